@@ -0,0 +1,351 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDBenchmark.h"
+#include "VARIDModule.h"
+#include "VARIDProfile.h"
+#include "VARIDVFMapPointTable.h"
+#include <json.hpp>
+#include "Interfaces/IPluginManager.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+using json = nlohmann::json;
+
+const int32 FVARIDBenchmark::NumPointsCases[4] = { 10, 100, 1000, 10000 };
+const int32 FVARIDBenchmark::NumFilesCases[3] = { 100, 1000, 10000 };
+
+static const double SECONDS_PER_CASE = 0.5;
+static const int32 MIN_ITERATIONS = 5;
+static const int32 MAX_ITERATIONS = 10000;
+
+/** keeps the optimiser from dropping work whose result is otherwise unused */
+static volatile int64 GVARIDBenchmarkSink = 0;
+
+FVARIDBenchmarkResult::FVARIDBenchmarkResult()
+{
+	NumIterations = 0;
+	MinMicroseconds = 0.0;
+	MedianMicroseconds = 0.0;
+	MeanMicroseconds = 0.0;
+	MaxMicroseconds = 0.0;
+	Bytes = -1;
+}
+
+/**
+ * times InFunction after one call to warm up. Each iteration calls it InNumCalls times and the results are per call, which keeps
+ * calls shorter than the timer's resolution measurable
+ */
+template <typename FunctionType>
+static FVARIDBenchmarkResult Measure(const TCHAR* InName, const FString& InCase, double InSeconds, int32 InNumCalls, FunctionType InFunction)
+{
+	InFunction();
+
+	TArray<double> Samples;
+	const double StartTime = FPlatformTime::Seconds();
+
+	while (Samples.Num() < MIN_ITERATIONS || (Samples.Num() < MAX_ITERATIONS && FPlatformTime::Seconds() - StartTime < InSeconds))
+	{
+		const double IterationStartTime = FPlatformTime::Seconds();
+		for (int32 Call = 0; Call < InNumCalls; ++Call)
+		{
+			InFunction();
+		}
+		Samples.Add((FPlatformTime::Seconds() - IterationStartTime) * 1e6 / InNumCalls);
+	}
+
+	return FVARIDBenchmark::Summarise(InName, InCase, Samples);
+}
+
+/** a VF map of InNumPoints points spread over the display, with the 0..33 dB range of a perimeter, at "/vf_map" of the returned json */
+static FString MakeVFMapJson(int32 InNumPoints, const FVector2D& InDisplayFOV, int32 InSeed)
+{
+	FRandomStream RandomStream(InSeed);
+
+	FString Data;
+	Data.Reserve(InNumPoints * 32);
+
+	for (int32 i = 0; i < InNumPoints; ++i)
+	{
+		const float RawX = RandomStream.FRandRange(-InDisplayFOV.X / 2.0f, InDisplayFOV.X / 2.0f);
+		const float RawY = RandomStream.FRandRange(-InDisplayFOV.Y / 2.0f, InDisplayFOV.Y / 2.0f);
+		const int32 RawValue = RandomStream.RandRange(0, 33);
+		Data += FString::Printf(TEXT("%s%.2f, %.2f, %d, 0, 33"), i > 0 ? TEXT(", ") : TEXT(""), RawX, RawY, RawValue);
+	}
+
+	return FString::Printf(TEXT("{ \"vf_map\": { \"expected_num_data_points\": %d, \"data\": [ %s ] } }"), InNumPoints, *Data);
+}
+
+void FVARIDBenchmark::Run(bool bInQuick, TArray<FVARIDBenchmarkResult>& OutResults)
+{
+	FVARIDModule& Module = FVARIDModule::Get();
+	const double Seconds = bInQuick ? SECONDS_PER_CASE / 10.0 : SECONDS_PER_CASE;
+
+	const FVector2D PreviousDisplayFOV = Module.GetDisplayFOV();
+	Module.SetDisplayFOV(FVector2D(100.0f, 100.0f));
+
+	OutResults.Reset();
+
+	/*************************************************************/
+	// LoadProfile() on every shipped profile, including those that are meant to fail
+
+	const FString ProfilesDir = FPaths::Combine(IPluginManager::Get().FindPlugin(TEXT("VARID"))->GetContentDir(), TEXT("Profiles"));
+	TArray<FString> ProfileFiles;
+	Module.ListProfiles(ProfilesDir, TEXT("json"), ProfileFiles);
+
+	for (const FString& File : ProfileFiles)
+	{
+		OutResults.Add(Measure(TEXT("LoadProfile"), FPaths::GetCleanFilename(File), Seconds, 1, [&Module, &File]()
+		{
+			FVARIDProfile Profile;
+			GVARIDBenchmarkSink += Module.LoadProfile(File, Profile) ? 1 : 0;
+		}));
+	}
+
+	/*************************************************************/
+	// ParseVFMap() on synthetic maps. It takes the json text, so the parse of the text alone is timed too
+
+	TArray<FVARIDVFMap> SyntheticVFMaps;
+
+	for (int32 NumPoints : NumPointsCases)
+	{
+		const FString Json = MakeVFMapJson(NumPoints, Module.GetDisplayFOV(), NumPoints);
+		const FString Case = FString::Printf(TEXT("%d points"), NumPoints);
+
+		OutResults.Add(Measure(TEXT("JsonParse"), Case, Seconds, 1, [&Json]()
+		{
+			json JsonObject = json::parse(TCHAR_TO_UTF8(*Json), nullptr, false, false);
+			GVARIDBenchmarkSink += JsonObject.size();
+		}));
+
+		FVARIDVFMap& VFMap = SyntheticVFMaps.AddDefaulted_GetRef();
+		OutResults.Add(Measure(TEXT("ParseVFMap"), Case, Seconds, 1, [&Module, &Json, &VFMap]()
+		{
+			GVARIDBenchmarkSink += Module.ParseVFMapJson(Json, TEXT("/vf_map"), VFMap) ? 1 : 0;
+		}));
+	}
+
+	/*************************************************************/
+	// the copy constructor, which clones the profile for the render thread, and the FX accessors. Every map of both eyes has the synthetic points
+	// at the same positions, each with its own values, as a perimeter's maps of one eye do. The points of the copy are compared, in time and bytes,
+	// with the same maps held as arrays of FVARIDVFMapPoint
+
+	for (int32 Case = 0; Case < SyntheticVFMaps.Num(); ++Case)
+	{
+		FVARIDProfile Profile;
+		Profile.Name = TEXT("Benchmark");
+		Profile.IsValid = true;
+
+		for (FVARIDEye* Eye : { &Profile.LeftEye, &Profile.RightEye })
+		{
+			Eye->Blur.VFMap = SyntheticVFMaps[Case];
+			Eye->Inpaint.VFMap = SyntheticVFMaps[Case];
+			Eye->Warp.VFMap = SyntheticVFMaps[Case];
+			Eye->Contrast.VFMaps.Init(SyntheticVFMaps[Case], 10);
+		}
+
+		const TArray<FVARIDVFMap*> VFMaps = Profile.GetVFMaps();
+		TArray<TArray<FVARIDVFMapPoint>> ArrayVFMaps;
+		TArray<const FVARIDVFMapPoints*> VFMapPoints;
+
+		for (FVARIDVFMap* VFMap : VFMaps)
+		{
+			for (int32 i = 0; i < VFMap->Points.Num(); ++i)
+			{
+				VFMap->Points.SetValue(i, VFMap->Points.GetValue(i) * (ArrayVFMaps.Num() + 1) / VFMaps.Num());
+			}
+
+			VFMap->Points.GetPoints(ArrayVFMaps.AddDefaulted_GetRef());
+			VFMapPoints.Add(&VFMap->Points);
+		}
+
+		const FString CaseName = FString::Printf(TEXT("%d points per map"), NumPointsCases[Case]);
+
+		FVARIDBenchmarkResult& CopyResult = OutResults.Add_GetRef(Measure(TEXT("ProfileCopy"), CaseName, Seconds, 1, [&Profile]()
+		{
+			FVARIDProfile Copy(Profile);
+			GVARIDBenchmarkSink += Copy.LeftEye.Blur.VFMap.Points.Num();
+		}));
+		CopyResult.Bytes = FVARIDVFMapPoints::GetAllocatedSize(VFMapPoints);
+
+		FVARIDBenchmarkResult& ArrayCopyResult = OutResults.Add_GetRef(Measure(TEXT("ProfileCopy"), CaseName + TEXT(" as FVARIDVFMapPoint"), Seconds, 1, [&ArrayVFMaps]()
+		{
+			TArray<TArray<FVARIDVFMapPoint>> Copy(ArrayVFMaps);
+			GVARIDBenchmarkSink += Copy[0].Num();
+		}));
+
+		ArrayCopyResult.Bytes = 0;
+		for (const TArray<FVARIDVFMapPoint>& Points : ArrayVFMaps)
+		{
+			ArrayCopyResult.Bytes += Points.GetAllocatedSize();
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("VARID: Benchmark points of a profile (%s): %lld bytes, %lld as FVARIDVFMapPoint"), *CaseName, CopyResult.Bytes, ArrayCopyResult.Bytes);
+	}
+
+	{
+		FVARIDProfile Profile;
+		const int32 NumFX = Profile.GetFX().Num();
+
+		OutResults.Add(Measure(TEXT("GetFX"), TEXT("all"), Seconds, 100, [&Profile]()
+		{
+			GVARIDBenchmarkSink += Profile.GetFX().Num();
+		}));
+
+		OutResults.Add(Measure(TEXT("GetFX"), TEXT("by ID"), Seconds, 100, [&Profile, NumFX]()
+		{
+			for (int32 ID = 0; ID < NumFX; ++ID)
+			{
+				GVARIDBenchmarkSink += Profile.GetFX(ID) ? 1 : 0;
+			}
+		}));
+
+		// twice per ID, which leaves the profile as it was
+		OutResults.Add(Measure(TEXT("ToggleFX"), TEXT("every ID twice"), Seconds, 100, [&Profile, NumFX]()
+		{
+			for (int32 ID = 0; ID < NumFX * 2; ++ID)
+			{
+				Profile.ToggleFX(ID % NumFX);
+			}
+		}));
+	}
+
+	/*************************************************************/
+	// ListProfiles() on directories of empty profiles
+
+	const FString ListRootDir = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("VARID"), TEXT("Benchmark"));
+
+	for (int32 NumFiles : NumFilesCases)
+	{
+		if (bInQuick && NumFiles == NumFilesCases[UE_ARRAY_COUNT(NumFilesCases) - 1])
+		{
+			continue;
+		}
+
+		const FString Dir = FPaths::Combine(ListRootDir, FString::Printf(TEXT("ListProfiles%d"), NumFiles));
+		for (int32 i = 0; i < NumFiles; ++i)
+		{
+			FFileHelper::SaveStringToFile(TEXT("{}"), *FPaths::Combine(Dir, FString::Printf(TEXT("Profile%05d.json"), i)));
+		}
+
+		OutResults.Add(Measure(TEXT("ListProfiles"), FString::Printf(TEXT("%d files"), NumFiles), Seconds, 1, [&Module, &Dir]()
+		{
+			TArray<FString> Files;
+			Module.ListProfiles(Dir, TEXT("json"), Files);
+			GVARIDBenchmarkSink += Files.Num();
+		}));
+	}
+
+	IFileManager::Get().DeleteDirectory(*ListRootDir, false, true);
+
+	/*************************************************************/
+	// the per frame packing of one map's points for both eyes of single pass stereo, as BuildHeightMapTexture_RenderThread does
+
+	for (int32 Case = 0; Case < SyntheticVFMaps.Num(); ++Case)
+	{
+		const FVARIDVFMapPoints& Points = SyntheticVFMaps[Case].Points;
+		const FVector2D GazePoint(0.02f, -0.01f);
+
+		OutResults.Add(Measure(TEXT("PackShaderPoints"), FString::Printf(TEXT("%d points, two eyes"), NumPointsCases[Case]), Seconds, 1, [&Points, &GazePoint]()
+		{
+			TArray<FShaderParameterMapPoint> FilteredPoints;
+			FVARIDVFMapPointTable::AddShaderPoints(Points, 0.5f, 0.0f, GazePoint, FilteredPoints);
+			FVARIDVFMapPointTable::AddShaderPoints(Points, 0.5f, 0.5f, GazePoint, FilteredPoints);
+			GVARIDBenchmarkSink += FilteredPoints.Num();
+		}));
+	}
+
+	Module.SetDisplayFOV(PreviousDisplayFOV);
+}
+
+FVARIDBenchmarkResult FVARIDBenchmark::Summarise(const FString& InName, const FString& InCase, TArray<double>& InOutSamples)
+{
+	FVARIDBenchmarkResult Result;
+	Result.Name = InName;
+	Result.Case = InCase;
+
+	if (InOutSamples.Num() == 0)
+	{
+		return Result;
+	}
+
+	InOutSamples.Sort();
+
+	double Sum = 0.0;
+	for (double Sample : InOutSamples)
+	{
+		Sum += Sample;
+	}
+
+	Result.NumIterations = InOutSamples.Num();
+	Result.MinMicroseconds = InOutSamples[0];
+	Result.MedianMicroseconds = InOutSamples[InOutSamples.Num() / 2];
+	Result.MeanMicroseconds = Sum / InOutSamples.Num();
+	Result.MaxMicroseconds = InOutSamples.Last();
+
+	UE_LOG(LogTemp, Display, TEXT("VARID: Benchmark %s (%s): median %.2f us, min %.2f us over %d iterations"), *InName, *InCase, Result.MedianMicroseconds, Result.MinMicroseconds, Result.NumIterations);
+	return Result;
+}
+
+FString FVARIDBenchmark::ToJson(const TArray<FVARIDBenchmarkResult>& InResults)
+{
+	json Root;
+	Root["plugin_version"] = TCHAR_TO_UTF8(*IPluginManager::Get().FindPlugin(TEXT("VARID"))->GetDescriptor().VersionName);
+	Root["engine_version"] = TCHAR_TO_UTF8(*FEngineVersion::Current().ToString());
+	Root["build_configuration"] = TCHAR_TO_UTF8(LexToString(FApp::GetBuildConfiguration()));
+	Root["date"] = TCHAR_TO_UTF8(*FDateTime::UtcNow().ToIso8601());
+	Root["platform"] = FPlatformProperties::IniPlatformName();
+	Root["cpu"] = TCHAR_TO_UTF8(*FPlatformMisc::GetCPUBrand().TrimStartAndEnd());
+
+	json Results = json::array();
+
+	for (const FVARIDBenchmarkResult& Result : InResults)
+	{
+		json JsonResult;
+		JsonResult["name"] = TCHAR_TO_UTF8(*Result.Name);
+		JsonResult["case"] = TCHAR_TO_UTF8(*Result.Case);
+		JsonResult["iterations"] = Result.NumIterations;
+		JsonResult["min_us"] = Result.MinMicroseconds;
+		JsonResult["median_us"] = Result.MedianMicroseconds;
+		JsonResult["mean_us"] = Result.MeanMicroseconds;
+		JsonResult["max_us"] = Result.MaxMicroseconds;
+		if (Result.Bytes >= 0)
+		{
+			JsonResult["bytes"] = Result.Bytes;
+		}
+		Results.push_back(JsonResult);
+	}
+
+	Root["results"] = Results;
+
+	return FString(UTF8_TO_TCHAR(Root.dump(1, '\t').c_str()));
+}
+
+bool FVARIDBenchmark::RunAndSave(const FString& InOutputPath, bool bInQuick, FString& OutOutputPath)
+{
+	TArray<FVARIDBenchmarkResult> Results;
+	Run(bInQuick, Results);
+
+	OutOutputPath = InOutputPath;
+	if (OutOutputPath.IsEmpty())
+	{
+		OutOutputPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("VARID"), FString::Printf(TEXT("Benchmark-%s.json"), *FDateTime::Now().ToString()));
+	}
+
+	if (!FFileHelper::SaveStringToFile(ToJson(Results), *OutOutputPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Could not save the benchmark results to %s"), *OutOutputPath);
+		return false;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("VARID: Saved %d benchmark results to %s"), Results.Num(), *OutOutputPath);
+	return true;
+}
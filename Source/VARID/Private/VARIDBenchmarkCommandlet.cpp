@@ -0,0 +1,26 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDBenchmarkCommandlet.h"
+#include "VARIDBenchmark.h"
+#include "Misc/Parse.h"
+
+UVARIDBenchmarkCommandlet::UVARIDBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UVARIDBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString OutputPath;
+	FParse::Value(*Params, TEXT("output="), OutputPath);
+	const bool bQuick = FParse::Param(*Params, TEXT("quick"));
+
+	FString SavedPath;
+	return FVARIDBenchmark::RunAndSave(OutputPath, bQuick, SavedPath) ? 0 : 1;
+}
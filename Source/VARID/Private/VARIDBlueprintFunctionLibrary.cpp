@@ -7,6 +7,8 @@
 #include "VARIDModule.h"
 #include "VARIDProfile.h"
 #include "VARIDEyeTracking.h"
+#include "VARIDFrameSource.h"
+#include "VARIDOutputCapture.h"
 #include "EngineMinimal.h"
 
 // When working with blueprint functions, accessing logic using singletons is the simplest approach. 
@@ -44,6 +46,47 @@ void UVARIDBlueprintFunctionLibrary::SetActiveProfile(const FVARIDProfile& Profi
 	FVARIDModule::Get().SetActiveProfile(Profile);
 }
 
+void UVARIDBlueprintFunctionLibrary::SetViewProfile(const int32 ViewIndex, const FVARIDProfile& Profile)
+{
+	FVARIDModule::Get().SetViewProfile(ViewIndex, Profile);
+}
+
+void UVARIDBlueprintFunctionLibrary::SetPlayerProfile(const int32 PlayerIndex, const FVARIDProfile& Profile)
+{
+	FVARIDModule::Get().SetPlayerProfile(PlayerIndex, Profile);
+}
+
+void UVARIDBlueprintFunctionLibrary::ClearViewProfiles()
+{
+	FVARIDModule::Get().ClearViewProfiles();
+}
+
+bool UVARIDBlueprintFunctionLibrary::SetProgression(const TArray<FVARIDProfile>& Keyframes, const TArray<float>& Times)
+{
+	return FVARIDModule::Get().SetProgression(Keyframes, Times);
+}
+
+void UVARIDBlueprintFunctionLibrary::SetProgressionTime(const float Time)
+{
+	FVARIDModule::Get().SetProgressionTime(Time);
+}
+
+void UVARIDBlueprintFunctionLibrary::ClearProgression()
+{
+	FVARIDModule::Get().ClearProgression();
+}
+
+bool UVARIDBlueprintFunctionLibrary::RenderProfileBatch(UTexture* Source, const TArray<FVARIDProfile>& Profiles, const TArray<FVector2D>& GazePoints, const TArray<UTextureRenderTarget2D*>& Outputs)
+{
+	TArray<FVARIDProfileBatchEntry> Entries;
+	for (int32 i = 0; i < Profiles.Num(); i++)
+	{
+		Entries.Add(FVARIDProfileBatchEntry(Profiles[i], GazePoints.IsValidIndex(i) ? GazePoints[i] : FVector2D::ZeroVector));
+	}
+
+	return FVARIDModule::Get().RenderProfileBatch(Source, Entries, Outputs);
+}
+
 void UVARIDBlueprintFunctionLibrary::ListFX(TArray<FString>& OutFXDetails)
 {
 	FVARIDProfile& Profile = FVARIDModule::Get().GetActiveProfile();
@@ -60,20 +103,17 @@ void UVARIDBlueprintFunctionLibrary::ListFX(TArray<FString>& OutFXDetails)
 
 void UVARIDBlueprintFunctionLibrary::ToggleFX(const int32 ID)
 {
-	FVARIDProfile& Profile = FVARIDModule::Get().GetActiveProfile();
-	Profile.ToggleFX(ID);
+	FVARIDModule::Get().ToggleFX(ID);
 }
 
 void UVARIDBlueprintFunctionLibrary::EnableAllFX()
 {
-	FVARIDProfile& Profile = FVARIDModule::Get().GetActiveProfile();
-	Profile.EnableAllFX();
+	FVARIDModule::Get().EnableAllFX();
 }
 
 void UVARIDBlueprintFunctionLibrary::DisableAllFX()
 {
-	FVARIDProfile& Profile = FVARIDModule::Get().GetActiveProfile();
-	Profile.DisableAllFX();
+	FVARIDModule::Get().DisableAllFX();
 }
 
 void UVARIDBlueprintFunctionLibrary::BeginRendering()
@@ -86,6 +126,11 @@ void UVARIDBlueprintFunctionLibrary::EndRendering()
 	FVARIDModule::Get().EndRendering();
 }
 
+bool UVARIDBlueprintFunctionLibrary::IsRenderingActive()
+{
+	return FVARIDModule::Get().IsRenderingActive();
+}
+
 FVARIDEyeTracking& UVARIDBlueprintFunctionLibrary::GetEyeTracking()
 {
 	return FVARIDModule::Get().GetEyeTracking();
@@ -104,4 +149,82 @@ const FVector2D& UVARIDBlueprintFunctionLibrary::GetDisplayFOV()
 void UVARIDBlueprintFunctionLibrary::SetDisplayFOV(const FVector2D& DisplayFOV)
 {
 	FVARIDModule::Get().SetDisplayFOV(DisplayFOV);
-}
\ No newline at end of file
+}
+
+bool UVARIDBlueprintFunctionLibrary::BeginTraceRecording(const FString& FilePath)
+{
+	return FVARIDModule::Get().BeginTraceRecording(FilePath);
+}
+
+void UVARIDBlueprintFunctionLibrary::EndTraceRecording()
+{
+	FVARIDModule::Get().EndTraceRecording();
+}
+
+bool UVARIDBlueprintFunctionLibrary::BeginTraceReplay(const FString& FilePath)
+{
+	return FVARIDModule::Get().BeginTraceReplay(FilePath);
+}
+
+void UVARIDBlueprintFunctionLibrary::EndTraceReplay()
+{
+	FVARIDModule::Get().EndTraceReplay();
+}
+
+bool UVARIDBlueprintFunctionLibrary::BeginFileFrameSource(const FString& Path, float FramesPerSecond, bool bSideBySideStereo)
+{
+	return FVARIDModule::Get().SetFrameSource(MakeShareable(new FVARIDFileFrameSource(Path, FramesPerSecond, bSideBySideStereo)));
+}
+
+void UVARIDBlueprintFunctionLibrary::EndFrameSource()
+{
+	FVARIDModule::Get().ClearFrameSource();
+}
+
+bool UVARIDBlueprintFunctionLibrary::BeginProfileHotReload(const FString& ProfileFullPath, float DebounceSeconds)
+{
+	return FVARIDModule::Get().BeginProfileHotReload(ProfileFullPath, DebounceSeconds);
+}
+
+void UVARIDBlueprintFunctionLibrary::EndProfileHotReload()
+{
+	FVARIDModule::Get().EndProfileHotReload();
+}
+
+bool UVARIDBlueprintFunctionLibrary::BeginOutputCapture(const FString& Directory, const FString& Format)
+{
+	EVARIDCaptureFormat CaptureFormat;
+	if (!FVARIDCaptureWriter::ParseFormat(Format, CaptureFormat))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Output capture format must be PNG, EXR or Raw, not %s"), *Format);
+		return false;
+	}
+
+	return FVARIDModule::Get().BeginOutputCapture(Directory, CaptureFormat);
+}
+
+void UVARIDBlueprintFunctionLibrary::EndOutputCapture()
+{
+	FVARIDModule::Get().EndOutputCapture();
+}
+
+TArray<FVARIDVFMapPoint> UVARIDBlueprintFunctionLibrary::GetVFMapPoints(const FVARIDVFMap& VFMap)
+{
+	// a map made in a blueprint before Points replaced Data
+	if (VFMap.Points.Num() == 0)
+	{
+		return VFMap.Data;
+	}
+
+	TArray<FVARIDVFMapPoint> Points;
+	VFMap.Points.GetPoints(Points);
+	return Points;
+}
+
+void UVARIDBlueprintFunctionLibrary::SetVFMapPoints(FVARIDVFMap& VFMap, const TArray<FVARIDVFMapPoint>& Points)
+{
+	VFMap.Points.SetPoints(Points);
+	VFMap.Data.Empty();
+	VFMap.ExpectedNumDataPoints = Points.Num();
+	VFMap.ResetDerivedData();
+}
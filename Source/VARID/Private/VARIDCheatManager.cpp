@@ -5,8 +5,15 @@
 
 #include "VARIDCheatManager.h"
 #include "VARIDModule.h"
+#include "VARIDReference.h"
+#include "VARIDBenchmark.h"
+#include "VARIDTrace.h"
+#include "VARIDTraceRecorder.h"
+#include "VARIDFrameSource.h"
+#include "VARIDOutputCapture.h"
 #include "GameFramework/CheatManager.h"
 #include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
 
 void UVARIDCheatManager::VARID_SetProfileRootPath(const FString& ProfileRootPath)
 {
@@ -34,33 +41,62 @@ void UVARIDCheatManager::VARID_ListProfiles()
 
 void UVARIDCheatManager::VARID_SetActiveProfile(const int32 ID)
 {
-	TArray<FString> Files;
-	FVARIDModule::Get().ListProfiles(Files);
+	FVARIDProfile Profile;
+	if (LoadProfileByID(ID, Profile))
+	{
+		FVARIDModule::Get().SetActiveProfile(Profile);
+	}
+}
 
-	// HACK: we are relying on the file system not changing between listing the profiles and loading a profile
-	
-	if (Files.IsValidIndex(ID))
+void UVARIDCheatManager::VARID_SetViewProfile(const int32 ViewIndex, const int32 ID)
+{
+	FVARIDProfile Profile;
+	if (LoadProfileByID(ID, Profile))
 	{
-		FVARIDProfile Profile;
-		if (FVARIDModule::Get().LoadProfile(Files[ID], Profile))
-		{
-			FVARIDModule::Get().SetActiveProfile(Profile);
-		}
-		else
+		FVARIDModule::Get().SetViewProfile(ViewIndex, Profile);
+	}
+}
+
+void UVARIDCheatManager::VARID_SetPlayerProfile(const int32 PlayerIndex, const int32 ID)
+{
+	FVARIDProfile Profile;
+	if (LoadProfileByID(ID, Profile))
+	{
+		FVARIDModule::Get().SetPlayerProfile(PlayerIndex, Profile);
+	}
+}
+
+void UVARIDCheatManager::VARID_ClearViewProfiles()
+{
+	FVARIDModule::Get().ClearViewProfiles();
+}
+
+void UVARIDCheatManager::VARID_SetProgression(const FString& IDs)
+{
+	TArray<FString> IDStrings;
+	IDs.ParseIntoArray(IDStrings, TEXT(","));
+
+	TArray<FVARIDProfile> Keyframes;
+	for (const FString& IDString : IDStrings)
+	{
+		FVARIDProfile& Keyframe = Keyframes.AddDefaulted_GetRef();
+		if (!IDString.IsNumeric() || !LoadProfileByID(FCString::Atoi(*IDString), Keyframe))
 		{
-			FString Message = "Failed to load profile. Check log for details";
-			UE_LOG(LogTemp, Error, TEXT("%s"), *Message);
-			GetOuterAPlayerController()->ClientMessage(Message);
+			return;
 		}
 	}
-	else
+
+	if (!FVARIDModule::Get().SetProgression(Keyframes, TArray<float>()))
 	{
-		FString Message = "Invalid Profile ID";
-		UE_LOG(LogTemp, Error, TEXT("%s"), *Message);
-		GetOuterAPlayerController()->ClientMessage(Message);
+		GetOuterAPlayerController()->ClientMessage(TEXT("Invalid progression"));
 	}
 }
 
+void UVARIDCheatManager::VARID_SetProgressionTime(const float Time)
+{
+	FVARIDModule::Get().SetProgressionTime(Time);
+}
+
 void UVARIDCheatManager::VARID_ListFX()
 {
 	FVARIDProfile& Profile = FVARIDModule::Get().GetActiveProfile();
@@ -77,20 +113,17 @@ void UVARIDCheatManager::VARID_ListFX()
 
 void UVARIDCheatManager::VARID_ToggleFX(const int32 ID)
 {
-	FVARIDProfile& Profile = FVARIDModule::Get().GetActiveProfile();
-	Profile.ToggleFX(ID);
+	FVARIDModule::Get().ToggleFX(ID);
 }
 
 void UVARIDCheatManager::VARID_EnableAllFX()
 {
-	FVARIDProfile& Profile = FVARIDModule::Get().GetActiveProfile();
-	Profile.EnableAllFX();
+	FVARIDModule::Get().EnableAllFX();
 }
 
 void UVARIDCheatManager::VARID_DisableAllFX()
 {
-	FVARIDProfile& Profile = FVARIDModule::Get().GetActiveProfile();
-	Profile.DisableAllFX();
+	FVARIDModule::Get().DisableAllFX();
 }
 
 void UVARIDCheatManager::VARID_BeginRendering()
@@ -114,4 +147,197 @@ void UVARIDCheatManager::VARID_GetDisplayFOV()
 void UVARIDCheatManager::VARID_SetDisplayFOV(const float HorizontalFOV, const float VerticalFOV)
 {
 	FVARIDModule::Get().SetDisplayFOV(FVector2D(HorizontalFOV, VerticalFOV));
+}
+
+void UVARIDCheatManager::VARID_ReportTileSkipFractions(const int32 EyeWidth, const int32 EyeHeight)
+{
+#if WITH_DEV_AUTOMATION_TESTS
+	const FIntPoint EyeSize(EyeWidth > 1 ? EyeWidth : 1024, EyeHeight > 1 ? EyeHeight : 1024);
+
+	IConsoleVariable* ContrastThresholdCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("r.VARID.TileClassification.ContrastThreshold"));
+	const float ContrastThreshold = ContrastThresholdCVar ? ContrastThresholdCVar->GetFloat() : 0.0f;
+
+	TArray<FString> Files;
+	FVARIDModule::Get().ListProfiles(Files);
+
+	for (const FString& File : Files)
+	{
+		FVARIDProfile Profile;
+		if (!FVARIDModule::Get().LoadProfile(File, Profile))
+		{
+			continue;	// already logged
+		}
+
+		FString Report;
+		FVARIDReference::ReportTileSkipFractions(Profile, EyeSize, ContrastThreshold, Report);
+		ReportValidation(true, Report);
+	}
+#else
+	ReportValidation(false, TEXT("VARID: Tile skip fractions need the CPU reference, which this build doesn't have"));
+#endif
+}
+
+void UVARIDCheatManager::VARID_Benchmark()
+{
+	FString OutputPath;
+	const bool bSaved = FVARIDBenchmark::RunAndSave(FString(), false, OutputPath);
+	ReportValidation(bSaved, FString::Printf(TEXT("VARID: Benchmark %s %s"), bSaved ? TEXT("results saved to") : TEXT("FAILED. Could not save the results to"), *OutputPath));
+}
+
+void UVARIDCheatManager::VARID_BeginTraceRecording(const FString& FilePath)
+{
+	FVARIDModule& Module = FVARIDModule::Get();
+	const bool bRecording = Module.BeginTraceRecording(FilePath);
+	ReportValidation(bRecording, bRecording ? FString::Printf(TEXT("VARID: Recording trace to %s"), *Module.GetTraceRecorder()->GetFilePath()) : TEXT("VARID: Trace recording FAILED to start. Check log for details"));
+}
+
+void UVARIDCheatManager::VARID_EndTraceRecording()
+{
+	FVARIDModule::Get().EndTraceRecording();
+}
+
+void UVARIDCheatManager::VARID_BeginTraceReplay(const FString& FilePath)
+{
+	const bool bReplaying = FVARIDModule::Get().BeginTraceReplay(FilePath);
+	ReportValidation(bReplaying, bReplaying ? FString::Printf(TEXT("VARID: Replaying trace %s"), *FilePath) : TEXT("VARID: Trace replay FAILED to start. Check log for details"));
+}
+
+void UVARIDCheatManager::VARID_EndTraceReplay()
+{
+	FVARIDModule::Get().EndTraceReplay();
+}
+
+void UVARIDCheatManager::VARID_ReplayTraceCPU(const FString& FilePath)
+{
+	FString OutputPath;
+	const bool bSaved = FVARIDTrace::ReplayCPUAndSave(FilePath, FString(), OutputPath);
+	ReportValidation(bSaved, FString::Printf(TEXT("VARID: Trace replay %s %s"), bSaved ? TEXT("results saved to") : TEXT("FAILED. Could not save the results to"), *OutputPath));
+}
+
+void UVARIDCheatManager::VARID_BeginFileFrameSource(const FString& Path, const float FramesPerSecond, const bool SideBySideStereo)
+{
+	const bool bStarted = FVARIDModule::Get().SetFrameSource(MakeShareable(new FVARIDFileFrameSource(Path, FramesPerSecond > 0.0f ? FramesPerSecond : 30.0f, SideBySideStereo)));
+	ReportValidation(bStarted, bStarted ? FString::Printf(TEXT("VARID: Playing frames from %s"), *Path) : TEXT("VARID: Frame source FAILED to start. Check log for details"));
+}
+
+void UVARIDCheatManager::VARID_EndFrameSource()
+{
+	FVARIDModule::Get().ClearFrameSource();
+}
+
+void UVARIDCheatManager::VARID_ReportFrameSourceLatency()
+{
+	const TSharedPtr<IVARIDFrameSource, ESPMode::ThreadSafe>& FrameSource = FVARIDModule::Get().GetFrameSource();
+	const TSharedPtr<FVARIDFrameRing, ESPMode::ThreadSafe> Ring = FrameSource ? FrameSource->GetRing() : nullptr;
+
+	if (!Ring)
+	{
+		ReportValidation(false, TEXT("VARID: No frame source is set"));
+		return;
+	}
+
+	TArray<FVARIDBenchmarkResult> Results;
+	Ring->GetLatencyResults(Results);
+
+	FString Report = FString::Printf(TEXT("VARID: %s. %llu frames committed, %llu uploaded, %llu dropped. Median"), *FrameSource->GetDescription(), Ring->GetNumCommitted(), Ring->GetNumRead(), Ring->GetNumDropped());
+	for (const FVARIDBenchmarkResult& Result : Results)
+	{
+		Report += FString::Printf(TEXT(" %s %.2f ms"), *Result.Case, Result.MedianMicroseconds / 1000.0);
+	}
+
+	ReportValidation(true, Report);
+}
+
+void UVARIDCheatManager::VARID_BeginProfileHotReload(const int32 ID, const float DebounceSeconds)
+{
+	TArray<FString> Files;
+	FVARIDModule::Get().ListProfiles(Files);
+
+	if (!Files.IsValidIndex(ID))
+	{
+		ReportValidation(false, TEXT("Invalid Profile ID"));
+		return;
+	}
+
+	const bool bStarted = FVARIDModule::Get().BeginProfileHotReload(Files[ID], DebounceSeconds > 0.0f ? DebounceSeconds : 0.5f);
+	ReportValidation(bStarted, bStarted ? FString::Printf(TEXT("VARID: Hot reloading %s"), *Files[ID]) : TEXT("VARID: Profile hot reload FAILED to start. Check log for details"));
+}
+
+void UVARIDCheatManager::VARID_EndProfileHotReload()
+{
+	FVARIDModule::Get().EndProfileHotReload();
+}
+
+void UVARIDCheatManager::VARID_BeginOutputCapture(const FString& Format)
+{
+	EVARIDCaptureFormat CaptureFormat = EVARIDCaptureFormat::PNG;
+	if (!Format.IsEmpty() && !FVARIDCaptureWriter::ParseFormat(Format, CaptureFormat))
+	{
+		ReportValidation(false, FString::Printf(TEXT("VARID: Output capture format must be PNG, EXR or Raw, not %s"), *Format));
+		return;
+	}
+
+	FVARIDModule& Module = FVARIDModule::Get();
+	const bool bCapturing = Module.BeginOutputCapture(FString(), CaptureFormat);
+	ReportValidation(bCapturing, bCapturing ? FString::Printf(TEXT("VARID: Capturing output to %s"), *Module.GetOutputCapture()->GetDirectory()) : TEXT("VARID: Output capture FAILED to start. Check log for details"));
+}
+
+void UVARIDCheatManager::VARID_EndOutputCapture()
+{
+	FVARIDModule& Module = FVARIDModule::Get();
+	const TSharedPtr<FVARIDCaptureWriter, ESPMode::ThreadSafe> Writer = Module.GetOutputCapture();
+	if (!Writer)
+	{
+		return;
+	}
+
+	Module.EndOutputCapture();
+	ReportValidation(true, FString::Printf(TEXT("VARID: Output capture ended. %llu frames written, %llu dropped, %llu failed: %s"),
+		Writer->GetNumWritten(), Writer->GetQueue().GetNumDropped(), Writer->GetNumFailed(), *Writer->GetDirectory()));
+}
+
+bool UVARIDCheatManager::LoadProfileByID(const int32 InID, FVARIDProfile& OutProfile)
+{
+	if (InID == INDEX_NONE)
+	{
+		OutProfile = FVARIDProfile();
+		return true;
+	}
+
+	TArray<FString> Files;
+	FVARIDModule::Get().ListProfiles(Files);
+
+	// HACK: we are relying on the file system not changing between listing the profiles and loading a profile
+
+	if (!Files.IsValidIndex(InID))
+	{
+		FString Message = "Invalid Profile ID";
+		UE_LOG(LogTemp, Error, TEXT("%s"), *Message);
+		GetOuterAPlayerController()->ClientMessage(Message);
+		return false;
+	}
+
+	if (!FVARIDModule::Get().LoadProfile(Files[InID], OutProfile))
+	{
+		FString Message = "Failed to load profile. Check log for details";
+		UE_LOG(LogTemp, Error, TEXT("%s"), *Message);
+		GetOuterAPlayerController()->ClientMessage(Message);
+		return false;
+	}
+
+	return true;
+}
+
+void UVARIDCheatManager::ReportValidation(const bool bPassed, const FString& Report)
+{
+	if (bPassed)
+	{
+		UE_LOG(LogTemp, Display, TEXT("%s"), *Report);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s"), *Report);
+	}
+
+	GetOuterAPlayerController()->ClientMessage(Report);
 }
\ No newline at end of file
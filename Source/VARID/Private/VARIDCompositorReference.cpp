@@ -0,0 +1,218 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "VARIDPyramidLayout.h"
+#include "Math/RandomStream.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// the compute compositor, which samples the contrast levels itself instead of taking the level 0 reconstruct pass's output texture. It
+// replaces the reconstruct pass plus the raster compositor, so it has to give exactly what they give
+
+/** the warped UV and the (sampler clamped) mip level both compositors sample at, for the texel at InX, InY of a scene sized working texture */
+static void GetCompositorSample(const FVARIDImage& InBlurVFMap, const FVARIDImage& InWarpVFMap, int32 InNumMips, int32 InX, int32 InY, FVector2D& OutWarpedUV, float& OutLevel)
+{
+	// texel centres - the bilinear VF map samples land on one texel
+	const FVector2D UV((InX + 0.5f) / InBlurVFMap.Size.X, (InY + 0.5f) / InBlurVFMap.Size.Y);
+	const FVector4 Warp = InWarpVFMap.Load(InX, InY);
+	OutWarpedUV = UV + FVector2D(Warp.X, Warp.Y);
+
+	// InMaxMipLevel is the number of mips. the sampler clamps to the last one
+	const float MaxMipLevel = (float)InNumMips;
+	OutLevel = FMath::Clamp(FMath::Clamp(InBlurVFMap.Load(InX, InY).X * MaxMipLevel, 0.0f, MaxMipLevel), 0.0f, (float)(InNumMips - 1));
+}
+
+/** trilinear sample of levels 1 and up, as both compositors take it */
+static FVector4 SampleContrastLevels(const TArray<FVARIDImage>& InContrastMips, const FVector2D& InUV, float InLevel)
+{
+	const int32 Level0 = FMath::Min(FMath::FloorToInt(InLevel), InContrastMips.Num() - 1);
+	const int32 Level1 = FMath::Min(Level0 + 1, InContrastMips.Num() - 1);
+	return FMath::Lerp(FVARIDReference::SampleBilinearClamped(InContrastMips[Level0], InUV), FVARIDReference::SampleBilinearClamped(InContrastMips[Level1], InUV), InLevel - Level0);
+}
+
+void FVARIDReference::CompositeRaster(const TArray<FVARIDImage>& InContrastMips, const FVARIDImage& InBlurVFMap, const FVARIDImage& InWarpVFMap, const FIntRect& InViewportRect, FVARIDImage& OutImage)
+{
+	for (int32 Y = InViewportRect.Min.Y; Y < InViewportRect.Max.Y; ++Y)
+	{
+		for (int32 X = InViewportRect.Min.X; X < InViewportRect.Max.X; ++X)
+		{
+			FVector2D WarpedUV;
+			float Level;
+			GetCompositorSample(InBlurVFMap, InWarpVFMap, InContrastMips.Num(), X, Y, WarpedUV, Level);
+
+			OutImage.Store(X, Y, RGBOnly(SampleContrastLevels(InContrastMips, WarpedUV, Level)));
+		}
+	}
+}
+
+void FVARIDReference::CompositeCompute(const TArray<FVARIDImage>& InGaussianMips, const TArray<FVARIDImage>& InVFMapMips, const TArray<FVARIDImage>& InContrastMips, const FVARIDImage& InBlurVFMap, const FVARIDImage& InWarpVFMap, const FIntRect& InViewportRect, FVARIDImage& OutImage, const FVARIDTileLists* InTileLists)
+{
+	check(InContrastMips.Num() > 1);
+
+	const FIntRect HiResRect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, 0);
+	const FIntRect LoResRect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, 1);
+
+	// LoadLevel0() in VARIDCompositorCS.usf
+	auto LoadLevel0 = [&](int32 InX, int32 InY)
+	{
+		const FIntPoint Position = ClampToRect(FIntPoint(InX, InY), HiResRect);
+		const FVector4 Colour = ReconstructFusedPixel(Position.X, Position.Y, InGaussianMips, InVFMapMips, InContrastMips, 0, HiResRect, LoResRect);
+		return FVector4(QuantiseUNORM16(Colour.X), QuantiseUNORM16(Colour.Y), QuantiseUNORM16(Colour.Z), 1.0f);
+	};
+
+	TArray<FIntPoint> GroupOrigins;
+	GetDispatchGroupOrigins(InViewportRect, TileListGroupSize, InTileLists ? &InTileLists->AffectedGroups : nullptr, GroupOrigins);
+
+	for (const FIntPoint& GroupOrigin : GroupOrigins)
+	{
+		for (int32 Index = 0; Index < TileListGroupSize * TileListGroupSize; ++Index)
+		{
+			const int32 X = GroupOrigin.X + Index % TileListGroupSize;
+			const int32 Y = GroupOrigin.Y + Index / TileListGroupSize;
+			if (X >= InViewportRect.Max.X || Y >= InViewportRect.Max.Y)
+			{
+				continue;
+			}
+
+			FVector2D WarpedUV;
+			float Level;
+			GetCompositorSample(InBlurVFMap, InWarpVFMap, InContrastMips.Num(), X, Y, WarpedUV, Level);
+
+			FVector4 Colour;
+			if (Level >= 1.0f)
+			{
+				Colour = SampleContrastLevels(InContrastMips, WarpedUV, Level);
+			}
+			else
+			{
+				const FVector4 Level0 = BilinearFilter(InGaussianMips[0].Size, WarpedUV, LoadLevel0);
+				const FVector4 Level1 = SampleBilinearClamped(InContrastMips[1], WarpedUV);
+				Colour = FMath::Lerp(Level0, Level1, Level);
+			}
+
+			OutImage.Store(X, Y, RGBOnly(Colour));
+		}
+	}
+
+	if (!InTileLists)
+	{
+		return;
+	}
+
+	// CopyCS
+	GetDispatchGroupOrigins(InViewportRect, TileListGroupSize, &InTileLists->UnaffectedGroups, GroupOrigins);
+
+	for (const FIntPoint& GroupOrigin : GroupOrigins)
+	{
+		for (int32 Index = 0; Index < TileListGroupSize * TileListGroupSize; ++Index)
+		{
+			const int32 X = GroupOrigin.X + Index % TileListGroupSize;
+			const int32 Y = GroupOrigin.Y + Index / TileListGroupSize;
+			if (X >= InViewportRect.Max.X || Y >= InViewportRect.Max.Y)
+			{
+				continue;
+			}
+
+			const FVector4 Gaussian = InGaussianMips[0].Load(X, Y);
+			OutImage.Store(X, Y, FVector4(QuantiseUNORM16(Gaussian.X), QuantiseUNORM16(Gaussian.Y), QuantiseUNORM16(Gaussian.Z), 1.0f));
+		}
+	}
+}
+
+bool FVARIDReference::ValidateComputeCompositor(FString& OutReport)
+{
+	const FIntPoint Extent(160, 120);
+	const FIntRect ViewportRect(FIntPoint(0, 0), Extent);
+	const int32 NumMips = FVARIDWorkingTexturePlan::CalculateNumMips2D(Extent);
+
+	FVARIDImage Image(Extent);
+	FRandomStream RandomStream(34);
+	for (int32 i = 0; i < Image.Pixels.Num(); ++i)
+	{
+		Image.Pixels[i] = FVector4(RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand(), 1.0f);
+	}
+
+	// contrast loss growing towards the right on every level
+	TArray<FVARIDImage> GaussianMips;
+	TArray<FVARIDImage> VFMapMips;
+	GaussianPyramidMultiPass(Image, ViewportRect, NumMips, GaussianMips);
+	AllocateMips(Extent, NumMips, VFMapMips);
+	for (int32 MipLevel = 0; MipLevel < NumMips; ++MipLevel)
+	{
+		FVARIDImage& VFMap = VFMapMips[MipLevel];
+		for (int32 Y = 0; Y < VFMap.Size.Y; ++Y)
+		{
+			for (int32 X = 0; X < VFMap.Size.X; ++X)
+			{
+				VFMap.Store(X, Y, FVector4((X + 0.5f) / VFMap.Size.X, 0.0f, 0.0f, 0.0f));
+			}
+		}
+	}
+
+	// the contrast texture as the GPU stores it: each level reconstructed from the stored (UNORM16) level above
+	TArray<FVARIDImage> ContrastMips;
+	AllocateMips(Extent, NumMips, ContrastMips);
+	DirectCopyTopLevel(GaussianMips, ViewportRect, ContrastMips);
+	for (int32 MipLevel = NumMips - 2; MipLevel >= 0; --MipLevel)
+	{
+		const FIntRect HiResRect = FVARIDPyramidLayout::GetMipViewportRect(ViewportRect, MipLevel);
+		const FIntRect LoResRect = FVARIDPyramidLayout::GetMipViewportRect(ViewportRect, MipLevel + 1);
+
+		for (int32 Y = HiResRect.Min.Y; Y < HiResRect.Max.Y; ++Y)
+		{
+			for (int32 X = HiResRect.Min.X; X < HiResRect.Max.X; ++X)
+			{
+				const FVector4 Colour = ReconstructFusedPixel(X, Y, GaussianMips, VFMapMips, ContrastMips, MipLevel, HiResRect, LoResRect);
+				ContrastMips[MipLevel].Store(X, Y, FVector4(QuantiseUNORM16(Colour.X), QuantiseUNORM16(Colour.Y), QuantiseUNORM16(Colour.Z), 1.0f));
+			}
+		}
+	}
+
+	// sharp in the middle, past the last mip in the corners. the warp pushes samples a few texels past the edges
+	FVARIDImage BlurVFMap(Extent);
+	FVARIDImage WarpVFMap(Extent);
+	int32 NumLevel0Samples = 0;
+	for (int32 Y = 0; Y < Extent.Y; ++Y)
+	{
+		for (int32 X = 0; X < Extent.X; ++X)
+		{
+			const FVector2D UV((X + 0.5f) / Extent.X, (Y + 0.5f) / Extent.Y);
+			const float Distance = FVector2D::Distance(UV, FVector2D(0.5f, 0.5f));
+			BlurVFMap.Store(X, Y, FVector4(FMath::Square(Distance / 0.6f), 0.0f, 0.0f, 0.0f));
+			WarpVFMap.Store(X, Y, FVector4(FMath::Sin(UV.Y * 9.0f) * 3.5f / Extent.X, FMath::Cos(UV.X * 7.0f) * 3.5f / Extent.Y, 0.0f, 0.0f));
+
+			NumLevel0Samples += BlurVFMap.Load(X, Y).X * NumMips < 1.0f ? 1 : 0;
+		}
+	}
+
+	FVARIDImage RasterOutput(Extent);
+	FVARIDImage ComputeOutput(Extent);
+	CompositeRaster(ContrastMips, BlurVFMap, WarpVFMap, ViewportRect, RasterOutput);
+
+	// level 0 must not be read by the compute path
+	TArray<FVARIDImage> ContrastMipsWithoutLevel0 = ContrastMips;
+	ContrastMipsWithoutLevel0[0] = FVARIDImage(Extent);
+	CompositeCompute(GaussianMips, VFMapMips, ContrastMipsWithoutLevel0, BlurVFMap, WarpVFMap, ViewportRect, ComputeOutput);
+
+	FIntPoint FirstMismatch;
+	if (!ImagesAreIdentical(RasterOutput, ComputeOutput, FirstMismatch))
+	{
+		OutReport = FString::Printf(TEXT("VARID: Compute compositor FAILED. First difference from the raster compositor at %d,%d"), FirstMismatch.X, FirstMismatch.Y);
+		return false;
+	}
+
+	if (NumLevel0Samples == 0)
+	{
+		OutReport = TEXT("VARID: Compute compositor FAILED. No pixel sampled level 0");
+		return false;
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: Compute compositor OK. Identical to the level 0 reconstruct pass + raster compositor at %dx%d. %d of %d pixels reconstructed level 0 on the fly"),
+		Extent.X, Extent.Y, NumLevel0Samples, Extent.X * Extent.Y);
+	return true;
+}
+
+#endif
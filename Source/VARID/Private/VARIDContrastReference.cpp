@@ -0,0 +1,313 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "VARIDPyramidLayout.h"
+#include "Math/RandomStream.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// the laplacian pyramid, the multi pass reconstruct and VARIDContrastReconstructFusedCS.usf, which folds the expand and the reconstruct of a
+// level into one dispatch. The fused pass must give the levels the multi pass one stores in UNORM16, clamped edges included
+
+/**
+ * bilinear 2x upsample with its taps clamped to the lo res viewport, then GaussianBlur() clamped to the hi res one. Written as two passes, like the render
+ * graph does it - see SetMipResampleParameters() in VARIDRendering.cpp
+ */
+static void ExpandMultiPass(const FVARIDImage& InLoRes, const FIntRect& InLoResRect, const FIntRect& InHiResRect, FVARIDImage& OutHiRes, int32 InKernelWidth)
+{
+	FVARIDImage Upsampled(OutHiRes.Size);
+
+	for (int32 Y = InHiResRect.Min.Y; Y < InHiResRect.Max.Y; ++Y)
+	{
+		for (int32 X = InHiResRect.Min.X; X < InHiResRect.Max.X; ++X)
+		{
+			// the hi res texel centre lands a quarter of a lo res texel away from the centre of the lo res texel underneath
+			const int32 NearX = X >> 1;
+			const int32 NearY = Y >> 1;
+			const int32 FarX = (X & 1) ? NearX + 1 : NearX - 1;
+			const int32 FarY = (Y & 1) ? NearY + 1 : NearY - 1;
+
+			FVector4 Colour(0.0f, 0.0f, 0.0f, 0.0f);
+			for (int32 Tap = 0; Tap < 4; ++Tap)
+			{
+				const FIntPoint Source = FVARIDReference::ClampToRect(FIntPoint((Tap & 1) ? FarX : NearX, (Tap & 2) ? FarY : NearY), InLoResRect);
+				const float Weight = ((Tap & 1) ? 0.25f : 0.75f) * ((Tap & 2) ? 0.25f : 0.75f);
+				Colour += InLoRes.Load(Source.X, Source.Y) * Weight;
+			}
+			Upsampled.Store(X, Y, Colour);
+		}
+	}
+
+	FVARIDReference::GaussianBlur(Upsampled, InHiResRect, InHiResRect, InKernelWidth, false, OutHiRes);
+}
+
+/** one axis of the combined expand kernel. must match ExpandWeights in VARIDContrastReconstructFused.ush */
+static void ExpandWeights(int32 X, int32 HiMin, int32 HiMax, int32 LoMin, int32 LoMax, int32& OutFirstTap, float OutWeights[4])
+{
+	OutFirstTap = (X >> 1) - 2 + (X & 1);
+
+	for (int32 i = 0; i < 4; ++i)
+	{
+		OutWeights[i] = 0.0f;
+	}
+
+	const float* Weights = FVARIDReference::GetBlurWeights(5);
+	for (int32 Tap = 0; Tap < 5; ++Tap)
+	{
+		const int32 HiRes = FMath::Clamp(X - 2 + Tap, HiMin, HiMax - 1);
+		const int32 Near = FMath::Clamp(HiRes >> 1, LoMin, LoMax - 1) - OutFirstTap;
+		const int32 Far = FMath::Clamp((HiRes & 1) ? (HiRes >> 1) + 1 : (HiRes >> 1) - 1, LoMin, LoMax - 1) - OutFirstTap;
+
+		check(Near >= 0 && Near < 4);
+		check(Far >= 0 && Far < 4);
+
+		OutWeights[Near] += Weights[Tap] * 0.75f;
+		OutWeights[Far] += Weights[Tap] * 0.25f;
+	}
+}
+
+void FVARIDReference::DirectCopyTopLevel(const TArray<FVARIDImage>& InGaussianMips, const FIntRect& InViewportRect, TArray<FVARIDImage>& OutContrastMips)
+{
+	const int32 TopLevel = InGaussianMips.Num() - 1;
+	const FIntRect Rect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, TopLevel);
+
+	for (int32 Y = Rect.Min.Y; Y < Rect.Max.Y; ++Y)
+	{
+		for (int32 X = Rect.Min.X; X < Rect.Max.X; ++X)
+		{
+			OutContrastMips[TopLevel].Store(X, Y, InGaussianMips[TopLevel].Load(X, Y));
+		}
+	}
+}
+
+void FVARIDReference::LaplacianPyramid(const TArray<FVARIDImage>& InGaussianMips, const FIntRect& InViewportRect, TArray<FVARIDImage>& OutLaplacianMips, int32 InKernelWidth)
+{
+	const int32 NumMips = InGaussianMips.Num();
+
+	// top level is a direct copy, no bias
+	AllocateMips(InGaussianMips[0].Size, NumMips, OutLaplacianMips);
+	DirectCopyTopLevel(InGaussianMips, InViewportRect, OutLaplacianMips);
+
+	for (int32 MipLevel = NumMips - 2; MipLevel >= 0; --MipLevel)
+	{
+		const FIntRect HiResRect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, MipLevel);
+		FVARIDImage Expanded(InGaussianMips[MipLevel].Size);
+		ExpandMultiPass(InGaussianMips[MipLevel + 1], FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, MipLevel + 1), HiResRect, Expanded, InKernelWidth);
+
+		for (int32 Y = HiResRect.Min.Y; Y < HiResRect.Max.Y; ++Y)
+		{
+			for (int32 X = HiResRect.Min.X; X < HiResRect.Max.X; ++X)
+			{
+				const FVector4 Difference = InGaussianMips[MipLevel].Load(X, Y) - Expanded.Load(X, Y);
+				OutLaplacianMips[MipLevel].Store(X, Y, FVector4(QuantiseUNORM16(Difference.X * 0.5f + 0.5f), QuantiseUNORM16(Difference.Y * 0.5f + 0.5f), QuantiseUNORM16(Difference.Z * 0.5f + 0.5f), 1.0f));
+			}
+		}
+	}
+}
+
+void FVARIDReference::ContrastReconstructFromLaplacian(const TArray<FVARIDImage>& InLaplacianMips, const TArray<FVARIDImage>& InVFMapMips, const FIntRect& InViewportRect, TArray<FVARIDImage>& OutContrastMips, int32 InKernelWidth)
+{
+	const int32 NumMips = InLaplacianMips.Num();
+	check(InVFMapMips.Num() == NumMips);
+
+	AllocateMips(InLaplacianMips[0].Size, NumMips, OutContrastMips);
+	DirectCopyTopLevel(InLaplacianMips, InViewportRect, OutContrastMips);
+
+	for (int32 MipLevel = NumMips - 2; MipLevel >= 0; --MipLevel)
+	{
+		const FIntRect HiResRect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, MipLevel);
+		FVARIDImage Expanded(InLaplacianMips[MipLevel].Size);
+		ExpandMultiPass(OutContrastMips[MipLevel + 1], FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, MipLevel + 1), HiResRect, Expanded, InKernelWidth);
+
+		for (int32 Y = HiResRect.Min.Y; Y < HiResRect.Max.Y; ++Y)
+		{
+			for (int32 X = HiResRect.Min.X; X < HiResRect.Max.X; ++X)
+			{
+				const float InvertedVFMapPixel = 1.0f - InVFMapMips[MipLevel].Load(X, Y).X;
+				const FVector4 Laplacian = InLaplacianMips[MipLevel].Load(X, Y) * 2.0f - FVector4(1.0f, 1.0f, 1.0f, 1.0f);	// reverse bias
+				const FVector4 Colour = Expanded.Load(X, Y) + Laplacian * InvertedVFMapPixel;
+				OutContrastMips[MipLevel].Store(X, Y, FVector4(SaturateUNORM(Colour.X), SaturateUNORM(Colour.Y), SaturateUNORM(Colour.Z), SaturateUNORM(Colour.W)));
+			}
+		}
+	}
+}
+
+void FVARIDReference::ContrastReconstructMultiPass(const TArray<FVARIDImage>& InGaussianMips, const TArray<FVARIDImage>& InVFMapMips, const FIntRect& InViewportRect, TArray<FVARIDImage>& OutContrastMips, int32 InKernelWidth)
+{
+	check(InVFMapMips.Num() == InGaussianMips.Num());
+
+	TArray<FVARIDImage> LaplacianMips;
+	LaplacianPyramid(InGaussianMips, InViewportRect, LaplacianMips, InKernelWidth);
+	ContrastReconstructFromLaplacian(LaplacianMips, InVFMapMips, InViewportRect, OutContrastMips, InKernelWidth);
+}
+
+FVector4 FVARIDReference::ReconstructFusedPixel(int32 X, int32 Y, const TArray<FVARIDImage>& InGaussianMips, const TArray<FVARIDImage>& InVFMapMips, const TArray<FVARIDImage>& InContrastMips, int32 InMipLevel, const FIntRect& InHiResRect, const FIntRect& InLoResRect)
+{
+	const FVARIDImage& LoResContrast = InContrastMips[InMipLevel + 1];
+	const FVARIDImage& LoResGaussian = InGaussianMips[InMipLevel + 1];
+
+	int32 FirstTapX;
+	int32 FirstTapY;
+	float WeightsX[4];
+	float WeightsY[4];
+	ExpandWeights(X, InHiResRect.Min.X, InHiResRect.Max.X, InLoResRect.Min.X, InLoResRect.Max.X, FirstTapX, WeightsX);
+	ExpandWeights(Y, InHiResRect.Min.Y, InHiResRect.Max.Y, InLoResRect.Min.Y, InLoResRect.Max.Y, FirstTapY, WeightsY);
+
+	FVector4 ExpandedContrast(0.0f, 0.0f, 0.0f, 0.0f);
+	FVector4 ExpandedGaussian(0.0f, 0.0f, 0.0f, 0.0f);
+
+	for (int32 TapY = 0; TapY < 4; ++TapY)
+	{
+		FVector4 ContrastRow(0.0f, 0.0f, 0.0f, 0.0f);
+		FVector4 GaussianRow(0.0f, 0.0f, 0.0f, 0.0f);
+
+		for (int32 TapX = 0; TapX < 4; ++TapX)
+		{
+			const FIntPoint Source = ClampToRect(FIntPoint(FirstTapX + TapX, FirstTapY + TapY), InLoResRect);
+			ContrastRow += LoResContrast.Load(Source.X, Source.Y) * WeightsX[TapX];
+			GaussianRow += LoResGaussian.Load(Source.X, Source.Y) * WeightsX[TapX];
+		}
+
+		ExpandedContrast += ContrastRow * WeightsY[TapY];
+		ExpandedGaussian += GaussianRow * WeightsY[TapY];
+	}
+
+	const FVector4 Laplacian = InGaussianMips[InMipLevel].Load(X, Y) - ExpandedGaussian;
+	const float InvertedVFMapPixel = 1.0f - InVFMapMips[InMipLevel].Load(X, Y).X;
+	const FVector4 Colour = ExpandedContrast + Laplacian * InvertedVFMapPixel;
+	return FVector4(SaturateUNORM(Colour.X), SaturateUNORM(Colour.Y), SaturateUNORM(Colour.Z), 1.0f);
+}
+
+void FVARIDReference::ContrastReconstructFused(const TArray<FVARIDImage>& InGaussianMips, const TArray<FVARIDImage>& InVFMapMips, const FIntRect& InViewportRect, TArray<FVARIDImage>& OutContrastMips, const FVARIDTileLists* InLevel0TileLists)
+{
+	const int32 NumMips = InGaussianMips.Num();
+	check(InVFMapMips.Num() == NumMips);
+
+	AllocateMips(InGaussianMips[0].Size, NumMips, OutContrastMips);
+	DirectCopyTopLevel(InGaussianMips, InViewportRect, OutContrastMips);
+
+	for (int32 MipLevel = NumMips - 2; MipLevel >= 0; --MipLevel)
+	{
+		const FIntRect HiResRect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, MipLevel);
+		const FIntRect LoResRect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, MipLevel + 1);
+
+		if (MipLevel == 0 && InLevel0TileLists)
+		{
+			TArray<FIntPoint> GroupOrigins;
+
+			// affected groups - reconstruct
+			GetDispatchGroupOrigins(HiResRect, TileListGroupSize, &InLevel0TileLists->AffectedGroups, GroupOrigins);
+			for (const FIntPoint& GroupOrigin : GroupOrigins)
+			{
+				for (int32 Index = 0; Index < TileListGroupSize * TileListGroupSize; ++Index)
+				{
+					const FIntPoint ID = GroupOrigin + FIntPoint(Index % TileListGroupSize, Index / TileListGroupSize);
+					if (HiResRect.Contains(ID))
+					{
+						OutContrastMips[0].Store(ID.X, ID.Y, ReconstructFusedPixel(ID.X, ID.Y, InGaussianMips, InVFMapMips, OutContrastMips, 0, HiResRect, LoResRect));
+					}
+				}
+			}
+
+			// unaffected groups - VARIDDirectCopyCS.usf
+			GetDispatchGroupOrigins(HiResRect, TileListGroupSize, &InLevel0TileLists->UnaffectedGroups, GroupOrigins);
+			for (const FIntPoint& GroupOrigin : GroupOrigins)
+			{
+				for (int32 Index = 0; Index < TileListGroupSize * TileListGroupSize; ++Index)
+				{
+					const FIntPoint ID = GroupOrigin + FIntPoint(Index % TileListGroupSize, Index / TileListGroupSize);
+					if (HiResRect.Contains(ID))
+					{
+						OutContrastMips[0].Store(ID.X, ID.Y, InGaussianMips[0].Load(ID.X, ID.Y));
+					}
+				}
+			}
+
+			continue;
+		}
+
+		for (int32 Y = HiResRect.Min.Y; Y < HiResRect.Max.Y; ++Y)
+		{
+			for (int32 X = HiResRect.Min.X; X < HiResRect.Max.X; ++X)
+			{
+				OutContrastMips[MipLevel].Store(X, Y, ReconstructFusedPixel(X, Y, InGaussianMips, InVFMapMips, OutContrastMips, MipLevel, HiResRect, LoResRect));
+			}
+		}
+	}
+}
+
+bool FVARIDReference::ValidateContrastReconstruct(FString& OutReport)
+{
+	const float Tolerance = 1.0f / 1024.0f;	// the multi pass laplacian is quantised to 16 bits per level
+
+	const FIntPoint Size(301, 157);
+	const FIntRect ViewportRects[2] = { FIntRect(0, 0, Size.X / 2, Size.Y), FIntRect(Size.X / 2, 0, Size.X, Size.Y) };
+	const int32 NumMips = 8;
+
+	FRandomStream RandomStream(91011);
+	FVARIDImage Image(Size);
+	for (int32 Y = 0; Y < Size.Y; ++Y)
+	{
+		for (int32 X = 0; X < Size.X; ++X)
+		{
+			Image.Store(X, Y, FVector4(RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand(), 1.0f));
+		}
+	}
+
+	// a different random loss per level and texel, from none to total
+	TArray<FVARIDImage> VFMapMips;
+	AllocateMips(Size, NumMips, VFMapMips);
+	for (FVARIDImage& VFMap : VFMapMips)
+	{
+		for (FVector4& Pixel : VFMap.Pixels)
+		{
+			Pixel = FVector4(RandomStream.FRand(), 0.0f, 0.0f, 0.0f);
+		}
+	}
+
+	float MaxError = 0.0f;
+
+	for (const FIntRect& ViewportRect : ViewportRects)
+	{
+		TArray<FVARIDImage> GaussianMips;
+		GaussianPyramidMultiPass(Image, ViewportRect, NumMips, GaussianMips);
+
+		TArray<FVARIDImage> MultiPassMips;
+		TArray<FVARIDImage> FusedMips;
+		ContrastReconstructMultiPass(GaussianMips, VFMapMips, ViewportRect, MultiPassMips);
+		ContrastReconstructFused(GaussianMips, VFMapMips, ViewportRect, FusedMips);
+
+		for (int32 MipLevel = 0; MipLevel < NumMips; ++MipLevel)
+		{
+			const FIntRect Rect = FVARIDPyramidLayout::GetMipViewportRect(ViewportRect, MipLevel);
+
+			for (int32 Y = Rect.Min.Y; Y < Rect.Max.Y; ++Y)
+			{
+				for (int32 X = Rect.Min.X; X < Rect.Max.X; ++X)
+				{
+					const FVector4 A = MultiPassMips[MipLevel].Load(X, Y);
+					const FVector4 B = FusedMips[MipLevel].Load(X, Y);
+					const float Error = FMath::Max(FMath::Max(FMath::Abs(A.X - B.X), FMath::Abs(A.Y - B.Y)), FMath::Max(FMath::Abs(A.Z - B.Z), FMath::Abs(A.W - B.W)));
+					MaxError = FMath::Max(MaxError, Error);
+
+					if (Error > Tolerance)
+					{
+						OutReport = FString::Printf(TEXT("VARID: Contrast reconstruct FAILED. Mismatch at (%d, %d) in mip %d for viewport starting at (%d, %d). Error=%f"), X, Y, MipLevel, ViewportRect.Min.X, ViewportRect.Min.Y, Error);
+						return false;
+					}
+				}
+			}
+		}
+	}
+
+	const int32 MultiPassDispatches = 2 * (1 + 3 * (NumMips - 1));	// laplacian + reconstruct: copy, then upsample, blur and combine per level
+	const int32 FusedDispatches = NumMips;	// copy, then one per level
+
+	OutReport = FString::Printf(TEXT("VARID: Contrast reconstruct OK. %d mips, max error %f (tolerance %f). Dispatches per eye: %d multi pass vs %d fused. Laplacian texture no longer needed"), NumMips, MaxError, Tolerance, MultiPassDispatches, FusedDispatches);
+	return true;
+}
+
+#endif
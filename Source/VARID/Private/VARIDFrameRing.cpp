@@ -0,0 +1,219 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDFrameRing.h"
+#include "VARIDBenchmark.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+
+FVARIDFrameLatency::FVARIDFrameLatency()
+	: FrameIndex(0)
+	, CaptureSeconds(0.0)
+	, CommitSeconds(0.0)
+	, UploadSeconds(0.0)
+	, CompositeSeconds(0.0)
+{
+
+}
+
+FVARIDFrameRing::FVARIDFrameRing(const FIntPoint& InSize, bool bInSideBySideStereo)
+	: Size(FIntPoint(FMath::Max(InSize.X, 1), FMath::Max(InSize.Y, 1)))
+	, bSideBySideStereo(bInSideBySideStereo)
+	, WriteSlot(INDEX_NONE)
+	, NewestSlot(INDEX_NONE)
+	, ReadSlot(INDEX_NONE)
+	, NumCommitted(0)
+	, NumDropped(0)
+	, NumRead(0)
+	, bLatencyPending(false)
+	, NextLatency(0)
+{
+	for (FVARIDFrameSlot& Slot : Slots)
+	{
+		Slot.Pixels.SetNumZeroed(GetPitch() * Size.Y);
+	}
+
+	Latencies.Reserve(NumLatencySamples);
+}
+
+FIntPoint FVARIDFrameRing::GetSize() const
+{
+	return Size;
+}
+
+bool FVARIDFrameRing::IsSideBySideStereo() const
+{
+	return bSideBySideStereo;
+}
+
+int32 FVARIDFrameRing::GetPitch() const
+{
+	return Size.X * BytesPerPixel;
+}
+
+uint8* FVARIDFrameRing::BeginWrite()
+{
+	FScopeLock ScopeLock(&Lock);
+
+	if (WriteSlot != INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	for (int32 i = 0; i < NumSlots; ++i)
+	{
+		if (i != NewestSlot && i != ReadSlot)
+		{
+			WriteSlot = i;
+			break;
+		}
+	}
+
+	check(WriteSlot != INDEX_NONE);
+	return Slots[WriteSlot].Pixels.GetData();
+}
+
+void FVARIDFrameRing::CommitWrite(double InCaptureSeconds)
+{
+	const double CommitSeconds = FPlatformTime::Seconds();
+
+	FScopeLock ScopeLock(&Lock);
+
+	if (WriteSlot == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (NewestSlot != INDEX_NONE)
+	{
+		++NumDropped;
+	}
+
+	FVARIDFrameLatency& Latency = Slots[WriteSlot].Latency;
+	Latency = FVARIDFrameLatency();
+	Latency.FrameIndex = NumCommitted++;
+	Latency.CaptureSeconds = InCaptureSeconds;
+	Latency.CommitSeconds = CommitSeconds;
+
+	NewestSlot = WriteSlot;
+	WriteSlot = INDEX_NONE;
+}
+
+void FVARIDFrameRing::CancelWrite()
+{
+	FScopeLock ScopeLock(&Lock);
+	WriteSlot = INDEX_NONE;
+}
+
+const FVARIDFrameSlot* FVARIDFrameRing::BeginRead()
+{
+	FScopeLock ScopeLock(&Lock);
+
+	if (ReadSlot != INDEX_NONE || NewestSlot == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	ReadSlot = NewestSlot;
+	NewestSlot = INDEX_NONE;
+	return &Slots[ReadSlot];
+}
+
+void FVARIDFrameRing::EndRead(double InUploadSeconds)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	if (ReadSlot == INDEX_NONE)
+	{
+		return;
+	}
+
+	PendingLatency = Slots[ReadSlot].Latency;
+	PendingLatency.UploadSeconds = InUploadSeconds;
+	bLatencyPending = true;
+
+	++NumRead;
+	ReadSlot = INDEX_NONE;
+}
+
+void FVARIDFrameRing::RecordComposite(double InCompositeSeconds)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	if (!bLatencyPending)
+	{
+		return;
+	}
+
+	PendingLatency.CompositeSeconds = InCompositeSeconds;
+	bLatencyPending = false;
+
+	if (Latencies.Num() < NumLatencySamples)
+	{
+		Latencies.Add(PendingLatency);
+	}
+	else
+	{
+		Latencies[NextLatency] = PendingLatency;
+	}
+
+	NextLatency = (NextLatency + 1) % NumLatencySamples;
+}
+
+uint64 FVARIDFrameRing::GetNumCommitted() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return NumCommitted;
+}
+
+uint64 FVARIDFrameRing::GetNumDropped() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return NumDropped;
+}
+
+uint64 FVARIDFrameRing::GetNumRead() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return NumRead;
+}
+
+void FVARIDFrameRing::GetLatencies(TArray<FVARIDFrameLatency>& OutLatencies) const
+{
+	FScopeLock ScopeLock(&Lock);
+
+	OutLatencies.Reset(Latencies.Num());
+
+	// until the buffer is full NextLatency is its end, and the oldest is at 0
+	const int32 Oldest = Latencies.Num() < NumLatencySamples ? 0 : NextLatency;
+	for (int32 i = 0; i < Latencies.Num(); ++i)
+	{
+		OutLatencies.Add(Latencies[(Oldest + i) % Latencies.Num()]);
+	}
+}
+
+void FVARIDFrameRing::GetLatencyResults(TArray<FVARIDBenchmarkResult>& OutResults) const
+{
+	TArray<FVARIDFrameLatency> FrameLatencies;
+	GetLatencies(FrameLatencies);
+
+	TArray<double> CaptureToCommit;
+	TArray<double> CommitToUpload;
+	TArray<double> UploadToComposite;
+	TArray<double> CaptureToComposite;
+
+	for (const FVARIDFrameLatency& Latency : FrameLatencies)
+	{
+		CaptureToCommit.Add((Latency.CommitSeconds - Latency.CaptureSeconds) * 1e6);
+		CommitToUpload.Add((Latency.UploadSeconds - Latency.CommitSeconds) * 1e6);
+		UploadToComposite.Add((Latency.CompositeSeconds - Latency.UploadSeconds) * 1e6);
+		CaptureToComposite.Add((Latency.CompositeSeconds - Latency.CaptureSeconds) * 1e6);
+	}
+
+	OutResults.Add(FVARIDBenchmark::Summarise(TEXT("FrameSource"), TEXT("CaptureToCommit"), CaptureToCommit));
+	OutResults.Add(FVARIDBenchmark::Summarise(TEXT("FrameSource"), TEXT("CommitToUpload"), CommitToUpload));
+	OutResults.Add(FVARIDBenchmark::Summarise(TEXT("FrameSource"), TEXT("UploadToCompositeSubmit"), UploadToComposite));
+	OutResults.Add(FVARIDBenchmark::Summarise(TEXT("FrameSource"), TEXT("CaptureToCompositeSubmit"), CaptureToComposite));
+}
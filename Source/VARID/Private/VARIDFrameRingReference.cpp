@@ -0,0 +1,165 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "VARIDFrameRing.h"
+#include "VARIDBenchmark.h"
+#include "Math/RandomStream.h"
+#include "HAL/PlatformTime.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// FVARIDFrameRing between the frame source and the render thread. The source keeps writing while a frame is held for upload, so a reader
+// must only ever get whole committed frames, and the latency counters must account for every one of them
+
+bool FVARIDReference::ValidateFrameRing(FString& OutReport)
+{
+	const FIntPoint Size(64, 32);
+	const int32 NumSteps = 2000;
+
+	FVARIDFrameRing Ring(Size, false);
+	const int32 NumBytes = Ring.GetPitch() * Size.Y;
+
+	// a frame's bytes are a function of its index, so a frame that was torn or overwritten while held shows up
+	auto GetByte = [](uint64 InFrameIndex, int32 InByteIndex) { return (uint8)(InFrameIndex * 7 + InByteIndex); };
+
+	FRandomStream RandomStream(4545);
+	TArray<uint8*> SlotPixels;
+	uint64 NumWritten = 0;
+	uint64 LastReadIndex = 0;
+	bool bRead = false;
+
+	for (int32 Step = 0; Step < NumSteps; ++Step)
+	{
+		// writes run ahead of reads, as a camera faster than the frame rate would, so frames get dropped
+		if (RandomStream.FRand() < 0.6f)
+		{
+			const double CaptureSeconds = FPlatformTime::Seconds();
+
+			uint8* Pixels = Ring.BeginWrite();
+			if (!Pixels || Ring.BeginWrite())
+			{
+				OutReport = FString::Printf(TEXT("VARID: Frame ring FAILED. Step %d: a write got %s slot"), Step, Pixels ? TEXT("a second") : TEXT("no"));
+				return false;
+			}
+
+			SlotPixels.AddUnique(Pixels);
+
+			for (int32 i = 0; i < NumBytes; ++i)
+			{
+				Pixels[i] = GetByte(NumWritten, i);
+			}
+
+			Ring.CommitWrite(CaptureSeconds);
+			++NumWritten;
+			continue;
+		}
+
+		const FVARIDFrameSlot* Slot = Ring.BeginRead();
+		if (!Slot)
+		{
+			continue;
+		}
+
+		const uint64 FrameIndex = Slot->Latency.FrameIndex;
+		if (FrameIndex != NumWritten - 1 || (bRead && FrameIndex <= LastReadIndex) || Ring.BeginRead())
+		{
+			OutReport = FString::Printf(TEXT("VARID: Frame ring FAILED. Step %d: read frame %llu when the newest was %llu"), Step, FrameIndex, NumWritten - 1);
+			return false;
+		}
+
+		// the source keeps writing while the frame is uploaded
+		const int32 NumHeldWrites = RandomStream.RandRange(0, 3);
+		for (int32 Write = 0; Write < NumHeldWrites; ++Write)
+		{
+			uint8* Pixels = Ring.BeginWrite();
+			if (!Pixels || Pixels == Slot->Pixels.GetData())
+			{
+				OutReport = FString::Printf(TEXT("VARID: Frame ring FAILED. Step %d: a write got %s"), Step, Pixels ? TEXT("the slot being read") : TEXT("no slot"));
+				return false;
+			}
+
+			SlotPixels.AddUnique(Pixels);
+
+			for (int32 i = 0; i < NumBytes; ++i)
+			{
+				Pixels[i] = GetByte(NumWritten, i);
+			}
+
+			Ring.CommitWrite(FPlatformTime::Seconds());
+			++NumWritten;
+		}
+
+		for (int32 i = 0; i < NumBytes; ++i)
+		{
+			if (Slot->Pixels[i] != GetByte(FrameIndex, i))
+			{
+				OutReport = FString::Printf(TEXT("VARID: Frame ring FAILED. Step %d: byte %d of frame %llu changed while it was read"), Step, i, FrameIndex);
+				return false;
+			}
+		}
+
+		Ring.EndRead(FPlatformTime::Seconds());
+		Ring.RecordComposite(FPlatformTime::Seconds());
+		Ring.RecordComposite(FPlatformTime::Seconds());	// a second view of the same frame isn't a sample
+
+		LastReadIndex = FrameIndex;
+		bRead = true;
+	}
+
+	/*************************************************************/
+	// no memory but the slots, and every frame accounted for
+
+	if (SlotPixels.Num() > FVARIDFrameRing::NumSlots)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Frame ring FAILED. Frames were written to %d places. Expected the %d slots"), SlotPixels.Num(), FVARIDFrameRing::NumSlots);
+		return false;
+	}
+
+	const uint64 NumCommitted = Ring.GetNumCommitted();
+	const uint64 NumRead = Ring.GetNumRead();
+	const uint64 NumDropped = Ring.GetNumDropped();
+	const uint64 NumUnread = NumCommitted - NumRead - NumDropped;
+
+	if (NumCommitted != NumWritten || NumUnread > 1 || NumRead == 0 || NumDropped == 0)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Frame ring FAILED. %llu frames written: %llu committed, %llu read and %llu dropped"), NumWritten, NumCommitted, NumRead, NumDropped);
+		return false;
+	}
+
+	/*************************************************************/
+	// latency counters: a sample per composited frame, oldest first, each stage after the last
+
+	TArray<FVARIDFrameLatency> Latencies;
+	Ring.GetLatencies(Latencies);
+
+	for (int32 i = 0; i < Latencies.Num(); ++i)
+	{
+		const FVARIDFrameLatency& Latency = Latencies[i];
+		const bool bOrdered = Latency.CaptureSeconds <= Latency.CommitSeconds && Latency.CommitSeconds <= Latency.UploadSeconds && Latency.UploadSeconds <= Latency.CompositeSeconds;
+
+		if (!bOrdered || (i > 0 && Latency.FrameIndex <= Latencies[i - 1].FrameIndex))
+		{
+			OutReport = FString::Printf(TEXT("VARID: Frame ring FAILED. Latency sample %d, frame %llu, is out of order"), i, Latency.FrameIndex);
+			return false;
+		}
+	}
+
+	TArray<FVARIDBenchmarkResult> Results;
+	Ring.GetLatencyResults(Results);
+
+	const int32 NumExpectedSamples = (int32)FMath::Min<uint64>(NumRead, FVARIDFrameRing::NumLatencySamples);
+	if (Latencies.Num() != NumExpectedSamples || Results.Num() != 4 || Results[3].NumIterations != NumExpectedSamples)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Frame ring FAILED. %d latency samples from %llu frames read"), Latencies.Num(), NumRead);
+		return false;
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: Frame ring OK. %llu frames of %dx%d through %d slots: %llu read, %llu dropped. Median capture to composite submitted %.2f us over the last %d"),
+		NumCommitted, Size.X, Size.Y, FVARIDFrameRing::NumSlots, NumRead, NumDropped, Results[3].MedianMicroseconds, Latencies.Num());
+	return true;
+}
+
+#endif
@@ -0,0 +1,183 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDFrameSource.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Modules/ModuleManager.h"
+
+/** B8G8R8A8. Fails on anything ImageWrapper can't decode to 8 bits per channel */
+static bool DecodeFrame(IImageWrapperModule& InImageWrapperModule, const FString& InFilePath, FIntPoint& OutSize, TArray<uint8>& OutPixels)
+{
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *InFilePath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Could not read frame: %s"), *InFilePath);
+		return false;
+	}
+
+	const EImageFormat Format = InImageWrapperModule.DetectImageFormat(FileData.GetData(), FileData.Num());
+	if (Format != EImageFormat::PNG && Format != EImageFormat::JPEG && Format != EImageFormat::BMP)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Frame must be a PNG, JPEG or BMP: %s"), *InFilePath);
+		return false;
+	}
+
+	TSharedPtr<IImageWrapper> ImageWrapper = InImageWrapperModule.CreateImageWrapper(Format);
+	if (!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(FileData.GetData(), FileData.Num()) || !ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, OutPixels))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Could not decode frame: %s"), *InFilePath);
+		return false;
+	}
+
+	OutSize = FIntPoint(ImageWrapper->GetWidth(), ImageWrapper->GetHeight());
+	return OutPixels.Num() == OutSize.X * OutSize.Y * FVARIDFrameRing::BytesPerPixel;
+}
+
+FVARIDFileFrameSource::FVARIDFileFrameSource(const FString& InPath, float InFramesPerSecond, bool bInSideBySideStereo)
+	: Path(InPath)
+	, FramesPerSecond(FMath::Max(InFramesPerSecond, 1.0f))
+	, bSideBySideStereo(bInSideBySideStereo)
+	, bStopping(false)
+{
+
+}
+
+FVARIDFileFrameSource::~FVARIDFileFrameSource()
+{
+	Stop();
+}
+
+bool FVARIDFileFrameSource::Start()
+{
+	Stop();
+
+	TArray<FString> FilePaths;
+
+	if (FPaths::DirectoryExists(Path))
+	{
+		TArray<FString> Files;
+		IFileManager::Get().FindFiles(Files, *FPaths::Combine(Path, TEXT("*")), true, false);
+		Files.Sort();
+
+		for (const FString& File : Files)
+		{
+			const FString Extension = FPaths::GetExtension(File).ToLower();
+			if (Extension == TEXT("png") || Extension == TEXT("jpg") || Extension == TEXT("jpeg") || Extension == TEXT("bmp"))
+			{
+				FilePaths.Add(FPaths::Combine(Path, File));
+			}
+		}
+
+		if (FilePaths.Num() > MaxNumFrames)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("VARID: Frame directory has %d images. Only the first %d are played: %s"), FilePaths.Num(), MaxNumFrames, *Path);
+			FilePaths.SetNum(MaxNumFrames);
+		}
+	}
+	else
+	{
+		FilePaths.Add(Path);
+	}
+
+	// modules can only be loaded on the game thread, and decoding up front keeps the capture thread to a copy per frame, as a camera's would be
+	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+
+	FIntPoint Size = FIntPoint::ZeroValue;
+	Frames.Reset();
+
+	for (const FString& FilePath : FilePaths)
+	{
+		FIntPoint FrameSize;
+		TArray<uint8> Pixels;
+		if (!DecodeFrame(ImageWrapperModule, FilePath, FrameSize, Pixels))
+		{
+			continue;
+		}
+
+		if (Frames.Num() == 0)
+		{
+			Size = FrameSize;
+		}
+		else if (FrameSize != Size)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("VARID: Frame is %dx%d, not %dx%d like the first. Left out: %s"), FrameSize.X, FrameSize.Y, Size.X, Size.Y, *FilePath);
+			continue;
+		}
+
+		Frames.Add(MoveTemp(Pixels));
+	}
+
+	if (Frames.Num() == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: No frames to play from %s"), *Path);
+		return false;
+	}
+
+	Ring = MakeShareable(new FVARIDFrameRing(Size, bSideBySideStereo));
+	bStopping = false;
+	CaptureThread = Async(EAsyncExecution::Thread, [this]() { CaptureFrames(); });
+
+	UE_LOG(LogTemp, Display, TEXT("VARID: Playing %d frames of %dx%d at %.1f fps from %s"), Frames.Num(), Size.X, Size.Y, FramesPerSecond, *Path);
+	return true;
+}
+
+void FVARIDFileFrameSource::Stop()
+{
+	if (CaptureThread.IsValid())
+	{
+		bStopping = true;
+		CaptureThread.Wait();
+		CaptureThread = TFuture<void>();
+	}
+}
+
+bool FVARIDFileFrameSource::IsRunning() const
+{
+	return CaptureThread.IsValid() && !CaptureThread.IsReady();
+}
+
+TSharedPtr<FVARIDFrameRing, ESPMode::ThreadSafe> FVARIDFileFrameSource::GetRing() const
+{
+	return Ring;
+}
+
+FString FVARIDFileFrameSource::GetDescription() const
+{
+	return FString::Printf(TEXT("File frame source %s (%d frames at %.1f fps)"), *Path, Frames.Num(), FramesPerSecond);
+}
+
+void FVARIDFileFrameSource::CaptureFrames()
+{
+	const double FramePeriod = 1.0 / FramesPerSecond;
+	const double StartSeconds = FPlatformTime::Seconds();
+
+	for (uint64 FrameCount = 0; !bStopping; ++FrameCount)
+	{
+		// frames are due on a fixed clock, so a late one doesn't push back the rest
+		const double DueSeconds = StartSeconds + FrameCount * FramePeriod;
+		const double WaitSeconds = DueSeconds - FPlatformTime::Seconds();
+		if (WaitSeconds > 0.0)
+		{
+			FPlatformProcess::Sleep((float)WaitSeconds);
+		}
+
+		const double CaptureSeconds = FPlatformTime::Seconds();
+		const TArray<uint8>& Frame = Frames[FrameCount % Frames.Num()];
+
+		// the copy a camera driver would make into the buffer it was handed
+		if (uint8* Pixels = Ring->BeginWrite())
+		{
+			FMemory::Memcpy(Pixels, Frame.GetData(), Frame.Num());
+			Ring->CommitWrite(CaptureSeconds);
+		}
+	}
+}
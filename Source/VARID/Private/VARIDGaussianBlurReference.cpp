@@ -0,0 +1,248 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "Math/RandomStream.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// VARIDGaussianBlurCS.usf for the three kernel widths. The weights are duplicated in HLSL and the f16 cache only rounds, so impulse responses
+// pin both down before a wider kernel or the half precision cache reaches the pyramid or the contrast chain
+
+// must match Weights5, Weights7 and Weights9 in VARIDCommon.ush
+static const float BLUR5_WEIGHTS[5] = { 1.0f / 16.0f, 4.0f / 16.0f, 6.0f / 16.0f, 4.0f / 16.0f, 1.0f / 16.0f };
+static const float BLUR7_WEIGHTS[7] = { 1.0f / 64.0f, 6.0f / 64.0f, 15.0f / 64.0f, 20.0f / 64.0f, 15.0f / 64.0f, 6.0f / 64.0f, 1.0f / 64.0f };
+static const float BLUR9_WEIGHTS[9] = { 1.0f / 256.0f, 8.0f / 256.0f, 28.0f / 256.0f, 56.0f / 256.0f, 70.0f / 256.0f, 56.0f / 256.0f, 28.0f / 256.0f, 8.0f / 256.0f, 1.0f / 256.0f };
+
+const float* FVARIDReference::GetBlurWeights(int32 InKernelWidth)
+{
+	switch (InKernelWidth)
+	{
+	case 7: return BLUR7_WEIGHTS;
+	case 9: return BLUR9_WEIGHTS;
+	default: check(InKernelWidth == 5); return BLUR5_WEIGHTS;
+	}
+}
+
+/** f32tof16 followed by f16tof32 - the half precision LDS cache of VARIDGaussianBlurCS.usf. Round to nearest even, denormals kept */
+static float QuantiseFP16(float InValue)
+{
+	uint32 Bits;
+	FMemory::Memcpy(&Bits, &InValue, sizeof(Bits));
+
+	// spacing of the f16 values around InValue. 10 mantissa bits, smallest normal exponent -14
+	const int32 Exponent = FMath::Max((int32)((Bits >> 23) & 0xFF) - 127, -14);
+	const float Step = FMath::Pow(2.0f, (float)(Exponent - 10));
+
+	return FMath::Clamp(FMath::RoundHalfToEven(InValue / Step) * Step, -65504.0f, 65504.0f);
+}
+
+/** Blur5, Blur7 or Blur9 from VARIDCommon.ush, in the same order of operations. InSamples[4] is the centre */
+static FVector4 BlurSamples(const FVector4 InSamples[9], int32 InKernelWidth)
+{
+	const float* Weights = FVARIDReference::GetBlurWeights(InKernelWidth);
+	const int32 Radius = InKernelWidth / 2;
+
+	FVector4 Colour = InSamples[4] * Weights[Radius];
+	for (int32 Offset = 1; Offset <= Radius; ++Offset)
+	{
+		Colour += (InSamples[4 - Offset] + InSamples[4 + Offset]) * Weights[Radius + Offset];
+	}
+
+	return Colour;
+}
+
+void FVARIDReference::GaussianBlur(const FVARIDImage& InImage, const FIntRect& InDispatchRect, const FIntRect& InClampRect, int32 InKernelWidth, bool bInHalfPrecisionCache, FVARIDImage& OutImage)
+{
+	const int32 GroupSize = 8;
+	const int32 Border = 4;
+	const int32 CacheSize = GroupSize + Border * 2;
+	const FIntPoint GroupCount = FIntPoint::DivideAndRoundUp(InDispatchRect.Size(), GroupSize);
+
+	TArray<FVector4> Cache;
+	TArray<FVector4> Horizontal;
+	Cache.SetNumZeroed(CacheSize * CacheSize);
+	Horizontal.SetNumZeroed(CacheSize * GroupSize);
+
+	// one iteration of this loop == one thread group
+	for (int32 GroupY = 0; GroupY < GroupCount.Y; ++GroupY)
+	{
+		for (int32 GroupX = 0; GroupX < GroupCount.X; ++GroupX)
+		{
+			const FIntPoint GroupOrigin = InDispatchRect.Min + FIntPoint(GroupX, GroupY) * GroupSize;
+
+			// 16x16 source pixels, clamped to the viewport so the other eye and the outside of the texture are never read
+			for (int32 Index = 0; Index < CacheSize * CacheSize; ++Index)
+			{
+				const FIntPoint Source = ClampToRect(FIntPoint(GroupOrigin.X - Border + Index % CacheSize, GroupOrigin.Y - Border + Index / CacheSize), InClampRect);
+				const FVector4 Pixel = InImage.Load(Source.X, Source.Y);
+				Cache[Index] = bInHalfPrecisionCache ? FVector4(QuantiseFP16(Pixel.X), QuantiseFP16(Pixel.Y), QuantiseFP16(Pixel.Z), 0.0f) : FVector4(Pixel.X, Pixel.Y, Pixel.Z, 0.0f);
+			}
+
+			// horizontal - every cached row, the 8 centre columns
+			for (int32 Index = 0; Index < CacheSize * GroupSize; ++Index)
+			{
+				const int32 Row = Index / GroupSize;
+				const int32 Column = Index % GroupSize;
+
+				FVector4 Samples[9];
+				for (int32 Sample = 0; Sample < 9; ++Sample)
+				{
+					Samples[Sample] = Cache[Row * CacheSize + Column + Sample];
+				}
+				Horizontal[Index] = BlurSamples(Samples, InKernelWidth);
+			}
+
+			// vertical. partial groups write outside the dispatch rect too, the same as the shader
+			for (int32 Index = 0; Index < GroupSize * GroupSize; ++Index)
+			{
+				const int32 Row = Index / GroupSize;
+				const int32 Column = Index % GroupSize;
+
+				FVector4 Samples[9];
+				for (int32 Sample = 0; Sample < 9; ++Sample)
+				{
+					Samples[Sample] = Horizontal[(Row + Sample) * GroupSize + Column];
+				}
+				OutImage.Store(GroupOrigin.X + Column, GroupOrigin.Y + Row, RGBOnly(BlurSamples(Samples, InKernelWidth)));
+			}
+		}
+	}
+}
+
+bool FVARIDReference::ValidateGaussianBlurKernels(FString& OutReport)
+{
+	const int32 KernelWidths[3] = { 5, 7, 9 };
+	const FIntPoint Size(61, 47);	// partial groups on both axes
+	const FIntRect Rect(FIntPoint(0, 0), Size);
+	const float HalfPrecisionTolerance = 1.0f / 4096.0f;	// half a f16 step just below 1.0. the weights sum to one
+
+	FRandomStream RandomStream(1213);
+	FVARIDImage Image(Size);
+	for (FVector4& Pixel : Image.Pixels)
+	{
+		Pixel = FVector4(RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand(), 1.0f);
+	}
+
+	FString Summary;
+
+	for (const int32 KernelWidth : KernelWidths)
+	{
+		const float* Weights = GetBlurWeights(KernelWidth);
+		const int32 Radius = KernelWidth / 2;
+
+		// binomial row - the same as the shader tables
+		float Binomial = 1.0f;
+		for (int32 Tap = 0; Tap < KernelWidth; ++Tap)
+		{
+			if (Weights[Tap] != Binomial / (float)(1 << (KernelWidth - 1)))
+			{
+				OutReport = FString::Printf(TEXT("VARID: Gaussian blur kernels FAILED. Blur%d tap %d is not a binomial weight"), KernelWidth, Tap);
+				return false;
+			}
+			Binomial = Binomial * (float)(KernelWidth - 1 - Tap) / (float)(Tap + 1);
+		}
+
+		// impulse response == outer product of the weights, for both cache precisions. every value involved is exact
+		const FIntPoint Centre(Size.X / 2, Size.Y / 2);
+		FVARIDImage Impulse(Size);
+		Impulse.Store(Centre.X, Centre.Y, FVector4(1.0f, 1.0f, 1.0f, 1.0f));
+
+		for (int32 HalfPrecision = 0; HalfPrecision < 2; ++HalfPrecision)
+		{
+			FVARIDImage Response(Size);
+			GaussianBlur(Impulse, Rect, Rect, KernelWidth, HalfPrecision != 0, Response);
+
+			for (int32 Y = 0; Y < Size.Y; ++Y)
+			{
+				for (int32 X = 0; X < Size.X; ++X)
+				{
+					const FIntPoint Offset = FIntPoint(X, Y) - Centre;
+					const bool bInsideKernel = FMath::Abs(Offset.X) <= Radius && FMath::Abs(Offset.Y) <= Radius;
+					const float Expected = bInsideKernel ? Weights[Radius + Offset.X] * Weights[Radius + Offset.Y] : 0.0f;
+
+					if (Response.Load(X, Y).X != Expected)
+					{
+						OutReport = FString::Printf(TEXT("VARID: Gaussian blur kernels FAILED. Blur%d impulse response at offset (%d, %d) is %g, expected %g. Half precision cache: %d"), KernelWidth, Offset.X, Offset.Y, Response.Load(X, Y).X, Expected, HalfPrecision);
+						return false;
+					}
+				}
+			}
+		}
+
+		// random image - full precision cache vs a plain separable convolution with the edge texels repeated, half vs full precision cache
+		FVARIDImage FullPrecision(Size);
+		FVARIDImage HalfPrecision(Size);
+		GaussianBlur(Image, Rect, Rect, KernelWidth, false, FullPrecision);
+		GaussianBlur(Image, Rect, Rect, KernelWidth, true, HalfPrecision);
+
+		float MaxFullPrecisionError = 0.0f;
+		float MaxHalfPrecisionError = 0.0f;
+
+		for (int32 Y = 0; Y < Size.Y; ++Y)
+		{
+			for (int32 X = 0; X < Size.X; ++X)
+			{
+				for (int32 Channel = 0; Channel < 3; ++Channel)
+				{
+					double Expected = 0.0;
+					for (int32 TapY = 0; TapY < KernelWidth; ++TapY)
+					{
+						for (int32 TapX = 0; TapX < KernelWidth; ++TapX)
+						{
+							const FIntPoint Source = ClampToRect(FIntPoint(X - Radius + TapX, Y - Radius + TapY), Rect);
+							Expected += (double)Weights[TapX] * (double)Weights[TapY] * (double)Image.Load(Source.X, Source.Y)[Channel];
+						}
+					}
+
+					MaxFullPrecisionError = FMath::Max(MaxFullPrecisionError, (float)FMath::Abs((double)FullPrecision.Load(X, Y)[Channel] - Expected));
+					MaxHalfPrecisionError = FMath::Max(MaxHalfPrecisionError, (float)FMath::Abs((double)HalfPrecision.Load(X, Y)[Channel] - Expected));
+				}
+			}
+		}
+
+		if (MaxFullPrecisionError > 1.0e-6f || MaxHalfPrecisionError > HalfPrecisionTolerance)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Gaussian blur kernels FAILED. Blur%d max error %g with the full precision cache, %g with the half precision cache"), KernelWidth, MaxFullPrecisionError, MaxHalfPrecisionError);
+			return false;
+		}
+
+		// the laplacian and reconstruct chains expand with the same kernel, so with no loss level 0 comes back up to the 16 bit laplacian quantisation
+		const FIntRect ViewportRect(0, 0, Size.X / 2, Size.Y);
+		const int32 NumMips = 5;
+		const float ReconstructTolerance = (float)NumMips / 65535.0f;
+
+		TArray<FVARIDImage> GaussianMips;
+		TArray<FVARIDImage> VFMapMips;
+		TArray<FVARIDImage> ContrastMips;
+		GaussianPyramidMultiPass(Image, ViewportRect, NumMips, GaussianMips, KernelWidth);
+		AllocateMips(Size, NumMips, VFMapMips);
+		ContrastReconstructMultiPass(GaussianMips, VFMapMips, ViewportRect, ContrastMips, KernelWidth);
+
+		float MaxReconstructError = 0.0f;
+
+		for (int32 Y = ViewportRect.Min.Y; Y < ViewportRect.Max.Y; ++Y)
+		{
+			for (int32 X = ViewportRect.Min.X; X < ViewportRect.Max.X; ++X)
+			{
+				const FVector4 Difference = ContrastMips[0].Load(X, Y) - Image.Load(X, Y);
+				MaxReconstructError = FMath::Max(MaxReconstructError, FMath::Max(FMath::Abs(Difference.X), FMath::Max(FMath::Abs(Difference.Y), FMath::Abs(Difference.Z))));
+			}
+		}
+
+		if (MaxReconstructError > ReconstructTolerance)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Gaussian blur kernels FAILED. Blur%d contrast chain does not reconstruct level 0 with no loss. Error=%f (tolerance %f)"), KernelWidth, MaxReconstructError, ReconstructTolerance);
+			return false;
+		}
+
+		Summary += FString::Printf(TEXT(" Blur%d: f16 cache error %f, reconstruct error %f."), KernelWidth, MaxHalfPrecisionError, MaxReconstructError);
+	}
+
+	OutReport = FString(TEXT("VARID: Gaussian blur kernels OK. Impulse responses exact for both cache precisions.")) + Summary;
+	return true;
+}
+
+#endif
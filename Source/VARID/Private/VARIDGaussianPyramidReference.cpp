@@ -0,0 +1,384 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "VARIDPyramidLayout.h"
+#include "Math/RandomStream.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// the multi pass pyramid and VARIDGaussianPyramidCS.usf, which builds every level in one dispatch with tile counters deciding which group
+// carries on. Groups finish in any order on a GPU, so the single pass version here runs them scrambled to catch a level read before it is written
+
+static const float PYRAMID_WEIGHTS[6] = { 1.0f / 32.0f, 5.0f / 32.0f, 10.0f / 32.0f, 10.0f / 32.0f, 5.0f / 32.0f, 1.0f / 32.0f };	// Blur5 followed by a 2x2 average. must match VARIDGaussianPyramidCS.usf
+
+/** 6x6 pyramid kernel at InPosition * 2 - 2. InLoad returns the (already clamped) texel of the previous level */
+template<typename LoadFunctionType>
+static FVector4 PyramidKernel(const FIntPoint& InPosition, LoadFunctionType InLoad)
+{
+	FVector4 Colour(0.0f, 0.0f, 0.0f, 0.0f);
+
+	for (int32 Y = 0; Y < 6; ++Y)
+	{
+		FVector4 Row(0.0f, 0.0f, 0.0f, 0.0f);
+
+		for (int32 X = 0; X < 6; ++X)
+		{
+			Row += InLoad(InPosition.X * 2 - 2 + X, InPosition.Y * 2 - 2 + Y) * PYRAMID_WEIGHTS[X];
+		}
+
+		Colour += Row * PYRAMID_WEIGHTS[Y];
+	}
+
+	return FVARIDReference::RGBOnly(Colour);
+}
+
+void FVARIDReference::GaussianPyramidMultiPass(const FVARIDImage& InImage, const FIntRect& InViewportRect, int32 InNumMips, TArray<FVARIDImage>& OutMips, int32 InKernelWidth)
+{
+	AllocateMips(InImage.Size, InNumMips, OutMips);
+
+	// copy
+	for (int32 Y = InViewportRect.Min.Y; Y < InViewportRect.Max.Y; ++Y)
+	{
+		for (int32 X = InViewportRect.Min.X; X < InViewportRect.Max.X; ++X)
+		{
+			OutMips[0].Store(X, Y, InImage.Load(X, Y));
+		}
+	}
+
+	for (int32 MipLevel = 1; MipLevel < InNumMips; ++MipLevel)
+	{
+		const FVARIDImage& HiRes = OutMips[MipLevel - 1];
+		const FIntRect HiResRect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, MipLevel - 1);
+		const FIntRect LoResRect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, MipLevel);
+
+		// blur. when the viewport starts on an odd texel the downsample footprint of the first lo res texel starts one texel before it, so the
+		// dispatch starts one texel early (its reads are still clamped to the viewport)
+		const FIntRect BlurRect(HiResRect.Min - FIntPoint(1, 1), HiResRect.Max);
+		FVARIDImage Blurred(HiRes.Size);
+		GaussianBlur(HiRes, BlurRect, HiResRect, InKernelWidth, false, Blurred);
+
+		// downsample - a bilinear sample at the lo res texel centre is the average of the 2x2 hi res texels under it
+		for (int32 Y = LoResRect.Min.Y; Y < LoResRect.Max.Y; ++Y)
+		{
+			for (int32 X = LoResRect.Min.X; X < LoResRect.Max.X; ++X)
+			{
+				FVector4 Colour(0.0f, 0.0f, 0.0f, 0.0f);
+				for (int32 Tap = 0; Tap < 4; ++Tap)
+				{
+					Colour += Blurred.Load(X * 2 + (Tap & 1), Y * 2 + (Tap >> 1)) * 0.25f;
+				}
+				OutMips[MipLevel].Store(X, Y, RGBOnly(Colour));
+			}
+		}
+	}
+}
+
+static FIntPoint GetGaussianPyramidTileOutputOrigin(const FIntRect& InViewportRect, int32 InStage, const FIntPoint& InTile)
+{
+	return FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, InStage * 2 + 2).Min + InTile * 8;
+}
+
+/** the first and last tile of stage InStage - 1 whose output the input of InTile reads, per axis. Inclusive. Must match VARIDGaussianPyramidCS.usf */
+static void GetGaussianPyramidTileContributors(const FIntRect& InViewportRect, int32 InStage, const FIntPoint& InTile, FIntPoint& OutFirst, FIntPoint& OutLast)
+{
+	const int32 TileSize = 32;
+	const int32 InputHalo = 6;
+	const FIntRect InputRect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, InStage * 2);
+	const FIntPoint InputOrigin = GetGaussianPyramidTileOutputOrigin(InViewportRect, InStage, InTile) * 4;
+	const FIntPoint FootprintMin(FMath::Max(InputOrigin.X - InputHalo, InputRect.Min.X), FMath::Max(InputOrigin.Y - InputHalo, InputRect.Min.Y));
+	const FIntPoint FootprintMax(FMath::Min(InputOrigin.X + TileSize + InputHalo, InputRect.Max.X) - 1, FMath::Min(InputOrigin.Y + TileSize + InputHalo, InputRect.Max.Y) - 1);
+
+	OutFirst = (FootprintMin - InputRect.Min) / 8;
+	OutLast = (FootprintMax - InputRect.Min) / 8;
+}
+
+void FVARIDReference::GaussianPyramidSinglePass(const FVARIDImage& InImage, const FIntRect& InViewportRect, int32 InNumMips, TArray<FVARIDImage>& OutMips, int32* OutNumCarriedOn, int32* OutTailLevel)
+{
+	const int32 TileSize = 32;
+	const int32 OutputTileSize = 8;
+	const int32 MiddleHalo = 2;
+	const int32 InputHalo = 6;
+	const int32 MiddleCacheSize = OutputTileSize * 2 + MiddleHalo * 2;
+	const int32 InputCacheSize = TileSize + InputHalo * 2;
+	const int32 MaxPendingTiles = 32;
+
+	AllocateMips(InImage.Size, InNumMips, OutMips);
+
+	const int32 NumStages = FVARIDPyramidLayout::GetGaussianPyramidNumStages(InNumMips);
+
+	TArray<int32> CounterOffsets;
+	CounterOffsets.SetNumZeroed(NumStages);
+	for (int32 Stage = 2; Stage < NumStages; ++Stage)
+	{
+		const FIntPoint NumTiles = FVARIDPyramidLayout::GetGaussianPyramidTileCount(InViewportRect, Stage - 1);
+		CounterOffsets[Stage] = CounterOffsets[Stage - 1] + NumTiles.X * NumTiles.Y;
+	}
+
+	TArray<uint32> TileCounters;
+	TileCounters.SetNumZeroed(FVARIDPyramidLayout::GetGaussianPyramidNumTileCounters(InViewportRect, InNumMips));
+
+	// groupshared memory. The emulation runs one group at a time, so one set is enough
+	TArray<FVector4> InputCache;
+	TArray<FVector4> MiddleCache;
+	TArray<FVector4> OutputTile;
+	InputCache.SetNumZeroed(InputCacheSize * InputCacheSize);
+	MiddleCache.SetNumZeroed(MiddleCacheSize * MiddleCacheSize);
+	OutputTile.SetNumZeroed(OutputTileSize * OutputTileSize);
+
+	int32 NumCarriedOn = 0;
+	int32 TailLevel = -1;
+
+	auto ReduceTile = [&](int32 Stage, const FIntPoint& Tile, bool bFromOutputTile)
+	{
+		const int32 InputLevel = Stage * 2;
+		const FIntRect InputRect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, InputLevel);
+		const FIntRect MiddleRect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, InputLevel + 1);
+		const FIntRect OutputRect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, InputLevel + 2);
+		const FIntPoint OutputOrigin = GetGaussianPyramidTileOutputOrigin(InViewportRect, Stage, Tile);
+		const FIntPoint MiddleOrigin = OutputOrigin * 2;
+		const FIntPoint InputOrigin = OutputOrigin * 4;
+
+		// input
+		for (int32 Index = 0; Index < InputCacheSize * InputCacheSize; ++Index)
+		{
+			const FIntPoint CacheCoord(Index % InputCacheSize, Index / InputCacheSize);
+			const FIntPoint Position = InputOrigin - FIntPoint(InputHalo, InputHalo) + CacheCoord;
+			const FIntPoint Clamped = ClampToRect(Position, InputRect);
+
+			if (Stage == 0)
+			{
+				InputCache[Index] = InImage.Load(Clamped.X, Clamped.Y);
+
+				const bool bInsideTile = CacheCoord.X >= InputHalo && CacheCoord.Y >= InputHalo && CacheCoord.X < InputCacheSize - InputHalo && CacheCoord.Y < InputCacheSize - InputHalo;
+				if (bInsideTile && InputRect.Contains(Position))
+				{
+					OutMips[0].Store(Position.X, Position.Y, InImage.Load(Position.X, Position.Y));
+				}
+			}
+			else if (bFromOutputTile)
+			{
+				const FIntPoint TileCoord = Clamped - InputRect.Min;
+				InputCache[Index] = OutputTile[TileCoord.Y * OutputTileSize + TileCoord.X];
+			}
+			else
+			{
+				InputCache[Index] = OutMips[InputLevel].Load(Clamped.X, Clamped.Y);
+			}
+		}
+
+		// middle
+		if (InputLevel + 1 < InNumMips)
+		{
+			for (int32 Index = 0; Index < MiddleCacheSize * MiddleCacheSize; ++Index)
+			{
+				const FIntPoint CacheCoord(Index % MiddleCacheSize, Index / MiddleCacheSize);
+				const FIntPoint Position = MiddleOrigin - FIntPoint(MiddleHalo, MiddleHalo) + CacheCoord;
+				const FIntPoint ClampedCacheCoord = ClampToRect(Position, MiddleRect) - (MiddleOrigin - FIntPoint(MiddleHalo, MiddleHalo));
+
+				// kernel reads 2 * Position - 2, which is 2 * CacheCoord relative to the input cache origin. undo the -2 PyramidKernel applies
+				const FVector4 Colour = PyramidKernel(ClampedCacheCoord + FIntPoint(1, 1), [&](int32 X, int32 Y) { return InputCache[Y * InputCacheSize + X]; });
+				MiddleCache[Index] = Colour;
+
+				const bool bInsideTile = CacheCoord.X >= MiddleHalo && CacheCoord.Y >= MiddleHalo && CacheCoord.X < MiddleCacheSize - MiddleHalo && CacheCoord.Y < MiddleCacheSize - MiddleHalo;
+				if (bInsideTile && MiddleRect.Contains(Position))
+				{
+					OutMips[InputLevel + 1].Store(Position.X, Position.Y, Colour);
+				}
+			}
+		}
+
+		// output
+		if (InputLevel + 2 < InNumMips)
+		{
+			for (int32 Index = 0; Index < OutputTileSize * OutputTileSize; ++Index)
+			{
+				const FIntPoint TileCoord(Index % OutputTileSize, Index / OutputTileSize);
+				const FIntPoint Position = OutputOrigin + TileCoord;
+				const FVector4 Colour = PyramidKernel(TileCoord + FIntPoint(1, 1), [&](int32 X, int32 Y) { return MiddleCache[Y * MiddleCacheSize + X]; });
+				OutputTile[Index] = Colour;
+
+				if (OutputRect.Contains(Position))
+				{
+					OutMips[InputLevel + 2].Store(Position.X, Position.Y, Colour);
+				}
+			}
+		}
+	};
+
+	// groups run in no particular order on the GPU. Scramble it, so a counter that is off shows up as a tile read before it was written
+	const FIntPoint GroupCount = FVARIDPyramidLayout::GetGaussianPyramidTileCount(InViewportRect, 0);
+	TArray<FIntPoint> Groups;
+	for (int32 GroupY = 0; GroupY < GroupCount.Y; ++GroupY)
+	{
+		for (int32 GroupX = 0; GroupX < GroupCount.X; ++GroupX)
+		{
+			Groups.Add(FIntPoint(GroupX, GroupY));
+		}
+	}
+
+	FRandomStream RandomStream(InViewportRect.Min.X * 31 + InViewportRect.Min.Y + InNumMips);
+	for (int32 Index = Groups.Num() - 1; Index > 0; --Index)
+	{
+		Groups.Swap(Index, RandomStream.RandRange(0, Index));
+	}
+
+	// one iteration of this loop == one thread group
+	for (const FIntPoint& Group : Groups)
+	{
+		TArray<uint32> PendingTiles;
+		int32 Stage = 0;
+		FIntPoint Tile = Group;
+		bool bFromOutputTile = false;
+
+		while (true)
+		{
+			ReduceTile(Stage, Tile, bFromOutputTile);
+
+			const int32 NextStage = Stage + 1;
+			if (NextStage < NumStages)
+			{
+				if (FVARIDPyramidLayout::GetGaussianPyramidTileCount(InViewportRect, Stage) == FIntPoint(1, 1))
+				{
+					TailLevel = TailLevel < 0 ? NextStage * 2 : TailLevel;
+					Stage = NextStage;
+					Tile = FIntPoint::ZeroValue;
+					bFromOutputTile = true;
+					continue;
+				}
+
+				const FIntPoint NumTiles = FVARIDPyramidLayout::GetGaussianPyramidTileCount(InViewportRect, NextStage);
+				const FIntPoint OutputOrigin = GetGaussianPyramidTileOutputOrigin(InViewportRect, Stage, Tile);
+				const FIntPoint NearestTile = (OutputOrigin - FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, NextStage * 2 + 2).Min * 4) / TileSize;
+
+				// threads 0-8
+				for (int32 Candidate = 0; Candidate < 9; ++Candidate)
+				{
+					const FIntPoint NextTile = NearestTile + FIntPoint(Candidate % 3, Candidate / 3) - FIntPoint(1, 1);
+
+					FIntPoint First;
+					FIntPoint Last;
+					GetGaussianPyramidTileContributors(InViewportRect, NextStage, NextTile, First, Last);
+
+					const bool bInside = NextTile.X >= 0 && NextTile.Y >= 0 && NextTile.X < NumTiles.X && NextTile.Y < NumTiles.Y;
+					const bool bContributes = Tile.X >= First.X && Tile.Y >= First.Y && Tile.X <= Last.X && Tile.Y <= Last.Y;
+					if (bInside && bContributes)
+					{
+						const FIntPoint NumContributors = Last - First + FIntPoint(1, 1);
+						const uint32 PreviousCount = TileCounters[CounterOffsets[NextStage] + NextTile.Y * NumTiles.X + NextTile.X]++;
+
+						if (PreviousCount == (uint32)(NumContributors.X * NumContributors.Y) - 1)
+						{
+							check(PendingTiles.Num() < MaxPendingTiles);
+							PendingTiles.Add(((uint32)NextStage << 28) | ((uint32)NextTile.Y << 14) | (uint32)NextTile.X);
+							++NumCarriedOn;
+						}
+					}
+				}
+			}
+
+			if (PendingTiles.Num() == 0)
+			{
+				break;
+			}
+
+			const uint32 Entry = PendingTiles.Pop();
+			Stage = Entry >> 28;
+			Tile = FIntPoint(Entry & 0x3FFF, (Entry >> 14) & 0x3FFF);
+			bFromOutputTile = false;
+		}
+	}
+
+	if (OutNumCarriedOn)
+	{
+		*OutNumCarriedOn = NumCarriedOn;
+	}
+
+	if (OutTailLevel)
+	{
+		*OutTailLevel = TailLevel;
+	}
+}
+
+bool FVARIDReference::ValidateGaussianPyramid(FString& OutReport)
+{
+	const float Tolerance = 1.0e-5f;	// summation order differs
+
+	// odd sizes and an odd right eye offset exercise the clamping, the partial groups and the tile alignment. Big enough for every stage to
+	// have more than one tile but the last
+	const FIntPoint Size(1203, 677);
+	const FIntRect ViewportRects[2] = { FIntRect(0, 0, Size.X / 2, Size.Y), FIntRect(Size.X / 2, 0, Size.X, Size.Y) };
+	const int32 NumMips = 10;
+
+	FRandomStream RandomStream(5678);
+	FVARIDImage Image(Size);
+	for (int32 Y = 0; Y < Size.Y; ++Y)
+	{
+		for (int32 X = 0; X < Size.X; ++X)
+		{
+			Image.Store(X, Y, FVector4(RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand()));
+		}
+	}
+
+	int32 NumCarriedOn[2] = { 0, 0 };
+	int32 TailLevel[2] = { -1, -1 };
+	for (int32 EyeIndex = 0; EyeIndex < 2; ++EyeIndex)
+	{
+		const FIntRect& ViewportRect = ViewportRects[EyeIndex];
+		TArray<FVARIDImage> MultiPassMips;
+		TArray<FVARIDImage> SinglePassMips;
+		GaussianPyramidMultiPass(Image, ViewportRect, NumMips, MultiPassMips);
+		GaussianPyramidSinglePass(Image, ViewportRect, NumMips, SinglePassMips, &NumCarriedOn[EyeIndex], &TailLevel[EyeIndex]);
+
+		for (int32 MipLevel = 0; MipLevel < NumMips; ++MipLevel)
+		{
+			const FIntRect Rect = FVARIDPyramidLayout::GetMipViewportRect(ViewportRect, MipLevel);
+
+			for (int32 Y = 0; Y < MultiPassMips[MipLevel].Size.Y; ++Y)
+			{
+				for (int32 X = 0; X < MultiPassMips[MipLevel].Size.X; ++X)
+				{
+					const FVector4 A = MultiPassMips[MipLevel].Load(X, Y);
+					const FVector4 B = SinglePassMips[MipLevel].Load(X, Y);
+					const float Error = FMath::Max(FMath::Max(FMath::Abs(A.X - B.X), FMath::Abs(A.Y - B.Y)), FMath::Max(FMath::Abs(A.Z - B.Z), FMath::Abs(A.W - B.W)));
+
+					// anything outside the viewport must be left untouched (zero) by both
+					if (Error > Tolerance || (!Rect.Contains(FIntPoint(X, Y)) && B != FVector4(0.0f, 0.0f, 0.0f, 0.0f)))
+					{
+						OutReport = FString::Printf(TEXT("VARID: Gaussian pyramid FAILED. Mismatch at (%d, %d) in mip %d for viewport starting at (%d, %d). Error=%f"), X, Y, MipLevel, ViewportRect.Min.X, ViewportRect.Min.Y, Error);
+						return false;
+					}
+				}
+			}
+		}
+	}
+
+	// what the blur read before it was clamped to the viewport: across the seam, the other eye
+	float MaxSeamError = 0.0f;
+	{
+		const FIntRect& RightEyeRect = ViewportRects[1];
+		const FIntRect TextureRect(FIntPoint::ZeroValue, Size);
+		FVARIDImage Clamped(Size);
+		FVARIDImage ReadingAcross(Size);
+		GaussianBlur(Image, RightEyeRect, RightEyeRect, 5, false, Clamped);
+		GaussianBlur(Image, RightEyeRect, TextureRect, 5, false, ReadingAcross);
+
+		for (int32 Y = RightEyeRect.Min.Y; Y < RightEyeRect.Max.Y; ++Y)
+		{
+			const FVector4 Difference = Clamped.Load(RightEyeRect.Min.X, Y) - ReadingAcross.Load(RightEyeRect.Min.X, Y);
+			MaxSeamError = FMath::Max(MaxSeamError, FMath::Max(FMath::Abs(Difference.X), FMath::Max(FMath::Abs(Difference.Y), FMath::Abs(Difference.Z))));
+		}
+	}
+
+	const int32 MultiPassDispatches = 1 + 2 * (NumMips - 1);
+	const int32 SinglePassDispatches = 2;	// clear the tile counters + pyramid
+	const FIntPoint GroupCount = FVARIDPyramidLayout::GetGaussianPyramidTileCount(ViewportRects[1], 0);
+
+	OutReport = FString::Printf(TEXT("VARID: Gaussian pyramid OK. %d mips identical (tolerance %g), the multi pass through the GaussianBlurCS emulation. Reading across the eye seam instead would be up to %f off at level 0. Dispatches per eye: %d multi pass vs %d single pass. Right eye: %dx%d groups, %d tiles of later stages carried on by the group finishing their inputs, levels %d and up from groupshared memory"),
+		NumMips, Tolerance, MaxSeamError, MultiPassDispatches, SinglePassDispatches, GroupCount.X, GroupCount.Y, NumCarriedOn[1], TailLevel[1]);
+	return true;
+}
+
+#endif
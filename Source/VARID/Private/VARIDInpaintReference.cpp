@@ -0,0 +1,276 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "Math/RandomStream.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// VARIDInpainterFillCS.usf and VARIDInpainterFillTiledCS.usf on the CPU. The tiled fill runs several passes out of a groupshared cache, so
+// it is only a drop-in for the single pass one if every pass reads and rounds exactly as a round trip through the colour textures would
+
+static const FIntPoint NEIGHBOUR_OFFSETS[8] =
+{
+	FIntPoint(0, -1),	// top
+	FIntPoint(1, -1),	// top right
+	FIntPoint(1, 0),	// right
+	FIntPoint(1, 1),	// bottom right
+	FIntPoint(0, 1),	// bottom
+	FIntPoint(-1, 1),	// bottom left
+	FIntPoint(-1, 0),	// left
+	FIntPoint(-1, -1)	// top left
+};
+
+/**
+ * the fill rule shared by both versions. Reads neighbours through the supplied functor so the tiled version can read from its cache.
+ * A filled colour is rounded to the R16G16B16A16_UNORM colour textures: by the texture write of a pass, and explicitly in the tiled version's cache
+ */
+template<typename LoadFunctionType>
+static void InpaintFillPixel(float InMaskValue, int32 InPassCounter, LoadFunctionType LoadNeighbour, FVector4& InOutColour, FVector4& InOutMetaData)
+{
+	if (InMaskValue > FVARIDReference::MaskThreshold && InOutMetaData.W == 1.0f)	// 1 == not yet filled
+	{
+		FVector4 AccumulatedColour(0.0f, 0.0f, 0.0f, 1.0f);
+		int32 NumColours = 0;
+
+		// in a clockwise order around the compass, check all neighbouring pixels
+		for (int32 i = 0; i < 8; ++i)
+		{
+			FVector4 NeighbourColour;
+			FVector4 NeighbourMetaData;
+			LoadNeighbour(NEIGHBOUR_OFFSETS[i], NeighbourColour, NeighbourMetaData);
+
+			if (NeighbourMetaData.W == 0.0f)
+			{
+				AccumulatedColour += NeighbourColour;
+				NumColours++;
+			}
+		}
+
+		if (NumColours > 0)
+		{
+			InOutMetaData = FVector4(InOutMetaData.X, InOutMetaData.Y, (float)(InPassCounter + 1), 0.0f);
+			const FVector4 Colour = AccumulatedColour / (float)NumColours;	// colour is average of neighbours
+			InOutColour = FVector4(FVARIDReference::QuantiseUNORM16(Colour.X), FVARIDReference::QuantiseUNORM16(Colour.Y), FVARIDReference::QuantiseUNORM16(Colour.Z), FVARIDReference::QuantiseUNORM16(Colour.W));
+		}
+	}
+}
+
+void FVARIDReference::InpaintFillPass(const FVARIDImage& InMask, const FVARIDImage& InColour, const FVARIDImage& InMetaData, FVARIDImage& OutColour, FVARIDImage& OutMetaData, const FIntRect& InActiveRect, int32 InPassCounter, const TArray<FIntPoint>* InTileList)
+{
+	TArray<FIntPoint> GroupOrigins;
+	GetDispatchGroupOrigins(InActiveRect, TileListGroupSize, InTileList, GroupOrigins);
+
+	for (const FIntPoint& GroupOrigin : GroupOrigins)
+	{
+		for (int32 Index = 0; Index < TileListGroupSize * TileListGroupSize; ++Index)
+		{
+			const int32 X = GroupOrigin.X + Index % TileListGroupSize;
+			const int32 Y = GroupOrigin.Y + Index / TileListGroupSize;
+
+			if (!InActiveRect.Contains(FIntPoint(X, Y)))
+			{
+				continue;
+			}
+
+			FVector4 MetaData = InMetaData.Load(X, Y);	//default is passthrough whether it be in mask, on the mask edge or neither
+			FVector4 Colour = InColour.Load(X, Y);
+
+			InpaintFillPixel(InMask.Load(X, Y).X, InPassCounter,
+				[&](const FIntPoint& Offset, FVector4& OutNeighbourColour, FVector4& OutNeighbourMetaData)
+				{
+					OutNeighbourColour = InColour.Load(X + Offset.X, Y + Offset.Y);
+					OutNeighbourMetaData = InMetaData.Load(X + Offset.X, Y + Offset.Y);
+				},
+				Colour, MetaData);
+
+			OutMetaData.Store(X, Y, MetaData);
+			OutColour.Store(X, Y, Colour);
+		}
+	}
+}
+
+void FVARIDReference::InpaintFillTiled(const FVARIDImage& InMask, const FVARIDImage& InColour, const FVARIDImage& InMetaData, FVARIDImage& OutColour, FVARIDImage& OutMetaData, const FIntRect& InActiveRect, int32 InPassCounter, int32 InIterations, int32 InTileSize, const TArray<FIntPoint>* InTileList)
+{
+	check(InIterations > 0);
+	check(InTileSize > 0);
+
+	const int32 CacheSize = InTileSize + 2 * InIterations;
+	const int32 CacheNumPixels = CacheSize * CacheSize;
+
+	TArray<FVector4> ColourCache[2];
+	TArray<FVector4> MetaDataCache[2];
+	TArray<float> MaskCache;
+
+	for (int32 i = 0; i < 2; ++i)
+	{
+		ColourCache[i].SetNumZeroed(CacheNumPixels);
+		MetaDataCache[i].SetNumZeroed(CacheNumPixels);
+	}
+	MaskCache.SetNumZeroed(CacheNumPixels);
+
+	TArray<FIntPoint> GroupOrigins;
+	GetDispatchGroupOrigins(InActiveRect, InTileSize, InTileList, GroupOrigins);
+
+	// one iteration of this loop == one thread group
+	for (const FIntPoint& GroupOrigin : GroupOrigins)
+	{
+		const FIntPoint CacheOrigin(GroupOrigin.X - InIterations, GroupOrigin.Y - InIterations);
+
+		// load tile + halo
+		for (int32 CacheIndex = 0; CacheIndex < CacheNumPixels; ++CacheIndex)
+		{
+			const int32 X = CacheOrigin.X + CacheIndex % CacheSize;
+			const int32 Y = CacheOrigin.Y + CacheIndex / CacheSize;
+			ColourCache[0][CacheIndex] = InColour.Load(X, Y);
+			MetaDataCache[0][CacheIndex] = InMetaData.Load(X, Y);
+			MaskCache[CacheIndex] = InMask.Load(X, Y).X;
+		}
+
+		for (int32 Iteration = 0; Iteration < InIterations; ++Iteration)
+		{
+			const int32 Src = Iteration & 1;
+			const int32 Dst = 1 - Src;
+			const int32 Border = Iteration + 1;
+
+			for (int32 CacheIndex = 0; CacheIndex < CacheNumPixels; ++CacheIndex)
+			{
+				const FIntPoint CacheCoord(CacheIndex % CacheSize, CacheIndex / CacheSize);
+				const FIntPoint ID = CacheOrigin + CacheCoord;
+
+				FVector4 MetaData = MetaDataCache[Src][CacheIndex];
+				FVector4 Colour = ColourCache[Src][CacheIndex];
+
+				const bool bInsideValidRegion = CacheCoord.X >= Border && CacheCoord.Y >= Border && CacheCoord.X < CacheSize - Border && CacheCoord.Y < CacheSize - Border;
+				const bool bInsideActiveRegion = InActiveRect.Contains(ID);
+
+				if (bInsideValidRegion && bInsideActiveRegion)
+				{
+					InpaintFillPixel(MaskCache[CacheIndex], InPassCounter + Iteration,
+						[&](const FIntPoint& Offset, FVector4& OutNeighbourColour, FVector4& OutNeighbourMetaData)
+						{
+							const int32 NeighbourIndex = (CacheCoord.Y + Offset.Y) * CacheSize + (CacheCoord.X + Offset.X);
+							OutNeighbourColour = ColourCache[Src][NeighbourIndex];
+							OutNeighbourMetaData = MetaDataCache[Src][NeighbourIndex];
+						},
+						Colour, MetaData);
+				}
+
+				MetaDataCache[Dst][CacheIndex] = MetaData;
+				ColourCache[Dst][CacheIndex] = Colour;
+			}
+		}
+
+		// write back the centre tile only
+		const int32 Result = InIterations & 1;
+		for (int32 TileY = 0; TileY < InTileSize; ++TileY)
+		{
+			for (int32 TileX = 0; TileX < InTileSize; ++TileX)
+			{
+				const int32 CacheIndex = (TileY + InIterations) * CacheSize + (TileX + InIterations);
+				OutMetaData.Store(GroupOrigin.X + TileX, GroupOrigin.Y + TileY, MetaDataCache[Result][CacheIndex]);
+				OutColour.Store(GroupOrigin.X + TileX, GroupOrigin.Y + TileY, ColourCache[Result][CacheIndex]);
+			}
+		}
+	}
+}
+
+void FVARIDReference::BuildSyntheticInpaintState(const FIntPoint& InSize, float InSpeckleProbability, FVARIDImage& OutMask, FVARIDImage& OutColour, FVARIDImage& OutMetaData)
+{
+	FRandomStream RandomStream(1234);
+
+	OutMask = FVARIDImage(InSize);
+	OutColour = FVARIDImage(InSize);
+	OutMetaData = FVARIDImage(InSize);
+
+	const FVector2D CentreA(InSize.X * 0.6f, InSize.Y * 0.5f);
+	const FVector2D CentreB(InSize.X * 0.85f, InSize.Y * 0.2f);
+
+	for (int32 Y = 0; Y < InSize.Y; ++Y)
+	{
+		for (int32 X = 0; X < InSize.X; ++X)
+		{
+			const FVector2D P(X + 0.5f, Y + 0.5f);
+			const bool bMasked = FVector2D::Distance(P, CentreA) < InSize.Y * 0.3f || FVector2D::Distance(P, CentreB) < InSize.Y * 0.15f || RandomStream.FRand() < InSpeckleProbability;
+
+			OutMask.Store(X, Y, FVector4(bMasked ? 1.0f : 0.0f, 0.0f, 0.0f, 0.0f));
+			OutColour.Store(X, Y, FVector4(QuantiseUNORM16(RandomStream.FRand()), QuantiseUNORM16(RandomStream.FRand()), QuantiseUNORM16(RandomStream.FRand()), 1.0f));
+
+			if (bMasked)
+			{
+				OutMetaData.Store(X, Y, FVector4(-1.0f, -1.0f, -1.0f, 1.0f));
+			}
+			else
+			{
+				OutMetaData.Store(X, Y, FVector4((X + 0.5f) / InSize.X, (Y + 0.5f) / InSize.Y, 0.0f, 0.0f));
+			}
+		}
+	}
+}
+
+bool FVARIDReference::ValidateInpaintFill(FString& OutReport)
+{
+	const int32 NumberOfPasses = 16;	// must match BuildInpaintTexture_RenderThread
+	const int32 Iterations = 4;		// must match INPAINT_FILL_ITERATIONS_PER_DISPATCH
+	const int32 TileSize = 8;
+
+	// odd sizes and an offset active rect (right eye) exercise the texture edges and the partial groups
+	const FIntPoint Size(93, 51);
+	const FIntRect ActiveRects[2] = { FIntRect(0, 0, Size.X, Size.Y), FIntRect(Size.X / 2, 0, Size.X, Size.Y) };
+
+	for (const FIntRect& ActiveRect : ActiveRects)
+	{
+		// the dispatch covers whole thread groups. those pixels get written too
+		const FIntPoint DispatchSize = ActiveRect.Size();
+		const FIntPoint GroupCount((DispatchSize.X + TileSize - 1) / TileSize, (DispatchSize.Y + TileSize - 1) / TileSize);
+		const FIntRect DispatchRect(ActiveRect.Min, ActiveRect.Min + GroupCount * TileSize);
+
+		FVARIDImage Mask;
+		FVARIDImage Colour[2];
+		FVARIDImage MetaData[2];
+		BuildSyntheticInpaintState(Size, 0.02f, Mask, Colour[0], MetaData[0]);
+
+		// NOTE: texture contents outside the dispatch are undefined on the GPU. equivalence only holds if both ping-pong textures agree there, so start them identical
+		Colour[1] = Colour[0];
+		MetaData[1] = MetaData[0];
+
+		FVARIDImage TiledColour[2] = { Colour[0], Colour[1] };
+		FVARIDImage TiledMetaData[2] = { MetaData[0], MetaData[1] };
+
+		int32 SinglePassResult = 0;
+		for (int32 PassCounter = 0; PassCounter < NumberOfPasses; ++PassCounter)
+		{
+			const int32 In = PassCounter % 2;
+			InpaintFillPass(Mask, Colour[In], MetaData[In], Colour[1 - In], MetaData[1 - In], DispatchRect, PassCounter);
+			SinglePassResult = 1 - In;
+		}
+
+		int32 TiledResult = 0;
+		for (int32 DispatchCounter = 0; DispatchCounter < NumberOfPasses / Iterations; ++DispatchCounter)
+		{
+			const int32 In = DispatchCounter % 2;
+			InpaintFillTiled(Mask, TiledColour[In], TiledMetaData[In], TiledColour[1 - In], TiledMetaData[1 - In], DispatchRect, DispatchCounter * Iterations, Iterations, TileSize);
+			TiledResult = 1 - In;
+		}
+
+		FIntPoint Mismatch;
+		if (!ImagesAreIdentical(Colour[SinglePassResult], TiledColour[TiledResult], Mismatch))
+		{
+			OutReport = FString::Printf(TEXT("VARID: Inpaint fill FAILED. Colour mismatch at (%d, %d) for active rect starting at (%d, %d)"), Mismatch.X, Mismatch.Y, ActiveRect.Min.X, ActiveRect.Min.Y);
+			return false;
+		}
+
+		if (!ImagesAreIdentical(MetaData[SinglePassResult], TiledMetaData[TiledResult], Mismatch))
+		{
+			OutReport = FString::Printf(TEXT("VARID: Inpaint fill FAILED. Meta data mismatch at (%d, %d) for active rect starting at (%d, %d)"), Mismatch.X, Mismatch.Y, ActiveRect.Min.X, ActiveRect.Min.Y);
+			return false;
+		}
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: Inpaint fill OK. %d single passes == %d tiled dispatches of %d iterations, filled colours rounded to UNORM16 after every one. Dispatches saved: %d"), NumberOfPasses, NumberOfPasses / Iterations, Iterations, NumberOfPasses - NumberOfPasses / Iterations);
+	return true;
+}
+
+#endif
@@ -5,6 +5,11 @@
 
 #include "VARIDModule.h"
 #include "VARIDProfile.h"
+#include "VARIDTraceRecorder.h"
+#include "VARIDFrameSource.h"
+#include "VARIDProfileHotReload.h"
+#include "VARIDPipelineWarmup.h"
+#include "VARIDOutputCapture.h"
 #include <json.hpp>
 #include "Interfaces/IPluginManager.h"
 #include "Misc/Paths.h"
@@ -14,13 +19,45 @@
 #include "EngineMinimal.h"
 #include "Runtime/Launch/Resources/Version.h"
 #include "HAL/FileManager.h"
+#include "Engine/TextureRenderTarget2D.h"
 #include "ImageUtils.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/CoreDelegates.h"
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/DateTime.h"
 
 using json = nlohmann::json;
 using nlohmann::json_pointer;
 
 #define LOCTEXT_NAMESPACE "FVARIDModule"
 
+/** how often a hot reloaded profile's file is checked for changes */
+static const float PROFILE_HOT_RELOAD_POLL_SECONDS = 0.1f;
+
+static TAutoConsoleVariable<int32> CVarVARIDVFMapKeepRawPoints(
+	TEXT("r.VARID.VFMap.KeepRawPoints"),
+	1,
+	TEXT("1: keep every VF map point as the profile gives it - position in degrees, value, min and max - for editing and export (default).\n")
+	TEXT("0: keep only the normalised positions and values the renderer reads, 20 bytes a point less. Blueprints then see the raw fields as 0.\n")
+	TEXT("   Applies to profiles loaded after it is set."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarVARIDPipelineWarmup(
+	TEXT("r.VARID.PipelineWarmup"),
+	1,
+	TEXT("0: create each shader and pipeline state the first time a pass needs it, which hitches the first frames after BeginRendering().\n")
+	TEXT("1: create them all on the render thread, a little each frame, from BeginRendering(). VARID renders once they are done (default).\n")
+	TEXT("2: as 1, but from engine start up, so that BeginRendering() usually takes effect at once."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarVARIDPipelineWarmupBudgetMs(
+	TEXT("r.VARID.PipelineWarmup.BudgetMs"),
+	2.0f,
+	TEXT("Render thread time the pipeline warm-up takes each frame, in milliseconds. At least one shader or pipeline state is created a frame."),
+	ECVF_Default);
+
 static bool CheckFOV(FVector2D FOV)
 {
 	if (FOV.IsZero() || FOV.X < 0.0f || FOV.Y < 0.0f)
@@ -44,6 +81,15 @@ void FVARIDModule::StartupModule()
 	FString PluginShaderDir = FPaths::Combine(IPluginManager::Get().FindPlugin(TEXT("VARID"))->GetBaseDir(), TEXT("Shaders"));
 	UE_LOG(LogTemp, Display, TEXT("VARID: PluginShaderDir: %s"), *PluginShaderDir);
 	AddShaderSourceDirectoryMapping(TEXT("/Plugin/VARID"), PluginShaderDir);
+
+	// the RHI and the global shader map don't exist yet
+	PostEngineInitHandle = FCoreDelegates::OnPostEngineInit.AddLambda([this]()
+	{
+		if (CVarVARIDPipelineWarmup.GetValueOnGameThread() == 2)
+		{
+			BeginPipelineWarmup();
+		}
+	});
 }
 
 void FVARIDModule::ShutdownModule()
@@ -56,13 +102,40 @@ void FVARIDModule::ShutdownModule()
 	// Cleanup the virtual source directory mapping.
 	ResetAllShaderSourceDirectoryMappings();
 
-	EndRendering();	// Module could be shutdown before we explicitly end rendering. Ensure cleanup.
+	FCoreDelegates::OnPostEngineInit.Remove(PostEngineInitHandle);
+	if (PipelineWarmupHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(PipelineWarmupHandle);
+		PipelineWarmupHandle.Reset();
+	}
+
+	EndAll();	// Module could be shutdown before we explicitly end rendering. Ensure cleanup.
+}
+
+void FVARIDModule::EndAll()
+{
+	EndRendering();
+	EndTraceReplay();
+	EndTraceRecording();
+	ClearFrameSource();
+	EndProfileHotReload();
+	EndOutputCapture();
 }
 
 void FVARIDModule::BeginRendering()
 {
 	if (!SceneViewExtension)
-		SceneViewExtension = FSceneViewExtensions::NewExtension<FVARIDSceneViewExtension>();
+	{
+		// the extension stays inactive until the warm-up is ready, rather than create everything on its first frame
+		TSharedPtr<const FVARIDPipelineWarmup, ESPMode::ThreadSafe> WaitForWarmup;
+		if (CVarVARIDPipelineWarmup.GetValueOnGameThread() != 0)
+		{
+			BeginPipelineWarmup();
+			WaitForWarmup = PipelineWarmup;
+		}
+
+		SceneViewExtension = FSceneViewExtensions::NewExtension<FVARIDSceneViewExtension>(WaitForWarmup);
+	}
 }
 
 void FVARIDModule::EndRendering()
@@ -74,6 +147,77 @@ void FVARIDModule::EndRendering()
 	}
 }
 
+bool FVARIDModule::IsRendering() const
+{
+	return SceneViewExtension.IsValid();
+}
+
+bool FVARIDModule::IsRenderingActive() const
+{
+	return SceneViewExtension.IsValid() && SceneViewExtension->IsActiveThisFrame(nullptr);
+}
+
+void FVARIDModule::BeginPipelineWarmup()
+{
+	// once a run. Shaders and pipeline states stay created
+	if (PipelineWarmup)
+	{
+		return;
+	}
+
+	TArray<FVARIDPipelineWarmupItem> Items;
+	FVARIDSceneViewExtension::GetPipelineWarmupItems(Items);
+
+	PipelineWarmup = MakeShared<FVARIDPipelineWarmup, ESPMode::ThreadSafe>();
+	PipelineWarmup->Start(MoveTemp(Items));
+
+	if (!PipelineWarmup->IsReady())
+	{
+		UE_LOG(LogTemp, Display, TEXT("VARID: Warming %d shaders and pipeline states"), PipelineWarmup->GetNumItems());
+		PipelineWarmupHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FVARIDModule::TickPipelineWarmup));
+	}
+}
+
+bool FVARIDModule::IsPipelineWarm() const
+{
+	return PipelineWarmup && PipelineWarmup->IsReady();
+}
+
+const TSharedPtr<FVARIDPipelineWarmup, ESPMode::ThreadSafe>& FVARIDModule::GetPipelineWarmup() const
+{
+	return PipelineWarmup;
+}
+
+bool FVARIDModule::TickPipelineWarmup(float InDeltaTime)
+{
+	if (PipelineWarmup->IsReady())
+	{
+		UE_LOG(LogTemp, Display, TEXT("VARID: Warmed %d shaders and pipeline states in %.1f ms on the render thread"), PipelineWarmup->GetNumItems(), PipelineWarmup->GetWarmSeconds() * 1000.0);
+
+		for (const FString& FailedName : PipelineWarmup->GetFailedNames())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("VARID: Could not warm %s. It will be created when it is first used"), *FailedName);
+		}
+
+		PipelineWarmupHandle.Reset();
+		return false;
+	}
+
+	if (PipelineWarmup->QueueStep())
+	{
+		TSharedPtr<FVARIDPipelineWarmup, ESPMode::ThreadSafe> Warmup = PipelineWarmup;
+		const double BudgetSeconds = FMath::Max(CVarVARIDPipelineWarmupBudgetMs.GetValueOnGameThread(), 0.0f) / 1000.0;
+
+		ENQUEUE_RENDER_COMMAND(VARIDPipelineWarmup)(
+			[Warmup, BudgetSeconds](FRHICommandListImmediate& RHICmdList)
+			{
+				Warmup->Step(BudgetSeconds);
+			});
+	}
+
+	return true;
+}
+
 void FVARIDModule::SetProfileRootPath(const FString ProfileRootPath)
 {
 	DefaultProfileRootPath = ProfileRootPath;
@@ -89,12 +233,380 @@ FVARIDProfile& FVARIDModule::GetActiveProfile()
 	return Profile;
 }
 
+/** reads the first channel of a 16 or 8 bit PNG, or a half float EXR. Called on the thread pool */
+static bool DecodeVFMapImage(IImageWrapperModule* InImageWrapperModule, const FString& InFilePath, FVARIDVFMapImagePixels& OutPixels)
+{
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *InFilePath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Could not read VF map image: %s"), *InFilePath);
+		return false;
+	}
+
+	const EImageFormat Format = InImageWrapperModule->DetectImageFormat(FileData.GetData(), FileData.Num());
+	if (Format != EImageFormat::PNG && Format != EImageFormat::EXR)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: VF map image must be a PNG or an EXR: %s"), *InFilePath);
+		return false;
+	}
+
+	TSharedPtr<IImageWrapper> ImageWrapper = InImageWrapperModule->CreateImageWrapper(Format);
+	if (!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(FileData.GetData(), FileData.Num()))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Could not decode VF map image: %s"), *InFilePath);
+		return false;
+	}
+
+	OutPixels.Size = FIntPoint(ImageWrapper->GetWidth(), ImageWrapper->GetHeight());
+	OutPixels.Values.SetNumUninitialized(OutPixels.Size.X * OutPixels.Size.Y);
+
+	TArray<uint8> RawData;
+
+	if (Format == EImageFormat::EXR)
+	{
+		// raw values, in the units of the map's min and max
+		if (!ImageWrapper->GetRaw(ERGBFormat::RGBA, 16, RawData) || RawData.Num() != OutPixels.Values.Num() * 4 * sizeof(FFloat16))
+		{
+			UE_LOG(LogTemp, Error, TEXT("VARID: Could not decode VF map image: %s"), *InFilePath);
+			return false;
+		}
+
+		const FFloat16* Texels = reinterpret_cast<const FFloat16*>(RawData.GetData());
+		for (int32 i = 0; i < OutPixels.Values.Num(); ++i)
+		{
+			OutPixels.Values[i] = Texels[i * 4];
+		}
+
+		OutPixels.bUnitRange = false;
+	}
+	else if (ImageWrapper->GetBitDepth() == 16)
+	{
+		if (!ImageWrapper->GetRaw(ERGBFormat::Gray, 16, RawData) || RawData.Num() != OutPixels.Values.Num() * sizeof(uint16))
+		{
+			UE_LOG(LogTemp, Error, TEXT("VARID: Could not decode VF map image: %s"), *InFilePath);
+			return false;
+		}
+
+		const uint16* Texels = reinterpret_cast<const uint16*>(RawData.GetData());
+		for (int32 i = 0; i < OutPixels.Values.Num(); ++i)
+		{
+			OutPixels.Values[i] = Texels[i] / 65535.0f;
+		}
+
+		OutPixels.bUnitRange = true;
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("VARID: VF map image is not 16 bit, the map will only have 256 levels: %s"), *InFilePath);
+
+		if (!ImageWrapper->GetRaw(ERGBFormat::Gray, 8, RawData) || RawData.Num() != OutPixels.Values.Num())
+		{
+			UE_LOG(LogTemp, Error, TEXT("VARID: Could not decode VF map image: %s"), *InFilePath);
+			return false;
+		}
+
+		for (int32 i = 0; i < OutPixels.Values.Num(); ++i)
+		{
+			OutPixels.Values[i] = RawData[i] / 255.0f;
+		}
+
+		OutPixels.bUnitRange = true;
+	}
+
+	return true;
+}
+
+/** profiles made in a blueprint may still fill the deprecated FVARIDVFMap::Data rather than Points */
+static void MigrateDeprecatedVFMapData(FVARIDProfile& InOutProfile)
+{
+	for (FVARIDVFMap* VFMap : InOutProfile.GetVFMaps())
+	{
+		VFMap->MigrateDeprecatedData();
+	}
+}
+
+/**
+ * image VF maps are decoded on the thread pool. Until one has loaded its eye renders as if the FX had no points.
+ * the image is shared with any other copy of the profile, so activating the same profile again doesn't load it again
+ */
+static void BeginLoadVFMapImages(FVARIDProfile& InOutProfile)
+{
+	IImageWrapperModule* ImageWrapperModule = nullptr;
+
+	for (FVARIDVFMap* VFMap : InOutProfile.GetVFMaps())
+	{
+		if (VFMap->Image.IsValid())
+		{
+			if (!ImageWrapperModule)
+			{
+				// modules can only be loaded on the game thread
+				ImageWrapperModule = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+			}
+
+			VFMap->Image->BeginLoad([ImageWrapperModule](const FString& InFilePath, FVARIDVFMapImagePixels& OutPixels) { return DecodeVFMapImage(ImageWrapperModule, InFilePath, OutPixels); });
+		}
+	}
+}
+
 void FVARIDModule::SetActiveProfile(const FVARIDProfile& InProfile)
 {
+	if (!CanChangeTracedState())
+	{
+		return;
+	}
+
 	if (InProfile.IsValid)
 	{
+		// the watched profile is no longer the one shown
+		if (ProfileHotReload && !bApplyingProfileHotReload)
+		{
+			EndProfileHotReload();
+		}
+
 		Profile = FVARIDProfile(InProfile);
+		MigrateDeprecatedVFMapData(Profile);
+		BeginLoadVFMapImages(Profile);
+		Progression.Reset();
+
+		if (TraceRecorder)
+		{
+			TraceRecorder->RecordActiveProfile(Profile);
+		}
+	}
+}
+
+void FVARIDModule::ToggleFX(int32 ID)
+{
+	if (!CanChangeTracedState())
+	{
+		return;
+	}
+
+	Profile.ToggleFX(ID);
+
+	if (TraceRecorder)
+	{
+		TraceRecorder->RecordFXEnabled(FVARIDTrace::GetFXEnabled(Profile));
+	}
+}
+
+void FVARIDModule::EnableAllFX()
+{
+	if (!CanChangeTracedState())
+	{
+		return;
+	}
+
+	Profile.EnableAllFX();
+
+	if (TraceRecorder)
+	{
+		TraceRecorder->RecordFXEnabled(FVARIDTrace::GetFXEnabled(Profile));
+	}
+}
+
+void FVARIDModule::DisableAllFX()
+{
+	if (!CanChangeTracedState())
+	{
+		return;
+	}
+
+	Profile.DisableAllFX();
+
+	if (TraceRecorder)
+	{
+		TraceRecorder->RecordFXEnabled(FVARIDTrace::GetFXEnabled(Profile));
+	}
+}
+
+bool FVARIDModule::SetProgression(const TArray<FVARIDProfile>& InKeyframes, const TArray<float>& InTimes)
+{
+	if (!CanChangeTracedState())
+	{
+		return false;
+	}
+
+	TArray<FVARIDProfile> Keyframes = InKeyframes;
+	for (FVARIDProfile& Keyframe : Keyframes)
+	{
+		MigrateDeprecatedVFMapData(Keyframe);
+	}
+
+	TSharedPtr<FVARIDProfileProgression, ESPMode::ThreadSafe> NewProgression = MakeShared<FVARIDProfileProgression, ESPMode::ThreadSafe>();
+	if (!FVARIDProfileProgression::Create(Keyframes, InTimes, *NewProgression))
+	{
+		return false;
+	}
+
+	// the profiles in between share the keyframes' images
+	for (FVARIDProfile& Keyframe : NewProgression->Keyframes)
+	{
+		BeginLoadVFMapImages(Keyframe);
+	}
+
+	if (!NewProgression->CanPackKeyframeTables())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("VARID: Progression has image or full field VF maps that can't be blended point by point. They switch half way between keyframes, and r.VARID.VFMap.Combined packs each step"));
+	}
+
+	// the watched profile is no longer the one shown
+	EndProfileHotReload();
+
+	Progression = NewProgression;
+	ProgressionTime = NewProgression->Times[0];
+	Profile = Progression->Evaluate(ProgressionTime);
+
+	if (TraceRecorder)
+	{
+		TraceRecorder->RecordActiveProfile(Profile);
+	}
+
+	return true;
+}
+
+void FVARIDModule::SetProgressionTime(float InTime)
+{
+	if (!CanChangeTracedState())
+	{
+		return;
+	}
+
+	if (!Progression.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("VARID: SetProgressionTime without a progression"));
+		return;
+	}
+
+	// no parsing - just the blend of the values of two keyframes. The GPU only needs the time
+	ProgressionTime = InTime;
+	Profile = Progression->Evaluate(InTime);
+
+	// a step is traced as the profile it gives, since replaying needs no progression
+	if (TraceRecorder)
+	{
+		TraceRecorder->RecordActiveProfile(Profile);
+	}
+}
+
+float FVARIDModule::GetProgressionTime() const
+{
+	return ProgressionTime;
+}
+
+void FVARIDModule::ClearProgression()
+{
+	Progression.Reset();
+}
+
+const TSharedPtr<const FVARIDProfileProgression, ESPMode::ThreadSafe>& FVARIDModule::GetProgression() const
+{
+	return Progression;
+}
+
+void FVARIDModule::SetViewProfile(int32 InViewIndex, const FVARIDProfile& InProfile)
+{
+	FVARIDProfile& ViewProfile = ViewProfiles.ByViewIndex.Add(InViewIndex, InProfile);
+	MigrateDeprecatedVFMapData(ViewProfile);
+	BeginLoadVFMapImages(ViewProfile);
+}
+
+void FVARIDModule::SetPlayerProfile(int32 InPlayerIndex, const FVARIDProfile& InProfile)
+{
+	FVARIDProfile& PlayerProfile = ViewProfiles.ByPlayerIndex.Add(InPlayerIndex, InProfile);
+	MigrateDeprecatedVFMapData(PlayerProfile);
+	BeginLoadVFMapImages(PlayerProfile);
+}
+
+void FVARIDModule::ClearViewProfiles()
+{
+	ViewProfiles.ByViewIndex.Empty();
+	ViewProfiles.ByPlayerIndex.Empty();
+}
+
+const FVARIDViewProfiles& FVARIDModule::GetViewProfiles() const
+{
+	return ViewProfiles;
+}
+
+bool FVARIDModule::RenderProfileBatch(UTexture* InSource, const TArray<FVARIDProfileBatchEntry>& InEntries, const TArray<UTextureRenderTarget2D*>& InOutputs)
+{
+	if (!InSource || !InSource->Resource || InEntries.Num() != InOutputs.Num())
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: RenderProfileBatch needs a source texture and one output per entry"));
+		return false;
+	}
+
+	TArray<FTextureRenderTargetResource*> Outputs;
+
+	for (UTextureRenderTarget2D* Output : InOutputs)
+	{
+		if (!Output || Output->SizeX != (int32)InSource->GetSurfaceWidth() || Output->SizeY != (int32)InSource->GetSurfaceHeight())
+		{
+			UE_LOG(LogTemp, Error, TEXT("VARID: RenderProfileBatch outputs must be the size of the source (%dx%d)"), (int32)InSource->GetSurfaceWidth(), (int32)InSource->GetSurfaceHeight());
+			return false;
+		}
+
+		Outputs.Add(Output->GameThread_GetRenderTargetResource());
+	}
+
+	// the render thread gets its own copy, the same as the active profile
+	TArray<FVARIDProfileBatchEntry> Entries = InEntries;
+	for (FVARIDProfileBatchEntry& Entry : Entries)
+	{
+		BeginLoadVFMapImages(Entry.Profile);
 	}
+
+	FTextureResource* SourceResource = InSource->Resource;
+
+	ENQUEUE_RENDER_COMMAND(VARIDRenderProfileBatch)(
+		[
+			SourceResource,
+			Entries,
+			Outputs
+		](FRHICommandListImmediate& RHICmdList)
+		{
+			TArray<FRHITexture*> OutputTextures;
+			for (FTextureRenderTargetResource* Output : Outputs)
+			{
+				OutputTextures.Add(Output->GetRenderTargetTexture());
+			}
+
+			FVARIDSceneViewExtension::RenderProfileBatch_RenderThread(RHICmdList, SourceResource->TextureRHI, Entries, OutputTextures);
+		}
+	);
+
+	return true;
+}
+
+bool FVARIDModule::SetFrameSource(const TSharedPtr<IVARIDFrameSource, ESPMode::ThreadSafe>& InSource)
+{
+	ClearFrameSource();
+
+	if (!InSource || !InSource->Start())
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Frame source did not start: %s"), InSource ? *InSource->GetDescription() : TEXT("none"));
+		return false;
+	}
+
+	FrameSource = InSource;
+	UE_LOG(LogTemp, Display, TEXT("VARID: Frame source set: %s"), *FrameSource->GetDescription());
+	return true;
+}
+
+void FVARIDModule::ClearFrameSource()
+{
+	if (FrameSource)
+	{
+		// the render thread may still hold the ring, but nothing more is written to it
+		FrameSource->Stop();
+		FrameSource.Reset();
+	}
+}
+
+const TSharedPtr<IVARIDFrameSource, ESPMode::ThreadSafe>& FVARIDModule::GetFrameSource() const
+{
+	return FrameSource;
 }
 
 bool FVARIDModule::ListProfiles(FString RootFolderFullPath, FString Ext, TArray<FString>& Files)
@@ -179,7 +691,72 @@ static bool CheckValue(float Value, float Min, float Max)
 	return true;
 }
 
-static bool ParseVFMap(json& jsonObject, FString JsonPath, const FVector2D& DisplayFOV, FVARIDVFMap& OutVFMap)
+/**
+ * "image": { "path": "relative/to/profile.png", "min": 0, "max": 1, "fov": [40, 30] }
+ * fov is the size of the field the image covers in degrees, centred on the origin. It is optional and defaults to the display FOV.
+ * The image isn't read here - that happens on the thread pool when the profile is activated
+ */
+static bool ParseVFMapImage(json& jsonObject, FString JsonPath, const FVector2D& DisplayFOV, const FString& ProfileDir, FVARIDVFMap& OutVFMap)
+{
+	std::string ImageJsonPathStdString = std::string(TCHAR_TO_UTF8(*JsonPath)) + "/image";
+
+	json::json_pointer pathJsonPtr(ImageJsonPathStdString + "/path");
+	json::json_pointer minJsonPtr(ImageJsonPathStdString + "/min");
+	json::json_pointer maxJsonPtr(ImageJsonPathStdString + "/max");
+	if (!jsonObject.contains(pathJsonPtr) || !jsonObject.contains(minJsonPtr) || !jsonObject.contains(maxJsonPtr))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: VF Map image @ %s must have the fields: 'path', 'min' and 'max'"), *JsonPath);
+		return false;
+	}
+
+	FString ImagePath = FString(jsonObject.at(pathJsonPtr).get<std::string>().c_str());
+	if (FPaths::IsRelative(ImagePath))
+	{
+		ImagePath = FPaths::Combine(ProfileDir, ImagePath);
+	}
+
+	if (!FPaths::FileExists(ImagePath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: VF Map image does not exist: %s"), *ImagePath);
+		return false;
+	}
+
+	float Min = jsonObject.at(minJsonPtr).get<float>();
+	float Max = jsonObject.at(maxJsonPtr).get<float>();
+
+	if (!CheckValue(Min, Min, Max))
+	{
+		return false;
+	}
+
+	FVector2D FOV = DisplayFOV;
+
+	json::json_pointer fovJsonPtr(ImageJsonPathStdString + "/fov");
+	if (jsonObject.contains(fovJsonPtr))
+	{
+		std::vector<float> RawFOV = jsonObject.at(fovJsonPtr).get<std::vector<float>>();
+		if (RawFOV.size() != 2 || !CheckFOV(FVector2D(RawFOV[0], RawFOV[1])))
+		{
+			UE_LOG(LogTemp, Error, TEXT("VARID: VF Map image @ %s has an invalid 'fov'. Expected [horizontal, vertical] in degrees"), *JsonPath);
+			return false;
+		}
+
+		FOV = FVector2D(RawFOV[0], RawFOV[1]);
+	}
+
+	// the same normalisation as the points: the origin is at 0.5 and the display FOV spans 0..1
+	const FVector2D NormHalfSize(FOV.X / DisplayFOV.X / 2.0f, FOV.Y / DisplayFOV.Y / 2.0f);
+
+	OutVFMap.FullField = false;
+	OutVFMap.ExpectedNumDataPoints = 0;
+	OutVFMap.Points.Empty();
+	OutVFMap.Image = MakeShared<FVARIDVFMapImage, ESPMode::ThreadSafe>(ImagePath, Min, Max, FVector2D(0.5f, 0.5f) - NormHalfSize, FVector2D(0.5f, 0.5f) + NormHalfSize);
+	OutVFMap.ResetDerivedData();
+
+	return true;
+}
+
+static bool ParseVFMap(json& jsonObject, FString JsonPath, const FVector2D& DisplayFOV, const FString& ProfileDir, FVARIDVFMap& OutVFMap)
 {
 	if (!CheckFOV(DisplayFOV))
 	{
@@ -195,6 +772,13 @@ static bool ParseVFMap(json& jsonObject, FString JsonPath, const FVector2D& Disp
 		return true;
 	}
 
+	// a dense map from an image file, instead of a list of points
+	json::json_pointer imageJsonPtr(JsonPathStdString + "/image");
+	if (jsonObject.contains(imageJsonPtr))
+	{
+		return ParseVFMapImage(jsonObject, JsonPath, DisplayFOV, ProfileDir, OutVFMap);
+	}
+
 	json::json_pointer dataJsonPtr(JsonPathStdString + "/data");
 	if (!jsonObject.contains(dataJsonPtr))
 	{
@@ -203,7 +787,9 @@ static bool ParseVFMap(json& jsonObject, FString JsonPath, const FVector2D& Disp
 	}
 
 	std::vector<float> InRawFloatArray = jsonObject.at(dataJsonPtr).get<std::vector<float>>();
-	OutVFMap.Data.Empty();	// ensure
+	OutVFMap.Points.Empty();	// ensure
+
+	TArray<FVARIDVFMapPoint> ParsedPoints;
 
 	if (InRawFloatArray.size() == 3)
 	{
@@ -237,7 +823,7 @@ static bool ParseVFMap(json& jsonObject, FString JsonPath, const FVector2D& Disp
 		}
 
 		FVARIDVFMapPoint MapPoint(0.0f, 0.0f, RawValue, Min, Max, 0.0f, 0.0f, NormValue);
-		OutVFMap.Data.Add(MapPoint);
+		ParsedPoints.Add(MapPoint);
 	}
 	else
 	{
@@ -302,10 +888,16 @@ static bool ParseVFMap(json& jsonObject, FString JsonPath, const FVector2D& Disp
 			}
 
 			FVARIDVFMapPoint MapPoint(RawX, RawY, RawValue, Min, Max, NormX, NormY, NormValue);
-			OutVFMap.Data.Add(MapPoint);
+			ParsedPoints.Add(MapPoint);
 		}
 	}
 
+	// the positions are shared with any map already loaded that has them, e.g. the other contrast levels
+	OutVFMap.Points.SetPoints(ParsedPoints, CVarVARIDVFMapKeepRawPoints.GetValueOnAnyThread() != 0);
+
+	// the mesh and the curvature bound wait until a map is first drawn with them, and are then kept for every copy of it
+	OutVFMap.ResetDerivedData();
+
 	return true;
 }
 
@@ -330,6 +922,9 @@ bool FVARIDModule::LoadProfile(const FString& ProfileFullPath, FVARIDProfile& Ou
 		return false;
 	}
 
+	// image VF maps are relative to the profile
+	const FString ProfileDir = FPaths::GetPath(ProfileFullPath);
+
 	/********************************************************************/
 	// load raw data
 
@@ -399,59 +994,153 @@ bool FVARIDModule::LoadProfile(const FString& ProfileFullPath, FVARIDProfile& Ou
 
 	// NOTE: contrast map index is reversed internally compared with profile format. highest freq = 0 aligns better with mip level indexes
 
+	OutProfile.LeftEye.Contrast.VFMaps.Empty();
+	OutProfile.RightEye.Contrast.VFMaps.Empty();
+
+	TArray<FVARIDProfileVFMapSlot> VFMapSlots;
+	FVARIDProfileHotReload::GetVFMapSlots(OutProfile, VFMapSlots);
+
+	for (const FVARIDProfileVFMapSlot& Slot : VFMapSlots)
 	{
-		FVARIDEye& Eye = OutProfile.LeftEye;
+		if (!ParseVFMap(JsonObject, Slot.JsonPath, FOV, ProfileDir, *Slot.VFMap)) return false;
+	}
 
-		if (!ParseVFMap(JsonObject, "/left_eye/blur", FOV, Eye.Blur.VFMap)) return false;
+	OutProfile.IsValid = true;
 
-		if (!ParseVFMap(JsonObject, "/left_eye/inpaint", FOV, Eye.Inpaint.VFMap)) return false;
+	UE_LOG(LogTemp, Display, TEXT("VARID: Profile is valid"));
 
-		Eye.Contrast.VFMaps.Empty();
-		Eye.Contrast.VFMaps.SetNum(10);
-		if (!ParseVFMap(JsonObject, "/left_eye/contrast/level_0_lowest_spatial_freq", FOV, Eye.Contrast.VFMaps[9])) return false;
-		if (!ParseVFMap(JsonObject, "/left_eye/contrast/level_1", FOV, Eye.Contrast.VFMaps[8])) return false;
-		if (!ParseVFMap(JsonObject, "/left_eye/contrast/level_2", FOV, Eye.Contrast.VFMaps[7])) return false;
-		if (!ParseVFMap(JsonObject, "/left_eye/contrast/level_3", FOV, Eye.Contrast.VFMaps[6])) return false;
-		if (!ParseVFMap(JsonObject, "/left_eye/contrast/level_4", FOV, Eye.Contrast.VFMaps[5])) return false;
-		if (!ParseVFMap(JsonObject, "/left_eye/contrast/level_5", FOV, Eye.Contrast.VFMaps[4])) return false;
-		if (!ParseVFMap(JsonObject, "/left_eye/contrast/level_6", FOV, Eye.Contrast.VFMaps[3])) return false;
-		if (!ParseVFMap(JsonObject, "/left_eye/contrast/level_7", FOV, Eye.Contrast.VFMaps[2])) return false;
-		if (!ParseVFMap(JsonObject, "/left_eye/contrast/level_8", FOV, Eye.Contrast.VFMaps[1])) return false;
-		if (!ParseVFMap(JsonObject, "/left_eye/contrast/level_9_highest_spatial_freq", FOV, Eye.Contrast.VFMaps[0])) return false;
+	return true;
+}
 
-		if (!ParseVFMap(JsonObject, "/left_eye/warp", FOV, Eye.Warp.VFMap)) return false;
+bool FVARIDModule::BeginProfileHotReload(const FString& InProfileFullPath, float InDebounceSeconds)
+{
+	EndProfileHotReload();
+
+	// SetActiveProfile() is ignored during a trace replay
+	if (IsTraceReplaying())
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Profiles can't be hot reloaded during a trace replay"));
+		return false;
 	}
 
+	FString JsonString;
+	TArray<uint32> Hashes;
+	FVARIDProfile LoadedProfile;
+
+	if (!FFileHelper::LoadFileToString(JsonString, *InProfileFullPath)
+		|| !FVARIDProfileHotReload::HashVFMaps(JsonString, GetDisplayFOV(), FPaths::GetPath(InProfileFullPath), Hashes)
+		|| !LoadProfile(InProfileFullPath, LoadedProfile))
 	{
-		FVARIDEye& Eye = OutProfile.RightEye;
+		UE_LOG(LogTemp, Error, TEXT("VARID: Could not load the profile to hot reload: %s"), *InProfileFullPath);
+		return false;
+	}
 
-		if (!ParseVFMap(JsonObject, "/right_eye/blur", FOV, Eye.Blur.VFMap)) return false;
+	SetActiveProfile(LoadedProfile);
 
-		if (!ParseVFMap(JsonObject, "/right_eye/inpaint", FOV, Eye.Inpaint.VFMap)) return false;
+	ProfileHotReload = MakeUnique<FVARIDProfileHotReload>(InProfileFullPath, FMath::Max(InDebounceSeconds, 0.0f), Hashes);
+	ProfileHotReloadHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FVARIDModule::TickProfileHotReload), PROFILE_HOT_RELOAD_POLL_SECONDS);
 
-		Eye.Contrast.VFMaps.Empty();
-		Eye.Contrast.VFMaps.SetNum(10);
-		if (!ParseVFMap(JsonObject, "/right_eye/contrast/level_0_lowest_spatial_freq", FOV, Eye.Contrast.VFMaps[9])) return false;
-		if (!ParseVFMap(JsonObject, "/right_eye/contrast/level_1", FOV, Eye.Contrast.VFMaps[8])) return false;
-		if (!ParseVFMap(JsonObject, "/right_eye/contrast/level_2", FOV, Eye.Contrast.VFMaps[7])) return false;
-		if (!ParseVFMap(JsonObject, "/right_eye/contrast/level_3", FOV, Eye.Contrast.VFMaps[6])) return false;
-		if (!ParseVFMap(JsonObject, "/right_eye/contrast/level_4", FOV, Eye.Contrast.VFMaps[5])) return false;
-		if (!ParseVFMap(JsonObject, "/right_eye/contrast/level_5", FOV, Eye.Contrast.VFMaps[4])) return false;
-		if (!ParseVFMap(JsonObject, "/right_eye/contrast/level_6", FOV, Eye.Contrast.VFMaps[3])) return false;
-		if (!ParseVFMap(JsonObject, "/right_eye/contrast/level_7", FOV, Eye.Contrast.VFMaps[2])) return false;
-		if (!ParseVFMap(JsonObject, "/right_eye/contrast/level_8", FOV, Eye.Contrast.VFMaps[1])) return false;
-		if (!ParseVFMap(JsonObject, "/right_eye/contrast/level_9_highest_spatial_freq", FOV, Eye.Contrast.VFMaps[0])) return false;
+	UE_LOG(LogTemp, Display, TEXT("VARID: Hot reloading %s"), *InProfileFullPath);
+	return true;
+}
 
-		if (!ParseVFMap(JsonObject, "/right_eye/warp", FOV, Eye.Warp.VFMap)) return false;
+void FVARIDModule::EndProfileHotReload()
+{
+	if (ProfileHotReload)
+	{
+		FTicker::GetCoreTicker().RemoveTicker(ProfileHotReloadHandle);
+		ProfileHotReloadHandle.Reset();
+
+		UE_LOG(LogTemp, Display, TEXT("VARID: Stopped hot reloading %s after %d reloads, which reparsed %d VF maps"),
+			*ProfileHotReload->GetProfileFullPath(), ProfileHotReload->NumReloads, ProfileHotReload->NumVFMapsReparsed);
+		ProfileHotReload.Reset();
 	}
+}
 
-	OutProfile.IsValid = true;
+bool FVARIDModule::IsProfileHotReloading() const
+{
+	return ProfileHotReload.IsValid();
+}
 
-	UE_LOG(LogTemp, Display, TEXT("VARID: Profile is valid"));
+int32 FVARIDModule::ReloadChangedVFMaps()
+{
+	if (!ProfileHotReload)
+	{
+		return INDEX_NONE;
+	}
+
+	const FString& ProfileFullPath = ProfileHotReload->GetProfileFullPath();
+	const FString ProfileDir = FPaths::GetPath(ProfileFullPath);
+	const FVector2D& FOV = GetDisplayFOV();
+
+	FString JsonString;
+	TArray<uint32> NewHashes;
+
+	// a file caught part way through a save fails here and is tried again when it next changes
+	if (!FFileHelper::LoadFileToString(JsonString, *ProfileFullPath) || !FVARIDProfileHotReload::HashVFMaps(JsonString, FOV, ProfileDir, NewHashes))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("VARID: Could not read the hot reloaded profile. Keeping the one shown: %s"), *ProfileFullPath);
+		return INDEX_NONE;
+	}
+
+	json JsonObject = json::parse(TCHAR_TO_UTF8(*JsonString), nullptr, false, false);
+
+	// the maps are replaced in a copy of the active profile, which keeps its FX toggles. The maps not replaced share their image textures with the active one
+	FVARIDProfile ReloadedProfile(Profile);
+	TArray<int32> ChangedSlots;
+
+	const bool bApplied = FVARIDProfileHotReload::ApplyChangedVFMaps(
+		NewHashes,
+		[&JsonObject, &FOV, &ProfileDir](const FString& InJsonPath, FVARIDVFMap& OutVFMap) { return ParseVFMap(JsonObject, InJsonPath, FOV, ProfileDir, OutVFMap); },
+		ReloadedProfile,
+		ProfileHotReload->Hashes,
+		ChangedSlots);
+
+	if (!bApplied)
+	{
+		return INDEX_NONE;
+	}
+
+	if (ChangedSlots.Num() > 0)
+	{
+		bApplyingProfileHotReload = true;
+		SetActiveProfile(ReloadedProfile);
+		bApplyingProfileHotReload = false;
+	}
+
+	++ProfileHotReload->NumReloads;
+	ProfileHotReload->NumVFMapsReparsed += ChangedSlots.Num();
+
+	UE_LOG(LogTemp, Display, TEXT("VARID: Hot reloaded %s: %d of %d VF maps changed"), *ProfileFullPath, ChangedSlots.Num(), FVARIDProfileHotReload::NumVFMaps);
+	return ChangedSlots.Num();
+}
+
+bool FVARIDModule::TickProfileHotReload(float InDeltaTime)
+{
+	check(ProfileHotReload);
+
+	const int64 Stamp = FVARIDProfileHotReload::GetFileStamp(ProfileHotReload->GetProfileFullPath());
+
+	if (ProfileHotReload->Debounce.Update(Stamp, FPlatformTime::Seconds(), ProfileHotReload->GetDebounceSeconds()))
+	{
+		ReloadChangedVFMaps();
+	}
 
 	return true;
 }
 
+bool FVARIDModule::ParseVFMapJson(const FString& InJsonString, const FString& InJsonPath, FVARIDVFMap& OutVFMap)
+{
+	json JsonObject = json::parse(TCHAR_TO_UTF8(*InJsonString), nullptr, false, false);
+	if (JsonObject.is_discarded())
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Could not parse the json VF map."));
+		return false;
+	}
+
+	return ParseVFMap(JsonObject, InJsonPath, GetDisplayFOV(), FString(), OutVFMap);
+}
+
 FVARIDEyeTracking& FVARIDModule::GetEyeTracking()
 {
 	return EyeTracking;
@@ -459,7 +1148,17 @@ FVARIDEyeTracking& FVARIDModule::GetEyeTracking()
 
 void FVARIDModule::SetEyeTracking(const FVARIDEyeTracking& InEyeTracking)
 {
+	if (!CanChangeTracedState())
+	{
+		return;
+	}
+
 	EyeTracking = InEyeTracking;
+
+	if (TraceRecorder)
+	{
+		TraceRecorder->RecordEyeTracking(EyeTracking);
+	}
 }
 
 const FVector2D& FVARIDModule::GetDisplayFOV()
@@ -469,10 +1168,208 @@ const FVector2D& FVARIDModule::GetDisplayFOV()
 
 void FVARIDModule::SetDisplayFOV(const FVector2D& InDisplayFOV)
 {
+	if (!CanChangeTracedState())
+	{
+		return;
+	}
+
 	DisplayFOV.X = InDisplayFOV.X;
 	DisplayFOV.Y = InDisplayFOV.Y;
+
+	if (TraceRecorder)
+	{
+		TraceRecorder->RecordDisplayFOV(DisplayFOV);
+	}
+}
+
+bool FVARIDModule::BeginTraceRecording(const FString& InFilePath)
+{
+	EndTraceRecording();
+
+	FString FilePath = InFilePath;
+	if (FilePath.IsEmpty())
+	{
+		FilePath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("VARID"), FString::Printf(TEXT("Trace-%s.vtrace"), *FDateTime::Now().ToString()));
+	}
+
+	TraceRecorder = FVARIDTraceRecorder::Begin(FilePath);
+	if (!TraceRecorder)
+	{
+		return false;
+	}
+
+	// the state the session starts in, so the trace doesn't depend on what was set before it
+	TraceRecorder->RecordDisplayFOV(DisplayFOV);
+	TraceRecorder->RecordEyeTracking(EyeTracking);
+
+	// with a progression, that is its current step, and every later step is recorded as it is set
+	if (Profile.IsValid)
+	{
+		TraceRecorder->RecordActiveProfile(Profile);
+	}
+
+	return true;
+}
+
+void FVARIDModule::EndTraceRecording()
+{
+	if (TraceRecorder)
+	{
+		// the render thread may still hold it, but records nothing more once it has ended
+		TraceRecorder->End();
+		TraceRecorder.Reset();
+	}
+}
+
+const TSharedPtr<FVARIDTraceRecorder, ESPMode::ThreadSafe>& FVARIDModule::GetTraceRecorder() const
+{
+	return TraceRecorder;
+}
+
+bool FVARIDModule::BeginTraceReplay(const FString& InFilePath)
+{
+	EndTraceReplay();
+
+	TUniquePtr<FVARIDTrace> Trace = MakeUnique<FVARIDTrace>();
+	if (!FVARIDTrace::Load(InFilePath, *Trace))
+	{
+		return false;
+	}
+
+	TraceReplay = MoveTemp(Trace);
+	TraceReplayNextEvent = 0;
+	bTraceReplayStarted = false;
+	TraceReplayHandle = FCoreDelegates::OnBeginFrame.AddRaw(this, &FVARIDModule::TickTraceReplay);
+
+	return true;
 }
 
+void FVARIDModule::EndTraceReplay()
+{
+	if (TraceReplay)
+	{
+		FCoreDelegates::OnBeginFrame.Remove(TraceReplayHandle);
+		TraceReplayHandle.Reset();
+		TraceReplay.Reset();
+	}
+}
+
+bool FVARIDModule::IsTraceReplaying() const
+{
+	return TraceReplay.IsValid();
+}
+
+bool FVARIDModule::CanChangeTracedState() const
+{
+	return !TraceReplay || bApplyingTraceReplay;
+}
+
+void FVARIDModule::TickTraceReplay()
+{
+	check(TraceReplay);
+
+	// frame 0 of the trace is the first frame of the replay. From then on the frames keep step, however long each takes
+	if (!bTraceReplayStarted)
+	{
+		TraceReplayStartFrameNumber = GFrameNumber;
+		bTraceReplayStarted = true;
+	}
+
+	const uint32 Frame = GFrameNumber - TraceReplayStartFrameNumber;
+	const TArray<FVARIDTraceEvent>& Events = TraceReplay->Events;
+
+	bApplyingTraceReplay = true;
+
+	for (; TraceReplayNextEvent < Events.Num() && Events[TraceReplayNextEvent].Frame <= Frame; ++TraceReplayNextEvent)
+	{
+		const FVARIDTraceEvent& Event = Events[TraceReplayNextEvent];
+
+		switch (Event.Type)
+		{
+		case EVARIDTraceEvent::EyeTracking:
+			SetEyeTracking(Event.EyeTracking);
+			break;
+		case EVARIDTraceEvent::ActiveProfile:
+			SetActiveProfile(TraceReplay->Profiles[Event.Value]);
+			break;
+		case EVARIDTraceEvent::FXEnabled:
+			FVARIDTrace::SetFXEnabled(Profile, (uint8)Event.Value);
+			if (TraceRecorder)
+			{
+				TraceRecorder->RecordFXEnabled((uint8)Event.Value);
+			}
+			break;
+		case EVARIDTraceEvent::DisplayFOV:
+			SetDisplayFOV(Event.DisplayFOV);
+			break;
+		default:
+			break;
+		}
+	}
+
+	bApplyingTraceReplay = false;
+
+	if (TraceReplayNextEvent >= Events.Num())
+	{
+		UE_LOG(LogTemp, Display, TEXT("VARID: Trace replay finished after %u frames"), Frame + 1);
+		EndTraceReplay();
+	}
+}
+
+/** encodes 8 bit BGRA as a PNG or half float RGBA as an EXR. Called on the output capture's writer thread */
+static bool EncodeCaptureFrame(IImageWrapperModule* InImageWrapperModule, EVARIDCaptureFormat InFormat, const FIntPoint& InSize, const TArray<uint8>& InPixels, TArray<uint8>& OutFileData)
+{
+	const bool bEXR = InFormat == EVARIDCaptureFormat::EXR;
+
+	TSharedPtr<IImageWrapper> ImageWrapper = InImageWrapperModule->CreateImageWrapper(bEXR ? EImageFormat::EXR : EImageFormat::PNG);
+	if (!ImageWrapper.IsValid() || !ImageWrapper->SetRaw(InPixels.GetData(), InPixels.Num(), InSize.X, InSize.Y, bEXR ? ERGBFormat::RGBA : ERGBFormat::BGRA, bEXR ? 16 : 8))
+	{
+		return false;
+	}
+
+	const TArray64<uint8>& Compressed = ImageWrapper->GetCompressed((int32)EImageCompressionQuality::Default);
+
+	OutFileData.Reset();
+	OutFileData.Append(Compressed.GetData(), (int32)Compressed.Num());
+	return OutFileData.Num() > 0;
+}
+
+bool FVARIDModule::BeginOutputCapture(const FString& InDirectory, EVARIDCaptureFormat InFormat, int32 InQueueFrames)
+{
+	EndOutputCapture();
+
+	FString Directory = InDirectory;
+	if (Directory.IsEmpty())
+	{
+		Directory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("VARID"), FString::Printf(TEXT("Capture-%s"), *FDateTime::Now().ToString()));
+	}
+
+	// the module is loaded here, on the game thread, for the writer thread to encode with
+	IImageWrapperModule* ImageWrapperModule = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+
+	OutputCapture = FVARIDCaptureWriter::Begin(Directory, InFormat, InQueueFrames,
+		[ImageWrapperModule](EVARIDCaptureFormat InEncodeFormat, const FIntPoint& InSize, const TArray<uint8>& InPixels, TArray<uint8>& OutFileData)
+		{
+			return EncodeCaptureFrame(ImageWrapperModule, InEncodeFormat, InSize, InPixels, OutFileData);
+		});
+
+	return OutputCapture.IsValid();
+}
+
+void FVARIDModule::EndOutputCapture()
+{
+	if (OutputCapture)
+	{
+		// the render thread may still hold it. Frames it queues from now on aren't written
+		OutputCapture->End();
+		OutputCapture.Reset();
+	}
+}
+
+const TSharedPtr<FVARIDCaptureWriter, ESPMode::ThreadSafe>& FVARIDModule::GetOutputCapture() const
+{
+	return OutputCapture;
+}
 
 #undef LOCTEXT_NAMESPACE
 
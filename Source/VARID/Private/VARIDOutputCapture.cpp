@@ -0,0 +1,517 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDOutputCapture.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Math/Float16.h"
+#include "Misc/Paths.h"
+
+/** how long the writer thread sleeps when the queue is empty */
+static const float IDLE_SECONDS = 0.002f;
+
+static const TCHAR* METADATA_FILE_NAME = TEXT("frames.csv");
+
+/** UTF-8 to the end of InFile */
+static void WriteText(FArchive& InFile, const FString& InText)
+{
+	FTCHARToUTF8 Utf8(*InText);
+	InFile.Serialize((void*)Utf8.Get(), Utf8.Length());
+}
+
+/** InBytes to a new file at InPath. False if it couldn't be opened or written */
+static bool WriteFile(const FString& InPath, const uint8* InBytes, int64 InNumBytes)
+{
+	TUniquePtr<FArchive> File(IFileManager::Get().CreateFileWriter(*InPath));
+	if (!File)
+	{
+		return false;
+	}
+
+	File->Serialize((void*)InBytes, InNumBytes);
+	return File->Close() && !File->IsError();
+}
+
+/*****************************************************************************************************************/
+// frame
+
+FVARIDCaptureFrame::FVARIDCaptureFrame()
+	: FrameNumber(0)
+	, Seconds(0.0)
+	, EyeIndex(0)
+	, GazePoint(FVector2D::ZeroVector)
+	, Size(FIntPoint::ZeroValue)
+	, PixelFormat(EVARIDCapturePixelFormat::B8G8R8A8)
+{
+
+}
+
+int32 FVARIDCaptureFrame::GetBytesPerPixel(EVARIDCapturePixelFormat InPixelFormat)
+{
+	return InPixelFormat == EVARIDCapturePixelFormat::FloatRGBA ? 8 : 4;
+}
+
+const TCHAR* FVARIDCaptureFrame::GetPixelFormatName(EVARIDCapturePixelFormat InPixelFormat)
+{
+	switch (InPixelFormat)
+	{
+	case EVARIDCapturePixelFormat::B8G8R8A8:
+		return TEXT("B8G8R8A8");
+	case EVARIDCapturePixelFormat::R8G8B8A8:
+		return TEXT("R8G8B8A8");
+	case EVARIDCapturePixelFormat::A2B10G10R10:
+		return TEXT("A2B10G10R10");
+	case EVARIDCapturePixelFormat::FloatRGBA:
+		return TEXT("FloatRGBA");
+	}
+
+	return TEXT("Unknown");
+}
+
+void FVARIDCaptureFrame::CopyFromSource()
+{
+	if (!Source)
+	{
+		return;
+	}
+
+	const int32 RowBytes = Size.X * GetBytesPerPixel(PixelFormat);
+	Pixels.SetNumUninitialized(RowBytes * Size.Y);
+
+	for (int32 Row = 0; Row < Size.Y; ++Row)
+	{
+		FMemory::Memcpy(Pixels.GetData() + Row * RowBytes, Source->GetData() + (SIZE_T)Row * Source->GetPitch(), RowBytes);
+	}
+
+	Source->MarkCopied();
+	Source.Reset();
+}
+
+/*****************************************************************************************************************/
+// source
+
+FVARIDCaptureSource::FVARIDCaptureSource(const uint8* InData, int32 InPitch)
+	: Data(InData)
+	, Pitch(InPitch)
+	, bCopied(false)
+{
+
+}
+
+const uint8* FVARIDCaptureSource::GetData() const
+{
+	return Data;
+}
+
+int32 FVARIDCaptureSource::GetPitch() const
+{
+	return Pitch;
+}
+
+bool FVARIDCaptureSource::IsCopied() const
+{
+	return bCopied;
+}
+
+void FVARIDCaptureSource::MarkCopied()
+{
+	bCopied = true;
+}
+
+/*****************************************************************************************************************/
+// queue
+
+FVARIDCaptureQueue::FFrameRing::FFrameRing()
+	: NumPushed(0)
+	, NumPopped(0)
+{
+
+}
+
+void FVARIDCaptureQueue::FFrameRing::Push(FVARIDCaptureFrame* InFrame)
+{
+	// only the pushing thread writes NumPushed, and the slot is published by the store that follows
+	const uint64 Index = NumPushed;
+	check(Index - NumPopped < (uint64)Items.Num());
+
+	Items[(int32)(Index % Items.Num())] = InFrame;
+	NumPushed = Index + 1;
+}
+
+FVARIDCaptureFrame* FVARIDCaptureQueue::FFrameRing::Pop()
+{
+	const uint64 Index = NumPopped;
+	if (Index == NumPushed)
+	{
+		return nullptr;
+	}
+
+	FVARIDCaptureFrame* Frame = Items[(int32)(Index % Items.Num())];
+	NumPopped = Index + 1;
+	return Frame;
+}
+
+FVARIDCaptureQueue::FVARIDCaptureQueue(int32 InCapacity)
+	: NumDropped(0)
+{
+	const int32 Capacity = FMath::Max(InCapacity, 1);
+
+	Frames.Reserve(Capacity);
+	Queued.Items.SetNumZeroed(Capacity);
+	Free.Items.SetNumZeroed(Capacity);
+
+	for (int32 i = 0; i < Capacity; ++i)
+	{
+		Frames.Add(MakeUnique<FVARIDCaptureFrame>());
+		Free.Push(Frames.Last().Get());
+	}
+}
+
+FVARIDCaptureFrame* FVARIDCaptureQueue::Acquire()
+{
+	FVARIDCaptureFrame* Frame = Free.Pop();
+	if (!Frame)
+	{
+		++NumDropped;
+	}
+
+	return Frame;
+}
+
+void FVARIDCaptureQueue::Push(FVARIDCaptureFrame* InFrame)
+{
+	Queued.Push(InFrame);
+}
+
+void FVARIDCaptureQueue::RecordDropped()
+{
+	++NumDropped;
+}
+
+FVARIDCaptureFrame* FVARIDCaptureQueue::Pop()
+{
+	return Queued.Pop();
+}
+
+void FVARIDCaptureQueue::Release(FVARIDCaptureFrame* InFrame)
+{
+	Free.Push(InFrame);
+}
+
+int32 FVARIDCaptureQueue::GetCapacity() const
+{
+	return Frames.Num();
+}
+
+int32 FVARIDCaptureQueue::GetNumQueued() const
+{
+	// popped is read first, so a pop in between can only make it look fuller than it is
+	const uint64 NumPopped = Queued.NumPopped;
+	return (int32)(Queued.NumPushed - NumPopped);
+}
+
+uint64 FVARIDCaptureQueue::GetNumPushed() const
+{
+	return Queued.NumPushed;
+}
+
+uint64 FVARIDCaptureQueue::GetNumDropped() const
+{
+	return NumDropped;
+}
+
+/*****************************************************************************************************************/
+// writer
+
+TSharedPtr<FVARIDCaptureWriter, ESPMode::ThreadSafe> FVARIDCaptureWriter::Begin(const FString& InDirectory, EVARIDCaptureFormat InFormat, int32 InQueueCapacity, FVARIDEncodeCaptureFrame InEncode)
+{
+	IFileManager::Get().MakeDirectory(*InDirectory, true);
+
+	const FString MetadataPath = FPaths::Combine(InDirectory, METADATA_FILE_NAME);
+	FArchive* MetadataFile = IFileManager::Get().CreateFileWriter(*MetadataPath);
+	if (!MetadataFile)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Could not open output capture for writing: %s"), *MetadataPath);
+		return nullptr;
+	}
+
+	WriteText(*MetadataFile, TEXT("frame,seconds,eye,gaze_x,gaze_y,width,height,pixel_format,file\n"));
+
+	TSharedPtr<FVARIDCaptureWriter, ESPMode::ThreadSafe> Writer = MakeShareable(new FVARIDCaptureWriter(InDirectory, InFormat, InQueueCapacity, MoveTemp(InEncode), MetadataFile));
+	Writer->WriterThread = Async(EAsyncExecution::Thread, [WriterPtr = Writer.Get()]() { WriterPtr->WriteFrames(); });
+
+	UE_LOG(LogTemp, Display, TEXT("VARID: Capturing output to %s"), *InDirectory);
+	return Writer;
+}
+
+FVARIDCaptureWriter::FVARIDCaptureWriter(const FString& InDirectory, EVARIDCaptureFormat InFormat, int32 InQueueCapacity, FVARIDEncodeCaptureFrame InEncode, FArchive* InMetadataFile)
+	: Directory(InDirectory)
+	, Format(InFormat)
+	, Encode(MoveTemp(InEncode))
+	, StartSeconds(FPlatformTime::Seconds())
+	, Queue(InQueueCapacity)
+	, bStopping(false)
+	, bEnded(false)
+	, MetadataFile(InMetadataFile)
+	, NumWritten(0)
+	, NumFailed(0)
+{
+
+}
+
+FVARIDCaptureWriter::~FVARIDCaptureWriter()
+{
+	End();
+}
+
+void FVARIDCaptureWriter::End()
+{
+	if (bEnded)
+	{
+		return;
+	}
+
+	bEnded = true;
+	bStopping = true;
+
+	if (WriterThread.IsValid())
+	{
+		WriterThread.Wait();
+		WriterThread = TFuture<void>();
+	}
+
+	MetadataFile->Close();
+	MetadataFile.Reset();
+
+	UE_LOG(LogTemp, Display, TEXT("VARID: Output capture ended. %llu frames written, %llu dropped, %llu failed: %s"), (uint64)NumWritten, Queue.GetNumDropped(), (uint64)NumFailed, *Directory);
+}
+
+FVARIDCaptureQueue& FVARIDCaptureWriter::GetQueue()
+{
+	return Queue;
+}
+
+const FString& FVARIDCaptureWriter::GetDirectory() const
+{
+	return Directory;
+}
+
+EVARIDCaptureFormat FVARIDCaptureWriter::GetFormat() const
+{
+	return Format;
+}
+
+uint64 FVARIDCaptureWriter::GetNumWritten() const
+{
+	return NumWritten;
+}
+
+uint64 FVARIDCaptureWriter::GetNumFailed() const
+{
+	return NumFailed;
+}
+
+FString FVARIDCaptureWriter::GetFrameFileName(const FVARIDCaptureFrame& InFrame, EVARIDCaptureFormat InFormat)
+{
+	const TCHAR* Extension = InFormat == EVARIDCaptureFormat::PNG ? TEXT("png") : InFormat == EVARIDCaptureFormat::EXR ? TEXT("exr") : TEXT("raw");
+	return FString::Printf(TEXT("Eye%d_%08u.%s"), InFrame.EyeIndex, InFrame.FrameNumber, Extension);
+}
+
+void FVARIDCaptureWriter::ConvertPixels(const FVARIDCaptureFrame& InFrame, EVARIDCaptureFormat InFormat, TArray<uint8>& OutPixels)
+{
+	const int32 NumPixels = InFrame.Size.X * InFrame.Size.Y;
+	const uint8* Source = InFrame.Pixels.GetData();
+
+	if (InFormat == EVARIDCaptureFormat::Raw)
+	{
+		OutPixels = InFrame.Pixels;
+		return;
+	}
+
+	if (InFormat == EVARIDCaptureFormat::PNG)
+	{
+		OutPixels.SetNumUninitialized(NumPixels * 4);
+		uint8* Dest = OutPixels.GetData();
+
+		for (int32 i = 0; i < NumPixels; ++i, Dest += 4)
+		{
+			switch (InFrame.PixelFormat)
+			{
+			case EVARIDCapturePixelFormat::B8G8R8A8:
+				FMemory::Memcpy(Dest, Source + i * 4, 4);
+				break;
+
+			case EVARIDCapturePixelFormat::R8G8B8A8:
+				Dest[0] = Source[i * 4 + 2];
+				Dest[1] = Source[i * 4 + 1];
+				Dest[2] = Source[i * 4 + 0];
+				Dest[3] = Source[i * 4 + 3];
+				break;
+
+			case EVARIDCapturePixelFormat::A2B10G10R10:
+			{
+				uint32 Packed;
+				FMemory::Memcpy(&Packed, Source + i * 4, 4);
+				Dest[0] = (uint8)(((Packed >> 20) & 0x3ff) >> 2);
+				Dest[1] = (uint8)(((Packed >> 10) & 0x3ff) >> 2);
+				Dest[2] = (uint8)((Packed & 0x3ff) >> 2);
+				Dest[3] = (uint8)((Packed >> 30) * 85);
+				break;
+			}
+
+			case EVARIDCapturePixelFormat::FloatRGBA:
+			{
+				const uint16* Half = (const uint16*)(Source + i * 8);
+				for (int32 Channel = 0; Channel < 4; ++Channel)
+				{
+					FFloat16 Value;
+					Value.Encoded = Half[Channel];
+
+					// BGRA from RGBA
+					const int32 DestChannel = Channel == 3 ? 3 : 2 - Channel;
+					Dest[DestChannel] = (uint8)FMath::RoundToInt(FMath::Clamp(Value.GetFloat(), 0.0f, 1.0f) * 255.0f);
+				}
+				break;
+			}
+			}
+		}
+
+		return;
+	}
+
+	// EXR
+	OutPixels.SetNumUninitialized(NumPixels * 8);
+	uint16* Dest = (uint16*)OutPixels.GetData();
+
+	if (InFrame.PixelFormat == EVARIDCapturePixelFormat::FloatRGBA)
+	{
+		FMemory::Memcpy(Dest, Source, NumPixels * 8);
+		return;
+	}
+
+	for (int32 i = 0; i < NumPixels; ++i, Dest += 4)
+	{
+		float RGBA[4];
+
+		switch (InFrame.PixelFormat)
+		{
+		case EVARIDCapturePixelFormat::B8G8R8A8:
+			RGBA[0] = Source[i * 4 + 2] / 255.0f;
+			RGBA[1] = Source[i * 4 + 1] / 255.0f;
+			RGBA[2] = Source[i * 4 + 0] / 255.0f;
+			RGBA[3] = Source[i * 4 + 3] / 255.0f;
+			break;
+
+		case EVARIDCapturePixelFormat::R8G8B8A8:
+			for (int32 Channel = 0; Channel < 4; ++Channel)
+			{
+				RGBA[Channel] = Source[i * 4 + Channel] / 255.0f;
+			}
+			break;
+
+		default:
+		{
+			uint32 Packed;
+			FMemory::Memcpy(&Packed, Source + i * 4, 4);
+			RGBA[0] = (Packed & 0x3ff) / 1023.0f;
+			RGBA[1] = ((Packed >> 10) & 0x3ff) / 1023.0f;
+			RGBA[2] = ((Packed >> 20) & 0x3ff) / 1023.0f;
+			RGBA[3] = (Packed >> 30) / 3.0f;
+			break;
+		}
+		}
+
+		for (int32 Channel = 0; Channel < 4; ++Channel)
+		{
+			Dest[Channel] = FFloat16(RGBA[Channel]).Encoded;
+		}
+	}
+}
+
+bool FVARIDCaptureWriter::ParseFormat(const FString& InName, EVARIDCaptureFormat& OutFormat)
+{
+	if (InName.Equals(TEXT("raw"), ESearchCase::IgnoreCase))
+	{
+		OutFormat = EVARIDCaptureFormat::Raw;
+	}
+	else if (InName.Equals(TEXT("png"), ESearchCase::IgnoreCase))
+	{
+		OutFormat = EVARIDCaptureFormat::PNG;
+	}
+	else if (InName.Equals(TEXT("exr"), ESearchCase::IgnoreCase))
+	{
+		OutFormat = EVARIDCaptureFormat::EXR;
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void FVARIDCaptureWriter::WriteFrames()
+{
+	// the frames queued when End() is called are still written, so stopping is only checked once the queue is empty
+	while (true)
+	{
+		FVARIDCaptureFrame* Frame = Queue.Pop();
+		if (!Frame)
+		{
+			if (bStopping)
+			{
+				break;
+			}
+
+			FPlatformProcess::Sleep(IDLE_SECONDS);
+			continue;
+		}
+
+		// first, so the producer gets its memory back as soon as it can
+		Frame->CopyFromSource();
+
+		if (WriteFrame(*Frame))
+		{
+			++NumWritten;
+		}
+		else if (NumFailed++ == 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("VARID: Could not write captured frame %u of eye %d to %s"), Frame->FrameNumber, Frame->EyeIndex, *Directory);
+		}
+
+		Queue.Release(Frame);
+	}
+}
+
+bool FVARIDCaptureWriter::WriteFrame(const FVARIDCaptureFrame& InFrame)
+{
+	const FString FileName = GetFrameFileName(InFrame, Format);
+	const FString FilePath = FPaths::Combine(Directory, FileName);
+
+	bool bWritten = false;
+	if (Format == EVARIDCaptureFormat::Raw)
+	{
+		bWritten = WriteFile(FilePath, InFrame.Pixels.GetData(), InFrame.Pixels.Num());
+	}
+	else
+	{
+		ConvertPixels(InFrame, Format, ConvertedPixels);
+		bWritten = Encode && Encode(Format, InFrame.Size, ConvertedPixels, FileData) && WriteFile(FilePath, FileData.GetData(), FileData.Num());
+	}
+
+	if (!bWritten)
+	{
+		return false;
+	}
+
+	// only frames whose file was written get a line, so every line has a file
+	WriteText(*MetadataFile, FString::Printf(TEXT("%u,%.6f,%d,%.6f,%.6f,%d,%d,%s,%s\n"),
+		InFrame.FrameNumber, InFrame.Seconds - StartSeconds, InFrame.EyeIndex, InFrame.GazePoint.X, InFrame.GazePoint.Y,
+		InFrame.Size.X, InFrame.Size.Y, FVARIDCaptureFrame::GetPixelFormatName(InFrame.PixelFormat), *FileName));
+
+	return true;
+}
@@ -0,0 +1,425 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "VARIDOutputCapture.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// FVARIDCaptureQueue and FVARIDCaptureWriter capturing made up frames to disk. Capturing must never stall the render thread, so a full
+// queue or a slow encoder drops frames, and the frames that are written must read back intact
+
+/** byte InByteIndex of a made up frame. Differs from frame to frame and eye to eye, so a frame written to the wrong file shows up */
+static uint8 GetCaptureByte(uint32 InFrameNumber, int32 InEyeIndex, int32 InByteIndex)
+{
+	return (uint8)(InFrameNumber * 13 + InEyeIndex * 101 + InByteIndex);
+}
+
+/** fills InOutFrame as the render thread would: frame InFrameNumber, eyes alternating, the gaze moving with the frame */
+static void FillCaptureFrame(FVARIDCaptureFrame& InOutFrame, uint32 InFrameNumber, const FIntPoint& InSize, EVARIDCapturePixelFormat InPixelFormat)
+{
+	InOutFrame.FrameNumber = InFrameNumber;
+	InOutFrame.Seconds = FPlatformTime::Seconds();
+	InOutFrame.EyeIndex = InFrameNumber % 2;
+	InOutFrame.GazePoint = FVector2D(InFrameNumber * 0.01f, InFrameNumber * -0.02f);
+	InOutFrame.Size = InSize;
+	InOutFrame.PixelFormat = InPixelFormat;
+	InOutFrame.Pixels.SetNumUninitialized(InSize.X * InSize.Y * FVARIDCaptureFrame::GetBytesPerPixel(InPixelFormat));
+
+	for (int32 i = 0; i < InOutFrame.Pixels.Num(); ++i)
+	{
+		InOutFrame.Pixels[i] = GetCaptureByte(InFrameNumber, InOutFrame.EyeIndex, i);
+	}
+}
+
+/** checks each line of a capture's frames.csv names a file holding what InGetFileData gives for its frame. The frames listed, in order */
+static bool CheckCaptureFiles(const FString& InDirectory, const FIntPoint& InSize, TFunctionRef<void(uint32 InFrameNumber, TArray<uint8>& OutFileData)> InGetFileData, TArray<uint32>& OutFrameNumbers, FString& OutError)
+{
+	OutFrameNumbers.Reset();
+
+	FString Csv;
+	if (!FFileHelper::LoadFileToString(Csv, *FPaths::Combine(InDirectory, TEXT("frames.csv"))))
+	{
+		OutError = TEXT("frames.csv couldn't be read");
+		return false;
+	}
+
+	TArray<FString> Lines;
+	Csv.ParseIntoArrayLines(Lines);
+
+	if (Lines.Num() == 0 || Lines[0] != TEXT("frame,seconds,eye,gaze_x,gaze_y,width,height,pixel_format,file"))
+	{
+		OutError = TEXT("frames.csv has no header");
+		return false;
+	}
+
+	TArray<uint8> Expected;
+	TArray<uint8> Written;
+
+	for (int32 LineIndex = 1; LineIndex < Lines.Num(); ++LineIndex)
+	{
+		TArray<FString> Fields;
+		Lines[LineIndex].ParseIntoArray(Fields, TEXT(","), false);
+
+		if (Fields.Num() != 9)
+		{
+			OutError = FString::Printf(TEXT("line %d of frames.csv has %d fields"), LineIndex, Fields.Num());
+			return false;
+		}
+
+		FVARIDCaptureFrame Frame;
+		Frame.FrameNumber = (uint32)FCString::Atoi(*Fields[0]);
+		Frame.EyeIndex = Frame.FrameNumber % 2;
+		Frame.GazePoint = FVector2D(Frame.FrameNumber * 0.01f, Frame.FrameNumber * -0.02f);
+
+		const FString ExpectedEnd = FString::Printf(TEXT("%d,%.6f,%.6f,%d,%d"), Frame.EyeIndex, Frame.GazePoint.X, Frame.GazePoint.Y, InSize.X, InSize.Y);
+		const FString WrittenEnd = FString::Printf(TEXT("%s,%s,%s,%s,%s"), *Fields[2], *Fields[3], *Fields[4], *Fields[5], *Fields[6]);
+
+		if (WrittenEnd != ExpectedEnd || (OutFrameNumbers.Num() > 0 && Frame.FrameNumber <= OutFrameNumbers.Last()))
+		{
+			OutError = FString::Printf(TEXT("line %d of frames.csv, frame %u, is out of order or has the wrong eye, gaze or size"), LineIndex, Frame.FrameNumber);
+			return false;
+		}
+
+		InGetFileData(Frame.FrameNumber, Expected);
+
+		if (!FFileHelper::LoadFileToArray(Written, *FPaths::Combine(InDirectory, Fields[8])) || Written != Expected)
+		{
+			OutError = FString::Printf(TEXT("%s, frame %u, doesn't hold the frame's pixels"), *Fields[8], Frame.FrameNumber);
+			return false;
+		}
+
+		OutFrameNumbers.Add(Frame.FrameNumber);
+	}
+
+	return true;
+}
+
+bool FVARIDReference::ValidateOutputCapture(FString& OutReport)
+{
+	const FIntPoint Size(48, 32);
+	const FString Directory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("VARID"), TEXT("ValidateOutputCapture"));
+
+	/*************************************************************/
+	// the queue on its own: each frame once, in order, and full is a drop rather than a wait
+
+	{
+		FVARIDCaptureQueue Queue(4);
+
+		TArray<FVARIDCaptureFrame*> Acquired;
+		for (int32 i = 0; i < 4; ++i)
+		{
+			Acquired.AddUnique(Queue.Acquire());
+		}
+
+		if (Acquired.Contains(nullptr) || Acquired.Num() != 4 || Queue.Acquire() || Queue.GetNumDropped() != 1)
+		{
+			OutReport = TEXT("VARID: Output capture FAILED. A queue of 4 didn't give 4 frames and then drop the 5th");
+			return false;
+		}
+
+		for (FVARIDCaptureFrame* Frame : Acquired)
+		{
+			Queue.Push(Frame);
+		}
+
+		for (int32 i = 0; i < 4; ++i)
+		{
+			FVARIDCaptureFrame* Frame = Queue.Pop();
+			if (Frame != Acquired[i])
+			{
+				OutReport = FString::Printf(TEXT("VARID: Output capture FAILED. Frame %d popped out of order"), i);
+				return false;
+			}
+
+			Queue.Release(Frame);
+		}
+
+		if (Queue.Pop() || Queue.GetNumQueued() != 0 || Queue.GetNumPushed() != 4 || !Queue.Acquire())
+		{
+			OutReport = TEXT("VARID: Output capture FAILED. An emptied queue didn't give its frames back");
+			return false;
+		}
+	}
+
+	// a producer and a consumer on threads of their own. Every frame pushed arrives whole and in order, and every frame offered is pushed or dropped
+	const uint32 NumThreadedOffered = 20000;
+	uint64 NumThreadedDropped = 0;
+	{
+		FVARIDCaptureQueue Queue(4);
+		const FIntPoint SmallSize(4, 4);
+
+		TAtomic<bool> bProducing(true);
+		TAtomic<int32> NumBadFrames(0);
+		TAtomic<uint64> NumConsumed(0);
+
+		TFuture<void> Consumer = Async(EAsyncExecution::Thread, [&]()
+		{
+			int64 LastFrameNumber = -1;
+			while (true)
+			{
+				FVARIDCaptureFrame* Frame = Queue.Pop();
+				if (!Frame)
+				{
+					if (!bProducing && Queue.GetNumQueued() == 0)
+					{
+						break;
+					}
+					continue;
+				}
+
+				bool bGood = (int64)Frame->FrameNumber > LastFrameNumber && Frame->Size == SmallSize;
+				for (int32 i = 0; i < Frame->Pixels.Num() && bGood; ++i)
+				{
+					bGood = Frame->Pixels[i] == GetCaptureByte(Frame->FrameNumber, Frame->EyeIndex, i);
+				}
+
+				NumBadFrames += bGood ? 0 : 1;
+				LastFrameNumber = Frame->FrameNumber;
+				++NumConsumed;
+				Queue.Release(Frame);
+			}
+		});
+
+		for (uint32 FrameNumber = 0; FrameNumber < NumThreadedOffered; ++FrameNumber)
+		{
+			if (FVARIDCaptureFrame* Frame = Queue.Acquire())
+			{
+				FillCaptureFrame(*Frame, FrameNumber, SmallSize, EVARIDCapturePixelFormat::B8G8R8A8);
+				Queue.Push(Frame);
+			}
+
+			// bursts of twice the capacity, so some frames are dropped however fast the consumer is, then a pause for it to catch up
+			while (FrameNumber % 8 == 7 && Queue.GetNumQueued() > 0)
+			{
+				FPlatformProcess::Sleep(0.0f);
+			}
+		}
+
+		bProducing = false;
+		Consumer.Wait();
+
+		NumThreadedDropped = Queue.GetNumDropped();
+		if (NumBadFrames != 0 || NumConsumed != Queue.GetNumPushed() || Queue.GetNumPushed() + NumThreadedDropped != NumThreadedOffered || Queue.GetNumPushed() < NumThreadedOffered / 2)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Output capture FAILED. Of %u frames offered across threads %llu were pushed, %llu dropped and %llu consumed, %d of them wrong"),
+				NumThreadedOffered, Queue.GetNumPushed(), NumThreadedDropped, (uint64)NumConsumed, (int32)NumBadFrames);
+			return false;
+		}
+	}
+
+	/*************************************************************/
+	// raw, with the writer keeping up: every frame written, as it was read back, with its line of metadata. Every other frame is left in padded rows
+	// for the writer thread to copy, as the render thread leaves a mapped staging surface, which it can't unmap until the copy is done
+
+	const uint32 NumRawFrames = 24;
+	{
+		IFileManager::Get().DeleteDirectory(*Directory, false, true);
+
+		const int32 RowBytes = Size.X * FVARIDCaptureFrame::GetBytesPerPixel(EVARIDCapturePixelFormat::R8G8B8A8);
+		const int32 SourcePitch = RowBytes + 64;
+		TArray<TArray<uint8>> SourcePixels;
+		TArray<TSharedPtr<FVARIDCaptureSource, ESPMode::ThreadSafe>> Sources;
+		SourcePixels.SetNum(NumRawFrames);
+
+		TSharedPtr<FVARIDCaptureWriter, ESPMode::ThreadSafe> Writer = FVARIDCaptureWriter::Begin(Directory, EVARIDCaptureFormat::Raw, 4, nullptr);
+		if (!Writer)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Output capture FAILED. Couldn't begin a capture to %s"), *Directory);
+			return false;
+		}
+
+		for (uint32 FrameNumber = 0; FrameNumber < NumRawFrames; ++FrameNumber)
+		{
+			// paced by the writer, as a frame rate the disk keeps up with is
+			while (Writer->GetNumWritten() + Writer->GetNumFailed() < FrameNumber)
+			{
+				FPlatformProcess::Sleep(0.001f);
+			}
+
+			FVARIDCaptureFrame* Frame = Writer->GetQueue().Acquire();
+			if (!Frame)
+			{
+				OutReport = FString::Printf(TEXT("VARID: Output capture FAILED. Frame %u was dropped with the writer keeping up"), FrameNumber);
+				return false;
+			}
+
+			FillCaptureFrame(*Frame, FrameNumber, Size, EVARIDCapturePixelFormat::R8G8B8A8);
+
+			if (FrameNumber % 2 == 1)
+			{
+				// the padding is left unset to show up in the file if it's copied
+				TArray<uint8>& Padded = SourcePixels[FrameNumber];
+				Padded.Init(0xCD, SourcePitch * Size.Y);
+				for (int32 Row = 0; Row < Size.Y; ++Row)
+				{
+					FMemory::Memcpy(Padded.GetData() + Row * SourcePitch, Frame->Pixels.GetData() + Row * RowBytes, RowBytes);
+				}
+
+				Frame->Pixels.Reset();
+				Frame->Source = MakeShared<FVARIDCaptureSource, ESPMode::ThreadSafe>(Padded.GetData(), SourcePitch);
+				Sources.Add(Frame->Source);
+			}
+
+			Writer->GetQueue().Push(Frame);
+		}
+
+		Writer->End();
+
+		for (const TSharedPtr<FVARIDCaptureSource, ESPMode::ThreadSafe>& Source : Sources)
+		{
+			if (!Source->IsCopied() || !Source.IsUnique())
+			{
+				OutReport = TEXT("VARID: Output capture FAILED. A frame left in its producer's memory wasn't copied and let go of by the writer");
+				return false;
+			}
+		}
+
+		TArray<uint32> FrameNumbers;
+		FString Error;
+		const bool bFilesOK = CheckCaptureFiles(Directory, Size, [&Size](uint32 InFrameNumber, TArray<uint8>& OutFileData)
+		{
+			FVARIDCaptureFrame Frame;
+			FillCaptureFrame(Frame, InFrameNumber, Size, EVARIDCapturePixelFormat::R8G8B8A8);
+			OutFileData = Frame.Pixels;
+		}, FrameNumbers, Error);
+
+		if (!bFilesOK || FrameNumbers.Num() != (int32)NumRawFrames || Writer->GetNumWritten() != NumRawFrames || Writer->GetNumFailed() != 0)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Output capture FAILED. Raw capture of %u frames: %llu written, %d listed. %s"), NumRawFrames, Writer->GetNumWritten(), FrameNumbers.Num(), *Error);
+			return false;
+		}
+	}
+
+	/*************************************************************/
+	// PNG through an encoder slower than the frames arrive: the producer never waits, the frames it can't hand over are dropped, and those it can are written
+
+	const uint32 NumSlowFrames = 40;
+	const float EncodeSeconds = 0.02f;
+	uint64 NumSlowWritten = 0;
+	uint64 NumSlowDropped = 0;
+	double MaxOfferSeconds = 0.0;
+	{
+		IFileManager::Get().DeleteDirectory(*Directory, false, true);
+
+		// the file is the converted pixels themselves, so what was converted can be checked
+		FVARIDEncodeCaptureFrame SlowEncode = [EncodeSeconds](EVARIDCaptureFormat InFormat, const FIntPoint& InSize, const TArray<uint8>& InPixels, TArray<uint8>& OutFileData)
+		{
+			FPlatformProcess::Sleep(EncodeSeconds);
+			OutFileData = InPixels;
+			return InFormat == EVARIDCaptureFormat::PNG && InPixels.Num() == InSize.X * InSize.Y * 4;
+		};
+
+		TSharedPtr<FVARIDCaptureWriter, ESPMode::ThreadSafe> Writer = FVARIDCaptureWriter::Begin(Directory, EVARIDCaptureFormat::PNG, 4, SlowEncode);
+		if (!Writer)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Output capture FAILED. Couldn't begin a capture to %s"), *Directory);
+			return false;
+		}
+
+		for (uint32 FrameNumber = 0; FrameNumber < NumSlowFrames; ++FrameNumber)
+		{
+			const double OfferStartSeconds = FPlatformTime::Seconds();
+
+			if (FVARIDCaptureFrame* Frame = Writer->GetQueue().Acquire())
+			{
+				FillCaptureFrame(*Frame, FrameNumber, Size, EVARIDCapturePixelFormat::R8G8B8A8);
+				Writer->GetQueue().Push(Frame);
+			}
+
+			MaxOfferSeconds = FMath::Max(MaxOfferSeconds, FPlatformTime::Seconds() - OfferStartSeconds);
+
+			// frames come a tenth as often as they are encoded
+			FPlatformProcess::Sleep(EncodeSeconds * 0.1f);
+		}
+
+		Writer->End();
+
+		NumSlowWritten = Writer->GetNumWritten();
+		NumSlowDropped = Writer->GetQueue().GetNumDropped();
+
+		TArray<uint32> FrameNumbers;
+		FString Error;
+		const bool bFilesOK = CheckCaptureFiles(Directory, Size, [&Size](uint32 InFrameNumber, TArray<uint8>& OutFileData)
+		{
+			FVARIDCaptureFrame Frame;
+			FillCaptureFrame(Frame, InFrameNumber, Size, EVARIDCapturePixelFormat::R8G8B8A8);
+			FVARIDCaptureWriter::ConvertPixels(Frame, EVARIDCaptureFormat::PNG, OutFileData);
+		}, FrameNumbers, Error);
+
+		if (!bFilesOK || NumSlowWritten + NumSlowDropped != NumSlowFrames || NumSlowDropped == 0 || NumSlowWritten < 4 || FrameNumbers.Num() != (int32)NumSlowWritten)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Output capture FAILED. Of %u frames offered to a slow encoder %llu were written, %llu dropped and %d listed. %s"),
+				NumSlowFrames, NumSlowWritten, NumSlowDropped, FrameNumbers.Num(), *Error);
+			return false;
+		}
+
+		// a frame that had to wait for the encoder would take as long as it does
+		if (MaxOfferSeconds >= EncodeSeconds)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Output capture FAILED. Offering a frame took up to %.2f ms, as long as encoding one"), MaxOfferSeconds * 1000.0);
+			return false;
+		}
+	}
+
+	IFileManager::Get().DeleteDirectory(*Directory, false, true);
+
+	/*************************************************************/
+	// the output formats converted for the encoders
+
+	{
+		struct FConversionCase
+		{
+			EVARIDCapturePixelFormat PixelFormat;
+			TArray<uint8> Pixel;
+			EVARIDCaptureFormat Format;
+			TArray<uint8> Expected;
+		};
+
+		// half floats are little endian: 0.25 = 0x3400, 0.5 = 0x3800, 1 = 0x3c00
+		const TArray<FConversionCase> Cases =
+		{
+			{ EVARIDCapturePixelFormat::B8G8R8A8, { 10, 20, 30, 40 }, EVARIDCaptureFormat::PNG, { 10, 20, 30, 40 } },
+			{ EVARIDCapturePixelFormat::R8G8B8A8, { 10, 20, 30, 40 }, EVARIDCaptureFormat::PNG, { 30, 20, 10, 40 } },
+			{ EVARIDCapturePixelFormat::A2B10G10R10, { 0xff, 0x03, 0x08, 0xc0 }, EVARIDCaptureFormat::PNG, { 0, 128, 255, 255 } },
+			{ EVARIDCapturePixelFormat::FloatRGBA, { 0x00, 0x34, 0x00, 0x38, 0x00, 0x3c, 0x00, 0x3c }, EVARIDCaptureFormat::PNG, { 255, 128, 64, 255 } },
+			{ EVARIDCapturePixelFormat::B8G8R8A8, { 0, 0, 255, 255 }, EVARIDCaptureFormat::EXR, { 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c } },
+			{ EVARIDCapturePixelFormat::A2B10G10R10, { 0xff, 0x03, 0x00, 0xc0 }, EVARIDCaptureFormat::EXR, { 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c } },
+			{ EVARIDCapturePixelFormat::FloatRGBA, { 0x00, 0x34, 0x00, 0x38, 0x00, 0x3c, 0x00, 0x3c }, EVARIDCaptureFormat::EXR, { 0x00, 0x34, 0x00, 0x38, 0x00, 0x3c, 0x00, 0x3c } }
+		};
+
+		for (int32 CaseIndex = 0; CaseIndex < Cases.Num(); ++CaseIndex)
+		{
+			const FConversionCase& Case = Cases[CaseIndex];
+
+			FVARIDCaptureFrame Frame;
+			Frame.Size = FIntPoint(1, 1);
+			Frame.PixelFormat = Case.PixelFormat;
+			Frame.Pixels = Case.Pixel;
+
+			TArray<uint8> Converted;
+			FVARIDCaptureWriter::ConvertPixels(Frame, Case.Format, Converted);
+
+			if (Converted != Case.Expected)
+			{
+				OutReport = FString::Printf(TEXT("VARID: Output capture FAILED. %s converted for %s wrongly"),
+					FVARIDCaptureFrame::GetPixelFormatName(Case.PixelFormat), Case.Format == EVARIDCaptureFormat::PNG ? TEXT("PNG") : TEXT("EXR"));
+				return false;
+			}
+		}
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: Output capture OK. %u raw frames of %dx%d written and read back, %u of them copied out of padded rows by the writer thread; of %u offered to an encoder taking %.0f ms, %llu written and %llu dropped, each offer at most %.3f ms; %llu of %u dropped across threads, none out of order"),
+		NumRawFrames, Size.X, Size.Y, NumRawFrames / 2, NumSlowFrames, EncodeSeconds * 1000.0f, NumSlowWritten, NumSlowDropped, MaxOfferSeconds * 1000.0, NumThreadedDropped, NumThreadedOffered);
+	return true;
+}
+
+#endif
@@ -0,0 +1,128 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDPipelineWarmup.h"
+#include "HAL/PlatformTime.h"
+
+FVARIDPipelineWarmupItem::FVARIDPipelineWarmupItem()
+{
+
+}
+
+FVARIDPipelineWarmupItem::FVARIDPipelineWarmupItem(const FString& InName, TFunction<bool()> InWarm)
+	: Name(InName)
+	, Warm(MoveTemp(InWarm))
+{
+
+}
+
+FVARIDPipelineWarmup::FVARIDPipelineWarmup()
+	: WarmSeconds(0.0)
+	, State(EVARIDPipelineWarmupState::NotStarted)
+	, NumWarmed(0)
+	, NumItems(0)
+	, NumFailed(0)
+	, bStepQueued(false)
+{
+
+}
+
+void FVARIDPipelineWarmup::Start(TArray<FVARIDPipelineWarmupItem>&& InItems)
+{
+	check(State != EVARIDPipelineWarmupState::Warming);
+
+	Items = MoveTemp(InItems);
+	FailedNames.Reset();
+	WarmSeconds = 0.0;
+
+	NumWarmed = 0;
+	NumFailed = 0;
+	NumItems = Items.Num();
+	State = Items.Num() > 0 ? EVARIDPipelineWarmupState::Warming : EVARIDPipelineWarmupState::Ready;
+}
+
+int32 FVARIDPipelineWarmup::Step(double InBudgetSeconds, int32 InMaxItems)
+{
+	bStepQueued = false;
+
+	if (State != EVARIDPipelineWarmupState::Warming)
+	{
+		return 0;
+	}
+
+	const double StartSeconds = FPlatformTime::Seconds();
+	int32 NumStepped = 0;
+
+	do
+	{
+		FVARIDPipelineWarmupItem& Item = Items[NumWarmed];
+		if (!Item.Warm())
+		{
+			FailedNames.Add(Item.Name);
+			++NumFailed;
+		}
+
+		++NumWarmed;
+		++NumStepped;
+	}
+	while (NumWarmed < Items.Num() && (InMaxItems <= 0 || NumStepped < InMaxItems) && FPlatformTime::Seconds() - StartSeconds < InBudgetSeconds);
+
+	WarmSeconds += FPlatformTime::Seconds() - StartSeconds;
+
+	if (NumWarmed == Items.Num())
+	{
+		// the closures can hold references to shader maps, which aren't needed once everything is warm
+		Items.Empty();
+		State = EVARIDPipelineWarmupState::Ready;
+	}
+
+	return NumStepped;
+}
+
+bool FVARIDPipelineWarmup::QueueStep()
+{
+	if (bStepQueued || State != EVARIDPipelineWarmupState::Warming)
+	{
+		return false;
+	}
+
+	bStepQueued = true;
+	return true;
+}
+
+EVARIDPipelineWarmupState FVARIDPipelineWarmup::GetState() const
+{
+	return State;
+}
+
+bool FVARIDPipelineWarmup::IsReady() const
+{
+	return State == EVARIDPipelineWarmupState::Ready;
+}
+
+int32 FVARIDPipelineWarmup::GetNumWarmed() const
+{
+	return NumWarmed;
+}
+
+int32 FVARIDPipelineWarmup::GetNumItems() const
+{
+	return NumItems;
+}
+
+int32 FVARIDPipelineWarmup::GetNumFailed() const
+{
+	return NumFailed;
+}
+
+const TArray<FString>& FVARIDPipelineWarmup::GetFailedNames() const
+{
+	return FailedNames;
+}
+
+double FVARIDPipelineWarmup::GetWarmSeconds() const
+{
+	return WarmSeconds;
+}
@@ -0,0 +1,152 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "VARIDPipelineWarmup.h"
+#include "HAL/PlatformTime.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// FVARIDPipelineWarmup stepped with made up items rather than real pipeline states, so the ordering, the failure reporting and the time
+// budget can be checked without an RHI
+
+bool FVARIDReference::ValidatePipelineWarmup(FString& OutReport)
+{
+	/*************************************************************/
+	// no items, as under NullRHI: ready at once
+
+	{
+		FVARIDPipelineWarmup Warmup;
+		if (Warmup.GetState() != EVARIDPipelineWarmupState::NotStarted || Warmup.IsReady())
+		{
+			OutReport = TEXT("VARID: Pipeline warm-up FAILED. A warm-up that hasn't started is ready");
+			return false;
+		}
+
+		Warmup.Start(TArray<FVARIDPipelineWarmupItem>());
+		if (!Warmup.IsReady() || Warmup.QueueStep() || Warmup.Step(1.0) != 0)
+		{
+			OutReport = TEXT("VARID: Pipeline warm-up FAILED. A warm-up without items isn't ready at once, or still steps");
+			return false;
+		}
+	}
+
+	/*************************************************************/
+	// ten items, two of which fail, stepped as the module does: queued on the game thread, three at most a step on the render thread
+
+	const int32 NumItems = 10;
+	TArray<int32> WarmOrder;
+
+	TArray<FVARIDPipelineWarmupItem> Items;
+	for (int32 i = 0; i < NumItems; ++i)
+	{
+		Items.Add(FVARIDPipelineWarmupItem(FString::Printf(TEXT("Item%d"), i), [i, &WarmOrder]()
+		{
+			WarmOrder.Add(i);
+			return i != 3 && i != 7;
+		}));
+	}
+
+	FVARIDPipelineWarmup Warmup;
+	Warmup.Start(MoveTemp(Items));
+
+	int32 NumSteps = 0;
+	int32 NumFrames = 0;
+
+	for (; !Warmup.IsReady() && NumFrames < 100; ++NumFrames)
+	{
+		// the render thread runs each step a frame after it is queued, so every other frame finds one still in flight
+		if (Warmup.QueueStep() != (NumFrames % 2 == 0))
+		{
+			OutReport = FString::Printf(TEXT("VARID: Pipeline warm-up FAILED. On frame %d a step was queued while the last hadn't run, or couldn't be once it had"), NumFrames);
+			return false;
+		}
+
+		if (NumFrames % 2 == 1)
+		{
+			Warmup.Step(1000.0, 3);
+			++NumSteps;
+
+			if (Warmup.GetNumWarmed() != FMath::Min(NumSteps * 3, NumItems) || Warmup.IsReady() != (NumSteps * 3 >= NumItems))
+			{
+				OutReport = FString::Printf(TEXT("VARID: Pipeline warm-up FAILED. %d items warmed after %d steps of 3, %s"), Warmup.GetNumWarmed(), NumSteps, Warmup.IsReady() ? TEXT("ready") : TEXT("not ready"));
+				return false;
+			}
+		}
+	}
+
+	if (!Warmup.IsReady() || NumSteps != 4 || WarmOrder.Num() != NumItems)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Pipeline warm-up FAILED. %d items took %d steps of 3 and warmed %d times, %s. Expected 4 steps, each item once"),
+			NumItems, NumSteps, WarmOrder.Num(), Warmup.IsReady() ? TEXT("ready") : TEXT("not ready"));
+		return false;
+	}
+
+	for (int32 i = 0; i < NumItems; ++i)
+	{
+		if (WarmOrder[i] != i)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Pipeline warm-up FAILED. Item %d was warmed in place of item %d"), WarmOrder[i], i);
+			return false;
+		}
+	}
+
+	if (Warmup.GetNumFailed() != 2 || Warmup.GetFailedNames().Num() != 2 || Warmup.GetFailedNames()[0] != TEXT("Item3") || Warmup.GetFailedNames()[1] != TEXT("Item7"))
+	{
+		OutReport = FString::Printf(TEXT("VARID: Pipeline warm-up FAILED. %d items failed. Expected Item3 and Item7"), Warmup.GetNumFailed());
+		return false;
+	}
+
+	if (Warmup.QueueStep() || Warmup.Step(1000.0) != 0 || WarmOrder.Num() != NumItems)
+	{
+		OutReport = TEXT("VARID: Pipeline warm-up FAILED. A ready warm-up still steps");
+		return false;
+	}
+
+	/*************************************************************/
+	// the time budget: a step warms one item even with none, and stops once the budget has gone
+
+	const double ItemSeconds = 0.001;
+	const double BudgetSeconds = 0.005;
+	const int32 NumTimedItems = 50;
+
+	TArray<FVARIDPipelineWarmupItem> TimedItems;
+	for (int32 i = 0; i < NumTimedItems; ++i)
+	{
+		TimedItems.Add(FVARIDPipelineWarmupItem(FString::Printf(TEXT("Timed%d"), i), [ItemSeconds]()
+		{
+			const double StartSeconds = FPlatformTime::Seconds();
+			while (FPlatformTime::Seconds() - StartSeconds < ItemSeconds)
+			{
+			}
+			return true;
+		}));
+	}
+
+	FVARIDPipelineWarmup TimedWarmup;
+	TimedWarmup.Start(MoveTemp(TimedItems));
+
+	const int32 NumZeroBudget = TimedWarmup.Step(0.0);
+	const int32 NumBudget = TimedWarmup.Step(BudgetSeconds);
+
+	if (NumZeroBudget != 1 || NumBudget < 2 || NumBudget > FMath::CeilToInt(BudgetSeconds / ItemSeconds) + 1)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Pipeline warm-up FAILED. A step with no budget warmed %d items, and one of %.1f ms warmed %d items of %.1f ms"),
+			NumZeroBudget, BudgetSeconds * 1000.0, NumBudget, ItemSeconds * 1000.0);
+		return false;
+	}
+
+	int32 NumTimedSteps = 2;
+	while (TimedWarmup.Step(BudgetSeconds) > 0)
+	{
+		++NumTimedSteps;
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: Pipeline warm-up OK. Ready only once every item has been warmed, in order, with failures named. %d items of %.1f ms took %d steps of %.1f ms"),
+		NumTimedItems, ItemSeconds * 1000.0, NumTimedSteps, BudgetSeconds * 1000.0);
+	return true;
+}
+
+#endif
@@ -4,6 +4,71 @@
 // file, You can obtain one at https://mozilla.org/MPL/2.0/.
 
 #include "VARIDProfile.h"
+#include "VARIDVFMapResolution.h"
+#include "Misc/ScopeLock.h"
+
+/** what a VF map builds from its points the first time it is needed, shared by every copy of the map */
+struct FVARIDVFMapDerivedData
+{
+	FCriticalSection Lock;
+
+	TSharedPtr<const FVARIDVFMapMesh, ESPMode::ThreadSafe> Mesh;
+
+	/** of a map with the same positions, whose triangles the mesh reuses */
+	TSharedPtr<FVARIDVFMapDerivedData, ESPMode::ThreadSafe> SamePositions;
+
+	/** x for mono and y for side by side stereo. Negative until they are asked for */
+	FVector2D CurvatureBounds = FVector2D(-1.0f, -1.0f);
+
+	/** maps whose bounds blend to this map's, instead of working it out from the points. A map that is off is flat, so it is left out */
+	TArray<FVARIDVFMap> BlendedVFMaps;
+	TArray<float> BlendWeights;
+};
+
+static TSharedPtr<const FVARIDVFMapMesh, ESPMode::ThreadSafe> GetVFMapMesh(FVARIDVFMapDerivedData& InOutDerivedData, const FVARIDVFMapPoints& InPoints, bool bInFullField)
+{
+	FScopeLock Lock(&InOutDerivedData.Lock);
+
+	if (InOutDerivedData.Mesh.IsValid())
+	{
+		return InOutDerivedData.Mesh;
+	}
+
+	TSharedPtr<FVARIDVFMapMesh, ESPMode::ThreadSafe> Mesh;
+
+	if (InOutDerivedData.SamePositions.IsValid())
+	{
+		// the triangulation only depends on the positions, so the other map's one just needs these values
+		Mesh = MakeShared<FVARIDVFMapMesh, ESPMode::ThreadSafe>(*GetVFMapMesh(*InOutDerivedData.SamePositions, InPoints, bInFullField));
+
+		for (int32 Vertex = 0; Vertex < Mesh->Vertices.Num(); ++Vertex)
+		{
+			if (Mesh->PointIndices[Vertex] != INDEX_NONE)
+			{
+				Mesh->Vertices[Vertex].Z = InPoints.GetValue(Mesh->PointIndices[Vertex]);
+			}
+		}
+	}
+	else
+	{
+		TArray<FVector> MeshPoints;
+
+		// a full field map is just the origin offset, which leaves a mesh of only the frame
+		if (!(bInFullField && InPoints.Num() == 1))
+		{
+			for (int32 i = 0; i < InPoints.Num(); ++i)
+			{
+				MeshPoints.Add(FVector(InPoints.GetX(i), InPoints.GetY(i), InPoints.GetValue(i)));
+			}
+		}
+
+		Mesh = MakeShared<FVARIDVFMapMesh, ESPMode::ThreadSafe>();
+		Mesh->Build(MeshPoints);
+	}
+
+	InOutDerivedData.Mesh = Mesh;
+	return Mesh;
+}
 
 FVARIDVFMapPoint::FVARIDVFMapPoint()
 {
@@ -45,6 +110,7 @@ FVARIDVFMap::FVARIDVFMap()
 {
 	ExpectedNumDataPoints = 0;
 	FullField = false;
+	DerivedData = MakeShared<FVARIDVFMapDerivedData, ESPMode::ThreadSafe>();
 }
 
 FVARIDVFMap::FVARIDVFMap(const FVARIDVFMap& CopyMe)
@@ -52,9 +118,106 @@ FVARIDVFMap::FVARIDVFMap(const FVARIDVFMap& CopyMe)
 	ExpectedNumDataPoints = CopyMe.ExpectedNumDataPoints;
 	FullField = CopyMe.FullField;
 
-	for (int32 i = 0; i < CopyMe.Data.Num(); i++)
+	Points = CopyMe.Points;
+	Data = CopyMe.Data;
+	Image = CopyMe.Image;
+	DerivedData = CopyMe.DerivedData;
+}
+
+void FVARIDVFMap::MigrateDeprecatedData()
+{
+	if (Data.Num() == 0)
+	{
+		return;
+	}
+
+	if (Points.Num() == 0)
+	{
+		Points.SetPoints(Data);
+		ResetDerivedData();
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("VARID: VF map has both Points and the deprecated Data. Data is ignored"));
+	}
+
+	Data.Empty();
+}
+
+void FVARIDVFMap::PostSerialize(const FArchive& Ar)
+{
+	if (Ar.IsLoading())
+	{
+		MigrateDeprecatedData();
+	}
+}
+
+TSharedPtr<const FVARIDVFMapMesh, ESPMode::ThreadSafe> FVARIDVFMap::GetMesh() const
+{
+	return GetVFMapMesh(*DerivedData, Points, FullField);
+}
+
+void FVARIDVFMap::ResetDerivedData(const FVARIDVFMap* InSamePositions)
+{
+	// InSamePositions can be this map, before its values were changed
+	TSharedPtr<FVARIDVFMapDerivedData, ESPMode::ThreadSafe> SamePositions = InSamePositions ? InSamePositions->DerivedData : nullptr;
+
+	DerivedData = MakeShared<FVARIDVFMapDerivedData, ESPMode::ThreadSafe>();
+	DerivedData->SamePositions = SamePositions;
+}
+
+float FVARIDVFMap::GetCurvatureBound(float InXScale) const
+{
+	// a full field map is flat, and an image map is never summed as an RBF
+	if ((FullField && Points.Num() == 1) || Points.Num() == 0)
+	{
+		return 0.0f;
+	}
+
+	if (InXScale != 1.0f && InXScale != 0.5f)
+	{
+		return FVARIDVFMapResolution::GetCurvatureBound(Points, InXScale);
+	}
+
+	FScopeLock Lock(&DerivedData->Lock);
+	float& Bound = InXScale == 1.0f ? DerivedData->CurvatureBounds.X : DerivedData->CurvatureBounds.Y;
+
+	if (Bound < 0.0f && DerivedData->BlendWeights.Num() > 0)
+	{
+		// the blend's second derivative is the blend of theirs, so their bounds blend too
+		Bound = 0.0f;
+
+		for (int32 i = 0; i < DerivedData->BlendWeights.Num(); ++i)
+		{
+			Bound += DerivedData->BlendWeights[i] * DerivedData->BlendedVFMaps[i].GetCurvatureBound(InXScale);
+		}
+	}
+	else if (Bound < 0.0f)
+	{
+		Bound = FVARIDVFMapResolution::GetCurvatureBound(Points, InXScale);
+	}
+
+	return Bound;
+}
+
+void FVARIDVFMap::BlendCurvatureBounds(const FVARIDVFMap* InVFMap0, const FVARIDVFMap* InVFMap1, float InAlpha)
+{
+	const FVARIDVFMap* VFMaps[2] = { InVFMap0, InVFMap1 };
+	const float Weights[2] = { 1.0f - InAlpha, InAlpha };
+
+	FScopeLock Lock(&DerivedData->Lock);
+	DerivedData->CurvatureBounds = FVector2D(-1.0f, -1.0f);
+	DerivedData->BlendedVFMaps.Reset();
+	DerivedData->BlendWeights.Reset();
+
+	for (int32 i = 0; i < 2; ++i)
 	{
-		Data.Add(FVARIDVFMapPoint(CopyMe.Data[i]));
+		if (VFMaps[i])
+		{
+			// a copy shares their derived data, so each keyframe works its bound out once for every blend of it
+			DerivedData->BlendedVFMaps.Add(*VFMaps[i]);
+			DerivedData->BlendWeights.Add(Weights[i]);
+		}
 	}
 }
 
@@ -232,6 +395,26 @@ FVARIDFX* FVARIDProfile::GetFX(int32 ID)
 	return FX;
 }
 
+TArray<FVARIDVFMap*> FVARIDProfile::GetVFMaps()
+{
+	TArray<FVARIDVFMap*> VFMaps;
+
+	for (FVARIDEye* Eye : { &LeftEye, &RightEye })
+	{
+		VFMaps.Add(&Eye->Blur.VFMap);
+
+		for (FVARIDVFMap& VFMap : Eye->Contrast.VFMaps)
+		{
+			VFMaps.Add(&VFMap);
+		}
+
+		VFMaps.Add(&Eye->Inpaint.VFMap);
+		VFMaps.Add(&Eye->Warp.VFMap);
+	}
+
+	return VFMaps;
+}
+
 void FVARIDProfile::ToggleFX(int32 ID)
 {
 	FVARIDFX* FX = GetFX(ID);
@@ -0,0 +1,54 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDProfileBatch.h"
+#include "VARIDViewProfiles.h"
+
+FVARIDProfileBatchEntry::FVARIDProfileBatchEntry()
+{
+	GazePoint = FVector2D(0.0f, 0.0f);
+	EyeIndex = 0;
+}
+
+FVARIDProfileBatchEntry::FVARIDProfileBatchEntry(const FVARIDProfile& InProfile, const FVector2D& InGazePoint, int32 InEyeIndex)
+	: Profile(InProfile)
+	, GazePoint(InGazePoint)
+	, EyeIndex(InEyeIndex)
+{
+}
+
+const FVARIDEye* FVARIDProfileBatchEntry::GetEye() const
+{
+	if (!Profile.IsValid)
+	{
+		return nullptr;
+	}
+
+	return EyeIndex == 1 ? &Profile.RightEye : &Profile.LeftEye;
+}
+
+TArray<TArray<int32>> FVARIDProfileBatch::GroupBySharedPyramids(const TArray<FVARIDProfileBatchEntry>& InEntries)
+{
+	TArray<TArray<int32>> Groups;
+	TArray<uint32> GroupHashes;
+
+	for (int32 EntryIndex = 0; EntryIndex < InEntries.Num(); ++EntryIndex)
+	{
+		const uint32 Hash = FVARIDViewProfiles::GetInpaintHash(InEntries[EntryIndex].GetEye(), InEntries[EntryIndex].GazePoint);
+		const int32 GroupIndex = GroupHashes.Find(Hash);
+
+		if (GroupIndex == INDEX_NONE)
+		{
+			GroupHashes.Add(Hash);
+			Groups.AddDefaulted_GetRef().Add(EntryIndex);
+		}
+		else
+		{
+			Groups[GroupIndex].Add(EntryIndex);
+		}
+	}
+
+	return Groups;
+}
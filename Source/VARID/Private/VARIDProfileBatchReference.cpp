@@ -0,0 +1,264 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "Math/RandomStream.h"
+#include "HAL/PlatformTime.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// FVARIDProfileBatch rendering many profiles from one image. Sharing the pyramids between entries must not change any entry's output from
+// what it gives rendered on its own
+
+void FVARIDReference::RenderProfileBatch(const FVARIDImage& InImage, const TArray<FVARIDProfileBatchEntry>& InEntries, TArray<FVARIDImage>& OutImages, double* OutSharedSeconds, double* OutEntrySeconds)
+{
+	const uint8 MaxNumMips = 10;	// must match MAX_NUM_MIP_LEVELS
+	const float GradientStep = 0.002f;	// default of r.VARID.Warp.GradientStep
+
+	const FIntRect ViewportRect(FIntPoint(0, 0), InImage.Size);
+	TArray<FIntRect> EyeSceneRects;
+	EyeSceneRects.Add(ViewportRect);
+
+	const FVARIDWorkingTexturePlan Plan = FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode::PerEye, InImage.Size, EyeSceneRects, 0, MaxNumMips);
+	const FVector2D GradientStepUV(GradientStep, GradientStep * Plan.SceneExtent.X / Plan.SceneExtent.Y);
+
+	// once for the whole batch
+	const double SharedStartTime = FPlatformTime::Seconds();
+
+	TArray<FVARIDImage> GaussianMips;
+	TArray<FVARIDImage> LaplacianMips;
+	GaussianPyramidMultiPass(InImage, ViewportRect, Plan.NumMips, GaussianMips);
+	LaplacianPyramid(GaussianMips, ViewportRect, LaplacianMips);
+
+	const double EntryStartTime = FPlatformTime::Seconds();
+
+	OutImages.Reset();
+	bool bIgnoredInpaint = false;
+
+	for (const FVARIDProfileBatchEntry& Entry : InEntries)
+	{
+		OutImages.Add(InImage);
+		FVARIDImage& OutImage = OutImages.Last();
+
+		const FVARIDEye* Eye = Entry.GetEye();
+		if (!Eye)
+		{
+			continue;
+		}
+
+		bIgnoredInpaint |= Eye->Inpaint.Enabled;
+
+		// the table BuildVFMapTexturesCombined_RenderThread fills, for one eye without the stereo squeeze. Image maps count as having no points, as they do there
+		auto PointVFMap = [](bool bInEnabled, const FVARIDVFMap* InVFMap) -> const FVARIDVFMap*
+		{
+			return bInEnabled && !InVFMap->Image.IsValid() ? InVFMap : nullptr;
+		};
+
+		FVARIDVFMapPointTable Table;
+		Table.BeginEye();
+		Table.AddVFMap(EVARIDVFMapChannel::Blur, PointVFMap(Eye->Blur.Enabled, &Eye->Blur.VFMap), 0.0f, 1.0f, 0.0f, Entry.GazePoint);
+		Table.AddVFMap(EVARIDVFMapChannel::Inpaint, nullptr, 0.0f, 1.0f, 0.0f, Entry.GazePoint);
+		Table.AddVFMap(EVARIDVFMapChannel::Warp, PointVFMap(Eye->Warp.Enabled, &Eye->Warp.VFMap), 0.5f, 1.0f, 0.0f, Entry.GazePoint);
+
+		for (int32 MipLevel = 0; MipLevel < Plan.NumMips; ++MipLevel)
+		{
+			const bool bHasLevel = Eye->Contrast.Enabled && Eye->Contrast.VFMaps.IsValidIndex(MipLevel);
+			Table.AddVFMap((EVARIDVFMapChannel::Type)(EVARIDVFMapChannel::Contrast0 + MipLevel), bHasLevel ? PointVFMap(true, &Eye->Contrast.VFMaps[MipLevel]) : nullptr, 0.0f, 1.0f, 0.0f, Entry.GazePoint);
+		}
+
+		FVARIDImage BlurVFMap(Plan.Extent);
+		FVARIDImage InpaintVFMap(Plan.Extent);
+		FVARIDImage WarpVFMap(Plan.Extent);
+		TArray<FVARIDImage> ContrastVFMapMips;
+		AllocateMips(Plan.Extent, Plan.NumMips, ContrastVFMapMips);
+		EvaluatePlanVFMapsCombined(Plan, Table, Plan.NumMips, &GradientStepUV, BlurVFMap, InpaintVFMap, ContrastVFMapMips, WarpVFMap);
+
+		TArray<FVARIDImage> ContrastMips;
+		ContrastReconstructFromLaplacian(LaplacianMips, ContrastVFMapMips, ViewportRect, ContrastMips);
+		CompositeRaster(ContrastMips, BlurVFMap, WarpVFMap, ViewportRect, OutImage);
+	}
+
+	if (bIgnoredInpaint)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("VARID: The CPU profile batch has no inpainter. Entries with inpaint on were rendered without it"));
+	}
+
+	if (OutSharedSeconds)
+	{
+		*OutSharedSeconds = EntryStartTime - SharedStartTime;
+	}
+
+	if (OutEntrySeconds)
+	{
+		*OutEntrySeconds = FPlatformTime::Seconds() - EntryStartTime;
+	}
+}
+
+/** stage InStage of InNumStages of a made up condition: blur, contrast loss and warp all growing from the periphery in */
+static FVARIDProfile MakeProfileBatchStage(int32 InStage, int32 InNumStages)
+{
+	const float Severity = (InStage + 1.0f) / InNumStages;
+
+	auto MakeVFMap = [Severity](float InScale)
+	{
+		TArray<FVARIDVFMapPoint> Points;
+		for (int32 Y = 0; Y < 5; ++Y)
+		{
+			for (int32 X = 0; X < 5; ++X)
+			{
+				const FVector2D Position(0.1f + 0.2f * X, 0.1f + 0.2f * Y);
+				const float Eccentricity = FVector2D::Distance(Position, FVector2D(0.5f, 0.5f)) / 0.57f;
+				Points.Add(FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, Position.X, Position.Y, FMath::Clamp(InScale * Severity * Eccentricity, 0.0f, 1.0f)));
+			}
+		}
+
+		FVARIDVFMap VFMap;
+		VFMap.Points.SetPoints(Points);
+		return VFMap;
+	};
+
+	FVARIDProfile Profile;
+	Profile.Name = FString::Printf(TEXT("Stage %d"), InStage);
+	Profile.IsValid = true;
+	Profile.LeftEye.Blur.Enabled = true;
+	Profile.LeftEye.Blur.VFMap = MakeVFMap(0.8f);
+	Profile.LeftEye.Contrast.Enabled = true;
+	Profile.LeftEye.Warp.Enabled = true;
+	Profile.LeftEye.Warp.VFMap = MakeVFMap(0.3f);
+	Profile.LeftEye.Inpaint.Enabled = false;
+
+	for (int32 Level = 0; Level < 4; ++Level)
+	{
+		Profile.LeftEye.Contrast.VFMaps.Add(MakeVFMap(1.0f - Level * 0.2f));
+	}
+
+	Profile.RightEye = Profile.LeftEye;
+	return Profile;
+}
+
+bool FVARIDReference::ValidateProfileBatch(FString& OutReport)
+{
+	const FIntPoint Extent(192, 128);
+	const int32 NumStages = 8;
+
+	FVARIDImage Image(Extent);
+	FRandomStream RandomStream(40);
+	for (int32 Y = 0; Y < Extent.Y; ++Y)
+	{
+		for (int32 X = 0; X < Extent.X; ++X)
+		{
+			// edges at every scale, so every contrast level has something to take away
+			const float Checker = ((X / 16 + Y / 16) % 2) * 0.5f + ((X / 4 + Y / 4) % 2) * 0.25f;
+			Image.Store(X, Y, FVector4(Checker + RandomStream.FRand() * 0.2f, 1.0f - Checker, (float)X / Extent.X, 1.0f));
+		}
+	}
+
+	TArray<FVARIDProfileBatchEntry> Entries;
+	for (int32 Stage = 0; Stage < NumStages; ++Stage)
+	{
+		Entries.Add(FVARIDProfileBatchEntry(MakeProfileBatchStage(Stage, NumStages), FVector2D(0.0f, 0.0f)));
+	}
+
+	// the last stage again, looking elsewhere, and a view left as it is
+	Entries.Add(FVARIDProfileBatchEntry(MakeProfileBatchStage(NumStages - 1, NumStages), FVector2D(0.1f, -0.05f)));
+	Entries.Add(FVARIDProfileBatchEntry(FVARIDProfile(), FVector2D(0.0f, 0.0f)));
+
+	TArray<FVARIDImage> BatchImages;
+	RenderProfileBatch(Image, Entries, BatchImages);
+
+	if (BatchImages.Num() != Entries.Num())
+	{
+		OutReport = FString::Printf(TEXT("VARID: Profile batch FAILED. %d entries gave %d images"), Entries.Num(), BatchImages.Num());
+		return false;
+	}
+
+	for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); ++EntryIndex)
+	{
+		TArray<FVARIDProfileBatchEntry> Single;
+		Single.Add(Entries[EntryIndex]);
+
+		TArray<FVARIDImage> SingleImages;
+		RenderProfileBatch(Image, Single, SingleImages);
+
+		FIntPoint FirstMismatch;
+		if (!ImagesAreIdentical(BatchImages[EntryIndex], SingleImages[0], FirstMismatch))
+		{
+			OutReport = FString::Printf(TEXT("VARID: Profile batch FAILED. Entry %d differs from the same profile rendered alone at %d,%d"), EntryIndex, FirstMismatch.X, FirstMismatch.Y);
+			return false;
+		}
+	}
+
+	FIntPoint FirstMismatch;
+	if (!ImagesAreIdentical(BatchImages.Last(), Image, FirstMismatch))
+	{
+		OutReport = FString::Printf(TEXT("VARID: Profile batch FAILED. The entry without a valid profile is not a copy of the input at %d,%d"), FirstMismatch.X, FirstMismatch.Y);
+		return false;
+	}
+
+	// every stage and the moved gaze must actually change the image
+	for (int32 EntryIndex = 1; EntryIndex < Entries.Num() - 1; ++EntryIndex)
+	{
+		if (ImagesAreIdentical(BatchImages[EntryIndex], BatchImages[EntryIndex - 1], FirstMismatch))
+		{
+			OutReport = FString::Printf(TEXT("VARID: Profile batch FAILED. Entry %d gave the same image as entry %d"), EntryIndex, EntryIndex - 1);
+			return false;
+		}
+	}
+
+	// the GPU groups entries by how they inpaint. Without inpaint they all share, whatever the gaze
+	TArray<FVARIDProfileBatchEntry> InpaintEntries = Entries;
+	for (int32 EntryIndex : { 1, 2, 5 })
+	{
+		InpaintEntries[EntryIndex].Profile.LeftEye.Inpaint.Enabled = true;
+		InpaintEntries[EntryIndex].Profile.LeftEye.Inpaint.VFMap = InpaintEntries[1].Profile.LeftEye.Warp.VFMap;
+	}
+	InpaintEntries[5].GazePoint = FVector2D(0.2f, 0.0f);
+
+	const TArray<TArray<int32>> Groups = FVARIDProfileBatch::GroupBySharedPyramids(Entries);
+	const TArray<TArray<int32>> InpaintGroups = FVARIDProfileBatch::GroupBySharedPyramids(InpaintEntries);
+
+	if (Groups.Num() != 1 || Groups[0].Num() != Entries.Num() || InpaintGroups.Num() != 3 || InpaintGroups[1].Num() != 2 || InpaintGroups[1][1] != 2 || InpaintGroups[2][0] != 5)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Profile batch FAILED. Grouped into %d and %d pyramids, expected 1 without inpaint and 3 with it"), Groups.Num(), InpaintGroups.Num());
+		return false;
+	}
+
+	// scaling: a batch of N against N batches of one
+	FString Timings;
+	double SharedSeconds = 0.0;
+	double EntrySeconds = 0.0;
+	double SpeedUp = 0.0;
+
+	for (int32 NumProfiles = 1; NumProfiles <= NumStages; NumProfiles *= 2)
+	{
+		TArray<FVARIDProfileBatchEntry> Batch;
+		for (int32 Stage = 0; Stage < NumProfiles; ++Stage)
+		{
+			Batch.Add(Entries[Stage]);
+		}
+
+		const double BatchStartTime = FPlatformTime::Seconds();
+		RenderProfileBatch(Image, Batch, BatchImages, &SharedSeconds, &EntrySeconds);
+		const double BatchSeconds = FPlatformTime::Seconds() - BatchStartTime;
+
+		const double SeparateStartTime = FPlatformTime::Seconds();
+		for (const FVARIDProfileBatchEntry& Entry : Batch)
+		{
+			TArray<FVARIDProfileBatchEntry> Single;
+			Single.Add(Entry);
+			RenderProfileBatch(Image, Single, BatchImages);
+		}
+		const double SeparateSeconds = FPlatformTime::Seconds() - SeparateStartTime;
+
+		SpeedUp = SeparateSeconds / FMath::Max(BatchSeconds, 1e-9);
+		Timings += FString::Printf(TEXT(" N=%d: %.1f ms (%.1f ms pyramids + %.1f ms per profile), %.2fx faster than separately."),
+			NumProfiles, BatchSeconds * 1000.0, SharedSeconds * 1000.0, EntrySeconds * 1000.0 / NumProfiles, SpeedUp);
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: Profile batch OK. %d entries at %dx%d match the same profiles rendered alone.%s"), Entries.Num(), Extent.X, Extent.Y, *Timings);
+	return true;
+}
+
+#endif
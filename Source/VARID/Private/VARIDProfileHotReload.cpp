@@ -0,0 +1,220 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDProfileHotReload.h"
+#include <json.hpp>
+#include "HAL/FileManager.h"
+#include "Misc/Crc.h"
+#include "Misc/Paths.h"
+
+using json = nlohmann::json;
+
+FVARIDProfileVFMapSlot::FVARIDProfileVFMapSlot()
+	: VFMap(nullptr)
+{
+
+}
+
+FVARIDProfileVFMapSlot::FVARIDProfileVFMapSlot(const FString& InJsonPath, FVARIDVFMap* InVFMap)
+	: JsonPath(InJsonPath)
+	, VFMap(InVFMap)
+{
+
+}
+
+FVARIDFileChangeDebounce::FVARIDFileChangeDebounce()
+	: AppliedStamp(0)
+	, PendingStamp(0)
+	, PendingSeconds(0.0)
+	, bPending(false)
+{
+
+}
+
+void FVARIDFileChangeDebounce::Reset(int64 InStamp)
+{
+	AppliedStamp = InStamp;
+	PendingStamp = InStamp;
+	bPending = false;
+}
+
+bool FVARIDFileChangeDebounce::Update(int64 InStamp, double InNowSeconds, double InDebounceSeconds)
+{
+	// every new stamp restarts the wait, so a burst of saves is one reload after the last of them
+	if (InStamp != (bPending ? PendingStamp : AppliedStamp))
+	{
+		PendingStamp = InStamp;
+		PendingSeconds = InNowSeconds;
+		bPending = true;
+		return false;
+	}
+
+	if (bPending && InNowSeconds - PendingSeconds >= InDebounceSeconds)
+	{
+		AppliedStamp = PendingStamp;
+		bPending = false;
+		return true;
+	}
+
+	return false;
+}
+
+FVARIDProfileHotReload::FVARIDProfileHotReload(const FString& InProfileFullPath, float InDebounceSeconds, const TArray<uint32>& InHashes)
+	: Hashes(InHashes)
+	, NumReloads(0)
+	, NumVFMapsReparsed(0)
+	, ProfileFullPath(InProfileFullPath)
+	, DebounceSeconds(InDebounceSeconds)
+{
+	Debounce.Reset(GetFileStamp(ProfileFullPath));
+}
+
+void FVARIDProfileHotReload::GetVFMapSlots(FVARIDProfile& InProfile, TArray<FVARIDProfileVFMapSlot>& OutSlots)
+{
+	OutSlots.Reset(NumVFMaps);
+
+	FVARIDEye* Eyes[2] = { &InProfile.LeftEye, &InProfile.RightEye };
+	const TCHAR* EyeNames[2] = { TEXT("left_eye"), TEXT("right_eye") };
+
+	for (int32 EyeIndex = 0; EyeIndex < 2; ++EyeIndex)
+	{
+		FVARIDEye& Eye = *Eyes[EyeIndex];
+		const FString EyePath = FString(TEXT("/")) + EyeNames[EyeIndex];
+
+		if (Eye.Contrast.VFMaps.Num() != 10)
+		{
+			Eye.Contrast.VFMaps.SetNum(10);
+		}
+
+		OutSlots.Add(FVARIDProfileVFMapSlot(EyePath + TEXT("/blur"), &Eye.Blur.VFMap));
+		OutSlots.Add(FVARIDProfileVFMapSlot(EyePath + TEXT("/inpaint"), &Eye.Inpaint.VFMap));
+
+		// lowest spatial frequency first in the json, highest first in the profile
+		for (int32 Level = 0; Level < 10; ++Level)
+		{
+			FString LevelName = FString::Printf(TEXT("level_%d"), Level);
+			if (Level == 0)
+			{
+				LevelName += TEXT("_lowest_spatial_freq");
+			}
+			else if (Level == 9)
+			{
+				LevelName += TEXT("_highest_spatial_freq");
+			}
+
+			OutSlots.Add(FVARIDProfileVFMapSlot(EyePath + TEXT("/contrast/") + LevelName, &Eye.Contrast.VFMaps[9 - Level]));
+		}
+
+		OutSlots.Add(FVARIDProfileVFMapSlot(EyePath + TEXT("/warp"), &Eye.Warp.VFMap));
+	}
+
+	check(OutSlots.Num() == NumVFMaps);
+}
+
+bool FVARIDProfileHotReload::HashVFMaps(const FString& InJsonString, const FVector2D& InDisplayFOV, const FString& InProfileDir, TArray<uint32>& OutHashes)
+{
+	json JsonObject = json::parse(TCHAR_TO_UTF8(*InJsonString), nullptr, false, false);
+	if (JsonObject.is_discarded())
+	{
+		return false;
+	}
+
+	FVARIDProfile Profile;
+	TArray<FVARIDProfileVFMapSlot> Slots;
+	GetVFMapSlots(Profile, Slots);
+
+	OutHashes.Reset(Slots.Num());
+
+	for (const FVARIDProfileVFMapSlot& Slot : Slots)
+	{
+		// objects dump with their keys sorted and no whitespace, so only a change to the values changes the hash
+		const json::json_pointer Pointer(TCHAR_TO_UTF8(*Slot.JsonPath));
+		const std::string Dump = JsonObject.contains(Pointer) ? JsonObject.at(Pointer).dump() : std::string();
+
+		uint32 Hash = FCrc::MemCrc32(Dump.data(), (int32)Dump.size());
+		Hash = FCrc::MemCrc32(&InDisplayFOV, sizeof(InDisplayFOV), Hash);
+
+		// an image map changes when its file does
+		const json::json_pointer ImagePathPointer(TCHAR_TO_UTF8(*(Slot.JsonPath + TEXT("/image/path"))));
+		if (JsonObject.contains(ImagePathPointer) && JsonObject.at(ImagePathPointer).is_string())
+		{
+			FString ImagePath = FString(JsonObject.at(ImagePathPointer).get<std::string>().c_str());
+			if (FPaths::IsRelative(ImagePath))
+			{
+				ImagePath = FPaths::Combine(InProfileDir, ImagePath);
+			}
+
+			const int64 ImageStamp = GetFileStamp(ImagePath);
+			Hash = FCrc::MemCrc32(&ImageStamp, sizeof(ImageStamp), Hash);
+		}
+
+		OutHashes.Add(Hash);
+	}
+
+	return true;
+}
+
+bool FVARIDProfileHotReload::ApplyChangedVFMaps(const TArray<uint32>& InNewHashes, TFunctionRef<bool(const FString& InJsonPath, FVARIDVFMap& OutVFMap)> InParseVFMap, FVARIDProfile& InOutProfile, TArray<uint32>& InOutHashes, TArray<int32>& OutChangedSlots)
+{
+	OutChangedSlots.Reset();
+
+	TArray<FVARIDProfileVFMapSlot> Slots;
+	GetVFMapSlots(InOutProfile, Slots);
+
+	if (InNewHashes.Num() != Slots.Num())
+	{
+		return false;
+	}
+
+	// parsed into new maps first, so a map that fails leaves the profile as it was
+	TArray<FVARIDVFMap> ParsedVFMaps;
+
+	for (int32 SlotIndex = 0; SlotIndex < Slots.Num(); ++SlotIndex)
+	{
+		if (InOutHashes.IsValidIndex(SlotIndex) && InOutHashes[SlotIndex] == InNewHashes[SlotIndex])
+		{
+			continue;
+		}
+
+		FVARIDVFMap& ParsedVFMap = ParsedVFMaps.AddDefaulted_GetRef();
+		if (!InParseVFMap(Slots[SlotIndex].JsonPath, ParsedVFMap))
+		{
+			UE_LOG(LogTemp, Error, TEXT("VARID: Could not reparse VF map %s. The profile is unchanged"), *Slots[SlotIndex].JsonPath);
+			OutChangedSlots.Reset();
+			return false;
+		}
+
+		OutChangedSlots.Add(SlotIndex);
+	}
+
+	for (int32 i = 0; i < OutChangedSlots.Num(); ++i)
+	{
+		*Slots[OutChangedSlots[i]].VFMap = ParsedVFMaps[i];
+	}
+
+	InOutHashes = InNewHashes;
+	return true;
+}
+
+int64 FVARIDProfileHotReload::GetFileStamp(const FString& InFilePath)
+{
+	const int64 Size = IFileManager::Get().FileSize(*InFilePath);
+	if (Size < 0)
+	{
+		return 0;
+	}
+
+	return IFileManager::Get().GetTimeStamp(*InFilePath).GetTicks() ^ (Size << 40);
+}
+
+const FString& FVARIDProfileHotReload::GetProfileFullPath() const
+{
+	return ProfileFullPath;
+}
+
+float FVARIDProfileHotReload::GetDebounceSeconds() const
+{
+	return DebounceSeconds;
+}
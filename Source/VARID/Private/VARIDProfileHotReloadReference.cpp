@@ -0,0 +1,256 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "VARIDProfileHotReload.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// FVARIDProfileHotReload reparsing a profile's json as it is edited. Only the VF maps that changed may be reparsed, and a broken edit or a
+// burst of saves from an editor must not disturb the profile in use
+
+/** a profile's json with every VF map three points, each map's own. InEditedPath's first value is InEditedValue instead. Compact unless bInPretty */
+static FString MakeHotReloadJson(const TArray<FVARIDProfileVFMapSlot>& InSlots, const FString& InEditedPath, float InEditedValue, bool bInPretty)
+{
+	const TCHAR* Space = bInPretty ? TEXT("\n  ") : TEXT("");
+
+	// the eyes, then their FX, then the contrast levels, nested the way the profile is
+	FString Json = FString::Printf(TEXT("{%s\"name\": \"hot reload\", \"description\": \"\", \"author\": \"\", \"date\": \"\""), Space);
+
+	for (const TCHAR* EyeName : { TEXT("left_eye"), TEXT("right_eye") })
+	{
+		Json += FString::Printf(TEXT(",%s\"%s\": {"), Space, EyeName);
+
+		bool bFirstFX = true;
+		bool bInContrast = false;
+
+		for (int32 SlotIndex = 0; SlotIndex < InSlots.Num(); ++SlotIndex)
+		{
+			const FString& JsonPath = InSlots[SlotIndex].JsonPath;
+			const FString EyePrefix = FString(TEXT("/")) + EyeName + TEXT("/");
+			if (!JsonPath.StartsWith(EyePrefix))
+			{
+				continue;
+			}
+
+			FString Data;
+			for (int32 Point = 0; Point < 3; ++Point)
+			{
+				const float Value = (JsonPath == InEditedPath && Point == 0) ? InEditedValue : SlotIndex + Point * 0.25f;
+				Data += FString::Printf(TEXT("%s%d, %d, %g, 0, 100"), Point > 0 ? TEXT(", ") : TEXT(""), Point * 5 - 5, Point * 3 - 3, Value);
+			}
+
+			const FString MapJson = FString::Printf(TEXT("{%s\"expected_num_data_points\": 3, \"data\": [%s]}"), Space, *Data);
+			const FString Key = JsonPath.RightChop(EyePrefix.Len());
+
+			if (Key.StartsWith(TEXT("contrast/")))
+			{
+				Json += FString::Printf(TEXT("%s%s\"%s\": %s"), bInContrast ? TEXT(", ") : (bFirstFX ? TEXT("") : TEXT(", ")), bInContrast ? TEXT("") : TEXT("\"contrast\": {"), *Key.RightChop(9), *MapJson);
+				bInContrast = true;
+			}
+			else
+			{
+				Json += FString::Printf(TEXT("%s%s\"%s\": %s"), bInContrast ? TEXT("}") : TEXT(""), bFirstFX ? TEXT("") : TEXT(", "), *Key, *MapJson);
+				bInContrast = false;
+			}
+
+			bFirstFX = false;
+		}
+
+		Json += bInContrast ? TEXT("}}") : TEXT("}");
+	}
+
+	return Json + TEXT("}");
+}
+
+bool FVARIDReference::ValidateProfileHotReload(FString& OutReport)
+{
+	const FVector2D DisplayFOV(100.0f, 100.0f);
+
+	FVARIDProfile Profile;
+	TArray<FVARIDProfileVFMapSlot> Slots;
+	FVARIDProfileHotReload::GetVFMapSlots(Profile, Slots);
+
+	if (Slots.Num() != FVARIDProfileHotReload::NumVFMaps || Slots[2].JsonPath != TEXT("/left_eye/contrast/level_0_lowest_spatial_freq") || Slots[2].VFMap != &Profile.LeftEye.Contrast.VFMaps[9])
+	{
+		OutReport = FString::Printf(TEXT("VARID: Profile hot reload FAILED. The profile has %d VF map slots in the wrong order. Expected %d"), Slots.Num(), FVARIDProfileHotReload::NumVFMaps);
+		return false;
+	}
+
+	// each parse stamps its map with a number, so a map that wasn't reparsed keeps the number it had
+	int32 NumParses = 0;
+	TArray<FString> ParsedPaths;
+	bool bFailParse = false;
+
+	auto ParseVFMap = [&NumParses, &ParsedPaths, &bFailParse](const FString& InJsonPath, FVARIDVFMap& OutVFMap)
+	{
+		if (bFailParse)
+		{
+			return false;
+		}
+
+		OutVFMap.ExpectedNumDataPoints = ++NumParses;
+		ParsedPaths.Add(InJsonPath);
+		return true;
+	};
+
+	auto GetStamps = [&Slots]()
+	{
+		TArray<int32> Stamps;
+		for (const FVARIDProfileVFMapSlot& Slot : Slots)
+		{
+			Stamps.Add(Slot.VFMap->ExpectedNumDataPoints);
+		}
+		return Stamps;
+	};
+
+	/*************************************************************/
+	// first load parses everything
+
+	TArray<uint32> Hashes;
+	TArray<uint32> NewHashes;
+	TArray<int32> ChangedSlots;
+
+	if (!FVARIDProfileHotReload::HashVFMaps(MakeHotReloadJson(Slots, FString(), 0.0f, false), DisplayFOV, FString(), NewHashes)
+		|| !FVARIDProfileHotReload::ApplyChangedVFMaps(NewHashes, ParseVFMap, Profile, Hashes, ChangedSlots)
+		|| ChangedSlots.Num() != FVARIDProfileHotReload::NumVFMaps)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Profile hot reload FAILED. The first load parsed %d VF maps. Expected %d"), ChangedSlots.Num(), FVARIDProfileHotReload::NumVFMaps);
+		return false;
+	}
+
+	// every map's points are different, so their hashes should be
+	for (int32 i = 0; i < NewHashes.Num(); ++i)
+	{
+		for (int32 j = i + 1; j < NewHashes.Num(); ++j)
+		{
+			if (NewHashes[i] == NewHashes[j])
+			{
+				OutReport = FString::Printf(TEXT("VARID: Profile hot reload FAILED. %s and %s hash the same"), *Slots[i].JsonPath, *Slots[j].JsonPath);
+				return false;
+			}
+		}
+	}
+
+	/*************************************************************/
+	// an edit to each map in turn reparses that map alone
+
+	for (int32 SlotIndex = 0; SlotIndex < Slots.Num(); ++SlotIndex)
+	{
+		const TArray<int32> StampsBefore = GetStamps();
+		ParsedPaths.Reset();
+
+		const FString EditedJson = MakeHotReloadJson(Slots, Slots[SlotIndex].JsonPath, 50.0f, false);
+		if (!FVARIDProfileHotReload::HashVFMaps(EditedJson, DisplayFOV, FString(), NewHashes)
+			|| !FVARIDProfileHotReload::ApplyChangedVFMaps(NewHashes, ParseVFMap, Profile, Hashes, ChangedSlots))
+		{
+			OutReport = FString::Printf(TEXT("VARID: Profile hot reload FAILED. An edit to %s did not reload"), *Slots[SlotIndex].JsonPath);
+			return false;
+		}
+
+		const TArray<int32> StampsAfter = GetStamps();
+		for (int32 Other = 0; Other < Slots.Num(); ++Other)
+		{
+			const bool bReparsed = StampsAfter[Other] != StampsBefore[Other];
+			const bool bExpected = Other == SlotIndex;
+
+			if (bReparsed != bExpected || ChangedSlots.Num() != 1 || ParsedPaths.Num() != 1 || ParsedPaths[0] != Slots[SlotIndex].JsonPath)
+			{
+				OutReport = FString::Printf(TEXT("VARID: Profile hot reload FAILED. An edit to %s reparsed %d VF maps, including %s"), *Slots[SlotIndex].JsonPath, ChangedSlots.Num(), ParsedPaths.Num() > 0 ? *ParsedPaths[0] : TEXT("none"));
+				return false;
+			}
+		}
+
+		// back to the original, which reparses the map again
+		FVARIDProfileHotReload::HashVFMaps(MakeHotReloadJson(Slots, FString(), 0.0f, false), DisplayFOV, FString(), NewHashes);
+		FVARIDProfileHotReload::ApplyChangedVFMaps(NewHashes, ParseVFMap, Profile, Hashes, ChangedSlots);
+	}
+
+	/*************************************************************/
+	// formatting reparses nothing, the display FOV reparses everything, and a failed parse changes nothing
+
+	const int32 NumParsesBeforeFormatting = NumParses;
+	const bool bFormattedHashed = FVARIDProfileHotReload::HashVFMaps(MakeHotReloadJson(Slots, FString(), 0.0f, true), DisplayFOV, FString(), NewHashes);
+	FVARIDProfileHotReload::ApplyChangedVFMaps(NewHashes, ParseVFMap, Profile, Hashes, ChangedSlots);
+
+	if (!bFormattedHashed || NumParses != NumParsesBeforeFormatting || ChangedSlots.Num() != 0)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Profile hot reload FAILED. Reformatting the json reparsed %d VF maps"), ChangedSlots.Num());
+		return false;
+	}
+
+	{
+		const TArray<int32> StampsBefore = GetStamps();
+		const TArray<uint32> HashesBefore = Hashes;
+
+		bFailParse = true;
+		FVARIDProfileHotReload::HashVFMaps(MakeHotReloadJson(Slots, Slots[5].JsonPath, 50.0f, false), DisplayFOV, FString(), NewHashes);
+		const bool bApplied = FVARIDProfileHotReload::ApplyChangedVFMaps(NewHashes, ParseVFMap, Profile, Hashes, ChangedSlots);
+		bFailParse = false;
+
+		if (bApplied || GetStamps() != StampsBefore || Hashes != HashesBefore)
+		{
+			OutReport = TEXT("VARID: Profile hot reload FAILED. A VF map that failed to parse changed the profile");
+			return false;
+		}
+	}
+
+	FVARIDProfileHotReload::HashVFMaps(MakeHotReloadJson(Slots, FString(), 0.0f, false), DisplayFOV * 1.5f, FString(), NewHashes);
+	FVARIDProfileHotReload::ApplyChangedVFMaps(NewHashes, ParseVFMap, Profile, Hashes, ChangedSlots);
+
+	if (ChangedSlots.Num() != FVARIDProfileHotReload::NumVFMaps)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Profile hot reload FAILED. A new display FOV reparsed %d VF maps. Expected all %d"), ChangedSlots.Num(), FVARIDProfileHotReload::NumVFMaps);
+		return false;
+	}
+
+	TArray<uint32> HalfWrittenHashes;
+	const FString Json = MakeHotReloadJson(Slots, FString(), 0.0f, false);
+	if (FVARIDProfileHotReload::HashVFMaps(Json.Left(Json.Len() / 2), DisplayFOV, FString(), HalfWrittenHashes))
+	{
+		OutReport = TEXT("VARID: Profile hot reload FAILED. Half a profile's json hashed");
+		return false;
+	}
+
+	/*************************************************************/
+	// debouncing: polled every 50ms, five saves 100ms apart and then one on its own are two reloads, each a debounce after its last save
+
+	const double DebounceSeconds = 0.5;
+	const double PollSeconds = 0.05;
+
+	TArray<double> SaveTimes = { 1.0, 1.1, 1.2, 1.3, 1.4, 4.0 };
+	TArray<double> ReloadTimes;
+
+	FVARIDFileChangeDebounce Debounce;
+	Debounce.Reset(100);
+
+	int64 Stamp = 100;
+	int32 NextSave = 0;
+
+	for (double Now = 0.0; Now < 6.0; Now += PollSeconds)
+	{
+		for (; NextSave < SaveTimes.Num() && SaveTimes[NextSave] <= Now + 1e-6; ++NextSave)
+		{
+			++Stamp;
+		}
+
+		if (Debounce.Update(Stamp, Now, DebounceSeconds))
+		{
+			ReloadTimes.Add(Now);
+		}
+	}
+
+	if (ReloadTimes.Num() != 2 || ReloadTimes[0] < 1.4 + DebounceSeconds - 1e-6 || ReloadTimes[0] > 1.4 + DebounceSeconds + PollSeconds + 1e-6 || ReloadTimes[1] < 4.0 + DebounceSeconds - 1e-6)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Profile hot reload FAILED. Six saves, five in a burst, gave %d reloads, the first at %.2fs. Expected 2, the first at %.2fs"), ReloadTimes.Num(), ReloadTimes.Num() > 0 ? ReloadTimes[0] : 0.0, 1.4 + DebounceSeconds);
+		return false;
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: Profile hot reload OK. An edit to any one of %d VF maps reparses only that map, reformatting reparses none, and a burst of 5 saves is one reload %.2fs after the last"),
+		FVARIDProfileHotReload::NumVFMaps, ReloadTimes[0] - 1.4);
+	return true;
+}
+
+#endif
@@ -0,0 +1,400 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDProfileProgression.h"
+
+FVARIDProgressionTableEye::FVARIDProgressionTableEye()
+{
+	EyeIndex = 0;
+	XScale = 1.0f;
+	XOffset = 0.0f;
+}
+
+FVARIDProgressionTableEye::FVARIDProgressionTableEye(int32 InEyeIndex, float InXScale, float InXOffset)
+{
+	EyeIndex = InEyeIndex;
+	XScale = InXScale;
+	XOffset = InXOffset;
+}
+
+bool FVARIDProgressionTableEye::operator==(const FVARIDProgressionTableEye& Other) const
+{
+	return EyeIndex == Other.EyeIndex && XScale == Other.XScale && XOffset == Other.XOffset;
+}
+
+bool FVARIDProfileProgression::Create(const TArray<FVARIDProfile>& InKeyframes, const TArray<float>& InTimes, FVARIDProfileProgression& OutProgression)
+{
+	if (InKeyframes.Num() == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: A progression needs at least one keyframe"));
+		return false;
+	}
+
+	for (int32 Keyframe = 0; Keyframe < InKeyframes.Num(); ++Keyframe)
+	{
+		if (!InKeyframes[Keyframe].IsValid)
+		{
+			UE_LOG(LogTemp, Error, TEXT("VARID: Progression keyframe %d is not a valid profile"), Keyframe);
+			return false;
+		}
+	}
+
+	if (InTimes.Num() > 0 && InTimes.Num() != InKeyframes.Num())
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: A progression needs one time per keyframe, or none. Got %d times for %d keyframes"), InTimes.Num(), InKeyframes.Num());
+		return false;
+	}
+
+	for (int32 Keyframe = 1; Keyframe < InTimes.Num(); ++Keyframe)
+	{
+		if (InTimes[Keyframe] <= InTimes[Keyframe - 1])
+		{
+			UE_LOG(LogTemp, Error, TEXT("VARID: Progression keyframe times must be ascending. Keyframe %d is at %f, after %f"), Keyframe, InTimes[Keyframe], InTimes[Keyframe - 1]);
+			return false;
+		}
+	}
+
+	OutProgression = FVARIDProfileProgression();
+	OutProgression.Keyframes = InKeyframes;
+	OutProgression.Times = InTimes;
+
+	if (OutProgression.Times.Num() == 0)
+	{
+		for (int32 Keyframe = 0; Keyframe < InKeyframes.Num(); ++Keyframe)
+		{
+			OutProgression.Times.Add((float)Keyframe);
+		}
+	}
+
+	OutProgression.BuildSegments();
+	return true;
+}
+
+void FVARIDProfileProgression::GetSegment(float InTime, int32& OutKeyframe0, int32& OutKeyframe1, float& OutAlpha) const
+{
+	check(Keyframes.Num() > 0 && Times.Num() == Keyframes.Num());
+
+	const int32 NumKeyframes = Keyframes.Num();
+
+	if (NumKeyframes == 1 || InTime <= Times[0])
+	{
+		OutKeyframe0 = 0;
+		OutKeyframe1 = FMath::Min(1, NumKeyframes - 1);
+		OutAlpha = 0.0f;
+		return;
+	}
+
+	if (InTime >= Times.Last())
+	{
+		OutKeyframe0 = NumKeyframes - 2;
+		OutKeyframe1 = NumKeyframes - 1;
+		OutAlpha = 1.0f;
+		return;
+	}
+
+	// InTime is before the last keyframe, so this stops before it
+	int32 Keyframe = 0;
+	while (Times[Keyframe + 1] <= InTime)
+	{
+		++Keyframe;
+	}
+
+	OutKeyframe0 = Keyframe;
+	OutKeyframe1 = Keyframe + 1;
+	OutAlpha = (InTime - Times[Keyframe]) / (Times[Keyframe + 1] - Times[Keyframe]);
+}
+
+/** calls InFunction with each VF map of the two eyes - nullptr where the FX is off - and the map of OutEye they blend into. Turns on the FX of OutEye that either eye has on */
+template <typename FunctionType>
+static void ForEachVFMap(const FVARIDEye& InEye0, const FVARIDEye& InEye1, FVARIDEye& OutEye, FunctionType InFunction)
+{
+	OutEye.Blur.Enabled = InEye0.Blur.Enabled || InEye1.Blur.Enabled;
+	InFunction(InEye0.Blur.Enabled ? &InEye0.Blur.VFMap : nullptr, InEye1.Blur.Enabled ? &InEye1.Blur.VFMap : nullptr, OutEye.Blur.VFMap);
+
+	OutEye.Inpaint.Enabled = InEye0.Inpaint.Enabled || InEye1.Inpaint.Enabled;
+	InFunction(InEye0.Inpaint.Enabled ? &InEye0.Inpaint.VFMap : nullptr, InEye1.Inpaint.Enabled ? &InEye1.Inpaint.VFMap : nullptr, OutEye.Inpaint.VFMap);
+
+	OutEye.Warp.Enabled = InEye0.Warp.Enabled || InEye1.Warp.Enabled;
+	InFunction(InEye0.Warp.Enabled ? &InEye0.Warp.VFMap : nullptr, InEye1.Warp.Enabled ? &InEye1.Warp.VFMap : nullptr, OutEye.Warp.VFMap);
+
+	OutEye.Contrast.Enabled = InEye0.Contrast.Enabled || InEye1.Contrast.Enabled;
+	const int32 NumLevels0 = InEye0.Contrast.Enabled ? InEye0.Contrast.VFMaps.Num() : 0;
+	const int32 NumLevels1 = InEye1.Contrast.Enabled ? InEye1.Contrast.VFMaps.Num() : 0;
+	OutEye.Contrast.VFMaps.SetNum(FMath::Max(NumLevels0, NumLevels1));
+
+	for (int32 Level = 0; Level < OutEye.Contrast.VFMaps.Num(); ++Level)
+	{
+		InFunction(Level < NumLevels0 ? &InEye0.Contrast.VFMaps[Level] : nullptr, Level < NumLevels1 ? &InEye1.Contrast.VFMaps[Level] : nullptr, OutEye.Contrast.VFMaps[Level]);
+	}
+}
+
+static bool IsFullField(const FVARIDVFMap* InVFMap)
+{
+	return InVFMap && InVFMap->FullField && InVFMap->Points.Num() == 1;
+}
+
+void FVARIDProfileProgression::BuildSegments()
+{
+	Segments.Reset();
+
+	for (int32 Keyframe0 = 0; Keyframe0 < FMath::Max(Keyframes.Num() - 1, 1); ++Keyframe0)
+	{
+		const int32 Keyframe1 = FMath::Min(Keyframe0 + 1, Keyframes.Num() - 1);
+
+		FSegment& Segment = Segments.AddDefaulted_GetRef();
+		Segment.Template = Keyframes[Keyframe0];
+		if (Keyframe1 != Keyframe0)
+		{
+			Segment.Template.Name = FString::Printf(TEXT("%s - %s"), *Keyframes[Keyframe0].Name, *Keyframes[Keyframe1].Name);
+		}
+
+		auto BuildBlendedVFMap = [&Segment](const FVARIDVFMap* InVFMap0, const FVARIDVFMap* InVFMap1, FVARIDVFMap& OutTemplate)
+		{
+			FBlendedVFMap& Blended = Segment.VFMaps.AddDefaulted_GetRef();
+
+			const bool bImage = (InVFMap0 && InVFMap0->Image.IsValid()) || (InVFMap1 && InVFMap1->Image.IsValid());
+			if (bImage || IsFullField(InVFMap0) != IsFullField(InVFMap1))
+			{
+				Blended.bSwitch = true;
+				return;
+			}
+
+			// a full field map is just its origin offset, so two of them blend the one value
+			if (IsFullField(InVFMap0))
+			{
+				OutTemplate = *InVFMap0;
+				Blended.UnionIndices[0].Add(0);
+				Blended.UnionIndices[1].Add(0);
+				return;
+			}
+
+			OutTemplate = FVARIDVFMap();
+
+			TMap<FVector2D, int32> PointIndices;
+			TArray<FVARIDVFMapPoint> UnionPoints;
+			const FVARIDVFMap* VFMaps[2] = { InVFMap0, InVFMap1 };
+
+			for (int32 i = 0; i < 2; ++i)
+			{
+				if (!VFMaps[i])
+				{
+					continue;
+				}
+
+				for (int32 PointIndex = 0; PointIndex < VFMaps[i]->Points.Num(); ++PointIndex)
+				{
+					const FVector2D NormPosition(VFMaps[i]->Points.GetX(PointIndex), VFMaps[i]->Points.GetY(PointIndex));
+					const int32* FoundIndex = PointIndices.Find(NormPosition);
+
+					if (!FoundIndex)
+					{
+						FVARIDVFMapPoint& UnionPoint = UnionPoints.Add_GetRef(VFMaps[i]->Points.GetPoint(PointIndex));
+						UnionPoint.NormValue = 0.0f;
+						PointIndices.Add(NormPosition, UnionPoints.Num() - 1);
+						Blended.UnionIndices[i].Add(UnionPoints.Num() - 1);
+					}
+					else
+					{
+						Blended.UnionIndices[i].Add(*FoundIndex);
+					}
+				}
+			}
+
+			// keyframes with the same positions give a template that shares them too
+			OutTemplate.Points.SetPoints(UnionPoints);
+			OutTemplate.ExpectedNumDataPoints = OutTemplate.Points.Num();
+		};
+
+		ForEachVFMap(Keyframes[Keyframe0].LeftEye, Keyframes[Keyframe1].LeftEye, Segment.Template.LeftEye, BuildBlendedVFMap);
+		ForEachVFMap(Keyframes[Keyframe0].RightEye, Keyframes[Keyframe1].RightEye, Segment.Template.RightEye, BuildBlendedVFMap);
+	}
+}
+
+FVARIDProfile FVARIDProfileProgression::Evaluate(float InTime) const
+{
+	int32 Keyframe0 = 0;
+	int32 Keyframe1 = 0;
+	float Alpha = 0.0f;
+	GetSegment(InTime, Keyframe0, Keyframe1, Alpha);
+
+	const FSegment& Segment = Segments[Keyframe0];
+	FVARIDProfile Profile(Segment.Template);
+	int32 VFMapIndex = 0;
+
+	auto BlendVFMap = [&Segment, &VFMapIndex, Alpha](const FVARIDVFMap* InVFMap0, const FVARIDVFMap* InVFMap1, FVARIDVFMap& InOutVFMap)
+	{
+		const FBlendedVFMap& Blended = Segment.VFMaps[VFMapIndex++];
+
+		if (Blended.bSwitch)
+		{
+			const FVARIDVFMap* VFMap = Alpha < 0.5f ? InVFMap0 : InVFMap1;
+			InOutVFMap = VFMap ? *VFMap : FVARIDVFMap();
+			return;
+		}
+
+		FVARIDVFMapPoints& Points = InOutVFMap.Points;
+
+		for (int32 PointIndex = 0; PointIndex < Points.Num(); ++PointIndex)
+		{
+			Points.SetValue(PointIndex, 0.0f);
+		}
+
+		const FVARIDVFMap* VFMaps[2] = { InVFMap0, InVFMap1 };
+		const float Weights[2] = { 1.0f - Alpha, Alpha };
+
+		for (int32 i = 0; i < 2; ++i)
+		{
+			for (int32 PointIndex = 0; PointIndex < Blended.UnionIndices[i].Num(); ++PointIndex)
+			{
+				const int32 UnionIndex = Blended.UnionIndices[i][PointIndex];
+				Points.SetValue(UnionIndex, Points.GetValue(UnionIndex) + Weights[i] * VFMaps[i]->Points.GetValue(PointIndex));
+			}
+		}
+
+		// still the template's positions, so a mesh is its triangles with these values rather than a new triangulation
+		InOutVFMap.ResetDerivedData(&InOutVFMap);
+		InOutVFMap.BlendCurvatureBounds(InVFMap0, InVFMap1, Alpha);
+	};
+
+	ForEachVFMap(Keyframes[Keyframe0].LeftEye, Keyframes[Keyframe1].LeftEye, Profile.LeftEye, BlendVFMap);
+	ForEachVFMap(Keyframes[Keyframe0].RightEye, Keyframes[Keyframe1].RightEye, Profile.RightEye, BlendVFMap);
+
+	return Profile;
+}
+
+bool FVARIDProfileProgression::CanPackKeyframeTables() const
+{
+	for (const FSegment& Segment : Segments)
+	{
+		for (const FBlendedVFMap& Blended : Segment.VFMaps)
+		{
+			if (Blended.bSwitch)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void FVARIDProfileProgression::PackKeyframeTables(const TArray<FVARIDProgressionTableEye>& InEyes, int32 InNumMips, bool bInWarp, TArray<FVARIDVFMapPointTable>& OutTables) const
+{
+	check(InEyes.Num() <= 2);
+
+	OutTables.Reset();
+
+	for (const FVARIDProfile& Keyframe : Keyframes)
+	{
+		FVARIDVFMapPointTable& Table = OutTables.AddDefaulted_GetRef();
+
+		for (const FVARIDProgressionTableEye& Eye : InEyes)
+		{
+			Table.AddEye(Eye.EyeIndex == 1 ? &Keyframe.RightEye : &Keyframe.LeftEye, InNumMips, bInWarp, Eye.XScale, Eye.XOffset, FVector2D(0.0f, 0.0f));
+		}
+	}
+
+	// one entry layout for every keyframe: the union of their positions, eye by eye
+	TArray<TArray<FVARIDVFMapTableEntry>> Entries;
+	Entries.SetNum(OutTables.Num());
+
+	for (int32 EyeIndex = 0; EyeIndex < InEyes.Num(); ++EyeIndex)
+	{
+		TMap<FVector2D, int32> UnionIndices;
+		TArray<FVARIDVFMapTableEntry> UnionEntries;
+
+		for (const FVARIDVFMapPointTable& Table : OutTables)
+		{
+			for (int32 i = Table.EyeEntryRange[EyeIndex * 2]; i < Table.EyeEntryRange[EyeIndex * 2] + Table.EyeEntryRange[EyeIndex * 2 + 1]; ++i)
+			{
+				const FVARIDVFMapTableEntry& Entry = Table.Entries[i];
+				const FVector2D Position(Entry.X, Entry.Y);
+				const int32* FoundIndex = UnionIndices.Find(Position);
+
+				if (!FoundIndex)
+				{
+					FVARIDVFMapTableEntry& UnionEntry = UnionEntries.AddDefaulted_GetRef();
+					UnionEntry.X = Entry.X;
+					UnionEntry.Y = Entry.Y;
+					UnionEntry.ChannelMask = Entry.ChannelMask;
+					UnionIndices.Add(Position, UnionEntries.Num() - 1);
+				}
+				else
+				{
+					UnionEntries[*FoundIndex].ChannelMask |= Entry.ChannelMask;
+				}
+			}
+		}
+
+		for (int32 Keyframe = 0; Keyframe < OutTables.Num(); ++Keyframe)
+		{
+			FVARIDVFMapPointTable& Table = OutTables[Keyframe];
+			const int32 FirstEntry = Entries[Keyframe].Num();
+			Entries[Keyframe].Append(UnionEntries);
+
+			for (int32 i = Table.EyeEntryRange[EyeIndex * 2]; i < Table.EyeEntryRange[EyeIndex * 2] + Table.EyeEntryRange[EyeIndex * 2 + 1]; ++i)
+			{
+				const FVARIDVFMapTableEntry& Entry = Table.Entries[i];
+				FVARIDVFMapTableEntry& UnionEntry = Entries[Keyframe][FirstEntry + UnionIndices[FVector2D(Entry.X, Entry.Y)]];
+
+				for (int32 Channel = 0; Channel < EVARIDVFMapChannel::Num; ++Channel)
+				{
+					UnionEntry.Values[Channel] = Entry.Values[Channel];
+				}
+			}
+		}
+
+		// every table has the same ranges, so the ranges of the first can be worked out from where it is now
+		for (FVARIDVFMapPointTable& Table : OutTables)
+		{
+			Table.EyeEntryRange[EyeIndex * 2] = Entries[0].Num() - UnionEntries.Num();
+			Table.EyeEntryRange[EyeIndex * 2 + 1] = UnionEntries.Num();
+		}
+	}
+
+	for (int32 Keyframe = 0; Keyframe < OutTables.Num(); ++Keyframe)
+	{
+		OutTables[Keyframe].Entries = MoveTemp(Entries[Keyframe]);
+	}
+}
+
+void FVARIDProfileProgression::BlendKeyframeTables(const FVARIDVFMapPointTable& InTable0, const FVARIDVFMapPointTable& InTable1, float InAlpha, const FVector2D InGazeOffsets[2], FVARIDVFMapPointTable& OutTable)
+{
+	check(InTable0.Entries.Num() == InTable1.Entries.Num());
+
+	OutTable = InTable0;
+
+	for (int32 i = 0; i < OutTable.Entries.Num(); ++i)
+	{
+		const bool bRightEye = i >= InTable0.EyeEntryRange[2] && i < InTable0.EyeEntryRange[2] + InTable0.EyeEntryRange[3];
+		FVARIDVFMapTableEntry& Entry = OutTable.Entries[i];
+
+		Entry.X += InGazeOffsets[bRightEye ? 1 : 0].X;
+		Entry.Y += InGazeOffsets[bRightEye ? 1 : 0].Y;
+
+		for (int32 Channel = 0; Channel < EVARIDVFMapChannel::Num; ++Channel)
+		{
+			Entry.Values[Channel] = FMath::Lerp(InTable0.Entries[i].Values[Channel], InTable1.Entries[i].Values[Channel], InAlpha);
+		}
+	}
+
+	BlendOriginOffsets(InTable0, InTable1, InAlpha, OutTable.OriginOffsets);
+}
+
+void FVARIDProfileProgression::BlendOriginOffsets(const FVARIDVFMapPointTable& InTable0, const FVARIDVFMapPointTable& InTable1, float InAlpha, FVector2D OutOriginOffsets[EVARIDVFMapChannel::Num])
+{
+	for (int32 Channel = 0; Channel < EVARIDVFMapChannel::Num; ++Channel)
+	{
+		OutOriginOffsets[Channel] = FVector2D(
+			FMath::Lerp(InTable0.OriginOffsets[Channel].X, InTable1.OriginOffsets[Channel].X, InAlpha),
+			FMath::Lerp(InTable0.OriginOffsets[Channel].Y, InTable1.OriginOffsets[Channel].Y, InAlpha));
+	}
+}
+
+FVector2D FVARIDProfileProgression::GetGazeOffset(const FVARIDProgressionTableEye& InEye, const FVector2D& InGazePoint)
+{
+	// the same transform as FVARIDVFMapPointTable::AddVFMap(), less the part without the gaze
+	return FVector2D(InGazePoint.X * InEye.XScale, InGazePoint.Y);
+}
@@ -0,0 +1,451 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "Math/RandomStream.h"
+#include "HAL/PlatformTime.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// FVARIDProfileProgression blending keyframe profiles over time. The keyframe point tables are uploaded once and blended on the GPU, so the
+// blend has to give the VF maps a table of the evaluated profile would
+
+/** the map of a channel of InEye, nullptr where the FX is off or the level is missing */
+static const FVARIDVFMap* GetProgressionVFMap(const FVARIDEye& InEye, int32 InChannel)
+{
+	switch (InChannel)
+	{
+	case EVARIDVFMapChannel::Blur: return InEye.Blur.Enabled ? &InEye.Blur.VFMap : nullptr;
+	case EVARIDVFMapChannel::Inpaint: return InEye.Inpaint.Enabled ? &InEye.Inpaint.VFMap : nullptr;
+	case EVARIDVFMapChannel::Warp: return InEye.Warp.Enabled ? &InEye.Warp.VFMap : nullptr;
+	default: return InEye.Contrast.Enabled && InEye.Contrast.VFMaps.IsValidIndex(InChannel - EVARIDVFMapChannel::Contrast0) ? &InEye.Contrast.VFMaps[InChannel - EVARIDVFMapChannel::Contrast0] : nullptr;
+	}
+}
+
+/** a channel of InEye at InPosition before the clamp: the origin offset where there is no map, the value of a full field map, or the origin offset plus the RBF sum */
+static float EvaluateProgressionField(const FVARIDEye& InEye, int32 InChannel, const FVector2D& InPosition)
+{
+	const FVARIDVFMap* VFMap = GetProgressionVFMap(InEye, InChannel);
+	const float OriginOffset = InChannel == EVARIDVFMapChannel::Warp ? 0.5f : 0.0f;
+
+	if (!VFMap)
+	{
+		return OriginOffset;
+	}
+
+	if (VFMap->FullField && VFMap->Points.Num() == 1)
+	{
+		return VFMap->Points.GetValue(0);
+	}
+
+	TArray<FVARIDVFMapPoint> Points;
+	VFMap->Points.GetPoints(Points);
+	return OriginOffset + FVARIDReference::EvaluateHeightUnclamped(Points, InPosition);
+}
+
+bool FVARIDReference::ValidateProfileProgression(FString& OutReport)
+{
+	const FVector2D FOV(100.0f, 100.0f);
+	const uint8 MaxNumMips = 10;	// must match MAX_NUM_MIP_LEVELS
+	const FVector2D GradientStep(0.002f, 0.002f);	// default of r.VARID.Warp.GradientStep
+	const float Tolerance = 1e-5f;
+
+	/*************************************************************/
+	// Create() and GetSegment()
+
+	FVARIDProfile ValidProfile;
+	ValidProfile.IsValid = true;
+	FVARIDProfile InvalidProfile;
+	InvalidProfile.IsValid = false;
+
+	{
+		FVARIDProfileProgression Rejected;
+		const TArray<float> NoTimes;
+		const TArray<float> DescendingTimes = { 0.0f, 2.0f, 1.0f };
+		const TArray<float> TooFewTimes = { 0.0f, 1.0f };
+
+		if (FVARIDProfileProgression::Create(TArray<FVARIDProfile>(), NoTimes, Rejected)
+			|| FVARIDProfileProgression::Create({ ValidProfile, InvalidProfile }, NoTimes, Rejected)
+			|| FVARIDProfileProgression::Create({ ValidProfile, ValidProfile, ValidProfile }, DescendingTimes, Rejected)
+			|| FVARIDProfileProgression::Create({ ValidProfile, ValidProfile, ValidProfile }, TooFewTimes, Rejected))
+		{
+			OutReport = TEXT("VARID: Profile progression FAILED. Create() took no keyframes, an invalid keyframe, times out of order or the wrong number of times");
+			return false;
+		}
+
+		FVARIDProfileProgression Single;
+		int32 Keyframe0 = -1;
+		int32 Keyframe1 = -1;
+		float Alpha = -1.0f;
+
+		if (!FVARIDProfileProgression::Create({ ValidProfile }, NoTimes, Single))
+		{
+			OutReport = TEXT("VARID: Profile progression FAILED. Create() turned down a single keyframe");
+			return false;
+		}
+
+		Single.GetSegment(0.7f, Keyframe0, Keyframe1, Alpha);
+		if (Keyframe0 != 0 || Keyframe1 != 0 || Alpha != 0.0f)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Profile progression FAILED. A single keyframe gave the segment %d - %d at %f"), Keyframe0, Keyframe1, Alpha);
+			return false;
+		}
+	}
+
+	/*************************************************************/
+	// three keyframes: points that come and go, an FX turned on and off, a full field level, and a level only the later keyframes have
+
+	FRandomStream RandomStream(4141);
+
+	auto AddRandomPoints = [&RandomStream](FVARIDVFMap& InOutVFMap, int32 InNumPoints)
+	{
+		TArray<FVARIDVFMapPoint> Points;
+		InOutVFMap.Points.GetPoints(Points);
+
+		for (int32 i = 0; i < InNumPoints; ++i)
+		{
+			Points.Add(FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand()));
+		}
+
+		InOutVFMap.Points.SetPoints(Points);
+		InOutVFMap.ExpectedNumDataPoints = InOutVFMap.Points.Num();
+	};
+
+	auto MakeFullField = [](float InValue)
+	{
+		FVARIDVFMap VFMap;
+		VFMap.FullField = true;
+		VFMap.Points.SetPoints({ FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.5f, 0.5f, InValue) });
+		return VFMap;
+	};
+
+	TArray<FVARIDProfile> Keyframes;
+	Keyframes.SetNum(3);
+	const TCHAR* KeyframeNames[3] = { TEXT("Early"), TEXT("Moderate"), TEXT("Advanced") };
+
+	for (int32 Keyframe = 0; Keyframe < 3; ++Keyframe)
+	{
+		FVARIDProfile& Profile = Keyframes[Keyframe];
+		Profile.Name = KeyframeNames[Keyframe];
+		Profile.IsValid = true;
+
+		FVARIDEye& Eye = Profile.LeftEye;
+		const int32 Seed = 410 + Keyframe * 10;
+
+		// 24-2 on the first two, points of its own on the last
+		Eye.Blur.Enabled = true;
+		if (Keyframe < 2)
+		{
+			BuildVFMap242(FOV, Seed, Eye.Blur.VFMap);
+		}
+		if (Keyframe > 0)
+		{
+			AddRandomPoints(Eye.Blur.VFMap, 16);
+		}
+
+		Eye.Inpaint.Enabled = Keyframe > 0;
+		BuildVFMap242(FOV, Seed + 1, Eye.Inpaint.VFMap);
+
+		Eye.Warp.Enabled = Keyframe < 2;
+		BuildVFMap242(FOV, Seed + 2, Eye.Warp.VFMap);
+
+		Eye.Contrast.Enabled = true;
+		Eye.Contrast.VFMaps.SetNum(Keyframe == 0 ? 2 : 3);
+		BuildVFMap242(FOV, Seed + 3, Eye.Contrast.VFMaps[0]);
+		Eye.Contrast.VFMaps[1] = MakeFullField(0.1f + 0.25f * Keyframe);
+		if (Keyframe > 0)
+		{
+			BuildVFMap242(FOV, Seed + 4, Eye.Contrast.VFMaps[2]);
+		}
+
+		// the right eye loses its blur, and its warp is there from the start
+		Profile.RightEye = Profile.LeftEye;
+		Profile.RightEye.Blur.Enabled = Keyframe == 0;
+		Profile.RightEye.Warp.Enabled = true;
+		BuildVFMap242(FOV, Seed + 5, Profile.RightEye.Warp.VFMap);
+	}
+
+	FVARIDProfileProgression Progression;
+	const TArray<float> Times = { 0.0f, 1.0f, 3.0f };
+
+	if (!FVARIDProfileProgression::Create(Keyframes, Times, Progression))
+	{
+		OutReport = TEXT("VARID: Profile progression FAILED. Create() turned down valid keyframes");
+		return false;
+	}
+
+	struct FSegmentCase
+	{
+		float Time;
+		int32 Keyframe0;
+		int32 Keyframe1;
+		float Alpha;
+	};
+	const FSegmentCase SegmentCases[] =
+	{
+		{ -1.0f, 0, 1, 0.0f }, { 0.0f, 0, 1, 0.0f }, { 0.25f, 0, 1, 0.25f }, { 1.0f, 1, 2, 0.0f }, { 2.0f, 1, 2, 0.5f }, { 3.0f, 1, 2, 1.0f }, { 5.0f, 1, 2, 1.0f }
+	};
+
+	for (const FSegmentCase& Case : SegmentCases)
+	{
+		int32 Keyframe0 = -1;
+		int32 Keyframe1 = -1;
+		float Alpha = -1.0f;
+		Progression.GetSegment(Case.Time, Keyframe0, Keyframe1, Alpha);
+
+		if (Keyframe0 != Case.Keyframe0 || Keyframe1 != Case.Keyframe1 || FMath::Abs(Alpha - Case.Alpha) > 1e-6f)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Profile progression FAILED. At %f the segment is %d - %d at %f, not %d - %d at %f"), Case.Time, Keyframe0, Keyframe1, Alpha, Case.Keyframe0, Case.Keyframe1, Case.Alpha);
+			return false;
+		}
+	}
+
+	/*************************************************************/
+	// Evaluate(): every channel of both eyes is the blend of the keyframes' fields, and the mesh is the one the blended points would build
+
+	const float EvaluateTimes[] = { -1.0f, 0.0f, 0.3f, 1.0f, 1.5f, 2.2f, 3.0f, 4.0f };
+	const int32 NumChannels = EVARIDVFMapChannel::Contrast0 + 3;
+	float MaxFieldError = 0.0f;
+	float MaxMeshError = 0.0f;
+
+	for (float Time : EvaluateTimes)
+	{
+		int32 Keyframe0 = 0;
+		int32 Keyframe1 = 0;
+		float Alpha = 0.0f;
+		Progression.GetSegment(Time, Keyframe0, Keyframe1, Alpha);
+
+		const FVARIDProfile Profile = Progression.Evaluate(Time);
+
+		for (int32 EyeIndex = 0; EyeIndex < 2; ++EyeIndex)
+		{
+			const FVARIDEye& Eye = EyeIndex == 1 ? Profile.RightEye : Profile.LeftEye;
+			const FVARIDEye& Eye0 = EyeIndex == 1 ? Keyframes[Keyframe0].RightEye : Keyframes[Keyframe0].LeftEye;
+			const FVARIDEye& Eye1 = EyeIndex == 1 ? Keyframes[Keyframe1].RightEye : Keyframes[Keyframe1].LeftEye;
+
+			if (Eye.Blur.Enabled != (Eye0.Blur.Enabled || Eye1.Blur.Enabled) || Eye.Inpaint.Enabled != (Eye0.Inpaint.Enabled || Eye1.Inpaint.Enabled)
+				|| Eye.Warp.Enabled != (Eye0.Warp.Enabled || Eye1.Warp.Enabled))
+			{
+				OutReport = FString::Printf(TEXT("VARID: Profile progression FAILED. At %f eye %d does not have the FX either keyframe has on"), Time, EyeIndex);
+				return false;
+			}
+
+			for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+			{
+				for (int32 Sample = 0; Sample < 32; ++Sample)
+				{
+					const FVector2D Position(RandomStream.FRand(), RandomStream.FRand());
+					const float Expected = FMath::Lerp(EvaluateProgressionField(Eye0, Channel, Position), EvaluateProgressionField(Eye1, Channel, Position), Alpha);
+					const float Actual = EvaluateProgressionField(Eye, Channel, Position);
+					const float Error = FMath::Abs(Actual - Expected);
+					MaxFieldError = FMath::Max(MaxFieldError, Error);
+
+					if (Error > Tolerance)
+					{
+						OutReport = FString::Printf(TEXT("VARID: Profile progression FAILED. At %f channel %d of eye %d is %f at (%f, %f), not the blend of its keyframes %f"), Time, Channel, EyeIndex, Actual, Position.X, Position.Y, Expected);
+						return false;
+					}
+				}
+
+				const FVARIDVFMap* VFMap = GetProgressionVFMap(Eye, Channel);
+				if (!VFMap || VFMap->FullField || VFMap->Points.Num() == 0)
+				{
+					continue;
+				}
+
+				FVARIDVFMap Rebuilt;
+				Rebuilt.Points = VFMap->Points;
+				Rebuilt.ExpectedNumDataPoints = Rebuilt.Points.Num();
+
+				for (int32 Sample = 0; Sample < 32; ++Sample)
+				{
+					const FVector2D Position(RandomStream.FRand(), RandomStream.FRand());
+					float Value = 0.0f;
+					float RebuiltValue = 0.0f;
+
+					if (VFMap->GetMesh()->Evaluate(Position, Value) != Rebuilt.GetMesh()->Evaluate(Position, RebuiltValue) || FMath::Abs(Value - RebuiltValue) > Tolerance)
+					{
+						OutReport = FString::Printf(TEXT("VARID: Profile progression FAILED. At %f the mesh of channel %d of eye %d gives %f at (%f, %f), not %f as built from its points"), Time, Channel, EyeIndex, Value, Position.X, Position.Y, RebuiltValue);
+						return false;
+					}
+
+					MaxMeshError = FMath::Max(MaxMeshError, FMath::Abs(Value - RebuiltValue));
+				}
+			}
+		}
+	}
+
+	/*************************************************************/
+	// maps that switch: a full field against points can't blend, and can't be packed
+
+	{
+		TArray<FVARIDProfile> SwitchKeyframes = { Keyframes[0], Keyframes[1] };
+		SwitchKeyframes[1].LeftEye.Blur.VFMap = MakeFullField(0.7f);
+
+		FVARIDProfileProgression Switching;
+		FVARIDProfileProgression::Create(SwitchKeyframes, TArray<float>(), Switching);
+
+		const FVARIDProfile Before = Switching.Evaluate(0.49f);
+		const FVARIDProfile After = Switching.Evaluate(0.5f);
+
+		if (Switching.CanPackKeyframeTables() || Before.LeftEye.Blur.VFMap.FullField || !After.LeftEye.Blur.VFMap.FullField
+			|| Before.LeftEye.Blur.VFMap.Points.Num() != SwitchKeyframes[0].LeftEye.Blur.VFMap.Points.Num())
+		{
+			OutReport = TEXT("VARID: Profile progression FAILED. A full field map against a map of points did not switch half way, or could still be packed");
+			return false;
+		}
+	}
+
+	/*************************************************************/
+	// the packed keyframe tables, blended as the kernel does, against a table of the evaluated profile
+
+	if (!Progression.CanPackKeyframeTables())
+	{
+		OutReport = TEXT("VARID: Profile progression FAILED. Keyframes that all blend point by point can't be packed");
+		return false;
+	}
+
+	struct FLayout
+	{
+		const TCHAR* Name;
+		EVARIDWorkingTextureMode Mode;
+		FIntPoint SceneExtent;
+		TArray<FIntRect> EyeRects;
+	};
+	FLayout Layouts[2];
+	Layouts[0].Name = TEXT("mono");
+	Layouts[0].Mode = EVARIDWorkingTextureMode::PerEye;
+	Layouts[0].SceneExtent = FIntPoint(320, 240);
+	Layouts[0].EyeRects.Add(FIntRect(0, 0, 320, 240));
+	Layouts[1].Name = TEXT("stereo");
+	Layouts[1].Mode = EVARIDWorkingTextureMode::SinglePassStereo;
+	Layouts[1].SceneExtent = FIntPoint(486, 250);
+	Layouts[1].EyeRects.Add(FIntRect(0, 0, 241, 249));
+	Layouts[1].EyeRects.Add(FIntRect(245, 0, 486, 249));
+
+	const FVector2D GazePoints[2] = { FVector2D(0.02f, -0.01f), FVector2D(-0.03f, 0.015f) };
+	const float TableTimes[] = { 0.3f, 1.0f, 2.2f };
+	float MaxTableError = 0.0f;
+	int32 NumPackedEntries = 0;
+	int32 NumStepEntries = 0;
+
+	for (const FLayout& Layout : Layouts)
+	{
+		const FVARIDWorkingTexturePlan Plan = FVARIDWorkingTexturePlan::Create(Layout.Mode, Layout.SceneExtent, Layout.EyeRects, 0, MaxNumMips);
+		const int32 NumMips = Plan.NumMips;
+
+		TArray<FVARIDProgressionTableEye> TableEyes;
+		for (int32 EyeIndex = 0; EyeIndex < Plan.Eyes.Num(); ++EyeIndex)
+		{
+			TableEyes.Add(FVARIDProgressionTableEye(EyeIndex, Plan.Eyes.Num() > 1 ? 0.5f : 1.0f, Plan.Eyes.Num() > 1 && EyeIndex == 1 ? 0.5f : 0.0f));
+		}
+
+		TArray<FVARIDVFMapPointTable> KeyframeTables;
+		Progression.PackKeyframeTables(TableEyes, NumMips, true, KeyframeTables);
+
+		for (const FVARIDVFMapPointTable& KeyframeTable : KeyframeTables)
+		{
+			if (KeyframeTable.Entries.Num() != KeyframeTables[0].Entries.Num())
+			{
+				OutReport = FString::Printf(TEXT("VARID: Profile progression FAILED. The %s keyframe tables have %d and %d entries"), Layout.Name, KeyframeTable.Entries.Num(), KeyframeTables[0].Entries.Num());
+				return false;
+			}
+		}
+
+		NumPackedEntries = FMath::Max(NumPackedEntries, KeyframeTables.Num() * KeyframeTables[0].Entries.Num());
+
+		for (float Time : TableTimes)
+		{
+			int32 Keyframe0 = 0;
+			int32 Keyframe1 = 0;
+			float Alpha = 0.0f;
+			Progression.GetSegment(Time, Keyframe0, Keyframe1, Alpha);
+
+			FVector2D GazeOffsets[2];
+			for (int32 EyeIndex = 0; EyeIndex < TableEyes.Num(); ++EyeIndex)
+			{
+				GazeOffsets[EyeIndex] = FVARIDProfileProgression::GetGazeOffset(TableEyes[EyeIndex], GazePoints[EyeIndex]);
+			}
+
+			FVARIDVFMapPointTable Blended;
+			FVARIDProfileProgression::BlendKeyframeTables(KeyframeTables[Keyframe0], KeyframeTables[Keyframe1], Alpha, GazeOffsets, Blended);
+
+			const FVARIDProfile Profile = Progression.Evaluate(Time);
+			FVARIDVFMapPointTable Expected;
+			for (int32 EyeIndex = 0; EyeIndex < TableEyes.Num(); ++EyeIndex)
+			{
+				Expected.AddEye(EyeIndex == 1 ? &Profile.RightEye : &Profile.LeftEye, NumMips, true, TableEyes[EyeIndex].XScale, TableEyes[EyeIndex].XOffset, GazePoints[EyeIndex]);
+			}
+
+			NumStepEntries = FMath::Max(NumStepEntries, Expected.Entries.Num());
+
+			FVARIDImage Images[2][3] = { { FVARIDImage(Plan.Extent), FVARIDImage(Plan.Extent), FVARIDImage(Plan.Extent) }, { FVARIDImage(Plan.Extent), FVARIDImage(Plan.Extent), FVARIDImage(Plan.Extent) } };
+			TArray<FVARIDImage> ContrastMips[2];
+			const FVARIDVFMapPointTable* Tables[2] = { &Blended, &Expected };
+
+			for (int32 i = 0; i < 2; ++i)
+			{
+				for (int32 MipLevel = 0; MipLevel < NumMips; ++MipLevel)
+				{
+					ContrastMips[i].Add(FVARIDImage(FIntPoint(FMath::Max(Plan.Extent.X >> MipLevel, 1), FMath::Max(Plan.Extent.Y >> MipLevel, 1))));
+				}
+
+				EvaluatePlanVFMapsCombined(Plan, *Tables[i], NumMips, &GradientStep, Images[i][0], Images[i][1], ContrastMips[i], Images[i][2]);
+			}
+
+			auto CompareImages = [&](const FVARIDImage& InBlended, const FVARIDImage& InExpected, const TCHAR* InName)
+			{
+				for (int32 Y = 0; Y < InExpected.Size.Y; ++Y)
+				{
+					for (int32 X = 0; X < InExpected.Size.X; ++X)
+					{
+						const FVector4 BlendedTexel = InBlended.Load(X, Y);
+						const FVector4 ExpectedTexel = InExpected.Load(X, Y);
+						const float Error = FMath::Max(FMath::Abs(BlendedTexel.X - ExpectedTexel.X), FMath::Abs(BlendedTexel.Y - ExpectedTexel.Y));
+						MaxTableError = FMath::Max(MaxTableError, Error);
+
+						if (Error > Tolerance)
+						{
+							OutReport = FString::Printf(TEXT("VARID: Profile progression FAILED. At %f the %s %s differs by %f at (%d, %d) from a table of the evaluated profile"), Time, Layout.Name, InName, Error, X, Y);
+							return false;
+						}
+					}
+				}
+
+				return true;
+			};
+
+			if (!CompareImages(Images[0][0], Images[1][0], TEXT("blur")) || !CompareImages(Images[0][1], Images[1][1], TEXT("inpaint")) || !CompareImages(Images[0][2], Images[1][2], TEXT("warp")))
+			{
+				return false;
+			}
+
+			for (int32 MipLevel = 0; MipLevel < NumMips; ++MipLevel)
+			{
+				if (!CompareImages(ContrastMips[0][MipLevel], ContrastMips[1][MipLevel], *FString::Printf(TEXT("contrast mip %d"), MipLevel)))
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	// what a step costs on the CPU: the blend of Evaluate(), against a table upload the kernel no longer needs
+	const int32 NumEvaluations = 200;
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumEvaluations; ++i)
+	{
+		Progression.Evaluate(3.0f * i / NumEvaluations);
+	}
+	const double EvaluateMicroseconds = (FPlatformTime::Seconds() - StartTime) * 1e6 / NumEvaluations;
+
+	const int32 EntryBytes = sizeof(FVARIDVFMapTableEntry);
+	OutReport = FString::Printf(TEXT("VARID: Profile progression OK. %d keyframes blend to within %g of their fields (mesh %g) and the blended keyframe tables to within %g of a table per step. ")
+		TEXT("%d bytes of tables uploaded once, against %d bytes a step. Evaluate() takes %.1f us"),
+		Keyframes.Num(), MaxFieldError, MaxMeshError, MaxTableError, NumPackedEntries * EntryBytes, NumStepEntries * EntryBytes, EvaluateMicroseconds);
+	return true;
+}
+
+#endif
@@ -0,0 +1,39 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDPyramidLayout.h"
+
+FIntRect FVARIDPyramidLayout::GetMipViewportRect(const FIntRect& InViewportRect, int32 InMipLevel)
+{
+	const FIntPoint Min(InViewportRect.Min.X >> InMipLevel, InViewportRect.Min.Y >> InMipLevel);
+	const FIntPoint Size(FMath::Max(InViewportRect.Width() >> InMipLevel, 1), FMath::Max(InViewportRect.Height() >> InMipLevel, 1));
+	return FIntRect(Min, Min + Size);
+}
+
+int32 FVARIDPyramidLayout::GetGaussianPyramidNumStages(int32 InNumMips)
+{
+	return FMath::Max(InNumMips / 2, 1);
+}
+
+FIntPoint FVARIDPyramidLayout::GetGaussianPyramidTileCount(const FIntRect& InViewportRect, int32 InStage)
+{
+	// tiles are aligned to texels of their output level, so the first can start up to 3 input texels before the viewport
+	const int32 TileSize = 32;
+	const FIntRect InputRect = GetMipViewportRect(InViewportRect, InStage * 2);
+	const FIntPoint Covered = InputRect.Max - GetMipViewportRect(InViewportRect, InStage * 2 + 2).Min * 4;
+	return FIntPoint((Covered.X + TileSize - 1) / TileSize, (Covered.Y + TileSize - 1) / TileSize);
+}
+
+int32 FVARIDPyramidLayout::GetGaussianPyramidNumTileCounters(const FIntRect& InViewportRect, int32 InNumMips)
+{
+	int32 NumTileCounters = 0;
+	for (int32 Stage = 1; Stage < GetGaussianPyramidNumStages(InNumMips); ++Stage)
+	{
+		const FIntPoint NumTiles = GetGaussianPyramidTileCount(InViewportRect, Stage);
+		NumTileCounters += NumTiles.X * NumTiles.Y;
+	}
+
+	return FMath::Max(NumTileCounters, 1);
+}
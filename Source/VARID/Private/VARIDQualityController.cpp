@@ -0,0 +1,186 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDQualityController.h"
+
+/** how much of each new timing goes into the average */
+static const float AVERAGE_WEIGHT = 0.25f;
+
+/** a timing counts at most this many budgets, so one hitch - a shader compile, a page fault - can't step the level down on its own */
+static const float MAX_TIMING_BUDGETS = 2.0f;
+
+/** a step up undone within FramesToStepUp frames of it makes the next wait this many times longer, up to MAX_STEP_UP_BACKOFF */
+static const int32 STEP_UP_BACKOFF_FACTOR = 2;
+static const int32 MAX_STEP_UP_BACKOFF = 16;
+
+FVARIDQualitySettings::FVARIDQualitySettings()
+	: MaxNumMips(10)	// must match MAX_NUM_MIP_LEVELS
+	, InpaintPasses(16)
+	, VFMapMaxError(0.0f)
+	, ContrastThreshold(0.0f)
+{
+
+}
+
+FVARIDQualitySettings::FVARIDQualitySettings(uint8 InMaxNumMips, int32 InInpaintPasses, float InVFMapMaxError, float InContrastThreshold)
+	: MaxNumMips(InMaxNumMips)
+	, InpaintPasses(InInpaintPasses)
+	, VFMapMaxError(InVFMapMaxError)
+	, ContrastThreshold(InContrastThreshold)
+{
+
+}
+
+const int32 FVARIDQualitySettings::NumLevels;
+
+FVARIDQualitySettings FVARIDQualitySettings::GetLevel(int32 InLevel)
+{
+	// the cheapest knobs go first. the pyramid keeps at least 5 levels, as the inpainter works at mip 3
+	static const FVARIDQualitySettings Levels[] =
+	{
+		FVARIDQualitySettings(10, 16, 0.0f, 0.0f),
+		FVARIDQualitySettings(10, 12, 0.0f, 1.0f / 2048.0f),
+		FVARIDQualitySettings(10, 12, 1.0f / 512.0f, 1.0f / 1024.0f),
+		FVARIDQualitySettings(8, 8, 1.0f / 256.0f, 1.0f / 512.0f),
+		FVARIDQualitySettings(7, 8, 1.0f / 128.0f, 1.0f / 256.0f),
+		FVARIDQualitySettings(6, 4, 1.0f / 64.0f, 1.0f / 128.0f)
+	};
+	static_assert(UE_ARRAY_COUNT(Levels) == NumLevels, "NumLevels must match the table");
+
+	return Levels[FMath::Clamp(InLevel, 0, NumLevels - 1)];
+}
+
+int32 FVARIDQualitySettings::GetBestLevelForQuality(int32 InQuality)
+{
+	// low, medium, high, epic
+	static const int32 BestLevels[4] = { 5, 3, 1, 0 };
+	return BestLevels[FMath::Clamp(InQuality, 0, 3)];
+}
+
+FVARIDQualityControllerSettings::FVARIDQualityControllerSettings()
+	: BudgetMs(3.0f)
+	, OverFraction(1.0f)
+	, UnderFraction(0.6f)
+	, FramesToStepDown(4)
+	, FramesToStepUp(60)
+	, SettleFrames(5)
+	, BestLevel(0)
+	, WorstLevel(FVARIDQualitySettings::NumLevels - 1)
+{
+
+}
+
+FVARIDQualityController::FVARIDQualityController()
+{
+	Reset(0);
+}
+
+void FVARIDQualityController::Reset(int32 InLevel)
+{
+	Level = InLevel;
+	AverageMs = 0.0f;
+	bHasAverage = false;
+	FramesOver = 0;
+	FramesUnder = 0;
+	FramesToSettle = 0;
+	FramesSinceStepUp = MAX_int32;
+	StepUpBackoff = 1;
+	NumStepsDown = 0;
+	NumStepsUp = 0;
+}
+
+bool FVARIDQualityController::Update(float InMilliseconds, const FVARIDQualityControllerSettings& InSettings)
+{
+	const int32 WorstLevel = FMath::Max(InSettings.BestLevel, InSettings.WorstLevel);
+
+	// the range moved, e.g. the scalability group changed. no waiting for timings to move into it
+	const int32 ClampedLevel = FMath::Clamp(Level, InSettings.BestLevel, WorstLevel);
+	if (ClampedLevel != Level)
+	{
+		Step(ClampedLevel, InSettings);
+		return true;
+	}
+
+	FramesSinceStepUp = FramesSinceStepUp < MAX_int32 ? FramesSinceStepUp + 1 : FramesSinceStepUp;
+
+	if (FramesToSettle > 0)
+	{
+		--FramesToSettle;
+		return false;
+	}
+
+	const float Milliseconds = FMath::Min(InMilliseconds, InSettings.BudgetMs * MAX_TIMING_BUDGETS);
+	AverageMs = bHasAverage ? FMath::Lerp(AverageMs, Milliseconds, AVERAGE_WEIGHT) : Milliseconds;
+	bHasAverage = true;
+
+	// between the two bands both runs start over, which is the hysteresis
+	if (AverageMs > InSettings.BudgetMs * InSettings.OverFraction)
+	{
+		++FramesOver;
+		FramesUnder = 0;
+	}
+	else if (AverageMs < InSettings.BudgetMs * InSettings.UnderFraction)
+	{
+		++FramesUnder;
+		FramesOver = 0;
+	}
+	else
+	{
+		FramesOver = 0;
+		FramesUnder = 0;
+	}
+
+	if (FramesOver >= InSettings.FramesToStepDown && Level < WorstLevel)
+	{
+		// the level above didn't fit after all. try it less often. a step down long after is the load changing, which is worth trying again for
+		const bool bUndoesStepUp = FramesSinceStepUp <= InSettings.FramesToStepUp;
+		StepUpBackoff = bUndoesStepUp ? FMath::Min(StepUpBackoff * STEP_UP_BACKOFF_FACTOR, MAX_STEP_UP_BACKOFF) : 1;
+
+		++NumStepsDown;
+		Step(Level + 1, InSettings);
+		return true;
+	}
+
+	if (FramesUnder >= InSettings.FramesToStepUp * StepUpBackoff && Level > InSettings.BestLevel)
+	{
+		++NumStepsUp;
+		Step(Level - 1, InSettings);
+		FramesSinceStepUp = 0;
+		return true;
+	}
+
+	return false;
+}
+
+void FVARIDQualityController::Step(int32 InLevel, const FVARIDQualityControllerSettings& InSettings)
+{
+	// the average of the old level says nothing of the new one
+	Level = InLevel;
+	AverageMs = 0.0f;
+	bHasAverage = false;
+	FramesOver = 0;
+	FramesUnder = 0;
+	FramesToSettle = InSettings.SettleFrames;
+}
+
+int32 FVARIDQualityController::GetLevel() const
+{
+	return Level;
+}
+
+float FVARIDQualityController::GetAverageMs() const
+{
+	return AverageMs;
+}
+
+int32 FVARIDQualityController::GetNumStepsDown() const
+{
+	return NumStepsDown;
+}
+
+int32 FVARIDQualityController::GetNumStepsUp() const
+{
+	return NumStepsUp;
+}
@@ -0,0 +1,248 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "VARIDQualityController.h"
+#include "Math/RandomStream.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// FVARIDQualityController driven by simulated frame times. It must settle rather than oscillate between levels, and a single hitch must
+// not cost a level
+
+/**
+ * runs InOutController over InNumFrames simulated frames. Frame F takes InLevelMs[level] * InLoad(F) GPU milliseconds, give or take InNoise of that, and its
+ * timing reaches the controller InLatencyFrames later, as the render thread reads timestamps back. Appends the level of every frame to OutLevels, and
+ * returns the number of frames that went over the budget
+ */
+static int32 SimulateQualityController(FVARIDQualityController& InOutController, const FVARIDQualityControllerSettings& InSettings, const float* InLevelMs, TFunctionRef<float(int32)> InLoad, int32 InNumFrames, int32 InLatencyFrames, float InNoise, FRandomStream& InOutRandomStream, TArray<int32>& OutLevels)
+{
+	TArray<float> InFlightMs;
+	int32 NumFramesOver = 0;
+
+	for (int32 Frame = 0; Frame < InNumFrames; ++Frame)
+	{
+		if (InFlightMs.Num() >= InLatencyFrames)
+		{
+			InOutController.Update(InFlightMs[0], InSettings);
+			InFlightMs.RemoveAt(0);
+		}
+
+		const int32 Level = InOutController.GetLevel();
+		const float Milliseconds = InLevelMs[Level] * InLoad(Frame) * (1.0f + InOutRandomStream.FRandRange(-InNoise, InNoise));
+
+		NumFramesOver += Milliseconds > InSettings.BudgetMs ? 1 : 0;
+		OutLevels.Add(Level);
+		InFlightMs.Add(Milliseconds);
+	}
+
+	return NumFramesOver;
+}
+
+/** the number of times the level changes in InLevels from InFirstFrame on */
+static int32 CountLevelChanges(const TArray<int32>& InLevels, int32 InFirstFrame)
+{
+	int32 NumChanges = 0;
+	for (int32 Frame = FMath::Max(InFirstFrame, 1); Frame < InLevels.Num(); ++Frame)
+	{
+		NumChanges += InLevels[Frame] != InLevels[Frame - 1] ? 1 : 0;
+	}
+
+	return NumChanges;
+}
+
+bool FVARIDReference::ValidateQualityController(FString& OutReport)
+{
+	FRandomStream RandomStream(4848);
+
+	FVARIDQualityControllerSettings Settings;
+	Settings.BudgetMs = 3.0f;
+
+	const int32 LatencyFrames = 3;
+	const float Noise = 0.1f;
+
+	// GPU milliseconds of each level at a load of 1. Each level is a little cheaper than the one above
+	const float LevelMs[FVARIDQualitySettings::NumLevels] = { 4.0f, 3.4f, 2.8f, 2.2f, 1.8f, 1.3f };
+
+	/*************************************************************/
+	// the levels: level 0 leaves every knob alone, and each level after is no better than the one before
+
+	const FVARIDQualitySettings Best = FVARIDQualitySettings::GetLevel(0);
+	const FVARIDQualitySettings Default;
+	if (Best.MaxNumMips != Default.MaxNumMips || Best.InpaintPasses != Default.InpaintPasses || Best.VFMapMaxError != 0.0f || Best.ContrastThreshold != 0.0f)
+	{
+		OutReport = TEXT("VARID: Quality controller FAILED. Level 0 turns a knob down");
+		return false;
+	}
+
+	for (int32 Level = 1; Level < FVARIDQualitySettings::NumLevels; ++Level)
+	{
+		const FVARIDQualitySettings Above = FVARIDQualitySettings::GetLevel(Level - 1);
+		const FVARIDQualitySettings Below = FVARIDQualitySettings::GetLevel(Level);
+
+		const bool bNoBetter = Below.MaxNumMips <= Above.MaxNumMips && Below.InpaintPasses <= Above.InpaintPasses
+			&& Below.VFMapMaxError >= Above.VFMapMaxError && Below.ContrastThreshold >= Above.ContrastThreshold;
+		const bool bCheaper = Below.MaxNumMips < Above.MaxNumMips || Below.InpaintPasses < Above.InpaintPasses
+			|| Below.VFMapMaxError > Above.VFMapMaxError || Below.ContrastThreshold > Above.ContrastThreshold;
+
+		// the inpainter works at mip 3 and runs 4 fill passes a tiled dispatch
+		if (!bNoBetter || !bCheaper || Below.MaxNumMips < 4 || Below.InpaintPasses <= 0 || Below.InpaintPasses % 4 != 0)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Quality controller FAILED. Level %d isn't a step down from level %d the renderer can take"), Level, Level - 1);
+			return false;
+		}
+	}
+
+	if (FVARIDQualitySettings::GetBestLevelForQuality(3) != 0 || FVARIDQualitySettings::GetBestLevelForQuality(4) != 0 || FVARIDQualitySettings::GetBestLevelForQuality(0) != FVARIDQualitySettings::NumLevels - 1)
+	{
+		OutReport = TEXT("VARID: Quality controller FAILED. Epic and cinematic quality don't allow level 0, or low quality the cheapest level");
+		return false;
+	}
+
+	/*************************************************************/
+	// under budget: stays at level 0
+
+	{
+		FVARIDQualityController Controller;
+		TArray<int32> Levels;
+		SimulateQualityController(Controller, Settings, LevelMs, [](int32) { return 0.4f; }, 2000, LatencyFrames, Noise, RandomStream, Levels);
+
+		if (CountLevelChanges(Levels, 0) != 0 || Controller.GetLevel() != 0)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Quality controller FAILED. Well under budget it left level 0 %d times"), CountLevelChanges(Levels, 0));
+			return false;
+		}
+	}
+
+	/*************************************************************/
+	// over budget: steps down to the best level that fits, level 2, and holds it in spite of the noise
+
+	int32 SettleFrames = 0;
+	const int32 NumHeldFrames = 5000;
+
+	{
+		FVARIDQualityController Controller;
+		TArray<int32> Levels;
+		SimulateQualityController(Controller, Settings, LevelMs, [](int32) { return 1.0f; }, 200 + NumHeldFrames, LatencyFrames, Noise, RandomStream, Levels);
+
+		SettleFrames = Levels.IndexOfByKey(2);
+		const int32 NumLaterChanges = CountLevelChanges(Levels, 200);
+
+		if (SettleFrames == INDEX_NONE || SettleFrames > 60 || Levels.Last() != 2 || NumLaterChanges != 0)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Quality controller FAILED. Over budget it reached level 2 on frame %d, then changed level %d times and ended on level %d"),
+				SettleFrames, NumLaterChanges, Levels.Last());
+			return false;
+		}
+	}
+
+	/*************************************************************/
+	// a level that only just doesn't fit above one well under the budget: tried again, but less and less often
+
+	const int32 NumRetryFrames = 6000;
+	int32 NumRetries = 0;
+	float RetryOverPercent = 0.0f;
+
+	{
+		const float SteepLevelMs[FVARIDQualitySettings::NumLevels] = { 6.0f, 5.5f, 5.0f, 4.0f, 3.5f, 1.5f };
+
+		FVARIDQualityController Controller;
+		TArray<int32> Levels;
+		const int32 NumFramesOver = SimulateQualityController(Controller, Settings, SteepLevelMs, [](int32) { return 1.0f; }, NumRetryFrames, LatencyFrames, Noise, RandomStream, Levels);
+
+		NumRetries = Controller.GetNumStepsUp();
+		RetryOverPercent = 100.0f * NumFramesOver / NumRetryFrames;
+
+		// waits of 60, 120, 240, 480, then 960 frames at most
+		int32 MaxRetries = 0;
+		for (int32 Frames = 0, Wait = Settings.FramesToStepUp; Frames < NumRetryFrames; Frames += Wait, Wait = FMath::Min(Wait * 2, Settings.FramesToStepUp * 16))
+		{
+			++MaxRetries;
+		}
+
+		if (NumRetries < 2 || NumRetries > MaxRetries || RetryOverPercent > 5.0f || Levels.Last() != FVARIDQualitySettings::NumLevels - 1)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Quality controller FAILED. A level that doesn't fit was retried %d times in %d frames, at most %d expected, with %.1f%% of frames over budget"),
+				NumRetries, NumRetryFrames, MaxRetries, RetryOverPercent);
+			return false;
+		}
+	}
+
+	/*************************************************************/
+	// a hitch doesn't step down, and a load that drops is followed back up to level 0
+
+	int32 ClimbFrames = 0;
+
+	{
+		FVARIDQualityController Controller;
+		TArray<int32> Levels;
+		SimulateQualityController(Controller, Settings, LevelMs, [](int32 Frame) { return Frame == 100 ? 20.0f : 0.4f; }, 300, LatencyFrames, Noise, RandomStream, Levels);
+
+		if (CountLevelChanges(Levels, 0) != 0)
+		{
+			OutReport = TEXT("VARID: Quality controller FAILED. A single frame of 80 ms stepped the level down");
+			return false;
+		}
+
+		Levels.Reset();
+		SimulateQualityController(Controller, Settings, LevelMs, [](int32 Frame) { return Frame < 600 ? 1.0f : 0.4f; }, 1200, LatencyFrames, Noise, RandomStream, Levels);
+
+		ClimbFrames = INDEX_NONE;
+		for (int32 Frame = 600; Frame < Levels.Num() && ClimbFrames == INDEX_NONE; ++Frame)
+		{
+			ClimbFrames = Levels[Frame] == 0 ? Frame : INDEX_NONE;
+		}
+
+		if (Levels[599] != 2 || ClimbFrames == INDEX_NONE || Levels.Last() != 0 || CountLevelChanges(Levels, ClimbFrames + 1) != 0)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Quality controller FAILED. When the load dropped it was on level %d, and got back to level 0 on frame %d, ending on level %d"),
+				Levels[599], ClimbFrames, Levels.Last());
+			return false;
+		}
+
+		ClimbFrames -= 600;
+	}
+
+	/*************************************************************/
+	// the range: moved into at once, and never left however far over or under budget
+
+	{
+		FVARIDQualityControllerSettings RangeSettings = Settings;
+		RangeSettings.BestLevel = FVARIDQualitySettings::GetBestLevelForQuality(2);
+		RangeSettings.WorstLevel = FVARIDQualitySettings::GetBestLevelForQuality(1);
+
+		FVARIDQualityController Controller;
+		if (!Controller.Update(1.0f, RangeSettings) || Controller.GetLevel() != RangeSettings.BestLevel)
+		{
+			OutReport = TEXT("VARID: Quality controller FAILED. A controller outside its range didn't move into it at once");
+			return false;
+		}
+
+		TArray<int32> Levels;
+		SimulateQualityController(Controller, RangeSettings, LevelMs, [](int32 Frame) { return Frame < 500 ? 10.0f : 0.1f; }, 1500, LatencyFrames, Noise, RandomStream, Levels);
+
+		for (int32 Frame = 0; Frame < Levels.Num(); ++Frame)
+		{
+			if (Levels[Frame] < RangeSettings.BestLevel || Levels[Frame] > RangeSettings.WorstLevel)
+			{
+				OutReport = FString::Printf(TEXT("VARID: Quality controller FAILED. On frame %d it was on level %d, outside %d..%d"), Frame, Levels[Frame], RangeSettings.BestLevel, RangeSettings.WorstLevel);
+				return false;
+			}
+		}
+
+		if (Levels[499] != RangeSettings.WorstLevel || Levels.Last() != RangeSettings.BestLevel)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Quality controller FAILED. Far over budget it got to level %d and far under it to level %d, expected %d and %d"),
+				Levels[499], Levels.Last(), RangeSettings.WorstLevel, RangeSettings.BestLevel);
+			return false;
+		}
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: Quality controller OK. Over a %.1f ms budget it settled in %d frames and held for %d; a level that doesn't fit was retried %d times in %d frames, %.1f%% of them over budget; a hitch didn't step down; back to level 0 %d frames after the load dropped"),
+		Settings.BudgetMs, SettleFrames, NumHeldFrames, NumRetries, NumRetryFrames, RetryOverPercent, ClimbFrames);
+	return true;
+}
+
+#endif
@@ -0,0 +1,144 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// FVARIDImage and the helpers the stage references share. The references themselves are in VARID<Stage>Reference.cpp
+
+const float FVARIDReference::MaskThreshold = 0.5f;	// must match VARIDCommon.ush
+
+FVARIDImage::FVARIDImage()
+{
+	Size = FIntPoint::ZeroValue;
+}
+
+FVARIDImage::FVARIDImage(const FIntPoint& InSize)
+{
+	Size = InSize;
+	Pixels.SetNumZeroed(InSize.X * InSize.Y);
+}
+
+bool FVARIDImage::IsInside(int32 X, int32 Y) const
+{
+	return X >= 0 && Y >= 0 && X < Size.X && Y < Size.Y;
+}
+
+FVector4 FVARIDImage::Load(int32 X, int32 Y) const
+{
+	return IsInside(X, Y) ? Pixels[Y * Size.X + X] : FVector4(0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+void FVARIDImage::Store(int32 X, int32 Y, const FVector4& Value)
+{
+	if (IsInside(X, Y))
+	{
+		Pixels[Y * Size.X + X] = Value;
+	}
+}
+
+float FVARIDReference::SaturateUNORM(float InValue)
+{
+	return FMath::Clamp(InValue, 0.0f, 1.0f);
+}
+
+float FVARIDReference::QuantiseUNORM16(float InValue)
+{
+	return FMath::RoundToFloat(SaturateUNORM(InValue) * 65535.0f) / 65535.0f;
+}
+
+FIntPoint FVARIDReference::GetTileListGroupCount(int32 InNumEntries)
+{
+	const int32 NumGroupsX = FMath::Min(InNumEntries, TileListMaxGroupsX);
+	return FIntPoint(NumGroupsX, NumGroupsX > 0 ? (InNumEntries + NumGroupsX - 1) / NumGroupsX : 0);
+}
+
+void FVARIDReference::GetDispatchGroupOrigins(const FIntRect& InRect, int32 InGroupSize, const TArray<FIntPoint>* InTileList, TArray<FIntPoint>& OutOrigins)
+{
+	OutOrigins.Reset();
+
+	if (InTileList)
+	{
+		// the groups of the indirect dispatch, flattened as GetTileListEntryIndex() does. Those past the end return, as IsTileListGroupValid() makes them
+		const FIntPoint GroupCount = GetTileListGroupCount(InTileList->Num());
+		for (int32 GroupY = 0; GroupY < GroupCount.Y; ++GroupY)
+		{
+			for (int32 GroupX = 0; GroupX < GroupCount.X; ++GroupX)
+			{
+				const int32 Index = GroupX + GroupY * GroupCount.X;
+				if (Index < InTileList->Num())
+				{
+					OutOrigins.Add(InRect.Min + (*InTileList)[Index] * InGroupSize);
+				}
+			}
+		}
+	}
+	else
+	{
+		for (int32 Y = InRect.Min.Y; Y < InRect.Max.Y; Y += InGroupSize)
+		{
+			for (int32 X = InRect.Min.X; X < InRect.Max.X; X += InGroupSize)
+			{
+				OutOrigins.Add(FIntPoint(X, Y));
+			}
+		}
+	}
+}
+
+bool FVARIDReference::ImagesAreIdentical(const FVARIDImage& A, const FVARIDImage& B, FIntPoint& OutFirstMismatch)
+{
+	if (A.Size != B.Size)
+	{
+		OutFirstMismatch = FIntPoint(-1, -1);
+		return false;
+	}
+
+	for (int32 Y = 0; Y < A.Size.Y; ++Y)
+	{
+		for (int32 X = 0; X < A.Size.X; ++X)
+		{
+			const FVector4 PixelA = A.Load(X, Y);
+			const FVector4 PixelB = B.Load(X, Y);
+
+			if (PixelA.X != PixelB.X || PixelA.Y != PixelB.Y || PixelA.Z != PixelB.Z || PixelA.W != PixelB.W)
+			{
+				OutFirstMismatch = FIntPoint(X, Y);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+FIntPoint FVARIDReference::ClampToRect(const FIntPoint& InPosition, const FIntRect& InRect)
+{
+	return FIntPoint(FMath::Clamp(InPosition.X, InRect.Min.X, InRect.Max.X - 1), FMath::Clamp(InPosition.Y, InRect.Min.Y, InRect.Max.Y - 1));
+}
+
+FVector4 FVARIDReference::RGBOnly(const FVector4& InColour)
+{
+	return FVector4(InColour.X, InColour.Y, InColour.Z, 1.0f);
+}
+
+void FVARIDReference::AllocateMips(const FIntPoint& InExtent, int32 InNumMips, TArray<FVARIDImage>& OutMips)
+{
+	OutMips.Reset();
+	for (int32 MipLevel = 0; MipLevel < InNumMips; ++MipLevel)
+	{
+		OutMips.Add(FVARIDImage(FIntPoint(FMath::Max(InExtent.X >> MipLevel, 1), FMath::Max(InExtent.Y >> MipLevel, 1))));
+	}
+}
+
+FVector4 FVARIDReference::SampleBilinearClamped(const FVARIDImage& InImage, const FVector2D& InUV)
+{
+	return BilinearFilter(InImage.Size, InUV, [&InImage](int32 InX, int32 InY)
+	{
+		return InImage.Load(FMath::Clamp(InX, 0, InImage.Size.X - 1), FMath::Clamp(InY, 0, InImage.Size.Y - 1));
+	});
+}
+
+#endif
@@ -6,6 +6,15 @@
 #include "VARIDRendering.h"
 #include "VARIDProfile.h"
 #include "VARIDModule.h"
+#include "VARIDPyramidLayout.h"
+#include "VARIDWorkingTexturePlan.h"
+#include "VARIDVFMapResolution.h"
+#include "VARIDVFMapPointTable.h"
+#include "VARIDTraceRecorder.h"
+#include "VARIDFrameSource.h"
+#include "VARIDPipelineWarmup.h"
+#include "VARIDQualityController.h"
+#include "VARIDOutputCapture.h"
 
 #include "CoreMinimal.h"
 #include "EngineMinimal.h"
@@ -17,6 +26,7 @@
 #include "Modules/ModuleManager.h"
 #include "Runtime/Launch/Resources/Version.h"
 #include "Containers/Array.h"
+#include "HAL/IConsoleManager.h"
 #include "StereoRendering.h"
 #include "RenderGraph.h"
 #include "RenderGraphResources.h"
@@ -40,24 +50,227 @@
 #include "PixelShaderUtils.h"
 #include "PostProcessMaterial.h"
 #include "Math/UnrealMathUtility.h"
+#include "Misc/App.h"
 #include "SystemTextures.h"
 
 
 static const int32 MAX_NUM_POINTS = 256;
 static const uint8 MAX_NUM_MIP_LEVELS = 10;
+static_assert(EVARIDVFMapChannel::Num == EVARIDVFMapChannel::Contrast0 + MAX_NUM_MIP_LEVELS, "EVARIDVFMapChannel needs a channel per contrast level");
+static const int32 INPAINT_FILL_ITERATIONS_PER_DISPATCH = 4;
+static const float INPAINT_MASK_THRESHOLD = 0.5f;	// must match MaskThreshold in VARIDCommon.ush
+static const int32 TILE_CLASSIFY_TILE_SIZE = 16;	// must match VARIDTileClassifyCS.usf
+static const int32 CONTRAST_TILE_DILATION = 4;		// how far the expand chain reaches, in texels of each level
+static const int32 FIXED_PYRAMID_KERNEL_WIDTH = 5;	// VARIDGaussianPyramidCS.usf and VARIDContrastReconstructFusedCS.usf bake in Blur5
+static const uint32 AFFECTED_TILE_LIST = 0;		// the order of OutTileCounters and OutIndirectArgs in VARIDTileClassifyCS.usf
+static const uint32 UNAFFECTED_TILE_LIST = 1;
+
+static_assert(FComputeShaderUtils::kGolden2DGroupSize == 8, "Tile list entries are 8x8 thread groups. Must match TILE_LIST_GROUP_SIZE in VARIDTileList.ush");
+
+
+static TAutoConsoleVariable<int32> CVarVARIDInpaintTiledFill(
+	TEXT("r.VARID.Inpaint.TiledFill"),
+	1,
+	TEXT("0: one dispatch per inpaint fill pass.\n")
+	TEXT("1: run several fill passes per dispatch inside groupshared memory (default)."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDPyramidSinglePass(
+	TEXT("r.VARID.Pyramid.SinglePass"),
+	0,
+	TEXT("0: build the gaussian pyramid with a blur and a downsample dispatch per mip level (default).\n")
+	TEXT("1: build every mip level of the gaussian pyramid in a single dispatch. Reads are clamped to the viewport edge."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDPyramidQuality(
+	TEXT("r.VARID.Pyramid.Quality"),
+	0,
+	TEXT("Kernel and precision of the multi pass gaussian blur, used by the gaussian, laplacian and contrast chains.\n")
+	TEXT("0: Blur5, source pixels cached as f16 (default).\n")
+	TEXT("1: Blur5, source pixels cached as f32.\n")
+	TEXT("2: Blur7, source pixels cached as f32.\n")
+	TEXT("3: Blur9, source pixels cached as f32.\n")
+	TEXT("r.VARID.Pyramid.SinglePass and r.VARID.Contrast.FusedReconstruct are built around Blur5. Above 1 they fall back to the multi pass chains."),
+	ECVF_Scalability | ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDContrastFusedReconstruct(
+	TEXT("r.VARID.Contrast.FusedReconstruct"),
+	0,
+	TEXT("0: build the laplacian pyramid, then reconstruct the contrast texture from it (default).\n")
+	TEXT("1: compute each laplacian band from the gaussian pyramid inside the reconstruct pass. No laplacian texture is built."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDTileClassification(
+	TEXT("r.VARID.TileClassification"),
+	0,
+	TEXT("0: dispatch the inpaint fill and contrast reconstruct passes over the whole viewport (default).\n")
+	TEXT("1: classify 16x16 tiles by the maximum of their VF map and dispatch indirectly over the affected tiles only. Unaffected tiles are copied.\n")
+	TEXT("Applies to the inpaint fill passes, to level 0 of the fused contrast reconstruct (r.VARID.Contrast.FusedReconstruct=1) and to the compute compositor\n")
+	TEXT("(r.VARID.Compositor.Compute=1), which copies the tiles its blur, warp and contrast leave as they are."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarVARIDTileClassificationContrastThreshold(
+	TEXT("r.VARID.TileClassification.ContrastThreshold"),
+	1.0f / 8192.0f,
+	TEXT("Contrast tiles whose VF map stays at or below this value, on every level, are copied from the gaussian pyramid.\n")
+	TEXT("The error is at most (number of mips - 1) * threshold. The default keeps it below half a step of an 8 bit output."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarVARIDTileClassificationCompositorThreshold(
+	TEXT("r.VARID.TileClassification.CompositorThreshold"),
+	1.0f / 8192.0f,
+	TEXT("Compute compositor tiles where the blur VF map picks a mip level, and the warp VF map moves the sample by a number of texels, at or below this\n")
+	TEXT("value are copied, as long as their contrast is too. Each adds at most this much to the error of the contrast threshold."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDWorkingTextures(
+	TEXT("r.VARID.WorkingTextures"),
+	1,
+	TEXT("Size and layout of the VF map, inpaint, pyramid and contrast textures.\n")
+	TEXT("0: the size of the whole scene colour texture, built for every view.\n")
+	TEXT("1: the size of the view rect, built for every view (default).\n")
+	TEXT("2: single pass stereo. One set of textures covering both eyes, built by the first stereo view of the frame and reused by the second.\n")
+	TEXT("   The VF map and inpaint passes run once over both eyes, the pyramid passes once per eye so their reads stay clamped to it.\n")
+	TEXT("   Falls back to 1 when the eyes are not side by side."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDWarpAnalyticGradient(
+	TEXT("r.VARID.Warp.AnalyticGradient"),
+	1,
+	TEXT("0: build a warp height map, then take a 5 texel finite difference of it. The displacement depends on the resolution.\n")
+	TEXT("1: write the closed form gradient of the warp VF map straight into the warp field, in a single pass (default)."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarVARIDWarpGradientStep(
+	TEXT("r.VARID.Warp.GradientStep"),
+	0.002f,
+	TEXT("Scene UV distance the analytic warp gradient is scaled by, horizontally. Vertically it is scaled by the aspect ratio so both axes move the same number of pixels.\n")
+	TEXT("The default is close to the 5 texel finite difference on a side by side buffer about 2500 texels wide."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDBlurSummedAreaTable(
+	TEXT("r.VARID.Blur.SummedAreaTable"),
+	0,
+	TEXT("0: blur by sampling the contrast mip chain at the blur VF map level. The radius moves in power of two steps (default).\n")
+	TEXT("1: build a summed area table of contrast level 0 once per frame and take a box of any radius from it, at a constant cost per pixel.\n")
+	TEXT("   Costs two passes and a 128 bit texture. See the VARID.Reference.SummedAreaTableBlur automation test for the error and CPU cost of both."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDCompositorCompute(
+	TEXT("r.VARID.Compositor.Compute"),
+	0,
+	TEXT("0: reconstruct contrast level 0 into the contrast texture, then composite with a full screen quad (default).\n")
+	TEXT("1: composite with a compute shader that reconstructs level 0 where it samples it, saving a full resolution write and read per eye.\n")
+	TEXT("   Needs r.VARID.Contrast.FusedReconstruct, the default pyramid kernel and more than one mip. Not used with r.VARID.Blur.SummedAreaTable, which reads level 0 as a whole.\n")
+	TEXT("   When the output can't be written from a compute shader the result goes through a temporary texture and a copy."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDVFMapInterpolation(
+	TEXT("r.VARID.VFMap.Interpolation"),
+	0,
+	TEXT("How the VF map textures are filled in between the profile points.\n")
+	TEXT("0: gaussian RBF, summing every point of the eye at every texel (default).\n")
+	TEXT("1: draw the Delaunay triangulation built when the profile was loaded and let the rasteriser interpolate it linearly. One triangle per texel.\n")
+	TEXT("   The field is linear between neighbouring points rather than a sum of bumps, so the two modes don't match. See the VARID.Reference.VFMapMesh automation test."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDVFMapLowRes(
+	TEXT("r.VARID.VFMap.LowRes"),
+	0,
+	TEXT("0: sum the RBF of the VF map at every texel (default).\n")
+	TEXT("1: sum it on a grid of nodes every 2 to 16 texels, then bilinearly upsample. The spacing is the coarsest a bound on the curvature of the map allows\n")
+	TEXT("   within r.VARID.VFMap.LowResMaxError, worked out when the profile is loaded. Height maps from points only, not the warp field, meshes or images.\n")
+	TEXT("   See the VARID.Reference.VFMapResolution automation test."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarVARIDVFMapLowResMaxError(
+	TEXT("r.VARID.VFMap.LowResMaxError"),
+	1.0f / 512.0f,
+	TEXT("Most the r.VARID.VFMap.LowRes upsample may move a VF map value, before the 0..1 clamp. The default is half a step of an 8 bit output."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDVFMapCombined(
+	TEXT("r.VARID.VFMap.Combined"),
+	0,
+	TEXT("0: one dispatch per VF map: blur, inpaint, warp and each contrast level, each summing its own points (default).\n")
+	TEXT("1: one dispatch for all of them, over a single table of the points of every map. Maps with a point at the same position share its gaussian weight.\n")
+	TEXT("   Not used with r.VARID.VFMap.Interpolation or r.VARID.VFMap.LowRes. The warp field joins in with r.VARID.Warp.AnalyticGradient. See the VARID.Reference.VFMapCombined automation test."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDSharePyramids(
+	TEXT("r.VARID.SharePyramids"),
+	1,
+	TEXT("0: every view builds its own inpainted colour and pyramids.\n")
+	TEXT("1: a view that sees the same image as an earlier view of the frame (same family, camera and view size) and inpaints it the same way reuses them (default).\n")
+	TEXT("   Only its VF maps, contrast reconstruct and composite run - e.g. two profiles side by side in split screen. See the VARID.Reference.ViewProfiles automation test."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDQuality(
+	TEXT("r.VARID.Quality"),
+	3,
+	TEXT("The best quality VARID renders at, and the best r.VARID.DynamicQuality may go to.\n")
+	TEXT("-1: follow sg.PostProcessQuality. Opt in per project, as below Epic it turns output quality down.\n")
+	TEXT("0: low. Pyramid of 6 levels, 4 inpaint passes, coarse VF maps and contrast tiles copied below 1/128.\n")
+	TEXT("1: medium. Pyramid of 8 levels, 8 inpaint passes, low res VF maps and contrast tiles copied below 1/512.\n")
+	TEXT("2: high. 12 inpaint passes and contrast tiles copied below 1/2048.\n")
+	TEXT("3: epic. As the other r.VARID console variables say (default).\n")
+	TEXT("Can be set per scalability level in the [PostProcessQuality@N] sections of the project's DefaultScalability.ini."),
+	ECVF_Scalability | ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDDynamicQuality(
+	TEXT("r.VARID.DynamicQuality"),
+	0,
+	TEXT("0: render at r.VARID.Quality (default).\n")
+	TEXT("1: time VARID's passes on the GPU and step the quality down from r.VARID.Quality when they take longer than r.VARID.DynamicQuality.BudgetMs, and back up when they\n")
+	TEXT("   are well under it. Needs timestamp queries. See the VARID.Reference.QualityController automation test."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarVARIDDynamicQualityBudgetMs(
+	TEXT("r.VARID.DynamicQuality.BudgetMs"),
+	3.0f,
+	TEXT("GPU milliseconds VARID may take a frame, every view together, under r.VARID.DynamicQuality."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDDynamicQualityMinQuality(
+	TEXT("r.VARID.DynamicQuality.MinQuality"),
+	0,
+	TEXT("The lowest r.VARID.Quality level r.VARID.DynamicQuality may go down to, 0 to 3."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVARIDCaptureReadbacks(
+	TEXT("r.VARID.Capture.Readbacks"),
+	6,
+	TEXT("Staging textures the output capture copies each eye into and maps once the GPU has made the copy. An eye with none free is dropped, so there need to\n")
+	TEXT("be enough for every eye of the frames the GPU runs behind. See FVARIDModule::BeginOutputCapture()."),
+	ECVF_RenderThreadSafe);
+
+/** the knobs of the quality level VARID renders at. Set once a frame, before its first view, by FVARIDSceneViewExtension::UpdateQuality_RenderThread() */
+static FVARIDQualitySettings GVARIDQualitySettingsRenderThread;
+
+static bool UseVFMapLowRes_RenderThread()
+{
+	return CVarVARIDVFMapLowRes.GetValueOnRenderThread() != 0 || GVARIDQualitySettingsRenderThread.VFMapMaxError > 0.0f;
+}
 
+static float GetVFMapLowResMaxError_RenderThread()
+{
+	return FMath::Max(CVarVARIDVFMapLowResMaxError.GetValueOnRenderThread(), GVARIDQualitySettingsRenderThread.VFMapMaxError);
+}
 
-struct FShaderParameterMapPoint
+static bool UseTileClassification_RenderThread()
 {
-public:
-	float X;
-	float Y;
-	float Value;
-	float Padding;
-};
+	return CVarVARIDTileClassification.GetValueOnRenderThread() != 0 || GVARIDQualitySettingsRenderThread.ContrastThreshold > 0.0f;
+}
 
+static float GetContrastTileThreshold_RenderThread()
+{
+	return FMath::Max(CVarVARIDTileClassificationContrastThreshold.GetValueOnRenderThread(), GVARIDQualitySettingsRenderThread.ContrastThreshold);
+}
 
-static_assert(sizeof(FShaderParameterMapPoint) == 16, "FShaderParameterMapPoint is wrong size. Expected 16 byte alignment. Has it been changed?!");
+static float GetCompositorTileThreshold_RenderThread()
+{
+	return FMath::Max(CVarVARIDTileClassificationCompositorThreshold.GetValueOnRenderThread(), GVARIDQualitySettingsRenderThread.ContrastThreshold);
+}
 
 
 class FQuadVertexBufferFull : public FVertexBuffer
@@ -168,12 +381,16 @@ public:
 IMPLEMENT_GLOBAL_SHADER(FVARIDQuadVS, "/Plugin/VARID/Private/VARIDQuadVS.usf", "MainVS", SF_Vertex);
 
 
+class FVARIDBlurSummedAreaTableDim : SHADER_PERMUTATION_BOOL("BLUR_MODE_SAT");
+
 class FVARIDQuadPS : public FGlobalShader
 {
 	DECLARE_SHADER_TYPE(FVARIDQuadPS, Global);
 
 public:
 
+	using FPermutationDomain = TShaderPermutationDomain<FVARIDBlurSummedAreaTableDim>;
+
 	SHADER_USE_PARAMETER_STRUCT(FVARIDQuadPS, FGlobalShader)
 
 		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
@@ -193,6 +410,14 @@ public:
 		SHADER_PARAMETER_SAMPLER(SamplerState, InPointSampler)
 
 		SHADER_PARAMETER(float, InMaxMipLevel)
+		SHADER_PARAMETER(FVector4, InUVScaleBias)
+		SHADER_PARAMETER(FVector2D, InWarpUVScale)
+
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<uint4>, InSummedAreaTableSRV)
+		SHADER_PARAMETER(FIntPoint, InSATOrigin)
+		SHADER_PARAMETER(FIntPoint, InSATViewportMin)
+		SHADER_PARAMETER(FIntPoint, InSATViewportMax)
+		SHADER_PARAMETER(FVector2D, InWorkingExtent)
 
 		RENDER_TARGET_BINDING_SLOTS()
 
@@ -211,15 +436,22 @@ public:
 IMPLEMENT_GLOBAL_SHADER(FVARIDQuadPS, "/Plugin/VARID/Private/VARIDQuadPS.usf", "MainPS", SF_Pixel);
 
 
+class FVARIDSourceUVTransformDim : SHADER_PERMUTATION_BOOL("USE_SOURCE_UV_TRANSFORM");
+class FVARIDSourceUVClampDim : SHADER_PERMUTATION_BOOL("USE_SOURCE_UV_CLAMP");
+
 class FVARIDBasicResampleCS : public FGlobalShader
 {
 public:
 	DECLARE_GLOBAL_SHADER(FVARIDBasicResampleCS)
 	SHADER_USE_PARAMETER_STRUCT(FVARIDBasicResampleCS, FGlobalShader)
 
+	using FPermutationDomain = TShaderPermutationDomain<FVARIDSourceUVTransformDim, FVARIDSourceUVClampDim>;
+
 		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
 		SHADER_PARAMETER(FIntPoint, InDispatchThreadIDOffset)
 		SHADER_PARAMETER(FVector2D, InTexelSize)
+		SHADER_PARAMETER(FVector4, InSourceUVScaleBias)
+		SHADER_PARAMETER(FVector4, InSourceUVClamp)
 		SHADER_PARAMETER_SAMPLER(SamplerState, InSampler)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InSRV)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutUAV)
@@ -264,14 +496,22 @@ public:
 IMPLEMENT_GLOBAL_SHADER(FVARIDLaplacianCS, "/Plugin/VARID/Private/VARIDLaplacianCS.usf", "MainCS", SF_Compute);
 
 
+class FVARIDBlurKernelWidthDim : SHADER_PERMUTATION_SPARSE_INT("BLUR_KERNEL_WIDTH", 5, 7, 9);
+class FVARIDBlurChannelCountDim : SHADER_PERMUTATION_SPARSE_INT("BLUR_CHANNEL_COUNT", 1, 3);
+class FVARIDBlurHalfPrecisionCacheDim : SHADER_PERMUTATION_BOOL("BLUR_HALF_PRECISION_CACHE");
+
 class FVARIDGaussianBlurCS : public FGlobalShader
 {
 public:
 	DECLARE_GLOBAL_SHADER(FVARIDGaussianBlurCS)
 	SHADER_USE_PARAMETER_STRUCT(FVARIDGaussianBlurCS, FGlobalShader)
 
+	using FPermutationDomain = TShaderPermutationDomain<FVARIDBlurKernelWidthDim, FVARIDBlurChannelCountDim, FVARIDBlurHalfPrecisionCacheDim>;
+
 		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
 		SHADER_PARAMETER(FIntPoint, DispatchThreadIDOffset)
+		SHADER_PARAMETER(FIntPoint, InClampMin)
+		SHADER_PARAMETER(FIntPoint, InClampMax)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InSRV)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutUAV)
 		END_SHADER_PARAMETER_STRUCT();
@@ -289,6 +529,43 @@ public:
 IMPLEMENT_GLOBAL_SHADER(FVARIDGaussianBlurCS, "/Plugin/VARID/Private/VARIDGaussianBlurCS.usf", "MainCS", SF_Compute);
 
 
+class FVARIDGaussianPyramidCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FVARIDGaussianPyramidCS)
+	SHADER_USE_PARAMETER_STRUCT(FVARIDGaussianPyramidCS, FGlobalShader)
+
+		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntPoint, InViewportMin)
+		SHADER_PARAMETER(FIntPoint, InViewportSize)
+		SHADER_PARAMETER(uint32, InNumMips)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutMip0)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutMip1)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutMip2)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutMip3)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutMip4)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutMip5)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutMip6)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutMip7)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutMip8)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutMip9)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, TileCounters)
+		END_SHADER_PARAMETER_STRUCT();
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return RHISupportsComputeShaders(Parameters.Platform);
+	}
+
+	static void ModifyCompilationEnvironment(const FShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FVARIDGaussianPyramidCS, "/Plugin/VARID/Private/VARIDGaussianPyramidCS.usf", "MainCS", SF_Compute);
+
+
 class FVARIDReconstructCS : public FGlobalShader
 {
 public:
@@ -316,6 +593,51 @@ public:
 IMPLEMENT_GLOBAL_SHADER(FVARIDReconstructCS, "/Plugin/VARID/Private/VARIDContrastReconstructCS.usf", "MainCS", SF_Compute)
 
 
+class FVARIDUseTileListDim : SHADER_PERMUTATION_BOOL("USE_TILE_LIST");
+
+BEGIN_SHADER_PARAMETER_STRUCT(FVARIDTileListParameters, )
+	SHADER_PARAMETER_RDG_BUFFER_SRV(Buffer<uint>, InTileList)
+	SHADER_PARAMETER_RDG_BUFFER_SRV(Buffer<uint>, InTileListCounters)
+	SHADER_PARAMETER(uint32, InTileListIndex)
+	RDG_BUFFER_ACCESS(IndirectArgsBuffer, ERHIAccess::IndirectArgs)
+END_SHADER_PARAMETER_STRUCT()
+
+
+class FVARIDReconstructFusedCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FVARIDReconstructFusedCS)
+	SHADER_USE_PARAMETER_STRUCT(FVARIDReconstructFusedCS, FGlobalShader)
+
+	using FPermutationDomain = TShaderPermutationDomain<FVARIDUseTileListDim>;
+
+		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntPoint, InDispatchThreadIDOffset)
+		SHADER_PARAMETER(FIntPoint, InHiResMin)
+		SHADER_PARAMETER(FIntPoint, InHiResMax)
+		SHADER_PARAMETER(FIntPoint, InLoResMin)
+		SHADER_PARAMETER(FIntPoint, InLoResMax)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InLoResContrastSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InLoResGaussianSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InHiResGaussianSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InVFMapSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, OutUAV)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FVARIDTileListParameters, TileList)
+		END_SHADER_PARAMETER_STRUCT();
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return RHISupportsComputeShaders(Parameters.Platform);
+	}
+
+	static void ModifyCompilationEnvironment(const FShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FVARIDReconstructFusedCS, "/Plugin/VARID/Private/VARIDContrastReconstructFusedCS.usf", "MainCS", SF_Compute)
+
+
 class FVARIDInpainterInitialiseCS : public FGlobalShader
 {
 public:
@@ -348,6 +670,8 @@ public:
 	DECLARE_GLOBAL_SHADER(FVARIDInpainterFillCS)
 	SHADER_USE_PARAMETER_STRUCT(FVARIDInpainterFillCS, FGlobalShader)
 
+	using FPermutationDomain = TShaderPermutationDomain<FVARIDUseTileListDim>;
+
 		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
 		SHADER_PARAMETER(FIntPoint, InDispatchThreadIDOffset)
 		SHADER_PARAMETER(FVector2D, InTexelSize)
@@ -357,6 +681,7 @@ public:
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InMetaDataSRV)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, OutColourUAV)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, OutMetaDataUAV)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FVARIDTileListParameters, TileList)
 		END_SHADER_PARAMETER_STRUCT();
 
 	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
@@ -372,6 +697,40 @@ public:
 IMPLEMENT_GLOBAL_SHADER(FVARIDInpainterFillCS, "/Plugin/VARID/Private/VARIDInpainterFillCS.usf", "MainCS", SF_Compute)
 
 
+class FVARIDInpainterFillTiledCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FVARIDInpainterFillTiledCS)
+	SHADER_USE_PARAMETER_STRUCT(FVARIDInpainterFillTiledCS, FGlobalShader)
+
+	using FPermutationDomain = TShaderPermutationDomain<FVARIDUseTileListDim>;
+
+		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntPoint, InDispatchThreadIDOffset)
+		SHADER_PARAMETER(FIntPoint, InActiveMax)
+		SHADER_PARAMETER(int32, PassCounter)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InMaskSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InColourSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InMetaDataSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, OutColourUAV)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, OutMetaDataUAV)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FVARIDTileListParameters, TileList)
+		END_SHADER_PARAMETER_STRUCT();
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return RHISupportsComputeShaders(Parameters.Platform);
+	}
+
+	static void ModifyCompilationEnvironment(const FShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		OutEnvironment.SetDefine(TEXT("ITERATIONS_PER_DISPATCH"), INPAINT_FILL_ITERATIONS_PER_DISPATCH);
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FVARIDInpainterFillTiledCS, "/Plugin/VARID/Private/VARIDInpainterFillTiledCS.usf", "MainCS", SF_Compute)
+
+
 class FVARIDInpainterFinaliseCS : public FGlobalShader
 {
 public:
@@ -387,6 +746,7 @@ public:
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InMaskSRV)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InMaskedColourSRV)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InUnmaskedColourSRV)
+		SHADER_PARAMETER(FIntPoint, InUnmaskedColourOffset)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InMetaDataSRV)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, OutColourUAV)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D, OutPositionUAV)
@@ -405,12 +765,16 @@ public:
 IMPLEMENT_GLOBAL_SHADER(FVARIDInpainterFinaliseCS, "/Plugin/VARID/Private/VARIDInpainterFinaliseCS.usf", "MainCS", SF_Compute)
 
 
+class FVARIDOutputGradientDim : SHADER_PERMUTATION_BOOL("OUTPUT_GRADIENT");
+
 class FVARIDHeightMapCS : public FGlobalShader
 {
 public:
 	DECLARE_GLOBAL_SHADER(FVARIDHeightMapCS)
 	SHADER_USE_PARAMETER_STRUCT(FVARIDHeightMapCS, FGlobalShader)
 
+	using FPermutationDomain = TShaderPermutationDomain<FVARIDOutputGradientDim>;
+
 		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
 		SHADER_PARAMETER(FIntPoint, DispatchThreadIDOffset)
 		SHADER_PARAMETER(FVector2D, TexelSize)
@@ -419,7 +783,14 @@ public:
 		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FShaderParameterMapPoint>, VFMapPoints)
 		SHADER_PARAMETER(uint32, NumVFMapPoints)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float>, OutUAV)
-		SHADER_PARAMETER(float, InOriginOffset)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float2>, OutGradientUAV)
+		SHADER_PARAMETER(FVector2D, InGradientStep)
+		SHADER_PARAMETER(FVector4, InSceneUVScaleBias)
+		SHADER_PARAMETER(int32, InRightEyeMinX)
+		SHADER_PARAMETER(FIntVector4, InEyePointRange)
+		SHADER_PARAMETER(FVector2D, InOriginOffset)
+		SHADER_PARAMETER(FVector4, InNodeTransform)
+		SHADER_PARAMETER(uint32, bInClampOutput)
 		END_SHADER_PARAMETER_STRUCT();
 
 	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
@@ -436,6 +807,186 @@ public:
 IMPLEMENT_GLOBAL_SHADER(FVARIDHeightMapCS, "/Plugin/VARID/Private/VARIDHeightMapCS.usf", "MainCS", SF_Compute);
 
 
+class FVARIDVFMapUpsampleCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FVARIDVFMapUpsampleCS)
+	SHADER_USE_PARAMETER_STRUCT(FVARIDVFMapUpsampleCS, FGlobalShader)
+
+		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntPoint, DispatchThreadIDOffset)
+		SHADER_PARAMETER(FIntPoint, InRegionMax)
+		SHADER_PARAMETER(int32, InRightEyeMinX)
+		SHADER_PARAMETER(FVector4, InNodeTransform)
+		SHADER_PARAMETER(FIntVector4, InLastNode)
+		SHADER_PARAMETER_RDG_TEXTURE(Texture2D<float>, InNodeTexture)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float>, OutUAV)
+		END_SHADER_PARAMETER_STRUCT();
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return RHISupportsComputeShaders(Parameters.Platform);
+	}
+
+	static void ModifyCompilationEnvironment(const FShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FVARIDVFMapUpsampleCS, "/Plugin/VARID/Private/VARIDVFMapUpsampleCS.usf", "MainCS", SF_Compute);
+
+
+class FVARIDProgressionDim : SHADER_PERMUTATION_BOOL("PROGRESSION");
+
+class FVARIDVFMapCombinedCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FVARIDVFMapCombinedCS)
+	SHADER_USE_PARAMETER_STRUCT(FVARIDVFMapCombinedCS, FGlobalShader)
+
+	using FPermutationDomain = TShaderPermutationDomain<FVARIDProgressionDim>;
+
+		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntPoint, InViewportMin)
+		SHADER_PARAMETER(FIntPoint, InViewportSize)
+		SHADER_PARAMETER(FIntPoint, InExtent)
+		SHADER_PARAMETER(uint32, InNumMips)
+		SHADER_PARAMETER(FVector4, InSceneUVScaleBias)
+		SHADER_PARAMETER(int32, InRightEyeMinX)
+		SHADER_PARAMETER(FIntVector4, InEyeEntryRange)
+		SHADER_PARAMETER_ARRAY(FVector4, InOriginOffsets, [EVARIDVFMapChannel::Num])
+		SHADER_PARAMETER(uint32, bInOutputWarp)
+		SHADER_PARAMETER(FVector2D, InGradientStep)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FVARIDVFMapTableEntry>, VFMapTable)
+		SHADER_PARAMETER(uint32, InNumKeyframeEntries)
+		SHADER_PARAMETER(FIntPoint, InKeyframes)
+		SHADER_PARAMETER(float, InKeyframeAlpha)
+		SHADER_PARAMETER(FVector4, InGazeOffsets)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float>, OutBlurUAV)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float>, OutInpaintUAV)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float2>, OutWarpUAV)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float>, OutContrastMip0)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float>, OutContrastMip1)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float>, OutContrastMip2)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float>, OutContrastMip3)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float>, OutContrastMip4)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float>, OutContrastMip5)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float>, OutContrastMip6)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float>, OutContrastMip7)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float>, OutContrastMip8)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float>, OutContrastMip9)
+		END_SHADER_PARAMETER_STRUCT();
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return RHISupportsComputeShaders(Parameters.Platform);
+	}
+
+	static void ModifyCompilationEnvironment(const FShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FVARIDVFMapCombinedCS, "/Plugin/VARID/Private/VARIDVFMapCombinedCS.usf", "MainCS", SF_Compute);
+
+
+BEGIN_SHADER_PARAMETER_STRUCT(FVARIDVFMapMeshParameters, )
+	SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FShaderParameterMapPoint>, InMeshVertices)
+	SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, InMeshIndices)
+	SHADER_PARAMETER(uint32, InFirstIndex)
+	SHADER_PARAMETER(uint32, InFirstVertex)
+	SHADER_PARAMETER(FVector4, InPointScaleBias)
+	SHADER_PARAMETER(FVector4, InSceneUVScaleBias)
+	SHADER_PARAMETER(float, InOriginOffset)
+	SHADER_PARAMETER(FVector2D, InGradientStep)
+	RENDER_TARGET_BINDING_SLOTS()
+END_SHADER_PARAMETER_STRUCT()
+
+class FVARIDVFMapMeshVS : public FGlobalShader
+{
+	DECLARE_SHADER_TYPE(FVARIDVFMapMeshVS, Global);
+
+public:
+
+	using FParameters = FVARIDVFMapMeshParameters;
+
+	SHADER_USE_PARAMETER_STRUCT(FVARIDVFMapMeshVS, FGlobalShader)
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FVARIDVFMapMeshVS, "/Plugin/VARID/Private/VARIDVFMapMeshVS.usf", "MainVS", SF_Vertex);
+
+
+class FVARIDVFMapMeshPS : public FGlobalShader
+{
+	DECLARE_SHADER_TYPE(FVARIDVFMapMeshPS, Global);
+
+public:
+
+	using FParameters = FVARIDVFMapMeshParameters;
+	using FPermutationDomain = TShaderPermutationDomain<FVARIDOutputGradientDim>;
+
+	SHADER_USE_PARAMETER_STRUCT(FVARIDVFMapMeshPS, FGlobalShader)
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FVARIDVFMapMeshPS, "/Plugin/VARID/Private/VARIDVFMapMeshPS.usf", "MainPS", SF_Pixel);
+
+
+class FVARIDVFMapImageCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FVARIDVFMapImageCS)
+	SHADER_USE_PARAMETER_STRUCT(FVARIDVFMapImageCS, FGlobalShader)
+
+	using FPermutationDomain = TShaderPermutationDomain<FVARIDOutputGradientDim>;
+
+		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntPoint, DispatchThreadIDOffset)
+		SHADER_PARAMETER(FIntPoint, InRegionMax)
+		SHADER_PARAMETER(FVector2D, TexelSize)
+		SHADER_PARAMETER(FVector4, InSceneUVScaleBias)
+		SHADER_PARAMETER(FVector4, InPointScaleBias)
+		SHADER_PARAMETER(FVector4, InImageScaleBias)
+		SHADER_PARAMETER(float, InImageLevel)
+		SHADER_PARAMETER(FVector2D, InImageTexelSize)
+		SHADER_PARAMETER(float, InOriginOffset)
+		SHADER_PARAMETER(FVector2D, InGradientStep)
+		SHADER_PARAMETER_RDG_TEXTURE(Texture2D<float>, ImageTexture)
+		SHADER_PARAMETER_SAMPLER(SamplerState, ImageSampler)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float>, OutUAV)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float2>, OutGradientUAV)
+		END_SHADER_PARAMETER_STRUCT();
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return RHISupportsComputeShaders(Parameters.Platform);
+	}
+
+	static void ModifyCompilationEnvironment(const FShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FVARIDVFMapImageCS, "/Plugin/VARID/Private/VARIDVFMapImageCS.usf", "MainCS", SF_Compute);
+
+
 class FVARIDNormalMapCS : public FGlobalShader
 {
 public:
@@ -500,10 +1051,13 @@ public:
 	DECLARE_GLOBAL_SHADER(FVARIDDirectCopyCS)
 	SHADER_USE_PARAMETER_STRUCT(FVARIDDirectCopyCS, FGlobalShader)
 
+	using FPermutationDomain = TShaderPermutationDomain<FVARIDUseTileListDim>;
+
 		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
 		SHADER_PARAMETER(FIntPoint, DispatchThreadIDOffset)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InSRV)
 		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutUAV)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FVARIDTileListParameters, TileList)
 		END_SHADER_PARAMETER_STRUCT();
 
 	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
@@ -545,203 +1099,1036 @@ public:
 IMPLEMENT_GLOBAL_SHADER(FVARIDDirectCopyMaskedCS, "/Plugin/VARID/Private/VARIDDirectCopyMaskedCS.usf", "MainCS", SF_Compute);
 
 
-/*****************************************************************************************************************/
-// VF map
+class FVARIDClassifyCompositorDim : SHADER_PERMUTATION_BOOL("CLASSIFY_COMPOSITOR");
 
-/** even if we have no points to pass in, we still generate a texture. in the case of zero points the texture would be black */
-static bool BuildHeightMapTexture_RenderThread
-(
-	FRDGBuilder& InGraphBuilder,
-	const bool InFXEnabled,
-	const TArray<FVARIDVFMapPoint>& InVFMapPoints,
-	const int32 InMipLevel,
-	const FVector2D& InEyeGazePoint,
-	float InOriginOffset,
-	FRDGTextureRef OutHeightMapTexture,
-	const FIntRect& InViewportRect,
-	const EStereoscopicPass InStereoPass,
-	const bool InFullField
-)
+class FVARIDTileClassifyCS : public FGlobalShader
 {
-	check(InMipLevel >= 0);
-	check(OutHeightMapTexture);
+public:
+	DECLARE_GLOBAL_SHADER(FVARIDTileClassifyCS)
+	SHADER_USE_PARAMETER_STRUCT(FVARIDTileClassifyCS, FGlobalShader)
 
-	const FRDGTextureDesc& OutHeightMapTextureDesc = OutHeightMapTexture->Desc;
-	const FIntPoint TextureSize(FMath::Max(OutHeightMapTextureDesc.Extent.X >> InMipLevel, 1), FMath::Max(OutHeightMapTextureDesc.Extent.Y >> InMipLevel, 1));
-	const FVector2D TexelSize(1.0f / TextureSize.X, 1.0f / TextureSize.Y);
-	const FIntPoint DispatchSize(FMath::Max(InViewportRect.Width() >> InMipLevel, 1), FMath::Max(InViewportRect.Height() >> InMipLevel, 1));
-	const FIntPoint DispatchThreadIDOffset(InViewportRect.Min.X >> InMipLevel, InViewportRect.Min.Y >> InMipLevel);
+	using FPermutationDomain = TShaderPermutationDomain<FVARIDClassifyCompositorDim>;
 
-	TArray<FShaderParameterMapPoint> FilteredPoints;
+		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntPoint, InRegionMin)
+		SHADER_PARAMETER(FIntPoint, InRegionSize)
+		SHADER_PARAMETER(int32, InBaseMipLevel)
+		SHADER_PARAMETER(int32, InNumLevels)
+		SHADER_PARAMETER(int32, InDilation)
+		SHADER_PARAMETER(float, InThreshold)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InVFMapSRV)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, OutAffectedTileList)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, OutUnaffectedTileList)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, OutTileCounters)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InBlurVFMapSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InWarpVFMapSRV)
+		SHADER_PARAMETER(float, InBlurScale)
+		SHADER_PARAMETER(FVector2D, InWarpTexelScale)
+		SHADER_PARAMETER(float, InCompositorThreshold)
+		END_SHADER_PARAMETER_STRUCT();
 
-	if (InFXEnabled)
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
 	{
-		if (InFullField && InVFMapPoints.Num() == 1)
-		{
-			InOriginOffset = InVFMapPoints[0].NormValue;
-			// FilteredPoints will be left empty
-		}
-		else
-		{
-			float XScale = 1.0f;
-			float XOffset = 0.0f;
-
-			switch (InStereoPass)
-			{
-			case eSSP_FULL:
-				break;
-			case eSSP_LEFT_EYE:
-				XScale = 0.5f;
-				break;
-			case eSSP_RIGHT_EYE:
-				XScale = 0.5f;
-				XOffset = 0.5f;
-				break;
-			case eSSP_LEFT_EYE_SIDE:
-				break;
-			case eSSP_RIGHT_EYE_SIDE:
-				break;
-			default:
-				break;
-			}
+		return RHISupportsComputeShaders(Parameters.Platform);
+	}
 
-			for (int32 i = 0; i < InVFMapPoints.Num(); ++i)
-			{
-				FShaderParameterMapPoint P;
-				P.X = ((InVFMapPoints[i].NormX + InEyeGazePoint.X) * XScale) + XOffset;
-				P.Y = (InVFMapPoints[i].NormY + InEyeGazePoint.Y);
-				P.Value = InVFMapPoints[i].NormValue;
-				P.Padding = 1.0f;	// makes the struct have 16 byte alignment
-				FilteredPoints.Add(P);
-			}
-		}
+	static void ModifyCompilationEnvironment(const FShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
 	}
+};
+IMPLEMENT_GLOBAL_SHADER(FVARIDTileClassifyCS, "/Plugin/VARID/Private/VARIDTileClassifyCS.usf", "ClassifyCS", SF_Compute);
 
-	// Even if there are no points Keep going - still need to generate a texture as the remaining parts of the render pipeline are relying on a valid texture to exist.
 
-	TShaderMapRef<FVARIDHeightMapCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+class FVARIDTileListIndirectArgsCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FVARIDTileListIndirectArgsCS)
+	SHADER_USE_PARAMETER_STRUCT(FVARIDTileListIndirectArgsCS, FGlobalShader)
 
-	FVARIDHeightMapCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDHeightMapCS::FParameters>();
-	PassParameters->DispatchThreadIDOffset = DispatchThreadIDOffset;
-	PassParameters->TexelSize = TexelSize;
-	PassParameters->LinearSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-	PassParameters->PointSampler = TStaticSamplerState<SF_Point, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-	PassParameters->InOriginOffset = InOriginOffset;	// intensity origin
-	PassParameters->NumVFMapPoints = FilteredPoints.Num();
-	if (FilteredPoints.Num() > 0)
+		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, OutTileCounters)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWBuffer<uint>, OutIndirectArgs)
+		END_SHADER_PARAMETER_STRUCT();
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
 	{
-		PassParameters->VFMapPoints = InGraphBuilder.CreateSRV(CreateStructuredBuffer(InGraphBuilder, TEXT("VFMapPoints"), sizeof(FShaderParameterMapPoint), FilteredPoints.Num(), FilteredPoints.GetData(), sizeof(FShaderParameterMapPoint) * FilteredPoints.Num(), ERDGInitialDataFlags::None));
+		return RHISupportsComputeShaders(Parameters.Platform);
 	}
-	else
+
+	static void ModifyCompilationEnvironment(const FShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
 	{
-		// HACK cant pass array with size zero. Have to pass at least one element. 
-		FShaderParameterMapPoint DummyPoint;
-		PassParameters->VFMapPoints = InGraphBuilder.CreateSRV(CreateStructuredBuffer(InGraphBuilder, TEXT("VFMapPoints"), sizeof(FShaderParameterMapPoint), 1, &DummyPoint, sizeof(FShaderParameterMapPoint), ERDGInitialDataFlags::None));
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
 	}
-	PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutHeightMapTexture, InMipLevel));
+};
+IMPLEMENT_GLOBAL_SHADER(FVARIDTileListIndirectArgsCS, "/Plugin/VARID/Private/VARIDTileClassifyCS.usf", "BuildIndirectArgsCS", SF_Compute);
 
-	FComputeShaderUtils::AddPass(
-		InGraphBuilder,
-		RDG_EVENT_NAME("VARID - Build Height Map - MipLevel=%d", InMipLevel),
-		ComputeShader,
-		PassParameters,
-		FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
 
-	return true;
+class FVARIDSummedAreaTableVerticalDim : SHADER_PERMUTATION_BOOL("SAT_VERTICAL_PASS");
+
+class FVARIDSummedAreaTableCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FVARIDSummedAreaTableCS)
+	SHADER_USE_PARAMETER_STRUCT(FVARIDSummedAreaTableCS, FGlobalShader)
+
+	using FPermutationDomain = TShaderPermutationDomain<FVARIDSummedAreaTableVerticalDim>;
+
+		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntPoint, InRegionMin)
+		SHADER_PARAMETER(FIntPoint, InRegionSize)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<uint4>, OutSAT)
+		END_SHADER_PARAMETER_STRUCT();
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return RHISupportsComputeShaders(Parameters.Platform);
+	}
+
+	static void ModifyCompilationEnvironment(const FShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FVARIDSummedAreaTableCS, "/Plugin/VARID/Private/VARIDSummedAreaTableCS.usf", "MainCS", SF_Compute);
+
+
+class FVARIDCompositorCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FVARIDCompositorCS)
+	SHADER_USE_PARAMETER_STRUCT(FVARIDCompositorCS, FGlobalShader)
+
+	using FPermutationDomain = TShaderPermutationDomain<FVARIDUseTileListDim>;
+
+		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntPoint, InOutputMin)
+		SHADER_PARAMETER(FIntPoint, InOutputSize)
+		SHADER_PARAMETER(FIntPoint, InWorkingMin)
+		SHADER_PARAMETER(FVector2D, InWorkingExtent)
+		SHADER_PARAMETER(FIntPoint, InHiResMin)
+		SHADER_PARAMETER(FIntPoint, InHiResMax)
+		SHADER_PARAMETER(FIntPoint, InLoResMin)
+		SHADER_PARAMETER(FIntPoint, InLoResMax)
+		SHADER_PARAMETER(float, InMaxMipLevel)
+		SHADER_PARAMETER(float, InLastMipLevel)
+		SHADER_PARAMETER(FVector2D, InWarpUVScale)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InBlurVFMapSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InWarpVFMapSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InContrastSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InLoResGaussianSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InHiResGaussianSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InVFMapSRV)
+		SHADER_PARAMETER_SAMPLER(SamplerState, InBilinearSampler)
+		SHADER_PARAMETER_SAMPLER(SamplerState, InTrilinearSampler)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutUAV)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FVARIDTileListParameters, TileList)
+		END_SHADER_PARAMETER_STRUCT();
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return RHISupportsComputeShaders(Parameters.Platform);
+	}
+
+	static void ModifyCompilationEnvironment(const FShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FVARIDCompositorCS, "/Plugin/VARID/Private/VARIDCompositorCS.usf", "MainCS", SF_Compute);
+
+
+class FVARIDCompositorCopyCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FVARIDCompositorCopyCS)
+	SHADER_USE_PARAMETER_STRUCT(FVARIDCompositorCopyCS, FGlobalShader)
+
+	using FPermutationDomain = TShaderPermutationDomain<FVARIDUseTileListDim>;
+
+		BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(FIntPoint, InOutputMin)
+		SHADER_PARAMETER(FIntPoint, InOutputSize)
+		SHADER_PARAMETER(FIntPoint, InWorkingMin)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, InHiResGaussianSRV)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutUAV)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FVARIDTileListParameters, TileList)
+		END_SHADER_PARAMETER_STRUCT();
+
+	// the copy path of the unaffected tile list. There is nothing to copy over without one
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		const FPermutationDomain PermutationVector(Parameters.PermutationId);
+		return RHISupportsComputeShaders(Parameters.Platform) && PermutationVector.Get<FVARIDUseTileListDim>();
+	}
+
+	static void ModifyCompilationEnvironment(const FShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(FVARIDCompositorCopyCS, "/Plugin/VARID/Private/VARIDCompositorCS.usf", "CopyCS", SF_Compute);
+
+
+/*****************************************************************************************************************/
+// VF map
+
+/** what the VF map passes need from the profile and eye tracker for one eye of the working texture plan */
+struct FVARIDVFMapEyeInput
+{
+	const FVARIDEye* ProfileEye = nullptr;
+	FVector2D GazePoint = FVector2D::ZeroVector;
+	EStereoscopicPass StereoPass = eSSP_FULL;
+
+	/** the eye of the profile ProfileEye is */
+	int32 EyeIndex = 0;
+
+	/** set when ProfileEye is of the progression's profile at ProgressionTime. r.VARID.VFMap.Combined then blends its keyframe tables rather than packing ProfileEye */
+	TSharedPtr<const FVARIDProfileProgression, ESPMode::ThreadSafe> Progression;
+	float ProgressionTime = 0.0f;
+};
+
+/** picks the VF map of one FX from an eye of the profile. Returns nullptr if the FX is disabled */
+typedef TFunctionRef<const FVARIDVFMap*(const FVARIDEye&)> FVARIDSelectVFMap;
+
+/** scene colour UV x = normalised eye x * OutXScale + OutXOffset, before the gaze offset */
+static void GetStereoPointTransform(const EStereoscopicPass InStereoPass, float& OutXScale, float& OutXOffset)
+{
+	OutXScale = 1.0f;
+	OutXOffset = 0.0f;
+
+	switch (InStereoPass)
+	{
+	case eSSP_FULL:
+		break;
+	case eSSP_LEFT_EYE:
+		OutXScale = 0.5f;
+		break;
+	case eSSP_RIGHT_EYE:
+		OutXScale = 0.5f;
+		OutXOffset = 0.5f;
+		break;
+	case eSSP_LEFT_EYE_SIDE:
+		break;
+	case eSSP_RIGHT_EYE_SIDE:
+		break;
+	default:
+		break;
+	}
 }
 
-static bool BuildNormalMapTexture_RenderThread
+/** the GPU copies of the image VF maps, uploaded with all their mips the first time each is drawn after it has loaded */
+class FVARIDVFMapImageTextures : public FRenderResource
+{
+public:
+	TRefCountPtr<IPooledRenderTarget> FindOrCreate(const TSharedPtr<FVARIDVFMapImage, ESPMode::ThreadSafe>& InImage)
+	{
+		check(IsInRenderingThread());
+		check(InImage.IsValid() && InImage->IsLoaded());
+
+		// images of profiles that are no longer active
+		Entries.RemoveAllSwap([](const FEntry& Entry) { return !Entry.Image.IsValid(); });
+
+		for (const FEntry& Entry : Entries)
+		{
+			if (Entry.Image.Pin() == InImage)
+			{
+				return Entry.Texture;
+			}
+		}
+
+		const TArray<FVARIDVFMapImageMip>& Mips = InImage->GetMips();
+
+		FRHIResourceCreateInfo CreateInfo;
+		FTexture2DRHIRef TextureRHI = RHICreateTexture2D(Mips[0].Size.X, Mips[0].Size.Y, PF_R32_FLOAT, Mips.Num(), 1, TexCreate_ShaderResource, CreateInfo);
+
+		for (int32 MipIndex = 0; MipIndex < Mips.Num(); ++MipIndex)
+		{
+			const FVARIDVFMapImageMip& Mip = Mips[MipIndex];
+			RHIUpdateTexture2D(TextureRHI, MipIndex, FUpdateTextureRegion2D(0, 0, 0, 0, Mip.Size.X, Mip.Size.Y), Mip.Size.X * sizeof(float), reinterpret_cast<const uint8*>(Mip.Values.GetData()));
+		}
+
+		FEntry& Entry = Entries.AddDefaulted_GetRef();
+		Entry.Image = InImage;
+		Entry.Texture = CreateRenderTarget(TextureRHI, TEXT("VARIDVFMapImage"));
+
+		return Entry.Texture;
+	}
+
+	virtual void ReleaseRHI() override
+	{
+		Entries.Empty();
+	}
+
+private:
+	struct FEntry
+	{
+		TWeakPtr<FVARIDVFMapImage, ESPMode::ThreadSafe> Image;
+		TRefCountPtr<IPooledRenderTarget> Texture;
+	};
+
+	TArray<FEntry> Entries;
+};
+TGlobalResource<FVARIDVFMapImageTextures> GVARIDVFMapImageTextures;
+
+/** the keyframe tables of progressions, packed and uploaded the first time each is drawn with a layout of eyes. Moving through a progression after that uploads nothing */
+class FVARIDProgressionTables : public FRenderResource
+{
+public:
+	struct FEntry
+	{
+		TWeakPtr<const FVARIDProfileProgression, ESPMode::ThreadSafe> Progression;
+		TArray<FVARIDProgressionTableEye> Eyes;
+		int32 NumMips = 0;
+		bool bWarp = false;
+		TArray<FVARIDVFMapPointTable> Tables;
+		TRefCountPtr<FRDGPooledBuffer> Buffer;
+	};
+
+	/** OutBuffer gets the tables of every keyframe, one after the other */
+	const FEntry& FindOrCreate(FRDGBuilder& InGraphBuilder, const TSharedPtr<const FVARIDProfileProgression, ESPMode::ThreadSafe>& InProgression, const TArray<FVARIDProgressionTableEye>& InEyes, int32 InNumMips, bool bInWarp, FRDGBufferRef& OutBuffer)
+	{
+		check(IsInRenderingThread());
+		check(InProgression.IsValid());
+
+		// progressions that are no longer active
+		Entries.RemoveAllSwap([](const TUniquePtr<FEntry>& Entry) { return !Entry->Progression.IsValid(); });
+
+		FEntry* FoundEntry = nullptr;
+
+		for (const TUniquePtr<FEntry>& Entry : Entries)
+		{
+			if (Entry->Progression.Pin() == InProgression && Entry->Eyes == InEyes && Entry->NumMips == InNumMips && Entry->bWarp == bInWarp)
+			{
+				FoundEntry = Entry.Get();
+				break;
+			}
+		}
+
+		// the buffer isn't there until the graph that uploaded it has run
+		if (FoundEntry && FoundEntry->Buffer.IsValid())
+		{
+			OutBuffer = InGraphBuilder.RegisterExternalBuffer(FoundEntry->Buffer, TEXT("VFMapProgressionTable"));
+			return *FoundEntry;
+		}
+
+		if (!FoundEntry)
+		{
+			FoundEntry = Entries.Add_GetRef(MakeUnique<FEntry>()).Get();
+			FoundEntry->Progression = InProgression;
+			FoundEntry->Eyes = InEyes;
+			FoundEntry->NumMips = InNumMips;
+			FoundEntry->bWarp = bInWarp;
+			InProgression->PackKeyframeTables(InEyes, InNumMips, bInWarp, FoundEntry->Tables);
+		}
+
+		TArray<FVARIDVFMapTableEntry> PackedEntries;
+		for (const FVARIDVFMapPointTable& Table : FoundEntry->Tables)
+		{
+			PackedEntries.Append(Table.Entries);
+		}
+
+		// can't create an empty buffer. The shader reads no entries
+		if (PackedEntries.Num() == 0)
+		{
+			PackedEntries.AddDefaulted();
+		}
+
+		OutBuffer = CreateStructuredBuffer(InGraphBuilder, TEXT("VFMapProgressionTable"), sizeof(FVARIDVFMapTableEntry), PackedEntries.Num(), PackedEntries.GetData(), sizeof(FVARIDVFMapTableEntry) * PackedEntries.Num(), ERDGInitialDataFlags::None);
+		InGraphBuilder.QueueBufferExtraction(OutBuffer, &FoundEntry->Buffer);
+
+		return *FoundEntry;
+	}
+
+	virtual void ReleaseRHI() override
+	{
+		Entries.Empty();
+	}
+
+private:
+	// by pointer, so a buffer queued for extraction stays where the graph writes it
+	TArray<TUniquePtr<FEntry>> Entries;
+};
+TGlobalResource<FVARIDProgressionTables> GVARIDProgressionTables;
+
+/**
+ * draws the image VF maps of the eyes that have one over the height map (or warp field) the points left, one dispatch per eye.
+ * The point paths don't see image maps, so until an image has loaded its eye keeps just the origin offset
+ */
+static bool BuildHeightMapTextureFromImages_RenderThread
 (
 	FRDGBuilder& InGraphBuilder,
-	const bool InFXEnabled,
-	const TArray<FVARIDVFMapPoint>& InVFMapPoints,
-	const FVector2D& InEyeGazePoint,
-	const float InOriginOffset,
-	FRDGTextureRef OutNormalMapTexture,
-	const FIntRect& ViewportRect,
-	const EStereoscopicPass InStereoPass,
-	const bool InFullField
+	const FVARIDWorkingTexturePlan& InPlan,
+	const TArray<FVARIDVFMapEyeInput>& InEyeInputs,
+	FVARIDSelectVFMap InSelectVFMap,
+	const int32 InMipLevel,
+	float InOriginOffset,
+	FRDGTextureRef OutHeightMapTexture,
+	const bool bInOutputGradient
 )
 {
-	check(OutNormalMapTexture);
-
-	const FRDGTextureDesc& TextureDesc = OutNormalMapTexture->Desc;
+	const FRDGTextureDesc& OutHeightMapTextureDesc = OutHeightMapTexture->Desc;
+	const FIntPoint TextureSize(FMath::Max(OutHeightMapTextureDesc.Extent.X >> InMipLevel, 1), FMath::Max(OutHeightMapTextureDesc.Extent.Y >> InMipLevel, 1));
+	const FVector2D TexelSize(1.0f / TextureSize.X, 1.0f / TextureSize.Y);
+	const FIntRect ViewportRect = FVARIDPyramidLayout::GetMipViewportRect(InPlan.GetActiveRect(), InMipLevel);
+	const int32 RightEyeMinX = InPlan.Eyes.Num() > 1 ? InPlan.Eyes[1].WorkingRect.Min.X >> InMipLevel : ViewportRect.Max.X;
+	const FVector4 SceneUVScaleBias = InPlan.GetSceneUVScaleBias();
 
-	FRDGTextureRef HeightMapTexture = InGraphBuilder.CreateTexture(TextureDesc, TEXT("HeightMapTexture"));
-	if (!BuildHeightMapTexture_RenderThread(InGraphBuilder, InFXEnabled, InVFMapPoints, 0, InEyeGazePoint, InOriginOffset, HeightMapTexture, ViewportRect, InStereoPass, InFullField))
+	for (int32 EyeIndex = 0; EyeIndex < InEyeInputs.Num(); ++EyeIndex)
 	{
-		return false;
-	}
+		const FVARIDVFMapEyeInput& EyeInput = InEyeInputs[EyeIndex];
+		const FVARIDVFMap* VFMap = EyeInput.ProfileEye ? InSelectVFMap(*EyeInput.ProfileEye) : nullptr;
 
-	TShaderMapRef<FVARIDNormalMapCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		if (!VFMap || !VFMap->Image.IsValid() || !VFMap->Image->IsLoaded())
+		{
+			continue;
+		}
 
-	FVARIDNormalMapCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDNormalMapCS::FParameters>();
-	PassParameters->DispatchThreadIDOffset = ViewportRect.Min;
-	PassParameters->TexelSize = FVector2D(1.0f / TextureDesc.Extent.X, 1.0f / TextureDesc.Extent.Y);
-	PassParameters->LinearSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-	PassParameters->PointSampler = TStaticSamplerState<SF_Point, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-	PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(HeightMapTexture, 0));
-	PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutNormalMapTexture, 0));
+		// the same split as the RBF dispatch: the right eye owns the texels from its working rect min onwards
+		const FIntRect RegionRect(
+			EyeIndex == 0 ? ViewportRect.Min.X : RightEyeMinX,
+			ViewportRect.Min.Y,
+			EyeIndex == 0 ? FMath::Min(RightEyeMinX, ViewportRect.Max.X) : ViewportRect.Max.X,
+			ViewportRect.Max.Y);
 
-	FComputeShaderUtils::AddPass(
-		InGraphBuilder,
-		RDG_EVENT_NAME("VARID BuildNormalMapTexture"),
-		ComputeShader,
-		PassParameters,
-		FComputeShaderUtils::GetGroupCount(ViewportRect.Size(), FComputeShaderUtils::kGolden2DGroupSize));
+		if (RegionRect.Area() <= 0)
+		{
+			continue;
+		}
+
+		const FVARIDVFMapImage& Image = *VFMap->Image;
+
+		float XScale = 1.0f;
+		float XOffset = 0.0f;
+		GetStereoPointTransform(EyeInput.StereoPass, XScale, XOffset);
+
+		const FVector2D ImageScale(1.0f / (Image.NormMax.X - Image.NormMin.X), 1.0f / (Image.NormMax.Y - Image.NormMin.Y));
+		const FVector2D NormTexelSize(TexelSize.X * SceneUVScaleBias.X / XScale, TexelSize.Y * SceneUVScaleBias.Y);
+		const float ImageLevel = Image.GetSampleLevel(NormTexelSize);
+		const FIntPoint& ImageLevelSize = Image.GetMips()[FMath::FloorToInt(ImageLevel)].Size;
+
+		FRDGTextureRef ImageTexture = InGraphBuilder.RegisterExternalTexture(GVARIDVFMapImageTextures.FindOrCreate(VFMap->Image), TEXT("VFMapImageTexture"));
+
+		FVARIDVFMapImageCS::FPermutationDomain PermutationVector;
+		PermutationVector.Set<FVARIDOutputGradientDim>(bInOutputGradient);
+		TShaderMapRef<FVARIDVFMapImageCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+
+		FVARIDVFMapImageCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDVFMapImageCS::FParameters>();
+		PassParameters->DispatchThreadIDOffset = RegionRect.Min;
+		PassParameters->InRegionMax = RegionRect.Max;
+		PassParameters->TexelSize = TexelSize;
+		PassParameters->InSceneUVScaleBias = SceneUVScaleBias;
+		PassParameters->InPointScaleBias = FVector4(XScale, 1.0f, EyeInput.GazePoint.X * XScale + XOffset, EyeInput.GazePoint.Y);
+		PassParameters->InImageScaleBias = FVector4(ImageScale.X, ImageScale.Y, -Image.NormMin.X * ImageScale.X, -Image.NormMin.Y * ImageScale.Y);
+		PassParameters->InImageLevel = ImageLevel;
+		PassParameters->InImageTexelSize = FVector2D(1.0f / ImageLevelSize.X, 1.0f / ImageLevelSize.Y);
+		PassParameters->InOriginOffset = InOriginOffset;
+		PassParameters->ImageTexture = ImageTexture;
+		PassParameters->ImageSampler = TStaticSamplerState<SF_Trilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+		if (bInOutputGradient)
+		{
+			const float GradientStep = CVarVARIDWarpGradientStep.GetValueOnRenderThread();
+			PassParameters->InGradientStep = FVector2D(GradientStep, GradientStep * InPlan.SceneExtent.X / InPlan.SceneExtent.Y);
+			PassParameters->OutGradientUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutHeightMapTexture, InMipLevel));
+		}
+		else
+		{
+			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutHeightMapTexture, InMipLevel));
+		}
+
+		FComputeShaderUtils::AddPass(
+			InGraphBuilder,
+			bInOutputGradient ? RDG_EVENT_NAME("VARID - Build Warp Field From Image - MipLevel=%d Eye=%d", InMipLevel, EyeIndex) : RDG_EVENT_NAME("VARID - Build Height Map From Image - MipLevel=%d Eye=%d", InMipLevel, EyeIndex),
+			ComputeShader,
+			PassParameters,
+			FComputeShaderUtils::GetGroupCount(RegionRect.Size(), FComputeShaderUtils::kGolden2DGroupSize));
+	}
 
 	return true;
 }
 
-static bool BuildPositionMapTexture_RenderThread
+/**
+ * r.VARID.VFMap.Interpolation=1: draws the VF map mesh of each eye, one draw per eye, scissored to the texels the RBF dispatch gives that eye.
+ * Eyes without the FX, and full field maps, draw the frame on its own, which leaves just the origin offset
+ */
+static bool BuildHeightMapTextureFromMesh_RenderThread
 (
 	FRDGBuilder& InGraphBuilder,
-	const bool InFXEnabled,
-	const TArray<FVARIDVFMapPoint>& InVFMapPoints,
+	const FVARIDWorkingTexturePlan& InPlan,
+	const TArray<FVARIDVFMapEyeInput>& InEyeInputs,
+	FVARIDSelectVFMap InSelectVFMap,
 	const int32 InMipLevel,
-	const FVector2D& InEyeGazePoint,
 	float InOriginOffset,
-	FRDGTextureRef OutTexture,
-	const FIntRect& InViewportRect,
-	const EStereoscopicPass InStereoPass,
-	const bool InFullField
+	FRDGTextureRef OutHeightMapTexture,
+	const bool bInOutputGradient
 )
 {
-	check(InMipLevel >= 0);
-	check(OutTexture);
+	const FRDGTextureDesc& OutHeightMapTextureDesc = OutHeightMapTexture->Desc;
+	check(OutHeightMapTextureDesc.Flags & TexCreate_RenderTargetable);
 
-	const FRDGTextureDesc& OutTextureDesc = OutTexture->Desc;
-	const FIntPoint TextureSize(FMath::Max(OutTextureDesc.Extent.X >> InMipLevel, 1), FMath::Max(OutTextureDesc.Extent.Y >> InMipLevel, 1));
-	const FVector2D TexelSize(1.0f / TextureSize.X, 1.0f / TextureSize.Y);
-	const FIntPoint DispatchSize(FMath::Max(InViewportRect.Width() >> InMipLevel, 1), FMath::Max(InViewportRect.Height() >> InMipLevel, 1));
-	const FIntPoint DispatchThreadIDOffset(InViewportRect.Min.X >> InMipLevel, InViewportRect.Min.Y >> InMipLevel);
+	const FIntPoint TextureSize(FMath::Max(OutHeightMapTextureDesc.Extent.X >> InMipLevel, 1), FMath::Max(OutHeightMapTextureDesc.Extent.Y >> InMipLevel, 1));
+	const FIntRect ViewportRect = FVARIDPyramidLayout::GetMipViewportRect(InPlan.GetActiveRect(), InMipLevel);
+	const int32 RightEyeMinX = InPlan.Eyes.Num() > 1 ? InPlan.Eyes[1].WorkingRect.Min.X >> InMipLevel : ViewportRect.Max.X;
 
-	TArray<FShaderParameterMapPoint> FilteredPoints;
+	static const FVARIDVFMapMesh FrameMesh = []() { FVARIDVFMapMesh Mesh; Mesh.Build(TArray<FVector>()); return Mesh; }();
 
-	if (InFXEnabled)
+	TArray<FShaderParameterMapPoint> MeshVertices;
+	TArray<uint32> MeshIndices;
+	int32 EyeFirstVertex[2] = { 0, 0 };
+	int32 EyeFirstIndex[2] = { 0, 0 };
+	int32 EyeNumTriangles[2] = { 0, 0 };
+	float EyeOriginOffset[2] = { InOriginOffset, InOriginOffset };
+	FVector4 EyePointScaleBias[2];
+
+	for (int32 EyeIndex = 0; EyeIndex < InEyeInputs.Num(); ++EyeIndex)
 	{
-		if (InFullField && InVFMapPoints.Num() == 1)
+		const FVARIDVFMapEyeInput& EyeInput = InEyeInputs[EyeIndex];
+		const FVARIDVFMap* VFMap = EyeInput.ProfileEye ? InSelectVFMap(*EyeInput.ProfileEye) : nullptr;
+
+		const FVARIDVFMapMesh* Mesh = &FrameMesh;
+		TSharedPtr<const FVARIDVFMapMesh, ESPMode::ThreadSafe> VFMapMesh;
+
+		if (VFMap && VFMap->FullField && VFMap->Points.Num() == 1)
 		{
-			InOriginOffset = InVFMapPoints[0].NormValue;
-			// FilteredPoints will be left empty
+			EyeOriginOffset[EyeIndex] = VFMap->Points.GetValue(0);
 		}
-		else
+		else if (VFMap && VFMap->Points.Num() > 0)
 		{
-			float XScale = 1.0f;
-			float XOffset = 0.0f;
+			// triangulated the first time any copy of the map is drawn like this, then shared
+			VFMapMesh = VFMap->GetMesh();
+			Mesh = VFMapMesh.Get();
+		}
 
-			switch (InStereoPass)
-			{
-			case eSSP_FULL:
-				break;
-			case eSSP_LEFT_EYE:
-				XScale = 0.5f;
-				break;
-			case eSSP_RIGHT_EYE:
-				XScale = 0.5f;
-				XOffset = 0.5f;
-				break;
-			case eSSP_LEFT_EYE_SIDE:
+		float XScale = 1.0f;
+		float XOffset = 0.0f;
+		GetStereoPointTransform(EyeInput.StereoPass, XScale, XOffset);
+		EyePointScaleBias[EyeIndex] = FVector4(XScale, 1.0f, EyeInput.GazePoint.X * XScale + XOffset, EyeInput.GazePoint.Y);
+
+		EyeFirstVertex[EyeIndex] = MeshVertices.Num();
+		EyeFirstIndex[EyeIndex] = MeshIndices.Num();
+		EyeNumTriangles[EyeIndex] = Mesh->GetNumTriangles();
+
+		for (const FVector& Vertex : Mesh->Vertices)
+		{
+			FShaderParameterMapPoint P;
+			P.X = Vertex.X;
+			P.Y = Vertex.Y;
+			P.Value = Vertex.Z;
+			P.Padding = 1.0f;
+			MeshVertices.Add(P);
+		}
+
+		for (const int32 Index : Mesh->Indices)
+		{
+			MeshIndices.Add(Index);
+		}
+	}
+
+	FRDGBufferSRVRef MeshVerticesSRV = InGraphBuilder.CreateSRV(CreateStructuredBuffer(InGraphBuilder, TEXT("VFMapMeshVertices"), sizeof(FShaderParameterMapPoint), MeshVertices.Num(), MeshVertices.GetData(), sizeof(FShaderParameterMapPoint) * MeshVertices.Num(), ERDGInitialDataFlags::None));
+	FRDGBufferSRVRef MeshIndicesSRV = InGraphBuilder.CreateSRV(CreateStructuredBuffer(InGraphBuilder, TEXT("VFMapMeshIndices"), sizeof(uint32), MeshIndices.Num(), MeshIndices.GetData(), sizeof(uint32) * MeshIndices.Num(), ERDGInitialDataFlags::None));
+
+	const float GradientStep = CVarVARIDWarpGradientStep.GetValueOnRenderThread();
+
+	TShaderMapRef<FVARIDVFMapMeshVS> VertexShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+	FVARIDVFMapMeshPS::FPermutationDomain PixelPermutationVector;
+	PixelPermutationVector.Set<FVARIDOutputGradientDim>(bInOutputGradient);
+	TShaderMapRef<FVARIDVFMapMeshPS> PixelShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PixelPermutationVector);
+
+	for (int32 EyeIndex = 0; EyeIndex < InEyeInputs.Num(); ++EyeIndex)
+	{
+		// the same split as the RBF dispatch: the right eye owns the texels from its working rect min onwards
+		const FIntRect ScissorRect(
+			EyeIndex == 0 ? ViewportRect.Min.X : RightEyeMinX,
+			ViewportRect.Min.Y,
+			EyeIndex == 0 ? FMath::Min(RightEyeMinX, ViewportRect.Max.X) : ViewportRect.Max.X,
+			ViewportRect.Max.Y);
+
+		const int32 NumTriangles = EyeNumTriangles[EyeIndex];
+
+		if (ScissorRect.Area() <= 0 || NumTriangles == 0)
+		{
+			continue;
+		}
+
+		FVARIDVFMapMeshParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDVFMapMeshParameters>();
+		PassParameters->InMeshVertices = MeshVerticesSRV;
+		PassParameters->InMeshIndices = MeshIndicesSRV;
+		PassParameters->InFirstIndex = EyeFirstIndex[EyeIndex];
+		PassParameters->InFirstVertex = EyeFirstVertex[EyeIndex];
+		PassParameters->InPointScaleBias = EyePointScaleBias[EyeIndex];
+		PassParameters->InSceneUVScaleBias = InPlan.GetSceneUVScaleBias();
+		PassParameters->InOriginOffset = EyeOriginOffset[EyeIndex];
+		PassParameters->InGradientStep = FVector2D(GradientStep, GradientStep * InPlan.SceneExtent.X / InPlan.SceneExtent.Y);
+		PassParameters->RenderTargets[0] = FRenderTargetBinding(OutHeightMapTexture, EyeIndex == 0 ? ERenderTargetLoadAction::ENoAction : ERenderTargetLoadAction::ELoad, InMipLevel);
+
+		InGraphBuilder.AddPass(
+			bInOutputGradient ? RDG_EVENT_NAME("VARID - Draw Warp Field Mesh - MipLevel=%d Eye=%d", InMipLevel, EyeIndex) : RDG_EVENT_NAME("VARID - Draw Height Map Mesh - MipLevel=%d Eye=%d", InMipLevel, EyeIndex),
+			PassParameters,
+			ERDGPassFlags::Raster,
+			[
+				VertexShader,
+				PixelShader,
+				TextureSize,
+				ScissorRect,
+				NumTriangles,
+				PassParameters
+			](FRHICommandListImmediate& RHICmdList)
+			{
+				FGraphicsPipelineStateInitializer GraphicsPSOInit;
+				RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
+				GraphicsPSOInit.BlendState = TStaticBlendState<>::GetRHI();
+				GraphicsPSOInit.RasterizerState = TStaticRasterizerState<FM_Solid, CM_None>::GetRHI();
+				GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
+				GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GEmptyVertexDeclaration.VertexDeclarationRHI;
+				GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+				GraphicsPSOInit.BoundShaderState.PixelShaderRHI = PixelShader.GetPixelShader();
+				GraphicsPSOInit.PrimitiveType = PT_TriangleList;
+				SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit);
+				SetShaderParameters(RHICmdList, VertexShader, VertexShader.GetVertexShader(), *PassParameters);
+				SetShaderParameters(RHICmdList, PixelShader, PixelShader.GetPixelShader(), *PassParameters);
+				RHICmdList.SetViewport(0.0f, 0.0f, 0.0f, TextureSize.X, TextureSize.Y, 1.0f);
+				RHICmdList.SetScissorRect(true, ScissorRect.Min.X, ScissorRect.Min.Y, ScissorRect.Max.X, ScissorRect.Max.Y);
+				RHICmdList.DrawPrimitive(0, NumTriangles, 1);
+			});	// end pass
+	}
+
+	return true;
+}
+
+/**
+ * even if we have no points to pass in, we still generate a texture. in the case of zero points the texture would be black
+ * with bInOutputGradient the analytic gradient of the height map (the warp field) is written to a two channel texture instead
+ */
+static bool BuildHeightMapTexture_RenderThread
+(
+	FRDGBuilder& InGraphBuilder,
+	const FVARIDWorkingTexturePlan& InPlan,
+	const TArray<FVARIDVFMapEyeInput>& InEyeInputs,
+	FVARIDSelectVFMap InSelectVFMap,
+	const int32 InMipLevel,
+	float InOriginOffset,
+	FRDGTextureRef OutHeightMapTexture,
+	const bool bInOutputGradient = false
+)
+{
+	check(InMipLevel >= 0);
+	check(OutHeightMapTexture);
+	check(InEyeInputs.Num() == InPlan.Eyes.Num() && InPlan.Eyes.Num() <= 2);
+
+	// image maps are drawn over the top by BuildHeightMapTextureFromImages_RenderThread. The point paths treat their eye as having no points
+	auto SelectPointVFMap = [&InSelectVFMap](const FVARIDEye& Eye) -> const FVARIDVFMap*
+	{
+		const FVARIDVFMap* VFMap = InSelectVFMap(Eye);
+		return VFMap && VFMap->Image.IsValid() ? nullptr : VFMap;
+	};
+
+	if (CVarVARIDVFMapInterpolation.GetValueOnRenderThread() != 0)
+	{
+		return BuildHeightMapTextureFromMesh_RenderThread(InGraphBuilder, InPlan, InEyeInputs, SelectPointVFMap, InMipLevel, InOriginOffset, OutHeightMapTexture, bInOutputGradient)
+			&& BuildHeightMapTextureFromImages_RenderThread(InGraphBuilder, InPlan, InEyeInputs, InSelectVFMap, InMipLevel, InOriginOffset, OutHeightMapTexture, bInOutputGradient);
+	}
+
+	const FRDGTextureDesc& OutHeightMapTextureDesc = OutHeightMapTexture->Desc;
+	const FIntPoint TextureSize(FMath::Max(OutHeightMapTextureDesc.Extent.X >> InMipLevel, 1), FMath::Max(OutHeightMapTextureDesc.Extent.Y >> InMipLevel, 1));
+	const FVector2D TexelSize(1.0f / TextureSize.X, 1.0f / TextureSize.Y);
+	const FIntRect ViewportRect = FVARIDPyramidLayout::GetMipViewportRect(InPlan.GetActiveRect(), InMipLevel);
+
+	TArray<FShaderParameterMapPoint> FilteredPoints;
+	int32 EyePointRange[4] = { 0, 0, 0, 0 };
+	float EyeOriginOffset[2] = { InOriginOffset, InOriginOffset };
+	float EyeCurvatureBound[2] = { 0.0f, 0.0f };
+
+	for (int32 EyeIndex = 0; EyeIndex < InEyeInputs.Num(); ++EyeIndex)
+	{
+		const FVARIDVFMapEyeInput& EyeInput = InEyeInputs[EyeIndex];
+		const FVARIDVFMap* VFMap = EyeInput.ProfileEye ? SelectPointVFMap(*EyeInput.ProfileEye) : nullptr;
+
+		EyePointRange[EyeIndex * 2] = FilteredPoints.Num();
+
+		if (!VFMap)
+		{
+			continue;
+		}
+
+		const FVARIDVFMapPoints& VFMapPoints = VFMap->Points;
+
+		if (VFMap->FullField && VFMapPoints.Num() == 1)
+		{
+			EyeOriginOffset[EyeIndex] = VFMapPoints.GetValue(0);
+			// no points for this eye
+			continue;
+		}
+
+		// points are in scene colour UV. the shader takes working texels there with InSceneUVScaleBias
+		float XScale = 1.0f;
+		float XOffset = 0.0f;
+		GetStereoPointTransform(EyeInput.StereoPass, XScale, XOffset);
+		EyeCurvatureBound[EyeIndex] = VFMap->GetCurvatureBound(XScale);
+
+		FVARIDVFMapPointTable::AddShaderPoints(VFMapPoints, XScale, XOffset, EyeInput.GazePoint, FilteredPoints);
+
+		EyePointRange[EyeIndex * 2 + 1] = FilteredPoints.Num() - EyePointRange[EyeIndex * 2];
+	}
+
+	// Even if there are no points Keep going - still need to generate a texture as the remaining parts of the render pipeline are relying on a valid texture to exist.
+
+	const FVector4 SceneUVScaleBias = InPlan.GetSceneUVScaleBias();
+	const int32 RightEyeMinX = InPlan.Eyes.Num() > 1 ? InPlan.Eyes[1].WorkingRect.Min.X >> InMipLevel : MAX_int32;
+
+	// r.VARID.VFMap.LowRes: the coarsest node spacing that keeps every eye within the error. The warp field is a derivative, which the bound doesn't cover
+	int32 ReductionFactor = 1;
+	if (!bInOutputGradient && FilteredPoints.Num() > 0 && UseVFMapLowRes_RenderThread())
+	{
+		const FVector2D SceneTexelSize(TexelSize.X * SceneUVScaleBias.X, TexelSize.Y * SceneUVScaleBias.Y);
+		const float MaxError = GetVFMapLowResMaxError_RenderThread();
+
+		ReductionFactor = FVARIDVFMapResolution::MaxReductionFactor;
+		for (int32 EyeIndex = 0; EyeIndex < InEyeInputs.Num(); ++EyeIndex)
+		{
+			ReductionFactor = FMath::Min(ReductionFactor, FVARIDVFMapResolution::GetReductionFactor(EyeCurvatureBound[EyeIndex], SceneTexelSize, MaxError, FVARIDVFMapResolution::MaxReductionFactor));
+		}
+	}
+
+	const FVARIDVFMapNodeGrid NodeGrid = FVARIDVFMapNodeGrid::Create(ViewportRect, RightEyeMinX, ReductionFactor);
+	const bool bLowRes = NodeGrid.Factor > 1 && NodeGrid.Size.X > 0 && NodeGrid.Size.Y > 0;
+
+	FVARIDHeightMapCS::FPermutationDomain PermutationVector;
+	PermutationVector.Set<FVARIDOutputGradientDim>(bInOutputGradient);
+	TShaderMapRef<FVARIDHeightMapCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+
+	FVARIDHeightMapCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDHeightMapCS::FParameters>();
+	PassParameters->DispatchThreadIDOffset = bLowRes ? FIntPoint(0, 0) : ViewportRect.Min;
+	PassParameters->TexelSize = TexelSize;
+	PassParameters->LinearSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+	PassParameters->PointSampler = TStaticSamplerState<SF_Point, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+	PassParameters->InSceneUVScaleBias = SceneUVScaleBias;
+	PassParameters->InRightEyeMinX = bLowRes ? NodeGrid.RightEyeNodeMinX : RightEyeMinX;
+	PassParameters->InNodeTransform = NodeGrid.NodeTransform;
+	PassParameters->bInClampOutput = bLowRes ? 0 : 1;
+	PassParameters->InEyePointRange = FIntVector4(EyePointRange[0], EyePointRange[1], EyePointRange[2], EyePointRange[3]);
+	PassParameters->InOriginOffset = FVector2D(EyeOriginOffset[0], EyeOriginOffset[1]);	// intensity origin
+	PassParameters->NumVFMapPoints = FilteredPoints.Num();
+	if (FilteredPoints.Num() > 0)
+	{
+		PassParameters->VFMapPoints = InGraphBuilder.CreateSRV(CreateStructuredBuffer(InGraphBuilder, TEXT("VFMapPoints"), sizeof(FShaderParameterMapPoint), FilteredPoints.Num(), FilteredPoints.GetData(), sizeof(FShaderParameterMapPoint) * FilteredPoints.Num(), ERDGInitialDataFlags::None));
+	}
+	else
+	{
+		// HACK cant pass array with size zero. Have to pass at least one element. 
+		FShaderParameterMapPoint DummyPoint;
+		PassParameters->VFMapPoints = InGraphBuilder.CreateSRV(CreateStructuredBuffer(InGraphBuilder, TEXT("VFMapPoints"), sizeof(FShaderParameterMapPoint), 1, &DummyPoint, sizeof(FShaderParameterMapPoint), ERDGInitialDataFlags::None));
+	}
+	if (bInOutputGradient)
+	{
+		const float GradientStep = CVarVARIDWarpGradientStep.GetValueOnRenderThread();
+		PassParameters->InGradientStep = FVector2D(GradientStep, GradientStep * InPlan.SceneExtent.X / InPlan.SceneExtent.Y);
+		PassParameters->OutGradientUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutHeightMapTexture, InMipLevel));
+	}
+	else if (bLowRes)
+	{
+		FRDGTextureDesc NodeTextureDesc = FRDGTextureDesc::Create2D
+		(
+			NodeGrid.Size,
+			EPixelFormat::PF_R32_FLOAT,
+			FClearValueBinding::Black,
+			TexCreate_ShaderResource | TexCreate_UAV,
+			1,
+			1
+		);
+
+		FRDGTextureRef NodeTexture = InGraphBuilder.CreateTexture(NodeTextureDesc, TEXT("VFMapNodeTexture"));
+		PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(NodeTexture));
+
+		FComputeShaderUtils::AddPass(
+			InGraphBuilder,
+			RDG_EVENT_NAME("VARID - Build Height Map Nodes - MipLevel=%d Factor=%d", InMipLevel, NodeGrid.Factor),
+			ComputeShader,
+			PassParameters,
+			FComputeShaderUtils::GetGroupCount(NodeGrid.Size, FComputeShaderUtils::kGolden2DGroupSize));
+
+		TShaderMapRef<FVARIDVFMapUpsampleCS> UpsampleShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+		FVARIDVFMapUpsampleCS::FParameters* UpsampleParameters = InGraphBuilder.AllocParameters<FVARIDVFMapUpsampleCS::FParameters>();
+		UpsampleParameters->DispatchThreadIDOffset = ViewportRect.Min;
+		UpsampleParameters->InRegionMax = ViewportRect.Max;
+		UpsampleParameters->InRightEyeMinX = RightEyeMinX;
+		UpsampleParameters->InNodeTransform = NodeGrid.NodeTransform;
+		UpsampleParameters->InLastNode = FIntVector4(NodeGrid.LastNode[0].X, NodeGrid.LastNode[0].Y, NodeGrid.LastNode[1].X, NodeGrid.LastNode[1].Y);
+		UpsampleParameters->InNodeTexture = NodeTexture;
+		UpsampleParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutHeightMapTexture, InMipLevel));
+
+		FComputeShaderUtils::AddPass(
+			InGraphBuilder,
+			RDG_EVENT_NAME("VARID - Upsample Height Map - MipLevel=%d Factor=%d", InMipLevel, NodeGrid.Factor),
+			UpsampleShader,
+			UpsampleParameters,
+			FComputeShaderUtils::GetGroupCount(ViewportRect.Size(), FComputeShaderUtils::kGolden2DGroupSize));
+
+		return BuildHeightMapTextureFromImages_RenderThread(InGraphBuilder, InPlan, InEyeInputs, InSelectVFMap, InMipLevel, InOriginOffset, OutHeightMapTexture, bInOutputGradient);
+	}
+	else
+	{
+		PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutHeightMapTexture, InMipLevel));
+	}
+
+	FComputeShaderUtils::AddPass(
+		InGraphBuilder,
+		bInOutputGradient ? RDG_EVENT_NAME("VARID - Build Warp Field - MipLevel=%d", InMipLevel) : RDG_EVENT_NAME("VARID - Build Height Map - MipLevel=%d", InMipLevel),
+		ComputeShader,
+		PassParameters,
+		FComputeShaderUtils::GetGroupCount(ViewportRect.Size(), FComputeShaderUtils::kGolden2DGroupSize));
+
+	return BuildHeightMapTextureFromImages_RenderThread(InGraphBuilder, InPlan, InEyeInputs, InSelectVFMap, InMipLevel, InOriginOffset, OutHeightMapTexture, bInOutputGradient);
+}
+
+static bool BuildNormalMapTexture_RenderThread
+(
+	FRDGBuilder& InGraphBuilder,
+	const FVARIDWorkingTexturePlan& InPlan,
+	const TArray<FVARIDVFMapEyeInput>& InEyeInputs,
+	FVARIDSelectVFMap InSelectVFMap,
+	const float InOriginOffset,
+	FRDGTextureRef OutNormalMapTexture
+)
+{
+	check(OutNormalMapTexture);
+
+	// single pass, no intermediate height map
+	if (CVarVARIDWarpAnalyticGradient.GetValueOnRenderThread() != 0)
+	{
+		return BuildHeightMapTexture_RenderThread(InGraphBuilder, InPlan, InEyeInputs, InSelectVFMap, 0, InOriginOffset, OutNormalMapTexture, true);
+	}
+
+	const FRDGTextureDesc& TextureDesc = OutNormalMapTexture->Desc;
+	const FIntRect ViewportRect = InPlan.GetActiveRect();
+
+	FRDGTextureRef HeightMapTexture = InGraphBuilder.CreateTexture(TextureDesc, TEXT("HeightMapTexture"));
+	if (!BuildHeightMapTexture_RenderThread(InGraphBuilder, InPlan, InEyeInputs, InSelectVFMap, 0, InOriginOffset, HeightMapTexture))
+	{
+		return false;
+	}
+
+	TShaderMapRef<FVARIDNormalMapCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+	FVARIDNormalMapCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDNormalMapCS::FParameters>();
+	PassParameters->DispatchThreadIDOffset = ViewportRect.Min;
+	PassParameters->TexelSize = FVector2D(1.0f / TextureDesc.Extent.X, 1.0f / TextureDesc.Extent.Y);
+	PassParameters->LinearSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+	PassParameters->PointSampler = TStaticSamplerState<SF_Point, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+	PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(HeightMapTexture, 0));
+	PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutNormalMapTexture, 0));
+
+	FComputeShaderUtils::AddPass(
+		InGraphBuilder,
+		RDG_EVENT_NAME("VARID BuildNormalMapTexture"),
+		ComputeShader,
+		PassParameters,
+		FComputeShaderUtils::GetGroupCount(ViewportRect.Size(), FComputeShaderUtils::kGolden2DGroupSize));
+
+	return true;
+}
+
+/**
+ * r.VARID.VFMap.Combined=1: the blur, inpaint and contrast VF maps, and the warp field with r.VARID.Warp.AnalyticGradient, from one dispatch
+ * of VARIDVFMapCombinedCS.usf over a table of all their points. Image maps are drawn over the top afterwards, as in BuildHeightMapTexture_RenderThread.
+ * Returns whether the warp field was built
+ */
+static bool BuildVFMapTexturesCombined_RenderThread
+(
+	FRDGBuilder& InGraphBuilder,
+	const FVARIDWorkingTexturePlan& InPlan,
+	const TArray<FVARIDVFMapEyeInput>& InEyeInputs,
+	FRDGTextureRef OutBlurVFMapTexture,
+	FRDGTextureRef OutContrastVFMapTexture,
+	FRDGTextureRef OutInpaintVFMapTexture,
+	FRDGTextureRef OutWarpVFMapTexture
+)
+{
+	check(InEyeInputs.Num() == InPlan.Eyes.Num() && InPlan.Eyes.Num() <= 2);
+
+	const int32 NumMips = OutContrastVFMapTexture->Desc.NumMips;
+	const bool bOutputWarp = CVarVARIDWarpAnalyticGradient.GetValueOnRenderThread() != 0;
+	check(NumMips <= MAX_NUM_MIP_LEVELS);
+
+	// a progression blends the keyframe tables it uploaded the first time, rather than packing the points of its profile at this time. Every eye must be of it
+	const TSharedPtr<const FVARIDProfileProgression, ESPMode::ThreadSafe> Progression = InEyeInputs.Num() > 0 ? InEyeInputs[0].Progression : nullptr;
+	const bool bProgression = Progression.IsValid() && Progression->CanPackKeyframeTables()
+		&& !InEyeInputs.ContainsByPredicate([&Progression](const FVARIDVFMapEyeInput& EyeInput) { return EyeInput.Progression != Progression; });
+
+	FVARIDVFMapPointTable Table;
+	FRDGBufferRef TableBuffer = nullptr;
+	int32 NumKeyframeEntries = 0;
+	int32 Keyframes[2] = { 0, 0 };
+	float KeyframeAlpha = 0.0f;
+	FVector2D GazeOffsets[2] = { FVector2D::ZeroVector, FVector2D::ZeroVector };
+
+	if (bProgression)
+	{
+		TArray<FVARIDProgressionTableEye> TableEyes;
+
+		for (int32 EyeIndex = 0; EyeIndex < InEyeInputs.Num(); ++EyeIndex)
+		{
+			const FVARIDVFMapEyeInput& EyeInput = InEyeInputs[EyeIndex];
+
+			float XScale = 1.0f;
+			float XOffset = 0.0f;
+			GetStereoPointTransform(EyeInput.StereoPass, XScale, XOffset);
+
+			TableEyes.Add(FVARIDProgressionTableEye(EyeInput.EyeIndex, XScale, XOffset));
+			GazeOffsets[EyeIndex] = FVARIDProfileProgression::GetGazeOffset(TableEyes.Last(), EyeInput.GazePoint);
+		}
+
+		const FVARIDProgressionTables::FEntry& ProgressionTables = GVARIDProgressionTables.FindOrCreate(InGraphBuilder, Progression, TableEyes, NumMips, bOutputWarp, TableBuffer);
+		Progression->GetSegment(InEyeInputs[0].ProgressionTime, Keyframes[0], Keyframes[1], KeyframeAlpha);
+
+		// every keyframe has the same entries. Only the origin offsets are blended here
+		const FVARIDVFMapPointTable& Table0 = ProgressionTables.Tables[Keyframes[0]];
+		FMemory::Memcpy(Table.EyeEntryRange, Table0.EyeEntryRange, sizeof(Table.EyeEntryRange));
+		FVARIDProfileProgression::BlendOriginOffsets(Table0, ProgressionTables.Tables[Keyframes[1]], KeyframeAlpha, Table.OriginOffsets);
+		NumKeyframeEntries = Table0.Entries.Num();
+	}
+	else
+	{
+		for (const FVARIDVFMapEyeInput& EyeInput : InEyeInputs)
+		{
+			float XScale = 1.0f;
+			float XOffset = 0.0f;
+			GetStereoPointTransform(EyeInput.StereoPass, XScale, XOffset);
+
+			Table.AddEye(EyeInput.ProfileEye, NumMips, bOutputWarp, XScale, XOffset, EyeInput.GazePoint);
+		}
+	}
+
+	const FIntRect ViewportRect = InPlan.GetActiveRect();
+
+	FVARIDVFMapCombinedCS::FPermutationDomain PermutationVector;
+	PermutationVector.Set<FVARIDProgressionDim>(bProgression);
+	TShaderMapRef<FVARIDVFMapCombinedCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+
+	FVARIDVFMapCombinedCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDVFMapCombinedCS::FParameters>();
+	PassParameters->InViewportMin = ViewportRect.Min;
+	PassParameters->InViewportSize = ViewportRect.Size();
+	PassParameters->InExtent = OutContrastVFMapTexture->Desc.Extent;
+	PassParameters->InNumMips = NumMips;
+	PassParameters->InSceneUVScaleBias = InPlan.GetSceneUVScaleBias();
+	PassParameters->InRightEyeMinX = InPlan.Eyes.Num() > 1 ? InPlan.Eyes[1].WorkingRect.Min.X : MAX_int32;
+	PassParameters->InEyeEntryRange = FIntVector4(Table.EyeEntryRange[0], Table.EyeEntryRange[1], Table.EyeEntryRange[2], Table.EyeEntryRange[3]);
+	for (int32 Channel = 0; Channel < EVARIDVFMapChannel::Num; ++Channel)
+	{
+		PassParameters->InOriginOffsets[Channel] = FVector4(Table.OriginOffsets[Channel].X, Table.OriginOffsets[Channel].Y, 0.0f, 0.0f);
+	}
+	PassParameters->bInOutputWarp = bOutputWarp ? 1 : 0;
+	const float GradientStep = CVarVARIDWarpGradientStep.GetValueOnRenderThread();
+	PassParameters->InGradientStep = FVector2D(GradientStep, GradientStep * InPlan.SceneExtent.X / InPlan.SceneExtent.Y);
+
+	PassParameters->InNumKeyframeEntries = NumKeyframeEntries;
+	PassParameters->InKeyframes = FIntPoint(Keyframes[0], Keyframes[1]);
+	PassParameters->InKeyframeAlpha = KeyframeAlpha;
+	PassParameters->InGazeOffsets = FVector4(GazeOffsets[0].X, GazeOffsets[0].Y, GazeOffsets[1].X, GazeOffsets[1].Y);
+
+	if (bProgression)
+	{
+		PassParameters->VFMapTable = InGraphBuilder.CreateSRV(TableBuffer);
+	}
+	else if (Table.Entries.Num() > 0)
+	{
+		PassParameters->VFMapTable = InGraphBuilder.CreateSRV(CreateStructuredBuffer(InGraphBuilder, TEXT("VFMapTable"), sizeof(FVARIDVFMapTableEntry), Table.Entries.Num(), Table.Entries.GetData(), sizeof(FVARIDVFMapTableEntry) * Table.Entries.Num(), ERDGInitialDataFlags::None));
+	}
+	else
+	{
+		// can't create an empty buffer. The shader reads no entries
+		FVARIDVFMapTableEntry DummyEntry;
+		PassParameters->VFMapTable = InGraphBuilder.CreateSRV(CreateStructuredBuffer(InGraphBuilder, TEXT("VFMapTable"), sizeof(FVARIDVFMapTableEntry), 1, &DummyEntry, sizeof(FVARIDVFMapTableEntry), ERDGInitialDataFlags::None));
+	}
+
+	PassParameters->OutBlurUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutBlurVFMapTexture, 0));
+	PassParameters->OutInpaintUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutInpaintVFMapTexture, 0));
+	PassParameters->OutWarpUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutWarpVFMapTexture, 0));	// not written without bInOutputWarp
+
+	// unused slots alias the last mip. the shader never touches them
+	FRDGTextureUAVRef* ContrastMipUAVs[MAX_NUM_MIP_LEVELS] =
+	{
+		&PassParameters->OutContrastMip0, &PassParameters->OutContrastMip1, &PassParameters->OutContrastMip2, &PassParameters->OutContrastMip3, &PassParameters->OutContrastMip4,
+		&PassParameters->OutContrastMip5, &PassParameters->OutContrastMip6, &PassParameters->OutContrastMip7, &PassParameters->OutContrastMip8, &PassParameters->OutContrastMip9
+	};
+
+	for (int32 MipLevel = 0; MipLevel < MAX_NUM_MIP_LEVELS; ++MipLevel)
+	{
+		*ContrastMipUAVs[MipLevel] = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutContrastVFMapTexture, FMath::Min(MipLevel, NumMips - 1)));
+	}
+
+	FComputeShaderUtils::AddPass(
+		InGraphBuilder,
+		RDG_EVENT_NAME("VARID - Build VF Maps Combined - NumMips=%d Entries=%d Progression=%d", NumMips, bProgression ? NumKeyframeEntries : Table.Entries.Num(), bProgression ? 1 : 0),
+		ComputeShader,
+		PassParameters,
+		FComputeShaderUtils::GetGroupCount(ViewportRect.Size(), FComputeShaderUtils::kGolden2DGroupSize));
+
+	BuildHeightMapTextureFromImages_RenderThread(InGraphBuilder, InPlan, InEyeInputs, [](const FVARIDEye& Eye) { return Eye.Blur.Enabled ? &Eye.Blur.VFMap : nullptr; }, 0, 0.0f, OutBlurVFMapTexture, false);
+	for (int32 MipLevel = 0; MipLevel < NumMips; MipLevel++)
+	{
+		BuildHeightMapTextureFromImages_RenderThread(InGraphBuilder, InPlan, InEyeInputs, [MipLevel](const FVARIDEye& Eye) { return Eye.Contrast.Enabled && Eye.Contrast.VFMaps.IsValidIndex(MipLevel) ? &Eye.Contrast.VFMaps[MipLevel] : nullptr; }, MipLevel, 0.0f, OutContrastVFMapTexture, false);
+	}
+	BuildHeightMapTextureFromImages_RenderThread(InGraphBuilder, InPlan, InEyeInputs, [](const FVARIDEye& Eye) { return Eye.Inpaint.Enabled ? &Eye.Inpaint.VFMap : nullptr; }, 0, 0.0f, OutInpaintVFMapTexture, false);
+	if (bOutputWarp)
+	{
+		BuildHeightMapTextureFromImages_RenderThread(InGraphBuilder, InPlan, InEyeInputs, [](const FVARIDEye& Eye) { return Eye.Warp.Enabled ? &Eye.Warp.VFMap : nullptr; }, 0, 0.5f, OutWarpVFMapTexture, true);
+	}
+
+	return bOutputWarp;
+}
+
+static bool BuildPositionMapTexture_RenderThread
+(
+	FRDGBuilder& InGraphBuilder,
+	const bool InFXEnabled,
+	const FVARIDVFMapPoints& InVFMapPoints,
+	const int32 InMipLevel,
+	const FVector2D& InEyeGazePoint,
+	float InOriginOffset,
+	FRDGTextureRef OutTexture,
+	const FIntRect& InViewportRect,
+	const EStereoscopicPass InStereoPass,
+	const bool InFullField
+)
+{
+	check(InMipLevel >= 0);
+	check(OutTexture);
+
+	const FRDGTextureDesc& OutTextureDesc = OutTexture->Desc;
+	const FIntPoint TextureSize(FMath::Max(OutTextureDesc.Extent.X >> InMipLevel, 1), FMath::Max(OutTextureDesc.Extent.Y >> InMipLevel, 1));
+	const FVector2D TexelSize(1.0f / TextureSize.X, 1.0f / TextureSize.Y);
+	const FIntPoint DispatchSize(FMath::Max(InViewportRect.Width() >> InMipLevel, 1), FMath::Max(InViewportRect.Height() >> InMipLevel, 1));
+	const FIntPoint DispatchThreadIDOffset(InViewportRect.Min.X >> InMipLevel, InViewportRect.Min.Y >> InMipLevel);
+
+	TArray<FShaderParameterMapPoint> FilteredPoints;
+
+	if (InFXEnabled)
+	{
+		if (InFullField && InVFMapPoints.Num() == 1)
+		{
+			InOriginOffset = InVFMapPoints.GetValue(0);
+			// FilteredPoints will be left empty
+		}
+		else
+		{
+			float XScale = 1.0f;
+			float XOffset = 0.0f;
+
+			switch (InStereoPass)
+			{
+			case eSSP_FULL:
+				break;
+			case eSSP_LEFT_EYE:
+				XScale = 0.5f;
+				break;
+			case eSSP_RIGHT_EYE:
+				XScale = 0.5f;
+				XOffset = 0.5f;
+				break;
+			case eSSP_LEFT_EYE_SIDE:
 				break;
 			case eSSP_RIGHT_EYE_SIDE:
 				break;
@@ -749,673 +2136,2229 @@ static bool BuildPositionMapTexture_RenderThread
 				break;
 			}
 
-			for (int32 i = 0; i < InVFMapPoints.Num(); ++i)
+			FVARIDVFMapPointTable::AddShaderPoints(InVFMapPoints, XScale, XOffset, InEyeGazePoint, FilteredPoints);
+		}
+	}
+
+	// Even if there are no points Keep going - still need to generate a texture as the remaining parts of the render pipeline are relying on a valid texture to exist.
+
+	TShaderMapRef<FVARIDPositionMapCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+	FVARIDPositionMapCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDPositionMapCS::FParameters>();
+	PassParameters->DispatchThreadIDOffset = DispatchThreadIDOffset;
+	PassParameters->TexelSize = TexelSize;
+	PassParameters->LinearSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+	PassParameters->PointSampler = TStaticSamplerState<SF_Point, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+	PassParameters->InOriginOffset = InOriginOffset;	// intensity origin
+	PassParameters->NumVFMapPoints = FilteredPoints.Num();
+	if (FilteredPoints.Num() > 0)
+	{
+		PassParameters->VFMapPoints = InGraphBuilder.CreateSRV(CreateStructuredBuffer(InGraphBuilder, TEXT("VFMapPoints"), sizeof(FShaderParameterMapPoint), FilteredPoints.Num(), FilteredPoints.GetData(), sizeof(FShaderParameterMapPoint) * FilteredPoints.Num(), ERDGInitialDataFlags::None));
+	}
+	else
+	{
+		// HACK cant pass array with size zero. Have to pass at least one element. 
+		FShaderParameterMapPoint DummyPoint;
+		PassParameters->VFMapPoints = InGraphBuilder.CreateSRV(CreateStructuredBuffer(InGraphBuilder, TEXT("VFMapPoints"), sizeof(FShaderParameterMapPoint), 1, &DummyPoint, sizeof(FShaderParameterMapPoint), ERDGInitialDataFlags::None));
+	}
+	PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutTexture, InMipLevel));
+
+	FComputeShaderUtils::AddPass(
+		InGraphBuilder,
+		RDG_EVENT_NAME("VARID - Build Position Map - MipLevel=%d", InMipLevel),
+		ComputeShader,
+		PassParameters,
+		FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+
+	return true;
+}
+
+/*****************************************************************************************************************/
+// tile classification
+
+/** the output of ClassifyTiles_RenderThread. Entries of both lists are 8x8 thread groups of the regular dispatch over the region */
+struct FVARIDTileListBuffers
+{
+public:
+	FRDGBufferRef IndirectArgsBuffer = nullptr;	// a FRHIDispatchIndirectParameters per list, AFFECTED_TILE_LIST then UNAFFECTED_TILE_LIST
+	FRDGBufferSRVRef AffectedTileListSRV = nullptr;
+	FRDGBufferSRVRef UnaffectedTileListSRV = nullptr;
+	FRDGBufferSRVRef TileCountersSRV = nullptr;	// the number of entries in each list, in the same order
+};
+
+/** what the compute compositor samples on top of the contrast VF map. Its tiles are affected if either moves the output by more than Threshold */
+struct FVARIDCompositorTileInputs
+{
+public:
+	FRDGTextureRef BlurVFMapTexture = nullptr;
+	FRDGTextureRef WarpVFMapTexture = nullptr;
+	float BlurScale = 0.0f;					// blur VF map -> mip level sampled
+	FVector2D WarpTexelScale = FVector2D::ZeroVector;	// warp VF map -> texels the sample moves
+	float Threshold = 0.0f;
+};
+
+/**
+ * a 16x16 tile is affected if its VF map is above InThreshold anywhere in its footprint on levels InBaseMipLevel .. InBaseMipLevel + InNumLevels - 1.
+ * InRegionRect is at InBaseMipLevel. With InCompositor, which needs InBaseMipLevel 0, the compositor's blur and warp can make it affected too
+ */
+static FVARIDTileListBuffers ClassifyTiles_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InVFMapMipTexture, int32 InBaseMipLevel, int32 InNumLevels, const FIntRect& InRegionRect, int32 InDilation, float InThreshold, const FVARIDCompositorTileInputs* InCompositor = nullptr)
+{
+	check(InVFMapMipTexture);
+	check(InNumLevels > 0);
+	check(InBaseMipLevel + InNumLevels <= InVFMapMipTexture->Desc.NumMips);
+	check(!InCompositor || InBaseMipLevel == 0);
+
+	const FIntPoint RegionSize = InRegionRect.Size();
+	const FIntVector GroupCount = FComputeShaderUtils::GetGroupCount(RegionSize, FComputeShaderUtils::kGolden2DGroupSize);
+	const FIntVector TileCount = FComputeShaderUtils::GetGroupCount(RegionSize, TILE_CLASSIFY_TILE_SIZE);
+	const uint32 MaxNumListEntries = GroupCount.X * GroupCount.Y;
+
+	FRDGBufferRef AffectedTileListBuffer = InGraphBuilder.CreateBuffer(FRDGBufferDesc::CreateBufferDesc(sizeof(uint32), MaxNumListEntries), TEXT("VARID_TEMP_AffectedTileList"));
+	FRDGBufferRef UnaffectedTileListBuffer = InGraphBuilder.CreateBuffer(FRDGBufferDesc::CreateBufferDesc(sizeof(uint32), MaxNumListEntries), TEXT("VARID_TEMP_UnaffectedTileList"));
+	FRDGBufferRef TileCounterBuffer = InGraphBuilder.CreateBuffer(FRDGBufferDesc::CreateBufferDesc(sizeof(uint32), 2), TEXT("VARID_TEMP_TileCounters"));
+	FRDGBufferRef IndirectArgsBuffer = InGraphBuilder.CreateBuffer(FRDGBufferDesc::CreateIndirectDesc(6), TEXT("VARID_TEMP_TileListIndirectArgs"));	// 2x FRHIDispatchIndirectParameters
+
+	FRDGBufferUAVRef TileCounterUAV = InGraphBuilder.CreateUAV(TileCounterBuffer, PF_R32_UINT);
+	AddClearUAVPass(InGraphBuilder, TileCounterUAV, 0);
+
+	{
+		FVARIDTileClassifyCS::FPermutationDomain PermutationVector;
+		PermutationVector.Set<FVARIDClassifyCompositorDim>(InCompositor != nullptr);
+		TShaderMapRef<FVARIDTileClassifyCS> ClassifyComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+
+		FVARIDTileClassifyCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDTileClassifyCS::FParameters>();
+		PassParameters->InRegionMin = InRegionRect.Min;
+		PassParameters->InRegionSize = RegionSize;
+		PassParameters->InBaseMipLevel = InBaseMipLevel;
+		PassParameters->InNumLevels = InNumLevels;
+		PassParameters->InDilation = InDilation;
+		PassParameters->InThreshold = InThreshold;
+		PassParameters->InVFMapSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(InVFMapMipTexture));
+		PassParameters->OutAffectedTileList = InGraphBuilder.CreateUAV(AffectedTileListBuffer, PF_R32_UINT);
+		PassParameters->OutUnaffectedTileList = InGraphBuilder.CreateUAV(UnaffectedTileListBuffer, PF_R32_UINT);
+		PassParameters->OutTileCounters = TileCounterUAV;
+
+		if (InCompositor)
+		{
+			PassParameters->InBlurVFMapSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InCompositor->BlurVFMapTexture, 0));
+			PassParameters->InWarpVFMapSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InCompositor->WarpVFMapTexture, 0));
+			PassParameters->InBlurScale = InCompositor->BlurScale;
+			PassParameters->InWarpTexelScale = InCompositor->WarpTexelScale;
+			PassParameters->InCompositorThreshold = InCompositor->Threshold;
+		}
+
+		FComputeShaderUtils::AddPass(
+			InGraphBuilder,
+			RDG_EVENT_NAME("VARID - Classify Tiles - MipLevel=%d - NumLevels=%d%s", InBaseMipLevel, InNumLevels, InCompositor ? TEXT(" - Compositor") : TEXT("")),
+			ClassifyComputeShader,
+			PassParameters,
+			TileCount);
+	}
+
+	{
+		TShaderMapRef<FVARIDTileListIndirectArgsCS> IndirectArgsComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+		FVARIDTileListIndirectArgsCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDTileListIndirectArgsCS::FParameters>();
+		PassParameters->OutTileCounters = TileCounterUAV;
+		PassParameters->OutIndirectArgs = InGraphBuilder.CreateUAV(IndirectArgsBuffer, PF_R32_UINT);
+
+		FComputeShaderUtils::AddPass(
+			InGraphBuilder,
+			RDG_EVENT_NAME("VARID - Classify Tiles - Build Indirect Args"),
+			IndirectArgsComputeShader,
+			PassParameters,
+			FIntVector(1, 1, 1));
+	}
+
+	FVARIDTileListBuffers TileLists;
+	TileLists.IndirectArgsBuffer = IndirectArgsBuffer;
+	TileLists.AffectedTileListSRV = InGraphBuilder.CreateSRV(AffectedTileListBuffer, PF_R32_UINT);
+	TileLists.UnaffectedTileListSRV = InGraphBuilder.CreateSRV(UnaffectedTileListBuffer, PF_R32_UINT);
+	TileLists.TileCountersSRV = InGraphBuilder.CreateSRV(TileCounterBuffer, PF_R32_UINT);
+	return TileLists;
+}
+
+/**
+ * dispatches over InGroupCount groups, or - once InTileLists have been classified - indirectly over the groups of list InTileList (AFFECTED_TILE_LIST or
+ * UNAFFECTED_TILE_LIST) only. The shader must be the USE_TILE_LIST permutation in that case
+ */
+template<typename TShaderClass>
+static void AddTileListPass(FRDGBuilder& InGraphBuilder, FRDGEventName&& InPassName, const TShaderRef<TShaderClass>& InComputeShader, typename TShaderClass::FParameters* InParameters, const FIntVector& InGroupCount, const FVARIDTileListBuffers& InTileLists, uint32 InTileList)
+{
+	if (InTileLists.IndirectArgsBuffer)
+	{
+		InParameters->TileList.InTileList = InTileList == AFFECTED_TILE_LIST ? InTileLists.AffectedTileListSRV : InTileLists.UnaffectedTileListSRV;
+		InParameters->TileList.InTileListCounters = InTileLists.TileCountersSRV;
+		InParameters->TileList.InTileListIndex = InTileList;
+		InParameters->TileList.IndirectArgsBuffer = InTileLists.IndirectArgsBuffer;
+		FComputeShaderUtils::AddPass(InGraphBuilder, Forward<FRDGEventName>(InPassName), InComputeShader, InParameters, InTileLists.IndirectArgsBuffer, InTileList * sizeof(FRHIDispatchIndirectParameters));
+	}
+	else
+	{
+		FComputeShaderUtils::AddPass(InGraphBuilder, Forward<FRDGEventName>(InPassName), InComputeShader, InParameters, InGroupCount);
+	}
+}
+
+/*****************************************************************************************************************/
+// FX 
+
+static bool BuildPyramid_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InTexture, FRHISamplerState* InSampler, const FIntRect& InViewportRect)
+{
+	check(InTexture);
+
+	const FRDGTextureDesc& TextureDesc = InTexture->Desc;
+	TShaderMapRef<FVARIDBasicResampleCS> ResampleComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+	for (uint32 MipLevel = 1; MipLevel < TextureDesc.NumMips; ++MipLevel)	// NOTE start at level 1 (level zero should already exist!)
+	{
+		const FIntPoint TextureSize(FMath::Max(TextureDesc.Extent.X >> MipLevel, 1), FMath::Max(TextureDesc.Extent.Y >> MipLevel, 1));
+		const FVector2D TexelSize(1.0f / TextureSize.X, 1.0f / TextureSize.Y);
+		const FIntPoint DispatchSize(FMath::Max(InViewportRect.Width() >> MipLevel, 1), FMath::Max(InViewportRect.Height() >> MipLevel, 1));
+		const FIntPoint DispatchThreadIDOffset(InViewportRect.Min.X >> MipLevel, InViewportRect.Min.Y >> MipLevel);
+
+		FVARIDBasicResampleCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDBasicResampleCS::FParameters>();
+		PassParameters->InDispatchThreadIDOffset = DispatchThreadIDOffset;
+		PassParameters->InTexelSize = TexelSize;
+		PassParameters->InSampler = InSampler;
+		PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InTexture, MipLevel - 1));	// SRV is for a different mip level to the UAV - therefore Texture can appear to be both input and output
+		PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(InTexture, MipLevel));
+
+		FComputeShaderUtils::AddPass(
+			InGraphBuilder,
+			RDG_EVENT_NAME("VARID - Build Pyramid - Downsample - MipLevel=%d", MipLevel),
+			ResampleComputeShader,
+			PassParameters,
+			FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+	}
+
+	return true;
+}
+
+static bool BuildPyramidCopy_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InTexture, FRDGTextureRef OutTexture, FRHISamplerState* InSampler, const FIntRect& InViewportRect)
+{
+	check(InTexture);
+	check(OutTexture);
+
+	const FRDGTextureDesc& OutTextureDesc = OutTexture->Desc;
+	TShaderMapRef<FVARIDBasicResampleCS> ResampleComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+	for (uint32 MipLevel = 0; MipLevel < OutTextureDesc.NumMips; ++MipLevel)
+	{
+		const FIntPoint DestTextureSize(FMath::Max(OutTextureDesc.Extent.X >> MipLevel, 1), FMath::Max(OutTextureDesc.Extent.Y >> MipLevel, 1));
+		const FVector2D TexelSize = FVector2D(1.0f / DestTextureSize.X, 1.0f / DestTextureSize.Y);
+		const FIntPoint DispatchSize(FMath::Max(InViewportRect.Width() >> MipLevel, 1), FMath::Max(InViewportRect.Height() >> MipLevel, 1));
+		const FIntPoint DispatchThreadIDOffset(InViewportRect.Min.X >> MipLevel, InViewportRect.Min.Y >> MipLevel);
+
+		if (MipLevel == 0)
+		{
+			TShaderMapRef<FVARIDDirectCopyCS> DirectCopyComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+			FVARIDDirectCopyCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDDirectCopyCS::FParameters>();
+			PassParameters->DispatchThreadIDOffset = DispatchThreadIDOffset;
+			PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InTexture, 0));
+			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutTexture, 0));
+
+			FComputeShaderUtils::AddPass(
+				InGraphBuilder,
+				RDG_EVENT_NAME("VARID - Direct Copy - MipLevel=%d", MipLevel),
+				DirectCopyComputeShader,
+				PassParameters,
+				FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+		}
+		else
+		{
+			FVARIDBasicResampleCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDBasicResampleCS::FParameters>();
+			PassParameters->InDispatchThreadIDOffset = DispatchThreadIDOffset;
+			PassParameters->InTexelSize = TexelSize;
+			PassParameters->InSampler = InSampler;
+			PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(OutTexture, MipLevel - 1));	// SRV is for a different mip level to the UAV - therefore Texture can appear to be both input and output
+			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutTexture, MipLevel));
+
+			FComputeShaderUtils::AddPass(
+				InGraphBuilder,
+				RDG_EVENT_NAME("VARID - Build Pyramid Copy - Downsample - MipLevel=%d", MipLevel),
+				ResampleComputeShader,
+				PassParameters,
+				FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+		}
+	}
+
+	return true;
+}
+
+/** the gaussian blur permutation picked by r.VARID.Pyramid.Quality. Read once per view so every chain expands with the same kernel */
+struct FVARIDPyramidQuality
+{
+public:
+	int32 KernelWidth = FIXED_PYRAMID_KERNEL_WIDTH;
+	bool bHalfPrecisionCache = true;
+};
+
+static FVARIDPyramidQuality GetPyramidQuality_RenderThread()
+{
+	FVARIDPyramidQuality PyramidQuality;
+
+	switch (FMath::Clamp(CVarVARIDPyramidQuality.GetValueOnRenderThread(), 0, 3))
+	{
+	case 1:
+		PyramidQuality.bHalfPrecisionCache = false;
+		break;
+	case 2:
+		PyramidQuality.KernelWidth = 7;
+		PyramidQuality.bHalfPrecisionCache = false;
+		break;
+	case 3:
+		PyramidQuality.KernelWidth = 9;
+		PyramidQuality.bHalfPrecisionCache = false;
+		break;
+	default:
+		break;
+	}
+
+	return PyramidQuality;
+}
+
+static TShaderMapRef<FVARIDGaussianBlurCS> GetGaussianBlurShader(const FVARIDPyramidQuality& InPyramidQuality, EPixelFormat InFormat)
+{
+	FVARIDGaussianBlurCS::FPermutationDomain PermutationVector;
+	PermutationVector.Set<FVARIDBlurKernelWidthDim>(InPyramidQuality.KernelWidth);
+	PermutationVector.Set<FVARIDBlurChannelCountDim>(GPixelFormats[InFormat].NumComponents == 1 ? 1 : 3);
+	PermutationVector.Set<FVARIDBlurHalfPrecisionCacheDim>(InPyramidQuality.bHalfPrecisionCache);
+
+	return TShaderMapRef<FVARIDGaussianBlurCS>(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+}
+
+/**
+ * a 2x downsample or upsample between neighbouring levels of a working texture for the multi pass chains. The source is addressed in its own texels,
+ * exactly twice or half the output's, not in UV, which drifts on odd sized levels. An upsample clamps its bilinear taps to the source viewport, so the
+ * other eye doesn't bleed in. The same reads as the single pass pyramid and the fused reconstruct - see FVARIDReference::GaussianPyramidMultiPass()
+ */
+static TShaderMapRef<FVARIDBasicResampleCS> SetMipResampleParameters(FVARIDBasicResampleCS::FParameters* OutParameters, const FIntPoint& InTextureExtent, const FIntRect& InViewportRect, int32 InSourceMipLevel, int32 InOutputMipLevel)
+{
+	const bool bUpsample = InOutputMipLevel < InSourceMipLevel;
+	const FIntPoint SourceSize(FMath::Max(InTextureExtent.X >> InSourceMipLevel, 1), FMath::Max(InTextureExtent.Y >> InSourceMipLevel, 1));
+	const FIntPoint OutputSize(FMath::Max(InTextureExtent.X >> InOutputMipLevel, 1), FMath::Max(InTextureExtent.Y >> InOutputMipLevel, 1));
+	const float SourceTexelsPerOutputTexel = bUpsample ? 0.5f : 2.0f;
+	const FIntRect SourceRect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, InSourceMipLevel);
+
+	OutParameters->InDispatchThreadIDOffset = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, InOutputMipLevel).Min;
+	OutParameters->InTexelSize = FVector2D(1.0f / OutputSize.X, 1.0f / OutputSize.Y);
+	OutParameters->InSourceUVScaleBias = FVector4(OutputSize.X * SourceTexelsPerOutputTexel / SourceSize.X, OutputSize.Y * SourceTexelsPerOutputTexel / SourceSize.Y, 0.0f, 0.0f);
+	OutParameters->InSourceUVClamp = FVector4(
+		(SourceRect.Min.X + 0.5f) / SourceSize.X, (SourceRect.Min.Y + 0.5f) / SourceSize.Y,
+		(SourceRect.Max.X - 0.5f) / SourceSize.X, (SourceRect.Max.Y - 0.5f) / SourceSize.Y);
+	OutParameters->InSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+
+	FVARIDBasicResampleCS::FPermutationDomain PermutationVector;
+	PermutationVector.Set<FVARIDSourceUVTransformDim>(true);
+	PermutationVector.Set<FVARIDSourceUVClampDim>(bUpsample);
+	return TShaderMapRef<FVARIDBasicResampleCS>(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+}
+
+/** the multi pass chains' blur of InMipLevel. Reads are clamped to the viewport of that level, and the dispatch starts InDispatchBorder texels before it */
+static void SetGaussianBlurParameters(FVARIDGaussianBlurCS::FParameters* OutParameters, const FIntRect& InViewportRect, int32 InMipLevel, int32 InDispatchBorder)
+{
+	const FIntRect Rect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, InMipLevel);
+	OutParameters->DispatchThreadIDOffset = Rect.Min - FIntPoint(InDispatchBorder, InDispatchBorder);
+	OutParameters->InClampMin = Rect.Min;
+	OutParameters->InClampMax = Rect.Max;
+}
+
+static void BuildGaussianPyramidSinglePass_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InTexture, FRDGTextureRef OutGaussianMipTexture, const FIntRect& InViewportRect)
+{
+	check(InTexture);
+	check(OutGaussianMipTexture);
+
+	const uint32 NumMips = OutGaussianMipTexture->Desc.NumMips;
+	check(NumMips <= MAX_NUM_MIP_LEVELS);
+
+	// one group per tile of the first stage. Tiles of later stages are picked up by the group finishing the last of their inputs
+	const FIntPoint GroupCount = FVARIDPyramidLayout::GetGaussianPyramidTileCount(InViewportRect, 0);
+	const int32 NumTileCounters = FVARIDPyramidLayout::GetGaussianPyramidNumTileCounters(InViewportRect, NumMips);
+
+	FRDGBufferRef TileCounterBuffer = InGraphBuilder.CreateBuffer(FRDGBufferDesc::CreateBufferDesc(sizeof(uint32), NumTileCounters), TEXT("VARID_TEMP_PyramidTileCounters"));
+	FRDGBufferUAVRef TileCounterUAV = InGraphBuilder.CreateUAV(TileCounterBuffer, PF_R32_UINT);
+	AddClearUAVPass(InGraphBuilder, TileCounterUAV, 0);
+
+	TShaderMapRef<FVARIDGaussianPyramidCS> GaussianPyramidComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+	FVARIDGaussianPyramidCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDGaussianPyramidCS::FParameters>();
+	PassParameters->InViewportMin = InViewportRect.Min;
+	PassParameters->InViewportSize = InViewportRect.Size();
+	PassParameters->InNumMips = NumMips;
+	PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InTexture, 0));
+	PassParameters->TileCounters = TileCounterUAV;
+
+	// unused slots alias the last mip. the shader never touches them
+	FRDGTextureUAVRef* MipUAVs[MAX_NUM_MIP_LEVELS] =
+	{
+		&PassParameters->OutMip0, &PassParameters->OutMip1, &PassParameters->OutMip2, &PassParameters->OutMip3, &PassParameters->OutMip4,
+		&PassParameters->OutMip5, &PassParameters->OutMip6, &PassParameters->OutMip7, &PassParameters->OutMip8, &PassParameters->OutMip9
+	};
+
+	for (uint32 MipLevel = 0; MipLevel < MAX_NUM_MIP_LEVELS; ++MipLevel)
+	{
+		*MipUAVs[MipLevel] = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutGaussianMipTexture, FMath::Min(MipLevel, NumMips - 1)));
+	}
+
+	FComputeShaderUtils::AddPass(
+		InGraphBuilder,
+		RDG_EVENT_NAME("VARID - Build Gaussian Pyramid - Single Pass - NumMips=%d", NumMips),
+		GaussianPyramidComputeShader,
+		PassParameters,
+		FIntVector(GroupCount.X, GroupCount.Y, 1));
+}
+
+static void BuildGaussianPyramid_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InTexture, FRDGTextureRef OutGaussianMipTexture, const FIntRect& InViewportRect, const FVARIDPyramidQuality& InPyramidQuality)
+{
+	check(InTexture);
+	check(OutGaussianMipTexture);
+
+	if (CVarVARIDPyramidSinglePass.GetValueOnRenderThread() != 0 && InPyramidQuality.KernelWidth == FIXED_PYRAMID_KERNEL_WIDTH)
+	{
+		BuildGaussianPyramidSinglePass_RenderThread(InGraphBuilder, InTexture, OutGaussianMipTexture, InViewportRect);
+		return;
+	}
+
+	const FRDGTextureDesc& OutGaussianMipTextureDesc = OutGaussianMipTexture->Desc;
+
+	FRDGTextureRef BlurredMipTexture = InGraphBuilder.CreateTexture(OutGaussianMipTextureDesc, TEXT("VARID_TEMP_MipsRenderTargetTexture"));
+
+	TShaderMapRef<FVARIDGaussianBlurCS> GaussianBlurComputeShader = GetGaussianBlurShader(InPyramidQuality, OutGaussianMipTextureDesc.Format);
+
+	for (uint32 MipLevel = 0; MipLevel < OutGaussianMipTextureDesc.NumMips; ++MipLevel)
+	{
+		if (MipLevel == 0)
+		{
+			const FIntPoint DispatchSize = InViewportRect.Size();
+			const FIntPoint DispatchThreadIDOffset = InViewportRect.Min;
+
+			TShaderMapRef<FVARIDDirectCopyCS> DirectCopyComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+			FVARIDDirectCopyCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDDirectCopyCS::FParameters>();
+			PassParameters->DispatchThreadIDOffset = DispatchThreadIDOffset;
+			PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InTexture, 0));
+			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutGaussianMipTexture, 0));
+
+			FComputeShaderUtils::AddPass(
+				InGraphBuilder,
+				RDG_EVENT_NAME("VARID - Build Gaussian Pyramid - Direct Copy - MipLevel=%d", 0),
+				DirectCopyComputeShader,
+				PassParameters,
+				FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+		}
+		else
+		{
+			int32 LoResMipLevel = MipLevel;
+			int32 HiResMipLevel = MipLevel - 1;
+
+			const FIntPoint LoResDispatchSize(FMath::Max(InViewportRect.Width() >> LoResMipLevel, 1), FMath::Max(InViewportRect.Height() >> LoResMipLevel, 1));
+			const FIntPoint HiResDispatchSize(FMath::Max(InViewportRect.Width() >> HiResMipLevel, 1), FMath::Max(InViewportRect.Height() >> HiResMipLevel, 1));
+
+			// DONT downsample THEN Filter. Noise will alias back in. 
+			// DO filter THEN downsample
+
+			{
+				// blur. when the viewport starts on an odd texel, the downsample footprint of its first lo res texel starts one texel before it
+				FVARIDGaussianBlurCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDGaussianBlurCS::FParameters>();
+				SetGaussianBlurParameters(PassParameters, InViewportRect, HiResMipLevel, 1);
+				PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(OutGaussianMipTexture, HiResMipLevel));
+				PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(BlurredMipTexture, HiResMipLevel));
+
+				FComputeShaderUtils::AddPass(
+					InGraphBuilder,
+					RDG_EVENT_NAME("VARID - Build Gaussian Pyramid - Gaussian Blur - MipLevel=%d", HiResMipLevel),
+					GaussianBlurComputeShader,
+					PassParameters,
+					FComputeShaderUtils::GetGroupCount(HiResDispatchSize + FIntPoint(1, 1), FComputeShaderUtils::kGolden2DGroupSize));
+			}
+
+			{
+				// downsample
+				FVARIDBasicResampleCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDBasicResampleCS::FParameters>();
+				TShaderMapRef<FVARIDBasicResampleCS> ResampleComputeShader = SetMipResampleParameters(PassParameters, OutGaussianMipTextureDesc.Extent, InViewportRect, HiResMipLevel, LoResMipLevel);
+				PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(BlurredMipTexture, HiResMipLevel));
+				PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutGaussianMipTexture, LoResMipLevel));
+
+				FComputeShaderUtils::AddPass(
+					InGraphBuilder,
+					RDG_EVENT_NAME("VARID - Build Gaussian Pyramid - Downsample - MipLevel=%d", LoResMipLevel),
+					ResampleComputeShader,
+					PassParameters,
+					FComputeShaderUtils::GetGroupCount(LoResDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+			}
+		}
+	}
+}
+
+static void BuildLaplacianPyramid_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InGaussianMipTexture, FRDGTextureRef OutLaplacianMipTexture, const FIntRect& InViewportRect, const FVARIDPyramidQuality& InPyramidQuality)
+{
+	check(InGaussianMipTexture);
+	check(OutLaplacianMipTexture);
+
+	const FRDGTextureDesc& OutLaplacianMipTextureDesc = OutLaplacianMipTexture->Desc;
+
+	uint32 MaxMipLevelIndex = InGaussianMipTexture->Desc.NumMips - 1;	// convert to zero based index
+
+	FRDGTextureRef UpsampledMipTexture = InGraphBuilder.CreateTexture(OutLaplacianMipTextureDesc, TEXT("VARID_TEMP_UpsampledMipTexture"));
+	FRDGTextureRef BlurredMipTexture = InGraphBuilder.CreateTexture(OutLaplacianMipTextureDesc, TEXT("VARID_TEMP_BlurredMipTexture"));
+
+	TShaderMapRef<FVARIDGaussianBlurCS> GaussianBlurComputeShader = GetGaussianBlurShader(InPyramidQuality, OutLaplacianMipTextureDesc.Format);
+	TShaderMapRef<FVARIDLaplacianCS> LaplacianComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+	// work from the highest mip level (lowest resolution) to the lowest mip level (highest resolution)
+	for (int32 MipLevel = MaxMipLevelIndex; MipLevel >= 0; --MipLevel)
+	{
+		if (MipLevel == MaxMipLevelIndex)
+		{
+			const FIntPoint DispatchSize(FMath::Max(InViewportRect.Width() >> MipLevel, 1), FMath::Max(InViewportRect.Height() >> MipLevel, 1));
+			const FIntPoint DispatchThreadIDOffset(InViewportRect.Min.X >> MipLevel, InViewportRect.Min.Y >> MipLevel);
+
+			TShaderMapRef<FVARIDDirectCopyCS> DirectCopyComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+			FVARIDDirectCopyCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDDirectCopyCS::FParameters>();
+			PassParameters->DispatchThreadIDOffset = DispatchThreadIDOffset;
+			PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InGaussianMipTexture, MipLevel));
+			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutLaplacianMipTexture, MipLevel));
+
+			FComputeShaderUtils::AddPass(
+				InGraphBuilder,
+				RDG_EVENT_NAME("VARID - Build Laplacian Pyramid - Direct Copy - MipLevel=%d", MipLevel),
+				DirectCopyComputeShader,
+				PassParameters,
+				FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+		}
+		else
+		{
+			int32 LoResMipLevel = MipLevel + 1;
+			int32 HiResMipLevel = MipLevel;
+
+			const FIntPoint LoResDispatchSize(FMath::Max(InViewportRect.Width() >> LoResMipLevel, 1), FMath::Max(InViewportRect.Height() >> LoResMipLevel, 1));
+			const FIntPoint LoResDispatchThreadIDOffset(InViewportRect.Min.X >> LoResMipLevel, InViewportRect.Min.Y >> LoResMipLevel);
+
+			const FIntPoint HiResDispatchSize(FMath::Max(InViewportRect.Width() >> HiResMipLevel, 1), FMath::Max(InViewportRect.Height() >> HiResMipLevel, 1));
+			const FIntPoint HiResDispatchThreadIDOffset(InViewportRect.Min.X >> HiResMipLevel, InViewportRect.Min.Y >> HiResMipLevel);
+
+			{
+				// upsample
+				FVARIDBasicResampleCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDBasicResampleCS::FParameters>();
+				TShaderMapRef<FVARIDBasicResampleCS> ResampleComputeShader = SetMipResampleParameters(PassParameters, OutLaplacianMipTextureDesc.Extent, InViewportRect, LoResMipLevel, HiResMipLevel);
+				PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InGaussianMipTexture, LoResMipLevel));
+				PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(UpsampledMipTexture, HiResMipLevel));
+
+				FComputeShaderUtils::AddPass(
+					InGraphBuilder,
+					RDG_EVENT_NAME("VARID - Build Laplacian Pyramid - Upsample - MipLevel=%d", HiResMipLevel),
+					ResampleComputeShader,
+					PassParameters,
+					FComputeShaderUtils::GetGroupCount(HiResDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+			}
+
+			{
+				// blur
+				FVARIDGaussianBlurCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDGaussianBlurCS::FParameters>();
+				SetGaussianBlurParameters(PassParameters, InViewportRect, HiResMipLevel, 0);
+				PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(UpsampledMipTexture, HiResMipLevel));
+				PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(BlurredMipTexture, HiResMipLevel));
+
+				FComputeShaderUtils::AddPass(
+					InGraphBuilder,
+					RDG_EVENT_NAME("VARID - Build Laplacian Pyramid - Gaussian Blur - MipLevel=%d", HiResMipLevel),
+					GaussianBlurComputeShader,
+					PassParameters,
+					FComputeShaderUtils::GetGroupCount(HiResDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+			}
+
+			{
+				// laplacian
+				FVARIDLaplacianCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDLaplacianCS::FParameters>();
+				PassParameters->DispatchThreadIDOffset = HiResDispatchThreadIDOffset;
+				PassParameters->InLoResSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(BlurredMipTexture, HiResMipLevel));
+				PassParameters->InHiResSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InGaussianMipTexture, HiResMipLevel));
+				PassParameters->OutLaplacianUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutLaplacianMipTexture, HiResMipLevel));
+
+				FComputeShaderUtils::AddPass(
+					InGraphBuilder,
+					RDG_EVENT_NAME("VARID - Build Laplacian Pyramid - Laplacian - MipLevel=%d", HiResMipLevel),
+					LaplacianComputeShader,
+					PassParameters,
+					FComputeShaderUtils::GetGroupCount(HiResDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+			}
+		}
+	}
+}
+
+static void BuildContrastTexture_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InLaplacianMipTexture, FRDGTextureRef InVFMapMipTexture, FRDGTextureRef OutContrastTexture, const FIntRect& InViewportRect, const FVARIDPyramidQuality& InPyramidQuality)
+{
+	check(InLaplacianMipTexture);
+	check(OutContrastTexture);
+
+	const FRDGTextureDesc& OutContrastTextureDesc = OutContrastTexture->Desc;
+	const int32 ContrastNumberOfMips = OutContrastTextureDesc.NumMips;
+
+	const FRDGTextureDesc& InLaplacianMipTextureDesc = InLaplacianMipTexture->Desc;
+	const int32 LaplacianNumberOfMips = InLaplacianMipTextureDesc.NumMips;
+
+	const FRDGTextureDesc& InVFMapMipTextureDesc = InVFMapMipTexture->Desc;
+	const int32 VFMapNumberOfMips = InVFMapMipTextureDesc.NumMips;
+
+	check(ContrastNumberOfMips == LaplacianNumberOfMips);
+	check(ContrastNumberOfMips == VFMapNumberOfMips);
+
+	const int32 MaxMipLevelIndex = ContrastNumberOfMips - 1;
+
+	FRDGTextureRef UpsampledMipTexture = InGraphBuilder.CreateTexture(OutContrastTextureDesc, TEXT("VARID_TEMP_UpsampledMipTexture"));
+	FRDGTextureRef BlurredMipTexture = InGraphBuilder.CreateTexture(OutContrastTextureDesc, TEXT("VARID_TEMP_BlurredMipTexture"));
+
+	TShaderMapRef<FVARIDGaussianBlurCS> GaussianBlurComputeShader = GetGaussianBlurShader(InPyramidQuality, OutContrastTextureDesc.Format);
+	TShaderMapRef<FVARIDReconstructCS> ReconstructComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+	// work from the highest mip level (lowest resolution) to the lowest mip level (highest resolution)
+	for (int32 MipLevel = MaxMipLevelIndex; MipLevel >= 0; --MipLevel)
+	{
+		// TODO move outside the for loop?
+		if (MipLevel == MaxMipLevelIndex)
+		{
+			// lowest res level is simply a direct copy. no bias applied
+			const FIntPoint DispatchSize(FMath::Max(InViewportRect.Width() >> MipLevel, 1), FMath::Max(InViewportRect.Height() >> MipLevel, 1));
+			const FIntPoint DispatchThreadIDOffset(InViewportRect.Min.X >> MipLevel, InViewportRect.Min.Y >> MipLevel);
+
+			TShaderMapRef<FVARIDDirectCopyCS> DirectCopyComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+			FVARIDDirectCopyCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDDirectCopyCS::FParameters>();
+			PassParameters->DispatchThreadIDOffset = DispatchThreadIDOffset;
+			PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InLaplacianMipTexture, MipLevel));
+			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutContrastTexture, MipLevel));
+
+			FComputeShaderUtils::AddPass(
+				InGraphBuilder,
+				RDG_EVENT_NAME("VARID - Build Contrast Texture - Direct Copy - MipLevel=%d", MipLevel),
+				DirectCopyComputeShader,
+				PassParameters,
+				FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+		}
+		else
+		{
+			int32 LoResMipLevel = MipLevel + 1;
+			int32 HiResMipLevel = MipLevel;
+
+			const FIntPoint HiResDispatchSize(FMath::Max(InViewportRect.Width() >> HiResMipLevel, 1), FMath::Max(InViewportRect.Height() >> HiResMipLevel, 1));
+			const FIntPoint HiResDispatchThreadIDOffset(InViewportRect.Min.X >> HiResMipLevel, InViewportRect.Min.Y >> HiResMipLevel);
+
+			{
+				// upsample
+				FVARIDBasicResampleCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDBasicResampleCS::FParameters>();
+				TShaderMapRef<FVARIDBasicResampleCS> ResampleComputeShader = SetMipResampleParameters(PassParameters, OutContrastTextureDesc.Extent, InViewportRect, LoResMipLevel, HiResMipLevel);
+				PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(OutContrastTexture, LoResMipLevel));
+				PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(UpsampledMipTexture, HiResMipLevel));
+
+				FComputeShaderUtils::AddPass(
+					InGraphBuilder,
+					RDG_EVENT_NAME("VARID - Build Contrast Texture - Upsample - MipLevel=%d", HiResMipLevel),
+					ResampleComputeShader,
+					PassParameters,
+					FComputeShaderUtils::GetGroupCount(HiResDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+			}
+
+			{
+				// blur
+				FVARIDGaussianBlurCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDGaussianBlurCS::FParameters>();
+				SetGaussianBlurParameters(PassParameters, InViewportRect, HiResMipLevel, 0);
+				PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(UpsampledMipTexture, HiResMipLevel));
+				PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(BlurredMipTexture, HiResMipLevel));
+
+				FComputeShaderUtils::AddPass(
+					InGraphBuilder,
+					RDG_EVENT_NAME("VARID - Build Contrast Texture - Gaussian Blur - MipLevel=%d", HiResMipLevel),
+					GaussianBlurComputeShader,
+					PassParameters,
+					FComputeShaderUtils::GetGroupCount(HiResDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+			}
+
+			{
+				// combine laplace and gaussian to reconstruct original image
+				FVARIDReconstructCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDReconstructCS::FParameters>();
+				PassParameters->InDispatchThreadIDOffset = HiResDispatchThreadIDOffset;
+				PassParameters->InGaussianSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(BlurredMipTexture, HiResMipLevel));
+				PassParameters->InLaplacianSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InLaplacianMipTexture, HiResMipLevel));
+				PassParameters->InVFMapSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InVFMapMipTexture, HiResMipLevel));
+				PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutContrastTexture, HiResMipLevel));
+
+				FComputeShaderUtils::AddPass(
+					InGraphBuilder,
+					RDG_EVENT_NAME("VARID - Build Contrast Texture - Reconstruct - MipLevel=%d", HiResMipLevel),
+					ReconstructComputeShader,
+					PassParameters,
+					FComputeShaderUtils::GetGroupCount(HiResDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+			}
+		}
+	}
+}
+
+/** with bInSkipLevel0 level 0 is left to the compute compositor, which reconstructs it where it samples it */
+static void BuildContrastTextureFused_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InGaussianMipTexture, FRDGTextureRef InVFMapMipTexture, FRDGTextureRef OutContrastTexture, const FIntRect& InViewportRect, bool bInSkipLevel0 = false)
+{
+	check(InGaussianMipTexture);
+	check(InVFMapMipTexture);
+	check(OutContrastTexture);
+
+	const int32 ContrastNumberOfMips = OutContrastTexture->Desc.NumMips;
+
+	check(ContrastNumberOfMips == InGaussianMipTexture->Desc.NumMips);
+	check(ContrastNumberOfMips == InVFMapMipTexture->Desc.NumMips);
+
+	const int32 MaxMipLevelIndex = ContrastNumberOfMips - 1;
+
+	{
+		// lowest res level of the laplacian pyramid is the lowest res level of the gaussian pyramid
+		const FIntPoint DispatchSize(FMath::Max(InViewportRect.Width() >> MaxMipLevelIndex, 1), FMath::Max(InViewportRect.Height() >> MaxMipLevelIndex, 1));
+		const FIntPoint DispatchThreadIDOffset(InViewportRect.Min.X >> MaxMipLevelIndex, InViewportRect.Min.Y >> MaxMipLevelIndex);
+
+		TShaderMapRef<FVARIDDirectCopyCS> DirectCopyComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+		FVARIDDirectCopyCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDDirectCopyCS::FParameters>();
+		PassParameters->DispatchThreadIDOffset = DispatchThreadIDOffset;
+		PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InGaussianMipTexture, MaxMipLevelIndex));
+		PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutContrastTexture, MaxMipLevelIndex));
+
+		FComputeShaderUtils::AddPass(
+			InGraphBuilder,
+			RDG_EVENT_NAME("VARID - Build Contrast Texture Fused - Direct Copy - MipLevel=%d", MaxMipLevelIndex),
+			DirectCopyComputeShader,
+			PassParameters,
+			FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+	}
+
+	// level 0 only needs reconstructing where the VF map of any level reaches it. elsewhere the result is the gaussian itself
+	const bool bUseTileLists = UseTileClassification_RenderThread() && MaxMipLevelIndex > 0 && !bInSkipLevel0;
+	FVARIDTileListBuffers TileLists;
+
+	if (bUseTileLists)
+	{
+		TileLists = ClassifyTiles_RenderThread(InGraphBuilder, InVFMapMipTexture, 0, MaxMipLevelIndex, InViewportRect, CONTRAST_TILE_DILATION, GetContrastTileThreshold_RenderThread());
+	}
+
+	FVARIDReconstructFusedCS::FPermutationDomain TileListPermutationVector;
+	TileListPermutationVector.Set<FVARIDUseTileListDim>(true);
+
+	TShaderMapRef<FVARIDReconstructFusedCS> ReconstructComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+	TShaderMapRef<FVARIDReconstructFusedCS> ReconstructTileListComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), TileListPermutationVector);
+
+	const int32 MinMipLevel = bInSkipLevel0 ? 1 : 0;
+
+	// work from the highest mip level (lowest resolution) to the lowest mip level (highest resolution)
+	for (int32 MipLevel = MaxMipLevelIndex - 1; MipLevel >= MinMipLevel; --MipLevel)
+	{
+		const int32 LoResMipLevel = MipLevel + 1;
+		const int32 HiResMipLevel = MipLevel;
+
+		const FIntRect LoResRect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, LoResMipLevel);
+		const FIntRect HiResRect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, HiResMipLevel);
+
+		FVARIDReconstructFusedCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDReconstructFusedCS::FParameters>();
+		PassParameters->InDispatchThreadIDOffset = HiResRect.Min;
+		PassParameters->InHiResMin = HiResRect.Min;
+		PassParameters->InHiResMax = HiResRect.Max;
+		PassParameters->InLoResMin = LoResRect.Min;
+		PassParameters->InLoResMax = LoResRect.Max;
+		PassParameters->InLoResContrastSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(OutContrastTexture, LoResMipLevel));
+		PassParameters->InLoResGaussianSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InGaussianMipTexture, LoResMipLevel));
+		PassParameters->InHiResGaussianSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InGaussianMipTexture, HiResMipLevel));
+		PassParameters->InVFMapSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InVFMapMipTexture, HiResMipLevel));
+		PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutContrastTexture, HiResMipLevel));
+
+		if (bUseTileLists && HiResMipLevel == 0)
+		{
+			AddTileListPass(
+				InGraphBuilder,
+				RDG_EVENT_NAME("VARID - Build Contrast Texture Fused - Reconstruct - Affected Tiles - MipLevel=%d", HiResMipLevel),
+				ReconstructTileListComputeShader,
+				PassParameters,
+				FIntVector::ZeroValue,
+				TileLists,
+				AFFECTED_TILE_LIST);
+
+			FVARIDDirectCopyCS::FPermutationDomain CopyPermutationVector;
+			CopyPermutationVector.Set<FVARIDUseTileListDim>(true);
+			TShaderMapRef<FVARIDDirectCopyCS> DirectCopyComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), CopyPermutationVector);
+
+			FVARIDDirectCopyCS::FParameters* CopyPassParameters = InGraphBuilder.AllocParameters<FVARIDDirectCopyCS::FParameters>();
+			CopyPassParameters->DispatchThreadIDOffset = HiResRect.Min;
+			CopyPassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InGaussianMipTexture, HiResMipLevel));
+			CopyPassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutContrastTexture, HiResMipLevel));
+
+			AddTileListPass(
+				InGraphBuilder,
+				RDG_EVENT_NAME("VARID - Build Contrast Texture Fused - Direct Copy - Unaffected Tiles - MipLevel=%d", HiResMipLevel),
+				DirectCopyComputeShader,
+				CopyPassParameters,
+				FIntVector::ZeroValue,
+				TileLists,
+				UNAFFECTED_TILE_LIST);
+		}
+		else
+		{
+			FComputeShaderUtils::AddPass(
+				InGraphBuilder,
+				RDG_EVENT_NAME("VARID - Build Contrast Texture Fused - Reconstruct - MipLevel=%d", HiResMipLevel),
+				ReconstructComputeShader,
+				PassParameters,
+				FComputeShaderUtils::GetGroupCount(HiResRect.Size(), FComputeShaderUtils::kGolden2DGroupSize));
+		}
+	}
+}
+
+/** InColourTexture is the scene colour. The other textures are working textures laid out by InPlan */
+static bool BuildInpaintTexture_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InColourTexture, FRDGTextureRef InVFMapTexture, FRDGTextureRef OutPositionMipTexture, FRDGTextureRef OutColourTexture, const FVARIDWorkingTexturePlan& InPlan)
+{
+	check(InColourTexture);
+	check(InVFMapTexture);
+
+	const FRDGTextureDesc& OutColourTextureDesc = OutColourTexture->Desc;
+	const FIntRect InViewportRect = InPlan.GetActiveRect();
+	const bool bSceneSized = InPlan.Mode == EVARIDWorkingTextureMode::SceneSized;
+	const int32 OriginalTextureWidth = OutColourTextureDesc.Extent.X;
+	const int32 OriginalTextureHeight = OutColourTextureDesc.Extent.Y;
+	const int32 OriginalTextureOriginOffset = InViewportRect.Min.X > 0 ? OriginalTextureWidth / 2 : 0;
+	const FVector2D OriginalTexelSize(1.0f / OriginalTextureWidth, 1.0f / OriginalTextureHeight);
+
+	// scene sized textures run from the start of the eye to the edge of the texture. otherwise the working textures hold nothing but the eyes
+	const FIntPoint OriginalDispatchSize = bSceneSized ? FIntPoint(OriginalTextureWidth, OriginalTextureHeight) : InViewportRect.Size();
+	const FIntPoint OriginalDispatchThreadIDOffset = bSceneSized ? FIntPoint(OriginalTextureOriginOffset, 0) : InViewportRect.Min;
+
+	const int32 NumberOfPasses = GVARIDQualitySettingsRenderThread.InpaintPasses;	// must be a multiple of INPAINT_FILL_ITERATIONS_PER_DISPATCH
+	const int32 PassMipLevel = 3;
+	const int32 NumMips = PassMipLevel + 1;
+
+	FRDGTextureDesc MetaDataTextureDesc = FRDGTextureDesc::Create2D
+	(
+		OutColourTextureDesc.Extent,
+		EPixelFormat::PF_A32B32G32R32F,
+		FClearValueBinding::Black,
+		TexCreate_ShaderResource | TexCreate_UAV,
+		NumMips,
+		1
+	);
+
+	// ensure we have a descriptor that can support mipmaps (the original texture passed in might not support mips)
+	FRDGTextureDesc ColourTextureDesc = FRDGTextureDesc::Create2D
+	(
+		OutColourTextureDesc.Extent,
+		OutColourTextureDesc.Format,
+		FClearValueBinding::Black,
+		TexCreate_ShaderResource | TexCreate_UAV,
+		NumMips,	
+		1
+	);
+
+	// temporary textures used for processing the 'fill' shader
+	// the textures only have data at a single lower resolution mip level - for better performance
+	// the final result is copied back into the hi res output texture during the finalise shader stage
+	FRDGTextureRef MetaDataTexture_1 = InGraphBuilder.CreateTexture(MetaDataTextureDesc, TEXT("MetaDataTexture_1"));
+	FRDGTextureRef MetaDataTexture_2 = InGraphBuilder.CreateTexture(MetaDataTextureDesc, TEXT("MetaDataTexture_2"));
+	FRDGTextureRef ColourTexture_1 = InGraphBuilder.CreateTexture(ColourTextureDesc, TEXT("ColourTexture_1"));
+	FRDGTextureRef ColourTexture_2 = InGraphBuilder.CreateTexture(ColourTextureDesc, TEXT("ColourTexture_2"));
+
+	TShaderMapRef<FVARIDInpainterInitialiseCS> InpainterInitialiseShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+	TShaderMapRef<FVARIDBasicResampleCS> ResampleComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+	TShaderMapRef<FVARIDInpainterFinaliseCS> InpainterFinaliseShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+	const FIntPoint PassTextureSize(FMath::Max(OriginalTextureWidth >> PassMipLevel, 1), FMath::Max(OriginalTextureHeight >> PassMipLevel, 1));
+	const FVector2D PassTexelSize(1.0f / PassTextureSize.X, 1.0f / PassTextureSize.Y);
+	const FIntPoint PassDispatchSize(FMath::Max(OriginalDispatchSize.X >> PassMipLevel, 1), FMath::Max(OriginalDispatchSize.Y >> PassMipLevel, 1));
+	const FIntPoint PassDispatchThreadIDOffset(OriginalDispatchThreadIDOffset.X >> PassMipLevel, OriginalDispatchThreadIDOffset.Y >> PassMipLevel);
+
+	// initialise low res pass mip texture with initial colour - essentially downsample the colour
+	{
+		// meta data: fill mask, pass counter, UV
+		{
+			FVARIDInpainterInitialiseCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDInpainterInitialiseCS::FParameters>();
+			PassParameters->InDispatchThreadIDOffset = PassDispatchThreadIDOffset;
+			PassParameters->InTexelSize = PassTexelSize;
+			PassParameters->InMaskSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InVFMapTexture, PassMipLevel));
+			PassParameters->OutMetaDataUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(MetaDataTexture_1, PassMipLevel));
+
+			FComputeShaderUtils::AddPass(
+				InGraphBuilder,
+				RDG_EVENT_NAME("VARID - Inpainter - Initialise - MipLevel=%d", PassMipLevel),
+				InpainterInitialiseShader,
+				PassParameters,
+				FComputeShaderUtils::GetGroupCount(PassDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+		}
+
+		// colour
+		{
+			FVARIDBasicResampleCS::FPermutationDomain PermutationVector;
+			PermutationVector.Set<FVARIDSourceUVTransformDim>(!bSceneSized);
+			TShaderMapRef<FVARIDBasicResampleCS> SceneColourResampleShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+
+			FVARIDBasicResampleCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDBasicResampleCS::FParameters>();
+			PassParameters->InDispatchThreadIDOffset = PassDispatchThreadIDOffset;
+			PassParameters->InTexelSize = PassTexelSize;
+			PassParameters->InSourceUVScaleBias = InPlan.GetSceneUVScaleBias();
+			PassParameters->InSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+			PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InColourTexture, 0));
+			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(ColourTexture_1, PassMipLevel));
+
+			FComputeShaderUtils::AddPass(
+				InGraphBuilder,
+				RDG_EVENT_NAME("VARID - Inpainter - Downsample Colour - MipLevel=%d", PassMipLevel),
+				SceneColourResampleShader,
+				PassParameters,
+				FComputeShaderUtils::GetGroupCount(PassDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+		}
+
+		// VF Map
+		{
+			FVARIDBasicResampleCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDBasicResampleCS::FParameters>();
+			PassParameters->InDispatchThreadIDOffset = PassDispatchThreadIDOffset;
+			PassParameters->InTexelSize = PassTexelSize;
+			PassParameters->InSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+			PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InVFMapTexture, 0));
+			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(InVFMapTexture, PassMipLevel));
+
+			FComputeShaderUtils::AddPass(
+				InGraphBuilder,
+				RDG_EVENT_NAME("VARID - Inpainter - Downsample VF Map - MipLevel=%d", PassMipLevel),
+				ResampleComputeShader,
+				PassParameters,
+				FComputeShaderUtils::GetGroupCount(PassDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+		}
+	}
+
+	// pointers to textures
+	FRDGTextureRef InMetaData;
+	FRDGTextureRef OutMetaData;
+	FRDGTextureRef InColour;
+	FRDGTextureRef OutColour;
+
+	// the tiled fill runs several passes per dispatch in groupshared memory, rounding each filled colour to the UNORM16 of the colour
+	// textures as the texture write between passes would. the result matches running them one at a time, up to the hardware's rounding of exact halves
+	const bool bTiledFill = CVarVARIDInpaintTiledFill.GetValueOnRenderThread() != 0;
+	check(!bTiledFill || OutColourTextureDesc.Format == EPixelFormat::PF_R16G16B16A16_UNORM);
+	const int32 PassesPerDispatch = bTiledFill ? INPAINT_FILL_ITERATIONS_PER_DISPATCH : 1;
+	const int32 NumberOfDispatches = NumberOfPasses / PassesPerDispatch;
+	check(NumberOfPasses % PassesPerDispatch == 0);
+
+	const FIntVector PassGroupCount = FComputeShaderUtils::GetGroupCount(PassDispatchSize, FComputeShaderUtils::kGolden2DGroupSize);
+
+	// fill passes only change masked texels. with tile lists they only run on groups that have some, the rest of the pass mip
+	// is copied into the second ping-pong texture once so both textures agree there for every pass
+	const bool bUseTileLists = UseTileClassification_RenderThread();
+	FVARIDTileListBuffers TileLists;
+
+	FVARIDInpainterFillCS::FPermutationDomain FillPermutationVector;
+	FillPermutationVector.Set<FVARIDUseTileListDim>(bUseTileLists);
+	TShaderMapRef<FVARIDInpainterFillCS> InpainterFillShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), FillPermutationVector);
+
+	FVARIDInpainterFillTiledCS::FPermutationDomain FillTiledPermutationVector;
+	FillTiledPermutationVector.Set<FVARIDUseTileListDim>(bUseTileLists);
+	TShaderMapRef<FVARIDInpainterFillTiledCS> InpainterFillTiledShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), FillTiledPermutationVector);
+
+	if (bUseTileLists)
+	{
+		TileLists = ClassifyTiles_RenderThread(InGraphBuilder, InVFMapTexture, PassMipLevel, 1, FIntRect(PassDispatchThreadIDOffset, PassDispatchThreadIDOffset + PassDispatchSize), 0, INPAINT_MASK_THRESHOLD);
+
+		FVARIDDirectCopyCS::FPermutationDomain CopyPermutationVector;
+		CopyPermutationVector.Set<FVARIDUseTileListDim>(true);
+		TShaderMapRef<FVARIDDirectCopyCS> DirectCopyComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), CopyPermutationVector);
+
+		const FRDGTextureRef CopySources[2] = { ColourTexture_1, MetaDataTexture_1 };
+		const FRDGTextureRef CopyDestinations[2] = { ColourTexture_2, MetaDataTexture_2 };
+
+		for (int32 CopyIndex = 0; CopyIndex < 2; ++CopyIndex)
+		{
+			FVARIDDirectCopyCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDDirectCopyCS::FParameters>();
+			PassParameters->DispatchThreadIDOffset = PassDispatchThreadIDOffset;
+			PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(CopySources[CopyIndex], PassMipLevel));
+			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(CopyDestinations[CopyIndex], PassMipLevel));
+
+			AddTileListPass(
+				InGraphBuilder,
+				RDG_EVENT_NAME("VARID - Inpainter - Copy Unaffected Tiles - MipLevel=%d", PassMipLevel),
+				DirectCopyComputeShader,
+				PassParameters,
+				PassGroupCount,
+				TileLists,
+				UNAFFECTED_TILE_LIST);
+		}
+	}
+
+	// multiple refinement passes
+	for (int32 DispatchCounter = 0; DispatchCounter < NumberOfDispatches; ++DispatchCounter)
+	{
+		const int32 PassCounter = DispatchCounter * PassesPerDispatch;
+
+		// flipping totally works!
+		if (DispatchCounter % 2 == 0)
+		{
+			InMetaData = MetaDataTexture_1;
+			OutMetaData = MetaDataTexture_2;
+			InColour = ColourTexture_1;
+			OutColour = ColourTexture_2;
+		}
+		else //if (DispatchCounter % 2 == 1)
+		{
+			InMetaData = MetaDataTexture_2;
+			OutMetaData = MetaDataTexture_1;
+			InColour = ColourTexture_2;
+			OutColour = ColourTexture_1;
+		}
+
+		if (bTiledFill)
+		{
+			FVARIDInpainterFillTiledCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDInpainterFillTiledCS::FParameters>();
+			PassParameters->InDispatchThreadIDOffset = PassDispatchThreadIDOffset;
+			PassParameters->InActiveMax = PassDispatchThreadIDOffset + FIntPoint(PassGroupCount.X, PassGroupCount.Y) * FComputeShaderUtils::kGolden2DGroupSize;
+			PassParameters->PassCounter = PassCounter;
+			PassParameters->InMaskSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InVFMapTexture, PassMipLevel));
+			PassParameters->InColourSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InColour, PassMipLevel));
+			PassParameters->InMetaDataSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InMetaData, PassMipLevel));
+			PassParameters->OutColourUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutColour, PassMipLevel));
+			PassParameters->OutMetaDataUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutMetaData, PassMipLevel));
+
+			AddTileListPass(
+				InGraphBuilder,
+				RDG_EVENT_NAME("VARID - Inpainter - Tiled - MipLevel=%d - PassCounter=%d..%d", PassMipLevel, PassCounter, PassCounter + PassesPerDispatch - 1),
+				InpainterFillTiledShader,
+				PassParameters,
+				PassGroupCount,
+				TileLists,
+				AFFECTED_TILE_LIST);
+		}
+		else
+		{
+			FVARIDInpainterFillCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDInpainterFillCS::FParameters>();
+			PassParameters->InDispatchThreadIDOffset = PassDispatchThreadIDOffset;
+			PassParameters->InTexelSize = PassTexelSize;
+			PassParameters->PassCounter = PassCounter;
+			PassParameters->InMaskSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InVFMapTexture, PassMipLevel));
+			PassParameters->InColourSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InColour, PassMipLevel));			
+			PassParameters->InMetaDataSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InMetaData, PassMipLevel));
+			PassParameters->OutColourUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutColour, PassMipLevel));
+			PassParameters->OutMetaDataUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutMetaData, PassMipLevel));
+
+			AddTileListPass(
+				InGraphBuilder,
+				RDG_EVENT_NAME("VARID - Inpainter - MipLevel=%d - PassCounter=%d", PassMipLevel, PassCounter),
+				InpainterFillShader,
+				PassParameters,
+				PassGroupCount,
+				TileLists,
+				AFFECTED_TILE_LIST);
+		}
+	}
+
+	// finalise - copy low res filled area into hi res out image. 
+	{
+		FVARIDInpainterFinaliseCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDInpainterFinaliseCS::FParameters>();
+		PassParameters->InDispatchThreadIDOffset = OriginalDispatchThreadIDOffset;
+		PassParameters->InTexelSize = OriginalTexelSize;
+		PassParameters->InBilinearSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+		PassParameters->InPointSampler = TStaticSamplerState<SF_Point, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+		PassParameters->SamplerMipLevel = PassMipLevel;
+		PassParameters->InMaskSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InVFMapTexture, 0));
+		PassParameters->InMaskedColourSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(OutColour, PassMipLevel));
+		PassParameters->InUnmaskedColourSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InColourTexture, 0));
+		PassParameters->InUnmaskedColourOffset = InPlan.SceneOrigin;
+		PassParameters->InMetaDataSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(OutMetaData, PassMipLevel));
+		PassParameters->OutColourUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutColourTexture, 0));
+		PassParameters->OutPositionUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutPositionMipTexture, 0));
+
+		FComputeShaderUtils::AddPass(
+			InGraphBuilder,
+			RDG_EVENT_NAME("VARID - Inpainter - Finalise - MipLevel=%d", 0),
+			InpainterFinaliseShader,
+			PassParameters,
+			FComputeShaderUtils::GetGroupCount(OriginalDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+	}
+
+	return true;
+}
+
+/** summed area table of mip 0 of InTexture over InRegionRect, for the BLUR_MODE_SAT compositor. Rows first, then columns in place */
+static FRDGTextureRef BuildSummedAreaTable_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InTexture, const FIntRect& InRegionRect)
+{
+	FRDGTextureDesc SummedAreaTableDesc = FRDGTextureDesc::Create2D
+	(
+		InTexture->Desc.Extent,
+		EPixelFormat::PF_R32G32B32A32_UINT,	// 10 bit quantised sums, allowed to wrap. see VARIDSummedAreaTable.ush
+		FClearValueBinding::Black,
+		TexCreate_ShaderResource | TexCreate_UAV,
+		1,
+		1
+	);
+
+	FRDGTextureRef SummedAreaTableTexture = InGraphBuilder.CreateTexture(SummedAreaTableDesc, TEXT("SummedAreaTableTexture"));
+
+	for (int32 Pass = 0; Pass < 2; ++Pass)
+	{
+		const bool bVertical = Pass == 1;
+
+		FVARIDSummedAreaTableCS::FPermutationDomain PermutationVector;
+		PermutationVector.Set<FVARIDSummedAreaTableVerticalDim>(bVertical);
+		TShaderMapRef<FVARIDSummedAreaTableCS> SummedAreaTableShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+
+		FVARIDSummedAreaTableCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDSummedAreaTableCS::FParameters>();
+		PassParameters->InRegionMin = InRegionRect.Min;
+		PassParameters->InRegionSize = InRegionRect.Size();
+		PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InTexture, 0));
+		PassParameters->OutSAT = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(SummedAreaTableTexture, 0));
+
+		// one group per row, then one per column
+		FComputeShaderUtils::AddPass(
+			InGraphBuilder,
+			RDG_EVENT_NAME("VARID - SummedAreaTable - %s", bVertical ? TEXT("Vertical") : TEXT("Horizontal")),
+			SummedAreaTableShader,
+			PassParameters,
+			FIntVector(bVertical ? InRegionRect.Width() : InRegionRect.Height(), 1, 1));
+	}
+
+	return SummedAreaTableTexture;
+}
+
+/*****************************************************************************************************************/
+// FX pipeline
+
+/** every working texture the compositor reads */
+struct FVARIDFXTextures
+{
+	FRDGTextureRef BlurVFMapTexture = nullptr;
+	FRDGTextureRef ContrastVFMapTexture = nullptr;
+	FRDGTextureRef InpaintVFMapTexture = nullptr;
+	FRDGTextureRef WarpVFMapTexture = nullptr;
+	FRDGTextureRef InpaintColourTexture = nullptr;
+	FRDGTextureRef GaussianTexture = nullptr;
+	FRDGTextureRef LaplacianTexture = nullptr;	// nullptr when reconstructing fused
+	FRDGTextureRef ContrastTexture = nullptr;
+	FRDGTextureRef SummedAreaTableTexture = nullptr;	// nullptr unless r.VARID.Blur.SummedAreaTable
+	bool bContrastLevel0Deferred = false;	// level 0 of ContrastTexture is left to the compute compositor
+};
+
+/** true if the compute compositor can take over contrast level 0 with the current settings */
+static bool CanDeferContrastLevel0_RenderThread(const FVARIDWorkingTexturePlan& InPlan, bool bInFusedReconstruct)
+{
+	return CVarVARIDCompositorCompute.GetValueOnRenderThread() != 0
+		&& bInFusedReconstruct
+		&& CVarVARIDBlurSummedAreaTable.GetValueOnRenderThread() == 0
+		&& InPlan.NumMips > 1;
+}
+
+/**
+ * builds the VF maps and FX for every eye of the plan. InEyeInputs are in the same order as the plan eyes.
+ * InSharedPyramids, if given, holds the inpainted colour and pyramids of an earlier view of the same image. Only the VF maps and contrast are built then
+ */
+static FVARIDFXTextures BuildFXTextures_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InSceneColourTexture, const FVARIDWorkingTexturePlan& InPlan, const TArray<FVARIDVFMapEyeInput>& InEyeInputs, const FVARIDFXTextures* InSharedPyramids = nullptr)
+{
+	const uint8 NumberOfMipsToGenerate = InPlan.NumMips;
+
+	FVARIDFXTextures Textures;
+
+	/*************************************************************/
+
+	// the VF maps are drawn rather than dispatched when they are interpolated from their mesh
+	const ETextureCreateFlags VFMapTextureFlags = CVarVARIDVFMapInterpolation.GetValueOnRenderThread() != 0 ? TexCreate_ShaderResource | TexCreate_UAV | TexCreate_RenderTargetable : TexCreate_ShaderResource | TexCreate_UAV;
+
+	// useful for simple height maps
+	FRDGTextureDesc R32_FLOAT_TextureDesc = FRDGTextureDesc::Create2D
+	(
+		InPlan.Extent,
+		EPixelFormat::PF_R32_FLOAT,		// TODO recuce to 16 for performance?
+		FClearValueBinding::Black,
+		VFMapTextureFlags,
+		NumberOfMipsToGenerate,
+		1
+	);
+
+	// useful for UV position/normal maps
+	FRDGTextureDesc G32R32F_TextureDesc = FRDGTextureDesc::Create2D
+	(
+		InPlan.Extent,
+		EPixelFormat::PF_G32R32F,		// TODO reduce to 16 for performance?
+		FClearValueBinding::Black,
+		VFMapTextureFlags,
+		NumberOfMipsToGenerate,
+		1
+	);
+
+	// useful for most colour processing
+	FRDGTextureDesc R16G16B16A16_UNORM_TextureDesc = FRDGTextureDesc::Create2D
+	(
+		InPlan.Extent,
+		EPixelFormat::PF_R16G16B16A16_UNORM,	// original is 8 bits per channel... we give it double precision to work with compared to input and output format
+		FClearValueBinding::Black,
+		TexCreate_ShaderResource | TexCreate_UAV,
+		NumberOfMipsToGenerate,
+		1
+	);
+
+	/*************************************************************/
+	// build VF maps
+
+	// NOTE: some VF maps e.g. contrast and inpaint require a mip map texture, so all VF map textures are created with the ability to be a mip map
+
+	Textures.BlurVFMapTexture = InGraphBuilder.CreateTexture(R32_FLOAT_TextureDesc, TEXT("BlurVFMapTexture"));
+	Textures.ContrastVFMapTexture = InGraphBuilder.CreateTexture(R32_FLOAT_TextureDesc, TEXT("ContrastVFMapTexture"));
+	Textures.InpaintVFMapTexture = InGraphBuilder.CreateTexture(R32_FLOAT_TextureDesc, TEXT("InpaintVFMapTexture"));
+	Textures.WarpVFMapTexture = InGraphBuilder.CreateTexture(G32R32F_TextureDesc, TEXT("WarpVFMapTexture"));
+
+	// one dispatch for every map, unless they are drawn from their mesh or summed at a lower resolution, which go map by map
+	const bool bCombinedVFMaps = CVarVARIDVFMapCombined.GetValueOnRenderThread() != 0 && CVarVARIDVFMapInterpolation.GetValueOnRenderThread() == 0 && !UseVFMapLowRes_RenderThread();
+	bool bWarpVFMapBuilt = false;
+
+	if (bCombinedVFMaps)
+	{
+		bWarpVFMapBuilt = BuildVFMapTexturesCombined_RenderThread(InGraphBuilder, InPlan, InEyeInputs, Textures.BlurVFMapTexture, Textures.ContrastVFMapTexture, Textures.InpaintVFMapTexture, Textures.WarpVFMapTexture);
+	}
+	else
+	{
+		BuildHeightMapTexture_RenderThread(InGraphBuilder, InPlan, InEyeInputs, [](const FVARIDEye& Eye) { return Eye.Blur.Enabled ? &Eye.Blur.VFMap : nullptr; }, 0, 0.0f, Textures.BlurVFMapTexture);
+		for (int32 MipLevel = 0; MipLevel < NumberOfMipsToGenerate; MipLevel++)
+		{
+			BuildHeightMapTexture_RenderThread(InGraphBuilder, InPlan, InEyeInputs, [MipLevel](const FVARIDEye& Eye) { return Eye.Contrast.Enabled && Eye.Contrast.VFMaps.IsValidIndex(MipLevel) ? &Eye.Contrast.VFMaps[MipLevel] : nullptr; }, MipLevel, 0.0f, Textures.ContrastVFMapTexture);
+		}
+		BuildHeightMapTexture_RenderThread(InGraphBuilder, InPlan, InEyeInputs, [](const FVARIDEye& Eye) { return Eye.Inpaint.Enabled ? &Eye.Inpaint.VFMap : nullptr; }, 0, 0.0f, Textures.InpaintVFMapTexture);
+	}
+
+	if (!bWarpVFMapBuilt)
+	{
+		BuildNormalMapTexture_RenderThread(InGraphBuilder, InPlan, InEyeInputs, [](const FVARIDEye& Eye) { return Eye.Warp.Enabled ? &Eye.Warp.VFMap : nullptr; }, 0.5f, Textures.WarpVFMapTexture);
+	}
+
+	/*************************************************************/
+	// build FX
+
+	const FVARIDPyramidQuality PyramidQuality = GetPyramidQuality_RenderThread();
+	const bool bFusedReconstruct = CVarVARIDContrastFusedReconstruct.GetValueOnRenderThread() != 0 && PyramidQuality.KernelWidth == FIXED_PYRAMID_KERNEL_WIDTH;
+
+	// only if they were built the way this view would build them
+	const bool bSharedPyramids = InSharedPyramids && (InSharedPyramids->LaplacianTexture == nullptr) == bFusedReconstruct;
+
+	if (bSharedPyramids)
+	{
+		Textures.InpaintColourTexture = InSharedPyramids->InpaintColourTexture;
+		Textures.GaussianTexture = InSharedPyramids->GaussianTexture;
+		Textures.LaplacianTexture = InSharedPyramids->LaplacianTexture;
+	}
+	else
+	{
+		// inpainter comes first as it only applies to mip level 0. Other FX will take the inpainter result and create inpainted pyramids
+		FRDGTextureRef InpaintPositionTexture = InGraphBuilder.CreateTexture(G32R32F_TextureDesc, TEXT("InpaintPositionTexture"));	// not currently used. Included for a future improved inpainter FX...
+		Textures.InpaintColourTexture = InGraphBuilder.CreateTexture(R16G16B16A16_UNORM_TextureDesc, TEXT("InpaintColourTexture"));
+		BuildInpaintTexture_RenderThread(InGraphBuilder, InSceneColourTexture, Textures.InpaintVFMapTexture, InpaintPositionTexture, Textures.InpaintColourTexture, InPlan);
+
+		Textures.GaussianTexture = InGraphBuilder.CreateTexture(R16G16B16A16_UNORM_TextureDesc, TEXT("GaussianTexture"));
+
+		if (!bFusedReconstruct)
+		{
+			Textures.LaplacianTexture = InGraphBuilder.CreateTexture(R16G16B16A16_UNORM_TextureDesc, TEXT("LaplacianTexture"));
+		}
+	}
+
+	Textures.ContrastTexture = InGraphBuilder.CreateTexture(R16G16B16A16_UNORM_TextureDesc, TEXT("ContrastTexture"));
+
+	Textures.bContrastLevel0Deferred = CanDeferContrastLevel0_RenderThread(InPlan, bFusedReconstruct);
+
+	// the pyramid passes clamp their reads to the viewport, so they run once per eye to keep the eyes apart
+	for (const FVARIDWorkingEye& Eye : InPlan.Eyes)
+	{
+		const FIntRect& ViewportRect = Eye.WorkingRect;
+
+		if (!bSharedPyramids)
+		{
+			BuildGaussianPyramid_RenderThread(InGraphBuilder, Textures.InpaintColourTexture, Textures.GaussianTexture, ViewportRect, PyramidQuality);
+		}
+
+		if (bFusedReconstruct)
+		{
+			BuildContrastTextureFused_RenderThread(InGraphBuilder, Textures.GaussianTexture, Textures.ContrastVFMapTexture, Textures.ContrastTexture, ViewportRect, Textures.bContrastLevel0Deferred);
+		}
+		else
+		{
+			if (!bSharedPyramids)
+			{
+				BuildLaplacianPyramid_RenderThread(InGraphBuilder, Textures.GaussianTexture, Textures.LaplacianTexture, ViewportRect, PyramidQuality);
+			}
+			BuildContrastTexture_RenderThread(InGraphBuilder, Textures.LaplacianTexture, Textures.ContrastVFMapTexture, Textures.ContrastTexture, ViewportRect, PyramidQuality);
+		}
+	}
+
+	// one table covers every eye - the compositor clamps its boxes to the eye, and the corners of a box cancel whatever lies outside it
+	if (CVarVARIDBlurSummedAreaTable.GetValueOnRenderThread() != 0)
+	{
+		Textures.SummedAreaTableTexture = BuildSummedAreaTable_RenderThread(InGraphBuilder, Textures.ContrastTexture, InPlan.GetActiveRect());
+	}
+
+	return Textures;
+}
+
+/*****************************************************************************************************************/
+// helpers
+
+static EVARIDWorkingTextureMode GetWorkingTextureMode_RenderThread()
+{
+	switch (CVarVARIDWorkingTextures.GetValueOnRenderThread())
+	{
+	case 0:
+		return EVARIDWorkingTextureMode::SceneSized;
+	case 2:
+		return EVARIDWorkingTextureMode::SinglePassStereo;
+	default:
+		return EVARIDWorkingTextureMode::PerEye;
+	}
+}
+
+/** 0 = left or mono, 1 = right. Matches FVARIDWorkingEye::EyeIndex */
+static int32 GetEyeIndex(const EStereoscopicPass InStereoPass)
+{
+	return InStereoPass == eSSP_RIGHT_EYE ? 1 : 0;
+}
+
+/** the view of the other eye of a stereo family, or nullptr */
+static const FSceneView* FindOtherEyeView(const FSceneView& InView)
+{
+	const bool bStereo = InView.StereoPass == eSSP_LEFT_EYE || InView.StereoPass == eSSP_RIGHT_EYE;
+
+	if (bStereo && InView.Family)
+	{
+		for (const FSceneView* OtherView : InView.Family->Views)
+		{
+			if (OtherView && OtherView != &InView && (OtherView->StereoPass == eSSP_LEFT_EYE || OtherView->StereoPass == eSSP_RIGHT_EYE) && GetEyeIndex(OtherView->StereoPass) != GetEyeIndex(InView.StereoPass))
 			{
-				FShaderParameterMapPoint P;
-				P.X = ((InVFMapPoints[i].NormX + InEyeGazePoint.X) * XScale) + XOffset;
-				P.Y = (InVFMapPoints[i].NormY + InEyeGazePoint.Y);
-				P.Value = InVFMapPoints[i].NormValue;
-				P.Padding = 1.0f;	// makes the struct have 16 byte alignment
-				FilteredPoints.Add(P);
+				return OtherView;
 			}
 		}
 	}
 
-	// Even if there are no points Keep going - still need to generate a texture as the remaining parts of the render pipeline are relying on a valid texture to exist.
+	return nullptr;
+}
 
-	TShaderMapRef<FVARIDPositionMapCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+static FVARIDWorkingTexturePlan CreateWorkingTexturePlan_RenderThread(const FSceneView& InView, const FScreenPassTexture& InSceneColor)
+{
+	const EVARIDWorkingTextureMode Mode = GetWorkingTextureMode_RenderThread();
+	const bool bStereo = InView.StereoPass == eSSP_LEFT_EYE || InView.StereoPass == eSSP_RIGHT_EYE;
+	const int32 EyeIndex = GetEyeIndex(InView.StereoPass);
 
-	FVARIDPositionMapCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDPositionMapCS::FParameters>();
-	PassParameters->DispatchThreadIDOffset = DispatchThreadIDOffset;
-	PassParameters->TexelSize = TexelSize;
-	PassParameters->LinearSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-	PassParameters->PointSampler = TStaticSamplerState<SF_Point, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-	PassParameters->InOriginOffset = InOriginOffset;	// intensity origin
-	PassParameters->NumVFMapPoints = FilteredPoints.Num();
-	if (FilteredPoints.Num() > 0)
-	{
-		PassParameters->VFMapPoints = InGraphBuilder.CreateSRV(CreateStructuredBuffer(InGraphBuilder, TEXT("VFMapPoints"), sizeof(FShaderParameterMapPoint), FilteredPoints.Num(), FilteredPoints.GetData(), sizeof(FShaderParameterMapPoint) * FilteredPoints.Num(), ERDGInitialDataFlags::None));
-	}
-	else
+	// unknown eyes are left empty - single pass stereo then falls back to per eye
+	TArray<FIntRect> EyeSceneRects;
+	EyeSceneRects.SetNum(bStereo ? 2 : 1);
+	EyeSceneRects[EyeIndex] = InSceneColor.ViewRect;
+
+	// the other eye's scene colour rect is only known if post processing hasn't resized this one
+	if (Mode == EVARIDWorkingTextureMode::SinglePassStereo && bStereo && InView.ViewRect == InSceneColor.ViewRect)
 	{
-		// HACK cant pass array with size zero. Have to pass at least one element. 
-		FShaderParameterMapPoint DummyPoint;
-		PassParameters->VFMapPoints = InGraphBuilder.CreateSRV(CreateStructuredBuffer(InGraphBuilder, TEXT("VFMapPoints"), sizeof(FShaderParameterMapPoint), 1, &DummyPoint, sizeof(FShaderParameterMapPoint), ERDGInitialDataFlags::None));
+		if (const FSceneView* OtherView = FindOtherEyeView(InView))
+		{
+			EyeSceneRects[GetEyeIndex(OtherView->StereoPass)] = OtherView->ViewRect;
+		}
 	}
-	PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutTexture, InMipLevel));
-
-	FComputeShaderUtils::AddPass(
-		InGraphBuilder,
-		RDG_EVENT_NAME("VARID - Build Position Map - MipLevel=%d", InMipLevel),
-		ComputeShader,
-		PassParameters,
-		FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
 
-	return true;
+	return FVARIDWorkingTexturePlan::Create(Mode, InSceneColor.Texture->Desc.Extent, EyeSceneRects, EyeIndex, FMath::Min(MAX_NUM_MIP_LEVELS, GVARIDQualitySettingsRenderThread.MaxNumMips));
 }
 
-/*****************************************************************************************************************/
-// FX 
-
-static bool BuildPyramid_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InTexture, FRHISamplerState* InSampler, const FIntRect& InViewportRect)
+/** InEyeProfiles holds the profile of the view of each eye. An eye without a valid one gets no FX */
+static TArray<FVARIDVFMapEyeInput> GetVFMapEyeInputs(const FVARIDWorkingTexturePlan& InPlan, const FVARIDProfile* const InEyeProfiles[2], const FVARIDEyeTracking& InEyeTracking, const bool bInStereo)
 {
-	check(InTexture);
+	TArray<FVARIDVFMapEyeInput> EyeInputs;
 
-	const FRDGTextureDesc& TextureDesc = InTexture->Desc;
-	TShaderMapRef<FVARIDBasicResampleCS> ResampleComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
-
-	for (uint32 MipLevel = 1; MipLevel < TextureDesc.NumMips; ++MipLevel)	// NOTE start at level 1 (level zero should already exist!)
+	for (const FVARIDWorkingEye& Eye : InPlan.Eyes)
 	{
-		const FIntPoint TextureSize(FMath::Max(TextureDesc.Extent.X >> MipLevel, 1), FMath::Max(TextureDesc.Extent.Y >> MipLevel, 1));
-		const FVector2D TexelSize(1.0f / TextureSize.X, 1.0f / TextureSize.Y);
-		const FIntPoint DispatchSize(FMath::Max(InViewportRect.Width() >> MipLevel, 1), FMath::Max(InViewportRect.Height() >> MipLevel, 1));
-		const FIntPoint DispatchThreadIDOffset(InViewportRect.Min.X >> MipLevel, InViewportRect.Min.Y >> MipLevel);
-
-		FVARIDBasicResampleCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDBasicResampleCS::FParameters>();
-		PassParameters->InDispatchThreadIDOffset = DispatchThreadIDOffset;
-		PassParameters->InTexelSize = TexelSize;
-		PassParameters->InSampler = InSampler;
-		PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InTexture, MipLevel - 1));	// SRV is for a different mip level to the UAV - therefore Texture can appear to be both input and output
-		PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(InTexture, MipLevel));
+		const FVARIDProfile* Profile = InEyeProfiles[Eye.EyeIndex];
 
-		FComputeShaderUtils::AddPass(
-			InGraphBuilder,
-			RDG_EVENT_NAME("VARID - Build Pyramid - Downsample - MipLevel=%d", MipLevel),
-			ResampleComputeShader,
-			PassParameters,
-			FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+		FVARIDVFMapEyeInput& EyeInput = EyeInputs.AddDefaulted_GetRef();
+		EyeInput.ProfileEye = !Profile || !Profile->IsValid ? nullptr : (Eye.EyeIndex == 1 ? &Profile->RightEye : &Profile->LeftEye);
+		EyeInput.GazePoint = Eye.EyeIndex == 1 ? InEyeTracking.RightEyeGazePoint : InEyeTracking.LeftEyeGazePoint;
+		EyeInput.StereoPass = !bInStereo ? eSSP_FULL : (Eye.EyeIndex == 1 ? eSSP_RIGHT_EYE : eSSP_LEFT_EYE);
+		EyeInput.EyeIndex = Eye.EyeIndex;
 	}
 
-	return true;
+	return EyeInputs;
 }
 
-static bool BuildPyramidCopy_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InTexture, FRDGTextureRef OutTexture, FRHISamplerState* InSampler, const FIntRect& InViewportRect)
+/** FVARIDViewProfiles::GetInpaintHash() of every eye */
+static uint32 GetInpaintHash(const TArray<FVARIDVFMapEyeInput>& InEyeInputs)
 {
-	check(InTexture);
-	check(OutTexture);
+	uint32 Hash = 0;
 
-	const FRDGTextureDesc& OutTextureDesc = OutTexture->Desc;
-	TShaderMapRef<FVARIDBasicResampleCS> ResampleComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+	for (const FVARIDVFMapEyeInput& EyeInput : InEyeInputs)
+	{
+		Hash = HashCombine(Hash, FVARIDViewProfiles::GetInpaintHash(EyeInput.ProfileEye, EyeInput.GazePoint));
+	}
 
-	for (uint32 MipLevel = 0; MipLevel < OutTextureDesc.NumMips; ++MipLevel)
+	return Hash;
+}
+
+/**
+ * draws the FX of InCompositeEye over InViewportRect of the render target: the compute compositor when contrast level 0 was left to it, otherwise the raster one.
+ * InStereoPass picks the eye quad of a scene sized working texture
+ */
+static FScreenPassTexture Composite_RenderThread(FRDGBuilder& InGraphBuilder, const FVARIDWorkingTexturePlan& InPlan, const FVARIDWorkingEye& InCompositeEye, const EStereoscopicPass InStereoPass, const FVARIDFXTextures& InFXTextures, const FIntRect& InViewportRect, FScreenPassRenderTarget InOutRenderTarget)
+{
+	/*************************************************************/
+	// compute compositor
+
+	if (InFXTextures.bContrastLevel0Deferred)
 	{
-		const FIntPoint DestTextureSize(FMath::Max(OutTextureDesc.Extent.X >> MipLevel, 1), FMath::Max(OutTextureDesc.Extent.Y >> MipLevel, 1));
-		const FVector2D TexelSize = FVector2D(1.0f / DestTextureSize.X, 1.0f / DestTextureSize.Y);
-		const FIntPoint DispatchSize(FMath::Max(InViewportRect.Width() >> MipLevel, 1), FMath::Max(InViewportRect.Height() >> MipLevel, 1));
-		const FIntPoint DispatchThreadIDOffset(InViewportRect.Min.X >> MipLevel, InViewportRect.Min.Y >> MipLevel);
+		const FIntRect& WorkingRect = InCompositeEye.WorkingRect;
+		const FIntRect HiResRect = FVARIDPyramidLayout::GetMipViewportRect(WorkingRect, 0);
+		const FIntRect LoResRect = FVARIDPyramidLayout::GetMipViewportRect(WorkingRect, 1);
 
-		if (MipLevel == 0)
-		{
-			TShaderMapRef<FVARIDDirectCopyCS> DirectCopyComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
-			FVARIDDirectCopyCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDDirectCopyCS::FParameters>();
-			PassParameters->DispatchThreadIDOffset = DispatchThreadIDOffset;
-			PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InTexture, 0));
-			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutTexture, 0));
+		check(WorkingRect.Size() == InViewportRect.Size());
 
-			FComputeShaderUtils::AddPass(
-				InGraphBuilder,
-				RDG_EVENT_NAME("VARID - Direct Copy - MipLevel=%d", MipLevel),
-				DirectCopyComputeShader,
-				PassParameters,
-				FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
-		}
-		else
-		{
-			FVARIDBasicResampleCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDBasicResampleCS::FParameters>();
-			PassParameters->InDispatchThreadIDOffset = DispatchThreadIDOffset;
-			PassParameters->InTexelSize = TexelSize;
-			PassParameters->InSampler = InSampler;
-			PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(OutTexture, MipLevel - 1));	// SRV is for a different mip level to the UAV - therefore Texture can appear to be both input and output
-			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutTexture, MipLevel));
+		// the output may not allow UAVs (e.g. an XR swap chain). write to a temporary and copy it over instead
+		FRDGTextureRef OutputTexture = InOutRenderTarget.Texture;
+		const bool bCopyToOutput = !(OutputTexture->Desc.Flags & TexCreate_UAV);
 
-			FComputeShaderUtils::AddPass(
-				InGraphBuilder,
-				RDG_EVENT_NAME("VARID - Build Pyramid Copy - Downsample - MipLevel=%d", MipLevel),
-				ResampleComputeShader,
-				PassParameters,
-				FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+		if (bCopyToOutput)
+		{
+			FRDGTextureDesc TemporaryDesc = FRDGTextureDesc::Create2D(OutputTexture->Desc.Extent, OutputTexture->Desc.Format, FClearValueBinding::Black, TexCreate_ShaderResource | TexCreate_UAV);
+			OutputTexture = InGraphBuilder.CreateTexture(TemporaryDesc, TEXT("CompositorOutputTexture"));
 		}
-	}
 
-	return true;
-}
+		// levels 1 and up. level 0 was never written
+		FRDGTextureSRVDesc ContrastSRVDesc = FRDGTextureSRVDesc::Create(InFXTextures.ContrastTexture);
+		ContrastSRVDesc.MipLevel = 1;
+		ContrastSRVDesc.NumMipLevels = InPlan.NumMips - 1;
 
-static void BuildGaussianPyramid_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InTexture, FRDGTextureRef OutGaussianMipTexture, const FIntRect& InViewportRect)
-{
-	check(InTexture);
-	check(OutGaussianMipTexture);
+		// tiles the FX leave as they are are the gaussian, copied rather than composited
+		const bool bUseTileLists = UseTileClassification_RenderThread();
+		const FVector2D WarpUVScale((float)InPlan.SceneExtent.X / InPlan.Extent.X, (float)InPlan.SceneExtent.Y / InPlan.Extent.Y);
+		FVARIDTileListBuffers TileLists;
 
-	const FRDGTextureDesc& OutGaussianMipTextureDesc = OutGaussianMipTexture->Desc;
+		if (bUseTileLists)
+		{
+			FVARIDCompositorTileInputs CompositorInputs;
+			CompositorInputs.BlurVFMapTexture = InFXTextures.BlurVFMapTexture;
+			CompositorInputs.WarpVFMapTexture = InFXTextures.WarpVFMapTexture;
+			CompositorInputs.BlurScale = InPlan.NumMips;
+			CompositorInputs.WarpTexelScale = WarpUVScale * FVector2D(InPlan.Extent.X, InPlan.Extent.Y);
+			CompositorInputs.Threshold = GetCompositorTileThreshold_RenderThread();
+
+			TileLists = ClassifyTiles_RenderThread(InGraphBuilder, InFXTextures.ContrastVFMapTexture, 0, InPlan.NumMips - 1, WorkingRect, CONTRAST_TILE_DILATION, GetContrastTileThreshold_RenderThread(), &CompositorInputs);
+		}
 
-	FRDGTextureRef BlurredMipTexture = InGraphBuilder.CreateTexture(OutGaussianMipTextureDesc, TEXT("VARID_TEMP_MipsRenderTargetTexture"));
+		FVARIDCompositorCS::FPermutationDomain PermutationVector;
+		PermutationVector.Set<FVARIDUseTileListDim>(bUseTileLists);
+		TShaderMapRef<FVARIDCompositorCS> CompositorShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+
+		const FIntVector GroupCount = FComputeShaderUtils::GetGroupCount(InViewportRect.Size(), FComputeShaderUtils::kGolden2DGroupSize);
+
+		FVARIDCompositorCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDCompositorCS::FParameters>();
+		PassParameters->InOutputMin = InViewportRect.Min;
+		PassParameters->InOutputSize = InViewportRect.Size();
+		PassParameters->InWorkingMin = WorkingRect.Min;
+		PassParameters->InWorkingExtent = FVector2D(InPlan.Extent.X, InPlan.Extent.Y);
+		PassParameters->InHiResMin = HiResRect.Min;
+		PassParameters->InHiResMax = HiResRect.Max;
+		PassParameters->InLoResMin = LoResRect.Min;
+		PassParameters->InLoResMax = LoResRect.Max;
+		PassParameters->InMaxMipLevel = InPlan.NumMips;
+		PassParameters->InLastMipLevel = InPlan.NumMips - 1;
+		PassParameters->InWarpUVScale = WarpUVScale;
+		PassParameters->InBlurVFMapSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InFXTextures.BlurVFMapTexture, 0));
+		PassParameters->InWarpVFMapSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InFXTextures.WarpVFMapTexture, 0));
+		PassParameters->InContrastSRV = InGraphBuilder.CreateSRV(ContrastSRVDesc);
+		PassParameters->InLoResGaussianSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InFXTextures.GaussianTexture, 1));
+		PassParameters->InHiResGaussianSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InFXTextures.GaussianTexture, 0));
+		PassParameters->InVFMapSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InFXTextures.ContrastVFMapTexture, 0));
+		PassParameters->InBilinearSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+		PassParameters->InTrilinearSampler = TStaticSamplerState<SF_Trilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+		PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutputTexture, 0));
 
-	TShaderMapRef<FVARIDGaussianBlurCS> GaussianBlurComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
-	TShaderMapRef<FVARIDBasicResampleCS> ResampleComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		AddTileListPass(
+			InGraphBuilder,
+			RDG_EVENT_NAME("VARID FX Compositor - Compute%s", bUseTileLists ? TEXT(" - Affected Tiles") : TEXT("")),
+			CompositorShader,
+			PassParameters,
+			GroupCount,
+			TileLists,
+			AFFECTED_TILE_LIST);
 
-	for (uint32 MipLevel = 0; MipLevel < OutGaussianMipTextureDesc.NumMips; ++MipLevel)
-	{
-		if (MipLevel == 0)
+		if (bUseTileLists)
 		{
-			const FIntPoint DispatchSize = InViewportRect.Size();
-			const FIntPoint DispatchThreadIDOffset = InViewportRect.Min;
+			FVARIDCompositorCopyCS::FPermutationDomain CopyPermutationVector;
+			CopyPermutationVector.Set<FVARIDUseTileListDim>(true);
+			TShaderMapRef<FVARIDCompositorCopyCS> CopyShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), CopyPermutationVector);
+
+			FVARIDCompositorCopyCS::FParameters* CopyPassParameters = InGraphBuilder.AllocParameters<FVARIDCompositorCopyCS::FParameters>();
+			CopyPassParameters->InOutputMin = InViewportRect.Min;
+			CopyPassParameters->InOutputSize = InViewportRect.Size();
+			CopyPassParameters->InWorkingMin = WorkingRect.Min;
+			CopyPassParameters->InHiResGaussianSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InFXTextures.GaussianTexture, 0));
+			CopyPassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutputTexture, 0));
+
+			AddTileListPass(
+				InGraphBuilder,
+				RDG_EVENT_NAME("VARID FX Compositor - Copy - Unaffected Tiles"),
+				CopyShader,
+				CopyPassParameters,
+				GroupCount,
+				TileLists,
+				UNAFFECTED_TILE_LIST);
+		}
 
-			TShaderMapRef<FVARIDDirectCopyCS> DirectCopyComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		if (bCopyToOutput)
+		{
+			FRHICopyTextureInfo CopyInfo;
+			CopyInfo.Size = FIntVector(InViewportRect.Width(), InViewportRect.Height(), 1);
+			CopyInfo.SourcePosition = FIntVector(InViewportRect.Min.X, InViewportRect.Min.Y, 0);
+			CopyInfo.DestPosition = CopyInfo.SourcePosition;
+			AddCopyTexturePass(InGraphBuilder, OutputTexture, InOutRenderTarget.Texture, CopyInfo);
+		}
 
-			FVARIDDirectCopyCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDDirectCopyCS::FParameters>();
-			PassParameters->DispatchThreadIDOffset = DispatchThreadIDOffset;
-			PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InTexture, 0));
-			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutGaussianMipTexture, 0));
+		return MoveTemp(InOutRenderTarget);
+	}
 
-			FComputeShaderUtils::AddPass(
-				InGraphBuilder,
-				RDG_EVENT_NAME("VARID - Build Gaussian Pyramid - Direct Copy - MipLevel=%d", 0),
-				DirectCopyComputeShader,
-				PassParameters,
-				FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+	/*************************************************************/
+	// raster compositor
+
+	{
+		FRHIVertexBuffer* VertexBuffer = GQuadVertexBufferFull.VertexBufferRHI;
+		FVector4 UVScaleBias(1.0f, 1.0f, 0.0f, 0.0f);
+
+		if (InPlan.Mode == EVARIDWorkingTextureMode::SceneSized)
+		{
+			// the eye quads cover the half of the texture the eye is drawn to
+			switch (InStereoPass)
+			{
+			case eSSP_LEFT_EYE:
+				VertexBuffer = GQuadVertexBufferLeft.VertexBufferRHI;
+				break;
+			case eSSP_RIGHT_EYE:
+				VertexBuffer = GQuadVertexBufferRight.VertexBufferRHI;
+				break;
+			default:
+				break;
+			}
 		}
 		else
 		{
-			int32 LoResMipLevel = MipLevel;
-			int32 HiResMipLevel = MipLevel - 1;
+			const FIntRect& WorkingRect = InCompositeEye.WorkingRect;
+			UVScaleBias = FVector4(
+				(float)WorkingRect.Width() / InPlan.Extent.X,
+				(float)WorkingRect.Height() / InPlan.Extent.Y,
+				(float)WorkingRect.Min.X / InPlan.Extent.X,
+				(float)WorkingRect.Min.Y / InPlan.Extent.Y);
+		}
 
-			const FIntPoint LoResTextureSize(FMath::Max(OutGaussianMipTextureDesc.Extent.X >> LoResMipLevel, 1), FMath::Max(OutGaussianMipTextureDesc.Extent.Y >> LoResMipLevel, 1));
-			const FVector2D LoResTexelSize(1.0f / LoResTextureSize.X, 1.0f / LoResTextureSize.Y);
+		TShaderMapRef<FVARIDQuadVS> VertexShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
 
-			const FIntPoint LoResDispatchSize(FMath::Max(InViewportRect.Width() >> LoResMipLevel, 1), FMath::Max(InViewportRect.Height() >> LoResMipLevel, 1));
-			const FIntPoint LoResDispatchThreadIDOffset(InViewportRect.Min.X >> LoResMipLevel, InViewportRect.Min.Y >> LoResMipLevel);
+		const bool bSummedAreaTableBlur = InFXTextures.SummedAreaTableTexture != nullptr;
 
-			const FIntPoint HiResDispatchSize(FMath::Max(InViewportRect.Width() >> HiResMipLevel, 1), FMath::Max(InViewportRect.Height() >> HiResMipLevel, 1));
-			const FIntPoint HiResDispatchThreadIDOffset(InViewportRect.Min.X >> HiResMipLevel, InViewportRect.Min.Y >> HiResMipLevel);
+		FVARIDQuadPS::FPermutationDomain PixelPermutationVector;
+		PixelPermutationVector.Set<FVARIDBlurSummedAreaTableDim>(bSummedAreaTableBlur);
+		TShaderMapRef<FVARIDQuadPS> PixelShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PixelPermutationVector);
 
-			// DONT downsample THEN Filter. Noise will alias back in. 
-			// DO filter THEN downsample
+		FVARIDQuadPS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDQuadPS::FParameters>();
+		PassParameters->InTrilinearSampler = TStaticSamplerState<SF_Trilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+		PassParameters->InBilinearSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+		PassParameters->InPointSampler = TStaticSamplerState<SF_Point, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+		PassParameters->InMaxMipLevel = InPlan.NumMips;
+		PassParameters->InUVScaleBias = UVScaleBias;
+		PassParameters->InWarpUVScale = FVector2D((float)InPlan.SceneExtent.X / InPlan.Extent.X, (float)InPlan.SceneExtent.Y / InPlan.Extent.Y);
 
-			{
-				// blur
-				FVARIDGaussianBlurCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDGaussianBlurCS::FParameters>();
-				PassParameters->DispatchThreadIDOffset = HiResDispatchThreadIDOffset;
-				PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(OutGaussianMipTexture, HiResMipLevel));
-				PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(BlurredMipTexture, HiResMipLevel));
+		PassParameters->InGaussianSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(InFXTextures.GaussianTexture));
+		PassParameters->InLaplacianSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(InFXTextures.LaplacianTexture ? InFXTextures.LaplacianTexture : InFXTextures.GaussianTexture));	// debug only. there is no laplacian texture when reconstructing fused
+		PassParameters->InContrastSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(InFXTextures.ContrastTexture));
+		PassParameters->InInpaintSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(InFXTextures.InpaintColourTexture));
 
-				FComputeShaderUtils::AddPass(
-					InGraphBuilder,
-					RDG_EVENT_NAME("VARID - Build Gaussian Pyramid - Gaussian Blur - MipLevel=%d", HiResMipLevel),
-					GaussianBlurComputeShader,
-					PassParameters,
-					FComputeShaderUtils::GetGroupCount(HiResDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
-			}
+		PassParameters->InBlurVFMapSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(InFXTextures.BlurVFMapTexture));
+		PassParameters->InContrastVFMapSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(InFXTextures.ContrastVFMapTexture));
+		PassParameters->InInpaintVFMapSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(InFXTextures.InpaintVFMapTexture));
+		PassParameters->InWarpVFMapSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(InFXTextures.WarpVFMapTexture));
+
+		if (bSummedAreaTableBlur)
+		{
+			PassParameters->InSummedAreaTableSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(InFXTextures.SummedAreaTableTexture));
+			PassParameters->InSATOrigin = InPlan.GetActiveRect().Min;
+			PassParameters->InSATViewportMin = InCompositeEye.WorkingRect.Min;
+			PassParameters->InSATViewportMax = InCompositeEye.WorkingRect.Max;
+			PassParameters->InWorkingExtent = FVector2D(InPlan.Extent.X, InPlan.Extent.Y);
+		}
+
+		PassParameters->RenderTargets[0] = InOutRenderTarget.GetRenderTargetBinding();
+
+		ClearUnusedGraphResources(PixelShader, PassParameters);
 
+		InGraphBuilder.AddPass(
+			RDG_EVENT_NAME("VARID FX Compositor"),
+			PassParameters,
+			ERDGPassFlags::Raster,
+			[
+				VertexBuffer,
+				VertexShader,
+				PixelShader,
+				InViewportRect,
+				PassParameters
+			](FRHICommandListImmediate& RHICmdList)
 			{
-				// downsample
-				FVARIDBasicResampleCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDBasicResampleCS::FParameters>();
-				PassParameters->InDispatchThreadIDOffset = LoResDispatchThreadIDOffset;
-				PassParameters->InTexelSize = LoResTexelSize;
-				PassParameters->InSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-				PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(BlurredMipTexture, HiResMipLevel));
-				PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutGaussianMipTexture, LoResMipLevel));
+				FGraphicsPipelineStateInitializer GraphicsPSOInit;
+				RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
+				GraphicsPSOInit.BlendState = TStaticBlendState<>::GetRHI();
+				GraphicsPSOInit.RasterizerState = TStaticRasterizerState<>::GetRHI();
+				GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
+				GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GFilterVertexDeclaration.VertexDeclarationRHI;
+				GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+				GraphicsPSOInit.BoundShaderState.PixelShaderRHI = PixelShader.GetPixelShader();
+				GraphicsPSOInit.PrimitiveType = PT_TriangleStrip;
+				SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit);
+				SetShaderParameters(RHICmdList, PixelShader, PixelShader.GetPixelShader(), *PassParameters);
+				RHICmdList.SetStreamSource(0, VertexBuffer, 0);
+				RHICmdList.SetViewport(InViewportRect.Min.X, InViewportRect.Min.Y, 0.0f, InViewportRect.Max.X, InViewportRect.Max.Y, 1.0f);
+				RHICmdList.DrawPrimitive(0, 2, 1);
+			});	// end pass
+
+		return MoveTemp(InOutRenderTarget);
+	}
+}
 
-				FComputeShaderUtils::AddPass(
-					InGraphBuilder,
-					RDG_EVENT_NAME("VARID - Build Gaussian Pyramid - Downsample - MipLevel=%d", LoResMipLevel),
-					ResampleComputeShader,
-					PassParameters,
-					FComputeShaderUtils::GetGroupCount(LoResDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
-			}
+/*****************************************************************************************************************/
+// pipeline warm-up
+
+/** an item per permutation of ShaderType compiled for this platform, each creating the RHI shader and its compute pipeline state */
+template <typename ShaderType>
+static void AddComputeWarmupItems(const TCHAR* InName, TArray<FVARIDPipelineWarmupItem>& OutItems)
+{
+	for (int32 PermutationId = 0; PermutationId < ShaderType::FPermutationDomain::PermutationCount; ++PermutationId)
+	{
+		if (!ShaderType::ShouldCompilePermutation(FGlobalShaderPermutationParameters(GMaxRHIShaderPlatform, PermutationId)))
+		{
+			continue;
 		}
+
+		OutItems.Add(FVARIDPipelineWarmupItem(FString::Printf(TEXT("%s %d"), InName, PermutationId), [PermutationId]()
+		{
+			TShaderMapRef<ShaderType> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), typename ShaderType::FPermutationDomain(PermutationId));
+			FRHIComputeShader* ComputeShaderRHI = ComputeShader.GetComputeShader();
+			return ComputeShaderRHI && PipelineStateCache::GetAndOrCreateComputePipelineState(FRHICommandListExecutor::GetImmediateCommandList(), ComputeShaderRHI) != nullptr;
+		}));
 	}
 }
 
-static void BuildLaplacianPyramid_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InGaussianMipTexture, FRDGTextureRef OutLaplacianMipTexture, const FIntRect& InViewportRect)
+/**
+ * an item creating the graphics pipeline state of a draw of VertexShaderType and permutation InPixelPermutationId of PixelShaderType into a single
+ * InFormat target. InSetup sets the rest of the state as the pass does
+ */
+template <typename VertexShaderType, typename PixelShaderType>
+static void AddGraphicsWarmupItem(const TCHAR* InName, int32 InPixelPermutationId, EPixelFormat InFormat, void (*InSetup)(FGraphicsPipelineStateInitializer&), TArray<FVARIDPipelineWarmupItem>& OutItems)
 {
-	check(InGaussianMipTexture);
-	check(OutLaplacianMipTexture);
+	if (!PixelShaderType::ShouldCompilePermutation(FGlobalShaderPermutationParameters(GMaxRHIShaderPlatform, InPixelPermutationId)))
+	{
+		return;
+	}
 
-	const FRDGTextureDesc& OutLaplacianMipTextureDesc = OutLaplacianMipTexture->Desc;
+	OutItems.Add(FVARIDPipelineWarmupItem(FString::Printf(TEXT("%s %d %s"), InName, InPixelPermutationId, GPixelFormats[InFormat].Name), [InPixelPermutationId, InFormat, InSetup]()
+	{
+		TShaderMapRef<VertexShaderType> VertexShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		TShaderMapRef<PixelShaderType> PixelShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), typename PixelShaderType::FPermutationDomain(InPixelPermutationId));
+
+		FGraphicsPipelineStateInitializer GraphicsPSOInit;
+		InSetup(GraphicsPSOInit);
+		GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+		GraphicsPSOInit.BoundShaderState.PixelShaderRHI = PixelShader.GetPixelShader();
+
+		// what ApplyCachedRenderTargets() gives the pass. The texture flags of the target are left out, so the driver's pipeline cache is warmed even where UE's own keys differ
+		GraphicsPSOInit.RenderTargetsEnabled = 1;
+		GraphicsPSOInit.RenderTargetFormats[0] = InFormat;
+		GraphicsPSOInit.NumSamples = 1;
+
+		return GraphicsPSOInit.BoundShaderState.VertexShaderRHI && GraphicsPSOInit.BoundShaderState.PixelShaderRHI
+			&& PipelineStateCache::GetAndOrCreateGraphicsPipelineState(FRHICommandListExecutor::GetImmediateCommandList(), GraphicsPSOInit, EApplyRendertargetOption::DoNothing) != nullptr;
+	}));
+}
 
-	uint32 MaxMipLevelIndex = InGaussianMipTexture->Desc.NumMips - 1;	// convert to zero based index
+/** the state of the compositor draw in Composite_RenderThread() */
+static void SetupCompositorPipelineState(FGraphicsPipelineStateInitializer& OutGraphicsPSOInit)
+{
+	OutGraphicsPSOInit.BlendState = TStaticBlendState<>::GetRHI();
+	OutGraphicsPSOInit.RasterizerState = TStaticRasterizerState<>::GetRHI();
+	OutGraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
+	OutGraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GFilterVertexDeclaration.VertexDeclarationRHI;
+	OutGraphicsPSOInit.PrimitiveType = PT_TriangleStrip;
+}
 
-	FRDGTextureRef UpsampledMipTexture = InGraphBuilder.CreateTexture(OutLaplacianMipTextureDesc, TEXT("VARID_TEMP_UpsampledMipTexture"));
-	FRDGTextureRef BlurredMipTexture = InGraphBuilder.CreateTexture(OutLaplacianMipTextureDesc, TEXT("VARID_TEMP_BlurredMipTexture"));
+/** the state of the mesh draw in BuildHeightMapTextureFromMesh_RenderThread() */
+static void SetupVFMapMeshPipelineState(FGraphicsPipelineStateInitializer& OutGraphicsPSOInit)
+{
+	OutGraphicsPSOInit.BlendState = TStaticBlendState<>::GetRHI();
+	OutGraphicsPSOInit.RasterizerState = TStaticRasterizerState<FM_Solid, CM_None>::GetRHI();
+	OutGraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
+	OutGraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GEmptyVertexDeclaration.VertexDeclarationRHI;
+	OutGraphicsPSOInit.PrimitiveType = PT_TriangleList;
+}
 
-	TShaderMapRef<FVARIDBasicResampleCS> ResampleComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
-	TShaderMapRef<FVARIDGaussianBlurCS> GaussianBlurComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
-	TShaderMapRef<FVARIDLaplacianCS> LaplacianComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+void FVARIDSceneViewExtension::GetPipelineWarmupItems(TArray<FVARIDPipelineWarmupItem>& OutItems)
+{
+	OutItems.Reset();
 
-	// work from the highest mip level (lowest resolution) to the lowest mip level (highest resolution)
-	for (int32 MipLevel = MaxMipLevelIndex; MipLevel >= 0; --MipLevel)
+	// NullRHI has no shaders to create, and nothing to hitch
+	if (!FApp::CanEverRender() || GUsingNullRHI)
 	{
-		if (MipLevel == MaxMipLevelIndex)
-		{
-			const FIntPoint DispatchSize(FMath::Max(InViewportRect.Width() >> MipLevel, 1), FMath::Max(InViewportRect.Height() >> MipLevel, 1));
-			const FIntPoint DispatchThreadIDOffset(InViewportRect.Min.X >> MipLevel, InViewportRect.Min.Y >> MipLevel);
+		return;
+	}
 
-			TShaderMapRef<FVARIDDirectCopyCS> DirectCopyComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+	AddComputeWarmupItems<FVARIDBasicResampleCS>(TEXT("BasicResampleCS"), OutItems);
+	AddComputeWarmupItems<FVARIDLaplacianCS>(TEXT("LaplacianCS"), OutItems);
+	AddComputeWarmupItems<FVARIDGaussianBlurCS>(TEXT("GaussianBlurCS"), OutItems);
+	AddComputeWarmupItems<FVARIDGaussianPyramidCS>(TEXT("GaussianPyramidCS"), OutItems);
+	AddComputeWarmupItems<FVARIDReconstructCS>(TEXT("ReconstructCS"), OutItems);
+	AddComputeWarmupItems<FVARIDReconstructFusedCS>(TEXT("ReconstructFusedCS"), OutItems);
+	AddComputeWarmupItems<FVARIDInpainterInitialiseCS>(TEXT("InpainterInitialiseCS"), OutItems);
+	AddComputeWarmupItems<FVARIDInpainterFillCS>(TEXT("InpainterFillCS"), OutItems);
+	AddComputeWarmupItems<FVARIDInpainterFillTiledCS>(TEXT("InpainterFillTiledCS"), OutItems);
+	AddComputeWarmupItems<FVARIDInpainterFinaliseCS>(TEXT("InpainterFinaliseCS"), OutItems);
+	AddComputeWarmupItems<FVARIDHeightMapCS>(TEXT("HeightMapCS"), OutItems);
+	AddComputeWarmupItems<FVARIDVFMapUpsampleCS>(TEXT("VFMapUpsampleCS"), OutItems);
+	AddComputeWarmupItems<FVARIDVFMapCombinedCS>(TEXT("VFMapCombinedCS"), OutItems);
+	AddComputeWarmupItems<FVARIDVFMapImageCS>(TEXT("VFMapImageCS"), OutItems);
+	AddComputeWarmupItems<FVARIDNormalMapCS>(TEXT("NormalMapCS"), OutItems);
+	AddComputeWarmupItems<FVARIDPositionMapCS>(TEXT("PositionMapCS"), OutItems);
+	AddComputeWarmupItems<FVARIDDirectCopyCS>(TEXT("DirectCopyCS"), OutItems);
+	AddComputeWarmupItems<FVARIDDirectCopyMaskedCS>(TEXT("DirectCopyMaskedCS"), OutItems);
+	AddComputeWarmupItems<FVARIDTileClassifyCS>(TEXT("TileClassifyCS"), OutItems);
+	AddComputeWarmupItems<FVARIDTileListIndirectArgsCS>(TEXT("TileListIndirectArgsCS"), OutItems);
+	AddComputeWarmupItems<FVARIDSummedAreaTableCS>(TEXT("SummedAreaTableCS"), OutItems);
+	AddComputeWarmupItems<FVARIDCompositorCS>(TEXT("CompositorCS"), OutItems);
+	AddComputeWarmupItems<FVARIDCompositorCopyCS>(TEXT("CompositorCopyCS"), OutItems);
+
+	// the compositor draws into the tonemapper's output: 8 bit, or 10 bit or half float for HDR displays
+	const EPixelFormat CompositorFormats[] = { PF_B8G8R8A8, PF_A2B10G10R10, PF_FloatRGBA };
+	for (int32 PermutationId = 0; PermutationId < FVARIDQuadPS::FPermutationDomain::PermutationCount; ++PermutationId)
+	{
+		for (EPixelFormat Format : CompositorFormats)
+		{
+			AddGraphicsWarmupItem<FVARIDQuadVS, FVARIDQuadPS>(TEXT("Compositor"), PermutationId, Format, &SetupCompositorPipelineState, OutItems);
+		}
+	}
 
-			FVARIDDirectCopyCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDDirectCopyCS::FParameters>();
-			PassParameters->DispatchThreadIDOffset = DispatchThreadIDOffset;
-			PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InGaussianMipTexture, MipLevel));
-			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutLaplacianMipTexture, MipLevel));
+	// height maps are one channel, warp fields (OUTPUT_GRADIENT) two
+	FVARIDVFMapMeshPS::FPermutationDomain HeightPermutationVector;
+	HeightPermutationVector.Set<FVARIDOutputGradientDim>(false);
+	FVARIDVFMapMeshPS::FPermutationDomain GradientPermutationVector;
+	GradientPermutationVector.Set<FVARIDOutputGradientDim>(true);
 
-			FComputeShaderUtils::AddPass(
-				InGraphBuilder,
-				RDG_EVENT_NAME("VARID - Build Laplacian Pyramid - Direct Copy - MipLevel=%d", MipLevel),
-				DirectCopyComputeShader,
-				PassParameters,
-				FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
-		}
-		else
-		{
-			int32 LoResMipLevel = MipLevel + 1;
-			int32 HiResMipLevel = MipLevel;
+	AddGraphicsWarmupItem<FVARIDVFMapMeshVS, FVARIDVFMapMeshPS>(TEXT("VFMapMesh"), HeightPermutationVector.ToDimensionValueId(), PF_R32_FLOAT, &SetupVFMapMeshPipelineState, OutItems);
+	AddGraphicsWarmupItem<FVARIDVFMapMeshVS, FVARIDVFMapMeshPS>(TEXT("VFMapMesh"), GradientPermutationVector.ToDimensionValueId(), PF_G32R32F, &SetupVFMapMeshPipelineState, OutItems);
+}
 
-			const FIntPoint HiResTextureSize(FMath::Max(OutLaplacianMipTextureDesc.Extent.X >> HiResMipLevel, 1), FMath::Max(OutLaplacianMipTextureDesc.Extent.Y >> HiResMipLevel, 1));
-			const FVector2D HiResTexelSize(1.0f / HiResTextureSize.X, 1.0f / HiResTextureSize.Y);
+/*****************************************************************************************************************/
+// scene view extenstion
 
-			const FIntPoint LoResDispatchSize(FMath::Max(InViewportRect.Width() >> LoResMipLevel, 1), FMath::Max(InViewportRect.Height() >> LoResMipLevel, 1));
-			const FIntPoint LoResDispatchThreadIDOffset(InViewportRect.Min.X >> LoResMipLevel, InViewportRect.Min.Y >> LoResMipLevel);
+FVARIDSceneViewExtension::FVARIDSceneViewExtension(const FAutoRegister& AutoRegister, const TSharedPtr<const FVARIDPipelineWarmup, ESPMode::ThreadSafe>& InPipelineWarmup)
+	: FSceneViewExtensionBase(AutoRegister)
+	, PipelineWarmup(InPipelineWarmup)
+{
 
-			const FIntPoint HiResDispatchSize(FMath::Max(InViewportRect.Width() >> HiResMipLevel, 1), FMath::Max(InViewportRect.Height() >> HiResMipLevel, 1));
-			const FIntPoint HiResDispatchThreadIDOffset(InViewportRect.Min.X >> HiResMipLevel, InViewportRect.Min.Y >> HiResMipLevel);
+}
 
-			{
-				// upsample
-				FVARIDBasicResampleCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDBasicResampleCS::FParameters>();
-				PassParameters->InDispatchThreadIDOffset = HiResDispatchThreadIDOffset;
-				PassParameters->InTexelSize = HiResTexelSize;
-				PassParameters->InSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-				PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InGaussianMipTexture, LoResMipLevel));
-				PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(UpsampledMipTexture, HiResMipLevel));
+bool FVARIDSceneViewExtension::IsActiveThisFrame(FViewport* InViewport) const
+{
+	return !PipelineWarmup.IsValid() || PipelineWarmup->IsReady();
+}
 
-				FComputeShaderUtils::AddPass(
-					InGraphBuilder,
-					RDG_EVENT_NAME("VARID - Build Laplacian Pyramid - Upsample - MipLevel=%d", HiResMipLevel),
-					ResampleComputeShader,
-					PassParameters,
-					FComputeShaderUtils::GetGroupCount(HiResDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
-			}
+void FVARIDSceneViewExtension::SetupViewFamily(FSceneViewFamily& InViewFamily)
+{
+	// this method runs in the game thread before the VARID rendering is performed
+	// It is here that we marshall the data from the game thread to the render thread. 
 
-			{
-				// blur
-				FVARIDGaussianBlurCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDGaussianBlurCS::FParameters>();
-				PassParameters->DispatchThreadIDOffset = HiResDispatchThreadIDOffset;
-				PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(UpsampledMipTexture, HiResMipLevel));
-				PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(BlurredMipTexture, HiResMipLevel));
+	const double MarshalStartTime = FPlatformTime::Seconds();
 
-				FComputeShaderUtils::AddPass(
-					InGraphBuilder,
-					RDG_EVENT_NAME("VARID - Build Laplacian Pyramid - Gaussian Blur - MipLevel=%d", HiResMipLevel),
-					GaussianBlurComputeShader,
-					PassParameters,
-					FComputeShaderUtils::GetGroupCount(HiResDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
-			}
+	FVARIDProfile& Profile = FVARIDModule::Get().GetActiveProfile();
+	const FVARIDViewProfiles& ViewProfiles = FVARIDModule::Get().GetViewProfiles();
+	FVARIDEyeTracking& EyeTracking = FVARIDModule::Get().GetEyeTracking();
+	const TSharedPtr<const FVARIDProfileProgression, ESPMode::ThreadSafe> Progression = FVARIDModule::Get().GetProgression();
+	const float ProgressionTime = FVARIDModule::Get().GetProgressionTime();
+	const TSharedPtr<FVARIDTraceRecorder, ESPMode::ThreadSafe> TraceRecorder = FVARIDModule::Get().GetTraceRecorder();
+	const TSharedPtr<IVARIDFrameSource, ESPMode::ThreadSafe>& FrameSource = FVARIDModule::Get().GetFrameSource();
+	const TSharedPtr<FVARIDFrameRing, ESPMode::ThreadSafe> FrameRing = FrameSource ? FrameSource->GetRing() : nullptr;
+	const TSharedPtr<FVARIDCaptureWriter, ESPMode::ThreadSafe> CaptureWriter = FVARIDModule::Get().GetOutputCapture();
 
-			{
-				// laplacian
-				FVARIDLaplacianCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDLaplacianCS::FParameters>();
-				PassParameters->DispatchThreadIDOffset = HiResDispatchThreadIDOffset;
-				PassParameters->InLoResSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(BlurredMipTexture, HiResMipLevel));
-				PassParameters->InHiResSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InGaussianMipTexture, HiResMipLevel));
-				PassParameters->OutLaplacianUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutLaplacianMipTexture, HiResMipLevel));
+	// TODO prevent copy constructor being called twice for each parameter. try converting FCachedRenderResource to hold pointers. 
 
-				FComputeShaderUtils::AddPass(
-					InGraphBuilder,
-					RDG_EVENT_NAME("VARID - Build Laplacian Pyramid - Laplacian - MipLevel=%d", HiResMipLevel),
-					LaplacianComputeShader,
-					PassParameters,
-					FComputeShaderUtils::GetGroupCount(HiResDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
-			}
+	// NOTE: this calls copy constructor for each parameter so we dont have to do it explicity. 
+	ENQUEUE_RENDER_COMMAND(VARIDParameters)(
+		[
+			this,
+			Profile,
+			ViewProfiles,
+			EyeTracking,
+			Progression,
+			ProgressionTime,
+			TraceRecorder,
+			FrameRing,
+			CaptureWriter
+		](FRHICommandListImmediate& RHICmdList)
+		{
+			// these assignments using equals operate actually results in 'Copy Initialization' - the copy constructor is called
+			CachedResourcesRenderThread.Profile = Profile;
+			CachedResourcesRenderThread.ViewProfiles = ViewProfiles;
+			CachedResourcesRenderThread.EyeTracking = EyeTracking;
+			CachedResourcesRenderThread.Progression = Progression;
+			CachedResourcesRenderThread.ProgressionTime = ProgressionTime;
+			CachedResourcesRenderThread.TraceRecorder = TraceRecorder;
+			CachedResourcesRenderThread.FrameRing = FrameRing;
+			CachedResourcesRenderThread.CaptureWriter = CaptureWriter;
 		}
+	);
+
+	// the copies are made as the command is enqueued, so this is the game thread's share of the marshalling
+	if (TraceRecorder)
+	{
+		TraceRecorder->RecordStageTiming(InViewFamily.FrameNumber, EVARIDTraceStage::Marshal, (FPlatformTime::Seconds() - MarshalStartTime) * 1e6);
 	}
 }
 
-static void BuildContrastTexture_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InLaplacianMipTexture, FRDGTextureRef InVFMapMipTexture, FRDGTextureRef OutContrastTexture, const FIntRect& InViewportRect)
+const FVARIDProfile& FVARIDSceneViewExtension::GetViewProfile_RenderThread(const FSceneView& InView) const
 {
-	check(InLaplacianMipTexture);
-	check(OutContrastTexture);
+	const int32 ViewIndex = InView.Family ? InView.Family->Views.IndexOfByKey(&InView) : INDEX_NONE;
+	return CachedResourcesRenderThread.ViewProfiles.Find(ViewIndex, InView.PlayerIndex, CachedResourcesRenderThread.Profile);
+}
 
-	const FRDGTextureDesc& OutContrastTextureDesc = OutContrastTexture->Desc;
-	const int32 ContrastNumberOfMips = OutContrastTextureDesc.NumMips;
+/*****************************************************************************************************************/
+// dynamic quality
 
-	const FRDGTextureDesc& InLaplacianMipTextureDesc = InLaplacianMipTexture->Desc;
-	const int32 LaplacianNumberOfMips = InLaplacianMipTextureDesc.NumMips;
+/** frames of timestamps kept waiting for the GPU. Older ones are dropped unread, e.g. timestamps lost to a device reset */
+static const int32 MAX_GPU_TIMING_FRAMES = 8;
 
-	const FRDGTextureDesc& InVFMapMipTextureDesc = InVFMapMipTexture->Desc;
-	const int32 VFMapNumberOfMips = InVFMapMipTextureDesc.NumMips;
+/** the best quality level r.VARID.Quality allows, or the post process scalability group if it is set to follow it */
+static int32 GetBestQualityLevel_RenderThread()
+{
+	int32 Quality = CVarVARIDQuality.GetValueOnRenderThread();
+	if (Quality < 0)
+	{
+		static const IConsoleVariable* CVarPostProcessQuality = IConsoleManager::Get().FindConsoleVariable(TEXT("sg.PostProcessQuality"));
+		Quality = CVarPostProcessQuality ? CVarPostProcessQuality->GetInt() : 3;
+	}
 
-	check(ContrastNumberOfMips == LaplacianNumberOfMips);
-	check(ContrastNumberOfMips == VFMapNumberOfMips);
+	return FVARIDQualitySettings::GetBestLevelForQuality(Quality);
+}
 
-	const int32 MaxMipLevelIndex = ContrastNumberOfMips - 1;
+void FVARIDSceneViewExtension::UpdateQuality_RenderThread(uint32 InFrameNumber)
+{
+	if (QualityFrameNumberRenderThread == InFrameNumber)
+	{
+		return;
+	}
 
-	FRDGTextureRef UpsampledMipTexture = InGraphBuilder.CreateTexture(OutContrastTextureDesc, TEXT("VARID_TEMP_UpsampledMipTexture"));
-	FRDGTextureRef BlurredMipTexture = InGraphBuilder.CreateTexture(OutContrastTextureDesc, TEXT("VARID_TEMP_BlurredMipTexture"));
+	QualityFrameNumberRenderThread = InFrameNumber;
 
-	TShaderMapRef<FVARIDBasicResampleCS> ResampleComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
-	TShaderMapRef<FVARIDGaussianBlurCS> GaussianBlurComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
-	TShaderMapRef<FVARIDReconstructCS> ReconstructComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+	const int32 BestLevel = GetBestQualityLevel_RenderThread();
 
-	// work from the highest mip level (lowest resolution) to the lowest mip level (highest resolution)
-	for (int32 MipLevel = MaxMipLevelIndex; MipLevel >= 0; --MipLevel)
+	if (CVarVARIDDynamicQuality.GetValueOnRenderThread() == 0 || !GSupportsTimestampRenderQueries)
 	{
-		// TODO move outside the for loop?
-		if (MipLevel == MaxMipLevelIndex)
-		{
-			// lowest res level is simply a direct copy. no bias applied
-			const FIntPoint DispatchSize(FMath::Max(InViewportRect.Width() >> MipLevel, 1), FMath::Max(InViewportRect.Height() >> MipLevel, 1));
-			const FIntPoint DispatchThreadIDOffset(InViewportRect.Min.X >> MipLevel, InViewportRect.Min.Y >> MipLevel);
+		QualityControllerRenderThread.Reset(BestLevel);
+		GPUTimingFramesRenderThread.Reset();
+		GVARIDQualitySettingsRenderThread = FVARIDQualitySettings::GetLevel(BestLevel);
+		return;
+	}
 
-			TShaderMapRef<FVARIDDirectCopyCS> DirectCopyComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+	FVARIDQualityControllerSettings Settings;
+	Settings.BudgetMs = CVarVARIDDynamicQualityBudgetMs.GetValueOnRenderThread();
+	Settings.BestLevel = BestLevel;
+	Settings.WorstLevel = FVARIDQualitySettings::GetBestLevelForQuality(CVarVARIDDynamicQualityMinQuality.GetValueOnRenderThread());
 
-			FVARIDDirectCopyCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDDirectCopyCS::FParameters>();
-			PassParameters->DispatchThreadIDOffset = DispatchThreadIDOffset;
-			PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InLaplacianMipTexture, MipLevel));
-			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutContrastTexture, MipLevel));
+	// oldest first, so the controller sees the frames in order. a frame the GPU hasn't finished holds back the ones after it
+	int32 NumRead = 0;
+	for (const FGPUTimingFrame& Frame : GPUTimingFramesRenderThread)
+	{
+		uint64 Microseconds = 0;
+		bool bRead = true;
 
-			FComputeShaderUtils::AddPass(
-				InGraphBuilder,
-				RDG_EVENT_NAME("VARID - Build Contrast Texture - Direct Copy - MipLevel=%d", MipLevel),
-				DirectCopyComputeShader,
-				PassParameters,
-				FComputeShaderUtils::GetGroupCount(DispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+		for (int32 QueryIndex = 0; QueryIndex + 1 < Frame.Queries.Num() && bRead; QueryIndex += 2)
+		{
+			uint64 BeginMicroseconds = 0;
+			uint64 EndMicroseconds = 0;
+			bRead = RHIGetRenderQueryResult(Frame.Queries[QueryIndex].GetQuery(), BeginMicroseconds, false)
+				&& RHIGetRenderQueryResult(Frame.Queries[QueryIndex + 1].GetQuery(), EndMicroseconds, false);
+
+			Microseconds += EndMicroseconds > BeginMicroseconds ? EndMicroseconds - BeginMicroseconds : 0;
 		}
-		else
+
+		if (!bRead)
 		{
-			int32 LoResMipLevel = MipLevel + 1;
-			int32 HiResMipLevel = MipLevel;
+			break;
+		}
 
-			const FIntPoint HiResTextureSize(FMath::Max(OutContrastTextureDesc.Extent.X >> HiResMipLevel, 1), FMath::Max(OutContrastTextureDesc.Extent.Y >> HiResMipLevel, 1));
-			const FVector2D HiResTexelSize(1.0f / HiResTextureSize.X, 1.0f / HiResTextureSize.Y);
+		QualityControllerRenderThread.Update(Microseconds / 1000.0f, Settings);
 
-			const FIntPoint HiResDispatchSize(FMath::Max(InViewportRect.Width() >> HiResMipLevel, 1), FMath::Max(InViewportRect.Height() >> HiResMipLevel, 1));
-			const FIntPoint HiResDispatchThreadIDOffset(InViewportRect.Min.X >> HiResMipLevel, InViewportRect.Min.Y >> HiResMipLevel);
+		if (CachedResourcesRenderThread.TraceRecorder)
+		{
+			CachedResourcesRenderThread.TraceRecorder->RecordStageTiming(Frame.FrameNumber, EVARIDTraceStage::GPUPasses, Microseconds);
+		}
 
-			{
-				// upsample
-				FVARIDBasicResampleCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDBasicResampleCS::FParameters>();
-				PassParameters->InDispatchThreadIDOffset = HiResDispatchThreadIDOffset;
-				PassParameters->InTexelSize = HiResTexelSize;
-				PassParameters->InSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-				PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(OutContrastTexture, LoResMipLevel));
-				PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(UpsampledMipTexture, HiResMipLevel));
+		++NumRead;
+	}
 
-				FComputeShaderUtils::AddPass(
-					InGraphBuilder,
-					RDG_EVENT_NAME("VARID - Build Contrast Texture - Upsample - MipLevel=%d", HiResMipLevel),
-					ResampleComputeShader,
-					PassParameters,
-					FComputeShaderUtils::GetGroupCount(HiResDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
-			}
+	GPUTimingFramesRenderThread.RemoveAt(0, FMath::Max(NumRead, GPUTimingFramesRenderThread.Num() - MAX_GPU_TIMING_FRAMES));
 
-			{
-				// blur
-				FVARIDGaussianBlurCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDGaussianBlurCS::FParameters>();
-				PassParameters->DispatchThreadIDOffset = HiResDispatchThreadIDOffset;
-				PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(UpsampledMipTexture, HiResMipLevel));
-				PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(BlurredMipTexture, HiResMipLevel));
+	// the range can move between timings, e.g. with the scalability group
+	GVARIDQualitySettingsRenderThread = FVARIDQualitySettings::GetLevel(FMath::Clamp(QualityControllerRenderThread.GetLevel(), Settings.BestLevel, FMath::Max(Settings.BestLevel, Settings.WorstLevel)));
+}
 
-				FComputeShaderUtils::AddPass(
-					InGraphBuilder,
-					RDG_EVENT_NAME("VARID - Build Contrast Texture - Gaussian Blur - MipLevel=%d", HiResMipLevel),
-					GaussianBlurComputeShader,
-					PassParameters,
-					FComputeShaderUtils::GetGroupCount(HiResDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
-			}
+void FVARIDSceneViewExtension::AddGPUTimestamp_RenderThread(FRDGBuilder& GraphBuilder, uint32 InFrameNumber)
+{
+	if (CVarVARIDDynamicQuality.GetValueOnRenderThread() == 0 || !GSupportsTimestampRenderQueries)
+	{
+		return;
+	}
 
-			{
-				// combine laplace and gaussian to reconstruct original image
-				FVARIDReconstructCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDReconstructCS::FParameters>();
-				PassParameters->InDispatchThreadIDOffset = HiResDispatchThreadIDOffset;
-				PassParameters->InGaussianSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(BlurredMipTexture, HiResMipLevel));
-				PassParameters->InLaplacianSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InLaplacianMipTexture, HiResMipLevel));
-				PassParameters->InVFMapSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InVFMapMipTexture, HiResMipLevel));
-				PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutContrastTexture, HiResMipLevel));
+	if (!GPUTimingQueryPoolRenderThread.IsValid())
+	{
+		GPUTimingQueryPoolRenderThread = RHICreateRenderQueryPool(RQT_AbsoluteTime);
+	}
 
-				FComputeShaderUtils::AddPass(
-					InGraphBuilder,
-					RDG_EVENT_NAME("VARID - Build Contrast Texture - Reconstruct - MipLevel=%d", HiResMipLevel),
-					ReconstructComputeShader,
-					PassParameters,
-					FComputeShaderUtils::GetGroupCount(HiResDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
-			}
-		}
+	if (GPUTimingFramesRenderThread.Num() == 0 || GPUTimingFramesRenderThread.Last().FrameNumber != InFrameNumber)
+	{
+		GPUTimingFramesRenderThread.AddDefaulted_GetRef().FrameNumber = InFrameNumber;
 	}
-}
 
-static bool BuildInpaintTexture_RenderThread(FRDGBuilder& InGraphBuilder, FRDGTextureRef InColourTexture, FRDGTextureRef InVFMapTexture, FRDGTextureRef OutPositionMipTexture, FRDGTextureRef OutColourTexture, const FIntRect& InViewportRect)
-{
-	check(InColourTexture);
-	check(InVFMapTexture);
+	// the pooled query stays with the frame until it is read back, frames after the graph has run
+	FRHIRenderQuery* Query = GPUTimingFramesRenderThread.Last().Queries.Add_GetRef(GPUTimingQueryPoolRenderThread->AllocateQuery()).GetQuery();
 
-	const FRDGTextureDesc& OutColourTextureDesc = OutColourTexture->Desc;
-	const int32 OriginalTextureWidth = OutColourTextureDesc.Extent.X;
-	const int32 OriginalTextureHeight = OutColourTextureDesc.Extent.Y;
-	const int32 OriginalTextureOriginOffset = InViewportRect.Min.X > 0 ? OriginalTextureWidth / 2 : 0;
-	const FVector2D OriginalTexelSize(1.0f / OriginalTextureWidth, 1.0f / OriginalTextureHeight);
-	const FIntPoint OriginalDispatchSize(OriginalTextureWidth, OriginalTextureHeight);
-	const FIntPoint OriginalDispatchThreadIDOffset(OriginalTextureOriginOffset, 0);
+	GraphBuilder.AddPass(
+		RDG_EVENT_NAME("VARID - GPU Timestamp"),
+		ERDGPassFlags::None,
+		[Query](FRHICommandListImmediate& RHICmdList)
+		{
+			RHICmdList.EndRenderQuery(Query);
+		});
+}
 
-	const int32 NumberOfPasses = 16;	// must be an even number
-	const int32 PassMipLevel = 3;
-	const int32 NumMips = PassMipLevel + 1;
+/*****************************************************************************************************************/
+// output capture
 
-	FRDGTextureDesc MetaDataTextureDesc = FRDGTextureDesc::Create2D
-	(
-		OutColourTextureDesc.Extent,
-		EPixelFormat::PF_A32B32G32R32F,
-		FClearValueBinding::Black,
-		TexCreate_ShaderResource | TexCreate_UAV,
-		NumMips,
-		1
-	);
+BEGIN_SHADER_PARAMETER_STRUCT(FVARIDOutputCaptureCopyParameters, )
+	RDG_TEXTURE_ACCESS(Output, ERHIAccess::CopySrc)
+END_SHADER_PARAMETER_STRUCT()
 
-	// ensure we have a descriptor that can support mipmaps (the original texture passed in might not support mips)
-	FRDGTextureDesc ColourTextureDesc = FRDGTextureDesc::Create2D
-	(
-		OutColourTextureDesc.Extent,
-		OutColourTextureDesc.Format,
-		FClearValueBinding::Black,
-		TexCreate_ShaderResource | TexCreate_UAV,
-		NumMips,	
-		1
-	);
+/** the capture's layout of InFormat. False for a format VARID doesn't composite to */
+static bool GetCapturePixelFormat(EPixelFormat InFormat, EVARIDCapturePixelFormat& OutPixelFormat)
+{
+	switch (InFormat)
+	{
+	case PF_B8G8R8A8:
+		OutPixelFormat = EVARIDCapturePixelFormat::B8G8R8A8;
+		return true;
+	case PF_R8G8B8A8:
+		OutPixelFormat = EVARIDCapturePixelFormat::R8G8B8A8;
+		return true;
+	case PF_A2B10G10R10:
+		OutPixelFormat = EVARIDCapturePixelFormat::A2B10G10R10;
+		return true;
+	case PF_FloatRGBA:
+		OutPixelFormat = EVARIDCapturePixelFormat::FloatRGBA;
+		return true;
+	}
 
-	// temporary textures used for processing the 'fill' shader
-	// the textures only have data at a single lower resolution mip level - for better performance
-	// the final result is copied back into the hi res output texture during the finalise shader stage
-	FRDGTextureRef MetaDataTexture_1 = InGraphBuilder.CreateTexture(MetaDataTextureDesc, TEXT("MetaDataTexture_1"));
-	FRDGTextureRef MetaDataTexture_2 = InGraphBuilder.CreateTexture(MetaDataTextureDesc, TEXT("MetaDataTexture_2"));
-	FRDGTextureRef ColourTexture_1 = InGraphBuilder.CreateTexture(ColourTextureDesc, TEXT("ColourTexture_1"));
-	FRDGTextureRef ColourTexture_2 = InGraphBuilder.CreateTexture(ColourTextureDesc, TEXT("ColourTexture_2"));
+	return false;
+}
 
-	TShaderMapRef<FVARIDInpainterInitialiseCS> InpainterInitialiseShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
-	TShaderMapRef<FVARIDBasicResampleCS> ResampleComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
-	TShaderMapRef<FVARIDInpainterFillCS> InpainterFillShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
-	TShaderMapRef<FVARIDInpainterFinaliseCS> InpainterFinaliseShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+void FVARIDSceneViewExtension::AddOutputCapture_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& InView, int32 InEyeIndex, const FScreenPassTexture& InOutput)
+{
+	FOutputCaptureResource& Resource = OutputCaptureRenderThread;
+	const TSharedPtr<FVARIDCaptureWriter, ESPMode::ThreadSafe>& Writer = CachedResourcesRenderThread.CaptureWriter;
 
-	const FIntPoint PassTextureSize(FMath::Max(OriginalTextureWidth >> PassMipLevel, 1), FMath::Max(OriginalTextureHeight >> PassMipLevel, 1));
-	const FVector2D PassTexelSize(1.0f / PassTextureSize.X, 1.0f / PassTextureSize.Y);
-	const FIntPoint PassDispatchSize(FMath::Max(OriginalTextureWidth >> PassMipLevel, 1), FMath::Max(OriginalTextureHeight >> PassMipLevel, 1));
-	const FIntPoint PassDispatchThreadIDOffset(OriginalTextureOriginOffset >> PassMipLevel, 0);
+	FRHICommandListImmediate& RHICmdList = GraphBuilder.RHICmdList;
 
-	// initialise low res pass mip texture with initial colour - essentially downsample the colour
+	if (Resource.Writer != Writer)
 	{
-		// meta data: fill mask, pass counter, UV
+		// the last writer has been ended, so its thread has stopped and won't read the readbacks still mapped. Copies still in flight are left to the
+		// GPU, which holds their textures until it is done
+		for (FCaptureReadback& Readback : Resource.Readbacks)
 		{
-			FVARIDInpainterInitialiseCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDInpainterInitialiseCS::FParameters>();
-			PassParameters->InDispatchThreadIDOffset = PassDispatchThreadIDOffset;
-			PassParameters->InTexelSize = PassTexelSize;
-			PassParameters->InMaskSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InVFMapTexture, PassMipLevel));
-			PassParameters->OutMetaDataUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(MetaDataTexture_1, PassMipLevel));
-
-			FComputeShaderUtils::AddPass(
-				InGraphBuilder,
-				RDG_EVENT_NAME("VARID - Inpainter - Initialise - MipLevel=%d", PassMipLevel),
-				InpainterInitialiseShader,
-				PassParameters,
-				FComputeShaderUtils::GetGroupCount(PassDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+			if (Readback.bMapped)
+			{
+				RHICmdList.UnmapStagingSurface(Readback.Texture);
+			}
 		}
 
-		// colour
-		{
-			FVARIDBasicResampleCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDBasicResampleCS::FParameters>();
-			PassParameters->InDispatchThreadIDOffset = PassDispatchThreadIDOffset;
-			PassParameters->InTexelSize = PassTexelSize;
-			PassParameters->InSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-			PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InColourTexture, 0));
-			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(ColourTexture_1, PassMipLevel));
+		Resource = FOutputCaptureResource();
+		Resource.Writer = Writer;
+	}
+
+	if (!Writer)
+	{
+		return;
+	}
+
+	FVARIDCaptureQueue& Queue = Writer->GetQueue();
+
+	/*************************************************************/
+	// unmap the readbacks the writer thread has copied, oldest first, so they can be issued again
 
-			FComputeShaderUtils::AddPass(
-				InGraphBuilder,
-				RDG_EVENT_NAME("VARID - Inpainter - Downsample Colour - MipLevel=%d", PassMipLevel),
-				ResampleComputeShader,
-				PassParameters,
-				FComputeShaderUtils::GetGroupCount(PassDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+	while (Resource.NumReleased < Resource.NumMapped)
+	{
+		FCaptureReadback& Readback = Resource.Readbacks[(int32)(Resource.NumReleased % Resource.Readbacks.Num())];
+		if (Readback.Source && !Readback.Source->IsCopied())
+		{
+			break;
 		}
 
-		// VF Map
+		if (Readback.bMapped)
 		{
-			FVARIDBasicResampleCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDBasicResampleCS::FParameters>();
-			PassParameters->InDispatchThreadIDOffset = PassDispatchThreadIDOffset;
-			PassParameters->InTexelSize = PassTexelSize;
-			PassParameters->InSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-			PassParameters->InSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InVFMapTexture, 0));
-			PassParameters->OutUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(InVFMapTexture, PassMipLevel));
-
-			FComputeShaderUtils::AddPass(
-				InGraphBuilder,
-				RDG_EVENT_NAME("VARID - Inpainter - Downsample VF Map - MipLevel=%d", PassMipLevel),
-				ResampleComputeShader,
-				PassParameters,
-				FComputeShaderUtils::GetGroupCount(PassDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+			RHICmdList.UnmapStagingSurface(Readback.Texture);
+			Readback.bMapped = false;
 		}
+
+		Readback.Source.Reset();
+		++Resource.NumReleased;
 	}
 
-	// pointers to textures
-	FRDGTextureRef InMetaData;
-	FRDGTextureRef OutMetaData;
-	FRDGTextureRef InColour;
-	FRDGTextureRef OutColour;
+	/*************************************************************/
+	// hand the copies the GPU has made to the writer, oldest first. One it hasn't made yet holds back those after it. The writer thread copies the
+	// pixels out of the mapped surface, which stays mapped until it has
 
-	// multiple refinement passes
-	for (int32 PassCounter = 0; PassCounter < NumberOfPasses; ++PassCounter)
+	while (Resource.NumMapped < Resource.NumIssued)
 	{
-		// flipping totally works!
-		if (PassCounter % 2 == 0)
+		FCaptureReadback& Readback = Resource.Readbacks[(int32)(Resource.NumMapped % Resource.Readbacks.Num())];
+		if (!Readback.Fence->Poll())
 		{
-			InMetaData = MetaDataTexture_1;
-			OutMetaData = MetaDataTexture_2;
-			InColour = ColourTexture_1;
-			OutColour = ColourTexture_2;
+			break;
 		}
-		else //if (CostReducingIteration % 2 == 1)
+
+		++Resource.NumMapped;
+
+		void* Data = nullptr;
+		int32 PitchInPixels = 0;
+		int32 Height = 0;
+		RHICmdList.MapStagingSurface(Readback.Texture, Readback.Fence, Data, PitchInPixels, Height);
+
+		if (!Data)
 		{
-			InMetaData = MetaDataTexture_2;
-			OutMetaData = MetaDataTexture_1;
-			InColour = ColourTexture_2;
-			OutColour = ColourTexture_1;
+			Queue.RecordDropped();
+			continue;
 		}
 
+		Readback.bMapped = true;
+
+		// a null frame means the writer is behind, and the queue has counted the drop. The readback is released next time round
+		if (FVARIDCaptureFrame* Frame = Queue.Acquire())
 		{
-			FVARIDInpainterFillCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDInpainterFillCS::FParameters>();
-			PassParameters->InDispatchThreadIDOffset = PassDispatchThreadIDOffset;
-			PassParameters->InTexelSize = PassTexelSize;
-			PassParameters->PassCounter = PassCounter;
-			PassParameters->InMaskSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InVFMapTexture, PassMipLevel));
-			PassParameters->InColourSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InColour, PassMipLevel));			
-			PassParameters->InMetaDataSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InMetaData, PassMipLevel));
-			PassParameters->OutColourUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutColour, PassMipLevel));
-			PassParameters->OutMetaDataUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutMetaData, PassMipLevel));
+			Frame->FrameNumber = Readback.FrameNumber;
+			Frame->Seconds = Readback.Seconds;
+			Frame->EyeIndex = Readback.EyeIndex;
+			Frame->GazePoint = Readback.GazePoint;
+			Frame->Size = Readback.Texture->GetSizeXY();
+			GetCapturePixelFormat(Readback.Texture->GetFormat(), Frame->PixelFormat);
+
+			// the rows of a staging surface can be padded
+			const int32 Pitch = PitchInPixels * FVARIDCaptureFrame::GetBytesPerPixel(Frame->PixelFormat);
+			Readback.Source = MakeShared<FVARIDCaptureSource, ESPMode::ThreadSafe>((const uint8*)Data, Pitch);
+			Frame->Source = Readback.Source;
+
+			Queue.Push(Frame);
+		}
+	}
 
-			FComputeShaderUtils::AddPass(
-				InGraphBuilder,
-				RDG_EVENT_NAME("VARID - Inpainter - MipLevel=%d - PassCounter=%d", PassMipLevel, PassCounter),
-				InpainterFillShader,
-				PassParameters,
-				FComputeShaderUtils::GetGroupCount(PassDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+	/*************************************************************/
+	// copy this eye into the next readback, once a frame
+
+	const uint32 FrameNumber = InView.Family->FrameNumber;
+	if (Resource.FrameNumber != FrameNumber)
+	{
+		Resource.FrameNumber = FrameNumber;
+		Resource.CapturedEyes = 0;
+	}
+
+	const uint32 EyeBit = 1u << FMath::Clamp(InEyeIndex, 0, 31);
+	if (Resource.CapturedEyes & EyeBit)
+	{
+		return;
+	}
+
+	Resource.CapturedEyes |= EyeBit;
+
+	const EPixelFormat Format = InOutput.Texture->Desc.Format;
+	EVARIDCapturePixelFormat PixelFormat;
+	if (!GetCapturePixelFormat(Format, PixelFormat))
+	{
+		static bool bWarned = false;
+		if (!bWarned)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("VARID: Output capture can't read back %s. Frames are dropped"), GPixelFormats[Format].Name);
+			bWarned = true;
 		}
+
+		Queue.RecordDropped();
+		return;
 	}
 
-	// finalise - copy low res filled area into hi res out image. 
+	// a new size of ring starts over once the copies in flight have been released, so the frames stay in order
+	const int32 NumReadbacks = FMath::Max(CVarVARIDCaptureReadbacks.GetValueOnRenderThread(), 1);
+	if (Resource.Readbacks.Num() != NumReadbacks && Resource.NumReleased == Resource.NumIssued)
 	{
-		FVARIDInpainterFinaliseCS::FParameters* PassParameters = InGraphBuilder.AllocParameters<FVARIDInpainterFinaliseCS::FParameters>();
-		PassParameters->InDispatchThreadIDOffset = OriginalDispatchThreadIDOffset;
-		PassParameters->InTexelSize = OriginalTexelSize;
-		PassParameters->InBilinearSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-		PassParameters->InPointSampler = TStaticSamplerState<SF_Point, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-		PassParameters->SamplerMipLevel = PassMipLevel;
-		PassParameters->InMaskSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InVFMapTexture, 0));
-		PassParameters->InMaskedColourSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(OutColour, PassMipLevel));
-		PassParameters->InUnmaskedColourSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InColourTexture, 0));
-		PassParameters->InMetaDataSRV = InGraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(OutMetaData, PassMipLevel));
-		PassParameters->OutColourUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutColourTexture, 0));
-		PassParameters->OutPositionUAV = InGraphBuilder.CreateUAV(FRDGTextureUAVDesc(OutPositionMipTexture, 0));
+		Resource.Readbacks.SetNum(NumReadbacks);
+		Resource.NumIssued = 0;
+		Resource.NumMapped = 0;
+		Resource.NumReleased = 0;
+	}
 
-		FComputeShaderUtils::AddPass(
-			InGraphBuilder,
-			RDG_EVENT_NAME("VARID - Inpainter - Finalise - MipLevel=%d", 0),
-			InpainterFinaliseShader,
-			PassParameters,
-			FComputeShaderUtils::GetGroupCount(OriginalDispatchSize, FComputeShaderUtils::kGolden2DGroupSize));
+	if (Resource.NumIssued - Resource.NumReleased >= (uint64)Resource.Readbacks.Num())
+	{
+		Queue.RecordDropped();
+		return;
 	}
 
-	return true;
-}
+	FCaptureReadback& Readback = Resource.Readbacks[(int32)(Resource.NumIssued % Resource.Readbacks.Num())];
+	++Resource.NumIssued;
 
-/*****************************************************************************************************************/
-// helpers
+	const FIntRect Rect = InOutput.ViewRect;
+	if (!Readback.Texture || Readback.Texture->GetSizeXY() != Rect.Size() || Readback.Texture->GetFormat() != Format)
+	{
+		FRHIResourceCreateInfo CreateInfo;
+		Readback.Texture = RHICreateTexture2D(Rect.Width(), Rect.Height(), Format, 1, 1, TexCreate_CPUReadback, CreateInfo);
+	}
 
-static uint8 CalculateNumMips1D(int32 InValue)
-{
-	uint8 numTimesHalved = 0;
-	while (InValue > 1)
+	if (!Readback.Fence)
 	{
-		// could also be done by logarithm to base 2 rounded up/down to the next integer
-		InValue = InValue >> 1;
-		numTimesHalved++;
+		Readback.Fence = RHICreateGPUFence(TEXT("VARIDOutputCapture"));
 	}
 
-	return numTimesHalved;
-}
+	Readback.Fence->Clear();
+	Readback.FrameNumber = FrameNumber;
+	Readback.Seconds = FPlatformTime::Seconds();
+	Readback.EyeIndex = InEyeIndex;
+	Readback.GazePoint = InEyeIndex == 1 ? CachedResourcesRenderThread.EyeTracking.RightEyeGazePoint : CachedResourcesRenderThread.EyeTracking.LeftEyeGazePoint;
 
-static uint8 CalculateNumMips2D(FIntPoint Size)
-{
-	uint8 mipsWidth = CalculateNumMips1D(Size.X);
-	uint8 mipsHeight = CalculateNumMips1D(Size.Y);
-	return mipsWidth > mipsHeight ? mipsWidth : mipsHeight;
+	FVARIDOutputCaptureCopyParameters* PassParameters = GraphBuilder.AllocParameters<FVARIDOutputCaptureCopyParameters>();
+	PassParameters->Output = InOutput.Texture;
+
+	GraphBuilder.AddPass(
+		RDG_EVENT_NAME("VARID - Output Capture Copy"),
+		PassParameters,
+		ERDGPassFlags::Copy | ERDGPassFlags::NeverCull,
+		[PassParameters, Rect, Texture = Readback.Texture, Fence = Readback.Fence](FRHICommandListImmediate& RHICmdList)
+		{
+			FRHICopyTextureInfo CopyInfo;
+			CopyInfo.Size = FIntVector(Rect.Width(), Rect.Height(), 1);
+			CopyInfo.SourcePosition = FIntVector(Rect.Min.X, Rect.Min.Y, 0);
+			RHICmdList.CopyTexture(PassParameters->Output->GetRHI(), Texture, CopyInfo);
+			RHICmdList.WriteGPUFence(Fence);
+		});
 }
 
-/*****************************************************************************************************************/
-// scene view extenstion
+BEGIN_SHADER_PARAMETER_STRUCT(FVARIDFrameSourceFenceParameters, )
+	RDG_TEXTURE_ACCESS(FrameTexture, ERHIAccess::SRVCompute)
+END_SHADER_PARAMETER_STRUCT()
 
-FVARIDSceneViewExtension::FVARIDSceneViewExtension(const FAutoRegister& AutoRegister)
-	: FSceneViewExtensionBase(AutoRegister)
+FRDGTextureRef FVARIDSceneViewExtension::GetFrameSourceInput_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& InView, const FScreenPassTexture& InSceneColor, const FVARIDWorkingTexturePlan& InPlan)
 {
+	const TSharedPtr<FVARIDFrameRing, ESPMode::ThreadSafe>& Ring = CachedResourcesRenderThread.FrameRing;
+	FFrameSourceResource& Resource = FrameSourceRenderThread;
 
-}
+	if (!Ring)
+	{
+		Resource = FFrameSourceResource();
+		return nullptr;
+	}
 
-void FVARIDSceneViewExtension::SetupViewFamily(FSceneViewFamily& InViewFamily)
-{
-	// this method runs in the game thread before the VARID rendering is performed
-	// It is here that we marshall the data from the game thread to the render thread. 
+	if (Resource.Ring != Ring)
+	{
+		Resource = FFrameSourceResource();
+		Resource.Ring = Ring;
+	}
 
-	FVARIDProfile& Profile = FVARIDModule::Get().GetActiveProfile();
-	FVARIDEyeTracking& EyeTracking = FVARIDModule::Get().GetEyeTracking();
+	/*************************************************************/
+	// upload the newest frame into the next texture, once per frame however many views there are. While the GPU is still sampling that texture the
+	// frame stays in the ring and the current texture is used again
 
-	// TODO prevent copy constructor being called twice for each parameter. try converting FCachedRenderResource to hold pointers. 
+	const uint32 FrameNumber = InView.Family->FrameNumber;
+	if (Resource.UploadFrameNumber != FrameNumber || Resource.Current == INDEX_NONE)
+	{
+		Resource.UploadFrameNumber = FrameNumber;
 
-	// NOTE: this calls copy constructor for each parameter so we dont have to do it explicity. 
-	ENQUEUE_RENDER_COMMAND(VARIDParameters)(
-		[
-			this,
-			Profile,
-			EyeTracking
-		](FRHICommandListImmediate& RHICmdList)
+		FFrameSourceTexture& Next = Resource.Textures[(Resource.Current + 1) % FFrameSourceResource::NumTextures];
+		const bool bNextInUse = Next.bFenced && !Next.Fence->Poll();
+
+		const FVARIDFrameSlot* Slot = bNextInUse ? nullptr : Ring->BeginRead();
+		if (Slot)
 		{
-			// these assignments using equals operate actually results in 'Copy Initialization' - the copy constructor is called
-			CachedResourcesRenderThread.Profile = Profile;
-			CachedResourcesRenderThread.EyeTracking = EyeTracking;
+			const FIntPoint FrameSize = Ring->GetSize();
+
+			if (!Next.Texture)
+			{
+				FRHIResourceCreateInfo CreateInfo;
+				Next.Texture = RHICreateTexture2D(FrameSize.X, FrameSize.Y, PF_B8G8R8A8, 1, 1, TexCreate_ShaderResource, CreateInfo);
+				Next.Fence = RHICreateGPUFence(TEXT("VARIDFrameSource"));
+			}
+
+			Next.Fence->Clear();
+			Next.bFenced = false;
+
+			// straight from the slot. The RHI has its own copy once this returns, so the slot goes back to the source
+			RHIUpdateTexture2D(Next.Texture, 0, FUpdateTextureRegion2D(0, 0, 0, 0, FrameSize.X, FrameSize.Y), Ring->GetPitch(), Slot->Pixels.GetData());
+			Ring->EndRead(FPlatformTime::Seconds());
+			Resource.Current = (Resource.Current + 1) % FFrameSourceResource::NumTextures;
 		}
-	);
+	}
+
+	if (Resource.Current == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	FFrameSourceTexture& Current = Resource.Textures[Resource.Current];
+
+	/*************************************************************/
+	// resample it into the scene rect of each eye the plan builds
+
+	FRDGTextureRef FrameTexture = GraphBuilder.RegisterExternalTexture(CreateRenderTarget(Current.Texture, TEXT("VARIDFrameSourceTexture")));
+
+	FRDGTextureDesc InputDesc = InSceneColor.Texture->Desc;
+	InputDesc.Flags |= TexCreate_ShaderResource | TexCreate_UAV;
+	InputDesc.NumMips = 1;
+	FRDGTextureRef InputTexture = GraphBuilder.CreateTexture(InputDesc, TEXT("VARIDFrameSourceInputTexture"));
+
+	FVARIDBasicResampleCS::FPermutationDomain PermutationVector;
+	PermutationVector.Set<FVARIDSourceUVTransformDim>(true);
+	TShaderMapRef<FVARIDBasicResampleCS> ResampleShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+
+	const FVector2D Extent(InputDesc.Extent.X, InputDesc.Extent.Y);
+
+	for (const FVARIDWorkingEye& Eye : InPlan.Eyes)
+	{
+		// side by side frames give each eye its half. A mono view gets the left one
+		const bool bHalf = Ring->IsSideBySideStereo();
+		const FVector2D FrameScale(bHalf ? 0.5f : 1.0f, 1.0f);
+		const FVector2D FrameBias(bHalf && Eye.EyeIndex == 1 ? 0.5f : 0.0f, 0.0f);
+
+		// input texture UV -> UV within the eye's scene rect -> frame UV
+		const FVector2D RectMin(Eye.SceneRect.Min.X, Eye.SceneRect.Min.Y);
+		const FVector2D RectSize(FMath::Max(Eye.SceneRect.Width(), 1), FMath::Max(Eye.SceneRect.Height(), 1));
+		const FVector2D Scale = Extent / RectSize * FrameScale;
+		const FVector2D Bias = -RectMin / RectSize * FrameScale + FrameBias;
+
+		FVARIDBasicResampleCS::FParameters* PassParameters = GraphBuilder.AllocParameters<FVARIDBasicResampleCS::FParameters>();
+		PassParameters->InDispatchThreadIDOffset = Eye.SceneRect.Min;
+		PassParameters->InTexelSize = FVector2D(1.0f / Extent.X, 1.0f / Extent.Y);
+		PassParameters->InSourceUVScaleBias = FVector4(Scale.X, Scale.Y, Bias.X, Bias.Y);
+		PassParameters->InSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+		PassParameters->InSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(FrameTexture));
+		PassParameters->OutUAV = GraphBuilder.CreateUAV(FRDGTextureUAVDesc(InputTexture, 0));
+
+		FComputeShaderUtils::AddPass(
+			GraphBuilder,
+			RDG_EVENT_NAME("VARID - Frame Source - Resample - Eye=%d", Eye.EyeIndex),
+			ResampleShader,
+			PassParameters,
+			FComputeShaderUtils::GetGroupCount(Eye.SceneRect.Size(), FComputeShaderUtils::kGolden2DGroupSize));
+	}
+
+	// after each view's resample, so the fence passes once the last view of the frame has sampled the texture
+	FVARIDFrameSourceFenceParameters* FenceParameters = GraphBuilder.AllocParameters<FVARIDFrameSourceFenceParameters>();
+	FenceParameters->FrameTexture = FrameTexture;
+
+	Current.bFenced = true;
+
+	GraphBuilder.AddPass(
+		RDG_EVENT_NAME("VARID - Frame Source - Fence"),
+		FenceParameters,
+		ERDGPassFlags::Copy | ERDGPassFlags::NeverCull,
+		[Fence = Current.Fence](FRHICommandListImmediate& RHICmdList)
+		{
+			RHICmdList.WriteGPUFence(Fence);
+		});
+
+	return InputTexture;
 }
 
 void FVARIDSceneViewExtension::SubscribeToPostProcessingPass(EPostProcessingPass PassId, FAfterPassCallbackDelegateArray& InOutPassCallbacks, bool bIsPassEnabled)
@@ -1469,13 +4412,22 @@ FScreenPassTexture FVARIDSceneViewExtension::PostProcessPassAfterTonemap_RenderT
 		return SceneColor;
 	}
 
-	if (!CachedResourcesRenderThread.Profile.IsValid)
+	// a view given a profile that isn't valid is left as it is, e.g. a spectator view next to the HMD
+	const FVARIDProfile& ViewProfile = GetViewProfile_RenderThread(View);
+
+	if (!ViewProfile.IsValid)
 	{
 		return SceneColor;
 	}
 
+	UpdateQuality_RenderThread(View.Family->FrameNumber);
+
+	// CPU time only. The GPU time of the passes is in the "VARID Rendering" scope of a GPU profile, and timed for r.VARID.DynamicQuality
+	const double BuildPassesStartTime = FPlatformTime::Seconds();
+
 	RDG_EVENT_SCOPE(GraphBuilder, "VARID Rendering");
 	{
+		AddGPUTimestamp_RenderThread(GraphBuilder, View.Family->FrameNumber);
 
 		/*************************************************************/
 		// setup back buffer to render to
@@ -1498,6 +4450,10 @@ FScreenPassTexture FVARIDSceneViewExtension::PostProcessPassAfterTonemap_RenderT
 			FRDGTextureDesc OutputDesc = SceneColor.Texture->Desc;
 			OutputDesc.Extent = TextureSize;
 			OutputDesc.Flags |= TexCreate_RenderTargetable;
+			if (CVarVARIDCompositorCompute.GetValueOnRenderThread() != 0)
+			{
+				OutputDesc.Flags |= TexCreate_UAV;
+			}
 			FLinearColor ClearColor(0., 0., 0., 0.);
 			OutputDesc.ClearValue = FClearValueBinding(ClearColor);
 
@@ -1505,179 +4461,255 @@ FScreenPassTexture FVARIDSceneViewExtension::PostProcessPassAfterTonemap_RenderT
 			BackBufferRenderTarget = FScreenPassRenderTarget(BackBufferRenderTargetTexture, ViewportRect, ERenderTargetLoadAction::EClear);
 		}
 
-		uint8 NumberOfMipsToGenerate = CalculateNumMips2D(TextureSize);
+		/*************************************************************/
+		// plan the working textures
 
-		NumberOfMipsToGenerate = FMath::Min(NumberOfMipsToGenerate, MAX_NUM_MIP_LEVELS);
+		const FVARIDWorkingTexturePlan Plan = CreateWorkingTexturePlan_RenderThread(View, SceneColor);
+		const FVARIDWorkingEye* CompositeEye = Plan.FindEye(GetEyeIndex(View.StereoPass));
+		check(CompositeEye);
 
 		/*************************************************************/
+		// build VF maps and FX
 
-		// useful for simple height maps
-		FRDGTextureDesc R32_FLOAT_TextureDesc = FRDGTextureDesc::Create2D
-		(
-			TextureSize,
-			EPixelFormat::PF_R32_FLOAT,		// TODO recuce to 16 for performance?
-			FClearValueBinding::Black,
-			TexCreate_ShaderResource | TexCreate_UAV,	
-			NumberOfMipsToGenerate,
-			1
-		);
+		// single pass stereo: the first stereo view of the frame builds both eyes. the second view only composites
+		const bool bSinglePassStereo = Plan.Mode == EVARIDWorkingTextureMode::SinglePassStereo;
+		const uint32 FrameNumber = View.Family->FrameNumber;
+		const bool bReuseSinglePassStereo =
+			bSinglePassStereo
+			&& SinglePassStereoRenderThread.FrameNumber == FrameNumber
+			&& SinglePassStereoRenderThread.Plan.HasSameLayout(Plan)
+			&& SinglePassStereoRenderThread.ContrastTexture.IsValid();
 
-		// useful for UV position/normal maps
-		FRDGTextureDesc G32R32F_TextureDesc = FRDGTextureDesc::Create2D
-		(
-			TextureSize,
-			EPixelFormat::PF_G32R32F,		// TODO reduce to 16 for performance?
-			FClearValueBinding::Black,
-			TexCreate_ShaderResource | TexCreate_UAV,
-			NumberOfMipsToGenerate,
-			1
-		);
+		FVARIDFXTextures FXTextures;
+		bool bFrameSourceInput = false;
 
-		// useful for high precision 4 channel textures
-		FRDGTextureDesc A32B32G32R32F_TextureDesc = FRDGTextureDesc::Create2D
-		(
-			TextureSize,
-			EPixelFormat::PF_A32B32G32R32F,
-			FClearValueBinding::Black,
-			TexCreate_ShaderResource | TexCreate_UAV,
-			NumberOfMipsToGenerate,
-			1
-		);
+		if (bReuseSinglePassStereo)
+		{
+			FXTextures.ContrastTexture = GraphBuilder.RegisterExternalTexture(SinglePassStereoRenderThread.ContrastTexture, TEXT("ContrastTexture"));
+			FXTextures.BlurVFMapTexture = GraphBuilder.RegisterExternalTexture(SinglePassStereoRenderThread.BlurVFMapTexture, TEXT("BlurVFMapTexture"));
+			FXTextures.WarpVFMapTexture = GraphBuilder.RegisterExternalTexture(SinglePassStereoRenderThread.WarpVFMapTexture, TEXT("WarpVFMapTexture"));
 
-		// useful for most colour processing
-		FRDGTextureDesc R16G16B16A16_UNORM_TextureDesc = FRDGTextureDesc::Create2D
-		(
-			TextureSize,
-			EPixelFormat::PF_R16G16B16A16_UNORM,	// original is 8 bits per channel... we give it double precision to work with compared to input and output format
-			FClearValueBinding::Black,
-			TexCreate_ShaderResource | TexCreate_UAV,
-			NumberOfMipsToGenerate,
-			1
-		);
+			if (SinglePassStereoRenderThread.SummedAreaTableTexture.IsValid())
+			{
+				FXTextures.SummedAreaTableTexture = GraphBuilder.RegisterExternalTexture(SinglePassStereoRenderThread.SummedAreaTableTexture, TEXT("SummedAreaTableTexture"));
+			}
 
-		/*************************************************************/
-		// build VF maps and vertex buffers
+			// the compute compositor reconstructs contrast level 0 from these
+			FXTextures.bContrastLevel0Deferred = SinglePassStereoRenderThread.bContrastLevel0Deferred;
+			if (FXTextures.bContrastLevel0Deferred)
+			{
+				FXTextures.GaussianTexture = GraphBuilder.RegisterExternalTexture(SinglePassStereoRenderThread.GaussianTexture, TEXT("GaussianTexture"));
+				FXTextures.ContrastVFMapTexture = GraphBuilder.RegisterExternalTexture(SinglePassStereoRenderThread.ContrastVFMapTexture, TEXT("ContrastVFMapTexture"));
+			}
+
+			// debug only. only the textures the compositor samples are kept between views
+			if (!FXTextures.bContrastLevel0Deferred)
+			{
+				FXTextures.GaussianTexture = FXTextures.ContrastTexture;
+				FXTextures.ContrastVFMapTexture = FXTextures.BlurVFMapTexture;
+			}
+			FXTextures.InpaintColourTexture = FXTextures.ContrastTexture;
+			FXTextures.InpaintVFMapTexture = FXTextures.BlurVFMapTexture;
 
-		// NOTE: some VF maps e.g. contrast and inpaint require a mip map texture, so all VF map textures are created with the ability to be a mip map
+			// both eyes have been composited - nothing left to keep alive
+			SinglePassStereoRenderThread = FSinglePassStereoResource();
+		}
+		else
+		{
+			// single pass stereo builds the other eye too, with the profile of its view
+			const FSceneView* OtherEyeView = bSinglePassStereo ? FindOtherEyeView(View) : nullptr;
+			const FVARIDProfile* EyeProfiles[2] = { &ViewProfile, &ViewProfile };
+			if (OtherEyeView)
+			{
+				EyeProfiles[GetEyeIndex(OtherEyeView->StereoPass)] = &GetViewProfile_RenderThread(*OtherEyeView);
+			}
+
+			TArray<FVARIDVFMapEyeInput> EyeInputs = GetVFMapEyeInputs(Plan, EyeProfiles, CachedResourcesRenderThread.EyeTracking, View.StereoPass != eSSP_FULL);
 
-		FRDGTextureRef BlurVFMapTexture = GraphBuilder.CreateTexture(R32_FLOAT_TextureDesc, TEXT("BlurVFMapTexture"));
-		FRDGTextureRef ContrastVFMapTexture = GraphBuilder.CreateTexture(R32_FLOAT_TextureDesc, TEXT("ContrastVFMapTexture"));
-		FRDGTextureRef InpaintVFMapTexture = GraphBuilder.CreateTexture(R32_FLOAT_TextureDesc, TEXT("InpaintVFMapTexture"));
-		FRDGTextureRef WarpVFMapTexture = GraphBuilder.CreateTexture(G32R32F_TextureDesc, TEXT("WarpVFMapTexture"));
+			// eyes showing the active profile show the progression, if there is one
+			for (FVARIDVFMapEyeInput& EyeInput : EyeInputs)
+			{
+				if (EyeInput.ProfileEye && EyeProfiles[EyeInput.EyeIndex] == &CachedResourcesRenderThread.Profile)
+				{
+					EyeInput.Progression = CachedResourcesRenderThread.Progression;
+					EyeInput.ProgressionTime = CachedResourcesRenderThread.ProgressionTime;
+				}
+			}
 
-		FRHIVertexBuffer* VertexBuffer = nullptr;
+			/*************************************************************/
+			// the frame source's frame, if there is one, goes through the pipeline in place of scene colour
 
-		// do any eye specific code here
-		switch (View.StereoPass)
-		{
-		case eSSP_FULL:
-			VertexBuffer = GQuadVertexBufferFull.VertexBufferRHI;
-			BuildHeightMapTexture_RenderThread(GraphBuilder, CachedResourcesRenderThread.Profile.LeftEye.Blur.Enabled, CachedResourcesRenderThread.Profile.LeftEye.Blur.VFMap.Data, 0, CachedResourcesRenderThread.EyeTracking.LeftEyeGazePoint, 0.0f, BlurVFMapTexture, ViewportRect, View.StereoPass, CachedResourcesRenderThread.Profile.LeftEye.Blur.VFMap.FullField);
-			for (int32 MipLevel = 0; MipLevel < NumberOfMipsToGenerate; MipLevel++)
+			FRDGTextureRef InputTexture = GetFrameSourceInput_RenderThread(GraphBuilder, View, SceneColor, Plan);
+			bFrameSourceInput = InputTexture != nullptr;
+			if (!InputTexture)
 			{
-				BuildHeightMapTexture_RenderThread(GraphBuilder, CachedResourcesRenderThread.Profile.LeftEye.Contrast.Enabled, CachedResourcesRenderThread.Profile.LeftEye.Contrast.VFMaps[MipLevel].Data, MipLevel, CachedResourcesRenderThread.EyeTracking.LeftEyeGazePoint, 0.0f, ContrastVFMapTexture, ViewportRect, View.StereoPass, CachedResourcesRenderThread.Profile.LeftEye.Contrast.VFMaps[MipLevel].FullField);
+				InputTexture = SceneColor.Texture;
 			}
-			BuildHeightMapTexture_RenderThread(GraphBuilder, CachedResourcesRenderThread.Profile.LeftEye.Inpaint.Enabled, CachedResourcesRenderThread.Profile.LeftEye.Inpaint.VFMap.Data, 0, CachedResourcesRenderThread.EyeTracking.LeftEyeGazePoint, 0.0f, InpaintVFMapTexture, ViewportRect, View.StereoPass, CachedResourcesRenderThread.Profile.LeftEye.Inpaint.VFMap.FullField);
-			BuildNormalMapTexture_RenderThread(GraphBuilder, CachedResourcesRenderThread.Profile.LeftEye.Warp.Enabled, CachedResourcesRenderThread.Profile.LeftEye.Warp.VFMap.Data, CachedResourcesRenderThread.EyeTracking.LeftEyeGazePoint, 0.5f, WarpVFMapTexture, ViewportRect, View.StereoPass, CachedResourcesRenderThread.Profile.LeftEye.Warp.VFMap.FullField);
-			break;
-		case eSSP_LEFT_EYE:
-			VertexBuffer = GQuadVertexBufferLeft.VertexBufferRHI;
-			BuildHeightMapTexture_RenderThread(GraphBuilder, CachedResourcesRenderThread.Profile.LeftEye.Blur.Enabled, CachedResourcesRenderThread.Profile.LeftEye.Blur.VFMap.Data, 0, CachedResourcesRenderThread.EyeTracking.LeftEyeGazePoint, 0.0f, BlurVFMapTexture, ViewportRect, View.StereoPass, CachedResourcesRenderThread.Profile.LeftEye.Blur.VFMap.FullField);
-			for (int32 MipLevel = 0; MipLevel < NumberOfMipsToGenerate; MipLevel++)
+
+			/*************************************************************/
+			// the inpainted colour and its pyramids don't depend on the rest of the profile, so a view showing the same image as an earlier one can use that view's
+
+			const bool bSharePyramids = CVarVARIDSharePyramids.GetValueOnRenderThread() != 0;
+			const FMatrix ViewProjectionMatrix = View.ViewMatrices.GetViewProjectionMatrix();
+			const uint32 InpaintHash = GetInpaintHash(EyeInputs);
+
+			SharedPyramidsRenderThread.RemoveAll([FrameNumber](const FSharedPyramidResource& Shared) { return Shared.FrameNumber != FrameNumber; });
+
+			const FSharedPyramidResource* SharedPyramid = !bSharePyramids ? nullptr : SharedPyramidsRenderThread.FindByPredicate([&](const FSharedPyramidResource& Shared)
+			{
+				return Shared.Family == View.Family && Shared.InpaintHash == InpaintHash && Shared.ViewProjectionMatrix.Equals(ViewProjectionMatrix, 0.0f) && Shared.Plan.HasSameWorkingLayout(Plan);
+			});
+
+			FVARIDFXTextures SharedPyramidTextures;
+			if (SharedPyramid)
 			{
-				BuildHeightMapTexture_RenderThread(GraphBuilder, CachedResourcesRenderThread.Profile.LeftEye.Contrast.Enabled, CachedResourcesRenderThread.Profile.LeftEye.Contrast.VFMaps[MipLevel].Data, MipLevel, CachedResourcesRenderThread.EyeTracking.LeftEyeGazePoint, 0.0f, ContrastVFMapTexture, ViewportRect, View.StereoPass, CachedResourcesRenderThread.Profile.LeftEye.Contrast.VFMaps[MipLevel].FullField);
+				SharedPyramidTextures.InpaintColourTexture = GraphBuilder.RegisterExternalTexture(SharedPyramid->InpaintColourTexture, TEXT("InpaintColourTexture"));
+				SharedPyramidTextures.GaussianTexture = GraphBuilder.RegisterExternalTexture(SharedPyramid->GaussianTexture, TEXT("GaussianTexture"));
+
+				if (SharedPyramid->LaplacianTexture.IsValid())
+				{
+					SharedPyramidTextures.LaplacianTexture = GraphBuilder.RegisterExternalTexture(SharedPyramid->LaplacianTexture, TEXT("LaplacianTexture"));
+				}
 			}
-			BuildHeightMapTexture_RenderThread(GraphBuilder, CachedResourcesRenderThread.Profile.LeftEye.Inpaint.Enabled, CachedResourcesRenderThread.Profile.LeftEye.Inpaint.VFMap.Data, 0, CachedResourcesRenderThread.EyeTracking.LeftEyeGazePoint, 0.0f, InpaintVFMapTexture, ViewportRect, View.StereoPass, CachedResourcesRenderThread.Profile.LeftEye.Inpaint.VFMap.FullField);
-			BuildNormalMapTexture_RenderThread(GraphBuilder, CachedResourcesRenderThread.Profile.LeftEye.Warp.Enabled, CachedResourcesRenderThread.Profile.LeftEye.Warp.VFMap.Data, CachedResourcesRenderThread.EyeTracking.LeftEyeGazePoint, 0.5f, WarpVFMapTexture, ViewportRect, View.StereoPass, CachedResourcesRenderThread.Profile.LeftEye.Warp.VFMap.FullField);
-			break;
-		case eSSP_RIGHT_EYE:
-			VertexBuffer = GQuadVertexBufferRight.VertexBufferRHI;
-			BuildHeightMapTexture_RenderThread(GraphBuilder, CachedResourcesRenderThread.Profile.RightEye.Blur.Enabled, CachedResourcesRenderThread.Profile.RightEye.Blur.VFMap.Data, 0, CachedResourcesRenderThread.EyeTracking.RightEyeGazePoint, 0.0f, BlurVFMapTexture, ViewportRect, View.StereoPass, CachedResourcesRenderThread.Profile.RightEye.Blur.VFMap.FullField);
-			for (int32 MipLevel = 0; MipLevel < NumberOfMipsToGenerate; MipLevel++)
+
+			FXTextures = BuildFXTextures_RenderThread(GraphBuilder, InputTexture, Plan, EyeInputs, SharedPyramid ? &SharedPyramidTextures : nullptr);
+
+			// only kept when the family has views other than this one's eyes that might want them
+			const int32 NumOwnViews = View.StereoPass != eSSP_FULL ? 2 : 1;
+			if (bSharePyramids && !SharedPyramid && View.Family && View.Family->Views.Num() > NumOwnViews)
 			{
-				BuildHeightMapTexture_RenderThread(GraphBuilder, CachedResourcesRenderThread.Profile.RightEye.Contrast.Enabled, CachedResourcesRenderThread.Profile.RightEye.Contrast.VFMaps[MipLevel].Data, MipLevel, CachedResourcesRenderThread.EyeTracking.RightEyeGazePoint, 0.0f, ContrastVFMapTexture, ViewportRect, View.StereoPass, CachedResourcesRenderThread.Profile.RightEye.Contrast.VFMaps[MipLevel].FullField);
+				FSharedPyramidResource& Shared = SharedPyramidsRenderThread.AddDefaulted_GetRef();
+				Shared.FrameNumber = FrameNumber;
+				Shared.Family = View.Family;
+				Shared.ViewProjectionMatrix = ViewProjectionMatrix;
+				Shared.Plan = Plan;
+				Shared.InpaintHash = InpaintHash;
+				Shared.InpaintColourTexture = ConvertToExternalTexture(GraphBuilder, FXTextures.InpaintColourTexture);
+				Shared.GaussianTexture = ConvertToExternalTexture(GraphBuilder, FXTextures.GaussianTexture);
+
+				if (FXTextures.LaplacianTexture)
+				{
+					Shared.LaplacianTexture = ConvertToExternalTexture(GraphBuilder, FXTextures.LaplacianTexture);
+				}
+			}
+
+			if (bSinglePassStereo)
+			{
+				SinglePassStereoRenderThread.FrameNumber = FrameNumber;
+				SinglePassStereoRenderThread.Plan = Plan;
+				SinglePassStereoRenderThread.ContrastTexture = ConvertToExternalTexture(GraphBuilder, FXTextures.ContrastTexture);
+				SinglePassStereoRenderThread.BlurVFMapTexture = ConvertToExternalTexture(GraphBuilder, FXTextures.BlurVFMapTexture);
+				SinglePassStereoRenderThread.WarpVFMapTexture = ConvertToExternalTexture(GraphBuilder, FXTextures.WarpVFMapTexture);
+
+				if (FXTextures.SummedAreaTableTexture)
+				{
+					SinglePassStereoRenderThread.SummedAreaTableTexture = ConvertToExternalTexture(GraphBuilder, FXTextures.SummedAreaTableTexture);
+				}
+				else
+				{
+					SinglePassStereoRenderThread.SummedAreaTableTexture.SafeRelease();
+				}
+
+				SinglePassStereoRenderThread.bContrastLevel0Deferred = FXTextures.bContrastLevel0Deferred;
+				if (FXTextures.bContrastLevel0Deferred)
+				{
+					SinglePassStereoRenderThread.GaussianTexture = ConvertToExternalTexture(GraphBuilder, FXTextures.GaussianTexture);
+					SinglePassStereoRenderThread.ContrastVFMapTexture = ConvertToExternalTexture(GraphBuilder, FXTextures.ContrastVFMapTexture);
+				}
+				else
+				{
+					SinglePassStereoRenderThread.GaussianTexture.SafeRelease();
+					SinglePassStereoRenderThread.ContrastVFMapTexture.SafeRelease();
+				}
 			}
-			BuildHeightMapTexture_RenderThread(GraphBuilder, CachedResourcesRenderThread.Profile.RightEye.Inpaint.Enabled, CachedResourcesRenderThread.Profile.RightEye.Inpaint.VFMap.Data, 0, CachedResourcesRenderThread.EyeTracking.RightEyeGazePoint, 0.0f, InpaintVFMapTexture, ViewportRect, View.StereoPass, CachedResourcesRenderThread.Profile.RightEye.Inpaint.VFMap.FullField);
-			BuildNormalMapTexture_RenderThread(GraphBuilder, CachedResourcesRenderThread.Profile.RightEye.Warp.Enabled, CachedResourcesRenderThread.Profile.RightEye.Warp.VFMap.Data, CachedResourcesRenderThread.EyeTracking.RightEyeGazePoint, 0.5f, WarpVFMapTexture, ViewportRect, View.StereoPass, CachedResourcesRenderThread.Profile.RightEye.Warp.VFMap.FullField);
-			break;
-		default:
-			break;
 		}
 
 		/*************************************************************/
-		// build FX
-
-		// inpainter comes first as it only applies to mip level 0. Other FX will take the inpainter result and create inpainted pyramids
-		FRDGTextureRef InpaintPositionTexture = GraphBuilder.CreateTexture(G32R32F_TextureDesc, TEXT("InpaintPositionTexture"));	// not currently used. Included for a future improved inpainter FX...
-		FRDGTextureRef InpaintColourTexture = GraphBuilder.CreateTexture(R16G16B16A16_UNORM_TextureDesc, TEXT("InpaintColourTexture"));
-		BuildInpaintTexture_RenderThread(GraphBuilder, SceneColor.Texture, InpaintVFMapTexture, InpaintPositionTexture, InpaintColourTexture, ViewportRect);
+		// composite
 
-		FRDGTextureRef GaussianTexture = GraphBuilder.CreateTexture(R16G16B16A16_UNORM_TextureDesc, TEXT("GaussianTexture"));
-		BuildGaussianPyramid_RenderThread(GraphBuilder, InpaintColourTexture, GaussianTexture, ViewportRect);
+		const FScreenPassTexture Output = Composite_RenderThread(GraphBuilder, Plan, *CompositeEye, View.StereoPass, FXTextures, ViewportRect, BackBufferRenderTarget);
 
-		FRDGTextureRef LaplacianTexture = GraphBuilder.CreateTexture(R16G16B16A16_UNORM_TextureDesc, TEXT("LaplacianTexture"));
-		BuildLaplacianPyramid_RenderThread(GraphBuilder, GaussianTexture, LaplacianTexture, ViewportRect);
+		AddGPUTimestamp_RenderThread(GraphBuilder, View.Family->FrameNumber);
 
-		FRDGTextureRef ContrastTexture = GraphBuilder.CreateTexture(R16G16B16A16_UNORM_TextureDesc, TEXT("ContrastTexture"));
-		BuildContrastTexture_RenderThread(GraphBuilder, LaplacianTexture, ContrastVFMapTexture, ContrastTexture, ViewportRect);
+		// after the timestamp, as the copy isn't VARID's to budget for
+		AddOutputCapture_RenderThread(GraphBuilder, View, CompositeEye->EyeIndex, Output);
 
-		/*************************************************************/
+		// only the first composite of a frame counts towards its latency. Its passes have been added, not run: the latency ends at submission
+		if (bFrameSourceInput)
+		{
+			CachedResourcesRenderThread.FrameRing->RecordComposite(FPlatformTime::Seconds());
+		}
 
+		if (CachedResourcesRenderThread.TraceRecorder)
 		{
-			TShaderMapRef<FVARIDQuadVS> VertexShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
-			TShaderMapRef<FVARIDQuadPS> PixelShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+			CachedResourcesRenderThread.TraceRecorder->RecordStageTiming(View.Family->FrameNumber, EVARIDTraceStage::BuildPasses, (FPlatformTime::Seconds() - BuildPassesStartTime) * 1e6);
+		}
 
-			FVARIDQuadPS::FParameters* PassParameters = GraphBuilder.AllocParameters<FVARIDQuadPS::FParameters>();
-			PassParameters->InTrilinearSampler = TStaticSamplerState<SF_Trilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-			PassParameters->InBilinearSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-			PassParameters->InPointSampler = TStaticSamplerState<SF_Point, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
-			PassParameters->InMaxMipLevel = NumberOfMipsToGenerate;
+		return Output;
 
-			PassParameters->InGaussianSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(GaussianTexture));
-			PassParameters->InLaplacianSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(LaplacianTexture));
-			PassParameters->InContrastSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(ContrastTexture));
-			PassParameters->InInpaintSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(InpaintColourTexture));
+	} //end RDG scope
+}
+
+/*****************************************************************************************************************/
+// profile batch
 
-			PassParameters->InBlurVFMapSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(BlurVFMapTexture));
-			PassParameters->InContrastVFMapSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(ContrastVFMapTexture));
-			PassParameters->InInpaintVFMapSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(InpaintVFMapTexture));
-			PassParameters->InWarpVFMapSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(WarpVFMapTexture));
+void FVARIDSceneViewExtension::RenderProfileBatch_RenderThread(FRHICommandListImmediate& RHICmdList, FRHITexture* InSource, const TArray<FVARIDProfileBatchEntry>& InEntries, const TArray<FRHITexture*>& InOutputs)
+{
+	check(IsInRenderingThread());
+	check(InSource);
+	check(InEntries.Num() == InOutputs.Num());
 
-			PassParameters->RenderTargets[0] = BackBufferRenderTarget.GetRenderTargetBinding();
+	// batches render as the console variables say, whatever quality the views are at
+	TGuardValue<FVARIDQualitySettings> QualityGuard(GVARIDQualitySettingsRenderThread, FVARIDQualitySettings());
 
-			ClearUnusedGraphResources(PixelShader, PassParameters);
+	FRDGBuilder GraphBuilder(RHICmdList);
+	{
+		RDG_EVENT_SCOPE(GraphBuilder, "VARID Profile Batch");
 
-			GraphBuilder.AddPass(
-				RDG_EVENT_NAME("VARID FX Compositor"),
-				PassParameters,
-				ERDGPassFlags::Raster,
-				[
-					&View,
-					VertexBuffer,
-					VertexShader,
-					PixelShader,
-					ViewportRect,
-					PassParameters
-				](FRHICommandListImmediate& RHICmdList)
+		FRDGTextureRef SourceTexture = GraphBuilder.RegisterExternalTexture(CreateRenderTarget(InSource, TEXT("VARIDBatchSourceTexture")));
+		const FIntRect ViewportRect(FIntPoint(0, 0), SourceTexture->Desc.Extent);
+
+		// one eye covering the whole image, laid out the way a per eye view is
+		TArray<FIntRect> EyeSceneRects;
+		EyeSceneRects.Add(ViewportRect);
+		const FVARIDWorkingTexturePlan Plan = FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode::PerEye, SourceTexture->Desc.Extent, EyeSceneRects, 0, MAX_NUM_MIP_LEVELS);
+
+		for (const TArray<int32>& Group : FVARIDProfileBatch::GroupBySharedPyramids(InEntries))
+		{
+			// the first entry of each group builds the inpainted colour and pyramids the rest of the group reuses
+			FVARIDFXTextures GroupPyramids;
+			bool bGroupPyramidsBuilt = false;
+
+			for (const int32 EntryIndex : Group)
+			{
+				const FVARIDProfileBatchEntry& Entry = InEntries[EntryIndex];
+				FRDGTextureRef OutputTexture = GraphBuilder.RegisterExternalTexture(CreateRenderTarget(InOutputs[EntryIndex], TEXT("VARIDBatchOutputTexture")));
+
+				// no profile, no FX. a straight copy where the formats allow it, otherwise the pipeline runs with nothing to do
+				if (!Entry.GetEye() && OutputTexture->Desc.Format == SourceTexture->Desc.Format)
 				{
-					FGraphicsPipelineStateInitializer GraphicsPSOInit;
-					RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
-					GraphicsPSOInit.BlendState = TStaticBlendState<>::GetRHI();
-					GraphicsPSOInit.RasterizerState = TStaticRasterizerState<>::GetRHI();
-					GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
-					GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GFilterVertexDeclaration.VertexDeclarationRHI;
-					GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
-					GraphicsPSOInit.BoundShaderState.PixelShaderRHI = PixelShader.GetPixelShader();
-					GraphicsPSOInit.PrimitiveType = PT_TriangleStrip;
-					SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit);
-					SetShaderParameters(RHICmdList, PixelShader, PixelShader.GetPixelShader(), *PassParameters);
-					RHICmdList.SetStreamSource(0, VertexBuffer, 0);
-					RHICmdList.SetViewport(ViewportRect.Min.X, ViewportRect.Min.Y, 0.0f, ViewportRect.Max.X, ViewportRect.Max.Y, 1.0f);
-					RHICmdList.DrawPrimitive(0, 2, 1);
-				});	// end pass
-
-			return MoveTemp(BackBufferRenderTarget);
-		}
+					AddCopyTexturePass(GraphBuilder, SourceTexture, OutputTexture, FRHICopyTextureInfo());
+					continue;
+				}
 
-	} //end RDG scope
-}
\ No newline at end of file
+				TArray<FVARIDVFMapEyeInput> EyeInputs;
+				FVARIDVFMapEyeInput& EyeInput = EyeInputs.AddDefaulted_GetRef();
+				EyeInput.ProfileEye = Entry.GetEye();
+				EyeInput.GazePoint = Entry.GazePoint;
+				EyeInput.StereoPass = eSSP_FULL;
+				EyeInput.EyeIndex = Entry.EyeIndex;
+
+				const FVARIDFXTextures FXTextures = BuildFXTextures_RenderThread(GraphBuilder, SourceTexture, Plan, EyeInputs, bGroupPyramidsBuilt ? &GroupPyramids : nullptr);
+
+				if (!bGroupPyramidsBuilt)
+				{
+					GroupPyramids = FXTextures;
+					bGroupPyramidsBuilt = true;
+				}
+
+				Composite_RenderThread(GraphBuilder, Plan, Plan.Eyes[0], eSSP_FULL, FXTextures, ViewportRect, FScreenPassRenderTarget(OutputTexture, ViewportRect, ERenderTargetLoadAction::ENoAction));
+			}
+		}
+	}
+	GraphBuilder.Execute();
+}
@@ -0,0 +1,396 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDSelfCheck.h"
+#include "VARIDModule.h"
+#include "VARIDProfile.h"
+#include "VARIDBenchmark.h"
+#include "VARIDPipelineWarmup.h"
+#include "VARIDTraceRecorder.h"
+#include "Interfaces/IPluginManager.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** the shipped profiles and whether LoadProfile() takes them. A new VARID_PROFILE_TEST_* file needs a line here */
+struct FVARIDProfileFileExpectation
+{
+	const TCHAR* FileName;
+	bool bLoads;
+};
+
+static const FVARIDProfileFileExpectation PROFILE_FILE_EXPECTATIONS[] =
+{
+	{ TEXT("VARID_PROFILE_TEMPLATE_ALL_FIELDS_POPULATED.json"), true },
+	{ TEXT("VARID_PROFILE_TEMPLATE_MINIMUM.json"), true },
+	{ TEXT("VARID_PROFILE_TEST_BAD_DATA.json"), false },
+	{ TEXT("VARID_PROFILE_TEST_BLANK_FILE.json"), false },
+	{ TEXT("VARID_PROFILE_TEST_BLUR_LEFT.json"), true },
+	{ TEXT("VARID_PROFILE_TEST_BLUR_RIGHT.json"), true },
+	{ TEXT("VARID_PROFILE_TEST_CONTRAST_LEFT.json"), true },
+	{ TEXT("VARID_PROFILE_TEST_CONTRAST_RIGHT.json"), true },
+	{ TEXT("VARID_PROFILE_TEST_CONTRAST_ZERO_LOSS.json"), true },
+	{ TEXT("VARID_PROFILE_TEST_GARBAGE.json"), false },
+	{ TEXT("VARID_PROFILE_TEST_INPAINT_LEFT.json"), true },
+	{ TEXT("VARID_PROFILE_TEST_INPAINT_RIGHT.json"), true },
+	{ TEXT("VARID_PROFILE_TEST_WARP_LEFT.json"), true },
+	{ TEXT("VARID_PROFILE_TEST_WARP_RIGHT.json"), true },
+};
+
+/** the slowest median a case of FVARIDBenchmark may take in a development build. No case means every case of the name */
+struct FVARIDBudget
+{
+	const TCHAR* Name;
+	const TCHAR* Case;
+	double MaxMedianMicroseconds;
+};
+
+static const FVARIDBudget BUDGETS[] =
+{
+	{ TEXT("LoadProfile"), nullptr, 20000.0 },
+	{ TEXT("ParseVFMap"), TEXT("1000 points"), 5000.0 },
+	{ TEXT("ProfileCopy"), TEXT("1000 points per map"), 1000.0 },	// twice a frame, to marshal the active profile to the render thread
+	{ TEXT("GetFX"), nullptr, 5.0 },
+	{ TEXT("ToggleFX"), nullptr, 5.0 },
+	{ TEXT("ListProfiles"), TEXT("1000 files"), 50000.0 },
+	{ TEXT("PackShaderPoints"), TEXT("10000 points, two eyes"), 500.0 },
+};
+
+/** whether InFXName (BLUR, CONTRAST, INPAINT or WARP) of InEye has any data to show */
+static bool HasVFMapData(const FVARIDEye& InEye, const FString& InFXName)
+{
+	auto HasData = [](const FVARIDVFMap& InVFMap) { return InVFMap.Points.Num() > 0 || InVFMap.Image.IsValid(); };
+
+	if (InFXName == TEXT("BLUR"))
+	{
+		return HasData(InEye.Blur.VFMap);
+	}
+	if (InFXName == TEXT("INPAINT"))
+	{
+		return HasData(InEye.Inpaint.VFMap);
+	}
+	if (InFXName == TEXT("WARP"))
+	{
+		return HasData(InEye.Warp.VFMap);
+	}
+
+	return InEye.Contrast.VFMaps.ContainsByPredicate(HasData);
+}
+
+static FString GetShippedProfilesDir()
+{
+	return FPaths::Combine(IPluginManager::Get().FindPlugin(TEXT("VARID"))->GetContentDir(), TEXT("Profiles"));
+}
+
+bool FVARIDSelfCheck::CheckProfileFiles(FString& OutReport)
+{
+	FVARIDModule& Module = FVARIDModule::Get();
+	const FString ProfilesDir = GetShippedProfilesDir();
+
+	TArray<FString> Files;
+	if (!Module.ListProfiles(ProfilesDir, TEXT("json"), Files))
+	{
+		OutReport = FString::Printf(TEXT("VARID: Profile files FAILED. Could not list %s"), *ProfilesDir);
+		return false;
+	}
+
+	// the profiles' points are in degrees of a display FOV, so give them one that machines agree on
+	const FVector2D PreviousDisplayFOV = Module.GetDisplayFOV();
+	Module.SetDisplayFOV(FVector2D(100.0f, 100.0f));
+
+	FString Failures;
+	int32 NumLoaded = 0;
+
+	for (const FVARIDProfileFileExpectation& Expectation : PROFILE_FILE_EXPECTATIONS)
+	{
+		if (!Files.ContainsByPredicate([&Expectation](const FString& File) { return FPaths::GetCleanFilename(File) == Expectation.FileName; }))
+		{
+			Failures += FString::Printf(TEXT(" %s is missing."), Expectation.FileName);
+		}
+	}
+
+	for (const FString& File : Files)
+	{
+		const FString FileName = FPaths::GetCleanFilename(File);
+		const FVARIDProfileFileExpectation* Expectation = nullptr;
+
+		for (const FVARIDProfileFileExpectation& Candidate : PROFILE_FILE_EXPECTATIONS)
+		{
+			if (FileName == Candidate.FileName)
+			{
+				Expectation = &Candidate;
+			}
+		}
+
+		if (!Expectation)
+		{
+			if (FileName.StartsWith(TEXT("VARID_PROFILE_TEST_")))
+			{
+				Failures += FString::Printf(TEXT(" %s has no expectation."), *FileName);
+			}
+			continue;
+		}
+
+		FVARIDProfile Profile;
+		const bool bLoaded = Module.LoadProfile(File, Profile);
+
+		if (bLoaded != Expectation->bLoads)
+		{
+			Failures += FString::Printf(TEXT(" %s was %s."), *FileName, bLoaded ? TEXT("loaded") : TEXT("turned down"));
+			continue;
+		}
+
+		if (!bLoaded)
+		{
+			continue;
+		}
+
+		++NumLoaded;
+
+		// VARID_PROFILE_TEST_<FX>_<EYE>: that FX has data on that eye and not on the other
+		TArray<FString> Parts;
+		FPaths::GetBaseFilename(FileName).ParseIntoArray(Parts, TEXT("_"));
+
+		if (Parts.Num() == 5 && Parts[2] == TEXT("TEST") && (Parts[4] == TEXT("LEFT") || Parts[4] == TEXT("RIGHT")))
+		{
+			const bool bLeft = Parts[4] == TEXT("LEFT");
+			const FVARIDEye& NamedEye = bLeft ? Profile.LeftEye : Profile.RightEye;
+			const FVARIDEye& OtherEye = bLeft ? Profile.RightEye : Profile.LeftEye;
+
+			if (!HasVFMapData(NamedEye, Parts[3]) || HasVFMapData(OtherEye, Parts[3]))
+			{
+				Failures += FString::Printf(TEXT(" %s does not have %s on the %s eye alone."), *FileName, *Parts[3].ToLower(), *Parts[4].ToLower());
+			}
+		}
+	}
+
+	Module.SetDisplayFOV(PreviousDisplayFOV);
+
+	if (!Failures.IsEmpty())
+	{
+		OutReport = FString::Printf(TEXT("VARID: Profile files FAILED.%s"), *Failures);
+		return false;
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: Profile files OK. %d of %d shipped profiles loaded, the rest were turned down as expected"), NumLoaded, (int32)UE_ARRAY_COUNT(PROFILE_FILE_EXPECTATIONS));
+	return true;
+}
+
+bool FVARIDSelfCheck::CheckFXIDs(FString& OutReport)
+{
+	FVARIDProfile Profile;
+	const FVARIDFX* Expected[] =
+	{
+		&Profile.LeftEye.Blur, &Profile.LeftEye.Contrast, &Profile.LeftEye.Inpaint, &Profile.LeftEye.Warp,
+		&Profile.RightEye.Blur, &Profile.RightEye.Contrast, &Profile.RightEye.Inpaint, &Profile.RightEye.Warp
+	};
+	const int32 NumFX = (int32)UE_ARRAY_COUNT(Expected);
+
+	const TArray<FVARIDFX*> FX = Profile.GetFX();
+	if (FX.Num() != NumFX)
+	{
+		OutReport = FString::Printf(TEXT("VARID: FX IDs FAILED. GetFX() returned %d FX, not %d"), FX.Num(), NumFX);
+		return false;
+	}
+
+	for (int32 ID = 0; ID < NumFX; ++ID)
+	{
+		if (FX[ID] != Expected[ID] || Profile.GetFX(ID) != Expected[ID])
+		{
+			OutReport = FString::Printf(TEXT("VARID: FX IDs FAILED. ID %d is not FX %d of the %s eye"), ID, ID % 4, ID < 4 ? TEXT("left") : TEXT("right"));
+			return false;
+		}
+	}
+
+	if (Profile.GetFX(-1) || Profile.GetFX(NumFX))
+	{
+		OutReport = TEXT("VARID: FX IDs FAILED. GetFX() returned an FX for an ID out of range");
+		return false;
+	}
+
+	auto GetEnabledMask = [&Expected, NumFX]()
+	{
+		uint32 Mask = 0;
+		for (int32 ID = 0; ID < NumFX; ++ID)
+		{
+			Mask |= Expected[ID]->Enabled ? 1u << ID : 0u;
+		}
+		return Mask;
+	};
+
+	const uint32 InitialMask = GetEnabledMask();
+
+	for (int32 ID = 0; ID < NumFX; ++ID)
+	{
+		Profile.ToggleFX(ID);
+		if (GetEnabledMask() != (InitialMask ^ (1u << ID)))
+		{
+			OutReport = FString::Printf(TEXT("VARID: FX IDs FAILED. ToggleFX(%d) did not toggle that FX alone"), ID);
+			return false;
+		}
+
+		Profile.ToggleFX(ID);
+	}
+
+	Profile.ToggleFX(-1);
+	Profile.ToggleFX(NumFX);
+	if (GetEnabledMask() != InitialMask)
+	{
+		OutReport = TEXT("VARID: FX IDs FAILED. ToggleFX() changed an FX for an ID out of range");
+		return false;
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: FX IDs OK. %d IDs, left eye then right"), NumFX);
+	return true;
+}
+
+bool FVARIDSelfCheck::CheckModuleState(FString& OutReport)
+{
+	FVARIDModule& Module = FVARIDModule::Get();
+	const bool bWasRendering = Module.IsRendering();
+
+	struct FStep
+	{
+		bool bBegin;
+		bool bRenderingAfter;
+	};
+	const FStep Steps[] = { { false, false }, { false, false }, { true, true }, { true, true }, { false, false }, { true, true }, { false, false } };
+
+	FString Failure;
+
+	for (int32 i = 0; i < (int32)UE_ARRAY_COUNT(Steps); ++i)
+	{
+		if (Steps[i].bBegin)
+		{
+			Module.BeginRendering();
+		}
+		else
+		{
+			Module.EndRendering();
+		}
+
+		if (Module.IsRendering() != Steps[i].bRenderingAfter)
+		{
+			Failure = FString::Printf(TEXT("Step %d, %s, left the module %s"), i, Steps[i].bBegin ? TEXT("BeginRendering()") : TEXT("EndRendering()"), Steps[i].bRenderingAfter ? TEXT("not rendering") : TEXT("rendering"));
+			break;
+		}
+	}
+
+	if (bWasRendering)
+	{
+		Module.BeginRendering();
+	}
+	else
+	{
+		Module.EndRendering();
+	}
+
+	if (!Failure.IsEmpty())
+	{
+		OutReport = FString::Printf(TEXT("VARID: Module state FAILED. %s"), *Failure);
+		return false;
+	}
+
+	// BeginRendering() started it, unless r.VARID.PipelineWarmup is 0
+	const TSharedPtr<FVARIDPipelineWarmup, ESPMode::ThreadSafe>& Warmup = Module.GetPipelineWarmup();
+	const FString WarmupState = !Warmup ? FString(TEXT("not started"))
+		: Warmup->IsReady() ? FString::Printf(TEXT("ready, %d of %d failed"), Warmup->GetNumFailed(), Warmup->GetNumItems())
+		: FString::Printf(TEXT("%d of %d warmed"), Warmup->GetNumWarmed(), Warmup->GetNumItems());
+
+	OutReport = FString::Printf(TEXT("VARID: Module state OK. %d transitions, left %s. Pipeline warm-up %s"), (int32)UE_ARRAY_COUNT(Steps), bWasRendering ? TEXT("rendering") : TEXT("not rendering"), *WarmupState);
+	return true;
+}
+
+bool FVARIDSelfCheck::CheckShutdown(FString& OutReport)
+{
+	FVARIDModule& Module = FVARIDModule::Get();
+	const bool bWasRendering = Module.IsRendering();
+	const FVARIDProfile PreviousProfile = Module.GetActiveProfile();
+	const FVector2D PreviousDisplayFOV = Module.GetDisplayFOV();
+	const FString TraceFilePath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("VARID"), TEXT("SelfCheckShutdown.vtrace"));
+
+	// what can be started without a headset, a frame source or a GPU
+	Module.SetDisplayFOV(FVector2D(100.0f, 100.0f));
+	Module.BeginRendering();
+	const bool bHotReloading = Module.BeginProfileHotReload(FPaths::Combine(GetShippedProfilesDir(), TEXT("VARID_PROFILE_TEMPLATE_MINIMUM.json")));
+	const bool bRecording = Module.BeginTraceRecording(TraceFilePath);
+
+	Module.EndAll();
+
+	FString Failures;
+	Failures += !bHotReloading ? TEXT(" The profile hot reload did not start.") : TEXT("");
+	Failures += !bRecording ? TEXT(" The trace recording did not start.") : TEXT("");
+	Failures += Module.IsRendering() ? TEXT(" Rendering was not ended.") : TEXT("");
+	Failures += Module.IsProfileHotReloading() ? TEXT(" The profile hot reload was not ended.") : TEXT("");
+	Failures += Module.GetTraceRecorder().IsValid() ? TEXT(" The trace recording was not ended.") : TEXT("");
+	Failures += Module.IsTraceReplaying() ? TEXT(" The trace replay was not ended.") : TEXT("");
+	Failures += Module.GetFrameSource().IsValid() ? TEXT(" The frame source was not cleared.") : TEXT("");
+	Failures += Module.GetOutputCapture().IsValid() ? TEXT(" The output capture was not ended.") : TEXT("");
+
+	IFileManager::Get().Delete(*TraceFilePath, false, false, true);
+	Module.SetActiveProfile(PreviousProfile);
+	Module.SetDisplayFOV(PreviousDisplayFOV);
+	if (bWasRendering)
+	{
+		Module.BeginRendering();
+	}
+
+	if (!Failures.IsEmpty())
+	{
+		OutReport = FString::Printf(TEXT("VARID: Shutdown FAILED.%s"), *Failures);
+		return false;
+	}
+
+	OutReport = TEXT("VARID: Shutdown OK. EndAll() ended rendering, a profile hot reload and a trace recording");
+	return true;
+}
+
+bool FVARIDSelfCheck::CheckBudgets(float InBudgetScale, FString& OutReport)
+{
+	TArray<FVARIDBenchmarkResult> Results;
+	FVARIDBenchmark::Run(true, Results);
+
+	FString Failures;
+	int32 NumChecked = 0;
+
+	for (const FVARIDBudget& Budget : BUDGETS)
+	{
+		const double MaxMedianMicroseconds = Budget.MaxMedianMicroseconds * InBudgetScale;
+		bool bFound = false;
+
+		for (const FVARIDBenchmarkResult& Result : Results)
+		{
+			if (Result.Name != Budget.Name || (Budget.Case && Result.Case != Budget.Case))
+			{
+				continue;
+			}
+
+			bFound = true;
+			++NumChecked;
+
+			if (Result.MedianMicroseconds > MaxMedianMicroseconds)
+			{
+				Failures += FString::Printf(TEXT(" %s (%s) took %.1f us, over its budget of %.1f us."), *Result.Name, *Result.Case, Result.MedianMicroseconds, MaxMedianMicroseconds);
+			}
+		}
+
+		if (!bFound)
+		{
+			Failures += FString::Printf(TEXT(" %s (%s) was not benchmarked."), Budget.Name, Budget.Case ? Budget.Case : TEXT("any case"));
+		}
+	}
+
+	if (!Failures.IsEmpty())
+	{
+		OutReport = FString::Printf(TEXT("VARID: Budgets FAILED.%s"), *Failures);
+		return false;
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: Budgets OK. %d cases within their budgets, scaled by %.2f"), NumChecked, InBudgetScale);
+	return true;
+}
+
+#endif
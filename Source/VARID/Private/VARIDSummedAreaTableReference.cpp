@@ -0,0 +1,319 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "Math/RandomStream.h"
+#include "HAL/PlatformTime.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// VARIDSummedAreaTableCS.usf and the SAT blur against a brute force box and the mip chain blur it replaces. The table is summed in uint32
+// and allowed to wrap, which only averages correctly if the quantisation and the corner loads match the shader's
+
+static const float SAT_QUANTISATION = 1023.0f;	// must match VARIDSummedAreaTable.ush
+
+FVARIDSummedAreaTable::FVARIDSummedAreaTable()
+{
+	Size = FIntPoint::ZeroValue;
+	Origin = FIntPoint::ZeroValue;
+}
+
+uint32 FVARIDSummedAreaTable::LoadCorner(int32 X, int32 Y, int32 InChannel) const
+{
+	if (X < Origin.X || Y < Origin.Y || X >= Size.X || Y >= Size.Y)
+	{
+		return 0;
+	}
+
+	return Sums[(Y * Size.X + X) * 3 + InChannel];
+}
+
+FVector4 FVARIDSummedAreaTable::BoxAverage(const FIntPoint& InBoxMin, const FIntPoint& InBoxMax) const
+{
+	const float Count = (float)((InBoxMax.X - InBoxMin.X + 1) * (InBoxMax.Y - InBoxMin.Y + 1));
+	FVector4 Average(0.0f, 0.0f, 0.0f, 1.0f);
+
+	for (int32 Channel = 0; Channel < 3; ++Channel)
+	{
+		// unsigned arithmetic wraps the same way the shader does
+		const uint32 Sum =
+			LoadCorner(InBoxMax.X, InBoxMax.Y, Channel)
+			- LoadCorner(InBoxMin.X - 1, InBoxMax.Y, Channel)
+			- LoadCorner(InBoxMax.X, InBoxMin.Y - 1, Channel)
+			+ LoadCorner(InBoxMin.X - 1, InBoxMin.Y - 1, Channel);
+
+		Average[Channel] = (float)Sum / (Count * SAT_QUANTISATION);
+	}
+
+	return Average;
+}
+
+float FVARIDReference::GetSummedAreaTableBlurRadius(float InBlurAmount, float InMaxMipLevel)
+{
+	const float ScaledBlurAmount = FMath::Clamp(InBlurAmount * InMaxMipLevel, 0.0f, InMaxMipLevel);
+	return (FMath::Pow(2.0f, ScaledBlurAmount) - 1.0f) * 0.5f;
+}
+
+void FVARIDReference::BuildSummedAreaTable(const FVARIDImage& InImage, const FIntRect& InRegionRect, FVARIDSummedAreaTable& OutTable)
+{
+	OutTable.Size = InImage.Size;
+	OutTable.Origin = InRegionRect.Min;
+	OutTable.Sums.SetNumZeroed(InImage.Size.X * InImage.Size.Y * 3);
+
+	// horizontal - quantise and scan each row
+	for (int32 Y = InRegionRect.Min.Y; Y < InRegionRect.Max.Y; ++Y)
+	{
+		uint32 Carry[3] = { 0, 0, 0 };
+
+		for (int32 X = InRegionRect.Min.X; X < InRegionRect.Max.X; ++X)
+		{
+			const FVector4 Colour = InImage.Load(X, Y);
+
+			for (int32 Channel = 0; Channel < 3; ++Channel)
+			{
+				Carry[Channel] += (uint32)FMath::RoundToInt(FMath::Clamp(Colour[Channel], 0.0f, 1.0f) * SAT_QUANTISATION);
+				OutTable.Sums[(Y * InImage.Size.X + X) * 3 + Channel] = Carry[Channel];
+			}
+		}
+	}
+
+	// vertical - scan each column in place
+	for (int32 X = InRegionRect.Min.X; X < InRegionRect.Max.X; ++X)
+	{
+		uint32 Carry[3] = { 0, 0, 0 };
+
+		for (int32 Y = InRegionRect.Min.Y; Y < InRegionRect.Max.Y; ++Y)
+		{
+			for (int32 Channel = 0; Channel < 3; ++Channel)
+			{
+				uint32& Sum = OutTable.Sums[(Y * InImage.Size.X + X) * 3 + Channel];
+				Carry[Channel] += Sum;
+				Sum = Carry[Channel];
+			}
+		}
+	}
+}
+
+/** the box of InRadius texels around InCentre, clamped to the viewport - the same as SATBoxAverageClamped() */
+static void GetClampedBox(const FIntPoint& InCentre, int32 InRadius, const FIntRect& InViewportRect, FIntPoint& OutBoxMin, FIntPoint& OutBoxMax)
+{
+	OutBoxMin = FIntPoint(FMath::Max(InCentre.X - InRadius, InViewportRect.Min.X), FMath::Max(InCentre.Y - InRadius, InViewportRect.Min.Y));
+	OutBoxMax = FIntPoint(FMath::Min(InCentre.X + InRadius, InViewportRect.Max.X - 1), FMath::Min(InCentre.Y + InRadius, InViewportRect.Max.Y - 1));
+}
+
+void FVARIDReference::BlurSummedAreaTable(const FVARIDSummedAreaTable& InTable, const FVARIDImage& InBlurVFMap, const FIntRect& InViewportRect, float InMaxMipLevel, FVARIDImage& OutImage)
+{
+	for (int32 Y = InViewportRect.Min.Y; Y < InViewportRect.Max.Y; ++Y)
+	{
+		for (int32 X = InViewportRect.Min.X; X < InViewportRect.Max.X; ++X)
+		{
+			const float Radius = GetSummedAreaTableBlurRadius(InBlurVFMap.Load(X, Y).X, InMaxMipLevel);
+			const int32 Radius0 = FMath::FloorToInt(Radius);
+
+			FIntPoint BoxMin, BoxMax;
+			GetClampedBox(FIntPoint(X, Y), Radius0, InViewportRect, BoxMin, BoxMax);
+			const FVector4 Box0 = InTable.BoxAverage(BoxMin, BoxMax);
+			GetClampedBox(FIntPoint(X, Y), Radius0 + 1, InViewportRect, BoxMin, BoxMax);
+			const FVector4 Box1 = InTable.BoxAverage(BoxMin, BoxMax);
+
+			OutImage.Store(X, Y, FMath::Lerp(Box0, Box1, Radius - Radius0));
+		}
+	}
+}
+
+void FVARIDReference::BlurMipChain(const TArray<FVARIDImage>& InMips, const FVARIDImage& InBlurVFMap, const FIntRect& InViewportRect, float InMaxMipLevel, FVARIDImage& OutImage)
+{
+	const FIntPoint Extent = InMips[0].Size;
+
+	for (int32 Y = InViewportRect.Min.Y; Y < InViewportRect.Max.Y; ++Y)
+	{
+		for (int32 X = InViewportRect.Min.X; X < InViewportRect.Max.X; ++X)
+		{
+			// the sampler clamps the level to the last mip
+			const float Level = FMath::Clamp(InBlurVFMap.Load(X, Y).X * InMaxMipLevel, 0.0f, (float)(InMips.Num() - 1));
+			const int32 Level0 = FMath::Min(FMath::FloorToInt(Level), InMips.Num() - 1);
+			const int32 Level1 = FMath::Min(Level0 + 1, InMips.Num() - 1);
+			const FVector2D UV((X + 0.5f) / Extent.X, (Y + 0.5f) / Extent.Y);
+
+			OutImage.Store(X, Y, RGBOnly(FMath::Lerp(SampleBilinearClamped(InMips[Level0], UV), SampleBilinearClamped(InMips[Level1], UV), Level - Level0)));
+		}
+	}
+}
+
+FVector4 FVARIDReference::BoxBlurBruteForce(const FVARIDImage& InImage, const FIntRect& InViewportRect, const FIntPoint& InCentre, float InRadius)
+{
+	const int32 Radius0 = FMath::FloorToInt(InRadius);
+	FVector4 Boxes[2];
+
+	for (int32 i = 0; i < 2; ++i)
+	{
+		FIntPoint BoxMin, BoxMax;
+		GetClampedBox(InCentre, Radius0 + i, InViewportRect, BoxMin, BoxMax);
+
+		double Sum[3] = { 0.0, 0.0, 0.0 };
+		for (int32 Y = BoxMin.Y; Y <= BoxMax.Y; ++Y)
+		{
+			for (int32 X = BoxMin.X; X <= BoxMax.X; ++X)
+			{
+				const FVector4 Colour = InImage.Load(X, Y);
+				Sum[0] += Colour.X;
+				Sum[1] += Colour.Y;
+				Sum[2] += Colour.Z;
+			}
+		}
+
+		const double Count = (double)((BoxMax.X - BoxMin.X + 1) * (BoxMax.Y - BoxMin.Y + 1));
+		Boxes[i] = FVector4((float)(Sum[0] / Count), (float)(Sum[1] / Count), (float)(Sum[2] / Count), 1.0f);
+	}
+
+	return FMath::Lerp(Boxes[0], Boxes[1], InRadius - Radius0);
+}
+
+bool FVARIDReference::ValidateSummedAreaTableBlur(FString& OutReport)
+{
+	const FIntPoint Extent(256, 256);
+	const FIntRect ViewportRect(FIntPoint(0, 0), Extent);
+	const int32 NumMips = FVARIDWorkingTexturePlan::CalculateNumMips2D(Extent);
+	const float MaxMipLevel = (float)NumMips;	// what the compositor is given
+	const int32 SampleSpacing = 13;	// the brute force box is only evaluated on a sparse grid
+	const int32 NumTimingRuns = 3;
+
+	// noise on top of stripes, so every radius changes the result
+	FVARIDImage Image(Extent);
+	FRandomStream RandomStream(33);
+	for (int32 Y = 0; Y < Extent.Y; ++Y)
+	{
+		for (int32 X = 0; X < Extent.X; ++X)
+		{
+			const float Stripes = ((X / 8 + Y / 16) & 1) ? 0.75f : 0.25f;
+			Image.Store(X, Y, FVector4(
+				FMath::Clamp(Stripes + RandomStream.FRandRange(-0.25f, 0.25f), 0.0f, 1.0f),
+				RandomStream.FRand(),
+				(float)X / Extent.X,
+				1.0f));
+		}
+	}
+
+	// radial blur VF map, sharp in the middle and fully blurred in the corners
+	FVARIDImage BlurVFMap(Extent);
+	for (int32 Y = 0; Y < Extent.Y; ++Y)
+	{
+		for (int32 X = 0; X < Extent.X; ++X)
+		{
+			const FVector2D UV((X + 0.5f) / Extent.X, (Y + 0.5f) / Extent.Y);
+			const float Blur = FMath::Clamp(FVector2D::Distance(UV, FVector2D(0.5f, 0.5f)) / 0.7071f, 0.0f, 1.0f);
+			BlurVFMap.Store(X, Y, FVector4(Blur, 0.0f, 0.0f, 0.0f));
+		}
+	}
+
+	// both blurs, timed including what they have to build every frame
+	FVARIDSummedAreaTable Table;
+	TArray<FVARIDImage> Mips;
+	FVARIDImage SummedAreaTableBlurred(Extent);
+	FVARIDImage MipChainBlurred(Extent);
+	double SummedAreaTableSeconds = 0.0;
+	double MipChainSeconds = 0.0;
+
+	for (int32 Run = 0; Run < NumTimingRuns; ++Run)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		BuildSummedAreaTable(Image, ViewportRect, Table);
+		BlurSummedAreaTable(Table, BlurVFMap, ViewportRect, MaxMipLevel, SummedAreaTableBlurred);
+		const double MidTime = FPlatformTime::Seconds();
+		GaussianPyramidMultiPass(Image, ViewportRect, NumMips, Mips);
+		BlurMipChain(Mips, BlurVFMap, ViewportRect, MaxMipLevel, MipChainBlurred);
+		const double EndTime = FPlatformTime::Seconds();
+
+		SummedAreaTableSeconds = Run == 0 ? MidTime - StartTime : FMath::Min(SummedAreaTableSeconds, MidTime - StartTime);
+		MipChainSeconds = Run == 0 ? EndTime - MidTime : FMath::Min(MipChainSeconds, EndTime - MidTime);
+	}
+
+	// the SAT lookup must not get dearer with the radius
+	FVARIDImage SharpVFMap(Extent);
+	FVARIDImage BlurredVFMap(Extent);
+	for (int32 i = 0; i < BlurredVFMap.Pixels.Num(); ++i)
+	{
+		BlurredVFMap.Pixels[i] = FVector4(1.0f, 0.0f, 0.0f, 0.0f);
+	}
+
+	FVARIDImage Scratch(Extent);
+	double SharpSeconds = 0.0;
+	double BlurredSeconds = 0.0;
+
+	for (int32 Run = 0; Run < NumTimingRuns; ++Run)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		BlurSummedAreaTable(Table, SharpVFMap, ViewportRect, MaxMipLevel, Scratch);
+		const double MidTime = FPlatformTime::Seconds();
+		BlurSummedAreaTable(Table, BlurredVFMap, ViewportRect, MaxMipLevel, Scratch);
+		const double EndTime = FPlatformTime::Seconds();
+
+		SharpSeconds = Run == 0 ? MidTime - StartTime : FMath::Min(SharpSeconds, MidTime - StartTime);
+		BlurredSeconds = Run == 0 ? EndTime - MidTime : FMath::Min(BlurredSeconds, EndTime - MidTime);
+	}
+
+	// error against the box both are meant to approximate
+	float MaxSummedAreaTableError = 0.0f;
+	float MaxMipChainError = 0.0f;
+	double SumMipChainError = 0.0;
+	int32 NumSamples = 0;
+
+	for (int32 Y = SampleSpacing / 2; Y < Extent.Y; Y += SampleSpacing)
+	{
+		for (int32 X = SampleSpacing / 2; X < Extent.X; X += SampleSpacing)
+		{
+			const float Radius = GetSummedAreaTableBlurRadius(BlurVFMap.Load(X, Y).X, MaxMipLevel);
+			const FVector4 Expected = BoxBlurBruteForce(Image, ViewportRect, FIntPoint(X, Y), Radius);
+			const FVector4 FromTable = SummedAreaTableBlurred.Load(X, Y);
+			const FVector4 FromMips = MipChainBlurred.Load(X, Y);
+
+			for (int32 Channel = 0; Channel < 3; ++Channel)
+			{
+				MaxSummedAreaTableError = FMath::Max(MaxSummedAreaTableError, FMath::Abs(FromTable[Channel] - Expected[Channel]));
+				MaxMipChainError = FMath::Max(MaxMipChainError, FMath::Abs(FromMips[Channel] - Expected[Channel]));
+				SumMipChainError += FMath::Abs(FromMips[Channel] - Expected[Channel]);
+			}
+
+			++NumSamples;
+		}
+	}
+
+	// only the 10 bit quantisation separates the table from the exact box
+	const float Tolerance = 0.5f / SAT_QUANTISATION + 1e-5f;
+
+	if (MaxSummedAreaTableError > Tolerance)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Summed area table blur FAILED. Max error against the brute force box %f (tolerance %f)"), MaxSummedAreaTableError, Tolerance);
+		return false;
+	}
+
+	// an eye sized white image sums past 2^32 towards the far corner. Boxes there must still come out exact
+	const FIntPoint WrapExtent(2100, 2100);
+	FVARIDImage WhiteImage(WrapExtent);
+	for (int32 i = 0; i < WhiteImage.Pixels.Num(); ++i)
+	{
+		WhiteImage.Pixels[i] = FVector4(1.0f, 1.0f, 1.0f, 1.0f);
+	}
+
+	FVARIDSummedAreaTable WrapTable;
+	BuildSummedAreaTable(WhiteImage, FIntRect(FIntPoint(0, 0), WrapExtent), WrapTable);
+
+	const FVector4 FarCornerBox = WrapTable.BoxAverage(WrapExtent - FIntPoint(40, 40), WrapExtent - FIntPoint(1, 1));
+	const bool bWrapped = (uint64)WrapExtent.X * WrapExtent.Y * (uint64)SAT_QUANTISATION > 0xFFFFFFFFull;
+
+	if (!bWrapped || FarCornerBox.X != 1.0f || FarCornerBox.Y != 1.0f || FarCornerBox.Z != 1.0f)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Summed area table blur FAILED. A box past the 32 bit wrap averages %f instead of 1"), FarCornerBox.X);
+		return false;
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: Summed area table blur OK. Max error against the brute force box %f (tolerance %f), mip chain %f (mean %f). ")
+		TEXT("CPU time at %dx%d: SAT build + blur %.2f ms, pyramid build + trilinear blur %.2f ms. SAT lookup at the smallest radius %.2f ms, at the largest %.2f ms"),
+		MaxSummedAreaTableError, Tolerance, MaxMipChainError, (float)(SumMipChainError / (NumSamples * 3)),
+		Extent.X, Extent.Y, SummedAreaTableSeconds * 1000.0, MipChainSeconds * 1000.0, SharpSeconds * 1000.0, BlurredSeconds * 1000.0);
+	return true;
+}
+
+#endif
@@ -0,0 +1,296 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDSelfCheck.h"
+#include "VARIDReference.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// FVARIDSelfCheck and the FVARIDReference validations as automation tests, in any application context so they run headless:
+// UE4Editor-Cmd <project> -nullrhi -unattended -ExecCmds="Automation RunTests VARID; Quit" [-VARIDBudgetScale=<n>]
+
+static const uint32 VARID_TEST_FLAGS = EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter;
+
+/** logs InReport as the test's result, an error if the check failed */
+static bool ReportTestResult(FAutomationTestBase& InTest, bool bInPassed, const FString& InReport)
+{
+	if (bInPassed)
+	{
+		InTest.AddInfo(InReport);
+	}
+	else
+	{
+		InTest.AddError(InReport);
+	}
+
+	return bInPassed;
+}
+
+/*****************************************************************************************************************/
+// self checks
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDProfileFilesTest, "VARID.SelfCheck.ProfileFiles", VARID_TEST_FLAGS)
+
+bool FVARIDProfileFilesTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDSelfCheck::CheckProfileFiles(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDFXIDsTest, "VARID.SelfCheck.FXIDs", VARID_TEST_FLAGS)
+
+bool FVARIDFXIDsTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDSelfCheck::CheckFXIDs(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDModuleStateTest, "VARID.SelfCheck.ModuleState", VARID_TEST_FLAGS)
+
+bool FVARIDModuleStateTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDSelfCheck::CheckModuleState(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDShutdownTest, "VARID.SelfCheck.Shutdown", VARID_TEST_FLAGS)
+
+bool FVARIDShutdownTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDSelfCheck::CheckShutdown(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDBudgetsTest, "VARID.SelfCheck.Budgets", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FVARIDBudgetsTest::RunTest(const FString& Parameters)
+{
+	// e.g. 4 for a debug build
+	float BudgetScale = 1.0f;
+	FParse::Value(FCommandLine::Get(), TEXT("VARIDBudgetScale="), BudgetScale);
+
+	FString Report;
+	const bool bPassed = FVARIDSelfCheck::CheckBudgets(FMath::Max(BudgetScale, 0.0f), Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+/*****************************************************************************************************************/
+// CPU reference
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceInpaintFillTest, "VARID.Reference.InpaintFill", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceInpaintFillTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateInpaintFill(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceGaussianPyramidTest, "VARID.Reference.GaussianPyramid", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceGaussianPyramidTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateGaussianPyramid(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceGaussianBlurKernelsTest, "VARID.Reference.GaussianBlurKernels", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceGaussianBlurKernelsTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateGaussianBlurKernels(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceContrastReconstructTest, "VARID.Reference.ContrastReconstruct", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceContrastReconstructTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateContrastReconstruct(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceTileClassificationTest, "VARID.Reference.TileClassification", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceTileClassificationTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateTileClassification(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceWorkingTexturePlanTest, "VARID.Reference.WorkingTexturePlan", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceWorkingTexturePlanTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateWorkingTexturePlan(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceWarpFieldTest, "VARID.Reference.WarpField", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceWarpFieldTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateWarpField(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceSummedAreaTableBlurTest, "VARID.Reference.SummedAreaTableBlur", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceSummedAreaTableBlurTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateSummedAreaTableBlur(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceComputeCompositorTest, "VARID.Reference.ComputeCompositor", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceComputeCompositorTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateComputeCompositor(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceVFMapMeshTest, "VARID.Reference.VFMapMesh", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceVFMapMeshTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateVFMapMesh(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceVFMapImageTest, "VARID.Reference.VFMapImage", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceVFMapImageTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateVFMapImage(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceVFMapResolutionTest, "VARID.Reference.VFMapResolution", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceVFMapResolutionTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateVFMapResolution(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceVFMapCombinedTest, "VARID.Reference.VFMapCombined", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceVFMapCombinedTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateVFMapCombined(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceViewProfilesTest, "VARID.Reference.ViewProfiles", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceViewProfilesTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateViewProfiles(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceProfileBatchTest, "VARID.Reference.ProfileBatch", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceProfileBatchTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateProfileBatch(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceProfileProgressionTest, "VARID.Reference.ProfileProgression", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceProfileProgressionTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateProfileProgression(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceTraceTest, "VARID.Reference.Trace", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceTraceTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateTrace(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceFrameRingTest, "VARID.Reference.FrameRing", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceFrameRingTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateFrameRing(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceProfileHotReloadTest, "VARID.Reference.ProfileHotReload", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceProfileHotReloadTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateProfileHotReload(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceVFMapPointsTest, "VARID.Reference.VFMapPoints", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceVFMapPointsTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateVFMapPoints(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferencePipelineWarmupTest, "VARID.Reference.PipelineWarmup", VARID_TEST_FLAGS)
+
+bool FVARIDReferencePipelineWarmupTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidatePipelineWarmup(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceQualityControllerTest, "VARID.Reference.QualityController", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceQualityControllerTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateQualityController(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVARIDReferenceOutputCaptureTest, "VARID.Reference.OutputCapture", VARID_TEST_FLAGS)
+
+bool FVARIDReferenceOutputCaptureTest::RunTest(const FString& Parameters)
+{
+	FString Report;
+	const bool bPassed = FVARIDReference::ValidateOutputCapture(Report);
+	return ReportTestResult(*this, bPassed, Report);
+}
+
+#endif
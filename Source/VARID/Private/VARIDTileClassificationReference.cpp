@@ -0,0 +1,474 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "VARIDPyramidLayout.h"
+#include "Math/RandomStream.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// VARIDTileClassifyCS.usf and the tile list dispatches of the inpaint fill, the fused reconstruct and the compute compositor. Skipping the
+// unaffected groups is only safe if each listed group gives what the full dispatch gives there, and the indirect dispatch runs every entry once
+
+static const int32 CLASSIFY_TILE_SIZE = 16;		// must match VARIDTileClassifyCS.usf
+
+float FVARIDTileLists::GetSkippedFraction() const
+{
+	const int32 NumGroups = AffectedGroups.Num() + UnaffectedGroups.Num();
+	return NumGroups > 0 ? (float)UnaffectedGroups.Num() / (float)NumGroups : 0.0f;
+}
+
+void FVARIDReference::EvaluateVFMap(const FVARIDVFMap& InVFMap, const FIntRect& InViewportRect, int32 InMipLevel, FVARIDImage& OutImage)
+{
+	const float StdDev = 0.025f;	// must match VARIDHeightMapCS.usf
+	const float RBFDenominator = 2.0f * StdDev * StdDev;
+
+	// the same point filtering as BuildHeightMapTexture_RenderThread
+	float OriginOffset = 0.0f;
+	TArray<FVARIDVFMapPoint> Points;
+
+	if (InVFMap.FullField && InVFMap.Points.Num() == 1)
+	{
+		OriginOffset = InVFMap.Points.GetValue(0);
+	}
+	else
+	{
+		InVFMap.Points.GetPoints(Points);
+	}
+
+	const FIntRect Rect = FVARIDPyramidLayout::GetMipViewportRect(InViewportRect, InMipLevel);
+	const FVector2D TexelSize(1.0f / OutImage.Size.X, 1.0f / OutImage.Size.Y);
+
+	// image maps have no points
+	const FVARIDVFMapImage* Image = InVFMap.Image.Get();
+	const float ImageLevel = Image ? Image->GetSampleLevel(TexelSize) : 0.0f;
+
+	for (int32 Y = Rect.Min.Y; Y < Rect.Max.Y; ++Y)
+	{
+		for (int32 X = Rect.Min.X; X < Rect.Max.X; ++X)
+		{
+			const FVector2D UV((X + 0.5f) * TexelSize.X, (Y + 0.5f) * TexelSize.Y);
+
+			float InterpolatedValue = OriginOffset + (Image ? Image->Sample(UV, ImageLevel) : 0.0f);
+
+			for (const FVARIDVFMapPoint& Point : Points)
+			{
+				InterpolatedValue += Point.NormValue * FMath::Exp(-FVector2D::DistSquared(UV, FVector2D(Point.NormX, Point.NormY)) / RBFDenominator);
+			}
+
+			OutImage.Store(X, Y, FVector4(FMath::Clamp(InterpolatedValue, 0.0f, 1.0f), 0.0f, 0.0f, 0.0f));
+		}
+	}
+}
+
+void FVARIDReference::ClassifyTiles(const TArray<FVARIDImage>& InVFMapMips, const FIntRect& InRegionRect, int32 InNumLevels, int32 InDilation, float InThreshold, FVARIDTileLists& OutTileLists, const FVARIDCompositorTileInput* InCompositor)
+{
+	check(InNumLevels > 0 && InNumLevels <= InVFMapMips.Num());
+
+	OutTileLists.AffectedGroups.Reset();
+	OutTileLists.UnaffectedGroups.Reset();
+
+	const FIntPoint RegionSize = InRegionRect.Size();
+	const FIntPoint NumTiles((RegionSize.X + CLASSIFY_TILE_SIZE - 1) / CLASSIFY_TILE_SIZE, (RegionSize.Y + CLASSIFY_TILE_SIZE - 1) / CLASSIFY_TILE_SIZE);
+	const FIntPoint NumRegionGroups((RegionSize.X + TileListGroupSize - 1) / TileListGroupSize, (RegionSize.Y + TileListGroupSize - 1) / TileListGroupSize);
+	const int32 GroupsPerTileAxis = CLASSIFY_TILE_SIZE / TileListGroupSize;
+
+	// one iteration of this loop == one thread group
+	for (int32 TileY = 0; TileY < NumTiles.Y; ++TileY)
+	{
+		for (int32 TileX = 0; TileX < NumTiles.X; ++TileX)
+		{
+			const FIntPoint TileMin = InRegionRect.Min + FIntPoint(TileX, TileY) * CLASSIFY_TILE_SIZE;
+			const FIntPoint TileMax = TileMin + FIntPoint(CLASSIFY_TILE_SIZE - 1, CLASSIFY_TILE_SIZE - 1);	// inclusive
+
+			float Max = 0.0f;
+			float CompositorMax = 0.0f;
+
+			if (InCompositor)
+			{
+				// one texel of dilation around the tile, at level 0
+				const FIntPoint FootprintMin = ClampToRect(TileMin - FIntPoint(1, 1), InRegionRect);
+				const FIntPoint FootprintMax = ClampToRect(TileMax + FIntPoint(1, 1), InRegionRect);
+
+				for (int32 Y = FootprintMin.Y; Y <= FootprintMax.Y; ++Y)
+				{
+					for (int32 X = FootprintMin.X; X <= FootprintMax.X; ++X)
+					{
+						const FVector4 Warp = InCompositor->WarpVFMap->Load(X, Y);
+						const float Move = FMath::Max(FMath::Abs(Warp.X * InCompositor->WarpTexelScale.X), FMath::Abs(Warp.Y * InCompositor->WarpTexelScale.Y));
+						CompositorMax = FMath::Max(CompositorMax, FMath::Max(InCompositor->BlurVFMap->Load(X, Y).X * InCompositor->BlurScale, Move));
+					}
+				}
+			}
+
+			for (int32 Level = 0; Level < InNumLevels; ++Level)
+			{
+				const FIntRect LevelRect = FVARIDPyramidLayout::GetMipViewportRect(InRegionRect, Level);
+				const FIntPoint FootprintMin = ClampToRect(FIntPoint((TileMin.X >> Level) - InDilation, (TileMin.Y >> Level) - InDilation), LevelRect);
+				const FIntPoint FootprintMax = ClampToRect(FIntPoint((TileMax.X >> Level) + InDilation, (TileMax.Y >> Level) + InDilation), LevelRect);
+
+				for (int32 Y = FootprintMin.Y; Y <= FootprintMax.Y; ++Y)
+				{
+					for (int32 X = FootprintMin.X; X <= FootprintMax.X; ++X)
+					{
+						Max = FMath::Max(Max, InVFMapMips[Level].Load(X, Y).X);
+					}
+				}
+			}
+
+			const bool bAffected = Max > InThreshold || (InCompositor && CompositorMax > InCompositor->Threshold);
+			TArray<FIntPoint>& TileList = bAffected ? OutTileLists.AffectedGroups : OutTileLists.UnaffectedGroups;
+
+			// only the groups the regular dispatch would have launched
+			for (int32 GroupY = TileY * GroupsPerTileAxis; GroupY < FMath::Min((TileY + 1) * GroupsPerTileAxis, NumRegionGroups.Y); ++GroupY)
+			{
+				for (int32 GroupX = TileX * GroupsPerTileAxis; GroupX < FMath::Min((TileX + 1) * GroupsPerTileAxis, NumRegionGroups.X); ++GroupX)
+				{
+					TileList.Add(FIntPoint(GroupX, GroupY));
+				}
+			}
+		}
+	}
+}
+
+/** the pass mip of the inpaint mask. VARIDBasicResampleCS.usf samples bilinearly at the texel centre, which is the average of the middle 2x2 level 0 texels */
+static void DownsampleInpaintMask(const FVARIDImage& InMask, int32 InPassMipLevel, FVARIDImage& OutMask)
+{
+	OutMask = FVARIDImage(FIntPoint(FMath::Max(InMask.Size.X >> InPassMipLevel, 1), FMath::Max(InMask.Size.Y >> InPassMipLevel, 1)));
+
+	const int32 Scale = 1 << InPassMipLevel;
+	const FIntRect MaskRect(FIntPoint::ZeroValue, InMask.Size);
+
+	for (int32 Y = 0; Y < OutMask.Size.Y; ++Y)
+	{
+		for (int32 X = 0; X < OutMask.Size.X; ++X)
+		{
+			FVector4 Sum(0.0f, 0.0f, 0.0f, 0.0f);
+
+			for (int32 Index = 0; Index < 4; ++Index)
+			{
+				const FIntPoint Source = FVARIDReference::ClampToRect(FIntPoint(X * Scale + Scale / 2 - 1 + Index % 2, Y * Scale + Scale / 2 - 1 + Index / 2), MaskRect);
+				Sum += InMask.Load(Source.X, Source.Y);
+			}
+
+			OutMask.Store(X, Y, Sum * 0.25f);
+		}
+	}
+}
+
+bool FVARIDReference::ValidateTileClassification(FString& OutReport)
+{
+	float MinInpaintSkipped = 1.0f;
+	float MinContrastSkipped = 1.0f;
+
+	/*************************************************************/
+	// inpaint - skipped groups are a copy, so the result must be bit identical
+
+	{
+		const int32 NumberOfPasses = 16;	// must match BuildInpaintTexture_RenderThread
+		const int32 Iterations = 4;		// must match INPAINT_FILL_ITERATIONS_PER_DISPATCH
+
+		const FIntPoint Size(141, 77);
+		const FIntRect ActiveRects[2] = { FIntRect(0, 0, Size.X, Size.Y), FIntRect(Size.X / 2, 0, Size.X, Size.Y) };
+
+		for (const FIntRect& ActiveRect : ActiveRects)
+		{
+			const FIntPoint GroupCount((ActiveRect.Width() + TileListGroupSize - 1) / TileListGroupSize, (ActiveRect.Height() + TileListGroupSize - 1) / TileListGroupSize);
+			const FIntRect DispatchRect(ActiveRect.Min, ActiveRect.Min + GroupCount * TileListGroupSize);
+
+			FVARIDImage Mask;
+			FVARIDImage Colour[2];
+			FVARIDImage MetaData[2];
+			BuildSyntheticInpaintState(Size, 0.0f, Mask, Colour[0], MetaData[0]);
+			Colour[1] = Colour[0];
+			MetaData[1] = MetaData[0];
+
+			TArray<FVARIDImage> MaskMips;
+			MaskMips.Add(Mask);
+
+			FVARIDTileLists TileLists;
+			ClassifyTiles(MaskMips, ActiveRect, 1, 0, MaskThreshold, TileLists);
+			MinInpaintSkipped = FMath::Min(MinInpaintSkipped, TileLists.GetSkippedFraction());
+
+			int32 ReferenceResult = 0;
+			for (int32 PassCounter = 0; PassCounter < NumberOfPasses; ++PassCounter)
+			{
+				const int32 In = PassCounter % 2;
+				InpaintFillPass(Mask, Colour[In], MetaData[In], Colour[1 - In], MetaData[1 - In], DispatchRect, PassCounter);
+				ReferenceResult = 1 - In;
+			}
+
+			for (const bool bTiledFill : { false, true })
+			{
+				// the second ping-pong texture only gets the one time copy on unaffected groups. affected groups start out as garbage
+				FVARIDImage TileListColour[2];
+				FVARIDImage TileListMetaData[2];
+				BuildSyntheticInpaintState(Size, 0.0f, Mask, TileListColour[0], TileListMetaData[0]);
+				TileListColour[1] = TileListColour[0];
+				TileListMetaData[1] = TileListMetaData[0];
+
+				TArray<FIntPoint> GroupOrigins;
+				GetDispatchGroupOrigins(DispatchRect, TileListGroupSize, &TileLists.AffectedGroups, GroupOrigins);
+				for (const FIntPoint& GroupOrigin : GroupOrigins)
+				{
+					for (int32 Index = 0; Index < TileListGroupSize * TileListGroupSize; ++Index)
+					{
+						const FIntPoint ID = GroupOrigin + FIntPoint(Index % TileListGroupSize, Index / TileListGroupSize);
+						TileListColour[1].Store(ID.X, ID.Y, FVector4(-7.0f, -7.0f, -7.0f, -7.0f));
+						TileListMetaData[1].Store(ID.X, ID.Y, FVector4(-7.0f, -7.0f, -7.0f, 1.0f));
+					}
+				}
+
+				const int32 PassesPerDispatch = bTiledFill ? Iterations : 1;
+
+				int32 TileListResult = 0;
+				for (int32 DispatchCounter = 0; DispatchCounter < NumberOfPasses / PassesPerDispatch; ++DispatchCounter)
+				{
+					const int32 In = DispatchCounter % 2;
+
+					if (bTiledFill)
+					{
+						InpaintFillTiled(Mask, TileListColour[In], TileListMetaData[In], TileListColour[1 - In], TileListMetaData[1 - In], DispatchRect, DispatchCounter * Iterations, Iterations, TileListGroupSize, &TileLists.AffectedGroups);
+					}
+					else
+					{
+						InpaintFillPass(Mask, TileListColour[In], TileListMetaData[In], TileListColour[1 - In], TileListMetaData[1 - In], DispatchRect, DispatchCounter, &TileLists.AffectedGroups);
+					}
+
+					TileListResult = 1 - In;
+				}
+
+				FIntPoint Mismatch;
+				if (!ImagesAreIdentical(Colour[ReferenceResult], TileListColour[TileListResult], Mismatch) || !ImagesAreIdentical(MetaData[ReferenceResult], TileListMetaData[TileListResult], Mismatch))
+				{
+					OutReport = FString::Printf(TEXT("VARID: Tile classification FAILED. Inpaint %s fill mismatch at (%d, %d) for active rect starting at (%d, %d)"), bTiledFill ? TEXT("tiled") : TEXT("single pass"), Mismatch.X, Mismatch.Y, ActiveRect.Min.X, ActiveRect.Min.Y);
+					return false;
+				}
+			}
+		}
+	}
+
+	/*************************************************************/
+	// contrast - skipped level 0 groups are a copy of the gaussian. every level below the threshold can add up to the threshold of error
+
+	const float ContrastThreshold = 1.0f / 8192.0f;	// default of r.VARID.TileClassification.ContrastThreshold
+	const int32 ContrastDilation = 4;	// must match BuildContrastTextureFused_RenderThread
+	float MaxContrastError = 0.0f;
+	float ContrastTolerance = 0.0f;
+
+	// compositor - skipped groups are a copy of the gaussian. on top of the contrast error, the blur and warp below the threshold can add up to it
+	const float CompositorThreshold = 1.0f / 8192.0f;	// default of r.VARID.TileClassification.CompositorThreshold
+	float MinCompositorSkipped = 1.0f;
+	float MaxCompositorError = 0.0f;
+	float CompositorTolerance = 0.0f;
+
+	{
+		const FIntPoint Size(301, 157);
+		const FIntRect ViewportRects[2] = { FIntRect(0, 0, Size.X / 2, Size.Y), FIntRect(Size.X / 2, 0, Size.X, Size.Y) };
+		const int32 NumMips = 8;
+
+		ContrastTolerance = (NumMips - 1) * ContrastThreshold + 1e-5f;
+		CompositorTolerance = (NumMips - 1) * ContrastThreshold + CompositorThreshold + 1e-5f;
+
+		FRandomStream RandomStream(121314);
+		FVARIDImage Image(Size);
+		for (int32 Y = 0; Y < Size.Y; ++Y)
+		{
+			for (int32 X = 0; X < Size.X; ++X)
+			{
+				Image.Store(X, Y, FVector4(RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand(), 1.0f));
+			}
+		}
+
+		// a central and a peripheral loss of the high spatial frequencies only. any loss at the coarse levels reaches every tile
+		const int32 NumLossLevels = 3;
+		FVARIDVFMap VFMap;
+		VFMap.FullField = false;
+		VFMap.Points.SetPoints({ FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.3f, 0.5f, 0.9f), FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.8f, 0.2f, 0.5f) });
+
+		TArray<FVARIDImage> VFMapMips;
+		AllocateMips(Size, NumMips, VFMapMips);
+
+		for (const FIntRect& ViewportRect : ViewportRects)
+		{
+			for (int32 MipLevel = 0; MipLevel < NumLossLevels; ++MipLevel)
+			{
+				EvaluateVFMap(VFMap, ViewportRect, MipLevel, VFMapMips[MipLevel]);
+			}
+		}
+
+		// blurred and warped in the lower half of each viewport. The upper half has a blur and warp too small to see, below the threshold
+		FVARIDImage BlurVFMap(Size);
+		FVARIDImage WarpVFMap(Size);
+		for (int32 Y = 0; Y < Size.Y; ++Y)
+		{
+			for (int32 X = 0; X < Size.X; ++X)
+			{
+				const bool bLowerHalf = Y >= Size.Y / 2;
+				BlurVFMap.Store(X, Y, FVector4(bLowerHalf ? 0.4f : 1e-6f, 0.0f, 0.0f, 0.0f));
+				WarpVFMap.Store(X, Y, bLowerHalf ? FVector4(2.5f / Size.X, -1.5f / Size.Y, 0.0f, 0.0f) : FVector4(1e-7f, -1e-7f, 0.0f, 0.0f));
+			}
+		}
+
+		FVARIDCompositorTileInput CompositorInput;
+		CompositorInput.BlurVFMap = &BlurVFMap;
+		CompositorInput.WarpVFMap = &WarpVFMap;
+		CompositorInput.BlurScale = NumMips;	// must match Composite_RenderThread
+		CompositorInput.WarpTexelScale = FVector2D(Size.X, Size.Y);
+		CompositorInput.Threshold = CompositorThreshold;
+
+		for (const FIntRect& ViewportRect : ViewportRects)
+		{
+			TArray<FVARIDImage> GaussianMips;
+			GaussianPyramidMultiPass(Image, ViewportRect, NumMips, GaussianMips);
+
+			FVARIDTileLists TileLists;
+			ClassifyTiles(VFMapMips, ViewportRect, NumMips - 1, ContrastDilation, ContrastThreshold, TileLists);
+			MinContrastSkipped = FMath::Min(MinContrastSkipped, TileLists.GetSkippedFraction());
+
+			TArray<FVARIDImage> ReferenceMips;
+			TArray<FVARIDImage> TileListMips;
+			ContrastReconstructFused(GaussianMips, VFMapMips, ViewportRect, ReferenceMips);
+			ContrastReconstructFused(GaussianMips, VFMapMips, ViewportRect, TileListMips, &TileLists);
+
+			for (int32 Y = ViewportRect.Min.Y; Y < ViewportRect.Max.Y; ++Y)
+			{
+				for (int32 X = ViewportRect.Min.X; X < ViewportRect.Max.X; ++X)
+				{
+					const FVector4 A = ReferenceMips[0].Load(X, Y);
+					const FVector4 B = TileListMips[0].Load(X, Y);
+					const float Error = FMath::Max(FMath::Max(FMath::Abs(A.X - B.X), FMath::Abs(A.Y - B.Y)), FMath::Abs(A.Z - B.Z));
+					MaxContrastError = FMath::Max(MaxContrastError, Error);
+
+					if (Error > ContrastTolerance)
+					{
+						OutReport = FString::Printf(TEXT("VARID: Tile classification FAILED. Contrast mismatch at (%d, %d) for viewport starting at (%d, %d). Error=%f"), X, Y, ViewportRect.Min.X, ViewportRect.Min.Y, Error);
+						return false;
+					}
+				}
+			}
+
+			// the compute compositor reads the contrast levels from 1 down, and reconstructs level 0 itself
+			FVARIDTileLists CompositorTileLists;
+			ClassifyTiles(VFMapMips, ViewportRect, NumMips - 1, ContrastDilation, ContrastThreshold, CompositorTileLists, &CompositorInput);
+			MinCompositorSkipped = FMath::Min(MinCompositorSkipped, CompositorTileLists.GetSkippedFraction());
+
+			FVARIDImage ReferenceOutput(Size);
+			FVARIDImage TileListOutput(Size);
+			CompositeCompute(GaussianMips, VFMapMips, ReferenceMips, BlurVFMap, WarpVFMap, ViewportRect, ReferenceOutput);
+			CompositeCompute(GaussianMips, VFMapMips, ReferenceMips, BlurVFMap, WarpVFMap, ViewportRect, TileListOutput, &CompositorTileLists);
+
+			for (int32 Y = ViewportRect.Min.Y; Y < ViewportRect.Max.Y; ++Y)
+			{
+				for (int32 X = ViewportRect.Min.X; X < ViewportRect.Max.X; ++X)
+				{
+					const FVector4 A = ReferenceOutput.Load(X, Y);
+					const FVector4 B = TileListOutput.Load(X, Y);
+					const float Error = FMath::Max(FMath::Max(FMath::Abs(A.X - B.X), FMath::Abs(A.Y - B.Y)), FMath::Max(FMath::Abs(A.Z - B.Z), FMath::Abs(A.W - B.W)));
+					MaxCompositorError = FMath::Max(MaxCompositorError, Error);
+
+					if (Error > CompositorTolerance)
+					{
+						OutReport = FString::Printf(TEXT("VARID: Tile classification FAILED. Compositor mismatch at (%d, %d) for viewport starting at (%d, %d). Error=%f"), X, Y, ViewportRect.Min.X, ViewportRect.Min.Y, Error);
+						return false;
+					}
+				}
+			}
+		}
+	}
+
+	/*************************************************************/
+	// a list longer than TileListMaxGroupsX wraps onto more rows of the dispatch. Each entry must run once, and the padding of the last row not at all
+
+	const int32 NumLongListEntries = 2 * TileListMaxGroupsX + 1234;
+
+	{
+		TArray<FIntPoint> LongList;
+		LongList.Reserve(NumLongListEntries);
+		for (int32 Index = 0; Index < NumLongListEntries; ++Index)
+		{
+			LongList.Add(FIntPoint(Index % 1024, Index / 1024));
+		}
+
+		const FIntPoint GroupCount = GetTileListGroupCount(LongList.Num());
+		TArray<FIntPoint> GroupOrigins;
+		GetDispatchGroupOrigins(FIntRect(0, 0, 1024 * TileListGroupSize, 1024 * TileListGroupSize), TileListGroupSize, &LongList, GroupOrigins);
+
+		bool bInOrder = GroupOrigins.Num() == LongList.Num();
+		for (int32 Index = 0; bInOrder && Index < GroupOrigins.Num(); ++Index)
+		{
+			bInOrder = GroupOrigins[Index] == LongList[Index] * TileListGroupSize;
+		}
+
+		if (GroupCount.X > TileListMaxGroupsX || GroupCount.X * GroupCount.Y < LongList.Num() || !bInOrder)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Tile classification FAILED. A list of %d entries dispatched as %dx%d groups ran %d of them"), LongList.Num(), GroupCount.X, GroupCount.Y, GroupOrigins.Num());
+			return false;
+		}
+	}
+
+	// without skipped groups the comparison above proves nothing
+	if (MinInpaintSkipped <= 0.0f || MinContrastSkipped <= 0.0f || MinCompositorSkipped <= 0.0f)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Tile classification FAILED. Synthetic data skipped no groups (inpaint %f, contrast %f, compositor %f)"), MinInpaintSkipped, MinContrastSkipped, MinCompositorSkipped);
+		return false;
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: Tile classification OK. Inpaint fill bit identical, skipping at least %.1f%% of groups. Contrast max error %f (tolerance %f), skipping at least %.1f%% of level 0 groups. ")
+		TEXT("Compositor max error %f (tolerance %f), skipping at least %.1f%% of groups. A list of %d entries ran each once"),
+		MinInpaintSkipped * 100.0f, MaxContrastError, ContrastTolerance, MinContrastSkipped * 100.0f, MaxCompositorError, CompositorTolerance, MinCompositorSkipped * 100.0f, NumLongListEntries);
+	return true;
+}
+
+void FVARIDReference::ReportTileSkipFractions(const FVARIDProfile& InProfile, const FIntPoint& InEyeSize, float InContrastThreshold, FString& OutReport)
+{
+	const int32 InpaintPassMipLevel = 3;	// must match BuildInpaintTexture_RenderThread
+	const int32 ContrastDilation = 4;	// must match BuildContrastTextureFused_RenderThread
+
+	// the same mip count as the render path, for a texture holding one eye
+	const int32 NumMips = FMath::Min((int32)FMath::Max(FMath::FloorLog2(InEyeSize.X), FMath::FloorLog2(InEyeSize.Y)), 10);
+	check(NumMips > 1);
+
+	const FIntRect ViewportRect(FIntPoint::ZeroValue, InEyeSize);
+
+	OutReport = FString::Printf(TEXT("VARID: Tile skip fractions for '%s' at %dx%d per eye"), *InProfile.Name, InEyeSize.X, InEyeSize.Y);
+
+	const FVARIDEye* Eyes[2] = { &InProfile.LeftEye, &InProfile.RightEye };
+	const TCHAR* EyeNames[2] = { TEXT("left"), TEXT("right") };
+
+	for (int32 EyeIndex = 0; EyeIndex < 2; ++EyeIndex)
+	{
+		const FVARIDEye& Eye = *Eyes[EyeIndex];
+
+		// contrast - level 0 of the fused reconstruct
+		TArray<FVARIDImage> ContrastVFMapMips;
+		AllocateMips(InEyeSize, NumMips, ContrastVFMapMips);
+		for (int32 MipLevel = 0; MipLevel < NumMips && MipLevel < Eye.Contrast.VFMaps.Num(); ++MipLevel)
+		{
+			EvaluateVFMap(Eye.Contrast.VFMaps[MipLevel], ViewportRect, MipLevel, ContrastVFMapMips[MipLevel]);
+		}
+
+		FVARIDTileLists ContrastTileLists;
+		ClassifyTiles(ContrastVFMapMips, ViewportRect, NumMips - 1, ContrastDilation, InContrastThreshold, ContrastTileLists);
+
+		// inpaint - fill passes at the pass mip level
+		FVARIDImage InpaintVFMap(InEyeSize);
+		EvaluateVFMap(Eye.Inpaint.VFMap, ViewportRect, 0, InpaintVFMap);
+
+		TArray<FVARIDImage> InpaintMaskMips;
+		InpaintMaskMips.AddZeroed();
+		DownsampleInpaintMask(InpaintVFMap, InpaintPassMipLevel, InpaintMaskMips[0]);
+
+		FVARIDTileLists InpaintTileLists;
+		ClassifyTiles(InpaintMaskMips, FIntRect(FIntPoint::ZeroValue, InpaintMaskMips[0].Size), 1, 0, MaskThreshold, InpaintTileLists);
+
+		OutReport += FString::Printf(TEXT("\n  %s eye: contrast skips %.1f%% of %d level 0 groups, inpaint skips %.1f%% of %d fill groups"),
+			EyeNames[EyeIndex],
+			ContrastTileLists.GetSkippedFraction() * 100.0f, ContrastTileLists.AffectedGroups.Num() + ContrastTileLists.UnaffectedGroups.Num(),
+			InpaintTileLists.GetSkippedFraction() * 100.0f, InpaintTileLists.AffectedGroups.Num() + InpaintTileLists.UnaffectedGroups.Num());
+	}
+}
+
+#endif
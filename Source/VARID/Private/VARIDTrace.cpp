@@ -0,0 +1,546 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDTrace.h"
+#include "VARIDBenchmark.h"
+#include "VARIDVFMapPointTable.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+
+const uint32 FVARIDTrace::Magic = 'V' | ('R' << 8) | ('T' << 16) | ('R' << 24);
+const uint32 FVARIDTrace::Version = 1;
+
+/** the bytes of one serialised point. A map claiming more points than the trace has bytes left is cut off, rather than allocated */
+static const int64 POINT_BYTES = 8 * sizeof(float);
+
+/** keeps the optimiser from dropping work whose result is otherwise unused */
+static volatile int64 GVARIDTraceSink = 0;
+
+FVARIDTraceEvent::FVARIDTraceEvent()
+	: FVARIDTraceEvent(EVARIDTraceEvent::EyeTracking, 0, 0.0f)
+{
+
+}
+
+FVARIDTraceEvent::FVARIDTraceEvent(EVARIDTraceEvent InType, uint32 InFrame, float InTime)
+{
+	Type = InType;
+	Frame = InFrame;
+	Time = InTime;
+	DisplayFOV = FVector2D::ZeroVector;
+	Value = 0;
+	Microseconds = 0.0f;
+}
+
+bool FVARIDTraceEvent::operator==(const FVARIDTraceEvent& Other) const
+{
+	return Type == Other.Type
+		&& Frame == Other.Frame
+		&& Time == Other.Time
+		&& EyeTracking == Other.EyeTracking
+		&& DisplayFOV == Other.DisplayFOV
+		&& Value == Other.Value
+		&& Microseconds == Other.Microseconds;
+}
+
+void FVARIDTrace::WriteHeader(FArchive& Ar)
+{
+	uint32 HeaderMagic = Magic;
+	uint32 HeaderVersion = Version;
+	Ar << HeaderMagic;
+	Ar << HeaderVersion;
+}
+
+static void SerialiseEventHeader(FArchive& Ar, uint8& InOutType, uint32& InOutFrame, float& InOutTime)
+{
+	Ar << InOutType;
+	Ar.SerializeIntPacked(InOutFrame);
+	Ar << InOutTime;
+}
+
+void FVARIDTrace::WriteEvent(FArchive& Ar, const FVARIDTraceEvent& InEvent)
+{
+	check(InEvent.Type != EVARIDTraceEvent::ProfileDefinition);
+
+	FVARIDTraceEvent Event = InEvent;
+	uint8 Type = (uint8)Event.Type;
+	SerialiseEventHeader(Ar, Type, Event.Frame, Event.Time);
+
+	switch (Event.Type)
+	{
+	case EVARIDTraceEvent::EyeTracking:
+		Ar << Event.EyeTracking.LeftEyeGazePoint;
+		Ar << Event.EyeTracking.RightEyeGazePoint;
+		break;
+	case EVARIDTraceEvent::ActiveProfile:
+	{
+		uint32 Index = (uint32)Event.Value;
+		Ar.SerializeIntPacked(Index);
+		break;
+	}
+	case EVARIDTraceEvent::FXEnabled:
+	{
+		uint8 FXEnabled = (uint8)Event.Value;
+		Ar << FXEnabled;
+		break;
+	}
+	case EVARIDTraceEvent::DisplayFOV:
+		Ar << Event.DisplayFOV;
+		break;
+	case EVARIDTraceEvent::StageTiming:
+	{
+		uint8 Stage = (uint8)Event.Value;
+		Ar << Stage;
+		Ar << Event.Microseconds;
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void FVARIDTrace::WriteProfileDefinition(FArchive& Ar, uint32 InFrame, float InTime, const TArray<uint8>& InProfileBytes)
+{
+	uint8 Type = (uint8)EVARIDTraceEvent::ProfileDefinition;
+	SerialiseEventHeader(Ar, Type, InFrame, InTime);
+	Ar.Serialize(const_cast<uint8*>(InProfileBytes.GetData()), InProfileBytes.Num());
+}
+
+static void SerialiseVFMap(FArchive& Ar, FVARIDVFMap& InOutVFMap)
+{
+	Ar << InOutVFMap.ExpectedNumDataPoints;
+	Ar << InOutVFMap.FullField;
+
+	// the Blueprint form, raw fields and all, so a trace reads back the same whether or not the raw points were kept
+	TArray<FVARIDVFMapPoint> Points;
+	if (!Ar.IsLoading())
+	{
+		InOutVFMap.Points.GetPoints(Points);
+	}
+
+	int32 NumPoints = Points.Num();
+	Ar << NumPoints;
+
+	if (Ar.IsLoading())
+	{
+		if (NumPoints < 0 || NumPoints * POINT_BYTES > Ar.TotalSize() - Ar.Tell())
+		{
+			Ar.SetError();
+			return;
+		}
+
+		Points.SetNum(NumPoints);
+	}
+
+	for (FVARIDVFMapPoint& Point : Points)
+	{
+		Ar << Point.RawX << Point.RawY << Point.RawValue << Point.Min << Point.Max << Point.NormX << Point.NormY << Point.NormValue;
+	}
+
+	if (Ar.IsLoading() && !Ar.IsError())
+	{
+		InOutVFMap.Points.SetPoints(Points);
+	}
+
+	bool bHasImage = InOutVFMap.Image.IsValid();
+	Ar << bHasImage;
+
+	if (bHasImage)
+	{
+		FString FilePath;
+		float Min = 0.0f;
+		float Max = 0.0f;
+		FVector2D NormMin;
+		FVector2D NormMax;
+
+		if (!Ar.IsLoading())
+		{
+			FilePath = InOutVFMap.Image->FilePath;
+			Min = InOutVFMap.Image->Min;
+			Max = InOutVFMap.Image->Max;
+			NormMin = InOutVFMap.Image->NormMin;
+			NormMax = InOutVFMap.Image->NormMax;
+		}
+
+		Ar << FilePath << Min << Max << NormMin << NormMax;
+
+		if (Ar.IsLoading() && !Ar.IsError())
+		{
+			InOutVFMap.Image = MakeShared<FVARIDVFMapImage, ESPMode::ThreadSafe>(FilePath, Min, Max, NormMin, NormMax);
+		}
+	}
+	else if (Ar.IsLoading())
+	{
+		InOutVFMap.Image.Reset();
+	}
+
+	// the same as a profile that has just been loaded
+	if (Ar.IsLoading() && !Ar.IsError())
+	{
+		InOutVFMap.ResetDerivedData();
+	}
+}
+
+void FVARIDTrace::SerialiseProfile(FArchive& Ar, FVARIDProfile& InOutProfile)
+{
+	Ar << InOutProfile.Name << InOutProfile.Description << InOutProfile.Author << InOutProfile.Date;
+	Ar << InOutProfile.IsValid;
+
+	uint8 FXEnabled = GetFXEnabled(InOutProfile);
+	Ar << FXEnabled;
+
+	for (FVARIDEye* Eye : { &InOutProfile.LeftEye, &InOutProfile.RightEye })
+	{
+		SerialiseVFMap(Ar, Eye->Blur.VFMap);
+
+		int32 NumContrastVFMaps = Eye->Contrast.VFMaps.Num();
+		Ar << NumContrastVFMaps;
+
+		if (Ar.IsLoading())
+		{
+			// LoadProfile() always gives 10
+			if (NumContrastVFMaps < 0 || NumContrastVFMaps > 64)
+			{
+				Ar.SetError();
+				return;
+			}
+
+			Eye->Contrast.VFMaps.SetNum(NumContrastVFMaps);
+		}
+
+		for (FVARIDVFMap& VFMap : Eye->Contrast.VFMaps)
+		{
+			SerialiseVFMap(Ar, VFMap);
+		}
+
+		SerialiseVFMap(Ar, Eye->Inpaint.VFMap);
+		SerialiseVFMap(Ar, Eye->Warp.VFMap);
+
+		if (Ar.IsError())
+		{
+			return;
+		}
+	}
+
+	if (Ar.IsLoading())
+	{
+		SetFXEnabled(InOutProfile, FXEnabled);
+	}
+}
+
+bool FVARIDTrace::Parse(const TArray<uint8>& InBytes, FVARIDTrace& OutTrace)
+{
+	OutTrace.Events.Empty();
+	OutTrace.Profiles.Empty();
+
+	FMemoryReader Ar(InBytes);
+
+	uint32 HeaderMagic = 0;
+	uint32 HeaderVersion = 0;
+	Ar << HeaderMagic;
+	Ar << HeaderVersion;
+
+	if (Ar.IsError() || HeaderMagic != Magic)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Not a VARID trace"));
+		return false;
+	}
+
+	if (HeaderVersion != Version)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Trace is version %u. Expected version %u"), HeaderVersion, Version);
+		return false;
+	}
+
+	while (!Ar.AtEnd())
+	{
+		uint8 Type = 0;
+		FVARIDTraceEvent Event;
+		SerialiseEventHeader(Ar, Type, Event.Frame, Event.Time);
+		Event.Type = (EVARIDTraceEvent)Type;
+
+		switch (Event.Type)
+		{
+		case EVARIDTraceEvent::EyeTracking:
+			Ar << Event.EyeTracking.LeftEyeGazePoint;
+			Ar << Event.EyeTracking.RightEyeGazePoint;
+			break;
+		case EVARIDTraceEvent::ProfileDefinition:
+			SerialiseProfile(Ar, OutTrace.Profiles.AddDefaulted_GetRef());
+			break;
+		case EVARIDTraceEvent::ActiveProfile:
+		{
+			uint32 Index = 0;
+			Ar.SerializeIntPacked(Index);
+			Event.Value = (int32)Index;
+
+			if (!OutTrace.Profiles.IsValidIndex(Event.Value))
+			{
+				UE_LOG(LogTemp, Error, TEXT("VARID: Trace activates profile %u before it is defined"), Index);
+				return false;
+			}
+			break;
+		}
+		case EVARIDTraceEvent::FXEnabled:
+		{
+			uint8 FXEnabled = 0;
+			Ar << FXEnabled;
+			Event.Value = FXEnabled;
+			break;
+		}
+		case EVARIDTraceEvent::DisplayFOV:
+			Ar << Event.DisplayFOV;
+			break;
+		case EVARIDTraceEvent::StageTiming:
+		{
+			uint8 Stage = 0;
+			Ar << Stage;
+			Ar << Event.Microseconds;
+			Event.Value = Stage;
+			break;
+		}
+		default:
+			UE_LOG(LogTemp, Error, TEXT("VARID: Trace has an unknown event %u at byte %lld"), Type, Ar.Tell());
+			return false;
+		}
+
+		// e.g. the session crashed before the last write. What was written before it still replays
+		if (Ar.IsError())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("VARID: Trace is cut off after %d events. The rest is ignored"), OutTrace.Events.Num());
+
+			if (Event.Type == EVARIDTraceEvent::ProfileDefinition)
+			{
+				OutTrace.Profiles.Pop();
+			}
+			break;
+		}
+
+		if (Event.Type != EVARIDTraceEvent::ProfileDefinition)
+		{
+			OutTrace.Events.Add(Event);
+		}
+	}
+
+	return true;
+}
+
+bool FVARIDTrace::Load(const FString& InFilePath, FVARIDTrace& OutTrace)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *InFilePath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Could not read trace: %s"), *InFilePath);
+		return false;
+	}
+
+	if (!Parse(Bytes, OutTrace))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Could not parse trace: %s"), *InFilePath);
+		return false;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("VARID: Loaded trace of %d events, %d profiles and %u frames: %s"), OutTrace.Events.Num(), OutTrace.Profiles.Num(), OutTrace.GetNumFrames(), *InFilePath);
+	return true;
+}
+
+uint8 FVARIDTrace::GetFXEnabled(FVARIDProfile& InProfile)
+{
+	uint8 FXEnabled = 0;
+
+	for (FVARIDFX* FX : InProfile.GetFX())
+	{
+		if (FX->Enabled && FX->ID >= 0 && FX->ID < 8)
+		{
+			FXEnabled |= 1 << FX->ID;
+		}
+	}
+
+	return FXEnabled;
+}
+
+void FVARIDTrace::SetFXEnabled(FVARIDProfile& InOutProfile, uint8 InFXEnabled)
+{
+	for (FVARIDFX* FX : InOutProfile.GetFX())
+	{
+		if (FX->ID >= 0 && FX->ID < 8)
+		{
+			FX->Enabled = (InFXEnabled & (1 << FX->ID)) != 0;
+		}
+	}
+}
+
+const TCHAR* FVARIDTrace::GetStageName(EVARIDTraceStage InStage)
+{
+	switch (InStage)
+	{
+	case EVARIDTraceStage::Marshal:
+		return TEXT("Marshal");
+	case EVARIDTraceStage::BuildPasses:
+		return TEXT("BuildPasses");
+	case EVARIDTraceStage::GPUPasses:
+		return TEXT("GPUPasses");
+	default:
+		return TEXT("Unknown");
+	}
+}
+
+uint32 FVARIDTrace::GetNumFrames() const
+{
+	return Events.Num() > 0 ? Events.Last().Frame + 1 : 0;
+}
+
+void FVARIDTrace::GetStageTimings(TArray<FVARIDBenchmarkResult>& OutResults) const
+{
+	TArray<double> Samples[(int32)EVARIDTraceStage::Num];
+
+	for (const FVARIDTraceEvent& Event : Events)
+	{
+		if (Event.Type == EVARIDTraceEvent::StageTiming && Event.Value < (int32)EVARIDTraceStage::Num)
+		{
+			Samples[Event.Value].Add(Event.Microseconds);
+		}
+	}
+
+	for (int32 Stage = 0; Stage < (int32)EVARIDTraceStage::Num; ++Stage)
+	{
+		if (Samples[Stage].Num() > 0)
+		{
+			OutResults.Add(FVARIDBenchmark::Summarise(TEXT("Trace"), GetStageName((EVARIDTraceStage)Stage), Samples[Stage]));
+		}
+	}
+}
+
+void FVARIDTrace::ReplayCPU(TArray<FVARIDBenchmarkResult>& OutResults) const
+{
+	FVARIDProfile Profile;
+	FVARIDEyeTracking EyeTracking;
+
+	TArray<double> MarshalSamples;
+	TArray<double> PackSamples;
+
+	int32 NextEvent = 0;
+	const uint32 NumFrames = GetNumFrames();
+
+	for (uint32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		/*************************************************************/
+		// the inputs of the frame, in the order they were recorded
+
+		for (; NextEvent < Events.Num() && Events[NextEvent].Frame <= Frame; ++NextEvent)
+		{
+			const FVARIDTraceEvent& Event = Events[NextEvent];
+
+			switch (Event.Type)
+			{
+			case EVARIDTraceEvent::EyeTracking:
+				EyeTracking = Event.EyeTracking;
+				break;
+			case EVARIDTraceEvent::ActiveProfile:
+				Profile = FVARIDProfile(Profiles[Event.Value]);
+				break;
+			case EVARIDTraceEvent::FXEnabled:
+				SetFXEnabled(Profile, (uint8)Event.Value);
+				break;
+			default:
+				// the display FOV only matters to profiles loaded after it changed, and those are in the trace already normalised
+				break;
+			}
+		}
+
+		if (!Profile.IsValid)
+		{
+			continue;
+		}
+
+		/*************************************************************/
+		// the CPU work of the frame
+
+		double StartTime = FPlatformTime::Seconds();
+		{
+			const FVARIDProfile RenderThreadProfile(Profile);
+			const FVARIDEyeTracking RenderThreadEyeTracking(EyeTracking);
+			GVARIDTraceSink += RenderThreadProfile.LeftEye.Blur.VFMap.Points.Num() + (RenderThreadEyeTracking.LeftEyeGazePoint.X > 0.0f ? 1 : 0);
+		}
+		MarshalSamples.Add((FPlatformTime::Seconds() - StartTime) * 1e6);
+
+		StartTime = FPlatformTime::Seconds();
+		{
+			TArray<FShaderParameterMapPoint> FilteredPoints;
+			const FVARIDEye* Eyes[2] = { &Profile.LeftEye, &Profile.RightEye };
+			const FVector2D GazePoints[2] = { EyeTracking.LeftEyeGazePoint, EyeTracking.RightEyeGazePoint };
+
+			for (int32 EyeIndex = 0; EyeIndex < 2; ++EyeIndex)
+			{
+				const FVARIDEye& Eye = *Eyes[EyeIndex];
+				TArray<const FVARIDVFMap*> VFMaps;
+
+				if (Eye.Blur.Enabled)
+				{
+					VFMaps.Add(&Eye.Blur.VFMap);
+				}
+
+				if (Eye.Contrast.Enabled)
+				{
+					for (const FVARIDVFMap& VFMap : Eye.Contrast.VFMaps)
+					{
+						VFMaps.Add(&VFMap);
+					}
+				}
+
+				if (Eye.Inpaint.Enabled)
+				{
+					VFMaps.Add(&Eye.Inpaint.VFMap);
+				}
+
+				if (Eye.Warp.Enabled)
+				{
+					VFMaps.Add(&Eye.Warp.VFMap);
+				}
+
+				for (const FVARIDVFMap* VFMap : VFMaps)
+				{
+					if (!VFMap->FullField)
+					{
+						FVARIDVFMapPointTable::AddShaderPoints(VFMap->Points, 0.5f, EyeIndex * 0.5f, GazePoints[EyeIndex], FilteredPoints);
+					}
+				}
+			}
+
+			GVARIDTraceSink += FilteredPoints.Num();
+		}
+		PackSamples.Add((FPlatformTime::Seconds() - StartTime) * 1e6);
+	}
+
+	const FString Case = FString::Printf(TEXT("%d of %u frames"), MarshalSamples.Num(), NumFrames);
+	OutResults.Add(FVARIDBenchmark::Summarise(TEXT("TraceReplay"), FString::Printf(TEXT("Marshal, %s"), *Case), MarshalSamples));
+	OutResults.Add(FVARIDBenchmark::Summarise(TEXT("TraceReplay"), FString::Printf(TEXT("PackShaderPoints, %s"), *Case), PackSamples));
+}
+
+bool FVARIDTrace::ReplayCPUAndSave(const FString& InTracePath, const FString& InOutputPath, FString& OutOutputPath)
+{
+	OutOutputPath = InOutputPath.IsEmpty() ? FPaths::ChangeExtension(InTracePath, TEXT("json")) : InOutputPath;
+
+	FVARIDTrace Trace;
+	if (!Load(InTracePath, Trace))
+	{
+		return false;
+	}
+
+	TArray<FVARIDBenchmarkResult> Results;
+	Trace.GetStageTimings(Results);
+	Trace.ReplayCPU(Results);
+
+	if (!FFileHelper::SaveStringToFile(FVARIDBenchmark::ToJson(Results), *OutOutputPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Could not save the trace replay results to %s"), *OutOutputPath);
+		return false;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("VARID: Saved %d trace replay results to %s"), Results.Num(), *OutOutputPath);
+	return true;
+}
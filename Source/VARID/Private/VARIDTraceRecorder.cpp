@@ -0,0 +1,288 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDTraceRecorder.h"
+#include "Async/Async.h"
+#include "CoreGlobals.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Crc.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/MemoryWriter.h"
+
+/** the buffer is written once it holds this much, or FLUSH_SECONDS after the last write, whichever is first */
+static const int32 FLUSH_BYTES = 64 * 1024;
+static const double FLUSH_SECONDS = 1.0;
+
+TSharedPtr<FVARIDTraceRecorder, ESPMode::ThreadSafe> FVARIDTraceRecorder::Begin(const FString& InFilePath)
+{
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(InFilePath), true);
+
+	FArchive* File = IFileManager::Get().CreateFileWriter(*InFilePath);
+	if (!File)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Could not open trace for writing: %s"), *InFilePath);
+		return nullptr;
+	}
+
+	TSharedPtr<FVARIDTraceRecorder, ESPMode::ThreadSafe> Recorder = MakeShareable(new FVARIDTraceRecorder(InFilePath, File));
+
+	{
+		FScopeLock Lock(&Recorder->BufferLock);
+		FMemoryWriter Ar(Recorder->Buffer, false, true);
+		FVARIDTrace::WriteHeader(Ar);
+		Recorder->NumBytes = Recorder->Buffer.Num();
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("VARID: Recording trace to %s"), *InFilePath);
+	return Recorder;
+}
+
+FVARIDTraceRecorder::FVARIDTraceRecorder(const FString& InFilePath, FArchive* InFile)
+	: FilePath(InFilePath)
+	, StartFrameNumber(GFrameNumber)
+	, StartSeconds(FPlatformTime::Seconds())
+	, LastFlushSeconds(StartSeconds)
+	, NumBytes(0)
+	, bEnded(false)
+	, File(InFile)
+{
+
+}
+
+FVARIDTraceRecorder::~FVARIDTraceRecorder()
+{
+	End();
+}
+
+bool FVARIDTraceRecorder::Stamp(uint32 InFrameNumber, uint32& OutFrame, float& OutTime) const
+{
+	if (InFrameNumber < StartFrameNumber)
+	{
+		return false;
+	}
+
+	OutFrame = InFrameNumber - StartFrameNumber;
+	OutTime = (float)(FPlatformTime::Seconds() - StartSeconds);
+	return true;
+}
+
+void FVARIDTraceRecorder::RecordEyeTracking(const FVARIDEyeTracking& InEyeTracking)
+{
+	FVARIDTraceEvent Event;
+	if (Stamp(GFrameNumber, Event.Frame, Event.Time))
+	{
+		Event.Type = EVARIDTraceEvent::EyeTracking;
+		Event.EyeTracking = InEyeTracking;
+		AddEvent(Event);
+	}
+}
+
+void FVARIDTraceRecorder::RecordActiveProfile(const FVARIDProfile& InProfile)
+{
+	FVARIDTraceEvent Event;
+	if (!Stamp(GFrameNumber, Event.Frame, Event.Time))
+	{
+		return;
+	}
+
+	// serialised outside the lock. The profile is only written the first time
+	TArray<uint8> Bytes;
+	{
+		FVARIDProfile Profile(InProfile);
+		FMemoryWriter Ar(Bytes);
+		FVARIDTrace::SerialiseProfile(Ar, Profile);
+	}
+
+	const uint32 Crc = FCrc::MemCrc32(Bytes.GetData(), Bytes.Num());
+
+	FScopeLock Lock(&BufferLock);
+
+	if (bEnded)
+	{
+		return;
+	}
+
+	const int32 PreviousNum = Buffer.Num();
+
+	const int32* FoundIndex = ProfileIndices.Find(Crc);
+	if (FoundIndex && ProfileBytes[*FoundIndex] == Bytes)
+	{
+		Event.Value = *FoundIndex;
+	}
+	else
+	{
+		Event.Value = ProfileBytes.Num();
+		ProfileIndices.Add(Crc, Event.Value);
+
+		FMemoryWriter Ar(Buffer, false, true);
+		FVARIDTrace::WriteProfileDefinition(Ar, Event.Frame, Event.Time, Bytes);
+		ProfileBytes.Add(MoveTemp(Bytes));
+	}
+
+	Event.Type = EVARIDTraceEvent::ActiveProfile;
+
+	{
+		FMemoryWriter Ar(Buffer, false, true);
+		FVARIDTrace::WriteEvent(Ar, Event);
+	}
+	NumBytes += Buffer.Num() - PreviousNum;
+
+	FlushBuffer(false);
+}
+
+void FVARIDTraceRecorder::RecordFXEnabled(uint8 InFXEnabled)
+{
+	FVARIDTraceEvent Event;
+	if (Stamp(GFrameNumber, Event.Frame, Event.Time))
+	{
+		Event.Type = EVARIDTraceEvent::FXEnabled;
+		Event.Value = InFXEnabled;
+		AddEvent(Event);
+	}
+}
+
+void FVARIDTraceRecorder::RecordDisplayFOV(const FVector2D& InDisplayFOV)
+{
+	FVARIDTraceEvent Event;
+	if (Stamp(GFrameNumber, Event.Frame, Event.Time))
+	{
+		Event.Type = EVARIDTraceEvent::DisplayFOV;
+		Event.DisplayFOV = InDisplayFOV;
+		AddEvent(Event);
+	}
+}
+
+void FVARIDTraceRecorder::RecordStageTiming(uint32 InFrameNumber, EVARIDTraceStage InStage, float InMicroseconds)
+{
+	FVARIDTraceEvent Event;
+	if (Stamp(InFrameNumber, Event.Frame, Event.Time))
+	{
+		Event.Type = EVARIDTraceEvent::StageTiming;
+		Event.Value = (int32)InStage;
+		Event.Microseconds = InMicroseconds;
+		AddEvent(Event);
+	}
+}
+
+void FVARIDTraceRecorder::AddEvent(const FVARIDTraceEvent& InEvent)
+{
+	FScopeLock Lock(&BufferLock);
+
+	if (bEnded)
+	{
+		return;
+	}
+
+	const int32 PreviousNum = Buffer.Num();
+	{
+		FMemoryWriter Ar(Buffer, false, true);
+		FVARIDTrace::WriteEvent(Ar, InEvent);
+	}
+	NumBytes += Buffer.Num() - PreviousNum;
+
+	FlushBuffer(false);
+}
+
+void FVARIDTraceRecorder::FlushBuffer(bool bInForce)
+{
+	const double Now = FPlatformTime::Seconds();
+
+	if (Buffer.Num() == 0 || (!bInForce && Buffer.Num() < FLUSH_BYTES && Now - LastFlushSeconds < FLUSH_SECONDS))
+	{
+		return;
+	}
+
+	LastFlushSeconds = Now;
+
+	Chunks.Add(MoveTemp(Buffer));
+	Buffer.Reset(FLUSH_BYTES);
+
+	// queued under the same lock the buffer was taken in, so the chunks are in the order they were recorded whichever write runs first
+	Writes.RemoveAll([](const TFuture<void>& Write) { return Write.IsReady(); });
+	Writes.Add(Async(EAsyncExecution::ThreadPool, [this]() { WriteChunks(); }));
+}
+
+void FVARIDTraceRecorder::WriteChunks()
+{
+	FScopeLock FileScopeLock(&FileLock);
+
+	while (true)
+	{
+		TArray<uint8> Chunk;
+		{
+			FScopeLock BufferScopeLock(&BufferLock);
+
+			if (Chunks.Num() == 0)
+			{
+				break;
+			}
+
+			Chunk = MoveTemp(Chunks[0]);
+			Chunks.RemoveAt(0);
+		}
+
+		if (File)
+		{
+			File->Serialize(Chunk.GetData(), Chunk.Num());
+		}
+	}
+
+	if (File)
+	{
+		File->Flush();
+	}
+}
+
+void FVARIDTraceRecorder::End()
+{
+	TArray<TFuture<void>> PendingWrites;
+	{
+		FScopeLock Lock(&BufferLock);
+
+		if (bEnded)
+		{
+			return;
+		}
+
+		FlushBuffer(true);
+		bEnded = true;
+		PendingWrites = MoveTemp(Writes);
+	}
+
+	for (TFuture<void>& Write : PendingWrites)
+	{
+		Write.Wait();
+	}
+
+	FScopeLock Lock(&FileLock);
+
+	if (File)
+	{
+		const bool bWritten = File->Close();
+		File.Reset();
+
+		if (bWritten)
+		{
+			UE_LOG(LogTemp, Display, TEXT("VARID: Recorded trace of %lld bytes to %s"), NumBytes, *FilePath);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("VARID: Could not write trace: %s"), *FilePath);
+		}
+	}
+}
+
+const FString& FVARIDTraceRecorder::GetFilePath() const
+{
+	return FilePath;
+}
+
+int64 FVARIDTraceRecorder::GetNumBytes() const
+{
+	FScopeLock Lock(&BufferLock);
+	return NumBytes;
+}
@@ -0,0 +1,300 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "VARIDTrace.h"
+#include "VARIDBenchmark.h"
+#include "Math/RandomStream.h"
+#include "Serialization/MemoryWriter.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// the trace format FVARIDTraceRecorder writes and the CPU replay of it. A recording cut off by a crash must still give the events before
+// the cut, and the replay has to step through the frames as they were recorded
+
+/** the same points, values, FX and image in two profiles, and the mesh rebuilt to the same triangles */
+static bool IsSameTracedProfile(FVARIDProfile& InA, FVARIDProfile& InB)
+{
+	if (InA.Name != InB.Name || InA.IsValid != InB.IsValid || FVARIDTrace::GetFXEnabled(InA) != FVARIDTrace::GetFXEnabled(InB))
+	{
+		return false;
+	}
+
+	TArray<FVARIDVFMap*> VFMapsA = InA.GetVFMaps();
+	TArray<FVARIDVFMap*> VFMapsB = InB.GetVFMaps();
+
+	if (VFMapsA.Num() != VFMapsB.Num())
+	{
+		return false;
+	}
+
+	for (int32 i = 0; i < VFMapsA.Num(); ++i)
+	{
+		const FVARIDVFMap& A = *VFMapsA[i];
+		const FVARIDVFMap& B = *VFMapsB[i];
+
+		if (A.FullField != B.FullField || A.ExpectedNumDataPoints != B.ExpectedNumDataPoints || A.Points.Num() != B.Points.Num()
+			|| A.GetMesh()->Indices.Num() != B.GetMesh()->Indices.Num() || A.Image.IsValid() != B.Image.IsValid())
+		{
+			return false;
+		}
+
+		for (int32 Point = 0; Point < A.Points.Num(); ++Point)
+		{
+			const FVARIDVFMapPoint PA = A.Points.GetPoint(Point);
+			const FVARIDVFMapPoint PB = B.Points.GetPoint(Point);
+
+			if (PA.RawX != PB.RawX || PA.RawY != PB.RawY || PA.RawValue != PB.RawValue || PA.Min != PB.Min || PA.Max != PB.Max
+				|| PA.NormX != PB.NormX || PA.NormY != PB.NormY || PA.NormValue != PB.NormValue)
+			{
+				return false;
+			}
+		}
+
+		if (A.Image.IsValid() && (A.Image->FilePath != B.Image->FilePath || A.Image->Min != B.Image->Min || A.Image->NormMax != B.Image->NormMax))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool FVARIDReference::ValidateTrace(FString& OutReport)
+{
+	const uint32 NumFrames = 600;
+
+	/*************************************************************/
+	// two profiles: points, a full field map and an image map
+
+	FRandomStream RandomStream(4444);
+
+	TArray<FVARIDProfile> Profiles;
+	Profiles.SetNum(2);
+
+	for (int32 ProfileIndex = 0; ProfileIndex < Profiles.Num(); ++ProfileIndex)
+	{
+		FVARIDProfile& Profile = Profiles[ProfileIndex];
+		Profile.Name = FString::Printf(TEXT("Trace%d"), ProfileIndex);
+		Profile.IsValid = true;
+
+		for (FVARIDEye* Eye : { &Profile.LeftEye, &Profile.RightEye })
+		{
+			Eye->Contrast.VFMaps.SetNum(10);
+
+			for (FVARIDVFMap* VFMap : { &Eye->Blur.VFMap, &Eye->Contrast.VFMaps[ProfileIndex * 3] })
+			{
+				VFMap->ExpectedNumDataPoints = 20 + ProfileIndex * 10;
+				TArray<FVARIDVFMapPoint> Points;
+				for (int32 i = 0; i < VFMap->ExpectedNumDataPoints; ++i)
+				{
+					Points.Add(FVARIDVFMapPoint(RandomStream.FRandRange(-50.0f, 50.0f), RandomStream.FRandRange(-50.0f, 50.0f), RandomStream.FRandRange(0.0f, 33.0f), 0.0f, 33.0f, RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand()));
+				}
+				VFMap->Points.SetPoints(Points);
+			}
+
+			Eye->Inpaint.VFMap.FullField = true;
+			Eye->Inpaint.VFMap.Points.SetPoints({ FVARIDVFMapPoint(0.0f, 0.0f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f) });
+
+			Eye->Warp.VFMap.Image = MakeShared<FVARIDVFMapImage, ESPMode::ThreadSafe>(TEXT("Trace/warp.png"), -1.0f, 1.0f, FVector2D(0.1f, 0.2f), FVector2D(0.9f, 0.8f));
+		}
+
+		for (FVARIDVFMap* VFMap : Profile.GetVFMaps())
+		{
+			VFMap->ResetDerivedData();
+		}
+	}
+
+	Profiles[1].RightEye.Contrast.Enabled = false;
+
+	/*************************************************************/
+	// a session as the recorder writes it: the state it starts in, a gaze sample and the stage timings every frame, FX toggles and profile changes
+
+	TArray<FVARIDTraceEvent> ExpectedEvents;
+	TArray<uint8> Bytes;
+	int32 NumGazeBytes = 0;
+	{
+		FMemoryWriter Ar(Bytes);
+		FVARIDTrace::WriteHeader(Ar);
+
+		auto Write = [&Ar, &ExpectedEvents](const FVARIDTraceEvent& InEvent)
+		{
+			FVARIDTrace::WriteEvent(Ar, InEvent);
+			ExpectedEvents.Add(InEvent);
+		};
+
+		auto Activate = [&Ar, &Write, &Profiles](uint32 InFrame, float InTime, int32 InIndex, bool bInDefine)
+		{
+			if (bInDefine)
+			{
+				TArray<uint8> ProfileBytes;
+				FMemoryWriter ProfileAr(ProfileBytes);
+				FVARIDTrace::SerialiseProfile(ProfileAr, Profiles[InIndex]);
+				FVARIDTrace::WriteProfileDefinition(Ar, InFrame, InTime, ProfileBytes);
+			}
+
+			FVARIDTraceEvent Event(EVARIDTraceEvent::ActiveProfile, InFrame, InTime);
+			Event.Value = InIndex;
+			Write(Event);
+		};
+
+		FVARIDTraceEvent DisplayFOVEvent(EVARIDTraceEvent::DisplayFOV, 0, 0.0f);
+		DisplayFOVEvent.DisplayFOV = FVector2D(100.0f, 90.0f);
+		Write(DisplayFOVEvent);
+
+		Activate(0, 0.0f, 0, true);
+
+		for (uint32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			const float Time = Frame / 90.0f;
+
+			FVARIDTraceEvent GazeEvent(EVARIDTraceEvent::EyeTracking, Frame, Time);
+			GazeEvent.EyeTracking.LeftEyeGazePoint = FVector2D(RandomStream.FRandRange(-0.2f, 0.2f), RandomStream.FRandRange(-0.2f, 0.2f));
+			GazeEvent.EyeTracking.RightEyeGazePoint = GazeEvent.EyeTracking.LeftEyeGazePoint + FVector2D(0.01f, 0.0f);
+
+			const int64 GazeStart = Ar.Tell();
+			Write(GazeEvent);
+			NumGazeBytes = Ar.Tell() - GazeStart;
+
+			if (Frame == 100)
+			{
+				FVARIDTraceEvent FXEvent(EVARIDTraceEvent::FXEnabled, Frame, Time);
+				FXEvent.Value = 0x5a;
+				Write(FXEvent);
+			}
+
+			if (Frame == 200)
+			{
+				Activate(Frame, Time, 1, true);
+			}
+
+			if (Frame == 400)
+			{
+				// the same profile again is only its index
+				Activate(Frame, Time, 0, false);
+			}
+
+			for (int32 Stage = 0; Stage < (int32)EVARIDTraceStage::Num; ++Stage)
+			{
+				FVARIDTraceEvent TimingEvent(EVARIDTraceEvent::StageTiming, Frame, Time);
+				TimingEvent.Value = Stage;
+				TimingEvent.Microseconds = RandomStream.FRandRange(10.0f, 500.0f);
+				Write(TimingEvent);
+			}
+		}
+	}
+
+	/*************************************************************/
+	// parse it back
+
+	FVARIDTrace Trace;
+	if (!FVARIDTrace::Parse(Bytes, Trace))
+	{
+		OutReport = TEXT("VARID: Trace FAILED. The encoded trace did not parse");
+		return false;
+	}
+
+	if (Trace.Events.Num() != ExpectedEvents.Num() || Trace.Profiles.Num() != Profiles.Num())
+	{
+		OutReport = FString::Printf(TEXT("VARID: Trace FAILED. Parsed %d events and %d profiles. Expected %d and %d"), Trace.Events.Num(), Trace.Profiles.Num(), ExpectedEvents.Num(), Profiles.Num());
+		return false;
+	}
+
+	for (int32 i = 0; i < ExpectedEvents.Num(); ++i)
+	{
+		if (!(Trace.Events[i] == ExpectedEvents[i]))
+		{
+			OutReport = FString::Printf(TEXT("VARID: Trace FAILED. Event %d (type %d, frame %u) did not parse to what was written"), i, (int32)ExpectedEvents[i].Type, ExpectedEvents[i].Frame);
+			return false;
+		}
+	}
+
+	for (int32 i = 0; i < Profiles.Num(); ++i)
+	{
+		if (!IsSameTracedProfile(Trace.Profiles[i], Profiles[i]))
+		{
+			OutReport = FString::Printf(TEXT("VARID: Trace FAILED. Profile %d did not parse to what was written"), i);
+			return false;
+		}
+	}
+
+	if (Trace.GetNumFrames() != NumFrames)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Trace FAILED. The trace has %u frames. Expected %u"), Trace.GetNumFrames(), NumFrames);
+		return false;
+	}
+
+	/*************************************************************/
+	// a trace cut off by a crash, and files that aren't traces
+
+	{
+		TArray<uint8> CutBytes = Bytes;
+		CutBytes.SetNum(CutBytes.Num() - 2);
+
+		FVARIDTrace CutTrace;
+		if (!FVARIDTrace::Parse(CutBytes, CutTrace) || CutTrace.Events.Num() != ExpectedEvents.Num() - 1)
+		{
+			OutReport = TEXT("VARID: Trace FAILED. A trace cut off part way through its last event did not give the events before it");
+			return false;
+		}
+
+		TArray<uint8> BadMagic = Bytes;
+		BadMagic[0] ^= 0xff;
+
+		TArray<uint8> Empty;
+
+		if (FVARIDTrace::Parse(BadMagic, CutTrace) || FVARIDTrace::Parse(Empty, CutTrace))
+		{
+			OutReport = TEXT("VARID: Trace FAILED. Parsed a file without the trace header");
+			return false;
+		}
+	}
+
+	/*************************************************************/
+	// FX bits
+
+	{
+		FVARIDProfile Profile;
+		FVARIDTrace::SetFXEnabled(Profile, 0x5a);
+		Profile.ToggleFX(0);
+
+		if (FVARIDTrace::GetFXEnabled(Profile) != 0x5b || Profile.LeftEye.Blur.Enabled != true || Profile.LeftEye.Contrast.Enabled != true || Profile.LeftEye.Inpaint.Enabled != false)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Trace FAILED. FX bits 0x5a toggled at ID 0 gave 0x%02x"), FVARIDTrace::GetFXEnabled(Profile));
+			return false;
+		}
+	}
+
+	/*************************************************************/
+	// the CPU replay steps through every frame, with the recorded timings alongside
+
+	TArray<FVARIDBenchmarkResult> Results;
+	Trace.GetStageTimings(Results);
+	Trace.ReplayCPU(Results);
+
+	if (Results.Num() != (int32)EVARIDTraceStage::Num + 2)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Trace FAILED. Expected %d results from the stage timings and the CPU replay. Got %d"), (int32)EVARIDTraceStage::Num + 2, Results.Num());
+		return false;
+	}
+
+	for (const FVARIDBenchmarkResult& Result : Results)
+	{
+		if (Result.NumIterations != (int32)NumFrames)
+		{
+			OutReport = FString::Printf(TEXT("VARID: Trace FAILED. %s (%s) has %d samples. Expected one per frame, %u"), *Result.Name, *Result.Case, Result.NumIterations, NumFrames);
+			return false;
+		}
+	}
+
+	const FVARIDBenchmarkResult& MarshalResult = Results[(int32)EVARIDTraceStage::Num];
+	const FVARIDBenchmarkResult& PackResult = Results[(int32)EVARIDTraceStage::Num + 1];
+
+	OutReport = FString::Printf(TEXT("VARID: Trace OK. %d events and %d profiles in %d bytes, %d bytes per gaze sample. CPU replay of %u frames: marshal median %.2f us, pack shader points median %.2f us"),
+		Trace.Events.Num(), Trace.Profiles.Num(), Bytes.Num(), NumGazeBytes, NumFrames, MarshalResult.MedianMicroseconds, PackResult.MedianMicroseconds);
+	return true;
+}
+
+#endif
@@ -0,0 +1,32 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDTraceReplayCommandlet.h"
+#include "VARIDTrace.h"
+#include "Misc/Parse.h"
+
+UVARIDTraceReplayCommandlet::UVARIDTraceReplayCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UVARIDTraceReplayCommandlet::Main(const FString& Params)
+{
+	FString TracePath;
+	if (!FParse::Value(*Params, TEXT("trace="), TracePath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VARID: Give the trace to replay with -trace=<file>"));
+		return 1;
+	}
+
+	FString OutputPath;
+	FParse::Value(*Params, TEXT("output="), OutputPath);
+
+	FString SavedPath;
+	return FVARIDTrace::ReplayCPUAndSave(TracePath, OutputPath, SavedPath) ? 0 : 1;
+}
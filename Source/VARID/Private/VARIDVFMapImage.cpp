@@ -0,0 +1,187 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDVFMapImage.h"
+#include "Async/Async.h"
+
+FVARIDVFMapImagePixels::FVARIDVFMapImagePixels()
+{
+	Size = FIntPoint(0, 0);
+	bUnitRange = true;
+}
+
+FVARIDVFMapImage::FVARIDVFMapImage(const FString& InFilePath, float InMin, float InMax, const FVector2D& InNormMin, const FVector2D& InNormMax)
+	: FilePath(InFilePath)
+	, Min(InMin)
+	, Max(InMax)
+	, NormMin(InNormMin)
+	, NormMax(InNormMax)
+	, State(EVARIDVFMapImageState::NotLoaded)
+{
+}
+
+FVARIDVFMapImage::~FVARIDVFMapImage()
+{
+	WaitForLoad();
+}
+
+void FVARIDVFMapImage::BeginLoad(FVARIDDecodeVFMapImage InDecode)
+{
+	EVARIDVFMapImageState Expected = EVARIDVFMapImageState::NotLoaded;
+	if (!State.CompareExchange(Expected, EVARIDVFMapImageState::Loading))
+	{
+		return;
+	}
+
+	// Mips is only written here, before State says Loaded
+	LoadTask = Async(EAsyncExecution::ThreadPool, [this, Decode = MoveTemp(InDecode)]()
+	{
+		FVARIDVFMapImagePixels Pixels;
+		if (!Decode(FilePath, Pixels) || !BuildMips(Pixels, Min, Max, Mips))
+		{
+			UE_LOG(LogTemp, Error, TEXT("VARID: Could not load VF map image: %s"), *FilePath);
+			Mips.Empty();
+			State = EVARIDVFMapImageState::Failed;
+			return;
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("VARID: Loaded VF map image %s (%dx%d, %d mips)"), *FilePath, Pixels.Size.X, Pixels.Size.Y, Mips.Num());
+		State = EVARIDVFMapImageState::Loaded;
+	});
+}
+
+void FVARIDVFMapImage::WaitForLoad()
+{
+	if (LoadTask.IsValid())
+	{
+		LoadTask.Wait();
+	}
+}
+
+EVARIDVFMapImageState FVARIDVFMapImage::GetState() const
+{
+	return State;
+}
+
+bool FVARIDVFMapImage::IsLoaded() const
+{
+	return State == EVARIDVFMapImageState::Loaded;
+}
+
+const TArray<FVARIDVFMapImageMip>& FVARIDVFMapImage::GetMips() const
+{
+	return Mips;
+}
+
+bool FVARIDVFMapImage::BuildMips(const FVARIDVFMapImagePixels& InPixels, float InMin, float InMax, TArray<FVARIDVFMapImageMip>& OutMips)
+{
+	OutMips.Empty();
+
+	if (InPixels.Size.X <= 0 || InPixels.Size.Y <= 0 || InPixels.Values.Num() != InPixels.Size.X * InPixels.Size.Y || InMax <= InMin)
+	{
+		return false;
+	}
+
+	FVARIDVFMapImageMip& Mip0 = OutMips.AddDefaulted_GetRef();
+	Mip0.Size = InPixels.Size;
+	Mip0.Values.SetNumUninitialized(InPixels.Values.Num());
+
+	for (int32 i = 0; i < InPixels.Values.Num(); ++i)
+	{
+		const float NormValue = FMath::Clamp(InPixels.bUnitRange ? InPixels.Values[i] : (InPixels.Values[i] - InMin) / (InMax - InMin), 0.0f, 1.0f);
+
+		// the same as a point in ParseVFMap(): high numbers are bad vision internally, and an origin offset for signed ranges
+		Mip0.Values[i] = (1.0f - NormValue) - ((InMin < 0.0f && InMax > 0.0f) ? 0.5f : 0.0f);
+	}
+
+	// 2x2 box down to 1x1. Mip sizes follow the GPU: max(Size >> Level, 1), so an odd last row or column is left out and a side that is already 1 is repeated
+	while (OutMips.Last().Size.X > 1 || OutMips.Last().Size.Y > 1)
+	{
+		const FVARIDVFMapImageMip& Source = OutMips.Last();
+		FVARIDVFMapImageMip Mip;
+		Mip.Size = FIntPoint(FMath::Max(Source.Size.X >> 1, 1), FMath::Max(Source.Size.Y >> 1, 1));
+		Mip.Values.SetNumUninitialized(Mip.Size.X * Mip.Size.Y);
+
+		for (int32 Y = 0; Y < Mip.Size.Y; ++Y)
+		{
+			for (int32 X = 0; X < Mip.Size.X; ++X)
+			{
+				const int32 X0 = FMath::Min(X * 2, Source.Size.X - 1);
+				const int32 X1 = FMath::Min(X * 2 + 1, Source.Size.X - 1);
+				const int32 Y0 = FMath::Min(Y * 2, Source.Size.Y - 1);
+				const int32 Y1 = FMath::Min(Y * 2 + 1, Source.Size.Y - 1);
+
+				Mip.Values[Y * Mip.Size.X + X] = 0.25f * (
+					Source.Values[Y0 * Source.Size.X + X0] + Source.Values[Y0 * Source.Size.X + X1] +
+					Source.Values[Y1 * Source.Size.X + X0] + Source.Values[Y1 * Source.Size.X + X1]);
+			}
+		}
+
+		OutMips.Add(MoveTemp(Mip));
+	}
+
+	return true;
+}
+
+float FVARIDVFMapImage::SampleBilinear(const FVARIDVFMapImageMip& InMip, const FVector2D& InUV) const
+{
+	// AM_Clamp
+	const float X = InUV.X * InMip.Size.X - 0.5f;
+	const float Y = InUV.Y * InMip.Size.Y - 0.5f;
+	const int32 X0 = FMath::FloorToInt(X);
+	const int32 Y0 = FMath::FloorToInt(Y);
+	const float FractionX = X - X0;
+	const float FractionY = Y - Y0;
+
+	auto Load = [&InMip](int32 InX, int32 InY)
+	{
+		return InMip.Values[FMath::Clamp(InY, 0, InMip.Size.Y - 1) * InMip.Size.X + FMath::Clamp(InX, 0, InMip.Size.X - 1)];
+	};
+
+	const float Top = FMath::Lerp(Load(X0, Y0), Load(X0 + 1, Y0), FractionX);
+	const float Bottom = FMath::Lerp(Load(X0, Y0 + 1), Load(X0 + 1, Y0 + 1), FractionX);
+	return FMath::Lerp(Top, Bottom, FractionY);
+}
+
+float FVARIDVFMapImage::Sample(const FVector2D& InNormPosition, float InLevel) const
+{
+	const FVector2D UV((InNormPosition.X - NormMin.X) / (NormMax.X - NormMin.X), (InNormPosition.Y - NormMin.Y) / (NormMax.Y - NormMin.Y));
+	if (UV.X < 0.0f || UV.X > 1.0f || UV.Y < 0.0f || UV.Y > 1.0f)
+	{
+		return 0.0f;
+	}
+
+	return SampleImageUV(UV, InLevel);
+}
+
+float FVARIDVFMapImage::SampleImageUV(const FVector2D& InUV, float InLevel) const
+{
+	if (!IsLoaded())
+	{
+		return 0.0f;
+	}
+
+	const float Level = FMath::Clamp(InLevel, 0.0f, (float)(Mips.Num() - 1));
+	const int32 Level0 = FMath::FloorToInt(Level);
+	const int32 Level1 = FMath::Min(Level0 + 1, Mips.Num() - 1);
+
+	return FMath::Lerp(SampleBilinear(Mips[Level0], InUV), SampleBilinear(Mips[Level1], InUV), Level - Level0);
+}
+
+float FVARIDVFMapImage::GetSampleLevel(const FVector2D& InNormTexelSize) const
+{
+	if (!IsLoaded())
+	{
+		return 0.0f;
+	}
+
+	// image texels per working texel, along the axis that squashes the most
+	const FIntPoint& Size = Mips[0].Size;
+	const float TexelsX = InNormTexelSize.X * Size.X / (NormMax.X - NormMin.X);
+	const float TexelsY = InNormTexelSize.Y * Size.Y / (NormMax.Y - NormMin.Y);
+	const float Footprint = FMath::Max(TexelsX, TexelsY);
+
+	return Footprint > 1.0f ? FMath::Min(FMath::Log2(Footprint), (float)(Mips.Num() - 1)) : 0.0f;
+}
@@ -0,0 +1,367 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "Math/RandomStream.h"
+#include "HAL/PlatformTime.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// VF maps given as images: the background load, the normalisation and mips of FVARIDVFMapImage, and the sampling that replaces the RBF
+// evaluation in the VF map shaders. Images are made up in memory so the load path is exercised without files
+
+void FVARIDReference::EvaluateVFMapImage(const FVARIDVFMapImage& InImage, const FVector4& InPointScaleBias, const FVector4& InSceneUVScaleBias, float InOriginOffset, const FIntRect& InRegionRect, FVARIDImage& OutImage, const FVector2D* InGradientStep)
+{
+	const FVector2D TexelSize(1.0f / OutImage.Size.X, 1.0f / OutImage.Size.Y);
+
+	// the same constants as BuildHeightMapTextureFromImages_RenderThread
+	const FVector2D ImageScale(1.0f / (InImage.NormMax.X - InImage.NormMin.X), 1.0f / (InImage.NormMax.Y - InImage.NormMin.Y));
+	const FVector2D ImageBias(-InImage.NormMin.X * ImageScale.X, -InImage.NormMin.Y * ImageScale.Y);
+	const float ImageLevel = InImage.GetSampleLevel(FVector2D(TexelSize.X * InSceneUVScaleBias.X / InPointScaleBias.X, TexelSize.Y * InSceneUVScaleBias.Y / InPointScaleBias.Y));
+	const FIntPoint ImageLevelSize = InImage.IsLoaded() ? InImage.GetMips()[FMath::FloorToInt(ImageLevel)].Size : FIntPoint(1, 1);
+	const FVector2D ImageTexelSize(1.0f / ImageLevelSize.X, 1.0f / ImageLevelSize.Y);
+
+	for (int32 Y = InRegionRect.Min.Y; Y < InRegionRect.Max.Y; ++Y)
+	{
+		for (int32 X = InRegionRect.Min.X; X < InRegionRect.Max.X; ++X)
+		{
+			const FVector2D SceneUV((X + 0.5f) * TexelSize.X * InSceneUVScaleBias.X + InSceneUVScaleBias.Z, (Y + 0.5f) * TexelSize.Y * InSceneUVScaleBias.Y + InSceneUVScaleBias.W);
+			const FVector2D NormPosition((SceneUV.X - InPointScaleBias.Z) / InPointScaleBias.X, (SceneUV.Y - InPointScaleBias.W) / InPointScaleBias.Y);
+			const FVector2D ImageUV(NormPosition.X * ImageScale.X + ImageBias.X, NormPosition.Y * ImageScale.Y + ImageBias.Y);
+
+			const bool bInside = ImageUV.X >= 0.0f && ImageUV.X <= 1.0f && ImageUV.Y >= 0.0f && ImageUV.Y <= 1.0f;
+			const float InterpolatedValue = InOriginOffset + (bInside ? InImage.SampleImageUV(ImageUV, ImageLevel) : 0.0f);
+
+			if (!InGradientStep)
+			{
+				OutImage.Store(X, Y, FVector4(FMath::Clamp(InterpolatedValue, 0.0f, 1.0f), 0.0f, 0.0f, 0.0f));
+				continue;
+			}
+
+			FVector2D Gradient(0.0f, 0.0f);
+			if (bInside)
+			{
+				Gradient.X = InImage.SampleImageUV(ImageUV + FVector2D(ImageTexelSize.X, 0.0f), ImageLevel) - InImage.SampleImageUV(ImageUV - FVector2D(ImageTexelSize.X, 0.0f), ImageLevel);
+				Gradient.Y = InImage.SampleImageUV(ImageUV + FVector2D(0.0f, ImageTexelSize.Y), ImageLevel) - InImage.SampleImageUV(ImageUV - FVector2D(0.0f, ImageTexelSize.Y), ImageLevel);
+				Gradient.X *= ImageScale.X / (2.0f * ImageTexelSize.X * InPointScaleBias.X);
+				Gradient.Y *= ImageScale.Y / (2.0f * ImageTexelSize.Y * InPointScaleBias.Y);
+			}
+
+			const bool bClamped = InterpolatedValue <= 0.0f || InterpolatedValue >= 1.0f;
+			const FVector2D Warp = bClamped ? FVector2D(0.0f, 0.0f) : FVector2D(-Gradient.X * InGradientStep->X, -Gradient.Y * InGradientStep->Y);
+			OutImage.Store(X, Y, FVector4(Warp.X, Warp.Y, 0.0f, 0.0f));
+		}
+	}
+}
+
+FVARIDDecodeVFMapImage FVARIDReference::MakeGeneratedVFMapImageDecode(const FVARIDVFMapImagePixels& InPixels, int32* OutNumDecodes)
+{
+	return [InPixels, OutNumDecodes](const FString& InFilePath, FVARIDVFMapImagePixels& OutPixels)
+	{
+		if (OutNumDecodes)
+		{
+			++(*OutNumDecodes);
+		}
+
+		OutPixels = InPixels;
+		return InPixels.Values.Num() > 0;
+	};
+}
+
+bool FVARIDReference::ValidateVFMapImage(FString& OutReport)
+{
+	const FIntPoint EyeSize(192, 160);
+	const FVector4 IdentityScaleBias(1.0f, 1.0f, 0.0f, 0.0f);
+	const FVector2D GradientStep(0.002f, 0.002f);
+	const int32 NumTimingRuns = 3;
+
+	/*************************************************************/
+	// normalisation: the same as the points of ParseVFMap()
+
+	{
+		FVARIDVFMapImagePixels Pixels;
+		Pixels.Size = FIntPoint(2, 1);
+		Pixels.Values = { 0.25f, 15.0f };
+		Pixels.bUnitRange = false;	// EXR: raw values in Min..Max
+
+		TArray<FVARIDVFMapImageMip> Mips;
+		if (!FVARIDVFMapImage::BuildMips(Pixels, -10.0f, 10.0f, Mips) || FMath::Abs(Mips[0].Values[0] - (1.0f - 10.25f / 20.0f - 0.5f)) > 1e-6f || Mips[0].Values[1] != -0.5f)
+		{
+			OutReport = TEXT("VARID: VF map image FAILED. Raw values are not normalised like the points of a profile");
+			return false;
+		}
+
+		Pixels.Values = { 0.25f, 1.0f };
+		Pixels.bUnitRange = true;	// PNG: 0..1 spans Min..Max
+
+		if (!FVARIDVFMapImage::BuildMips(Pixels, 0.0f, 33.0f, Mips) || Mips[0].Values[0] != 0.75f || Mips[0].Values[1] != 0.0f)
+		{
+			OutReport = TEXT("VARID: VF map image FAILED. Unit range values are not normalised like the points of a profile");
+			return false;
+		}
+
+		Pixels.Values.Empty();
+		if (FVARIDVFMapImage::BuildMips(Pixels, 0.0f, 1.0f, Mips))
+		{
+			OutReport = TEXT("VARID: VF map image FAILED. An image with no pixels was accepted");
+			return false;
+		}
+	}
+
+	/*************************************************************/
+	// mips: GPU sizes down to 1x1, and a 2x2 box keeps the mean of a power of two image
+
+	FRandomStream RandomStream(136);
+
+	FVARIDVFMapImagePixels NoisePixels;
+	NoisePixels.Size = FIntPoint(64, 32);
+	for (int32 i = 0; i < NoisePixels.Size.X * NoisePixels.Size.Y; ++i)
+	{
+		NoisePixels.Values.Add(RandomStream.FRand());
+	}
+
+	{
+		TArray<FVARIDVFMapImageMip> Mips;
+		FVARIDVFMapImage::BuildMips(NoisePixels, 0.0f, 1.0f, Mips);
+
+		double Mean0 = 0.0;
+		for (float Value : Mips[0].Values)
+		{
+			Mean0 += Value;
+		}
+		Mean0 /= Mips[0].Values.Num();
+
+		for (int32 Level = 0; Level < Mips.Num(); ++Level)
+		{
+			const FIntPoint ExpectedSize(FMath::Max(NoisePixels.Size.X >> Level, 1), FMath::Max(NoisePixels.Size.Y >> Level, 1));
+
+			double Mean = 0.0;
+			for (float Value : Mips[Level].Values)
+			{
+				Mean += Value;
+			}
+			Mean /= Mips[Level].Values.Num();
+
+			if (Mips[Level].Size != ExpectedSize || Mips[Level].Values.Num() != ExpectedSize.X * ExpectedSize.Y || FMath::Abs(Mean - Mean0) > 1e-5)
+			{
+				OutReport = FString::Printf(TEXT("VARID: VF map image FAILED. Mip %d is %dx%d with a mean of %f, expected %dx%d with a mean of %f"), Level, Mips[Level].Size.X, Mips[Level].Size.Y, Mean, ExpectedSize.X, ExpectedSize.Y, Mean0);
+				return false;
+			}
+		}
+
+		if (Mips.Num() != 7)
+		{
+			OutReport = FString::Printf(TEXT("VARID: VF map image FAILED. A 64x32 image has %d mips, expected 7"), Mips.Num());
+			return false;
+		}
+
+		// odd sizes
+		FVARIDVFMapImagePixels OddPixels;
+		OddPixels.Size = FIntPoint(37, 5);
+		OddPixels.Values.Init(0.5f, 37 * 5);
+		FVARIDVFMapImage::BuildMips(OddPixels, 0.0f, 1.0f, Mips);
+
+		if (Mips.Num() != 6 || Mips[2].Size != FIntPoint(9, 1) || Mips.Last().Size != FIntPoint(1, 1) || Mips.Last().Values[0] != 0.5f)
+		{
+			OutReport = FString::Printf(TEXT("VARID: VF map image FAILED. A 37x5 image has %d mips ending at %dx%d, expected 6 ending at 1x1"), Mips.Num(), Mips.Last().Size.X, Mips.Last().Size.Y);
+			return false;
+		}
+	}
+
+	/*************************************************************/
+	// background load, sampling and the area outside the image
+
+	{
+		int32 NumDecodes = 0;
+		FVARIDVFMapImage Image(TEXT("generated"), 0.0f, 1.0f, FVector2D(0.25f, 0.5f), FVector2D(0.75f, 1.0f));
+
+		if (Image.Sample(FVector2D(0.5f, 0.75f), 0.0f) != 0.0f)
+		{
+			OutReport = TEXT("VARID: VF map image FAILED. An image that hasn't loaded is not zero");
+			return false;
+		}
+
+		Image.BeginLoad(MakeGeneratedVFMapImageDecode(NoisePixels, &NumDecodes));
+		Image.BeginLoad(MakeGeneratedVFMapImageDecode(NoisePixels, &NumDecodes));
+		Image.WaitForLoad();
+
+		if (!Image.IsLoaded() || NumDecodes != 1)
+		{
+			OutReport = FString::Printf(TEXT("VARID: VF map image FAILED. Loading twice decoded %d times, state %d"), NumDecodes, (int32)Image.GetState());
+			return false;
+		}
+
+		// texel centres of level 0 are exact
+		const TArray<FVARIDVFMapImageMip>& Mips = Image.GetMips();
+		for (int32 Y = 0; Y < NoisePixels.Size.Y; ++Y)
+		{
+			for (int32 X = 0; X < NoisePixels.Size.X; ++X)
+			{
+				const FVector2D NormPosition(0.25f + 0.5f * (X + 0.5f) / NoisePixels.Size.X, 0.5f + 0.5f * (Y + 0.5f) / NoisePixels.Size.Y);
+				const float Expected = Mips[0].Values[Y * NoisePixels.Size.X + X];
+				const float Sampled = Image.Sample(NormPosition, 0.0f);
+
+				if (FMath::Abs(Sampled - Expected) > 1e-5f)
+				{
+					OutReport = FString::Printf(TEXT("VARID: VF map image FAILED. Texel %d,%d samples as %f, expected %f"), X, Y, Sampled, Expected);
+					return false;
+				}
+			}
+		}
+
+		if (Image.Sample(FVector2D(0.2f, 0.75f), 0.0f) != 0.0f || Image.Sample(FVector2D(0.5f, 0.45f), 0.0f) != 0.0f || Image.Sample(FVector2D(0.5f, 1.05f), 0.0f) != 0.0f)
+		{
+			OutReport = TEXT("VARID: VF map image FAILED. The map is not zero outside the image");
+			return false;
+		}
+
+		// the last mip is the mean everywhere
+		if (FMath::Abs(Image.Sample(FVector2D(0.3f, 0.6f), 100.0f) - Mips.Last().Values[0]) > 1e-6f)
+		{
+			OutReport = TEXT("VARID: VF map image FAILED. Levels past the last mip are not clamped to it");
+			return false;
+		}
+
+		FVARIDVFMapImage FailedImage(TEXT("missing"), 0.0f, 1.0f, FVector2D(0.0f, 0.0f), FVector2D(1.0f, 1.0f));
+		FailedImage.BeginLoad(MakeGeneratedVFMapImageDecode(FVARIDVFMapImagePixels()));
+		FailedImage.WaitForLoad();
+
+		if (FailedImage.GetState() != EVARIDVFMapImageState::Failed || FailedImage.Sample(FVector2D(0.5f, 0.5f), 0.0f) != 0.0f)
+		{
+			OutReport = TEXT("VARID: VF map image FAILED. An image that can't be decoded is not marked as failed, or is not zero");
+			return false;
+		}
+	}
+
+	/*************************************************************/
+	// height map and warp field of a ramp, over the eye with a gaze offset and side by side stereo
+
+	FVARIDVFMapImagePixels RampPixels;
+	RampPixels.Size = FIntPoint(256, 256);
+	for (int32 Y = 0; Y < RampPixels.Size.Y; ++Y)
+	{
+		for (int32 X = 0; X < RampPixels.Size.X; ++X)
+		{
+			RampPixels.Values.Add(0.2f + 0.6f * X / (RampPixels.Size.X - 1));
+		}
+	}
+
+	FVARIDVFMapImage RampImage(TEXT("ramp"), 0.0f, 1.0f, FVector2D(0.1f, 0.1f), FVector2D(0.9f, 0.9f));
+	RampImage.BeginLoad(MakeGeneratedVFMapImageDecode(RampPixels));
+	RampImage.WaitForLoad();
+
+	// value = 1 - (0.2 + 0.6 * x / 255) at texel x, so d/dImageUV = -0.6 * 256 / 255
+	const float RampSlope = -0.6f * RampPixels.Size.X / (RampPixels.Size.X - 1) / (RampImage.NormMax.X - RampImage.NormMin.X);
+	const FVector2D GazePoint(0.03f, -0.02f);
+	float MaxValueError = 0.0f;
+	float MaxGradientError = 0.0f;
+
+	for (int32 NumEyes = 1; NumEyes <= 2; ++NumEyes)
+	{
+		const FIntPoint Extent(EyeSize.X * NumEyes, EyeSize.Y);
+		FVARIDImage HeightMap(Extent);
+		FVARIDImage WarpField(Extent);
+
+		for (int32 EyeIndex = 0; EyeIndex < NumEyes; ++EyeIndex)
+		{
+			const float XScale = NumEyes > 1 ? 0.5f : 1.0f;
+			const float XOffset = EyeIndex == 1 ? 0.5f : 0.0f;
+			const FVector4 PointScaleBias(XScale, 1.0f, GazePoint.X * XScale + XOffset, GazePoint.Y);
+			const FIntRect RegionRect(EyeIndex * EyeSize.X, 0, (EyeIndex + 1) * EyeSize.X, EyeSize.Y);
+
+			EvaluateVFMapImage(RampImage, PointScaleBias, IdentityScaleBias, 0.0f, RegionRect, HeightMap);
+			EvaluateVFMapImage(RampImage, PointScaleBias, IdentityScaleBias, 0.0f, RegionRect, WarpField, &GradientStep);
+
+			for (int32 Y = RegionRect.Min.Y; Y < RegionRect.Max.Y; ++Y)
+			{
+				for (int32 X = RegionRect.Min.X; X < RegionRect.Max.X; ++X)
+				{
+					const FVector2D SceneUV((X + 0.5f) / Extent.X, (Y + 0.5f) / Extent.Y);
+					const FVector2D NormPosition((SceneUV.X - PointScaleBias.Z) / PointScaleBias.X, (SceneUV.Y - PointScaleBias.W) / PointScaleBias.Y);
+					const FVector2D ImageUV((NormPosition.X - 0.1f) / 0.8f, (NormPosition.Y - 0.1f) / 0.8f);
+					const bool bInside = ImageUV.X >= 0.0f && ImageUV.X <= 1.0f && ImageUV.Y >= 0.0f && ImageUV.Y <= 1.0f;
+
+					if (!bInside)
+					{
+						MaxValueError = FMath::Max(MaxValueError, FMath::Abs(HeightMap.Load(X, Y).X));
+						continue;
+					}
+
+					// every mip of the ramp is the same ramp, away from the edges where the sampler clamps. The sampled level is below 1, so
+					// four level 0 texels in, neither the sample nor the central difference reaches the clamp of level 1
+					const float EdgeDistance = FMath::Min(ImageUV.X, 1.0f - ImageUV.X) * RampPixels.Size.X;
+					if (EdgeDistance > 4.0f)
+					{
+						const float Expected = 1.0f - (0.2f + 0.6f * (ImageUV.X * RampPixels.Size.X - 0.5f) / (RampPixels.Size.X - 1));
+						MaxValueError = FMath::Max(MaxValueError, FMath::Abs(HeightMap.Load(X, Y).X - Expected));
+
+						const FVector4 Warp = WarpField.Load(X, Y);
+						const float ExpectedWarpX = -RampSlope / PointScaleBias.X * GradientStep.X;
+						MaxGradientError = FMath::Max(MaxGradientError, FMath::Max(FMath::Abs(Warp.X - ExpectedWarpX) / FMath::Abs(ExpectedWarpX), FMath::Abs(Warp.Y)));
+					}
+				}
+			}
+		}
+	}
+
+	if (MaxValueError > 1e-4f || MaxGradientError > 1e-3f)
+	{
+		OutReport = FString::Printf(TEXT("VARID: VF map image FAILED. The ramp height map is %f away from the image, its warp field %f (relative) away from the slope"), MaxValueError, MaxGradientError);
+		return false;
+	}
+
+	/*************************************************************/
+	// cost next to the RBF at MAX_NUM_POINTS, which a point map can't go past
+
+	FVARIDVFMap PointVFMap;
+	TArray<FVARIDVFMapPoint> Points;
+	for (int32 i = 0; i < 256; ++i)
+	{
+		Points.Add(FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand()));
+	}
+	PointVFMap.Points.SetPoints(Points);
+
+	FVARIDVFMapImagePixels DensePixels;
+	DensePixels.Size = FIntPoint(1024, 1024);
+	DensePixels.Values.SetNumUninitialized(DensePixels.Size.X * DensePixels.Size.Y);
+	for (int32 i = 0; i < DensePixels.Values.Num(); ++i)
+	{
+		DensePixels.Values[i] = RandomStream.FRand();
+	}
+
+	FVARIDVFMap ImageVFMap;
+	ImageVFMap.Image = MakeShared<FVARIDVFMapImage, ESPMode::ThreadSafe>(TEXT("dense"), 0.0f, 1.0f, FVector2D(0.0f, 0.0f), FVector2D(1.0f, 1.0f));
+
+	const double LoadStartTime = FPlatformTime::Seconds();
+	ImageVFMap.Image->BeginLoad(MakeGeneratedVFMapImageDecode(DensePixels));
+	ImageVFMap.Image->WaitForLoad();
+	const double LoadSeconds = FPlatformTime::Seconds() - LoadStartTime;
+
+	const FIntRect ViewportRect(FIntPoint(0, 0), EyeSize);
+	FVARIDImage RBFHeightMap(EyeSize);
+	FVARIDImage ImageHeightMap(EyeSize);
+	double RBFSeconds = 0.0;
+	double ImageSeconds = 0.0;
+
+	for (int32 Run = 0; Run < NumTimingRuns; ++Run)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		EvaluateVFMap(PointVFMap, ViewportRect, 0, RBFHeightMap);
+		const double MidTime = FPlatformTime::Seconds();
+		EvaluateVFMap(ImageVFMap, ViewportRect, 0, ImageHeightMap);
+		const double EndTime = FPlatformTime::Seconds();
+
+		RBFSeconds = Run == 0 ? MidTime - StartTime : FMath::Min(RBFSeconds, MidTime - StartTime);
+		ImageSeconds = Run == 0 ? EndTime - MidTime : FMath::Min(ImageSeconds, EndTime - MidTime);
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: VF map image OK. Normalised like the points, box mips to 1x1, loaded once, exact at texel centres and zero outside. ")
+		TEXT("Ramp within %f, warp field within %f of the slope. At %dx%d: RBF %d points %.2f ms, %dx%d image (level %.2f) %.2f ms on the CPU. Load and mips %.2f ms off the game thread"),
+		MaxValueError, MaxGradientError,
+		EyeSize.X, EyeSize.Y, PointVFMap.Points.Num(), RBFSeconds * 1000.0, DensePixels.Size.X, DensePixels.Size.Y, ImageVFMap.Image->GetSampleLevel(FVector2D(1.0f / EyeSize.X, 1.0f / EyeSize.Y)), ImageSeconds * 1000.0, LoadSeconds * 1000.0);
+	return true;
+}
+
+#endif
@@ -0,0 +1,252 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDVFMapMesh.h"
+
+const float FVARIDVFMapMesh::FrameMin = -1.0f;
+const float FVARIDVFMapMesh::FrameMax = 2.0f;
+
+static const double SUPER_TRIANGLE_RADIUS = 1.0e4;	// far enough out that no circumcircle of the real triangulation reaches it
+
+/** twice the signed area of ABC. Positive for the winding the mesh uses */
+static double Orient2D(double AX, double AY, double BX, double BY, double CX, double CY)
+{
+	return (BX - AX) * (CY - AY) - (BY - AY) * (CX - AX);
+}
+
+/** positive if D is inside the circumcircle of ABC. ABC must have a positive winding */
+static double InCircle(double AX, double AY, double BX, double BY, double CX, double CY, double DX, double DY)
+{
+	const double ADX = AX - DX, ADY = AY - DY;
+	const double BDX = BX - DX, BDY = BY - DY;
+	const double CDX = CX - DX, CDY = CY - DY;
+
+	const double AD = ADX * ADX + ADY * ADY;
+	const double BD = BDX * BDX + BDY * BDY;
+	const double CD = CDX * CDX + CDY * CDY;
+
+	return ADX * (BDY * CD - BD * CDY) - ADY * (BDX * CD - BD * CDX) + AD * (BDX * CDY - BDY * CDX);
+}
+
+FVARIDVFMapMesh::FVARIDVFMapMesh()
+{
+}
+
+void FVARIDVFMapMesh::Build(const TArray<FVector>& InPoints)
+{
+	Vertices.Reset();
+	Indices.Reset();
+	PointIndices.Reset();
+
+	Vertices.Add(FVector(FrameMin, FrameMin, 0.0f));
+	Vertices.Add(FVector(FrameMax, FrameMin, 0.0f));
+	Vertices.Add(FVector(FrameMax, FrameMax, 0.0f));
+	Vertices.Add(FVector(FrameMin, FrameMax, 0.0f));
+	PointIndices.Init(INDEX_NONE, 4);
+
+	for (int32 PointIndex = 0; PointIndex < InPoints.Num(); ++PointIndex)
+	{
+		const FVector& Point = InPoints[PointIndex];
+
+		if (Point.X <= FrameMin || Point.X >= FrameMax || Point.Y <= FrameMin || Point.Y >= FrameMax)
+		{
+			continue;
+		}
+
+		bool bDuplicate = false;
+		for (const FVector& Vertex : Vertices)
+		{
+			if (Vertex.X == Point.X && Vertex.Y == Point.Y)
+			{
+				bDuplicate = true;
+				break;
+			}
+		}
+
+		if (!bDuplicate)
+		{
+			Vertices.Add(Point);
+			PointIndices.Add(PointIndex);
+		}
+	}
+
+	// positions in double, followed by the three vertices of a super triangle around the frame
+	const int32 NumVertices = Vertices.Num();
+	TArray<double> X;
+	TArray<double> Y;
+	X.SetNumUninitialized(NumVertices + 3);
+	Y.SetNumUninitialized(NumVertices + 3);
+
+	for (int32 i = 0; i < NumVertices; ++i)
+	{
+		X[i] = Vertices[i].X;
+		Y[i] = Vertices[i].Y;
+	}
+
+	const double Centre = 0.5 * (FrameMin + FrameMax);
+	for (int32 i = 0; i < 3; ++i)
+	{
+		const float Angle = (2.0f * PI * i) / 3.0f;
+		X[NumVertices + i] = Centre + SUPER_TRIANGLE_RADIUS * FMath::Cos(Angle);
+		Y[NumVertices + i] = Centre + SUPER_TRIANGLE_RADIUS * FMath::Sin(Angle);
+	}
+
+	TArray<int32> Triangles = { NumVertices, NumVertices + 1, NumVertices + 2 };
+	TArray<int32> CavityEdges;
+
+	for (int32 Point = 0; Point < NumVertices; ++Point)
+	{
+		// remove every triangle whose circumcircle contains the point, keeping the edges of the hole they leave
+		CavityEdges.Reset();
+
+		for (int32 Triangle = Triangles.Num() / 3 - 1; Triangle >= 0; --Triangle)
+		{
+			const int32 A = Triangles[Triangle * 3 + 0];
+			const int32 B = Triangles[Triangle * 3 + 1];
+			const int32 C = Triangles[Triangle * 3 + 2];
+
+			if (InCircle(X[A], Y[A], X[B], Y[B], X[C], Y[C], X[Point], Y[Point]) <= 0.0)
+			{
+				continue;
+			}
+
+			const int32 Edges[6] = { A, B, B, C, C, A };
+			for (int32 Edge = 0; Edge < 3; ++Edge)
+			{
+				// an edge shared by two removed triangles is inside the hole
+				bool bShared = false;
+				for (int32 i = 0; i < CavityEdges.Num(); i += 2)
+				{
+					if (CavityEdges[i] == Edges[Edge * 2 + 1] && CavityEdges[i + 1] == Edges[Edge * 2])
+					{
+						CavityEdges.RemoveAtSwap(i, 2);
+						bShared = true;
+						break;
+					}
+				}
+
+				if (!bShared)
+				{
+					CavityEdges.Add(Edges[Edge * 2]);
+					CavityEdges.Add(Edges[Edge * 2 + 1]);
+				}
+			}
+
+			Triangles.RemoveAtSwap(Triangle * 3, 3);
+		}
+
+		// fan the hole from the point. The edges keep the winding of the triangles they came from
+		for (int32 i = 0; i < CavityEdges.Num(); i += 2)
+		{
+			Triangles.Add(CavityEdges[i]);
+			Triangles.Add(CavityEdges[i + 1]);
+			Triangles.Add(Point);
+		}
+	}
+
+	for (int32 i = 0; i < Triangles.Num(); i += 3)
+	{
+		if (Triangles[i] < NumVertices && Triangles[i + 1] < NumVertices && Triangles[i + 2] < NumVertices)
+		{
+			Indices.Add(Triangles[i]);
+			Indices.Add(Triangles[i + 1]);
+			Indices.Add(Triangles[i + 2]);
+		}
+	}
+}
+
+bool FVARIDVFMapMesh::IsEmpty() const
+{
+	return Indices.Num() == 0;
+}
+
+int32 FVARIDVFMapMesh::GetNumTriangles() const
+{
+	return Indices.Num() / 3;
+}
+
+bool FVARIDVFMapMesh::Evaluate(const FVector2D& InPosition, float& OutValue, FVector2D* OutGradient) const
+{
+	const double Tolerance = 1.0e-9;
+
+	for (int32 i = 0; i < Indices.Num(); i += 3)
+	{
+		const FVector& A = Vertices[Indices[i + 0]];
+		const FVector& B = Vertices[Indices[i + 1]];
+		const FVector& C = Vertices[Indices[i + 2]];
+
+		const double Area = Orient2D(A.X, A.Y, B.X, B.Y, C.X, C.Y);
+		const double WeightA = Orient2D(B.X, B.Y, C.X, C.Y, InPosition.X, InPosition.Y) / Area;
+		const double WeightB = Orient2D(C.X, C.Y, A.X, A.Y, InPosition.X, InPosition.Y) / Area;
+		const double WeightC = 1.0 - WeightA - WeightB;
+
+		if (WeightA < -Tolerance || WeightB < -Tolerance || WeightC < -Tolerance)
+		{
+			continue;
+		}
+
+		OutValue = (float)(WeightA * A.Z + WeightB * B.Z + WeightC * C.Z);
+
+		if (OutGradient)
+		{
+			// the plane through the corners: dot(Gradient, B - A) = B.Z - A.Z and dot(Gradient, C - A) = C.Z - A.Z
+			const double DeltaB = B.Z - A.Z;
+			const double DeltaC = C.Z - A.Z;
+			OutGradient->X = (float)((DeltaB * (C.Y - A.Y) - DeltaC * (B.Y - A.Y)) / Area);
+			OutGradient->Y = (float)((DeltaC * (B.X - A.X) - DeltaB * (C.X - A.X)) / Area);
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+bool FVARIDVFMapMesh::IsValidDelaunay(FString& OutReason) const
+{
+	const double FrameArea = (double)(FrameMax - FrameMin) * (double)(FrameMax - FrameMin);
+	double TotalArea = 0.0;
+
+	for (int32 i = 0; i < Indices.Num(); i += 3)
+	{
+		const FVector& A = Vertices[Indices[i + 0]];
+		const FVector& B = Vertices[Indices[i + 1]];
+		const FVector& C = Vertices[Indices[i + 2]];
+
+		const double Area = Orient2D(A.X, A.Y, B.X, B.Y, C.X, C.Y);
+		if (Area <= 0.0)
+		{
+			OutReason = FString::Printf(TEXT("triangle %d is degenerate or wound the wrong way"), i / 3);
+			return false;
+		}
+
+		TotalArea += 0.5 * Area;
+
+		// exactly cocircular points can go either way, so allow for rounding
+		const double Scale = FMath::Max(FVector2D::DistSquared(FVector2D(A.X, A.Y), FVector2D(B.X, B.Y)), FVector2D::DistSquared(FVector2D(A.X, A.Y), FVector2D(C.X, C.Y)));
+		for (int32 Vertex = 0; Vertex < Vertices.Num(); ++Vertex)
+		{
+			if (Vertex == Indices[i + 0] || Vertex == Indices[i + 1] || Vertex == Indices[i + 2])
+			{
+				continue;
+			}
+
+			const FVector& D = Vertices[Vertex];
+			if (InCircle(A.X, A.Y, B.X, B.Y, C.X, C.Y, D.X, D.Y) > 1.0e-9 * Scale * Scale)
+			{
+				OutReason = FString::Printf(TEXT("vertex %d is inside the circumcircle of triangle %d"), Vertex, i / 3);
+				return false;
+			}
+		}
+	}
+
+	if (FMath::Abs(TotalArea - FrameArea) > 1.0e-6 * FrameArea)
+	{
+		OutReason = FString::Printf(TEXT("the triangles cover an area of %f, the frame is %f"), TotalArea, FrameArea);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,405 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "Math/RandomStream.h"
+#include "HAL/PlatformTime.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// FVARIDVFMapMesh's triangulation and its rasterisation into the VF maps. The mesh stands in for the RBF fields, so it must interpolate the
+// points, and the raster must cover every texel once and agree with the mesh field evaluated on the CPU
+
+/** E > 0 inside a triangle with a positive winding. Ties go to the triangle that has the edge as a "top left" edge, the same edge the other triangle sharing it walks the other way */
+static bool IsInsideEdge(double InEdge, double InEdgeDeltaX, double InEdgeDeltaY)
+{
+	return InEdge > 0.0 || (InEdge == 0.0 && (InEdgeDeltaY > 0.0 || (InEdgeDeltaY == 0.0 && InEdgeDeltaX < 0.0)));
+}
+
+void FVARIDReference::RasteriseVFMapMesh(const FVARIDVFMapMesh& InMesh, const FVector4& InPointScaleBias, const FVector4& InSceneUVScaleBias, float InOriginOffset, const FIntRect& InScissorRect, FVARIDImage& OutImage, const FVector2D* InGradientStep, TArray<int32>* OutCoverage)
+{
+	const FIntRect ClipRect(
+		FMath::Max(InScissorRect.Min.X, 0),
+		FMath::Max(InScissorRect.Min.Y, 0),
+		FMath::Min(InScissorRect.Max.X, OutImage.Size.X),
+		FMath::Min(InScissorRect.Max.Y, OutImage.Size.Y));
+
+	if (OutCoverage && OutCoverage->Num() != OutImage.Size.X * OutImage.Size.Y)
+	{
+		OutCoverage->SetNumZeroed(OutImage.Size.X * OutImage.Size.Y);
+	}
+
+	for (int32 Triangle = 0; Triangle < InMesh.GetNumTriangles(); ++Triangle)
+	{
+		// VARIDVFMapMeshVS.usf
+		FVector2D SceneUV[3];
+		float Value[3];
+		double PixelX[3];
+		double PixelY[3];
+
+		for (int32 Corner = 0; Corner < 3; ++Corner)
+		{
+			const FVector& Vertex = InMesh.Vertices[InMesh.Indices[Triangle * 3 + Corner]];
+			SceneUV[Corner] = FVector2D(Vertex.X * InPointScaleBias.X + InPointScaleBias.Z, Vertex.Y * InPointScaleBias.Y + InPointScaleBias.W);
+			Value[Corner] = Vertex.Z;
+
+			// working UV -> NDC -> viewport is a scale by the texture size
+			PixelX[Corner] = (double)((SceneUV[Corner].X - InSceneUVScaleBias.Z) / InSceneUVScaleBias.X) * OutImage.Size.X;
+			PixelY[Corner] = (double)((SceneUV[Corner].Y - InSceneUVScaleBias.W) / InSceneUVScaleBias.Y) * OutImage.Size.Y;
+		}
+
+		const FVector2D Edge1 = SceneUV[1] - SceneUV[0];
+		const FVector2D Edge2 = SceneUV[2] - SceneUV[0];
+		const float Delta1 = Value[1] - Value[0];
+		const float Delta2 = Value[2] - Value[0];
+		const float GradientArea = Edge1.X * Edge2.Y - Edge1.Y * Edge2.X;
+		const FVector2D Gradient = GradientArea != 0.0f ? FVector2D(Delta1 * Edge2.Y - Delta2 * Edge1.Y, Delta2 * Edge1.X - Delta1 * Edge2.X) / GradientArea : FVector2D(0.0f, 0.0f);
+
+		// the rasteriser. Culling is off, so flip a mirrored triangle round rather than dropping it
+		double Area = (PixelX[1] - PixelX[0]) * (PixelY[2] - PixelY[0]) - (PixelY[1] - PixelY[0]) * (PixelX[2] - PixelX[0]);
+		if (Area == 0.0)
+		{
+			continue;
+		}
+
+		int32 Order[3] = { 0, 1, 2 };
+		if (Area < 0.0)
+		{
+			Order[1] = 2;
+			Order[2] = 1;
+			Area = -Area;
+		}
+
+		const int32 MinX = FMath::Max(ClipRect.Min.X, FMath::FloorToInt((float)FMath::Min(PixelX[0], FMath::Min(PixelX[1], PixelX[2])) - 0.5f));
+		const int32 MinY = FMath::Max(ClipRect.Min.Y, FMath::FloorToInt((float)FMath::Min(PixelY[0], FMath::Min(PixelY[1], PixelY[2])) - 0.5f));
+		const int32 MaxX = FMath::Min(ClipRect.Max.X - 1, FMath::CeilToInt((float)FMath::Max(PixelX[0], FMath::Max(PixelX[1], PixelX[2]))));
+		const int32 MaxY = FMath::Min(ClipRect.Max.Y - 1, FMath::CeilToInt((float)FMath::Max(PixelY[0], FMath::Max(PixelY[1], PixelY[2]))));
+
+		for (int32 Y = MinY; Y <= MaxY; ++Y)
+		{
+			for (int32 X = MinX; X <= MaxX; ++X)
+			{
+				const double CentreX = X + 0.5;
+				const double CentreY = Y + 0.5;
+
+				double Weights[3];
+				bool bInside = true;
+
+				for (int32 Edge = 0; Edge < 3 && bInside; ++Edge)
+				{
+					// the weight of a corner is the edge function of the opposite edge
+					const int32 A = Order[(Edge + 1) % 3];
+					const int32 B = Order[(Edge + 2) % 3];
+					const double DeltaX = PixelX[B] - PixelX[A];
+					const double DeltaY = PixelY[B] - PixelY[A];
+					const double EdgeFunction = DeltaX * (CentreY - PixelY[A]) - DeltaY * (CentreX - PixelX[A]);
+
+					bInside = IsInsideEdge(EdgeFunction, DeltaX, DeltaY);
+					Weights[Order[Edge]] = EdgeFunction / Area;
+				}
+
+				if (!bInside)
+				{
+					continue;
+				}
+
+				// VARIDVFMapMeshPS.usf
+				const float InterpolatedValue = (float)(Weights[0] * Value[0] + Weights[1] * Value[1] + Weights[2] * Value[2]) + InOriginOffset;
+
+				if (InGradientStep)
+				{
+					const bool bClamped = InterpolatedValue <= 0.0f || InterpolatedValue >= 1.0f;
+					OutImage.Store(X, Y, bClamped ? FVector4(0.0f, 0.0f, 0.0f, 0.0f) : FVector4(-Gradient.X * InGradientStep->X, -Gradient.Y * InGradientStep->Y, 0.0f, 0.0f));
+				}
+				else
+				{
+					OutImage.Store(X, Y, FVector4(FMath::Clamp(InterpolatedValue, 0.0f, 1.0f), 0.0f, 0.0f, 0.0f));
+				}
+
+				if (OutCoverage)
+				{
+					++(*OutCoverage)[Y * OutImage.Size.X + X];
+				}
+			}
+		}
+	}
+}
+
+void FVARIDReference::BuildVFMap242(const FVector2D& InFOV, int32 InSeed, FVARIDVFMap& OutVFMap)
+{
+	const int32 RowY[8] = { 21, 15, 9, 3, -3, -9, -15, -21 };
+	const int32 RowMinX[8] = { -9, -15, -21, -27, -27, -21, -15, -9 };
+	const int32 RowMaxX[8] = { 9, 15, 21, 21, 21, 21, 15, 9 };
+
+	FRandomStream RandomStream(InSeed);
+	OutVFMap.FullField = false;
+	TArray<FVARIDVFMapPoint> Points;
+
+	for (int32 Row = 0; Row < 8; ++Row)
+	{
+		for (int32 RawX = RowMinX[Row]; RawX <= RowMaxX[Row]; RawX += 6)
+		{
+			const float RawY = (float)RowY[Row];
+			const float RawValue = (float)RandomStream.RandRange(0, 33);
+			const float NormX = ((RawX / (InFOV.X / 2.0f)) / 2.0f) + 0.5f;
+			const float NormY = ((RawY / (InFOV.Y / 2.0f)) / 2.0f) + 0.5f;
+			Points.Add(FVARIDVFMapPoint((float)RawX, RawY, RawValue, 0.0f, 33.0f, NormX, NormY, 1.0f - RawValue / 33.0f));
+		}
+	}
+
+	OutVFMap.Points.SetPoints(Points);
+	OutVFMap.ExpectedNumDataPoints = OutVFMap.Points.Num();
+}
+
+/** compares a rasterised eye with the mesh field at every texel centre of InScissorRect. InSceneUVScaleBias is the identity */
+static bool CompareRasterisedVFMapMesh(const FVARIDVFMapMesh& InMesh, const FVector4& InPointScaleBias, float InOriginOffset, const FIntRect& InScissorRect, const FVARIDImage& InHeightMap, const FVARIDImage& InWarpField, const FVector2D& InGradientStep, float& OutMaxValueError, int32& OutNumGradientMismatches)
+{
+	for (int32 Y = InScissorRect.Min.Y; Y < InScissorRect.Max.Y; ++Y)
+	{
+		for (int32 X = InScissorRect.Min.X; X < InScissorRect.Max.X; ++X)
+		{
+			const FVector2D SceneUV((X + 0.5f) / InHeightMap.Size.X, (Y + 0.5f) / InHeightMap.Size.Y);
+			const FVector2D Position((SceneUV.X - InPointScaleBias.Z) / InPointScaleBias.X, (SceneUV.Y - InPointScaleBias.W) / InPointScaleBias.Y);
+
+			float Value = 0.0f;
+			FVector2D Gradient;
+			if (!InMesh.Evaluate(Position, Value, &Gradient))
+			{
+				return false;
+			}
+
+			Value += InOriginOffset;
+			OutMaxValueError = FMath::Max(OutMaxValueError, FMath::Abs(InHeightMap.Load(X, Y).X - FMath::Clamp(Value, 0.0f, 1.0f)));
+
+			// a texel centre on an edge can take either triangle's gradient, so only count the mismatches
+			const bool bClamped = Value <= 0.0f || Value >= 1.0f;
+			const FVector2D Expected = bClamped ? FVector2D(0.0f, 0.0f) : FVector2D(-Gradient.X / InPointScaleBias.X * InGradientStep.X, -Gradient.Y / InPointScaleBias.Y * InGradientStep.Y);
+			const FVector4 Rasterised = InWarpField.Load(X, Y);
+			const float Tolerance = 1e-3f * FMath::Max(1e-3f, Expected.Size());
+			if (FMath::Abs(Rasterised.X - Expected.X) > Tolerance || FMath::Abs(Rasterised.Y - Expected.Y) > Tolerance)
+			{
+				++OutNumGradientMismatches;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool FVARIDReference::ValidateVFMapMesh(FString& OutReport)
+{
+	const FVector2D FOV(100.0f, 100.0f);
+	const FIntPoint EyeSize(192, 160);
+	const FVector4 IdentityScaleBias(1.0f, 1.0f, 0.0f, 0.0f);
+	const FVector2D GazePoint(0.07f, -0.04f);
+	const FVector2D GradientStep(0.002f, 0.002f);
+	const float OriginOffset = 0.1f;	// pushes the worst points past 1 so the clamp is covered
+	const float ValueTolerance = 1e-4f;	// the vertices go through scene UV in float, the field is evaluated from them directly
+	const int32 NumTimingRuns = 3;
+
+	/*************************************************************/
+	// triangulations
+
+	FVARIDVFMap VFMap242;
+	BuildVFMap242(FOV, 35, VFMap242);
+
+	// a random cloud
+	FVARIDVFMap RandomVFMap;
+	FRandomStream RandomStream(135);
+	TArray<FVARIDVFMapPoint> RandomPoints;
+	for (int32 i = 0; i < 300; ++i)
+	{
+		const float NormX = RandomStream.FRand();
+		const float NormY = RandomStream.FRand();
+		RandomPoints.Add(FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, NormX, NormY, RandomStream.FRand()));
+	}
+	RandomVFMap.Points.SetPoints(RandomPoints);
+
+	// a regular grid is all cocircular quads. The duplicates have to be skipped
+	FVARIDVFMap GridVFMap;
+	TArray<FVARIDVFMapPoint> GridPoints;
+	for (int32 Y = 0; Y < 10; ++Y)
+	{
+		for (int32 X = 0; X < 10; ++X)
+		{
+			GridPoints.Add(FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.05f + X * 0.1f, 0.05f + Y * 0.1f, (X + Y) / 18.0f));
+		}
+	}
+	for (int32 i = 0; i < 10; ++i)
+	{
+		GridPoints.Add(FVARIDVFMapPoint(GridPoints[i * 7]));
+	}
+	GridVFMap.Points.SetPoints(GridPoints);
+
+	FVARIDVFMap FullFieldVFMap;
+	FullFieldVFMap.FullField = true;
+	FullFieldVFMap.Points.SetPoints({ FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.3f) });
+
+	const FVARIDVFMap* VFMaps[4] = { &VFMap242, &RandomVFMap, &GridVFMap, &FullFieldVFMap };
+	const TCHAR* VFMapNames[4] = { TEXT("24-2"), TEXT("random"), TEXT("grid"), TEXT("full field") };
+	const int32 ExpectedNumVertices[4] = { 4 + 54, 4 + 300, 4 + 100, 4 };
+
+	for (int32 i = 0; i < 4; ++i)
+	{
+		const FVARIDVFMapMesh& Mesh = *VFMaps[i]->GetMesh();
+
+		FString Reason;
+		if (!Mesh.IsValidDelaunay(Reason))
+		{
+			OutReport = FString::Printf(TEXT("VARID: VF map mesh FAILED. The %s triangulation is not valid: %s"), VFMapNames[i], *Reason);
+			return false;
+		}
+
+		if (Mesh.Vertices.Num() != ExpectedNumVertices[i])
+		{
+			OutReport = FString::Printf(TEXT("VARID: VF map mesh FAILED. The %s triangulation has %d vertices, expected %d"), VFMapNames[i], Mesh.Vertices.Num(), ExpectedNumVertices[i]);
+			return false;
+		}
+
+		// the field goes through every point
+		for (int32 Vertex = 0; Vertex < Mesh.Vertices.Num(); ++Vertex)
+		{
+			float Value = 0.0f;
+			if (!Mesh.Evaluate(FVector2D(Mesh.Vertices[Vertex].X, Mesh.Vertices[Vertex].Y), Value) || FMath::Abs(Value - Mesh.Vertices[Vertex].Z) > 1e-6f)
+			{
+				OutReport = FString::Printf(TEXT("VARID: VF map mesh FAILED. The %s mesh gives %f at vertex %d, expected %f"), VFMapNames[i], Value, Vertex, Mesh.Vertices[Vertex].Z);
+				return false;
+			}
+		}
+	}
+
+	/*************************************************************/
+	// shared by copies, and reused with other values by a map with the same positions
+
+	const FVARIDVFMap RandomCopy(RandomVFMap);
+	if (RandomCopy.GetMesh() != RandomVFMap.GetMesh())
+	{
+		OutReport = TEXT("VARID: VF map mesh FAILED. A copy of the random map triangulated it again");
+		return false;
+	}
+
+	FVARIDVFMap Revalued(RandomVFMap);
+	for (int32 PointIndex = 0; PointIndex < Revalued.Points.Num(); ++PointIndex)
+	{
+		Revalued.Points.SetValue(PointIndex, 1.0f - Revalued.Points.GetValue(PointIndex));
+	}
+	Revalued.ResetDerivedData(&Revalued);
+
+	FVARIDVFMap Retriangulated;
+	Retriangulated.Points = Revalued.Points;
+
+	const FVARIDVFMapMesh& RevaluedMesh = *Revalued.GetMesh();
+	const FVARIDVFMapMesh& RetriangulatedMesh = *Retriangulated.GetMesh();
+	bool bSameMesh = RevaluedMesh.Vertices.Num() == RetriangulatedMesh.Vertices.Num() && RevaluedMesh.Indices.Num() == RetriangulatedMesh.Indices.Num();
+
+	for (int32 Vertex = 0; bSameMesh && Vertex < RevaluedMesh.Vertices.Num(); ++Vertex)
+	{
+		bSameMesh = RevaluedMesh.Vertices[Vertex] == RetriangulatedMesh.Vertices[Vertex];
+	}
+
+	for (int32 Index = 0; bSameMesh && Index < RevaluedMesh.Indices.Num(); ++Index)
+	{
+		bSameMesh = RevaluedMesh.Indices[Index] == RetriangulatedMesh.Indices[Index];
+	}
+
+	if (!bSameMesh || RandomVFMap.GetMesh()->Vertices[4].Z == RevaluedMesh.Vertices[4].Z)
+	{
+		OutReport = TEXT("VARID: VF map mesh FAILED. The random map with new values differs from its own triangulation");
+		return false;
+	}
+
+	/*************************************************************/
+	// rasterised, one eye with a gaze offset and side by side stereo
+
+	float MaxValueError = 0.0f;
+	int32 NumGradientMismatches = 0;
+	int32 NumTexels = 0;
+
+	for (int32 NumEyes = 1; NumEyes <= 2; ++NumEyes)
+	{
+		const FIntPoint Extent(EyeSize.X * NumEyes, EyeSize.Y);
+		FVARIDImage HeightMap(Extent);
+		FVARIDImage WarpField(Extent);
+		TArray<int32> Coverage;
+
+		for (int32 EyeIndex = 0; EyeIndex < NumEyes; ++EyeIndex)
+		{
+			// the same transform BuildHeightMapTextureFromMesh_RenderThread gives the vertex shader
+			const float XScale = NumEyes > 1 ? 0.5f : 1.0f;
+			const float XOffset = EyeIndex == 1 ? 0.5f : 0.0f;
+			const FVector4 PointScaleBias(XScale, 1.0f, GazePoint.X * XScale + XOffset, GazePoint.Y);
+			const FIntRect ScissorRect(EyeIndex * EyeSize.X, 0, (EyeIndex + 1) * EyeSize.X, EyeSize.Y);
+			const FVARIDVFMapMesh& Mesh = *(EyeIndex == 0 ? VFMap242 : RandomVFMap).GetMesh();
+
+			RasteriseVFMapMesh(Mesh, PointScaleBias, IdentityScaleBias, OriginOffset, ScissorRect, HeightMap, nullptr, &Coverage);
+			RasteriseVFMapMesh(Mesh, PointScaleBias, IdentityScaleBias, OriginOffset, ScissorRect, WarpField, &GradientStep);
+
+			if (!CompareRasterisedVFMapMesh(Mesh, PointScaleBias, OriginOffset, ScissorRect, HeightMap, WarpField, GradientStep, MaxValueError, NumGradientMismatches))
+			{
+				OutReport = FString::Printf(TEXT("VARID: VF map mesh FAILED. Eye %d of %d has texels outside its mesh frame"), EyeIndex, NumEyes);
+				return false;
+			}
+
+			NumTexels += ScissorRect.Area();
+		}
+
+		for (int32 i = 0; i < Coverage.Num(); ++i)
+		{
+			if (Coverage[i] != 1)
+			{
+				OutReport = FString::Printf(TEXT("VARID: VF map mesh FAILED. With %d eyes texel %d,%d was written %d times"), NumEyes, i % Extent.X, i / Extent.X, Coverage[i]);
+				return false;
+			}
+		}
+	}
+
+	if (MaxValueError > ValueTolerance)
+	{
+		OutReport = FString::Printf(TEXT("VARID: VF map mesh FAILED. The rasterised height map is %f away from the mesh field (tolerance %f)"), MaxValueError, ValueTolerance);
+		return false;
+	}
+
+	// texel centres landing on an edge are rare. Many mismatches mean the gradient is wrong
+	if (NumGradientMismatches * 1000 > NumTexels)
+	{
+		OutReport = FString::Printf(TEXT("VARID: VF map mesh FAILED. The rasterised warp field differs from the mesh gradient at %d of %d texels"), NumGradientMismatches, NumTexels);
+		return false;
+	}
+
+	/*************************************************************/
+	// cost next to the RBF, on the 24-2 map
+
+	const FIntRect ViewportRect(FIntPoint(0, 0), EyeSize);
+	FVARIDImage RBFHeightMap(EyeSize);
+	FVARIDImage MeshHeightMap(EyeSize);
+	double RBFSeconds = 0.0;
+	double MeshSeconds = 0.0;
+
+	for (int32 Run = 0; Run < NumTimingRuns; ++Run)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		EvaluateVFMap(VFMap242, ViewportRect, 0, RBFHeightMap);
+		const double MidTime = FPlatformTime::Seconds();
+		RasteriseVFMapMesh(*VFMap242.GetMesh(), IdentityScaleBias, IdentityScaleBias, 0.0f, ViewportRect, MeshHeightMap);
+		const double EndTime = FPlatformTime::Seconds();
+
+		RBFSeconds = Run == 0 ? MidTime - StartTime : FMath::Min(RBFSeconds, MidTime - StartTime);
+		MeshSeconds = Run == 0 ? EndTime - MidTime : FMath::Min(MeshSeconds, EndTime - MidTime);
+	}
+
+	double SumDifference = 0.0;
+	for (int32 i = 0; i < RBFHeightMap.Pixels.Num(); ++i)
+	{
+		SumDifference += FMath::Abs(RBFHeightMap.Pixels[i].X - MeshHeightMap.Pixels[i].X);
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: VF map mesh OK. Delaunay, through every point, every texel written once and within %f of the mesh field (%d of %d warp texels on an edge). ")
+		TEXT("24-2 at %dx%d: RBF %d points per texel %.2f ms, mesh %d triangles %.2f ms on the CPU. Mean difference between the two fields %f"),
+		MaxValueError, NumGradientMismatches, NumTexels,
+		EyeSize.X, EyeSize.Y, VFMap242.Points.Num(), RBFSeconds * 1000.0, VFMap242.GetMesh()->GetNumTriangles(), MeshSeconds * 1000.0, SumDifference / RBFHeightMap.Pixels.Num());
+	return true;
+}
+
+#endif
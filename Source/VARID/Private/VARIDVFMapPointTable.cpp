@@ -0,0 +1,155 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDVFMapPointTable.h"
+
+FVARIDVFMapTableEntry::FVARIDVFMapTableEntry()
+{
+	X = 0.0f;
+	Y = 0.0f;
+	ChannelMask = 0;
+
+	for (int32 Channel = 0; Channel < EVARIDVFMapChannel::Num; ++Channel)
+	{
+		Values[Channel] = 0.0f;
+	}
+}
+
+FVARIDVFMapPointTable::FVARIDVFMapPointTable()
+{
+	for (int32 i = 0; i < 4; ++i)
+	{
+		EyeEntryRange[i] = 0;
+	}
+
+	for (int32 Channel = 0; Channel < EVARIDVFMapChannel::Num; ++Channel)
+	{
+		OriginOffsets[Channel] = FVector2D(0.0f, 0.0f);
+		NumPoints[Channel][0] = 0;
+		NumPoints[Channel][1] = 0;
+	}
+
+	CurrentEye = -1;
+}
+
+void FVARIDVFMapPointTable::BeginEye()
+{
+	check(CurrentEye < 1);
+
+	++CurrentEye;
+	EyeEntryRange[CurrentEye * 2] = Entries.Num();
+	EyeEntryRange[CurrentEye * 2 + 1] = 0;
+	EntryIndices.Reset();
+	LastPositions.Reset();
+}
+
+void FVARIDVFMapPointTable::AddVFMap(EVARIDVFMapChannel::Type InChannel, const FVARIDVFMap* InVFMap, float InOriginOffset, float InXScale, float InXOffset, const FVector2D& InGazePoint)
+{
+	check(CurrentEye >= 0);
+
+	float& OriginOffset = CurrentEye == 0 ? OriginOffsets[InChannel].X : OriginOffsets[InChannel].Y;
+	OriginOffset = InOriginOffset;
+
+	if (!InVFMap)
+	{
+		return;
+	}
+
+	const FVARIDVFMapPoints& Points = InVFMap->Points;
+
+	if (InVFMap->FullField && Points.Num() == 1)
+	{
+		OriginOffset = Points.GetValue(0);
+		return;
+	}
+
+	// the positions are shared, so a map with the same as the last has its points at the same entries
+	if (!Points.GetPositions().IsValid() || Points.GetPositions() != LastPositions)
+	{
+		LastPositions = Points.GetPositions();
+		LastEntryIndices.Reset(Points.Num());
+
+		for (int32 i = 0; i < Points.Num(); ++i)
+		{
+			const FVector2D NormPosition(Points.GetX(i), Points.GetY(i));
+			const int32* FoundIndex = EntryIndices.Find(NormPosition);
+			int32 EntryIndex = FoundIndex ? *FoundIndex : INDEX_NONE;
+
+			if (EntryIndex == INDEX_NONE)
+			{
+				// the same transform as the points of BuildHeightMapTexture_RenderThread
+				FVARIDVFMapTableEntry& NewEntry = Entries.AddDefaulted_GetRef();
+				NewEntry.X = ((NormPosition.X + InGazePoint.X) * InXScale) + InXOffset;
+				NewEntry.Y = (NormPosition.Y + InGazePoint.Y);
+				EntryIndex = Entries.Num() - 1;
+				EntryIndices.Add(NormPosition, EntryIndex);
+			}
+
+			LastEntryIndices.Add(EntryIndex);
+		}
+	}
+
+	for (int32 i = 0; i < Points.Num(); ++i)
+	{
+		FVARIDVFMapTableEntry& Entry = Entries[LastEntryIndices[i]];
+		Entry.ChannelMask |= GetChannelBit(InChannel);
+		Entry.Values[InChannel] += Points.GetValue(i);
+	}
+
+	NumPoints[InChannel][CurrentEye] += Points.Num();
+	EyeEntryRange[CurrentEye * 2 + 1] = Entries.Num() - EyeEntryRange[CurrentEye * 2];
+}
+
+void FVARIDVFMapPointTable::AddEye(const FVARIDEye* InEye, int32 InNumMips, bool bInWarp, float InXScale, float InXOffset, const FVector2D& InGazePoint)
+{
+	// image maps are drawn afterwards. The table treats their eye as having no points
+	auto PointVFMap = [](const FVARIDVFMap* InVFMap) -> const FVARIDVFMap*
+	{
+		return InVFMap && InVFMap->Image.IsValid() ? nullptr : InVFMap;
+	};
+
+	BeginEye();
+	AddVFMap(EVARIDVFMapChannel::Blur, InEye && InEye->Blur.Enabled ? PointVFMap(&InEye->Blur.VFMap) : nullptr, 0.0f, InXScale, InXOffset, InGazePoint);
+	AddVFMap(EVARIDVFMapChannel::Inpaint, InEye && InEye->Inpaint.Enabled ? PointVFMap(&InEye->Inpaint.VFMap) : nullptr, 0.0f, InXScale, InXOffset, InGazePoint);
+	AddVFMap(EVARIDVFMapChannel::Warp, InEye && InEye->Warp.Enabled && bInWarp ? PointVFMap(&InEye->Warp.VFMap) : nullptr, 0.5f, InXScale, InXOffset, InGazePoint);
+
+	for (int32 MipLevel = 0; MipLevel < InNumMips; ++MipLevel)
+	{
+		const bool bHasLevel = InEye && InEye->Contrast.Enabled && InEye->Contrast.VFMaps.IsValidIndex(MipLevel);
+		AddVFMap((EVARIDVFMapChannel::Type)(EVARIDVFMapChannel::Contrast0 + MipLevel), bHasLevel ? PointVFMap(&InEye->Contrast.VFMaps[MipLevel]) : nullptr, 0.0f, InXScale, InXOffset, InGazePoint);
+	}
+}
+
+int32 FVARIDVFMapPointTable::GetNumWeights(int32 InEyeIndex, uint32 InChannelMask) const
+{
+	int32 NumWeights = 0;
+
+	for (int32 i = EyeEntryRange[InEyeIndex * 2]; i < EyeEntryRange[InEyeIndex * 2] + EyeEntryRange[InEyeIndex * 2 + 1]; ++i)
+	{
+		NumWeights += (Entries[i].ChannelMask & InChannelMask) != 0 ? 1 : 0;
+	}
+
+	return NumWeights;
+}
+
+uint32 FVARIDVFMapPointTable::GetChannelBit(int32 InChannel)
+{
+	return 1u << InChannel;
+}
+
+void FVARIDVFMapPointTable::AddShaderPoints(const FVARIDVFMapPoints& InPoints, float InXScale, float InXOffset, const FVector2D& InGazePoint, TArray<FShaderParameterMapPoint>& InOutPoints)
+{
+	InOutPoints.Reserve(InOutPoints.Num() + InPoints.Num());
+
+	for (int32 i = 0; i < InPoints.Num(); ++i)
+	{
+		FShaderParameterMapPoint P;
+		P.X = ((InPoints.GetX(i) + InGazePoint.X) * InXScale) + InXOffset;
+		P.Y = (InPoints.GetY(i) + InGazePoint.Y);
+		P.Value = InPoints.GetValue(i);
+		P.Padding = 1.0f;	// makes the struct have 16 byte alignment
+		InOutPoints.Add(P);
+	}
+}
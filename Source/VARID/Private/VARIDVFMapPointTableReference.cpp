@@ -0,0 +1,388 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "VARIDPyramidLayout.h"
+#include "Math/RandomStream.h"
+#include "HAL/PlatformTime.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// VARIDVFMapCombinedCS.usf, which evaluates every VF map of a view from one FVARIDVFMapPointTable in a single dispatch. It must give the
+// maps the separate dispatches per map give, on one eye and on single pass stereo
+
+void FVARIDReference::EvaluatePlanVFMapsCombined(const FVARIDWorkingTexturePlan& InPlan, const FVARIDVFMapPointTable& InTable, int32 InNumMips, const FVector2D* InGradientStep, FVARIDImage& OutBlur, FVARIDImage& OutInpaint, TArray<FVARIDImage>& OutContrastMips, FVARIDImage& OutWarp, int64* OutNumWeights)
+{
+	check(InNumMips <= OutContrastMips.Num());
+
+	const float StdDev = 0.025f;	// must match VARIDVFMapCombinedCS.usf
+	const float RBFDenominator = 2.0f * StdDev * StdDev;
+
+	const FIntRect ActiveRect = InPlan.GetActiveRect();
+	const FVector4 SceneUVScaleBias = InPlan.GetSceneUVScaleBias();
+	const int32 RightEyeMinX = InPlan.Eyes.Num() > 1 ? InPlan.Eyes[1].WorkingRect.Min.X : MAX_int32;
+
+	const uint32 Level0Mask = FVARIDVFMapPointTable::GetChannelBit(EVARIDVFMapChannel::Blur) | FVARIDVFMapPointTable::GetChannelBit(EVARIDVFMapChannel::Inpaint)
+		| FVARIDVFMapPointTable::GetChannelBit(EVARIDVFMapChannel::Contrast0) | (InGradientStep ? FVARIDVFMapPointTable::GetChannelBit(EVARIDVFMapChannel::Warp) : 0u);
+
+	int64 NumWeights = 0;
+
+	// GetLevelTexel() in VARIDVFMapCombinedCS.usf
+	auto GetLevelTexel = [&](const FIntPoint& InLocalID, int32 InMipLevel, FIntPoint& OutPosition, FVector2D& OutUV, int32& OutEyeIndex)
+	{
+		const FIntRect LevelRect = FVARIDPyramidLayout::GetMipViewportRect(ActiveRect, InMipLevel);
+		const FIntPoint MipExtent(FMath::Max(InPlan.Extent.X >> InMipLevel, 1), FMath::Max(InPlan.Extent.Y >> InMipLevel, 1));
+
+		OutPosition = LevelRect.Min + InLocalID;
+		OutUV = FVector2D(
+			(OutPosition.X + 0.5f) / MipExtent.X * SceneUVScaleBias.X + SceneUVScaleBias.Z,
+			(OutPosition.Y + 0.5f) / MipExtent.Y * SceneUVScaleBias.Y + SceneUVScaleBias.W);
+		OutEyeIndex = OutPosition.X >= (RightEyeMinX >> InMipLevel) ? 1 : 0;
+
+		return InLocalID.X < LevelRect.Width() && InLocalID.Y < LevelRect.Height();
+	};
+
+	for (int32 LocalY = 0; LocalY < ActiveRect.Height(); ++LocalY)
+	{
+		for (int32 LocalX = 0; LocalX < ActiveRect.Width(); ++LocalX)
+		{
+			const FIntPoint LocalID(LocalX, LocalY);
+			FIntPoint Position;
+			FVector2D UV;
+			int32 EyeIndex = 0;
+
+			GetLevelTexel(LocalID, 0, Position, UV, EyeIndex);
+
+			// level 0: blur, inpaint, warp and contrast 0 share the weights
+			{
+				const int32 FirstEntry = InTable.EyeEntryRange[EyeIndex * 2];
+				const int32 NumEntries = InTable.EyeEntryRange[EyeIndex * 2 + 1];
+
+				float Blur = 0.0f;
+				float Inpaint = 0.0f;
+				float Contrast = 0.0f;
+				float Warp = 0.0f;
+				FVector2D WarpGradient(0.0f, 0.0f);
+
+				for (int32 i = FirstEntry; i < FirstEntry + NumEntries; ++i)
+				{
+					const FVARIDVFMapTableEntry& Entry = InTable.Entries[i];
+					if ((Entry.ChannelMask & Level0Mask) == 0)
+					{
+						continue;
+					}
+
+					const FVector2D Delta = UV - FVector2D(Entry.X, Entry.Y);
+					const float Weight = FMath::Exp(-Delta.SizeSquared() / RBFDenominator);
+					++NumWeights;
+
+					Blur += Weight * Entry.Values[EVARIDVFMapChannel::Blur];
+					Inpaint += Weight * Entry.Values[EVARIDVFMapChannel::Inpaint];
+					Contrast += Weight * Entry.Values[EVARIDVFMapChannel::Contrast0];
+					Warp += Weight * Entry.Values[EVARIDVFMapChannel::Warp];
+					WarpGradient += Delta * (Weight * Entry.Values[EVARIDVFMapChannel::Warp]);
+				}
+
+				auto GetOriginOffset = [&InTable, EyeIndex](int32 InChannel) { return EyeIndex == 1 ? InTable.OriginOffsets[InChannel].Y : InTable.OriginOffsets[InChannel].X; };
+
+				OutBlur.Store(Position.X, Position.Y, FVector4(FMath::Clamp(GetOriginOffset(EVARIDVFMapChannel::Blur) + Blur, 0.0f, 1.0f), 0.0f, 0.0f, 0.0f));
+				OutInpaint.Store(Position.X, Position.Y, FVector4(FMath::Clamp(GetOriginOffset(EVARIDVFMapChannel::Inpaint) + Inpaint, 0.0f, 1.0f), 0.0f, 0.0f, 0.0f));
+				OutContrastMips[0].Store(Position.X, Position.Y, FVector4(FMath::Clamp(GetOriginOffset(EVARIDVFMapChannel::Contrast0) + Contrast, 0.0f, 1.0f), 0.0f, 0.0f, 0.0f));
+
+				if (InGradientStep)
+				{
+					const float WarpHeight = GetOriginOffset(EVARIDVFMapChannel::Warp) + Warp;
+					const bool bClamped = WarpHeight <= 0.0f || WarpHeight >= 1.0f;
+					WarpGradient *= -2.0f / RBFDenominator;
+					OutWarp.Store(Position.X, Position.Y, bClamped ? FVector4(0.0f, 0.0f, 0.0f, 0.0f) : FVector4(-WarpGradient.X * InGradientStep->X, -WarpGradient.Y * InGradientStep->Y, 0.0f, 0.0f));
+				}
+			}
+
+			// the rest of the contrast levels, from the top left threads
+			for (int32 MipLevel = 1; MipLevel < InNumMips; ++MipLevel)
+			{
+				if (!GetLevelTexel(LocalID, MipLevel, Position, UV, EyeIndex))
+				{
+					break;
+				}
+
+				const int32 Channel = EVARIDVFMapChannel::Contrast0 + MipLevel;
+				const int32 FirstEntry = InTable.EyeEntryRange[EyeIndex * 2];
+				const int32 NumEntries = InTable.EyeEntryRange[EyeIndex * 2 + 1];
+
+				float Contrast = 0.0f;
+
+				for (int32 i = FirstEntry; i < FirstEntry + NumEntries; ++i)
+				{
+					const FVARIDVFMapTableEntry& Entry = InTable.Entries[i];
+					if ((Entry.ChannelMask & FVARIDVFMapPointTable::GetChannelBit(Channel)) == 0)
+					{
+						continue;
+					}
+
+					const FVector2D Delta = UV - FVector2D(Entry.X, Entry.Y);
+					Contrast += Entry.Values[Channel] * FMath::Exp(-Delta.SizeSquared() / RBFDenominator);
+					++NumWeights;
+				}
+
+				const float OriginOffset = EyeIndex == 1 ? InTable.OriginOffsets[Channel].Y : InTable.OriginOffsets[Channel].X;
+				OutContrastMips[MipLevel].Store(Position.X, Position.Y, FVector4(FMath::Clamp(OriginOffset + Contrast, 0.0f, 1.0f), 0.0f, 0.0f, 0.0f));
+			}
+		}
+	}
+
+	if (OutNumWeights)
+	{
+		*OutNumWeights = NumWeights;
+	}
+}
+
+bool FVARIDReference::ValidateVFMapCombined(FString& OutReport)
+{
+	const FVector2D FOV(100.0f, 100.0f);
+	const uint8 MaxNumMips = 10;	// must match MAX_NUM_MIP_LEVELS
+	const FVector2D GradientStep(0.002f, 0.002f);	// default of r.VARID.Warp.GradientStep
+	const float Tolerance = 1e-5f;	// points at the same position are summed before the weight, not after it
+
+	/*************************************************************/
+	// VF maps. The 24-2 maps share their positions, so level 0 shares most of its weights
+
+	FVARIDVFMap BlurVFMap;
+	FVARIDVFMap InpaintVFMap;
+	FVARIDVFMap WarpVFMap;
+	BuildVFMap242(FOV, 38, BlurVFMap);
+	BuildVFMap242(FOV, 39, InpaintVFMap);
+	BuildVFMap242(FOV, 40, WarpVFMap);
+
+	// a second point on top of one already there, at the edge where the sum is not clamped
+	TArray<FVARIDVFMapPoint> BlurPoints;
+	BlurVFMap.Points.GetPoints(BlurPoints);
+	BlurPoints.Add(BlurPoints[0]);
+	BlurPoints.Last().NormValue = 0.5f - BlurPoints[0].NormValue;
+	BlurVFMap.Points.SetPoints(BlurPoints);
+
+	// 24-2 for the first two levels, points of their own on the third, a full field on the fourth and nothing past that
+	TArray<FVARIDVFMap> ContrastVFMaps;
+	ContrastVFMaps.SetNum(4);
+	BuildVFMap242(FOV, 41, ContrastVFMaps[0]);
+	BuildVFMap242(FOV, 42, ContrastVFMaps[1]);
+
+	FRandomStream RandomStream(3838);
+	TArray<FVARIDVFMapPoint> ContrastPoints;
+	for (int32 i = 0; i < 48; ++i)
+	{
+		ContrastPoints.Add(FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand()));
+	}
+	ContrastVFMaps[2].Points.SetPoints(ContrastPoints);
+
+	ContrastVFMaps[3].FullField = true;
+	ContrastVFMaps[3].Points.SetPoints({ FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.5f, 0.5f, 0.3f) });
+
+	// the map of each channel of each eye, as BuildVFMapTexturesCombined_RenderThread picks them. Eye 1 has inpaint turned off
+	auto GetVFMap = [&](int32 InEyeIndex, int32 InChannel) -> const FVARIDVFMap*
+	{
+		switch (InChannel)
+		{
+		case EVARIDVFMapChannel::Blur: return &BlurVFMap;
+		case EVARIDVFMapChannel::Inpaint: return InEyeIndex == 0 ? &InpaintVFMap : nullptr;
+		case EVARIDVFMapChannel::Warp: return &WarpVFMap;
+		default: return ContrastVFMaps.IsValidIndex(InChannel - EVARIDVFMapChannel::Contrast0) ? &ContrastVFMaps[InChannel - EVARIDVFMapChannel::Contrast0] : nullptr;
+		}
+	};
+
+	/*************************************************************/
+	// one eye, and single pass stereo with a gap between the eyes. Small, so the CPU gets through every level of every map
+
+	struct FLayout
+	{
+		const TCHAR* Name;
+		EVARIDWorkingTextureMode Mode;
+		FIntPoint SceneExtent;
+		TArray<FIntRect> EyeRects;
+	};
+	FLayout Layouts[2];
+	Layouts[0].Name = TEXT("mono");
+	Layouts[0].Mode = EVARIDWorkingTextureMode::PerEye;
+	Layouts[0].SceneExtent = FIntPoint(320, 240);
+	Layouts[0].EyeRects.Add(FIntRect(0, 0, 320, 240));
+	Layouts[1].Name = TEXT("stereo");
+	Layouts[1].Mode = EVARIDWorkingTextureMode::SinglePassStereo;
+	Layouts[1].SceneExtent = FIntPoint(486, 250);
+	Layouts[1].EyeRects.Add(FIntRect(0, 0, 241, 249));
+	Layouts[1].EyeRects.Add(FIntRect(245, 0, 486, 249));
+
+	const FVector2D GazePoints[2] = { FVector2D(0.02f, -0.01f), FVector2D(-0.03f, 0.015f) };
+	const TCHAR* ChannelNames[3] = { TEXT("blur"), TEXT("inpaint"), TEXT("warp") };
+
+	float MaxError = 0.0f;
+	int64 NumSeparateWeights = 0;
+	int64 NumCombinedWeights = 0;
+	double SeparateSeconds = 0.0;
+	double CombinedSeconds = 0.0;
+	int32 NumSeparateDispatches = 0;
+
+	for (const FLayout& Layout : Layouts)
+	{
+		const FVARIDWorkingTexturePlan Plan = FVARIDWorkingTexturePlan::Create(Layout.Mode, Layout.SceneExtent, Layout.EyeRects, 0, MaxNumMips);
+		const int32 NumMips = Plan.NumMips;
+
+		if (Plan.Mode != Layout.Mode || NumMips <= ContrastVFMaps.Num())
+		{
+			OutReport = FString::Printf(TEXT("VARID: VF map combined FAILED. The %s layout did not get the plan it asked for (%d mips)"), Layout.Name, NumMips);
+			return false;
+		}
+
+		// the table, as BuildVFMapTexturesCombined_RenderThread builds it
+		FVARIDVFMapPointTable Table;
+		for (int32 EyeIndex = 0; EyeIndex < Plan.Eyes.Num(); ++EyeIndex)
+		{
+			const float XScale = Plan.Eyes.Num() > 1 ? 0.5f : 1.0f;
+			const float XOffset = Plan.Eyes.Num() > 1 && EyeIndex == 1 ? 0.5f : 0.0f;
+
+			Table.BeginEye();
+			for (int32 Channel = 0; Channel < EVARIDVFMapChannel::Contrast0 + NumMips; ++Channel)
+			{
+				Table.AddVFMap((EVARIDVFMapChannel::Type)Channel, GetVFMap(EyeIndex, Channel), Channel == EVARIDVFMapChannel::Warp ? 0.5f : 0.0f, XScale, XOffset, GazePoints[EyeIndex]);
+			}
+		}
+
+		FVARIDImage CombinedBlur(Plan.Extent);
+		FVARIDImage CombinedInpaint(Plan.Extent);
+		FVARIDImage CombinedWarp(Plan.Extent);
+		TArray<FVARIDImage> CombinedContrastMips;
+		for (int32 MipLevel = 0; MipLevel < NumMips; ++MipLevel)
+		{
+			CombinedContrastMips.Add(FVARIDImage(FIntPoint(FMath::Max(Plan.Extent.X >> MipLevel, 1), FMath::Max(Plan.Extent.Y >> MipLevel, 1))));
+		}
+
+		int64 NumWeights = 0;
+		double StartTime = FPlatformTime::Seconds();
+		EvaluatePlanVFMapsCombined(Plan, Table, NumMips, &GradientStep, CombinedBlur, CombinedInpaint, CombinedContrastMips, CombinedWarp, &NumWeights);
+		CombinedSeconds += FPlatformTime::Seconds() - StartTime;
+		NumCombinedWeights += NumWeights;
+
+		// a dispatch per map: the points and origin offsets BuildHeightMapTexture_RenderThread gives VARIDHeightMapCS.usf
+		for (int32 Channel = 0; Channel < EVARIDVFMapChannel::Contrast0 + NumMips; ++Channel)
+		{
+			const int32 MipLevel = Channel >= EVARIDVFMapChannel::Contrast0 ? Channel - EVARIDVFMapChannel::Contrast0 : 0;
+			const FIntPoint MipExtent(FMath::Max(Plan.Extent.X >> MipLevel, 1), FMath::Max(Plan.Extent.Y >> MipLevel, 1));
+			const FIntRect Rect = FVARIDPyramidLayout::GetMipViewportRect(Plan.GetActiveRect(), MipLevel);
+			const int32 RightEyeMinX = Plan.Eyes.Num() > 1 ? Plan.Eyes[1].WorkingRect.Min.X >> MipLevel : Rect.Max.X;
+
+			TArray<TArray<FVARIDVFMapPoint>> EyePoints;
+			FVector2D EyeOriginOffsets(Channel == EVARIDVFMapChannel::Warp ? 0.5f : 0.0f, Channel == EVARIDVFMapChannel::Warp ? 0.5f : 0.0f);
+
+			for (int32 EyeIndex = 0; EyeIndex < Plan.Eyes.Num(); ++EyeIndex)
+			{
+				const float XScale = Plan.Eyes.Num() > 1 ? 0.5f : 1.0f;
+				const float XOffset = Plan.Eyes.Num() > 1 && EyeIndex == 1 ? 0.5f : 0.0f;
+				const FVARIDVFMap* VFMap = GetVFMap(EyeIndex, Channel);
+				TArray<FVARIDVFMapPoint>& Points = EyePoints.AddDefaulted_GetRef();
+
+				if (VFMap && VFMap->FullField && VFMap->Points.Num() == 1)
+				{
+					(EyeIndex == 0 ? EyeOriginOffsets.X : EyeOriginOffsets.Y) = VFMap->Points.GetValue(0);
+				}
+				else if (VFMap)
+				{
+					VFMap->Points.GetPoints(Points);
+
+					for (FVARIDVFMapPoint& ScenePoint : Points)
+					{
+						ScenePoint.NormX = ((ScenePoint.NormX + GazePoints[EyeIndex].X) * XScale) + XOffset;
+						ScenePoint.NormY = ScenePoint.NormY + GazePoints[EyeIndex].Y;
+					}
+				}
+
+				const int32 NumEyeTexels = EyeIndex == 0 ? (FMath::Min(RightEyeMinX, Rect.Max.X) - Rect.Min.X) * Rect.Height() : (Rect.Max.X - RightEyeMinX) * Rect.Height();
+				NumSeparateWeights += (int64)NumEyeTexels * Points.Num();
+
+				if (Points.Num() != Table.NumPoints[Channel][EyeIndex])
+				{
+					OutReport = FString::Printf(TEXT("VARID: VF map combined FAILED. The %s table has %d points for channel %d of eye %d, not %d"), Layout.Name, Table.NumPoints[Channel][EyeIndex], Channel, EyeIndex, Points.Num());
+					return false;
+				}
+			}
+
+			const bool bWarp = Channel == EVARIDVFMapChannel::Warp;
+			FVARIDImage SeparateImage(MipExtent);
+
+			StartTime = FPlatformTime::Seconds();
+			EvaluatePlanHeightMap(Plan, EyePoints, MipLevel, SeparateImage, bWarp ? &GradientStep : nullptr, EyeOriginOffsets);
+			SeparateSeconds += FPlatformTime::Seconds() - StartTime;
+			++NumSeparateDispatches;
+
+			const FVARIDImage& CombinedImage = Channel == EVARIDVFMapChannel::Blur ? CombinedBlur : Channel == EVARIDVFMapChannel::Inpaint ? CombinedInpaint : bWarp ? CombinedWarp : CombinedContrastMips[MipLevel];
+
+			for (int32 Y = 0; Y < MipExtent.Y; ++Y)
+			{
+				for (int32 X = 0; X < MipExtent.X; ++X)
+				{
+					const FVector4 Separate = SeparateImage.Load(X, Y);
+					const FVector4 Combined = CombinedImage.Load(X, Y);
+					const float Error = FMath::Max(FMath::Abs(Separate.X - Combined.X), FMath::Abs(Separate.Y - Combined.Y));
+					MaxError = FMath::Max(MaxError, Error);
+
+					if (Error > Tolerance)
+					{
+						OutReport = FString::Printf(TEXT("VARID: VF map combined FAILED. The %s %s differs by %f at (%d, %d): (%f, %f) from a dispatch of its own, (%f, %f) combined"),
+							Layout.Name, Channel < EVARIDVFMapChannel::Contrast0 ? ChannelNames[Channel] : *FString::Printf(TEXT("contrast mip %d"), MipLevel), Error, X, Y, Separate.X, Separate.Y, Combined.X, Combined.Y);
+						return false;
+					}
+				}
+			}
+		}
+	}
+
+	// what a typical headset gets with the same 24-2 layout on blur, inpaint, warp and the first two contrast levels: exp() calls of a dispatch per map against the one dispatch
+	int64 NumHeadsetSeparateWeights = 0;
+	int64 NumHeadsetCombinedWeights = 0;
+	{
+		TArray<FIntRect> EyeRects;
+		EyeRects.Add(FIntRect(0, 0, 1440, 1600));
+		EyeRects.Add(FIntRect(1440, 0, 2880, 1600));
+		const FVARIDWorkingTexturePlan Plan = FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode::SinglePassStereo, FIntPoint(2880, 1600), EyeRects, 0, MaxNumMips);
+
+		FVARIDVFMapPointTable Table;
+		for (int32 EyeIndex = 0; EyeIndex < 2; ++EyeIndex)
+		{
+			Table.BeginEye();
+			for (int32 Channel = 0; Channel < EVARIDVFMapChannel::Contrast0 + Plan.NumMips; ++Channel)
+			{
+				Table.AddVFMap((EVARIDVFMapChannel::Type)Channel, Channel < EVARIDVFMapChannel::Contrast0 + 2 ? &BlurVFMap : nullptr, 0.0f, 0.5f, EyeIndex * 0.5f, FVector2D(0.0f, 0.0f));
+			}
+		}
+
+		const uint32 Level0Mask = FVARIDVFMapPointTable::GetChannelBit(EVARIDVFMapChannel::Blur) | FVARIDVFMapPointTable::GetChannelBit(EVARIDVFMapChannel::Inpaint)
+			| FVARIDVFMapPointTable::GetChannelBit(EVARIDVFMapChannel::Warp) | FVARIDVFMapPointTable::GetChannelBit(EVARIDVFMapChannel::Contrast0);
+
+		for (int32 MipLevel = 0; MipLevel < Plan.NumMips; ++MipLevel)
+		{
+			const FIntRect Rect = FVARIDPyramidLayout::GetMipViewportRect(Plan.GetActiveRect(), MipLevel);
+			const int32 RightEyeMinX = Plan.Eyes[1].WorkingRect.Min.X >> MipLevel;
+			const int64 NumEyeTexels[2] = { (int64)(RightEyeMinX - Rect.Min.X) * Rect.Height(), (int64)(Rect.Max.X - RightEyeMinX) * Rect.Height() };
+			const int32 Channel = EVARIDVFMapChannel::Contrast0 + MipLevel;
+
+			for (int32 EyeIndex = 0; EyeIndex < 2; ++EyeIndex)
+			{
+				NumHeadsetSeparateWeights += NumEyeTexels[EyeIndex] * Table.NumPoints[Channel][EyeIndex];
+				NumHeadsetCombinedWeights += NumEyeTexels[EyeIndex] * Table.GetNumWeights(EyeIndex, MipLevel == 0 ? Level0Mask : FVARIDVFMapPointTable::GetChannelBit(Channel));
+
+				if (MipLevel == 0)
+				{
+					NumHeadsetSeparateWeights += NumEyeTexels[EyeIndex] * (Table.NumPoints[EVARIDVFMapChannel::Blur][EyeIndex] + Table.NumPoints[EVARIDVFMapChannel::Inpaint][EyeIndex] + Table.NumPoints[EVARIDVFMapChannel::Warp][EyeIndex]);
+				}
+			}
+		}
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: VF map combined OK. One dispatch per plan gives the blur, inpaint, warp and contrast maps of %d dispatches on %d plans, within %f. ")
+		TEXT("%.2fx fewer exp() calls (%.2f ms instead of %.2f ms on the CPU). 24-2 blur, inpaint, warp and two contrast levels on 2x1440x1600 stereo: %.2fx fewer"),
+		NumSeparateDispatches, 2, MaxError, (double)NumSeparateWeights / FMath::Max(NumCombinedWeights, (int64)1), CombinedSeconds * 1000.0, SeparateSeconds * 1000.0,
+		(double)NumHeadsetSeparateWeights / FMath::Max(NumHeadsetCombinedWeights, (int64)1));
+	return true;
+}
+
+#endif
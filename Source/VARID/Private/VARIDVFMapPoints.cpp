@@ -0,0 +1,207 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDVFMapPoints.h"
+#include "VARIDProfile.h"
+#include "HAL/CriticalSection.h"
+#include "Misc/Crc.h"
+#include "Misc/ScopeLock.h"
+
+/** every set of positions in use. Profiles are loaded on more than one thread, e.g. by batches */
+static FCriticalSection GVARIDVFMapPositionsLock;
+static TArray<TWeakPtr<const FVARIDVFMapPositions, ESPMode::ThreadSafe>> GVARIDVFMapPositions;
+
+/** InPositions, or a set already in use that equals it */
+static TSharedPtr<const FVARIDVFMapPositions, ESPMode::ThreadSafe> SharePositions(FVARIDVFMapPositions& InPositions)
+{
+	InPositions.Hash = FCrc::MemCrc32(InPositions.X.GetData(), InPositions.X.Num() * sizeof(float));
+	InPositions.Hash = FCrc::MemCrc32(InPositions.Y.GetData(), InPositions.Y.Num() * sizeof(float), InPositions.Hash);
+
+	FScopeLock ScopeLock(&GVARIDVFMapPositionsLock);
+
+	// sets no map uses any more are dropped as they are come across
+	for (int32 i = GVARIDVFMapPositions.Num() - 1; i >= 0; --i)
+	{
+		TSharedPtr<const FVARIDVFMapPositions, ESPMode::ThreadSafe> Shared = GVARIDVFMapPositions[i].Pin();
+		if (!Shared.IsValid())
+		{
+			GVARIDVFMapPositions.RemoveAtSwap(i);
+			continue;
+		}
+
+		if (Shared->Hash == InPositions.Hash && Shared->X == InPositions.X && Shared->Y == InPositions.Y)
+		{
+			return Shared;
+		}
+	}
+
+	TSharedPtr<const FVARIDVFMapPositions, ESPMode::ThreadSafe> Shared = MakeShared<FVARIDVFMapPositions, ESPMode::ThreadSafe>(MoveTemp(InPositions));
+	GVARIDVFMapPositions.Add(Shared);
+	return Shared;
+}
+
+FVARIDVFMapPositions::FVARIDVFMapPositions()
+	: Hash(0)
+{
+
+}
+
+FVARIDVFMapPoints::FVARIDVFMapPoints()
+{
+
+}
+
+int32 FVARIDVFMapPoints::Num() const
+{
+	return Values.Num();
+}
+
+float FVARIDVFMapPoints::GetX(int32 InIndex) const
+{
+	return Positions->X[InIndex];
+}
+
+float FVARIDVFMapPoints::GetY(int32 InIndex) const
+{
+	return Positions->Y[InIndex];
+}
+
+float FVARIDVFMapPoints::GetValue(int32 InIndex) const
+{
+	return Values[InIndex];
+}
+
+void FVARIDVFMapPoints::SetValue(int32 InIndex, float InNormValue)
+{
+	Values[InIndex] = InNormValue;
+}
+
+FVARIDVFMapPoint FVARIDVFMapPoints::GetPoint(int32 InIndex) const
+{
+	if (RawPoints.IsValid())
+	{
+		return FVARIDVFMapPoint(RawPoints->X[InIndex], RawPoints->Y[InIndex], RawPoints->Value[InIndex], RawPoints->Min[InIndex], RawPoints->Max[InIndex], Positions->X[InIndex], Positions->Y[InIndex], Values[InIndex]);
+	}
+
+	return FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, Positions->X[InIndex], Positions->Y[InIndex], Values[InIndex]);
+}
+
+void FVARIDVFMapPoints::GetPoints(TArray<FVARIDVFMapPoint>& OutPoints) const
+{
+	OutPoints.Reset(Num());
+
+	for (int32 i = 0; i < Num(); ++i)
+	{
+		OutPoints.Add(GetPoint(i));
+	}
+}
+
+void FVARIDVFMapPoints::SetPoints(const TArray<FVARIDVFMapPoint>& InPoints, bool bInKeepRaw)
+{
+	Empty();
+
+	if (InPoints.Num() == 0)
+	{
+		return;
+	}
+
+	FVARIDVFMapPositions NewPositions;
+	NewPositions.X.Reserve(InPoints.Num());
+	NewPositions.Y.Reserve(InPoints.Num());
+	Values.Reserve(InPoints.Num());
+
+	for (const FVARIDVFMapPoint& Point : InPoints)
+	{
+		NewPositions.X.Add(Point.NormX);
+		NewPositions.Y.Add(Point.NormY);
+		Values.Add(Point.NormValue);
+	}
+
+	Positions = SharePositions(NewPositions);
+
+	if (bInKeepRaw)
+	{
+		TSharedPtr<FVARIDVFMapRawPoints, ESPMode::ThreadSafe> NewRawPoints = MakeShared<FVARIDVFMapRawPoints, ESPMode::ThreadSafe>();
+		NewRawPoints->X.Reserve(InPoints.Num());
+		NewRawPoints->Y.Reserve(InPoints.Num());
+		NewRawPoints->Value.Reserve(InPoints.Num());
+		NewRawPoints->Min.Reserve(InPoints.Num());
+		NewRawPoints->Max.Reserve(InPoints.Num());
+
+		for (const FVARIDVFMapPoint& Point : InPoints)
+		{
+			NewRawPoints->X.Add(Point.RawX);
+			NewRawPoints->Y.Add(Point.RawY);
+			NewRawPoints->Value.Add(Point.RawValue);
+			NewRawPoints->Min.Add(Point.Min);
+			NewRawPoints->Max.Add(Point.Max);
+		}
+
+		RawPoints = NewRawPoints;
+	}
+}
+
+void FVARIDVFMapPoints::Empty()
+{
+	Positions.Reset();
+	Values.Empty();
+	RawPoints.Reset();
+}
+
+bool FVARIDVFMapPoints::HasRawPoints() const
+{
+	return RawPoints.IsValid();
+}
+
+const TSharedPtr<const FVARIDVFMapPositions, ESPMode::ThreadSafe>& FVARIDVFMapPoints::GetPositions() const
+{
+	return Positions;
+}
+
+SIZE_T FVARIDVFMapPoints::GetAllocatedSize() const
+{
+	return Values.GetAllocatedSize();
+}
+
+SIZE_T FVARIDVFMapPoints::GetAllocatedSize(const TArray<const FVARIDVFMapPoints*>& InPoints)
+{
+	TArray<const void*> Counted;
+	SIZE_T Size = 0;
+
+	for (const FVARIDVFMapPoints* Points : InPoints)
+	{
+		Size += Points->GetAllocatedSize();
+
+		const FVARIDVFMapPositions* SharedPositions = Points->Positions.Get();
+		if (SharedPositions && !Counted.Contains(SharedPositions))
+		{
+			Counted.Add(SharedPositions);
+			Size += sizeof(FVARIDVFMapPositions) + SharedPositions->X.GetAllocatedSize() + SharedPositions->Y.GetAllocatedSize();
+		}
+
+		const FVARIDVFMapRawPoints* SharedRawPoints = Points->RawPoints.Get();
+		if (SharedRawPoints && !Counted.Contains(SharedRawPoints))
+		{
+			Counted.Add(SharedRawPoints);
+			Size += sizeof(FVARIDVFMapRawPoints) + SharedRawPoints->X.GetAllocatedSize() + SharedRawPoints->Y.GetAllocatedSize() + SharedRawPoints->Value.GetAllocatedSize()
+				+ SharedRawPoints->Min.GetAllocatedSize() + SharedRawPoints->Max.GetAllocatedSize();
+		}
+	}
+
+	return Size;
+}
+
+int32 FVARIDVFMapPoints::GetNumSharedPositions()
+{
+	FScopeLock ScopeLock(&GVARIDVFMapPositionsLock);
+
+	int32 NumInUse = 0;
+	for (const TWeakPtr<const FVARIDVFMapPositions, ESPMode::ThreadSafe>& WeakPositions : GVARIDVFMapPositions)
+	{
+		NumInUse += WeakPositions.IsValid() ? 1 : 0;
+	}
+
+	return NumInUse;
+}
@@ -0,0 +1,186 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "Math/RandomStream.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// FVARIDVFMapPoints sharing point positions between the VF maps of a profile. Copies share positions until one is edited, so edits must
+// only reach the map they were made on and unused positions must be released
+
+bool FVARIDReference::ValidateVFMapPoints(FString& OutReport)
+{
+	auto PointsAreEqual = [](const FVARIDVFMapPoint& A, const FVARIDVFMapPoint& B)
+	{
+		return A.RawX == B.RawX && A.RawY == B.RawY && A.RawValue == B.RawValue && A.Min == B.Min && A.Max == B.Max && A.NormX == B.NormX && A.NormY == B.NormY && A.NormValue == B.NormValue;
+	};
+
+	/*************************************************************/
+	// ten contrast levels of one eye: the same positions, each with its own values
+
+	const int32 NumPoints = 76;
+	const int32 NumPositionsBefore = FVARIDVFMapPoints::GetNumSharedPositions();
+
+	FRandomStream RandomStream(4747);
+
+	TArray<FVARIDVFMapPoint> Positions;
+	for (int32 i = 0; i < NumPoints; ++i)
+	{
+		Positions.Add(FVARIDVFMapPoint(RandomStream.FRandRange(-30.0f, 30.0f), RandomStream.FRandRange(-30.0f, 30.0f), 0.0f, 0.0f, 33.0f, RandomStream.FRand(), RandomStream.FRand(), 0.0f));
+	}
+
+	TArray<TArray<FVARIDVFMapPoint>> LevelPoints;
+	TArray<FVARIDVFMap> Levels;
+	Levels.SetNum(10);
+
+	for (int32 Level = 0; Level < Levels.Num(); ++Level)
+	{
+		TArray<FVARIDVFMapPoint>& Points = LevelPoints.AddDefaulted_GetRef();
+		Points = Positions;
+
+		for (FVARIDVFMapPoint& Point : Points)
+		{
+			Point.RawValue = (float)RandomStream.RandRange(0, 33);
+			Point.NormValue = Point.RawValue / 33.0f;
+		}
+
+		Levels[Level].Points.SetPoints(Points);
+	}
+
+	/*************************************************************/
+	// round trip
+
+	for (int32 Level = 0; Level < Levels.Num(); ++Level)
+	{
+		TArray<FVARIDVFMapPoint> Points;
+		Levels[Level].Points.GetPoints(Points);
+
+		if (Points.Num() != NumPoints)
+		{
+			OutReport = FString::Printf(TEXT("VARID: VF map points FAILED. Level %d gave back %d points. Expected %d"), Level, Points.Num(), NumPoints);
+			return false;
+		}
+
+		for (int32 i = 0; i < NumPoints; ++i)
+		{
+			if (!PointsAreEqual(Points[i], LevelPoints[Level][i]) || Levels[Level].Points.GetX(i) != Points[i].NormX || Levels[Level].Points.GetValue(i) != Points[i].NormValue)
+			{
+				OutReport = FString::Printf(TEXT("VARID: VF map points FAILED. Point %d of level %d did not come back as it was set"), i, Level);
+				return false;
+			}
+		}
+	}
+
+	FVARIDVFMapPoints WithoutRaw;
+	WithoutRaw.SetPoints(LevelPoints[0], false);
+	const FVARIDVFMapPoint Stripped = WithoutRaw.GetPoint(3);
+
+	if (WithoutRaw.HasRawPoints() || Stripped.RawX != 0.0f || Stripped.RawValue != 0.0f || Stripped.Min != 0.0f || Stripped.Max != 1.0f
+		|| Stripped.NormX != LevelPoints[0][3].NormX || Stripped.NormY != LevelPoints[0][3].NormY || Stripped.NormValue != LevelPoints[0][3].NormValue)
+	{
+		OutReport = TEXT("VARID: VF map points FAILED. Points set without their raw fields did not keep their normalised fields alone");
+		return false;
+	}
+
+	/*************************************************************/
+	// sharing: every level has the one set of positions, other positions have their own, and values belong to each map alone
+
+	for (int32 Level = 1; Level < Levels.Num(); ++Level)
+	{
+		if (Levels[Level].Points.GetPositions() != Levels[0].Points.GetPositions())
+		{
+			OutReport = FString::Printf(TEXT("VARID: VF map points FAILED. Level %d doesn't share the positions of level 0"), Level);
+			return false;
+		}
+	}
+
+	TArray<FVARIDVFMapPoint> MovedPoints = LevelPoints[0];
+	MovedPoints[NumPoints - 1].NormY += 0.01f;
+
+	FVARIDVFMap Moved;
+	Moved.Points.SetPoints(MovedPoints);
+
+	if (Moved.Points.GetPositions() == Levels[0].Points.GetPositions() || FVARIDVFMapPoints::GetNumSharedPositions() != NumPositionsBefore + 2)
+	{
+		OutReport = FString::Printf(TEXT("VARID: VF map points FAILED. A moved point shared the positions of the levels, or there are %d sets of positions in use. Expected %d"),
+			FVARIDVFMapPoints::GetNumSharedPositions(), NumPositionsBefore + 2);
+		return false;
+	}
+
+	FVARIDVFMap Copy = Levels[4];
+	Copy.Points.SetValue(7, 0.123f);
+
+	if (Levels[4].Points.GetValue(7) != LevelPoints[4][7].NormValue || Levels[5].Points.GetValue(7) != LevelPoints[5][7].NormValue || Copy.Points.GetX(7) != LevelPoints[4][7].NormX)
+	{
+		OutReport = TEXT("VARID: VF map points FAILED. Setting a value of a copy changed the map it was copied from, or another level");
+		return false;
+	}
+
+	Moved.Points.Empty();
+
+	if (FVARIDVFMapPoints::GetNumSharedPositions() != NumPositionsBefore + 1)
+	{
+		OutReport = FString::Printf(TEXT("VARID: VF map points FAILED. Emptying the only map with a set of positions left %d sets in use. Expected %d"),
+			FVARIDVFMapPoints::GetNumSharedPositions(), NumPositionsBefore + 1);
+		return false;
+	}
+
+	/*************************************************************/
+	// the point table reuses the entries of the last map when the positions are shared. The entries must be as if every point had been looked up
+
+	FVARIDEye Eye;
+	Eye.Contrast.Enabled = true;
+	Eye.Contrast.VFMaps = Levels;
+
+	FVARIDVFMapPointTable Table;
+	Table.AddEye(&Eye, Levels.Num(), false, 0.5f, 0.0f, FVector2D(0.01f, -0.02f));
+
+	if (Table.Entries.Num() != NumPoints)
+	{
+		OutReport = FString::Printf(TEXT("VARID: VF map points FAILED. Ten levels with the same %d positions gave %d table entries"), NumPoints, Table.Entries.Num());
+		return false;
+	}
+
+	for (int32 i = 0; i < NumPoints; ++i)
+	{
+		const FVARIDVFMapTableEntry& Entry = Table.Entries[i];
+
+		for (int32 Level = 0; Level < Levels.Num(); ++Level)
+		{
+			if (Entry.Values[EVARIDVFMapChannel::Contrast0 + Level] != LevelPoints[Level][i].NormValue)
+			{
+				OutReport = FString::Printf(TEXT("VARID: VF map points FAILED. Table entry %d has %f for level %d. Expected %f"), i, Entry.Values[EVARIDVFMapChannel::Contrast0 + Level], Level, LevelPoints[Level][i].NormValue);
+				return false;
+			}
+		}
+	}
+
+	/*************************************************************/
+	// memory against the same maps as arrays of FVARIDVFMapPoint
+
+	TArray<const FVARIDVFMapPoints*> AllPoints;
+	SIZE_T ArrayBytes = 0;
+
+	for (int32 Level = 0; Level < Levels.Num(); ++Level)
+	{
+		AllPoints.Add(&Levels[Level].Points);
+		ArrayBytes += LevelPoints[Level].GetAllocatedSize();
+	}
+
+	const SIZE_T Bytes = FVARIDVFMapPoints::GetAllocatedSize(AllPoints);
+
+	if (Bytes >= ArrayBytes)
+	{
+		OutReport = FString::Printf(TEXT("VARID: VF map points FAILED. Ten levels take %d bytes. As FVARIDVFMapPoint they take %d"), (int32)Bytes, (int32)ArrayBytes);
+		return false;
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: VF map points OK. Points round trip, levels share their positions, and ten levels of %d points take %d bytes against %d as FVARIDVFMapPoint"),
+		NumPoints, (int32)Bytes, (int32)ArrayBytes);
+	return true;
+}
+
+#endif
@@ -0,0 +1,179 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDVFMapResolution.h"
+
+const float FVARIDVFMapResolution::RBFStdDev = 0.025f;
+const int32 FVARIDVFMapResolution::MaxReductionFactor = 16;
+
+FVARIDVFMapNodeGrid::FVARIDVFMapNodeGrid()
+{
+	Factor = 1;
+	Size = FIntPoint(0, 0);
+	RightEyeNodeMinX = MAX_int32;
+	NodeTransform = FVector4(1.0f, 0.5f, 0.5f, 0.5f);
+	LastNode[0] = FIntPoint(0, 0);
+	LastNode[1] = FIntPoint(0, 0);
+}
+
+FVARIDVFMapNodeGrid FVARIDVFMapNodeGrid::Create(const FIntRect& InViewportRect, int32 InRightEyeMinX, int32 InFactor)
+{
+	FVARIDVFMapNodeGrid Grid;
+	Grid.Factor = FMath::Max(InFactor, 1);
+
+	if (Grid.Factor == 1)
+	{
+		return Grid;
+	}
+
+	const bool bTwoEyes = InRightEyeMinX < InViewportRect.Max.X;
+	const int32 Eye0Width = FMath::Min(InRightEyeMinX, InViewportRect.Max.X) - InViewportRect.Min.X;
+	const int32 NumNodes0 = FVARIDVFMapResolution::GetNumNodes(FMath::Max(Eye0Width, 0), Grid.Factor);
+	const int32 NumNodes1 = bTwoEyes ? FVARIDVFMapResolution::GetNumNodes(InViewportRect.Max.X - InRightEyeMinX, Grid.Factor) : 0;
+	const int32 NumNodesY = FVARIDVFMapResolution::GetNumNodes(InViewportRect.Height(), Grid.Factor);
+
+	Grid.Size = FIntPoint(NumNodes0 + NumNodes1, NumNodesY);
+	Grid.RightEyeNodeMinX = bTwoEyes ? NumNodes0 : MAX_int32;
+
+	// eye 1 counts its nodes from RightEyeNodeMinX, so its bias takes those back off
+	const float Eye0BiasX = InViewportRect.Min.X + 0.5f;
+	const float Eye1BiasX = bTwoEyes ? InRightEyeMinX + 0.5f - NumNodes0 * Grid.Factor : Eye0BiasX;
+	Grid.NodeTransform = FVector4((float)Grid.Factor, InViewportRect.Min.Y + 0.5f, Eye0BiasX, Eye1BiasX);
+
+	Grid.LastNode[0] = FIntPoint(NumNodes0 - 1, NumNodesY - 1);
+	Grid.LastNode[1] = FIntPoint(NumNodes0 + NumNodes1 - 1, NumNodesY - 1);
+
+	return Grid;
+}
+
+FVector2D FVARIDVFMapNodeGrid::GetTexelPosition(const FIntPoint& InNode) const
+{
+	const float BiasX = InNode.X >= RightEyeNodeMinX ? NodeTransform.W : NodeTransform.Z;
+	return FVector2D(InNode.X * NodeTransform.X + BiasX, InNode.Y * NodeTransform.X + NodeTransform.Y);
+}
+
+FVector2D FVARIDVFMapNodeGrid::GetNodePosition(const FVector2D& InTexelPosition, int32 InRightEyeMinX) const
+{
+	const float BiasX = InTexelPosition.X >= InRightEyeMinX ? NodeTransform.W : NodeTransform.Z;
+	return FVector2D((InTexelPosition.X - BiasX) / NodeTransform.X, (InTexelPosition.Y - NodeTransform.Y) / NodeTransform.X);
+}
+
+static const float CURVATURE_CELL_SIZE = 0.5f;		// in units of RBFStdDev
+static const float CURVATURE_MARGIN = 4.0f;		// in units of RBFStdDev. Beyond it every term is bounded by the same constant
+static const float CURVATURE_CUTOFF = 8.0f;		// in units of RBFStdDev. Terms further away than this are bounded without an exp(), or without being visited
+
+/**
+ * a bound on |d2g/dx2| * StdDev^2 for a unit gaussian term g, at every distance of at least InDistance StdDevs from its centre.
+ * d2g/dx2 = (tx^2 - 1) * exp(-t^2 / 2) / StdDev^2, and |tx^2 - 1| <= max(1, t^2 - 1). That is exp(-t^2 / 2) up to t = sqrt(2),
+ * then (t^2 - 1) * exp(-t^2 / 2), which peaks at t = sqrt(3) and falls after it
+ */
+static float GetCurvatureFalloff(float InDistance)
+{
+	const float PeakDistanceSquared = 3.0f;
+	const float Peak = 2.0f * FMath::Exp(-1.5f);
+
+	const float DistanceSquared = InDistance * InDistance;
+
+	if (DistanceSquared <= PeakDistanceSquared)
+	{
+		return FMath::Max(FMath::Exp(-0.5f * DistanceSquared), Peak);
+	}
+
+	return (DistanceSquared - 1.0f) * FMath::Exp(-0.5f * DistanceSquared);
+}
+
+float FVARIDVFMapResolution::GetCurvatureBound(const FVARIDVFMapPoints& InPoints, float InXScale)
+{
+	if (InPoints.Num() == 0)
+	{
+		return 0.0f;
+	}
+
+	// work in units of StdDev, where each term is a unit gaussian scaled by its value
+	TArray<FVector2D> Positions;
+	FVector2D BoundsMin(MAX_flt, MAX_flt);
+	FVector2D BoundsMax(-MAX_flt, -MAX_flt);
+	float SumAbsValue = 0.0f;
+
+	for (int32 i = 0; i < InPoints.Num(); ++i)
+	{
+		const FVector2D Position(InPoints.GetX(i) * InXScale / RBFStdDev, InPoints.GetY(i) / RBFStdDev);
+		Positions.Add(Position);
+		BoundsMin = FVector2D(FMath::Min(BoundsMin.X, Position.X), FMath::Min(BoundsMin.Y, Position.Y));
+		BoundsMax = FVector2D(FMath::Max(BoundsMax.X, Position.X), FMath::Max(BoundsMax.Y, Position.Y));
+		SumAbsValue += FMath::Abs(InPoints.GetValue(i));
+	}
+
+	// anywhere further than the margin from every point
+	float Bound = SumAbsValue * GetCurvatureFalloff(CURVATURE_MARGIN);
+
+	const float CutoffFalloff = GetCurvatureFalloff(CURVATURE_CUTOFF);
+	const FVector2D GridMin(BoundsMin.X - CURVATURE_MARGIN, BoundsMin.Y - CURVATURE_MARGIN);
+	const int32 NumCellsX = FMath::CeilToInt((BoundsMax.X - BoundsMin.X + 2.0f * CURVATURE_MARGIN) / CURVATURE_CELL_SIZE);
+	const int32 NumCellsY = FMath::CeilToInt((BoundsMax.Y - BoundsMin.Y + 2.0f * CURVATURE_MARGIN) / CURVATURE_CELL_SIZE);
+
+	// every term at its worst anywhere in a cell is the falloff at the nearest point of the cell to its centre. Every term is at least
+	// CutoffFalloff, so a cell starts from that for all of them and each term only adds what it has over it to the cells within the cutoff.
+	// A cell k cells away from the one a point is in is at least (k - 1) cells from it, which leaves CutoffCells on each side
+	const int32 CutoffCells = FMath::CeilToInt(CURVATURE_CUTOFF / CURVATURE_CELL_SIZE);
+	TArray<float> CellBounds;
+	CellBounds.Init(SumAbsValue * CutoffFalloff, NumCellsX * NumCellsY);
+
+	for (int32 i = 0; i < Positions.Num(); ++i)
+	{
+		const float AbsValue = FMath::Abs(InPoints.GetValue(i));
+		const int32 PointCellX = FMath::FloorToInt((Positions[i].X - GridMin.X) / CURVATURE_CELL_SIZE);
+		const int32 PointCellY = FMath::FloorToInt((Positions[i].Y - GridMin.Y) / CURVATURE_CELL_SIZE);
+
+		for (int32 CellY = FMath::Max(PointCellY - CutoffCells, 0); CellY <= FMath::Min(PointCellY + CutoffCells, NumCellsY - 1); ++CellY)
+		{
+			for (int32 CellX = FMath::Max(PointCellX - CutoffCells, 0); CellX <= FMath::Min(PointCellX + CutoffCells, NumCellsX - 1); ++CellX)
+			{
+				const FVector2D CellMin(GridMin.X + CellX * CURVATURE_CELL_SIZE, GridMin.Y + CellY * CURVATURE_CELL_SIZE);
+				const FVector2D CellMax(CellMin.X + CURVATURE_CELL_SIZE, CellMin.Y + CURVATURE_CELL_SIZE);
+
+				const float DeltaX = FMath::Max(FMath::Max(CellMin.X - Positions[i].X, Positions[i].X - CellMax.X), 0.0f);
+				const float DeltaY = FMath::Max(FMath::Max(CellMin.Y - Positions[i].Y, Positions[i].Y - CellMax.Y), 0.0f);
+				const float DistanceSquared = DeltaX * DeltaX + DeltaY * DeltaY;
+
+				if (DistanceSquared < CURVATURE_CUTOFF * CURVATURE_CUTOFF)
+				{
+					CellBounds[CellY * NumCellsX + CellX] += AbsValue * (GetCurvatureFalloff(FMath::Sqrt(DistanceSquared)) - CutoffFalloff);
+				}
+			}
+		}
+	}
+
+	for (const float CellBound : CellBounds)
+	{
+		Bound = FMath::Max(Bound, CellBound);
+	}
+
+	return Bound / (RBFStdDev * RBFStdDev);
+}
+
+float FVARIDVFMapResolution::GetErrorBound(float InCurvatureBound, const FVector2D& InNodeSpacing)
+{
+	// bilinear = linear in x, then linear in y. Each step is off by at most spacing^2 / 8 * |second derivative along it|
+	return (InNodeSpacing.X * InNodeSpacing.X + InNodeSpacing.Y * InNodeSpacing.Y) * InCurvatureBound / 8.0f;
+}
+
+int32 FVARIDVFMapResolution::GetReductionFactor(float InCurvatureBound, const FVector2D& InTexelSize, float InMaxError, int32 InMaxFactor)
+{
+	for (int32 Factor = FMath::RoundUpToPowerOfTwo(FMath::Max(InMaxFactor, 1)); Factor > 1; Factor /= 2)
+	{
+		if (Factor <= InMaxFactor && GetErrorBound(InCurvatureBound, InTexelSize * (float)Factor) <= InMaxError)
+		{
+			return Factor;
+		}
+	}
+
+	return 1;
+}
+
+int32 FVARIDVFMapResolution::GetNumNodes(int32 InNumTexels, int32 InFactor)
+{
+	return InNumTexels > 0 ? FMath::DivideAndRoundUp(InNumTexels - 1, InFactor) + 1 : 0;
+}
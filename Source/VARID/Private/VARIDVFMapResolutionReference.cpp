@@ -0,0 +1,368 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "VARIDPyramidLayout.h"
+#include "VARIDVFMapResolution.h"
+#include "Math/RandomStream.h"
+#include "HAL/PlatformTime.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// FVARIDVFMapResolution's curvature bound and the height maps evaluated on a coarser node grid and upsampled. The bound picks the upsample
+// factor, so it must never underestimate the curvature or the upsampled maps drift from the full resolution ones
+
+float FVARIDReference::EvaluateHeightUnclamped(const TArray<FVARIDVFMapPoint>& InPoints, const FVector2D& InUV)
+{
+	const float RBFDenominator = 2.0f * FVARIDVFMapResolution::RBFStdDev * FVARIDVFMapResolution::RBFStdDev;
+
+	float InterpolatedValue = 0.0f;
+
+	for (const FVARIDVFMapPoint& Point : InPoints)
+	{
+		InterpolatedValue += Point.NormValue * FMath::Exp(-FVector2D::DistSquared(InUV, FVector2D(Point.NormX, Point.NormY)) / RBFDenominator);
+	}
+
+	return InterpolatedValue;
+}
+
+void FVARIDReference::EvaluatePlanHeightMapUpsampled(const FVARIDWorkingTexturePlan& InPlan, const TArray<TArray<FVARIDVFMapPoint>>& InEyePoints, int32 InMipLevel, int32 InFactor, FVARIDImage& OutImage, int32* OutNumNodes)
+{
+	check(InEyePoints.Num() == InPlan.Eyes.Num());
+
+	const FIntRect Rect = FVARIDPyramidLayout::GetMipViewportRect(InPlan.GetActiveRect(), InMipLevel);
+	const FVector2D TexelSize(1.0f / OutImage.Size.X, 1.0f / OutImage.Size.Y);
+	const FVector4 SceneUVScaleBias = InPlan.GetSceneUVScaleBias();
+	const int32 RightEyeMinX = InPlan.Eyes.Num() > 1 ? InPlan.Eyes[1].WorkingRect.Min.X >> InMipLevel : MAX_int32;
+
+	const FVARIDVFMapNodeGrid Grid = FVARIDVFMapNodeGrid::Create(Rect, RightEyeMinX, InFactor);
+
+	if (Grid.Factor == 1)
+	{
+		EvaluatePlanHeightMap(InPlan, InEyePoints, InMipLevel, OutImage);
+
+		if (OutNumNodes)
+		{
+			*OutNumNodes = Rect.Area();
+		}
+		return;
+	}
+
+	// VARIDHeightMapCS.usf with bInClampOutput = 0, one thread per node
+	TArray<float> Nodes;
+	Nodes.SetNumUninitialized(Grid.Size.X * Grid.Size.Y);
+
+	for (int32 NodeY = 0; NodeY < Grid.Size.Y; ++NodeY)
+	{
+		for (int32 NodeX = 0; NodeX < Grid.Size.X; ++NodeX)
+		{
+			const FVector2D Position = Grid.GetTexelPosition(FIntPoint(NodeX, NodeY));
+			const FVector2D UV(
+				Position.X * TexelSize.X * SceneUVScaleBias.X + SceneUVScaleBias.Z,
+				Position.Y * TexelSize.Y * SceneUVScaleBias.Y + SceneUVScaleBias.W);
+
+			Nodes[NodeY * Grid.Size.X + NodeX] = EvaluateHeightUnclamped(InEyePoints[NodeX >= Grid.RightEyeNodeMinX ? 1 : 0], UV);
+		}
+	}
+
+	// VARIDVFMapUpsampleCS.usf
+	for (int32 Y = Rect.Min.Y; Y < Rect.Max.Y; ++Y)
+	{
+		for (int32 X = Rect.Min.X; X < Rect.Max.X; ++X)
+		{
+			const FIntPoint& LastNode = Grid.LastNode[X >= RightEyeMinX ? 1 : 0];
+			const FVector2D Node = Grid.GetNodePosition(FVector2D(X + 0.5f, Y + 0.5f), RightEyeMinX);
+			const FIntPoint Node0(FMath::Min(FMath::FloorToInt(Node.X), LastNode.X), FMath::Min(FMath::FloorToInt(Node.Y), LastNode.Y));
+			const FIntPoint Node1(FMath::Min(Node0.X + 1, LastNode.X), FMath::Min(Node0.Y + 1, LastNode.Y));
+			const FVector2D Fraction(Node.X - Node0.X, Node.Y - Node0.Y);
+
+			auto Load = [&Nodes, &Grid](int32 InX, int32 InY) { return Nodes[InY * Grid.Size.X + InX]; };
+
+			const float Top = FMath::Lerp(Load(Node0.X, Node0.Y), Load(Node1.X, Node0.Y), Fraction.X);
+			const float Bottom = FMath::Lerp(Load(Node0.X, Node1.Y), Load(Node1.X, Node1.Y), Fraction.X);
+
+			OutImage.Store(X, Y, FVector4(FMath::Clamp(FMath::Lerp(Top, Bottom, Fraction.Y), 0.0f, 1.0f), 0.0f, 0.0f, 0.0f));
+		}
+	}
+
+	if (OutNumNodes)
+	{
+		*OutNumNodes = Nodes.Num();
+	}
+}
+
+bool FVARIDReference::ValidateVFMapResolution(FString& OutReport)
+{
+	const FVector2D FOV(100.0f, 100.0f);
+	const uint8 MaxNumMips = 10;	// must match MAX_NUM_MIP_LEVELS
+	const float MaxErrors[2] = { 1.0f / 512.0f, 1.0f / 128.0f };	// the default of r.VARID.VFMap.LowResMaxError, and a looser one
+	const float FloatTolerance = 1e-5f;	// the nodes and the full resolution texels are summed in float
+	const float CurvatureStep = FVARIDVFMapResolution::RBFStdDev / 8.0f;
+
+	/*************************************************************/
+	// VF maps
+
+	FVARIDVFMap VFMap242;
+	BuildVFMap242(FOV, 37, VFMap242);
+
+	FVARIDVFMap RandomVFMap;
+	FRandomStream RandomStream(3737);
+	TArray<FVARIDVFMapPoint> RandomPoints;
+	for (int32 i = 0; i < 128; ++i)
+	{
+		RandomPoints.Add(FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand() * 2.0f - 1.0f));
+	}
+	RandomVFMap.Points.SetPoints(RandomPoints);
+
+	// the steepest a single point gets
+	FVARIDVFMap BumpVFMap;
+	BumpVFMap.Points.SetPoints({ FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.3f, 0.6f, 1.0f) });
+
+	// far past 1 in the middle, so the clamp flattens it after the upsample
+	FVARIDVFMap ClusterVFMap;
+	TArray<FVARIDVFMapPoint> ClusterPoints;
+	for (int32 i = 0; i < 6; ++i)
+	{
+		ClusterPoints.Add(FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.5f + 0.01f * FMath::Cos(i * 1.047f), 0.5f + 0.01f * FMath::Sin(i * 1.047f), 0.7f));
+	}
+	ClusterVFMap.Points.SetPoints(ClusterPoints);
+
+	FVARIDVFMap* VFMaps[4] = { &VFMap242, &RandomVFMap, &BumpVFMap, &ClusterVFMap };
+	const TCHAR* VFMapNames[4] = { TEXT("24-2"), TEXT("random"), TEXT("bump"), TEXT("cluster") };
+
+	/*************************************************************/
+	// the bound against a central difference of the field, over and around the points
+
+	float MinTightness = MAX_flt;
+
+	for (int32 i = 0; i < 4; ++i)
+	{
+		for (int32 Stereo = 0; Stereo < 2; ++Stereo)
+		{
+			const float XScale = Stereo ? 0.5f : 1.0f;
+			const float Bound = VFMaps[i]->GetCurvatureBound(XScale);
+
+			if (Bound != FVARIDVFMapResolution::GetCurvatureBound(VFMaps[i]->Points, XScale))
+			{
+				OutReport = FString::Printf(TEXT("VARID: VF map resolution FAILED. The cached %s curvature bound (XScale %.1f) is not the one worked out"), VFMapNames[i], XScale);
+				return false;
+			}
+
+			TArray<FVARIDVFMapPoint> Points;
+			VFMaps[i]->Points.GetPoints(Points);
+			for (FVARIDVFMapPoint& ScenePoint : Points)
+			{
+				ScenePoint.NormX *= XScale;
+			}
+
+			float MaxCurvature = 0.0f;
+			for (float Y = -0.1f; Y <= 1.1f; Y += CurvatureStep * 1.7f)
+			{
+				for (float X = -0.1f * XScale; X <= 1.1f * XScale; X += CurvatureStep * 1.7f * XScale)
+				{
+					const float Centre = EvaluateHeightUnclamped(Points, FVector2D(X, Y));
+					const float CurvatureX = (EvaluateHeightUnclamped(Points, FVector2D(X + CurvatureStep, Y)) - 2.0f * Centre + EvaluateHeightUnclamped(Points, FVector2D(X - CurvatureStep, Y))) / (CurvatureStep * CurvatureStep);
+					const float CurvatureY = (EvaluateHeightUnclamped(Points, FVector2D(X, Y + CurvatureStep)) - 2.0f * Centre + EvaluateHeightUnclamped(Points, FVector2D(X, Y - CurvatureStep))) / (CurvatureStep * CurvatureStep);
+					MaxCurvature = FMath::Max(MaxCurvature, FMath::Max(FMath::Abs(CurvatureX), FMath::Abs(CurvatureY)));
+				}
+			}
+
+			if (MaxCurvature > Bound)
+			{
+				OutReport = FString::Printf(TEXT("VARID: VF map resolution FAILED. The %s map curves by %f (XScale %.1f), past its bound of %f"), VFMapNames[i], MaxCurvature, XScale, Bound);
+				return false;
+			}
+
+			MinTightness = FMath::Min(MinTightness, MaxCurvature / Bound);
+		}
+	}
+
+	/*************************************************************/
+	// upsampled against full resolution: one eye, and single pass stereo with a gap between the eyes
+
+	struct FLayout
+	{
+		const TCHAR* Name;
+		EVARIDWorkingTextureMode Mode;
+		FIntPoint SceneExtent;
+		TArray<FIntRect> EyeRects;
+	};
+	FLayout Layouts[2];
+	Layouts[0].Name = TEXT("mono");
+	Layouts[0].Mode = EVARIDWorkingTextureMode::PerEye;
+	Layouts[0].SceneExtent = FIntPoint(960, 720);
+	Layouts[0].EyeRects.Add(FIntRect(0, 0, 960, 720));
+	Layouts[1].Name = TEXT("stereo");
+	Layouts[1].Mode = EVARIDWorkingTextureMode::SinglePassStereo;
+	Layouts[1].SceneExtent = FIntPoint(1446, 700);
+	Layouts[1].EyeRects.Add(FIntRect(0, 0, 721, 699));
+	Layouts[1].EyeRects.Add(FIntRect(725, 0, 1446, 699));
+
+	const int32 MipLevels[2] = { 0, 2 };
+
+	float MaxErrorToBound = 0.0f;
+	float MaxError = 0.0f;
+	int64 NumFullEvaluations = 0;
+	int64 NumLowResEvaluations = 0;
+	double FullSeconds = 0.0;
+	double LowResSeconds = 0.0;
+	int32 NumReduced = 0;
+	int32 NumCases = 0;
+	FString Factors;
+
+	for (const FLayout& Layout : Layouts)
+	{
+		const FVARIDWorkingTexturePlan Plan = FVARIDWorkingTexturePlan::Create(Layout.Mode, Layout.SceneExtent, Layout.EyeRects, 0, MaxNumMips);
+		const float XScale = Plan.Eyes.Num() > 1 ? 0.5f : 1.0f;
+
+		if (Plan.Mode != Layout.Mode)
+		{
+			OutReport = FString::Printf(TEXT("VARID: VF map resolution FAILED. The %s layout did not get the plan it asked for"), Layout.Name);
+			return false;
+		}
+
+		for (int32 MipLevel : MipLevels)
+		{
+			const FIntPoint MipExtent(FMath::Max(Plan.Extent.X >> MipLevel, 1), FMath::Max(Plan.Extent.Y >> MipLevel, 1));
+			const FIntRect Rect = FVARIDPyramidLayout::GetMipViewportRect(Plan.GetActiveRect(), MipLevel);
+			const int32 RightEyeMinX = Plan.Eyes.Num() > 1 ? Plan.Eyes[1].WorkingRect.Min.X >> MipLevel : MAX_int32;
+			const FVector4 SceneUVScaleBias = Plan.GetSceneUVScaleBias();
+			const FVector2D SceneTexelSize(SceneUVScaleBias.X / MipExtent.X, SceneUVScaleBias.Y / MipExtent.Y);
+
+			// every factor puts the first node of each eye on its first texel centre, and the last on or just past its last one
+			for (int32 Factor = 2; Factor <= FVARIDVFMapResolution::MaxReductionFactor; Factor *= 2)
+			{
+				const FVARIDVFMapNodeGrid Grid = FVARIDVFMapNodeGrid::Create(Rect, RightEyeMinX, Factor);
+
+				for (int32 EyeIndex = 0; EyeIndex < Plan.Eyes.Num(); ++EyeIndex)
+				{
+					const FVector2D FirstTexel(EyeIndex == 0 ? Rect.Min.X + 0.5f : RightEyeMinX + 0.5f, Rect.Min.Y + 0.5f);
+					const FVector2D LastTexel(EyeIndex == 0 && Plan.Eyes.Num() > 1 ? RightEyeMinX - 0.5f : Rect.Max.X - 0.5f, Rect.Max.Y - 0.5f);
+					const FVector2D FirstNode = Grid.GetTexelPosition(FIntPoint(EyeIndex == 0 ? 0 : Grid.RightEyeNodeMinX, 0));
+					const FVector2D LastNode = Grid.GetTexelPosition(Grid.LastNode[EyeIndex]);
+
+					if (FirstNode != FirstTexel || LastNode.X < LastTexel.X || LastNode.Y < LastTexel.Y || LastNode.X >= LastTexel.X + Factor || LastNode.Y >= LastTexel.Y + Factor)
+					{
+						OutReport = FString::Printf(TEXT("VARID: VF map resolution FAILED. The %s mip %d nodes of eye %d at factor %d run from (%.1f, %.1f) to (%.1f, %.1f), the texels from (%.1f, %.1f) to (%.1f, %.1f)"),
+							Layout.Name, MipLevel, EyeIndex, Factor, FirstNode.X, FirstNode.Y, LastNode.X, LastNode.Y, FirstTexel.X, FirstTexel.Y, LastTexel.X, LastTexel.Y);
+						return false;
+					}
+				}
+			}
+
+			for (int32 i = 0; i < 4; ++i)
+			{
+				// the same points, and the same factor, as BuildHeightMapTexture_RenderThread. Both eyes of the stereo plan get the same map
+				TArray<TArray<FVARIDVFMapPoint>> EyePoints;
+				float CurvatureBound = VFMaps[i]->GetCurvatureBound(XScale);
+
+				for (int32 EyeIndex = 0; EyeIndex < Plan.Eyes.Num(); ++EyeIndex)
+				{
+					const float XOffset = Plan.Eyes.Num() > 1 && EyeIndex == 1 ? 0.5f : 0.0f;
+					TArray<FVARIDVFMapPoint>& Points = EyePoints.AddDefaulted_GetRef();
+					VFMaps[i]->Points.GetPoints(Points);
+
+					for (FVARIDVFMapPoint& ScenePoint : Points)
+					{
+						ScenePoint.NormX = ScenePoint.NormX * XScale + XOffset;
+					}
+				}
+
+				FVARIDImage FullHeightMap(MipExtent);
+				bool bFullHeightMapBuilt = false;
+
+				for (float MaxErrorSetting : MaxErrors)
+				{
+					const int32 Factor = FVARIDVFMapResolution::GetReductionFactor(CurvatureBound, SceneTexelSize, MaxErrorSetting, FVARIDVFMapResolution::MaxReductionFactor);
+					const float ErrorBound = FVARIDVFMapResolution::GetErrorBound(CurvatureBound, SceneTexelSize * (float)Factor);
+
+					Factors += FString::Printf(TEXT("%s%s/%s/mip %d/1/%d: %d"), NumCases > 0 ? TEXT(", ") : TEXT(""), VFMapNames[i], Layout.Name, MipLevel, FMath::RoundToInt(1.0f / MaxErrorSetting), Factor);
+					++NumCases;
+
+					if (Factor == 1)
+					{
+						continue;
+					}
+
+					if (ErrorBound > MaxErrorSetting || (Factor < FVARIDVFMapResolution::MaxReductionFactor && FVARIDVFMapResolution::GetErrorBound(CurvatureBound, SceneTexelSize * (float)(Factor * 2)) <= MaxErrorSetting))
+					{
+						OutReport = FString::Printf(TEXT("VARID: VF map resolution FAILED. Factor %d for the %s map is not the coarsest within %f"), Factor, VFMapNames[i], MaxErrorSetting);
+						return false;
+					}
+
+					if (!bFullHeightMapBuilt)
+					{
+						const double StartTime = FPlatformTime::Seconds();
+						EvaluatePlanHeightMap(Plan, EyePoints, MipLevel, FullHeightMap);
+						FullSeconds += FPlatformTime::Seconds() - StartTime;
+						bFullHeightMapBuilt = true;
+					}
+
+					FVARIDImage LowResHeightMap(MipExtent);
+					int32 NumNodes = 0;
+
+					const double StartTime = FPlatformTime::Seconds();
+					EvaluatePlanHeightMapUpsampled(Plan, EyePoints, MipLevel, Factor, LowResHeightMap, &NumNodes);
+					LowResSeconds += FPlatformTime::Seconds() - StartTime;
+
+					NumFullEvaluations += (int64)Rect.Area() * VFMaps[i]->Points.Num();
+					NumLowResEvaluations += (int64)NumNodes * VFMaps[i]->Points.Num();
+					++NumReduced;
+
+					for (int32 Y = Rect.Min.Y; Y < Rect.Max.Y; ++Y)
+					{
+						for (int32 X = Rect.Min.X; X < Rect.Max.X; ++X)
+						{
+							const float Error = FMath::Abs(LowResHeightMap.Load(X, Y).X - FullHeightMap.Load(X, Y).X);
+							MaxError = FMath::Max(MaxError, Error);
+							MaxErrorToBound = FMath::Max(MaxErrorToBound, Error / ErrorBound);
+
+							if (Error > ErrorBound + FloatTolerance)
+							{
+								OutReport = FString::Printf(TEXT("VARID: VF map resolution FAILED. The %s map upsampled %dx on the %s mip %d plan is %f away at (%d, %d), past its bound of %f"),
+									VFMapNames[i], Factor, Layout.Name, MipLevel, Error, X, Y, ErrorBound);
+								return false;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (NumReduced == 0)
+	{
+		OutReport = FString::Printf(TEXT("VARID: VF map resolution FAILED. No case allowed a coarser grid. Factors %s"), *Factors);
+		return false;
+	}
+
+	// what a typical headset gets: the factor of the 24-2 map on each mip of a single pass stereo plan, at the default error, and the nodes summed instead of texels
+	FString HeadsetFactors;
+	{
+		TArray<FIntRect> EyeRects;
+		EyeRects.Add(FIntRect(0, 0, 1440, 1600));
+		EyeRects.Add(FIntRect(1440, 0, 2880, 1600));
+		const FVARIDWorkingTexturePlan Plan = FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode::SinglePassStereo, FIntPoint(2880, 1600), EyeRects, 0, MaxNumMips);
+		const FVector4 SceneUVScaleBias = Plan.GetSceneUVScaleBias();
+
+		for (int32 MipLevel = 0; MipLevel < 4; ++MipLevel)
+		{
+			const FIntPoint MipExtent(FMath::Max(Plan.Extent.X >> MipLevel, 1), FMath::Max(Plan.Extent.Y >> MipLevel, 1));
+			const FIntRect Rect = FVARIDPyramidLayout::GetMipViewportRect(Plan.GetActiveRect(), MipLevel);
+			const int32 Factor = FVARIDVFMapResolution::GetReductionFactor(VFMap242.GetCurvatureBound(0.5f), FVector2D(SceneUVScaleBias.X / MipExtent.X, SceneUVScaleBias.Y / MipExtent.Y), MaxErrors[0], FVARIDVFMapResolution::MaxReductionFactor);
+			const FVARIDVFMapNodeGrid Grid = FVARIDVFMapNodeGrid::Create(Rect, Plan.Eyes[1].WorkingRect.Min.X >> MipLevel, Factor);
+			const int32 NumNodes = Factor > 1 ? Grid.Size.X * Grid.Size.Y : Rect.Area();
+
+			HeadsetFactors += FString::Printf(TEXT("%smip %d: %d (%d of %d)"), MipLevel > 0 ? TEXT(", ") : TEXT(""), MipLevel, Factor, NumNodes, Rect.Area());
+		}
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: VF map resolution OK. Curvature bounds hold, and are never more than %.1fx the measured curvature. Upsampled maps within %f, %.2f of their error bound at most. ")
+		TEXT("%d of %d cases reduced, summing the RBF %.1fx fewer times (%.2f ms instead of %.2f ms on the CPU). Factors (map/plan/mip/max error: factor) %s. 24-2 on 2x1440x1600 stereo: %s"),
+		1.0f / MinTightness, MaxError, MaxErrorToBound, NumReduced, NumCases, (double)NumFullEvaluations / FMath::Max(NumLowResEvaluations, (int64)1), LowResSeconds * 1000.0, FullSeconds * 1000.0, *Factors, *HeadsetFactors);
+	return true;
+}
+
+#endif
@@ -0,0 +1,58 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDViewProfiles.h"
+
+bool FVARIDViewProfiles::IsEmpty() const
+{
+	return ByViewIndex.Num() == 0 && ByPlayerIndex.Num() == 0;
+}
+
+const FVARIDProfile& FVARIDViewProfiles::Find(int32 InViewIndex, int32 InPlayerIndex, const FVARIDProfile& InActiveProfile) const
+{
+	if (const FVARIDProfile* ViewProfile = ByViewIndex.Find(InViewIndex))
+	{
+		return *ViewProfile;
+	}
+
+	if (const FVARIDProfile* PlayerProfile = ByPlayerIndex.Find(InPlayerIndex))
+	{
+		return *PlayerProfile;
+	}
+
+	return InActiveProfile;
+}
+
+uint32 FVARIDViewProfiles::GetInpaintHash(const FVARIDEye* InEye, const FVector2D& InGazePoint)
+{
+	// no inpaint: the inpainted colour is the scene colour, whatever the gaze
+	if (!InEye || !InEye->Inpaint.Enabled)
+	{
+		return 0;
+	}
+
+	const FVARIDVFMap& VFMap = InEye->Inpaint.VFMap;
+
+	uint32 Hash = HashCombine(GetTypeHash(InGazePoint.X), GetTypeHash(InGazePoint.Y));
+	Hash = HashCombine(Hash, GetTypeHash(VFMap.FullField));
+	Hash = HashCombine(Hash, GetTypeHash(VFMap.Points.Num()));
+
+	for (int32 i = 0; i < VFMap.Points.Num(); ++i)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(VFMap.Points.GetX(i)));
+		Hash = HashCombine(Hash, GetTypeHash(VFMap.Points.GetY(i)));
+		Hash = HashCombine(Hash, GetTypeHash(VFMap.Points.GetValue(i)));
+	}
+
+	// an image that finishes loading between two views changes what they draw
+	if (VFMap.Image.IsValid())
+	{
+		Hash = HashCombine(Hash, PointerHash(VFMap.Image.Get()));
+		Hash = HashCombine(Hash, GetTypeHash(VFMap.Image->IsLoaded()));
+	}
+
+	// never 0, so an eye with inpaint on can't match one with it off
+	return Hash | 1u;
+}
@@ -0,0 +1,190 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// FVARIDViewProfiles' resolution of the profile of each view. Views share pyramids to save work, which is only correct when their inpainted
+// colour and working layout are the same
+
+bool FVARIDReference::ValidateViewProfiles(FString& OutReport)
+{
+	FVARIDProfile Active;
+	Active.Name = TEXT("Active");
+	Active.IsValid = true;
+
+	FVARIDProfile ViewOne = Active;
+	ViewOne.Name = TEXT("ViewOne");
+
+	FVARIDProfile PlayerOne = Active;
+	PlayerOne.Name = TEXT("PlayerOne");
+
+	// split screen: player 1 gets their own profile, view 2 is a spectator left unprocessed
+	FVARIDViewProfiles ViewProfiles;
+	if (!ViewProfiles.IsEmpty() || &ViewProfiles.Find(0, 0, Active) != &Active)
+	{
+		OutReport = TEXT("VARID: View profiles FAILED. With no view profiles a view did not get the active profile");
+		return false;
+	}
+
+	ViewProfiles.ByPlayerIndex.Add(1, PlayerOne);
+	ViewProfiles.ByViewIndex.Add(1, ViewOne);
+	ViewProfiles.ByViewIndex.Add(2, FVARIDProfile());
+
+	struct FCase
+	{
+		int32 ViewIndex;
+		int32 PlayerIndex;
+		const TCHAR* Expected;
+	};
+	const FCase Cases[] =
+	{
+		{ 0, 0, TEXT("Active") },
+		{ 1, 1, TEXT("ViewOne") },		// the view wins over its player
+		{ 3, 1, TEXT("PlayerOne") },
+		{ INDEX_NONE, 0, TEXT("Active") },
+	};
+
+	for (const FCase& Case : Cases)
+	{
+		const FVARIDProfile& Found = ViewProfiles.Find(Case.ViewIndex, Case.PlayerIndex, Active);
+		if (Found.Name != Case.Expected || !Found.IsValid)
+		{
+			OutReport = FString::Printf(TEXT("VARID: View profiles FAILED. View %d of player %d got %s, expected %s"), Case.ViewIndex, Case.PlayerIndex, *Found.Name, Case.Expected);
+			return false;
+		}
+	}
+
+	if (ViewProfiles.Find(2, 1, Active).IsValid)
+	{
+		OutReport = TEXT("VARID: View profiles FAILED. A view given a profile that isn't valid would be processed");
+		return false;
+	}
+
+	/*************************************************************/
+	// the inpaint hash must follow the inpainted colour and nothing else
+
+	FVARIDEye Eye;
+	Eye.Inpaint.Enabled = true;
+	TArray<FVARIDVFMapPoint> InpaintPoints = { FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.4f, 0.5f, 0.8f), FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.6f, 0.3f, 0.2f) };
+	Eye.Inpaint.VFMap.Points.SetPoints(InpaintPoints);
+	const FVector2D Gaze(0.1f, -0.05f);
+	const uint32 Hash = FVARIDViewProfiles::GetInpaintHash(&Eye, Gaze);
+
+	FVARIDEye OtherFX = Eye;
+	OtherFX.Blur.Enabled = !Eye.Blur.Enabled;
+	OtherFX.Contrast.Enabled = !Eye.Contrast.Enabled;
+	OtherFX.Warp.Enabled = !Eye.Warp.Enabled;
+	OtherFX.Blur.VFMap.Points.SetPoints({ FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.5f, 0.5f, 1.0f) });
+
+	FVARIDEye OtherValue = Eye;
+	OtherValue.Inpaint.VFMap.Points.SetValue(1, 0.25f);
+
+	FVARIDEye OtherPosition = Eye;
+	InpaintPoints[0].NormX = 0.41f;
+	OtherPosition.Inpaint.VFMap.Points.SetPoints(InpaintPoints);
+
+	FVARIDEye Disabled = Eye;
+	Disabled.Inpaint.Enabled = false;
+
+	FVARIDEye DisabledOtherPoints = Disabled;
+	DisabledOtherPoints.Inpaint.VFMap.Points.Empty();
+
+	struct FHashCase
+	{
+		const TCHAR* Name;
+		uint32 Hash;
+		bool bSame;
+	};
+	const FHashCase HashCases[] =
+	{
+		{ TEXT("other FX"), FVARIDViewProfiles::GetInpaintHash(&OtherFX, Gaze), true },
+		{ TEXT("an inpaint value"), FVARIDViewProfiles::GetInpaintHash(&OtherValue, Gaze), false },
+		{ TEXT("an inpaint position"), FVARIDViewProfiles::GetInpaintHash(&OtherPosition, Gaze), false },
+		{ TEXT("the gaze"), FVARIDViewProfiles::GetInpaintHash(&Eye, Gaze + FVector2D(0.01f, 0.0f)), false },
+		{ TEXT("inpaint off"), FVARIDViewProfiles::GetInpaintHash(&Disabled, Gaze), false },
+		{ TEXT("no profile"), FVARIDViewProfiles::GetInpaintHash(nullptr, Gaze), false },
+	};
+
+	for (const FHashCase& Case : HashCases)
+	{
+		if ((Case.Hash == Hash) != Case.bSame)
+		{
+			OutReport = FString::Printf(TEXT("VARID: View profiles FAILED. Changing %s %s the inpaint hash"), Case.Name, Case.bSame ? TEXT("changed") : TEXT("did not change"));
+			return false;
+		}
+	}
+
+	// with inpaint off every eye inpaints the same way - not at all - whatever its gaze or points, the same as an eye without a profile
+	if (FVARIDViewProfiles::GetInpaintHash(&Disabled, Gaze) != FVARIDViewProfiles::GetInpaintHash(&DisabledOtherPoints, FVector2D(0.3f, 0.3f))
+		|| FVARIDViewProfiles::GetInpaintHash(&Disabled, Gaze) != FVARIDViewProfiles::GetInpaintHash(nullptr, Gaze))
+	{
+		OutReport = TEXT("VARID: View profiles FAILED. Eyes without inpaint got different inpaint hashes");
+		return false;
+	}
+
+	// an image VF map changes what is drawn once it has loaded
+	FVARIDVFMapImagePixels Pixels;
+	Pixels.Size = FIntPoint(4, 4);
+	Pixels.Values.Init(0.5f, Pixels.Size.X * Pixels.Size.Y);
+
+	FVARIDEye ImageEye;
+	ImageEye.Inpaint.Enabled = true;
+	ImageEye.Inpaint.VFMap.Image = MakeShared<FVARIDVFMapImage, ESPMode::ThreadSafe>(TEXT("inpaint"), 0.0f, 1.0f, FVector2D(0.0f, 0.0f), FVector2D(1.0f, 1.0f));
+	const uint32 NotLoadedHash = FVARIDViewProfiles::GetInpaintHash(&ImageEye, Gaze);
+	ImageEye.Inpaint.VFMap.Image->BeginLoad(MakeGeneratedVFMapImageDecode(Pixels));
+	ImageEye.Inpaint.VFMap.Image->WaitForLoad();
+
+	if (NotLoadedHash == FVARIDViewProfiles::GetInpaintHash(&ImageEye, Gaze))
+	{
+		OutReport = TEXT("VARID: View profiles FAILED. Loading the inpaint image did not change the inpaint hash");
+		return false;
+	}
+
+	/*************************************************************/
+	// two side by side views of one camera share their pyramids only where the working textures are laid out the same
+
+	const uint8 MaxNumMips = 10;	// must match MAX_NUM_MIP_LEVELS
+	const FIntPoint SceneExtent(1920, 1080);
+	const FIntRect ViewRects[2] = { FIntRect(0, 0, 960, 1080), FIntRect(960, 0, 1920, 1080) };
+
+	FVARIDWorkingTexturePlan Plans[2][2];
+	for (int32 ViewIndex = 0; ViewIndex < 2; ++ViewIndex)
+	{
+		TArray<FIntRect> EyeSceneRects;
+		EyeSceneRects.Add(ViewRects[ViewIndex]);
+
+		Plans[ViewIndex][0] = FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode::SceneSized, SceneExtent, EyeSceneRects, 0, MaxNumMips);
+		Plans[ViewIndex][1] = FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode::PerEye, SceneExtent, EyeSceneRects, 0, MaxNumMips);
+	}
+
+	if (!Plans[0][1].HasSameWorkingLayout(Plans[1][1]) || Plans[0][1].HasSameLayout(Plans[1][1]))
+	{
+		OutReport = TEXT("VARID: View profiles FAILED. Per eye plans of two views of the same size should share their working layout but not their scene layout");
+		return false;
+	}
+
+	if (Plans[0][0].HasSameWorkingLayout(Plans[1][0]) || Plans[0][1].HasSameWorkingLayout(Plans[0][0]))
+	{
+		OutReport = TEXT("VARID: View profiles FAILED. Plans with working textures in different places share their working layout");
+		return false;
+	}
+
+	TArray<FIntRect> SmallerRects;
+	SmallerRects.Add(FIntRect(960, 0, 1920, 1076));
+	const FVARIDWorkingTexturePlan Smaller = FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode::PerEye, SceneExtent, SmallerRects, 0, MaxNumMips);
+
+	if (Plans[0][1].HasSameWorkingLayout(Smaller))
+	{
+		OutReport = TEXT("VARID: View profiles FAILED. Views of different sizes share their working layout");
+		return false;
+	}
+
+	OutReport = TEXT("VARID: View profiles OK. Views resolve by view, then player, then the active profile. Split screen views of one camera with per eye working textures share their inpainted colour and pyramids when only blur, contrast or warp differ");
+	return true;
+}
+
+#endif
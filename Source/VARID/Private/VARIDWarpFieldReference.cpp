@@ -0,0 +1,134 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// the warp field the VF map shaders compute from the analytic gradient of the height map. A wrong sign or scale only shows as a slightly
+// off warp on screen, so it is held against a central difference here at two resolutions
+
+float FVARIDReference::EvaluateHeight(const TArray<FVARIDVFMapPoint>& InPoints, const FVector2D& InUV, FVector2D* OutGradient, float InOriginOffset)
+{
+	const float StdDev = 0.025f;	// must match VARIDHeightMapCS.usf
+	const float RBFDenominator = 2.0f * StdDev * StdDev;
+
+	float InterpolatedValue = InOriginOffset;
+	FVector2D Gradient(0.0f, 0.0f);
+
+	for (const FVARIDVFMapPoint& Point : InPoints)
+	{
+		const FVector2D Delta = InUV - FVector2D(Point.NormX, Point.NormY);
+		const float Weight = Point.NormValue * FMath::Exp(-Delta.SizeSquared() / RBFDenominator);
+		InterpolatedValue += Weight;
+		Gradient += Delta * Weight;
+	}
+
+	if (OutGradient)
+	{
+		const bool bClamped = InterpolatedValue <= 0.0f || InterpolatedValue >= 1.0f;
+		*OutGradient = bClamped ? FVector2D(0.0f, 0.0f) : Gradient * (-2.0f / RBFDenominator);
+	}
+
+	return FMath::Clamp(InterpolatedValue, 0.0f, 1.0f);
+}
+
+bool FVARIDReference::ValidateWarpField(FString& OutReport)
+{
+	const FVector2D GradientStep(0.002f, 0.002f);	// default of r.VARID.Warp.GradientStep, square extent
+	const float NumericalStep = 1e-3f;
+	const int32 LegacyStrength = 5;	// must match VARIDNormalMapCS.usf
+
+	// overlapping bumps and a dip, all inside 0..1 so most of the field is not clamped
+	TArray<TArray<FVARIDVFMapPoint>> Points;
+	Points.AddDefaulted();
+	Points[0].Add(FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.40f, 0.45f, 0.6f));
+	Points[0].Add(FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.45f, 0.50f, 0.3f));
+	Points[0].Add(FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.62f, 0.58f, -0.2f));
+
+	// the same view at two resolutions
+	const int32 Resolutions[2] = { 512, 1024 };
+	float MaxDisplacement[2] = { 0.0f, 0.0f };
+	float MaxLegacyDisplacement[2] = { 0.0f, 0.0f };
+	float MaxError = 0.0f;
+
+	for (int32 ResolutionIndex = 0; ResolutionIndex < 2; ++ResolutionIndex)
+	{
+		const FIntPoint Extent(Resolutions[ResolutionIndex], Resolutions[ResolutionIndex]);
+
+		TArray<FIntRect> EyeSceneRects;
+		EyeSceneRects.Add(FIntRect(FIntPoint(0, 0), Extent));
+		const FVARIDWorkingTexturePlan Plan = FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode::PerEye, Extent, EyeSceneRects, 0, 1);
+
+		FVARIDImage WarpField(Plan.Extent);
+		FVARIDImage HeightMap(Plan.Extent);
+		EvaluatePlanHeightMap(Plan, Points, 0, WarpField, &GradientStep);
+		EvaluatePlanHeightMap(Plan, Points, 0, HeightMap);
+
+		for (int32 Y = 0; Y < Extent.Y; ++Y)
+		{
+			for (int32 X = 0; X < Extent.X; ++X)
+			{
+				const FVector4 Analytic = WarpField.Load(X, Y);
+				MaxDisplacement[ResolutionIndex] = FMath::Max(MaxDisplacement[ResolutionIndex], FMath::Max(FMath::Abs(Analytic.X), FMath::Abs(Analytic.Y)));
+
+				// what VARIDNormalMapCS.usf made of the height map. reads past the edge return zero
+				const float Height = HeightMap.Load(X, Y).X;
+				const FVector2D Legacy(Height - HeightMap.Load(X + LegacyStrength, Y).X, Height - HeightMap.Load(X, Y + LegacyStrength).X);
+				if (X + LegacyStrength < Extent.X && Y + LegacyStrength < Extent.Y)
+				{
+					MaxLegacyDisplacement[ResolutionIndex] = FMath::Max(MaxLegacyDisplacement[ResolutionIndex], FMath::Max(FMath::Abs(Legacy.X), FMath::Abs(Legacy.Y)));
+				}
+
+				// central difference, away from the clamp where the height map has no derivative
+				const FVector2D UV((X + 0.5f) / Extent.X, (Y + 0.5f) / Extent.Y);
+				const FVector2D Offsets[4] = { FVector2D(NumericalStep, 0.0f), FVector2D(-NumericalStep, 0.0f), FVector2D(0.0f, NumericalStep), FVector2D(0.0f, -NumericalStep) };
+				float Heights[4];
+				bool bNearClamp = false;
+
+				for (int32 i = 0; i < 4; ++i)
+				{
+					Heights[i] = EvaluateHeight(Points[0], UV + Offsets[i]);
+					bNearClamp |= Heights[i] <= 0.01f || Heights[i] >= 0.99f;
+				}
+
+				if (bNearClamp)
+				{
+					continue;
+				}
+
+				const FVector2D Numerical(
+					-(Heights[0] - Heights[1]) / (2.0f * NumericalStep) * GradientStep.X,
+					-(Heights[2] - Heights[3]) / (2.0f * NumericalStep) * GradientStep.Y);
+
+				MaxError = FMath::Max(MaxError, FMath::Max(FMath::Abs(Analytic.X - Numerical.X), FMath::Abs(Analytic.Y - Numerical.Y)));
+			}
+		}
+	}
+
+	// central difference error is about (NumericalStep / StdDev)^2 of the gradient, plus float rounding of the heights
+	const float Tolerance = 0.01f * MaxDisplacement[0];
+
+	if (MaxDisplacement[0] <= 0.0f || MaxError > Tolerance)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Warp field FAILED. Analytic gradient differs from the numerical one by %f (tolerance %f)"), MaxError, Tolerance);
+		return false;
+	}
+
+	// both resolutions see the same bumps - the largest displacement must not follow the texel size
+	const float ResolutionDifference = FMath::Abs(MaxDisplacement[1] - MaxDisplacement[0]) / MaxDisplacement[0];
+
+	if (ResolutionDifference > 0.02f)
+	{
+		OutReport = FString::Printf(TEXT("VARID: Warp field FAILED. Largest displacement changes by %.1f%% between %d and %d texels"), ResolutionDifference * 100.0f, Resolutions[0], Resolutions[1]);
+		return false;
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: Warp field OK. Max error against the numerical gradient %f (tolerance %f). Largest displacement %f at %d texels, %f at %d. The 5 texel finite difference gave %f and %f"),
+		MaxError, Tolerance, MaxDisplacement[0], Resolutions[0], MaxDisplacement[1], Resolutions[1], MaxLegacyDisplacement[0], MaxLegacyDisplacement[1]);
+	return true;
+}
+
+#endif
@@ -0,0 +1,211 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDWorkingTexturePlan.h"
+
+/*****************************************************************************************************************/
+// eye
+
+FVARIDWorkingEye::FVARIDWorkingEye()
+	: EyeIndex(0)
+{
+}
+
+FVARIDWorkingEye::FVARIDWorkingEye(int32 InEyeIndex, const FIntRect& InSceneRect, const FIntRect& InWorkingRect)
+	: EyeIndex(InEyeIndex)
+	, SceneRect(InSceneRect)
+	, WorkingRect(InWorkingRect)
+{
+}
+
+/*****************************************************************************************************************/
+// plan
+
+FVARIDWorkingTexturePlan::FVARIDWorkingTexturePlan()
+	: Mode(EVARIDWorkingTextureMode::SceneSized)
+	, SceneExtent(0, 0)
+	, Extent(0, 0)
+	, SceneOrigin(0, 0)
+	, NumMips(1)
+{
+}
+
+FVARIDWorkingTexturePlan FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode InMode, const FIntPoint& InSceneExtent, const TArray<FIntRect>& InEyeSceneRects, int32 InEyeIndex, uint8 InMaxNumMips)
+{
+	check(InEyeSceneRects.IsValidIndex(InEyeIndex));
+
+	FVARIDWorkingTexturePlan Plan;
+	Plan.SceneExtent = InSceneExtent;
+
+	const FIntRect& EyeSceneRect = InEyeSceneRects[InEyeIndex];
+
+	if (InMode == EVARIDWorkingTextureMode::SinglePassStereo)
+	{
+		const bool bSideBySide =
+			InEyeSceneRects.Num() == 2
+			&& InEyeSceneRects[0].Area() > 0
+			&& InEyeSceneRects[1].Area() > 0
+			&& InEyeSceneRects[0].Max.X <= InEyeSceneRects[1].Min.X;
+
+		if (!bSideBySide)
+		{
+			InMode = EVARIDWorkingTextureMode::PerEye;
+		}
+	}
+
+	Plan.Mode = InMode;
+
+	switch (InMode)
+	{
+	case EVARIDWorkingTextureMode::SceneSized:
+		Plan.Extent = InSceneExtent;
+		Plan.SceneOrigin = FIntPoint(0, 0);
+		Plan.Eyes.Add(FVARIDWorkingEye(InEyeIndex, EyeSceneRect, EyeSceneRect));
+		break;
+
+	case EVARIDWorkingTextureMode::PerEye:
+		Plan.Extent = EyeSceneRect.Size();
+		Plan.SceneOrigin = EyeSceneRect.Min;
+		Plan.Eyes.Add(FVARIDWorkingEye(InEyeIndex, EyeSceneRect, FIntRect(FIntPoint(0, 0), EyeSceneRect.Size())));
+		break;
+
+	case EVARIDWorkingTextureMode::SinglePassStereo:
+	{
+		// keep any gap between the eyes so one offset takes every working texel back to the scene
+		const FIntRect& Left = InEyeSceneRects[0];
+		const FIntRect& Right = InEyeSceneRects[1];
+		const FIntPoint UnionMin(FMath::Min(Left.Min.X, Right.Min.X), FMath::Min(Left.Min.Y, Right.Min.Y));
+		const FIntPoint UnionMax(FMath::Max(Left.Max.X, Right.Max.X), FMath::Max(Left.Max.Y, Right.Max.Y));
+
+		Plan.Extent = UnionMax - UnionMin;
+		Plan.SceneOrigin = UnionMin;
+		Plan.Eyes.Add(FVARIDWorkingEye(0, Left, FIntRect(Left.Min - UnionMin, Left.Max - UnionMin)));
+		Plan.Eyes.Add(FVARIDWorkingEye(1, Right, FIntRect(Right.Min - UnionMin, Right.Max - UnionMin)));
+		break;
+	}
+
+	default:
+		break;
+	}
+
+	Plan.NumMips = FMath::Max<uint8>(FMath::Min(CalculateNumMips2D(Plan.Extent), InMaxNumMips), 1);
+
+	return Plan;
+}
+
+uint8 FVARIDWorkingTexturePlan::CalculateNumMips1D(int32 InValue)
+{
+	uint8 numTimesHalved = 0;
+	while (InValue > 1)
+	{
+		// could also be done by logarithm to base 2 rounded up/down to the next integer
+		InValue = InValue >> 1;
+		numTimesHalved++;
+	}
+
+	return numTimesHalved;
+}
+
+uint8 FVARIDWorkingTexturePlan::CalculateNumMips2D(FIntPoint InSize)
+{
+	uint8 mipsWidth = CalculateNumMips1D(InSize.X);
+	uint8 mipsHeight = CalculateNumMips1D(InSize.Y);
+	return mipsWidth > mipsHeight ? mipsWidth : mipsHeight;
+}
+
+const FVARIDWorkingEye* FVARIDWorkingTexturePlan::FindEye(int32 InEyeIndex) const
+{
+	for (const FVARIDWorkingEye& Eye : Eyes)
+	{
+		if (Eye.EyeIndex == InEyeIndex)
+		{
+			return &Eye;
+		}
+	}
+
+	return nullptr;
+}
+
+FIntRect FVARIDWorkingTexturePlan::GetActiveRect() const
+{
+	check(Eyes.Num() > 0);
+
+	FIntRect ActiveRect = Eyes[0].WorkingRect;
+
+	for (const FVARIDWorkingEye& Eye : Eyes)
+	{
+		ActiveRect.Min.X = FMath::Min(ActiveRect.Min.X, Eye.WorkingRect.Min.X);
+		ActiveRect.Min.Y = FMath::Min(ActiveRect.Min.Y, Eye.WorkingRect.Min.Y);
+		ActiveRect.Max.X = FMath::Max(ActiveRect.Max.X, Eye.WorkingRect.Max.X);
+		ActiveRect.Max.Y = FMath::Max(ActiveRect.Max.Y, Eye.WorkingRect.Max.Y);
+	}
+
+	return ActiveRect;
+}
+
+FVector4 FVARIDWorkingTexturePlan::GetSceneUVScaleBias() const
+{
+	// SceneUV = (WorkingUV * Extent + SceneOrigin) / SceneExtent
+	return FVector4(
+		(float)Extent.X / SceneExtent.X,
+		(float)Extent.Y / SceneExtent.Y,
+		(float)SceneOrigin.X / SceneExtent.X,
+		(float)SceneOrigin.Y / SceneExtent.Y);
+}
+
+uint64 FVARIDWorkingTexturePlan::GetTextureBytes(int32 InBytesPerTexel) const
+{
+	uint64 Bytes = 0;
+
+	for (int32 MipLevel = 0; MipLevel < NumMips; ++MipLevel)
+	{
+		const uint64 Width = FMath::Max(Extent.X >> MipLevel, 1);
+		const uint64 Height = FMath::Max(Extent.Y >> MipLevel, 1);
+		Bytes += Width * Height * InBytesPerTexel;
+	}
+
+	return Bytes;
+}
+
+int32 FVARIDWorkingTexturePlan::GetPipelineBuildsPerFrame(int32 InNumViews) const
+{
+	return Mode == EVARIDWorkingTextureMode::SinglePassStereo ? 1 : InNumViews;
+}
+
+bool FVARIDWorkingTexturePlan::HasSameLayout(const FVARIDWorkingTexturePlan& Other) const
+{
+	if (Mode != Other.Mode || SceneExtent != Other.SceneExtent || Extent != Other.Extent || SceneOrigin != Other.SceneOrigin || NumMips != Other.NumMips || Eyes.Num() != Other.Eyes.Num())
+	{
+		return false;
+	}
+
+	for (int32 i = 0; i < Eyes.Num(); ++i)
+	{
+		if (Eyes[i].EyeIndex != Other.Eyes[i].EyeIndex || !(Eyes[i].SceneRect == Other.Eyes[i].SceneRect) || !(Eyes[i].WorkingRect == Other.Eyes[i].WorkingRect))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool FVARIDWorkingTexturePlan::HasSameWorkingLayout(const FVARIDWorkingTexturePlan& Other) const
+{
+	if (Mode != Other.Mode || Extent != Other.Extent || NumMips != Other.NumMips || Eyes.Num() != Other.Eyes.Num())
+	{
+		return false;
+	}
+
+	for (int32 i = 0; i < Eyes.Num(); ++i)
+	{
+		if (Eyes[i].EyeIndex != Other.Eyes[i].EyeIndex || Eyes[i].SceneRect.Size() != Other.Eyes[i].SceneRect.Size() || !(Eyes[i].WorkingRect == Other.Eyes[i].WorkingRect))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,240 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "VARIDReference.h"
+#include "VARIDPyramidLayout.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// the VF maps evaluated through FVARIDWorkingTexturePlan's per eye and single pass stereo layouts. The smaller layouts only save memory if
+// every view still reads the values the scene sized layout would give it
+
+void FVARIDReference::EvaluatePlanHeightMap(const FVARIDWorkingTexturePlan& InPlan, const TArray<TArray<FVARIDVFMapPoint>>& InEyePoints, int32 InMipLevel, FVARIDImage& OutImage, const FVector2D* InGradientStep, const FVector2D& InEyeOriginOffsets)
+{
+	check(InEyePoints.Num() == InPlan.Eyes.Num());
+
+	const FIntRect Rect = FVARIDPyramidLayout::GetMipViewportRect(InPlan.GetActiveRect(), InMipLevel);
+	const FVector2D TexelSize(1.0f / OutImage.Size.X, 1.0f / OutImage.Size.Y);
+	const FVector4 SceneUVScaleBias = InPlan.GetSceneUVScaleBias();
+	const int32 RightEyeMinX = InPlan.Eyes.Num() > 1 ? InPlan.Eyes[1].WorkingRect.Min.X >> InMipLevel : MAX_int32;
+
+	for (int32 Y = Rect.Min.Y; Y < Rect.Max.Y; ++Y)
+	{
+		for (int32 X = Rect.Min.X; X < Rect.Max.X; ++X)
+		{
+			const FVector2D UV(
+				(X + 0.5f) * TexelSize.X * SceneUVScaleBias.X + SceneUVScaleBias.Z,
+				(Y + 0.5f) * TexelSize.Y * SceneUVScaleBias.Y + SceneUVScaleBias.W);
+
+			const bool bRightEye = X >= RightEyeMinX;
+			FVector2D Gradient;
+			const float Height = EvaluateHeight(InEyePoints[bRightEye ? 1 : 0], UV, &Gradient, bRightEye ? InEyeOriginOffsets.Y : InEyeOriginOffsets.X);
+
+			if (InGradientStep)
+			{
+				OutImage.Store(X, Y, FVector4(-Gradient.X * InGradientStep->X, -Gradient.Y * InGradientStep->Y, 0.0f, 0.0f));
+			}
+			else
+			{
+				OutImage.Store(X, Y, FVector4(Height, 0.0f, 0.0f, 0.0f));
+			}
+		}
+	}
+}
+
+bool FVARIDReference::ValidateWorkingTexturePlan(FString& OutReport)
+{
+	const uint8 MaxNumMips = 10;	// must match MAX_NUM_MIP_LEVELS
+	const int32 BytesPerTexel = 8;	// PF_R16G16B16A16_UNORM
+	const float HeightMapTolerance = 1e-5f;
+
+	// a typical headset and an awkward one: odd sizes, a gap between the eyes and views smaller than the texture
+	struct FLayout
+	{
+		FIntPoint SceneExtent;
+		FIntRect EyeRects[2];
+	};
+	const FLayout Layouts[2] =
+	{
+		{ FIntPoint(2880, 1600), { FIntRect(0, 0, 1440, 1600), FIntRect(1440, 0, 2880, 1600) } },
+		{ FIntPoint(2036, 1130), { FIntRect(0, 0, 1017, 1111), FIntRect(1019, 0, 2036, 1111) } }
+	};
+
+	float MaxMemoryRatio = 0.0f;
+	float MaxHeightMapError = 0.0f;
+
+	for (int32 LayoutIndex = 0; LayoutIndex < 2; ++LayoutIndex)
+	{
+		const FLayout& Layout = Layouts[LayoutIndex];
+
+		TArray<FIntRect> EyeSceneRects;
+		EyeSceneRects.Add(Layout.EyeRects[0]);
+		EyeSceneRects.Add(Layout.EyeRects[1]);
+
+		// stereo squeezed points, as BuildHeightMapTexture_RenderThread passes them: one per eye, plus one in the other eye that must be ignored
+		TArray<FVARIDVFMapPoint> EyePoints[2];
+		for (int32 EyeIndex = 0; EyeIndex < 2; ++EyeIndex)
+		{
+			const float XOffset = EyeIndex * 0.5f;
+			EyePoints[EyeIndex].Add(FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.25f * 0.5f + XOffset, 0.4f, 0.9f));
+			EyePoints[EyeIndex].Add(FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.98f * 0.5f + XOffset, 0.7f, 0.6f));
+			EyePoints[EyeIndex].Add(FVARIDVFMapPoint(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.02f * 0.5f + (0.5f - XOffset), 0.5f, 1.0f));
+		}
+
+		uint64 SceneSizedFrameBytes = 0;
+		uint64 PerEyeFrameBytes = 0;
+		TArray<FVARIDImage> SceneSizedHeightMaps;
+
+		for (int32 EyeIndex = 0; EyeIndex < 2; ++EyeIndex)
+		{
+			const FIntRect& SceneRect = Layout.EyeRects[EyeIndex];
+			const FVARIDWorkingTexturePlan SceneSized = FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode::SceneSized, Layout.SceneExtent, EyeSceneRects, EyeIndex, MaxNumMips);
+			const FVARIDWorkingTexturePlan PerEye = FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode::PerEye, Layout.SceneExtent, EyeSceneRects, EyeIndex, MaxNumMips);
+
+			if (SceneSized.Extent != Layout.SceneExtent || SceneSized.GetSceneUVScaleBias() != FVector4(1.0f, 1.0f, 0.0f, 0.0f) || !(SceneSized.GetActiveRect() == SceneRect))
+			{
+				OutReport = FString::Printf(TEXT("VARID: Working texture plan FAILED. Scene sized plan of layout %d eye %d is not the original layout"), LayoutIndex, EyeIndex);
+				return false;
+			}
+
+			if (PerEye.Mode != EVARIDWorkingTextureMode::PerEye || PerEye.Extent != SceneRect.Size() || PerEye.Eyes.Num() != 1 || !(PerEye.Eyes[0].WorkingRect == FIntRect(FIntPoint(0, 0), SceneRect.Size())) || PerEye.FindEye(EyeIndex) == nullptr)
+			{
+				OutReport = FString::Printf(TEXT("VARID: Working texture plan FAILED. Per eye plan of layout %d eye %d is not the size of the view"), LayoutIndex, EyeIndex);
+				return false;
+			}
+
+			// memory. mip 0 is exactly the view, the mip tail can round up by a texel
+			const uint64 SceneSizedBytes = SceneSized.GetTextureBytes(BytesPerTexel);
+			const uint64 PerEyeBytes = PerEye.GetTextureBytes(BytesPerTexel);
+			const float MemoryRatio = (float)PerEyeBytes / SceneSizedBytes;
+			MaxMemoryRatio = FMath::Max(MaxMemoryRatio, MemoryRatio);
+			SceneSizedFrameBytes += SceneSizedBytes;
+			PerEyeFrameBytes += PerEyeBytes;
+
+			if (MemoryRatio > 0.5f + 1e-3f)
+			{
+				OutReport = FString::Printf(TEXT("VARID: Working texture plan FAILED. Per eye textures of layout %d eye %d take %.4f of the scene sized memory, expected at most half"), LayoutIndex, EyeIndex, MemoryRatio);
+				return false;
+			}
+
+			// VF maps. every texel of the eye must get the value the scene sized texture has at the same scene texel
+			TArray<TArray<FVARIDVFMapPoint>> Points;
+			Points.Add(EyePoints[EyeIndex]);
+
+			FVARIDImage SceneSizedHeightMap(SceneSized.Extent);
+			FVARIDImage PerEyeHeightMap(PerEye.Extent);
+			EvaluatePlanHeightMap(SceneSized, Points, 0, SceneSizedHeightMap);
+			EvaluatePlanHeightMap(PerEye, Points, 0, PerEyeHeightMap);
+			SceneSizedHeightMaps.Add(SceneSizedHeightMap);
+
+			for (int32 Y = SceneRect.Min.Y; Y < SceneRect.Max.Y; ++Y)
+			{
+				for (int32 X = SceneRect.Min.X; X < SceneRect.Max.X; ++X)
+				{
+					const float Error = FMath::Abs(SceneSizedHeightMap.Load(X, Y).X - PerEyeHeightMap.Load(X - PerEye.SceneOrigin.X, Y - PerEye.SceneOrigin.Y).X);
+					MaxHeightMapError = FMath::Max(MaxHeightMapError, Error);
+
+					if (Error > HeightMapTolerance)
+					{
+						OutReport = FString::Printf(TEXT("VARID: Working texture plan FAILED. Per eye VF map of layout %d differs at scene texel (%d, %d). Error=%f"), LayoutIndex, X, Y, Error);
+						return false;
+					}
+				}
+			}
+		}
+
+		// single pass stereo: both eyes in one set of textures, built once per frame
+		for (int32 EyeIndex = 0; EyeIndex < 2; ++EyeIndex)
+		{
+			const FVARIDWorkingTexturePlan Stereo = FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode::SinglePassStereo, Layout.SceneExtent, EyeSceneRects, EyeIndex, MaxNumMips);
+
+			const bool bEyesInPlace =
+				Stereo.Mode == EVARIDWorkingTextureMode::SinglePassStereo
+				&& Stereo.Eyes.Num() == 2
+				&& Stereo.Eyes[0].WorkingRect.Max.X <= Stereo.Eyes[1].WorkingRect.Min.X
+				&& Stereo.Eyes[0].WorkingRect.Size() == Layout.EyeRects[0].Size()
+				&& Stereo.Eyes[1].WorkingRect.Size() == Layout.EyeRects[1].Size()
+				&& Stereo.Extent.X <= Layout.SceneExtent.X && Stereo.Extent.Y <= Layout.SceneExtent.Y;
+
+			if (!bEyesInPlace)
+			{
+				OutReport = FString::Printf(TEXT("VARID: Working texture plan FAILED. Single pass stereo plan of layout %d, view %d, does not hold both eyes"), LayoutIndex, EyeIndex);
+				return false;
+			}
+
+			if (Stereo.GetPipelineBuildsPerFrame(2) != 1 || FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode::PerEye, Layout.SceneExtent, EyeSceneRects, EyeIndex, MaxNumMips).GetPipelineBuildsPerFrame(2) != 2)
+			{
+				OutReport = FString::Printf(TEXT("VARID: Working texture plan FAILED. Single pass stereo of layout %d does not build once per frame"), LayoutIndex);
+				return false;
+			}
+
+			// the memory of the frame stays at half of scene sized. over per eye it only grows by the gap between the eyes
+			const uint64 StereoFrameBytes = Stereo.GetTextureBytes(BytesPerTexel);
+			if (StereoFrameBytes > PerEyeFrameBytes + PerEyeFrameBytes / 100 || StereoFrameBytes * 2 > SceneSizedFrameBytes + SceneSizedFrameBytes / 1000)
+			{
+				OutReport = FString::Printf(TEXT("VARID: Working texture plan FAILED. Single pass stereo textures of layout %d take %llu bytes per frame. Per eye %llu, scene sized %llu"), LayoutIndex, StereoFrameBytes, PerEyeFrameBytes, SceneSizedFrameBytes);
+				return false;
+			}
+
+			// the second view must be able to pick up what the first one built
+			const FVARIDWorkingTexturePlan OtherView = FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode::SinglePassStereo, Layout.SceneExtent, EyeSceneRects, 1 - EyeIndex, MaxNumMips);
+			if (!Stereo.HasSameLayout(OtherView))
+			{
+				OutReport = FString::Printf(TEXT("VARID: Working texture plan FAILED. The views of layout %d plan different single pass stereo layouts"), LayoutIndex);
+				return false;
+			}
+
+			// one dispatch, each eye its own points
+			TArray<TArray<FVARIDVFMapPoint>> Points;
+			Points.Add(EyePoints[0]);
+			Points.Add(EyePoints[1]);
+
+			FVARIDImage StereoHeightMap(Stereo.Extent);
+			EvaluatePlanHeightMap(Stereo, Points, 0, StereoHeightMap);
+
+			for (const FVARIDWorkingEye& Eye : Stereo.Eyes)
+			{
+				const FVARIDImage& SceneSizedHeightMap = SceneSizedHeightMaps[Eye.EyeIndex];
+
+				for (int32 Y = Eye.SceneRect.Min.Y; Y < Eye.SceneRect.Max.Y; ++Y)
+				{
+					for (int32 X = Eye.SceneRect.Min.X; X < Eye.SceneRect.Max.X; ++X)
+					{
+						const float Error = FMath::Abs(SceneSizedHeightMap.Load(X, Y).X - StereoHeightMap.Load(X - Stereo.SceneOrigin.X, Y - Stereo.SceneOrigin.Y).X);
+						MaxHeightMapError = FMath::Max(MaxHeightMapError, Error);
+
+						if (Error > HeightMapTolerance)
+						{
+							OutReport = FString::Printf(TEXT("VARID: Working texture plan FAILED. Single pass stereo VF map of layout %d differs at scene texel (%d, %d). Error=%f"), LayoutIndex, X, Y, Error);
+							return false;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// single pass stereo needs two side by side eyes
+	{
+		TArray<FIntRect> Mono;
+		Mono.Add(FIntRect(0, 0, 1920, 1080));
+
+		TArray<FIntRect> Overlapping;
+		Overlapping.Add(FIntRect(0, 0, 1000, 1000));
+		Overlapping.Add(FIntRect(900, 0, 1900, 1000));
+
+		if (FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode::SinglePassStereo, FIntPoint(1920, 1080), Mono, 0, MaxNumMips).Mode != EVARIDWorkingTextureMode::PerEye
+			|| FVARIDWorkingTexturePlan::Create(EVARIDWorkingTextureMode::SinglePassStereo, FIntPoint(1900, 1000), Overlapping, 1, MaxNumMips).Mode != EVARIDWorkingTextureMode::PerEye)
+		{
+			OutReport = TEXT("VARID: Working texture plan FAILED. Single pass stereo did not fall back to per eye without two side by side eyes");
+			return false;
+		}
+	}
+
+	OutReport = FString::Printf(TEXT("VARID: Working texture plan OK. Per eye textures take at most %.4f of the scene sized memory per view. Single pass stereo builds once per frame. VF map max error %f"), MaxMemoryRatio, MaxHeightMapError);
+	return true;
+}
+
+#endif
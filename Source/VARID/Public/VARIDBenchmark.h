@@ -0,0 +1,59 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Times the CPU work VARID does on the game and render threads: loading and parsing profiles, copying them for the render thread,
+// the FX accessors, listing profile directories and the per frame packing of VF map points. Profile copies are also sized, against the
+// FVARIDVFMapPoint arrays VF maps used to hold. Nothing here needs a GPU, so it also runs
+// headless on a build machine - UE4Editor-Cmd <project> -run=VARIDBenchmark -nullrhi [-output=<file>] [-quick].
+// The results are written as JSON so that releases can be compared.
+
+/** one case of one benchmark, e.g. ParseVFMap on 1000 points. Times are per iteration */
+struct FVARIDBenchmarkResult
+{
+public:
+	FString Name;
+	FString Case;
+	int32 NumIterations;
+	double MinMicroseconds;
+	double MedianMicroseconds;
+	double MeanMicroseconds;
+	double MaxMicroseconds;
+
+	/** memory the case measures, -1 if it doesn't */
+	int64 Bytes;
+
+public:
+	FVARIDBenchmarkResult();
+};
+
+struct FVARIDBenchmark
+{
+public:
+	/** the point counts of the synthetic VF maps */
+	static const int32 NumPointsCases[4];
+
+	/** the sizes of the directories ListProfiles() is timed on */
+	static const int32 NumFilesCases[3];
+
+public:
+	/**
+	 * runs every benchmark, with the display FOV at 100x100 so that machines compare. A case repeats for half a second, within 5 to 10000 iterations.
+	 * bInQuick gives each case a tenth of that and skips the largest directory. The directories go under the project's Saved folder and are deleted afterwards
+	 */
+	static void Run(bool bInQuick, TArray<FVARIDBenchmarkResult>& OutResults);
+
+	/** min, median, mean and max of samples in microseconds, each one iteration. Sorts InOutSamples. No samples give a result of zero iterations */
+	static FVARIDBenchmarkResult Summarise(const FString& InName, const FString& InCase, TArray<double>& InOutSamples);
+
+	/** the results with what they were run on: { "plugin_version", "date", "platform", "cpu", "results": [ { "name", "case", "iterations", "min_us", ..., "bytes" } ] } */
+	static FString ToJson(const TArray<FVARIDBenchmarkResult>& InResults);
+
+	/** runs the benchmarks and saves the JSON to InOutputPath, or to Saved/VARID/Benchmark-<date>.json if it is empty. OutOutputPath gets the file written */
+	static bool RunAndSave(const FString& InOutputPath, bool bInQuick, FString& OutOutputPath);
+};
@@ -0,0 +1,21 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "VARIDBenchmarkCommandlet.generated.h"
+
+/** runs FVARIDBenchmark headless: UE4Editor-Cmd <project> -run=VARIDBenchmark -nullrhi [-output=<file>] [-quick]. Returns 1 if the results could not be saved */
+UCLASS()
+class UVARIDBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UVARIDBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
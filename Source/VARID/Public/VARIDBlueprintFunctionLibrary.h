@@ -10,6 +10,9 @@
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include "VARIDBlueprintFunctionLibrary.generated.h"
 
+class UTexture;
+class UTextureRenderTarget2D;
+
 UCLASS(BlueprintType)
 class UVARIDBlueprintFunctionLibrary : public UBlueprintFunctionLibrary
 {
@@ -36,6 +39,34 @@ public:
 	UFUNCTION(BlueprintCallable, category = "VARID")
 		static void SetActiveProfile(const FVARIDProfile& Profile);
 
+	/** Gives one view of the view family (e.g. one half of split screen) its own profile. A profile that isn't valid leaves the view unprocessed. */
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static void SetViewProfile(const int32 ViewIndex, const FVARIDProfile& Profile);
+
+	/** The same, for every view of a local player. A view profile set with SetViewProfile wins. */
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static void SetPlayerProfile(const int32 PlayerIndex, const FVARIDProfile& Profile);
+
+	/** Every view goes back to the active profile. */
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static void ClearViewProfiles();
+
+	/** Steps through Keyframes, e.g. early to advanced, with SetProgressionTime rather than reloading a profile per step. Times may be empty, which puts keyframe k at time k. */
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static bool SetProgression(const TArray<FVARIDProfile>& Keyframes, const TArray<float>& Times);
+
+	/** Moves the progression to Time, blending the VF maps of the keyframes either side. */
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static void SetProgressionTime(const float Time);
+
+	/** Keeps the active profile where the progression left it. */
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static void ClearProgression();
+
+	/** Renders Source through every profile into the output of the same index, building the pyramids once for all of them. GazePoints may be shorter than Profiles - the rest look straight ahead. */
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static bool RenderProfileBatch(UTexture* Source, const TArray<FVARIDProfile>& Profiles, const TArray<FVector2D>& GazePoints, const TArray<UTextureRenderTarget2D*>& Outputs);
+
 	UFUNCTION(BlueprintCallable, category = "VARID")
 		static void ListFX(TArray<FString>& OutFXDetails);
 
@@ -54,6 +85,10 @@ public:
 	UFUNCTION(BlueprintCallable, category = "VARID")
 		static void EndRendering();
 
+	/** True once rendering has begun and VARID's shaders and pipeline states are warm, i.e. the simulation is on screen. See r.VARID.PipelineWarmup. */
+	UFUNCTION(BlueprintPure, category = "VARID")
+		static bool IsRenderingActive();
+
 	UFUNCTION(BlueprintCallable, category = "VARID")
 		static FVARIDEyeTracking& GetEyeTracking();
 
@@ -65,4 +100,47 @@ public:
 
 	UFUNCTION(BlueprintCallable, category = "VARID")
 		static void SetDisplayFOV(const FVector2D& DisplayFOV);
+
+	/** Records eye tracking, profile activations, FX changes, display FOV changes and per frame timings to FilePath, or to Saved/VARID if it is empty. */
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static bool BeginTraceRecording(const FString& FilePath);
+
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static void EndTraceRecording();
+
+	/** Feeds a recorded trace back in, frame by frame. Until it ends, eye tracking, profile, FX and display FOV changes from anywhere else are ignored. */
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static bool BeginTraceReplay(const FString& FilePath);
+
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static void EndTraceReplay();
+
+	/** Feeds an image, or a directory of them, into VARID in place of the scene at FramesPerSecond, looping. A stand-in for a passthrough camera. */
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static bool BeginFileFrameSource(const FString& Path, float FramesPerSecond, bool bSideBySideStereo);
+
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static void EndFrameSource();
+
+	/** Activates the profile at ProfileFullPath and reloads it whenever the file is saved, once it has gone DebounceSeconds unchanged. Only the VF maps that changed are reparsed. */
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static bool BeginProfileHotReload(const FString& ProfileFullPath, float DebounceSeconds = 0.5f);
+
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static void EndProfileHotReload();
+
+	/** Writes VARID's output for each eye, with the gaze point of every frame, to Directory or to Saved/VARID if it is empty. Format is PNG, EXR or Raw. Frames the disk can't keep up with are dropped. */
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static bool BeginOutputCapture(const FString& Directory, const FString& Format = TEXT("PNG"));
+
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static void EndOutputCapture();
+
+	/** The points of a VF map, one struct each. Raw fields are 0, and Min..Max 0..1, if r.VARID.VFMap.KeepRawPoints was 0 when the map was parsed. Falls back to the deprecated Data if the map has no Points. */
+	UFUNCTION(BlueprintPure, category = "VARID")
+		static TArray<FVARIDVFMapPoint> GetVFMapPoints(const FVARIDVFMap& VFMap);
+
+	/** Replaces the points of a VF map, and empties the deprecated Data. Its mesh and curvature bound are built again when they are next needed. */
+	UFUNCTION(BlueprintCallable, category = "VARID")
+		static void SetVFMapPoints(UPARAM(ref) FVARIDVFMap& VFMap, const TArray<FVARIDVFMapPoint>& Points);
 };
\ No newline at end of file
@@ -28,6 +28,24 @@ public:
 	UFUNCTION(exec, Category = "VARID")
 		void VARID_SetActiveProfile(const int32 ID);
 
+	/** Gives one view of the view family its own profile, by the ID VARID_ListProfiles shows. An ID of -1 leaves the view unprocessed. */
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_SetViewProfile(const int32 ViewIndex, const int32 ID);
+
+	/** The same for every view of a local player. An ID of -1 leaves the player's views unprocessed. */
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_SetPlayerProfile(const int32 PlayerIndex, const int32 ID);
+
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_ClearViewProfiles();
+
+	/** Steps through the profiles VARID_ListProfiles shows as IDs, comma separated (e.g. 3,5,7), with keyframe k at time k. */
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_SetProgression(const FString& IDs);
+
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_SetProgressionTime(const float Time);
+
 	UFUNCTION(exec, Category = "VARID")
 		void VARID_ListFX();
 
@@ -51,4 +69,62 @@ public:
 
 	UFUNCTION(exec, Category = "VARID")
 		void VARID_SetDisplayFOV(const float HorizontalFOV, const float VerticalFOV);
+
+	/** Loads every profile and reports the fraction of contrast and inpaint thread groups tile classification would skip. Eye size defaults to 1024x1024. The active profile is not changed. */
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_ReportTileSkipFractions(const int32 EyeWidth, const int32 EyeHeight);
+
+	/** Times the CPU side of VARID - profile loading and parsing, the FX accessors, profile listing and VF map point packing - and saves the results as JSON under Saved/VARID. Takes a while. */
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_Benchmark();
+
+	/** Records eye tracking, profile activations, FX changes, display FOV changes and per frame timings to a trace. An empty path saves under Saved/VARID. */
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_BeginTraceRecording(const FString& FilePath);
+
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_EndTraceRecording();
+
+	/** Feeds a trace back in, frame by frame. Start a recording as well to get this build's timings on the same inputs. */
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_BeginTraceReplay(const FString& FilePath);
+
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_EndTraceReplay();
+
+	/** Replays a trace on the CPU, without changing the active profile, and saves its recorded timings and those of the replay as JSON next to it. */
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_ReplayTraceCPU(const FString& FilePath);
+
+	/** Feeds an image, or a directory of them, into VARID in place of the scene at FramesPerSecond, looping. A stand-in for a passthrough camera. */
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_BeginFileFrameSource(const FString& Path, const float FramesPerSecond, const bool SideBySideStereo);
+
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_EndFrameSource();
+
+	/** Reports the frames the frame source delivered and dropped, and the median latency of each stage from capture to the composite being submitted, on the CPU, over the last 256 frames. */
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_ReportFrameSourceLatency();
+
+	/** Activates profile ID and reloads it whenever its file is saved, reparsing only the VF maps that changed. DebounceSeconds defaults to 0.5. */
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_BeginProfileHotReload(const int32 ID, const float DebounceSeconds);
+
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_EndProfileHotReload();
+
+	/** Writes VARID's output for each eye, with the gaze point of every frame, under Saved/VARID. Format is PNG, EXR or Raw. */
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_BeginOutputCapture(const FString& Format);
+
+	/** Ends the output capture and reports the frames written and dropped. */
+	UFUNCTION(exec, Category = "VARID")
+		void VARID_EndOutputCapture();
+
+private:
+	/** loads the profile VARID_ListProfiles shows as InID. -1 gives a profile that isn't valid. Reports failures to the player */
+	bool LoadProfileByID(const int32 InID, FVARIDProfile& OutProfile);
+
+	void ReportValidation(const bool bPassed, const FString& Report);
 };
\ No newline at end of file
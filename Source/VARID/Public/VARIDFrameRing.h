@@ -0,0 +1,131 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+struct FVARIDBenchmarkResult;
+
+// How a frame source (see VARIDFrameSource.h) hands its frames to the render thread. The slots are allocated once, with the ring. The source writes
+// a frame straight into a free slot and the render thread uploads the newest one from where it lies, then gives the slot back, so nothing is
+// allocated or copied between capture and upload. With three slots the source never waits: one is being uploaded, one holds the newest frame
+// and the source writes the third. A frame replaced before it was uploaded is dropped, never queued, so the input is always the newest frame.
+// Kept free of render code so it can be checked on the CPU - see FVARIDReference::ValidateFrameRing().
+
+/** when each stage of a frame happened, in FPlatformTime::Seconds() */
+struct FVARIDFrameLatency
+{
+public:
+	uint64 FrameIndex;
+
+	/** when the source captured the frame, e.g. the camera's exposure time moved to the FPlatformTime clock */
+	double CaptureSeconds;
+
+	/** when the source finished writing it into its slot */
+	double CommitSeconds;
+
+	/** when the render thread handed it to the RHI */
+	double UploadSeconds;
+
+	/**
+	 * when the render thread finished adding the passes that composite it, on the CPU. The GPU runs them later, a frame or more on, so this is when
+	 * the composite was submitted, not when it was on screen
+	 */
+	double CompositeSeconds;
+
+public:
+	FVARIDFrameLatency();
+};
+
+struct FVARIDFrameSlot
+{
+public:
+	/** B8G8R8A8, rows of FVARIDFrameRing::GetPitch() bytes */
+	TArray<uint8> Pixels;
+
+	/** the latency of the frame in the slot, up to its commit */
+	FVARIDFrameLatency Latency;
+};
+
+class FVARIDFrameRing
+{
+public:
+	static const int32 NumSlots = 3;
+	static const int32 BytesPerPixel = 4;
+
+	/** the latency of this many of the most recent composited frames is kept */
+	static const int32 NumLatencySamples = 256;
+
+public:
+	/** the size of every frame. A source whose frames change size makes a new ring. bInSideBySideStereo gives the left half to the left eye and the right half to the right */
+	FVARIDFrameRing(const FIntPoint& InSize, bool bInSideBySideStereo);
+
+	FIntPoint GetSize() const;
+	bool IsSideBySideStereo() const;
+	int32 GetPitch() const;
+
+	/** source. The slot to write the next frame into, never the one being uploaded or the newest frame. Null while the source already has one */
+	uint8* BeginWrite();
+
+	/** source. The written slot becomes the newest frame. InCaptureSeconds is when it was captured */
+	void CommitWrite(double InCaptureSeconds);
+
+	/** source. Gives the slot back without a frame, e.g. when the capture failed */
+	void CancelWrite();
+
+	/** render thread. The newest frame if there is one the render thread hasn't had, otherwise null. The slot is held until EndRead() */
+	const FVARIDFrameSlot* BeginRead();
+
+	/** render thread. InUploadSeconds is when the pixels were handed to the RHI, after which the slot can be written again */
+	void EndRead(double InUploadSeconds);
+
+	/**
+	 * render thread. The passes compositing the frame of the last EndRead() have been added, at InCompositeSeconds on the CPU. Only its first composite
+	 * counts, so a frame shown by two views is one sample
+	 */
+	void RecordComposite(double InCompositeSeconds);
+
+	/** frames committed, dropped before they were uploaded, and uploaded */
+	uint64 GetNumCommitted() const;
+	uint64 GetNumDropped() const;
+	uint64 GetNumRead() const;
+
+	/** the most recent composited frames, oldest first */
+	void GetLatencies(TArray<FVARIDFrameLatency>& OutLatencies) const;
+
+	/**
+	 * the latencies as benchmark results named "FrameSource", each sample one frame, with the cases "CaptureToCommit", "CommitToUpload",
+	 * "UploadToCompositeSubmit" and "CaptureToCompositeSubmit". The last two end when the composite was submitted, so leave out the GPU's time
+	 */
+	void GetLatencyResults(TArray<FVARIDBenchmarkResult>& OutResults) const;
+
+private:
+	const FIntPoint Size;
+	const bool bSideBySideStereo;
+
+	/** guards everything below. Only held to move slot indices and counts, never while pixels are copied */
+	mutable FCriticalSection Lock;
+
+	FVARIDFrameSlot Slots[NumSlots];
+
+	/** INDEX_NONE when no slot is in that state */
+	int32 WriteSlot;
+	int32 NewestSlot;
+	int32 ReadSlot;
+
+	uint64 NumCommitted;
+	uint64 NumDropped;
+	uint64 NumRead;
+
+	/** the frame of the last EndRead(), until it is composited */
+	FVARIDFrameLatency PendingLatency;
+	bool bLatencyPending;
+
+	/** NumLatencySamples of them once full. NextLatency is where the next goes */
+	TArray<FVARIDFrameLatency> Latencies;
+	int32 NextLatency;
+};
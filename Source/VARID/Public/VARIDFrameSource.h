@@ -0,0 +1,73 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VARIDFrameRing.h"
+#include "Async/Future.h"
+#include "Templates/Atomic.h"
+
+// A frame source feeds images - a passthrough camera, a video - into VARID in place of the rendered scene. FVARIDModule::SetFrameSource() starts one.
+// Its frames go through a FVARIDFrameRing to the render thread, which uploads the newest each frame and gives it to the FX pipeline as its input,
+// resampled to the view, instead of the tonemapped scene colour. A camera is implemented by writing its frames into the ring from its own capture
+// callback, ideally straight from the driver's buffer into BeginWrite().
+
+class IVARIDFrameSource
+{
+public:
+	virtual ~IVARIDFrameSource() {}
+
+	/** begins writing frames into GetRing(). False if the source can't start */
+	virtual bool Start() = 0;
+
+	/** stops writing frames. Returns once the source no longer touches the ring */
+	virtual void Stop() = 0;
+
+	virtual bool IsRunning() const = 0;
+
+	/** valid once started. The render thread keeps its own reference, so the ring outlives a source that is destroyed */
+	virtual TSharedPtr<FVARIDFrameRing, ESPMode::ThreadSafe> GetRing() const = 0;
+
+	/** for logs, e.g. the file or device the frames come from */
+	virtual FString GetDescription() const = 0;
+};
+
+/**
+ * a stand-in for a camera, for working without the hardware. Plays an image, or every image of a directory in name order, at a fixed rate and loops.
+ * The images are decoded when the source starts. A thread then writes one into the ring per frame period, as a camera's capture callback would
+ */
+class FVARIDFileFrameSource : public IVARIDFrameSource
+{
+public:
+	/** InPath is a PNG, JPEG or BMP, or a directory of them the size of the first. bInSideBySideStereo if each image holds the left eye then the right */
+	FVARIDFileFrameSource(const FString& InPath, float InFramesPerSecond, bool bInSideBySideStereo);
+	virtual ~FVARIDFileFrameSource();
+
+	virtual bool Start() override;
+	virtual void Stop() override;
+	virtual bool IsRunning() const override;
+	virtual TSharedPtr<FVARIDFrameRing, ESPMode::ThreadSafe> GetRing() const override;
+	virtual FString GetDescription() const override;
+
+	/** images more than this are left out of a directory, the decoded frames are kept in memory */
+	static const int32 MaxNumFrames = 300;
+
+private:
+	/** on its own thread until Stop() */
+	void CaptureFrames();
+
+private:
+	const FString Path;
+	const float FramesPerSecond;
+	const bool bSideBySideStereo;
+
+	/** B8G8R8A8, the ring's pitch */
+	TArray<TArray<uint8>> Frames;
+
+	TSharedPtr<FVARIDFrameRing, ESPMode::ThreadSafe> Ring;
+	TFuture<void> CaptureThread;
+	TAtomic<bool> bStopping;
+};
@@ -8,8 +8,20 @@
 #include "Modules/ModuleManager.h"
 #include "VARIDProfile.h"
 #include "VARIDEyeTracking.h"
+#include "VARIDViewProfiles.h"
+#include "VARIDProfileBatch.h"
+#include "VARIDProfileProgression.h"
+#include "VARIDTrace.h"
 
+class UTexture;
+class UTextureRenderTarget2D;
 class FVARIDSceneViewExtension;
+class FVARIDTraceRecorder;
+class IVARIDFrameSource;
+class FVARIDProfileHotReload;
+class FVARIDPipelineWarmup;
+class FVARIDCaptureWriter;
+enum class EVARIDCaptureFormat : uint8;
 
 // This class is the hub of the VARID plugin. The IModuleInterface gives us singleton behaviour which is fine because we only want one instance
 
@@ -43,8 +55,25 @@ public:
 	}
 
 public:
+	/** with r.VARID.PipelineWarmup, rendering only takes effect once BeginPipelineWarmup() is ready. Until then IsRendering() is true but IsRenderingActive() isn't */
 	void BeginRendering();
 	void EndRendering();
+	bool IsRendering() const;
+	bool IsRenderingActive() const;
+
+	/**
+	 * ends rendering, trace replay and recording, the frame source, profile hot reload and output capture. All of ShutdownModule() but resetting the
+	 * shader directory mappings and unhooking from the engine, so it can be called, and checked, with the engine running
+	 */
+	void EndAll();
+
+	/**
+	 * starts creating every shader and pipeline state VARID renders with on the render thread, r.VARID.PipelineWarmup.BudgetMs a frame. Only the first call
+	 * does anything. BeginRendering() calls it, and so does engine start up with r.VARID.PipelineWarmup=2. Ready at once under NullRHI
+	 */
+	void BeginPipelineWarmup();
+	bool IsPipelineWarm() const;
+	const TSharedPtr<FVARIDPipelineWarmup, ESPMode::ThreadSafe>& GetPipelineWarmup() const;
 
 public:
 	void SetProfileRootPath(FString ProfileRootPath);
@@ -52,9 +81,65 @@ public:
 	bool ListProfiles(FString ProfileRootPath, FString Ext, TArray<FString>& Files);
 	bool ListProfiles(TArray<FString>& Files);
 	bool LoadProfile(const FString& ProfileFullPath, FVARIDProfile& OutProfile);
+
+	/** parses one VF map of a profile's json, e.g. InJsonPath "/left_eye/blur", as LoadProfile() does. Image maps are relative to the working directory */
+	bool ParseVFMapJson(const FString& InJsonString, const FString& InJsonPath, FVARIDVFMap& OutVFMap);
 	void SetActiveProfile(const FVARIDProfile& InProfile);
 	FVARIDProfile& GetActiveProfile();
 
+	/** the FX of the active profile. Changing them here rather than through GetActiveProfile() gets them into a trace */
+	void ToggleFX(int32 ID);
+	void EnableAllFX();
+	void DisableAllFX();
+
+public:
+	/**
+	 * loads InProfileFullPath, activates it and watches its file. Once the file has gone InDebounceSeconds without changing it is reparsed, and the VF maps
+	 * whose json or image changed - only those - are replaced in the active profile. FX toggles are kept. Activating another profile ends it
+	 */
+	bool BeginProfileHotReload(const FString& InProfileFullPath, float InDebounceSeconds = 0.5f);
+	void EndProfileHotReload();
+	bool IsProfileHotReloading() const;
+
+	/** reparses the hot reloaded profile now, rather than when its file changes. The number of VF maps that changed, or INDEX_NONE if it couldn't be read */
+	int32 ReloadChangedVFMaps();
+
+public:
+	/** profiles for particular views, picked over the active profile. A profile that isn't valid, e.g. FVARIDProfile(), leaves the view unprocessed */
+	void SetViewProfile(int32 InViewIndex, const FVARIDProfile& InProfile);
+	void SetPlayerProfile(int32 InPlayerIndex, const FVARIDProfile& InProfile);
+	void ClearViewProfiles();
+	const FVARIDViewProfiles& GetViewProfiles() const;
+
+public:
+	/**
+	 * steps through InKeyframes with SetProgressionTime() rather than a SetActiveProfile() per step. The active profile becomes the progression at the
+	 * first keyframe's time, until SetActiveProfile() or ClearProgression(). InTimes may be empty, which puts keyframe k at time k.
+	 * Like SetActiveProfile(), it ends a profile hot reload and is ignored during a trace replay. A trace records the progression as the
+	 * profile of each step, so a replay shows the same profiles without one
+	 */
+	bool SetProgression(const TArray<FVARIDProfile>& InKeyframes, const TArray<float>& InTimes);
+	void SetProgressionTime(float InTime);
+	float GetProgressionTime() const;
+	void ClearProgression();
+	const TSharedPtr<const FVARIDProfileProgression, ESPMode::ThreadSafe>& GetProgression() const;
+
+public:
+	/**
+	 * renders InSource through every entry into the output of the same index, which must be the size of InSource. Entries that inpaint the same way
+	 * build the inpainted colour and pyramids once between them. Runs on the render thread - the outputs are ready once it has caught up
+	 */
+	bool RenderProfileBatch(UTexture* InSource, const TArray<FVARIDProfileBatchEntry>& InEntries, const TArray<UTextureRenderTarget2D*>& InOutputs);
+
+public:
+	/**
+	 * starts InSource and feeds its newest frame into every view VARID processes, in place of the view's scene colour. Replaces and stops the source
+	 * set before. Until the first frame arrives the views are processed as usual
+	 */
+	bool SetFrameSource(const TSharedPtr<IVARIDFrameSource, ESPMode::ThreadSafe>& InSource);
+	void ClearFrameSource();
+	const TSharedPtr<IVARIDFrameSource, ESPMode::ThreadSafe>& GetFrameSource() const;
+
 public:
 	FVARIDEyeTracking& GetEyeTracking();
 	void SetEyeTracking(const FVARIDEyeTracking& EyeTracking);
@@ -63,11 +148,75 @@ public:
 	const FVector2D& GetDisplayFOV();
 	void SetDisplayFOV(const FVector2D& InDisplayFOV);
 
+public:
+	/**
+	 * records the eye tracking, profile activations, FX changes and display FOV given to this module, and the CPU time of each frame's VARID work,
+	 * to InFilePath or to Saved/VARID/Trace-<date>.vtrace if it is empty. Starts with the current state, so the trace replays on its own
+	 */
+	bool BeginTraceRecording(const FString& InFilePath);
+	void EndTraceRecording();
+	const TSharedPtr<FVARIDTraceRecorder, ESPMode::ThreadSafe>& GetTraceRecorder() const;
+
+	/**
+	 * feeds a trace's inputs back through SetEyeTracking(), SetActiveProfile(), the FX functions and SetDisplayFOV(), the events of recorded frame n
+	 * at the start of the nth engine frame. Until it ends, calls to those from anywhere else are ignored, so live eye tracking doesn't mix with the trace.
+	 * Recording at the same time gives the stage timings of this build on the same inputs
+	 */
+	bool BeginTraceReplay(const FString& InFilePath);
+	void EndTraceReplay();
+	bool IsTraceReplaying() const;
+
+public:
+	/**
+	 * writes VARID's output for each eye, as it leaves the compositor, to InDirectory or to Saved/VARID/Capture-<date> if it is empty, with the gaze
+	 * point of every frame in frames.csv. Rendering never waits for it: InQueueFrames frames can wait to be written, and frames the GPU copies or the
+	 * disk can't keep up with are dropped and counted. Ends the capture before
+	 */
+	bool BeginOutputCapture(const FString& InDirectory, EVARIDCaptureFormat InFormat, int32 InQueueFrames = 8);
+	void EndOutputCapture();
+	const TSharedPtr<FVARIDCaptureWriter, ESPMode::ThreadSafe>& GetOutputCapture() const;
+
 private:
 	TSharedPtr<FVARIDSceneViewExtension, ESPMode::ThreadSafe> SceneViewExtension;
+
+	TSharedPtr<FVARIDPipelineWarmup, ESPMode::ThreadSafe> PipelineWarmup;
+	FDelegateHandle PipelineWarmupHandle;
+	FDelegateHandle PostEngineInitHandle;
 	FString DefaultProfileRootPath;
 	FString DefaultProfileExtension;
 	FVARIDProfile Profile;
+	FVARIDViewProfiles ViewProfiles;
+	TSharedPtr<const FVARIDProfileProgression, ESPMode::ThreadSafe> Progression;
+	float ProgressionTime = 0.0f;
 	FVARIDEyeTracking EyeTracking;	
 	FVector2D DisplayFOV;
+
+	TSharedPtr<IVARIDFrameSource, ESPMode::ThreadSafe> FrameSource;
+
+	TUniquePtr<FVARIDProfileHotReload> ProfileHotReload;
+	FDelegateHandle ProfileHotReloadHandle;
+	bool bApplyingProfileHotReload = false;
+
+	TSharedPtr<FVARIDTraceRecorder, ESPMode::ThreadSafe> TraceRecorder;
+
+	/** the trace being replayed, the next of its events and the GFrameNumber of its frame 0, set on the first frame of the replay */
+	TUniquePtr<FVARIDTrace> TraceReplay;
+	int32 TraceReplayNextEvent = 0;
+	uint32 TraceReplayStartFrameNumber = 0;
+	bool bTraceReplayStarted = false;
+	bool bApplyingTraceReplay = false;
+	FDelegateHandle TraceReplayHandle;
+
+	TSharedPtr<FVARIDCaptureWriter, ESPMode::ThreadSafe> OutputCapture;
+
+private:
+	/** false while a replay is running, unless it is the replay calling */
+	bool CanChangeTracedState() const;
+	void TickTraceReplay();
+
+	/** polls the hot reloaded profile's file */
+	bool TickProfileHotReload(float InDeltaTime);
+
+	/** queues the next step of the pipeline warm-up to the render thread, once the last has run */
+	bool TickPipelineWarmup(float InDeltaTime);
 };
\ No newline at end of file
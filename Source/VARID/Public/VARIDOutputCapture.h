@@ -0,0 +1,211 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Templates/Atomic.h"
+#include "Templates/Function.h"
+
+// Records what a study participant saw: VARID's output for each eye as it leaves the compositor, with the gaze point it was rendered for. Started with
+// FVARIDModule::BeginOutputCapture(). The render thread copies each eye into one of a ring of staging textures and maps it once its fence has passed, a
+// few frames later, so it never waits on the GPU. The mapped surface goes through a FVARIDCaptureQueue to a writer thread, which copies the pixels out,
+// so the render thread only unmaps it once that is done, and writes raw, PNG or EXR files and a line of frames.csv for each. The queue's frames are
+// allocated once and reused. When the writer falls behind, e.g. the disk is slow, the queue fills and new frames are dropped and counted rather than
+// waited for. Encoding is passed in, so the queue and writer can be checked on the CPU with made up frames - see
+// FVARIDReference::ValidateOutputCapture().
+
+enum class EVARIDCaptureFormat : uint8
+{
+	/** the pixels as read back, in FVARIDCaptureFrame::PixelFormat. frames.csv has the size and format to read them with */
+	Raw,
+	/** 8 bit BGRA */
+	PNG,
+	/** half float RGBA. The output is display referred, so it holds the values that were displayed */
+	EXR
+};
+
+/** the layout of FVARIDCaptureFrame::Pixels. The output formats VARID composites to */
+enum class EVARIDCapturePixelFormat : uint8
+{
+	B8G8R8A8,
+	R8G8B8A8,
+	/** R in the low 10 bits, then G, B and 2 bits of A */
+	A2B10G10R10,
+	/** half float RGBA */
+	FloatRGBA
+};
+
+/**
+ * pixels the producer still owns, e.g. a mapped staging surface, for the writer thread to copy into a frame so the producer doesn't have to. The
+ * producer keeps them valid until IsCopied()
+ */
+class FVARIDCaptureSource
+{
+public:
+	/** rows InPitch bytes apart, which can be more than a row of the frame */
+	FVARIDCaptureSource(const uint8* InData, int32 InPitch);
+
+	const uint8* GetData() const;
+	int32 GetPitch() const;
+
+	/** any thread. True once the writer is done with the pixels */
+	bool IsCopied() const;
+	void MarkCopied();
+
+private:
+	const uint8* Data;
+	const int32 Pitch;
+	TAtomic<bool> bCopied;
+};
+
+struct FVARIDCaptureFrame
+{
+public:
+	/** the GFrameNumber it was rendered on */
+	uint32 FrameNumber;
+
+	/** FPlatformTime::Seconds() when its passes were added */
+	double Seconds;
+
+	/** 0 = left, or mono. 1 = right */
+	int32 EyeIndex;
+
+	/** the gaze point of the eye it was rendered with */
+	FVector2D GazePoint;
+
+	FIntPoint Size;
+	EVARIDCapturePixelFormat PixelFormat;
+
+	/** Size.Y rows of Size.X pixels, without padding. Kept between uses, so a frame the same size as the last allocates nothing */
+	TArray<uint8> Pixels;
+
+	/** if set, the pixels are still in the producer's memory, and the writer copies them into Pixels before anything else */
+	TSharedPtr<FVARIDCaptureSource, ESPMode::ThreadSafe> Source;
+
+public:
+	FVARIDCaptureFrame();
+
+	static int32 GetBytesPerPixel(EVARIDCapturePixelFormat InPixelFormat);
+	static const TCHAR* GetPixelFormatName(EVARIDCapturePixelFormat InPixelFormat);
+
+	/** copies Source into Pixels, marks it copied and lets go of it. Nothing without a source */
+	void CopyFromSource();
+};
+
+/** encodes pixels converted by FVARIDCaptureWriter::ConvertPixels() into the bytes of a PNG or EXR file. Called on the writer thread */
+typedef TFunction<bool(EVARIDCaptureFormat InFormat, const FIntPoint& InSize, const TArray<uint8>& InPixels, TArray<uint8>& OutFileData)> FVARIDEncodeCaptureFrame;
+
+/** a fixed number of frames, passed from one producer to one consumer without locks */
+class FVARIDCaptureQueue
+{
+public:
+	/** allocates InCapacity frames. Frames queued, being filled and being written are never more than that */
+	explicit FVARIDCaptureQueue(int32 InCapacity);
+
+	/** producer. A frame to fill and Push(), or null if every frame is queued or being written, in which case this one is dropped and counted */
+	FVARIDCaptureFrame* Acquire();
+
+	/** producer. Queues a frame from Acquire() for the consumer */
+	void Push(FVARIDCaptureFrame* InFrame);
+
+	/** producer. Counts a frame dropped before it got as far as Acquire(), e.g. there was nowhere to copy it to on the GPU */
+	void RecordDropped();
+
+	/** consumer. The oldest frame queued, or null if there is none. Give it back with Release() once it is written */
+	FVARIDCaptureFrame* Pop();
+	void Release(FVARIDCaptureFrame* InFrame);
+
+	/** any thread */
+	int32 GetCapacity() const;
+	int32 GetNumQueued() const;
+	uint64 GetNumPushed() const;
+	uint64 GetNumDropped() const;
+
+private:
+	/** a ring of frame pointers with one thread pushing and another popping. It never holds more than the frames there are, so it can't overflow */
+	struct FFrameRing
+	{
+		TArray<FVARIDCaptureFrame*> Items;
+		TAtomic<uint64> NumPushed;
+		TAtomic<uint64> NumPopped;
+
+		FFrameRing();
+		void Push(FVARIDCaptureFrame* InFrame);
+		FVARIDCaptureFrame* Pop();
+	};
+
+private:
+	TArray<TUniquePtr<FVARIDCaptureFrame>> Frames;
+
+	/** producer to consumer, and the frames given back */
+	FFrameRing Queued;
+	FFrameRing Free;
+
+	TAtomic<uint64> NumDropped;
+};
+
+class FVARIDCaptureWriter
+{
+public:
+	/**
+	 * makes InDirectory, opens frames.csv in it, and writes the frames pushed into GetQueue() on a thread of its own until End(). Null if the directory
+	 * can't be written. InEncode is only called for PNG and EXR
+	 */
+	static TSharedPtr<FVARIDCaptureWriter, ESPMode::ThreadSafe> Begin(const FString& InDirectory, EVARIDCaptureFormat InFormat, int32 InQueueCapacity, FVARIDEncodeCaptureFrame InEncode);
+
+	/** ends the capture if End() hasn't */
+	~FVARIDCaptureWriter();
+
+	/** writes the frames already queued, waits for the thread and closes frames.csv. Frames pushed after are left unwritten */
+	void End();
+
+	/** the render thread is the producer */
+	FVARIDCaptureQueue& GetQueue();
+
+	const FString& GetDirectory() const;
+	EVARIDCaptureFormat GetFormat() const;
+
+	/** any thread. Frames written, and frames that couldn't be encoded or written. Frames dropped are the queue's */
+	uint64 GetNumWritten() const;
+	uint64 GetNumFailed() const;
+
+	/** the name of InFrame's file in the directory, e.g. Eye0_00001234.png */
+	static FString GetFrameFileName(const FVARIDCaptureFrame& InFrame, EVARIDCaptureFormat InFormat);
+
+	/** InFrame's pixels as the encoder takes them for InFormat: 8 bit BGRA for PNG, half float RGBA for EXR. Raw leaves them as they are */
+	static void ConvertPixels(const FVARIDCaptureFrame& InFrame, EVARIDCaptureFormat InFormat, TArray<uint8>& OutPixels);
+
+	/** "raw", "png" or "exr", any case. False for anything else */
+	static bool ParseFormat(const FString& InName, EVARIDCaptureFormat& OutFormat);
+
+private:
+	FVARIDCaptureWriter(const FString& InDirectory, EVARIDCaptureFormat InFormat, int32 InQueueCapacity, FVARIDEncodeCaptureFrame InEncode, FArchive* InMetadataFile);
+
+	/** on the writer thread. Writes queued frames until End() and the queue is empty */
+	void WriteFrames();
+	bool WriteFrame(const FVARIDCaptureFrame& InFrame);
+
+private:
+	const FString Directory;
+	const EVARIDCaptureFormat Format;
+	const FVARIDEncodeCaptureFrame Encode;
+	const double StartSeconds;
+
+	FVARIDCaptureQueue Queue;
+
+	TFuture<void> WriterThread;
+	TAtomic<bool> bStopping;
+	bool bEnded;
+
+	/** the writer thread's, reused from frame to frame */
+	TUniquePtr<FArchive> MetadataFile;
+	TArray<uint8> ConvertedPixels;
+	TArray<uint8> FileData;
+
+	TAtomic<uint64> NumWritten;
+	TAtomic<uint64> NumFailed;
+};
@@ -0,0 +1,78 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Atomic.h"
+#include "Templates/Function.h"
+
+// Creates VARID's shaders and pipeline states before they are first needed. Without it the first frame after BeginRendering() creates the RHI shader of
+// every pass it runs, and the pipeline state of every dispatch and draw, which is a visible hitch when the simulation is turned on mid session.
+// FVARIDSceneViewExtension::GetPipelineWarmupItems() gives one item per compute shader permutation and graphics pipeline; the module steps through them on
+// the render thread a few milliseconds a frame, and the view extension stays inactive until every one has been warmed. Kept free of render code so the
+// readiness can be checked on the CPU, and under NullRHI, with made up items - see FVARIDReference::ValidatePipelineWarmup().
+
+enum class EVARIDPipelineWarmupState : uint8
+{
+	NotStarted,
+	Warming,
+	Ready
+};
+
+/** one shader permutation or pipeline state to create. Warm returns false if it couldn't be, e.g. the permutation isn't compiled for this platform */
+struct FVARIDPipelineWarmupItem
+{
+public:
+	FString Name;
+	TFunction<bool()> Warm;
+
+public:
+	FVARIDPipelineWarmupItem();
+	FVARIDPipelineWarmupItem(const FString& InName, TFunction<bool()> InWarm);
+};
+
+class FVARIDPipelineWarmup
+{
+public:
+	FVARIDPipelineWarmup();
+
+	/** game thread. Starts warming InItems from the first. No items is ready at once, e.g. under NullRHI, which has no shaders to create */
+	void Start(TArray<FVARIDPipelineWarmupItem>&& InItems);
+
+	/**
+	 * render thread. Warms items until InBudgetSeconds have gone, at least one a call, and at most InMaxItems if it is above zero. The items warmed.
+	 * The last item makes it ready
+	 */
+	int32 Step(double InBudgetSeconds, int32 InMaxItems = 0);
+
+	/** game thread. Call before queueing a Step() to the render thread. False while the last one queued hasn't run, so only one is ever in flight */
+	bool QueueStep();
+
+	/** any thread */
+	EVARIDPipelineWarmupState GetState() const;
+	bool IsReady() const;
+
+	/** any thread. Items warmed so far, of how many, and how many of them failed */
+	int32 GetNumWarmed() const;
+	int32 GetNumItems() const;
+	int32 GetNumFailed() const;
+
+	/** render thread, or any thread once ready. The names of the items that failed, and the time the items took altogether */
+	const TArray<FString>& GetFailedNames() const;
+	double GetWarmSeconds() const;
+
+private:
+	TArray<FVARIDPipelineWarmupItem> Items;
+	TArray<FString> FailedNames;
+	double WarmSeconds;
+
+	/** read by the game thread while the render thread steps */
+	TAtomic<EVARIDPipelineWarmupState> State;
+	TAtomic<int32> NumWarmed;
+	TAtomic<int32> NumItems;
+	TAtomic<int32> NumFailed;
+	TAtomic<bool> bStepQueued;
+};
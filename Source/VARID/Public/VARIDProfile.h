@@ -5,8 +5,13 @@
 
 #pragma once
 
+#include "VARIDVFMapMesh.h"
+#include "VARIDVFMapImage.h"
+#include "VARIDVFMapPoints.h"
 #include "VARIDProfile.generated.h"
 
+struct FVARIDVFMapDerivedData;
+
 USTRUCT(BlueprintType)
 struct FVARIDVFMapPoint
 {
@@ -60,12 +65,58 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "VARID")
 		bool FullField;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "VARID")
+	/** compact, with positions shared between maps. Blueprints get and set them as FVARIDVFMapPoint with UVARIDBlueprintFunctionLibrary::GetVFMapPoints() and SetVFMapPoints() */
+	FVARIDVFMapPoints Points;
+
+	/** what Points used to be. Saved maps and blueprint made profiles that still fill it are moved into Points by MigrateDeprecatedData() */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "VARID", meta = (DeprecatedProperty, DeprecationMessage = "Data has been replaced by Points. Use GetVFMapPoints() and SetVFMapPoints() instead"))
 		TArray<FVARIDVFMapPoint> Data;
 
+	/** set when the profile gives an image file instead of points. Points is then empty. Shared by every copy of the profile, so it is only loaded once */
+	TSharedPtr<FVARIDVFMapImage, ESPMode::ThreadSafe> Image;
+
 public:
 	FVARIDVFMap();
 	FVARIDVFMap(const FVARIDVFMap& CopyMe);
+
+	/** moves the deprecated Data into Points when Points is empty, and empties Data */
+	void MigrateDeprecatedData();
+
+	/** migrates saved maps as they load */
+	void PostSerialize(const FArchive& Ar);
+
+	/**
+	 * FVARIDVFMapResolution::GetCurvatureBound() of Points, used by r.VARID.VFMap.LowRes to pick how coarse the RBF can be summed. Not saved -
+	 * worked out the first time it is asked for with an InXScale of 1 (mono) or 0.5 (side by side stereo), and then shared by every copy of the map
+	 */
+	float GetCurvatureBound(float InXScale) const;
+
+	/** makes the curvature bound of this map the blend of the bounds of InVFMap0 and InVFMap1, by InAlpha. Theirs are only worked out when this one is. Call after ResetDerivedData() */
+	void BlendCurvatureBounds(const FVARIDVFMap* InVFMap0, const FVARIDVFMap* InVFMap1, float InAlpha);
+
+	/**
+	 * Delaunay triangulation of Points, used by r.VARID.VFMap.Interpolation=1. Not saved - built from any thread the first time it is asked for,
+	 * and shared by every copy of the map, so copying a profile never copies it
+	 */
+	TSharedPtr<const FVARIDVFMapMesh, ESPMode::ThreadSafe> GetMesh() const;
+
+	/**
+	 * call after changing Points, so what was built from the old points is built again when it is next needed. Copies made before keep theirs.
+	 * InSamePositions has points at the same positions in the same order, and this map's mesh is then its triangles with this map's values
+	 */
+	void ResetDerivedData(const FVARIDVFMap* InSamePositions = nullptr);
+
+private:
+	TSharedPtr<FVARIDVFMapDerivedData, ESPMode::ThreadSafe> DerivedData;
+};
+
+template<>
+struct TStructOpsTypeTraits<FVARIDVFMap> : public TStructOpsTypeTraitsBase2<FVARIDVFMap>
+{
+	enum
+	{
+		WithPostSerialize = true,
+	};
 };
 
 
@@ -233,5 +284,6 @@ public:
 	void DisableAllFX();
 	TArray <FVARIDFX*> GetFX();
 	FVARIDFX* GetFX(int32 ID);
+	TArray <FVARIDVFMap*> GetVFMaps();
 	void ToggleFX(int32 ID);
 };
\ No newline at end of file
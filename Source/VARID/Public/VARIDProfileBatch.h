@@ -0,0 +1,39 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VARIDProfile.h"
+
+// One image rendered through many profiles at once, e.g. every stage of a condition side by side for a clinical comparison.
+// Entries that inpaint the same way share one inpainted colour and its Gaussian/Laplacian pyramids. Only the VF maps, contrast reconstruct
+// and composite run per entry. FVARIDModule::RenderProfileBatch() runs it on the GPU, FVARIDReference::RenderProfileBatch() on the CPU.
+
+struct FVARIDProfileBatchEntry
+{
+public:
+	FVARIDProfile Profile;
+
+	/** the same as FVARIDEyeTracking, for the eye being rendered */
+	FVector2D GazePoint;
+
+	/** the eye of the profile the image is rendered with. 0 = left, 1 = right */
+	int32 EyeIndex;
+
+public:
+	FVARIDProfileBatchEntry();
+	FVARIDProfileBatchEntry(const FVARIDProfile& InProfile, const FVector2D& InGazePoint, int32 InEyeIndex = 0);
+
+	/** the eye that is rendered, or nullptr if the profile isn't valid. The output is then a copy of the input */
+	const FVARIDEye* GetEye() const;
+};
+
+struct FVARIDProfileBatch
+{
+public:
+	/** the entries that can share pyramids, by FVARIDViewProfiles::GetInpaintHash(). Groups are in the order of their first entry, entries in batch order */
+	static TArray<TArray<int32>> GroupBySharedPyramids(const TArray<FVARIDProfileBatchEntry>& InEntries);
+};
@@ -0,0 +1,96 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VARIDProfile.h"
+
+// Reloads the active profile while it is being authored. FVARIDModule::BeginProfileHotReload() polls the profile's file and, once it has stopped
+// changing, reparses only the VF maps whose json changed. The rest keep their points, meshes, curvature bounds and image textures, so an edit to one
+// map doesn't rebuild or upload the other 25. Kept free of render code so it can be checked on the CPU - see FVARIDReference::ValidateProfileHotReload().
+
+/** one VF map of a profile and where it is in the profile json */
+struct FVARIDProfileVFMapSlot
+{
+public:
+	FString JsonPath;
+	FVARIDVFMap* VFMap;
+
+public:
+	FVARIDProfileVFMapSlot();
+	FVARIDProfileVFMapSlot(const FString& InJsonPath, FVARIDVFMap* InVFMap);
+};
+
+/** tells when a file that is being saved has settled. A save can be several writes, and an editor can save several times in a row */
+struct FVARIDFileChangeDebounce
+{
+public:
+	/** what identified the file's contents when it was last reloaded, or is waiting to be */
+	int64 AppliedStamp;
+	int64 PendingStamp;
+
+	/** when PendingStamp was first seen */
+	double PendingSeconds;
+	bool bPending;
+
+public:
+	FVARIDFileChangeDebounce();
+
+	/** starts from InStamp without a change pending */
+	void Reset(int64 InStamp);
+
+	/** InStamp identifies the file's contents now, e.g. its time and size. True once a change has gone InDebounceSeconds without another */
+	bool Update(int64 InStamp, double InNowSeconds, double InDebounceSeconds);
+};
+
+class FVARIDProfileHotReload
+{
+public:
+	/** two eyes of blur, inpaint, ten contrast levels and warp */
+	static const int32 NumVFMaps = 26;
+
+public:
+	/** InProfileFullPath is the profile the hashes are of. InHashes from HashVFMaps() */
+	FVARIDProfileHotReload(const FString& InProfileFullPath, float InDebounceSeconds, const TArray<uint32>& InHashes);
+
+	/**
+	 * the VF maps of InProfile in the order LoadProfile() parses them, each with its json path. Contrast gets its ten levels if it hasn't got them.
+	 * Contrast level n of the json is VFMaps[9 - n]
+	 */
+	static void GetVFMapSlots(FVARIDProfile& InProfile, TArray<FVARIDProfileVFMapSlot>& OutSlots);
+
+	/**
+	 * a hash of the json of each VF map, in slot order, with everything else its parse depends on: the display FOV and, for an image map, the size and
+	 * time of the image file. Formatting and key order don't change a hash. False if the json doesn't parse, e.g. it is half written
+	 */
+	static bool HashVFMaps(const FString& InJsonString, const FVector2D& InDisplayFOV, const FString& InProfileDir, TArray<uint32>& OutHashes);
+
+	/**
+	 * parses, with InParseVFMap, every VF map whose hash in InNewHashes differs from InOutHashes, and only then replaces them in InOutProfile. If any fails to
+	 * parse nothing is replaced. OutChangedSlots gets the slots replaced. InOutHashes becomes InNewHashes on success
+	 */
+	static bool ApplyChangedVFMaps(const TArray<uint32>& InNewHashes, TFunctionRef<bool(const FString& InJsonPath, FVARIDVFMap& OutVFMap)> InParseVFMap, FVARIDProfile& InOutProfile, TArray<uint32>& InOutHashes, TArray<int32>& OutChangedSlots);
+
+	/** the time and size of the file, 0 if it doesn't exist */
+	static int64 GetFileStamp(const FString& InFilePath);
+
+	const FString& GetProfileFullPath() const;
+	float GetDebounceSeconds() const;
+
+public:
+	/** of the maps as they are in the active profile */
+	TArray<uint32> Hashes;
+
+	FVARIDFileChangeDebounce Debounce;
+
+	/** reloads so far, and VF maps they reparsed */
+	int32 NumReloads;
+	int32 NumVFMapsReparsed;
+
+private:
+	const FString ProfileFullPath;
+	const float DebounceSeconds;
+};
@@ -0,0 +1,93 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VARIDProfile.h"
+#include "VARIDVFMapPointTable.h"
+
+// A progression steps through keyframe profiles, e.g. early, moderate and advanced glaucoma, with one time value rather than a profile per step.
+// Between two keyframes each VF map is blended point by point: the union of both maps' points, a point missing from one keyframe being zero there.
+// The RBF sum is linear in the values, so that is the blend of the two maps themselves, before the clamp.
+// With r.VARID.VFMap.Combined=1 the keyframes are packed into tables that are uploaded once, and the VF map kernel does the blend - see PackKeyframeTables().
+// Kept free of render code so the blend can be checked on the CPU - see FVARIDReference::ValidateProfileProgression().
+
+/** an eye of a combined VF map table: the eye of the profile it shows, and the stereo transform of its points */
+struct FVARIDProgressionTableEye
+{
+public:
+	int32 EyeIndex;
+	float XScale;
+	float XOffset;
+
+public:
+	FVARIDProgressionTableEye();
+	FVARIDProgressionTableEye(int32 InEyeIndex, float InXScale, float InXOffset);
+
+	bool operator==(const FVARIDProgressionTableEye& Other) const;
+};
+
+struct FVARIDProfileProgression
+{
+public:
+	/** in order. All valid */
+	TArray<FVARIDProfile> Keyframes;
+
+	/** the time of each keyframe, ascending */
+	TArray<float> Times;
+
+public:
+	/** InTimes may be empty, which puts keyframe k at time k. Fails without keyframes, with one that isn't valid, or with times that aren't one per keyframe and ascending */
+	static bool Create(const TArray<FVARIDProfile>& InKeyframes, const TArray<float>& InTimes, FVARIDProfileProgression& OutProgression);
+
+	/** the keyframes either side of InTime and how far it is from the first to the second, 0..1. Before the first keyframe or after the last it holds there */
+	void GetSegment(float InTime, int32& OutKeyframe0, int32& OutKeyframe1, float& OutAlpha) const;
+
+	/**
+	 * the profile at InTime. An FX is on if either keyframe has it on. Maps that can't be blended point by point - image maps, or a full field map
+	 * against one that isn't - switch over half way through the segment. The mesh of r.VARID.VFMap.Interpolation is of the union points, so it only
+	 * matches a keyframe's own mesh where both keyframes have points in the same places
+	 */
+	FVARIDProfile Evaluate(float InTime) const;
+
+	/** every segment blends point by point, so the tables of PackKeyframeTables() give the same VF maps as Evaluate() */
+	bool CanPackKeyframeTables() const;
+
+	/**
+	 * a combined VF map table per keyframe, each with the same entries in the same order, so entry i of keyframe k can go at k * NumEntries + i of one buffer.
+	 * The points are left without the gaze offset, which the kernel adds. An entry has the channels of every keyframe, zero where a keyframe has no point
+	 */
+	void PackKeyframeTables(const TArray<FVARIDProgressionTableEye>& InEyes, int32 InNumMips, bool bInWarp, TArray<FVARIDVFMapPointTable>& OutTables) const;
+
+	/** what the PROGRESSION permutation of VARIDVFMapCombinedCS.usf reads for each entry: two keyframe tables blended, and moved by InGazeOffsets of their eye */
+	static void BlendKeyframeTables(const FVARIDVFMapPointTable& InTable0, const FVARIDVFMapPointTable& InTable1, float InAlpha, const FVector2D InGazeOffsets[2], FVARIDVFMapPointTable& OutTable);
+
+	/** the part of the blend left to the CPU: the origin offsets, which go to the kernel as they are */
+	static void BlendOriginOffsets(const FVARIDVFMapPointTable& InTable0, const FVARIDVFMapPointTable& InTable1, float InAlpha, FVector2D OutOriginOffsets[EVARIDVFMapChannel::Num]);
+
+	/** where the gaze point moves the points of an eye, in scene colour UV */
+	static FVector2D GetGazeOffset(const FVARIDProgressionTableEye& InEye, const FVector2D& InGazePoint);
+
+private:
+	/** a VF map of a segment: the union point each point of the two keyframes adds to, or a switch when they can't be blended */
+	struct FBlendedVFMap
+	{
+		bool bSwitch = false;
+		TArray<int32> UnionIndices[2];
+	};
+
+	/** a pair of neighbouring keyframes. Template has the union points, which only need values to become the profile. Its mesh is built the first time an evaluation is drawn with one */
+	struct FSegment
+	{
+		FVARIDProfile Template;
+		TArray<FBlendedVFMap> VFMaps;
+	};
+
+	TArray<FSegment> Segments;
+
+private:
+	void BuildSegments();
+};
@@ -0,0 +1,30 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Where each mip level of a viewport lies, and how VARIDGaussianPyramidCS.usf divides the pyramid into tiles. The renderer sizes its passes
+// with these and FVARIDReference emulates them, so they are kept out of both.
+
+struct FVARIDPyramidLayout
+{
+public:
+	/** the viewport rect of a mip level, the same as the multi pass dispatches use */
+	static FIntRect GetMipViewportRect(const FIntRect& InViewportRect, int32 InMipLevel);
+
+	/** VARIDGaussianPyramidCS.usf builds two levels a stage. Every stage but the last has a level after it, so NumMips / 2, and at least 1 */
+	static int32 GetGaussianPyramidNumStages(int32 InNumMips);
+
+	/**
+	 * tiles of stage InStage of VARIDGaussianPyramidCS.usf. A tile covers 32x32 texels of level InStage * 2 and builds the next two levels.
+	 * Stage 0 is the dispatch, one group per tile
+	 */
+	static FIntPoint GetGaussianPyramidTileCount(const FIntRect& InViewportRect, int32 InStage);
+
+	/** the size of the buffer of tile counters VARIDGaussianPyramidCS.usf takes, one per tile of stage 1 and up. At least 1 */
+	static int32 GetGaussianPyramidNumTileCounters(const FIntRect& InViewportRect, int32 InNumMips);
+};
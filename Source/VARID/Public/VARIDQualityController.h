@@ -0,0 +1,110 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Holds VARID's GPU time to a budget by stepping through quality levels between frames (r.VARID.DynamicQuality). Each level turns down one or more of
+// the knobs VARID has - pyramid depth, inpaint passes, VF map resolution and the contrast a tile needs to be processed rather than copied - and level 0
+// leaves them all to their console variables. The render thread times VARID's passes with GPU timestamps and feeds the time of each frame in, a few frames
+// late; the controller steps down after a run of frames over the budget and up after a longer run well under it, waits for the timings of the new level
+// before judging it, and waits longer each time a step up has to be undone, so it settles instead of hunting. r.VARID.Quality caps the best level
+// it may use. It defaults to epic, level 0, and only follows the post process scalability group when a project sets it to -1. Kept free of render code so it can be checked on the CPU against made up timings - see
+// FVARIDReference::ValidateQualityController().
+
+/** the knobs of one quality level. Each is either left to its console variable or turned down from it */
+struct FVARIDQualitySettings
+{
+public:
+	/** cap on the number of pyramid levels. Levels past it are left out of the contrast FX */
+	uint8 MaxNumMips;
+
+	/** inpaint fill passes. A multiple of 4, see r.VARID.Inpaint.TiledFill */
+	int32 InpaintPasses;
+
+	/** 0 leaves the VF maps to r.VARID.VFMap.LowRes. Otherwise they are summed at low resolution within at least this error */
+	float VFMapMaxError;
+
+	/** 0 leaves tile classification to r.VARID.TileClassification. Otherwise it is on, and contrast tiles whose VF map is at or below at least this are copied */
+	float ContrastThreshold;
+
+public:
+	FVARIDQualitySettings();
+	FVARIDQualitySettings(uint8 InMaxNumMips, int32 InInpaintPasses, float InVFMapMaxError, float InContrastThreshold);
+
+	/** 0 is the best, NumLevels - 1 the cheapest */
+	static FVARIDQualitySettings GetLevel(int32 InLevel);
+	static const int32 NumLevels = 6;
+
+	/** the best level r.VARID.Quality, 0 (low) to 3 (epic), allows */
+	static int32 GetBestLevelForQuality(int32 InQuality);
+};
+
+struct FVARIDQualityControllerSettings
+{
+public:
+	/** GPU milliseconds VARID may take a frame */
+	float BudgetMs;
+
+	/** a frame is over the budget above BudgetMs * OverFraction, and well under it below BudgetMs * UnderFraction */
+	float OverFraction;
+	float UnderFraction;
+
+	/** frames in a row over the budget before stepping down, and well under it before stepping up */
+	int32 FramesToStepDown;
+	int32 FramesToStepUp;
+
+	/** frames after a step whose timings are ignored, as they can be from before it. At least the latency of the timings */
+	int32 SettleFrames;
+
+	/** the levels it may use */
+	int32 BestLevel;
+	int32 WorstLevel;
+
+public:
+	FVARIDQualityControllerSettings();
+};
+
+class FVARIDQualityController
+{
+public:
+	FVARIDQualityController();
+
+	/** starts over at InLevel, with no history */
+	void Reset(int32 InLevel);
+
+	/** the GPU milliseconds of one frame. True if the level changed */
+	bool Update(float InMilliseconds, const FVARIDQualityControllerSettings& InSettings);
+
+	int32 GetLevel() const;
+
+	/** the timings averaged over the last few frames. 0 until there is one */
+	float GetAverageMs() const;
+
+	/** steps taken since the last Reset(), down and up */
+	int32 GetNumStepsDown() const;
+	int32 GetNumStepsUp() const;
+
+private:
+	/** moves to InLevel and waits for timings of it */
+	void Step(int32 InLevel, const FVARIDQualityControllerSettings& InSettings);
+
+private:
+	int32 Level;
+	float AverageMs;
+	bool bHasAverage;
+
+	int32 FramesOver;
+	int32 FramesUnder;
+	int32 FramesToSettle;
+
+	/** frames since the last step up, and how many times longer than FramesToStepUp the next one waits */
+	int32 FramesSinceStepUp;
+	int32 StepUpBackoff;
+
+	int32 NumStepsDown;
+	int32 NumStepsUp;
+};
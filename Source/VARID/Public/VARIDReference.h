@@ -0,0 +1,450 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VARIDProfile.h"
+#include "VARIDWorkingTexturePlan.h"
+#include "VARIDVFMapPointTable.h"
+#include "VARIDViewProfiles.h"
+#include "VARIDProfileBatch.h"
+#include "VARIDProfileProgression.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// CPU versions of the VARID render stages. They follow the compute shaders line by line (including their edge behaviour) so that
+// alternative GPU code paths can be checked against the original ones without a GPU. Each Validate*() is an automation test under
+// VARID.Reference - see VARIDTests.cpp. Not built without WITH_DEV_AUTOMATION_TESTS, e.g. in shipping builds.
+//
+// Each stage's reference lives in its own VARID<Stage>Reference.cpp next to the code it checks. VARIDReference.cpp only has FVARIDImage
+// and the helpers several of them share.
+
+struct FVARIDImage
+{
+public:
+	FIntPoint Size;
+	TArray<FVector4> Pixels;
+
+public:
+	FVARIDImage();
+	FVARIDImage(const FIntPoint& InSize);
+
+	/** out of bounds reads return zero - the same as Texture2D.Load() and Texture2D[] in HLSL */
+	FVector4 Load(int32 X, int32 Y) const;
+
+	/** out of bounds writes are ignored - the same as RWTexture2D[] in HLSL */
+	void Store(int32 X, int32 Y, const FVector4& Value);
+
+	bool IsInside(int32 X, int32 Y) const;
+};
+
+
+/** the tile lists built by VARIDTileClassifyCS.usf. Entries are 8x8 thread groups of the regular dispatch, relative to the region min */
+struct FVARIDTileLists
+{
+public:
+	TArray<FIntPoint> AffectedGroups;
+	TArray<FIntPoint> UnaffectedGroups;
+
+public:
+	/** fraction of the thread groups that only need the copy path */
+	float GetSkippedFraction() const;
+};
+
+
+/** what the compute compositor samples on top of the contrast VF map, for VARIDTileClassifyCS.usf's CLASSIFY_COMPOSITOR permutation */
+struct FVARIDCompositorTileInput
+{
+public:
+	const FVARIDImage* BlurVFMap = nullptr;
+	const FVARIDImage* WarpVFMap = nullptr;
+
+	/** blur VF map -> mip level sampled */
+	float BlurScale = 0.0f;
+
+	/** warp VF map -> texels the sample moves */
+	FVector2D WarpTexelScale = FVector2D::ZeroVector;
+
+	float Threshold = 0.0f;
+};
+
+
+/** the table built by VARIDSummedAreaTableCS.usf: RGB quantised to 10 bits and summed from Origin in uint32, allowed to wrap */
+struct FVARIDSummedAreaTable
+{
+public:
+	FIntPoint Size;
+	FIntPoint Origin;
+	TArray<uint32> Sums;	// 3 per texel
+
+public:
+	FVARIDSummedAreaTable();
+
+	/** corners before Origin are zero - the same as LoadSATCorner() */
+	uint32 LoadCorner(int32 X, int32 Y, int32 InChannel) const;
+
+	/** average of InBoxMin..InBoxMax (inclusive) - the same as SATBoxAverage() */
+	FVector4 BoxAverage(const FIntPoint& InBoxMin, const FIntPoint& InBoxMax) const;
+};
+
+
+class FVARIDReference
+{
+public:
+
+	/*****************************************************************************************************************/
+	// shared by several stages
+
+	static const float MaskThreshold;	// must match VARIDCommon.ush
+	static const int32 TileListGroupSize = 8;	// must match VARIDTileList.ush
+	static const int32 TileListMaxGroupsX = 65535;	// must match VARIDTileList.ush
+
+	static float SaturateUNORM(float InValue);
+
+	/** a UNORM16 texture write followed by a read */
+	static float QuantiseUNORM16(float InValue);
+
+	/** GetTileListGroupCount() in VARIDTileList.ush: the 2D indirect dispatch of a list, rows of at most TileListMaxGroupsX groups */
+	static FIntPoint GetTileListGroupCount(int32 InNumEntries);
+
+	/** origins of the thread groups a dispatch over InRect launches - every group, or only those in the tile list */
+	static void GetDispatchGroupOrigins(const FIntRect& InRect, int32 InGroupSize, const TArray<FIntPoint>* InTileList, TArray<FIntPoint>& OutOrigins);
+
+	/** OutFirstMismatch is (-1, -1) when the sizes differ */
+	static bool ImagesAreIdentical(const FVARIDImage& A, const FVARIDImage& B, FIntPoint& OutFirstMismatch);
+
+	static FIntPoint ClampToRect(const FIntPoint& InPosition, const FIntRect& InRect);
+
+	/** alpha set to 1, as the colour textures are written */
+	static FVector4 RGBOnly(const FVector4& InColour);
+
+	/** InNumMips levels of InExtent, halved per level down to 1x1 */
+	static void AllocateMips(const FIntPoint& InExtent, int32 InNumMips, TArray<FVARIDImage>& OutMips);
+
+	/** bilinear filter at InUV of a texture InSize texels big. InLoad returns the texel at an (unclamped) position */
+	template<typename LoadFunctionType>
+	static FVector4 BilinearFilter(const FIntPoint& InSize, const FVector2D& InUV, LoadFunctionType InLoad);
+
+	/** SampleLevel() with a bilinear AM_Clamp sampler */
+	static FVector4 SampleBilinearClamped(const FVARIDImage& InImage, const FVector2D& InUV);
+
+	/*****************************************************************************************************************/
+	// inpaint
+
+	/** builds the state VARIDInpainterInitialiseCS.usf would produce for a synthetic mask with a couple of scotoma shaped holes and some single masked pixels */
+	static void BuildSyntheticInpaintState(const FIntPoint& InSize, float InSpeckleProbability, FVARIDImage& OutMask, FVARIDImage& OutColour, FVARIDImage& OutMetaData);
+
+	/** one pass of VARIDInpainterFillCS.usf over InActiveRect. With InTileList only the listed 8x8 groups are run */
+	static void InpaintFillPass(const FVARIDImage& InMask, const FVARIDImage& InColour, const FVARIDImage& InMetaData, FVARIDImage& OutColour, FVARIDImage& OutMetaData, const FIntRect& InActiveRect, int32 InPassCounter, const TArray<FIntPoint>* InTileList = nullptr);
+
+	/** emulates VARIDInpainterFillTiledCS.usf: InIterations passes per dispatch, using a tile + halo cache per thread group. With InTileList only the listed groups are run */
+	static void InpaintFillTiled(const FVARIDImage& InMask, const FVARIDImage& InColour, const FVARIDImage& InMetaData, FVARIDImage& OutColour, FVARIDImage& OutMetaData, const FIntRect& InActiveRect, int32 InPassCounter, int32 InIterations, int32 InTileSize, const TArray<FIntPoint>* InTileList = nullptr);
+
+	/** runs the full ping-pong fill sequence on synthetic data, single pass vs tiled, and expects bit identical results with both rounding filled colours to the UNORM16 colour textures */
+	static bool ValidateInpaintFill(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// gaussian pyramid
+
+	/**
+	 * the multi pass pyramid: copy, then GaussianBlur() (Blur5 by default, full precision cache) and 2x2 downsample per level, as
+	 * BuildGaussianPyramid_RenderThread() dispatches them. Reads outside the viewport are clamped to its edge
+	 */
+	static void GaussianPyramidMultiPass(const FVARIDImage& InImage, const FIntRect& InViewportRect, int32 InNumMips, TArray<FVARIDImage>& OutMips, int32 InKernelWidth = 5);
+
+	/**
+	 * emulates VARIDGaussianPyramidCS.usf, tile counters included, with the groups run one at a time in a scrambled order. OutNumCarriedOn is the
+	 * tiles of later stages a group carried on with, OutTailLevel the first level read from the groupshared output tile rather than the mip (-1 if none)
+	 */
+	static void GaussianPyramidSinglePass(const FVARIDImage& InImage, const FIntRect& InViewportRect, int32 InNumMips, TArray<FVARIDImage>& OutMips, int32* OutNumCarriedOn = nullptr, int32* OutTailLevel = nullptr);
+
+	/** compares every level of both pyramids for a left and a right eye viewport */
+	static bool ValidateGaussianPyramid(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// gaussian blur
+
+	/** the weights of Blur5, Blur7 or Blur9 in VARIDCommon.ush, in tap order. InKernelWidth must be 5, 7 or 9 */
+	static const float* GetBlurWeights(int32 InKernelWidth);
+
+	/** emulates VARIDGaussianBlurCS.usf over the 8x8 groups covering InDispatchRect, with its reads clamped to InClampRect and the optional f16 cache */
+	static void GaussianBlur(const FVARIDImage& InImage, const FIntRect& InDispatchRect, const FIntRect& InClampRect, int32 InKernelWidth, bool bInHalfPrecisionCache, FVARIDImage& OutImage);
+
+	/** pins every kernel width: binomial weights, exact impulse responses, the f16 cache error and a lossless contrast chain */
+	static bool ValidateGaussianBlurKernels(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// contrast
+
+	/** the top level of the contrast pyramid, a copy of the gaussian one */
+	static void DirectCopyTopLevel(const TArray<FVARIDImage>& InGaussianMips, const FIntRect& InViewportRect, TArray<FVARIDImage>& OutContrastMips);
+
+	/** one texel of VARIDContrastReconstructFusedCS.usf */
+	static FVector4 ReconstructFusedPixel(int32 X, int32 Y, const TArray<FVARIDImage>& InGaussianMips, const TArray<FVARIDImage>& InVFMapMips, const TArray<FVARIDImage>& InContrastMips, int32 InMipLevel, const FIntRect& InHiResRect, const FIntRect& InLoResRect);
+
+	/** the laplacian pyramid (stored biased in UNORM16) followed by the reconstruct chain. Both expand with a bilinear upsample and the pyramid blur (Blur5 by default) */
+	static void ContrastReconstructMultiPass(const TArray<FVARIDImage>& InGaussianMips, const TArray<FVARIDImage>& InVFMapMips, const FIntRect& InViewportRect, TArray<FVARIDImage>& OutContrastMips, int32 InKernelWidth = 5);
+
+	/** the first half of ContrastReconstructMultiPass(): the laplacian pyramid, stored biased in UNORM16. Its top level is a copy of the gaussian */
+	static void LaplacianPyramid(const TArray<FVARIDImage>& InGaussianMips, const FIntRect& InViewportRect, TArray<FVARIDImage>& OutLaplacianMips, int32 InKernelWidth = 5);
+
+	/** the second half: the reconstruct chain from a laplacian pyramid, so one pyramid can be reconstructed with many VF maps */
+	static void ContrastReconstructFromLaplacian(const TArray<FVARIDImage>& InLaplacianMips, const TArray<FVARIDImage>& InVFMapMips, const FIntRect& InViewportRect, TArray<FVARIDImage>& OutContrastMips, int32 InKernelWidth = 5);
+
+	/** emulates VARIDContrastReconstructFusedCS.usf: the laplacian band is computed on the fly from the gaussian pyramid. With InLevel0TileLists, unaffected level 0 groups are a copy of the gaussian */
+	static void ContrastReconstructFused(const TArray<FVARIDImage>& InGaussianMips, const TArray<FVARIDImage>& InVFMapMips, const FIntRect& InViewportRect, TArray<FVARIDImage>& OutContrastMips, const FVARIDTileLists* InLevel0TileLists = nullptr);
+
+	/** compares every level of both reconstructions for a left and a right eye viewport */
+	static bool ValidateContrastReconstruct(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// tile classification
+
+	/** emulates VARIDHeightMapCS.usf, or VARIDVFMapImageCS.usf for a loaded image map, for one eye rendered on its own - no stereo squeeze, no gaze offset. OutImage must already have the size of the mip level */
+	static void EvaluateVFMap(const FVARIDVFMap& InVFMap, const FIntRect& InViewportRect, int32 InMipLevel, FVARIDImage& OutImage);
+
+	/**
+	 * emulates VARIDTileClassifyCS.usf. InRegionRect is a rect of InVFMapMips[0]. Level N of the footprint is read from InVFMapMips[N]. With InCompositor,
+	 * the CLASSIFY_COMPOSITOR permutation
+	 */
+	static void ClassifyTiles(const TArray<FVARIDImage>& InVFMapMips, const FIntRect& InRegionRect, int32 InNumLevels, int32 InDilation, float InThreshold, FVARIDTileLists& OutTileLists, const FVARIDCompositorTileInput* InCompositor = nullptr);
+
+	/**
+	 * runs the inpaint fill, the fused contrast reconstruct and the compute compositor over tile lists and compares them with the full dispatches. Lists
+	 * longer than a dispatch allows along an axis must still run each entry once
+	 */
+	static bool ValidateTileClassification(FString& OutReport);
+
+	/** the fraction of contrast and inpaint thread groups the tile lists skip for a profile, per eye. Every FX is treated as enabled */
+	static void ReportTileSkipFractions(const FVARIDProfile& InProfile, const FIntPoint& InEyeSize, float InContrastThreshold, FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// working textures
+
+	/**
+	 * emulates VARIDHeightMapCS.usf over the eyes of a plan. InEyePoints holds the points of each plan eye, already in scene colour UV. OutImage must already have the size of the mip level.
+	 * With InGradientStep it emulates the OUTPUT_GRADIENT permutation and stores the warp field in xy. InEyeOriginOffsets is InOriginOffset of each eye
+	 */
+	static void EvaluatePlanHeightMap(const FVARIDWorkingTexturePlan& InPlan, const TArray<TArray<FVARIDVFMapPoint>>& InEyePoints, int32 InMipLevel, FVARIDImage& OutImage, const FVector2D* InGradientStep = nullptr, const FVector2D& InEyeOriginOffsets = FVector2D(0.0f, 0.0f));
+
+	/** checks the per eye and single pass stereo layouts against the scene sized one: same VF map values, half the memory per view, one pipeline build per stereo frame */
+	static bool ValidateWorkingTexturePlan(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// warp
+
+	/** the clamped RBF sum of VARIDHeightMapCS.usf at one scene UV, starting from InOriginOffset. OutGradient gets the closed form gradient, zero where the clamp applies */
+	static float EvaluateHeight(const TArray<FVARIDVFMapPoint>& InPoints, const FVector2D& InUV, FVector2D* OutGradient = nullptr, float InOriginOffset = 0.0f);
+
+	/** compares the analytic warp field with a central difference of the height map at two resolutions, and checks the displacement doesn't change with the resolution */
+	static bool ValidateWarpField(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// blur
+
+	/** box radius the BLUR_MODE_SAT compositor uses for a blur VF map value. The box is 2^(blur * InMaxMipLevel) texels wide */
+	static float GetSummedAreaTableBlurRadius(float InBlurAmount, float InMaxMipLevel);
+
+	/** emulates both passes of VARIDSummedAreaTableCS.usf over InRegionRect */
+	static void BuildSummedAreaTable(const FVARIDImage& InImage, const FIntRect& InRegionRect, FVARIDSummedAreaTable& OutTable);
+
+	/** the BLUR_MODE_SAT compositor, without the warp, for every texel of InViewportRect */
+	static void BlurSummedAreaTable(const FVARIDSummedAreaTable& InTable, const FVARIDImage& InBlurVFMap, const FIntRect& InViewportRect, float InMaxMipLevel, FVARIDImage& OutImage);
+
+	/** the original compositor, without the warp: a trilinear (AM_Clamp) sample of InMips at blur * InMaxMipLevel */
+	static void BlurMipChain(const TArray<FVARIDImage>& InMips, const FVARIDImage& InBlurVFMap, const FIntRect& InViewportRect, float InMaxMipLevel, FVARIDImage& OutImage);
+
+	/** the box the SAT blur stands for at one texel, summed texel by texel in float - the ground truth both blurs are measured against */
+	static FVector4 BoxBlurBruteForce(const FVARIDImage& InImage, const FIntRect& InViewportRect, const FIntPoint& InCentre, float InRadius);
+
+	/** checks the SAT blur against the brute force box, and reports the error and CPU time of both the SAT and the mip chain blur */
+	static bool ValidateSummedAreaTableBlur(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// compositor
+
+	/** VARIDQuadPS.usf for a working texture the size of the scene: a trilinear sample of the stored contrast mips at the warped UV */
+	static void CompositeRaster(const TArray<FVARIDImage>& InContrastMips, const FVARIDImage& InBlurVFMap, const FVARIDImage& InWarpVFMap, const FIntRect& InViewportRect, FVARIDImage& OutImage);
+
+	/**
+	 * emulates VARIDCompositorCS.usf: the same, but level 0 texels are reconstructed (and rounded to UNORM16) where they are sampled. InContrastMips level 0
+	 * is not read. With InTileLists only the affected groups are composited, and the unaffected ones are CopyCS's rounded copy of the gaussian
+	 */
+	static void CompositeCompute(const TArray<FVARIDImage>& InGaussianMips, const TArray<FVARIDImage>& InVFMapMips, const TArray<FVARIDImage>& InContrastMips, const FVARIDImage& InBlurVFMap, const FVARIDImage& InWarpVFMap, const FIntRect& InViewportRect, FVARIDImage& OutImage, const FVARIDTileLists* InTileLists = nullptr);
+
+	/** checks the compute compositor gives exactly the output of the level 0 reconstruct pass followed by the raster compositor */
+	static bool ValidateComputeCompositor(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// VF map mesh
+
+	/** the 54 point 24-2 layout the profile templates use, normalised the same way as ParseVFMap() in VARIDModule.cpp */
+	static void BuildVFMap242(const FVector2D& InFOV, int32 InSeed, FVARIDVFMap& OutVFMap);
+
+	/**
+	 * emulates VARIDVFMapMeshVS.usf + VARIDVFMapMeshPS.usf for one eye: the triangles are sampled at texel centres with a top left fill rule,
+	 * so a texel shared by two triangles is written once, clipped to InScissorRect. With InGradientStep it emulates the OUTPUT_GRADIENT permutation.
+	 * OutCoverage, if given, is the size of OutImage and counts the triangles that wrote each texel
+	 */
+	static void RasteriseVFMapMesh(const FVARIDVFMapMesh& InMesh, const FVector4& InPointScaleBias, const FVector4& InSceneUVScaleBias, float InOriginOffset, const FIntRect& InScissorRect, FVARIDImage& OutImage, const FVector2D* InGradientStep = nullptr, TArray<int32>* OutCoverage = nullptr);
+
+	/** checks the triangulation is Delaunay and goes through the points, and that the rasterised mesh covers every texel once and matches the mesh field. Reports the cost next to the RBF */
+	static bool ValidateVFMapMesh(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// VF map image
+
+	/** a generated image, decoded from memory rather than a file */
+	static FVARIDDecodeVFMapImage MakeGeneratedVFMapImageDecode(const FVARIDVFMapImagePixels& InPixels, int32* OutNumDecodes = nullptr);
+
+	/**
+	 * emulates VARIDVFMapImageCS.usf for one eye over InRegionRect, at the mip level BuildHeightMapTextureFromImages_RenderThread picks.
+	 * With InGradientStep it emulates the OUTPUT_GRADIENT permutation. Before the image has loaded it writes the origin offset, as the point paths leave it
+	 */
+	static void EvaluateVFMapImage(const FVARIDVFMapImage& InImage, const FVector4& InPointScaleBias, const FVector4& InSceneUVScaleBias, float InOriginOffset, const FIntRect& InRegionRect, FVARIDImage& OutImage, const FVector2D* InGradientStep = nullptr);
+
+	/** loads generated images through the background path and checks their normalisation, mips, sampling and warp field. Reports the cost next to the RBF */
+	static bool ValidateVFMapImage(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// VF map resolution
+
+	/** the RBF sum of VARIDHeightMapCS.usf at one scene UV, before the clamp. What the r.VARID.VFMap.LowRes nodes hold */
+	static float EvaluateHeightUnclamped(const TArray<FVARIDVFMapPoint>& InPoints, const FVector2D& InUV);
+
+	/**
+	 * emulates the r.VARID.VFMap.LowRes path of BuildHeightMapTexture_RenderThread with the same inputs as EvaluatePlanHeightMap(): VARIDHeightMapCS.usf
+	 * on the FVARIDVFMapNodeGrid of InFactor, then VARIDVFMapUpsampleCS.usf. OutNumNodes, if given, gets the number of nodes summed
+	 */
+	static void EvaluatePlanHeightMapUpsampled(const FVARIDWorkingTexturePlan& InPlan, const TArray<TArray<FVARIDVFMapPoint>>& InEyePoints, int32 InMipLevel, int32 InFactor, FVARIDImage& OutImage, int32* OutNumNodes = nullptr);
+
+	/** checks the curvature bound against the measured curvature, and the upsampled height maps against the full resolution ones at the factor the bound picks. Reports the RBF evaluations saved */
+	static bool ValidateVFMapResolution(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// VF map combined
+
+	/**
+	 * emulates VARIDVFMapCombinedCS.usf over a plan, thread by thread. The contrast mips must already have the size of their level. With InGradientStep the warp field goes
+	 * to OutWarp as BuildVFMapTexturesCombined_RenderThread does with r.VARID.Warp.AnalyticGradient. OutNumWeights, if given, gets the number of exp() calls
+	 */
+	static void EvaluatePlanVFMapsCombined(const FVARIDWorkingTexturePlan& InPlan, const FVARIDVFMapPointTable& InTable, int32 InNumMips, const FVector2D* InGradientStep, FVARIDImage& OutBlur, FVARIDImage& OutInpaint, TArray<FVARIDImage>& OutContrastMips, FVARIDImage& OutWarp, int64* OutNumWeights = nullptr);
+
+	/** checks the one dispatch gives the maps of a dispatch per map, on one eye and on single pass stereo. Reports the dispatches and exp() calls saved */
+	static bool ValidateVFMapCombined(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// view profiles
+
+	/** checks the profile each view resolves to, and that views only share pyramids when their inpainted colour and working layout are the same */
+	static bool ValidateViewProfiles(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// profile batch
+
+	/**
+	 * renders InImage (one eye, the size of the view) through every entry the way the GPU does with r.VARID.VFMap.Combined on a per eye working texture,
+	 * without r.VARID.Contrast.FusedReconstruct: the gaussian and laplacian pyramids are built once, then each entry gets its VF maps, contrast reconstruct and raster composite.
+	 * Point VF maps only. The inpainter and image VF maps have no CPU version, so every entry is rendered as if they were off and all of them share one pyramid.
+	 * OutSharedSeconds and OutEntrySeconds, if given, get the time spent on the pyramids and on the entries
+	 */
+	static void RenderProfileBatch(const FVARIDImage& InImage, const TArray<FVARIDProfileBatchEntry>& InEntries, TArray<FVARIDImage>& OutImages, double* OutSharedSeconds = nullptr, double* OutEntrySeconds = nullptr);
+
+	/** checks every entry of a batch comes out as it does rendered on its own, and the pyramid grouping. Reports how the time scales with the number of profiles */
+	static bool ValidateProfileBatch(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// profile progression
+
+	/**
+	 * checks a progression gives each keyframe at its time and the blend of the two keyframes' fields between them, and that the keyframe tables
+	 * blended as VARIDVFMapCombinedCS.usf does give the same VF maps as a table of the evaluated profile. Reports the bytes uploaded once against a table per step
+	 */
+	static bool ValidateProfileProgression(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// trace
+
+	/**
+	 * checks a trace encoded as the recorder writes it parses back to the same events and profiles, that a trace cut off part way through an event
+	 * gives the events before it, and that the CPU replay steps through every frame. Reports the bytes per gaze sample and the replay's time per frame
+	 */
+	static bool ValidateTrace(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// frame source
+
+	/**
+	 * writes and reads frames through a FVARIDFrameRing in a random order, and checks every frame read is the newest committed, whole and untouched
+	 * while it is held, that only the ring's own slots are ever written, and that the latency counters account for every frame read
+	 */
+	static bool ValidateFrameRing(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// profile hot reload
+
+	/**
+	 * checks an edit to one VF map of a profile's json reparses that map alone and leaves the rest as they were, that formatting and key order changes
+	 * reparse nothing, that a map which fails to parse changes nothing, and that a burst of saves is one reload once the file has settled
+	 */
+	static bool ValidateProfileHotReload(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// VF map points
+
+	/**
+	 * checks VF map points come back from their compact form as they were set, with or without the raw fields, that maps with the same positions share
+	 * them and only them, that a value set on one map leaves its copies alone, that unused positions are released, and that the point table's reuse of
+	 * shared positions gives the entries a lookup of every point would. Reports the bytes of ten contrast levels against FVARIDVFMapPoint arrays
+	 */
+	static bool ValidateVFMapPoints(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// pipeline warm-up
+
+	/**
+	 * steps a FVARIDPipelineWarmup of made up items as the module does, and checks it is only ready once every item has been warmed, each once and in
+	 * order, that failures are named, that only one step is ever queued, and that a step keeps to its time budget. No items, as under NullRHI, is ready at once
+	 */
+	static bool ValidatePipelineWarmup(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// dynamic quality
+
+	/**
+	 * runs FVARIDQualityController over simulated GPU timings, late and noisy as the render thread reads them back, and checks that over budget it
+	 * settles on the best level that fits and holds it, that a level that only just doesn't fit is retried less and less often, that a hitch doesn't step
+	 * it down, that it climbs back once the load drops, and that it keeps to the range the scalability settings give
+	 */
+	static bool ValidateQualityController(FString& OutReport);
+
+	/*****************************************************************************************************************/
+	// output capture
+
+	/**
+	 * passes made up frames through a FVARIDCaptureQueue, on one thread and across two, and through FVARIDCaptureWriter, and checks each frame arrives
+	 * once, whole and in order, that a full queue drops rather than waits, that an encoder slower than the frame rate costs dropped frames and never a
+	 * wait, and that every frame written reads back as it was with its line of frames.csv. Writes to Saved/VARID/ValidateOutputCapture and deletes it
+	 */
+	static bool ValidateOutputCapture(FString& OutReport);
+};
+
+template<typename LoadFunctionType>
+FVector4 FVARIDReference::BilinearFilter(const FIntPoint& InSize, const FVector2D& InUV, LoadFunctionType InLoad)
+{
+	const float X = InUV.X * InSize.X - 0.5f;
+	const float Y = InUV.Y * InSize.Y - 0.5f;
+	const int32 X0 = FMath::FloorToInt(X);
+	const int32 Y0 = FMath::FloorToInt(Y);
+	const float FractionX = X - X0;
+	const float FractionY = Y - Y0;
+
+	const FVector4 Top = FMath::Lerp(InLoad(X0, Y0), InLoad(X0 + 1, Y0), FractionX);
+	const FVector4 Bottom = FMath::Lerp(InLoad(X0, Y0 + 1), InLoad(X0 + 1, Y0 + 1), FractionX);
+	return FMath::Lerp(Top, Bottom, FractionY);
+}
+
+#endif
@@ -7,15 +7,28 @@
 
 #include "VARIDProfile.h"
 #include "VARIDEyeTracking.h"
+#include "VARIDViewProfiles.h"
+#include "VARIDProfileBatch.h"
+#include "VARIDProfileProgression.h"
+#include "VARIDWorkingTexturePlan.h"
+#include "VARIDQualityController.h"
 #include "SceneViewExtension.h"
+#include "RendererInterface.h"
 
 class FTextureResource;
+class FVARIDTraceRecorder;
+class FVARIDFrameRing;
+class FVARIDCaptureSource;
+class FVARIDCaptureWriter;
+class FVARIDPipelineWarmup;
+struct FVARIDPipelineWarmupItem;
 
 class FVARIDSceneViewExtension : public FSceneViewExtensionBase
 {
 public:
 
-	FVARIDSceneViewExtension(const FAutoRegister& AutoRegister);
+	/** inactive until InPipelineWarmup is ready, if it is given */
+	FVARIDSceneViewExtension(const FAutoRegister& AutoRegister, const TSharedPtr<const FVARIDPipelineWarmup, ESPMode::ThreadSafe>& InPipelineWarmup);
 		
 	virtual void SetupView(FSceneViewFamily& InViewFamily, FSceneView& InView) override {}
 	virtual void SetupViewPoint(APlayerController* Player, FMinimalViewInfo& InViewInfo) override {}
@@ -28,25 +41,173 @@ public:
 	virtual void PostRenderViewFamily_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneViewFamily& InViewFamily) override {}
 	virtual void PostRenderView_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneView& InView) override {}
 	virtual int32 GetPriority() const { return 0; }
-	virtual bool IsActiveThisFrame(class FViewport* InViewport) const { return true; }
 	virtual bool IsActiveThisFrameInContext(FSceneViewExtensionContext& Context) const { return IsActiveThisFrame(Context.Viewport); }
 
 	// implemented
 	virtual void SetupViewFamily(FSceneViewFamily& InViewFamily) override;
 	virtual void SubscribeToPostProcessingPass(EPostProcessingPass Pass, FAfterPassCallbackDelegateArray& InOutPassCallbacks, bool bIsPassEnabled) override;
+	virtual bool IsActiveThisFrame(class FViewport* InViewport) const override;
 	
 	// VARID main render method
 	FScreenPassTexture PostProcessPassAfterTonemap_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& View, const FPostProcessMaterialInputs& InOutInputs);
 
+	// renders InSource through every entry of a batch into the output of the same index. See FVARIDModule::RenderProfileBatch()
+	static void RenderProfileBatch_RenderThread(FRHICommandListImmediate& RHICmdList, FRHITexture* InSource, const TArray<FVARIDProfileBatchEntry>& InEntries, const TArray<FRHITexture*>& InOutputs);
+
+	// an item per compute shader permutation and graphics pipeline VARID renders with, for this RHI. None under NullRHI. See FVARIDPipelineWarmup
+	static void GetPipelineWarmupItems(TArray<FVARIDPipelineWarmupItem>& OutItems);
+
 private:
 
+	// the module's. Null when rendering doesn't wait for it
+	TSharedPtr<const FVARIDPipelineWarmup, ESPMode::ThreadSafe> PipelineWarmup;
+
 	struct FCachedRenderResource
 	{		
 		FVARIDProfile Profile;
+		FVARIDViewProfiles ViewProfiles;
 		FVARIDEyeTracking EyeTracking;
+
+		// set when Profile is the progression at ProgressionTime
+		TSharedPtr<const FVARIDProfileProgression, ESPMode::ThreadSafe> Progression;
+		float ProgressionTime = 0.0f;
+
+		// set while a trace is recording, for the stage timings
+		TSharedPtr<FVARIDTraceRecorder, ESPMode::ThreadSafe> TraceRecorder;
+
+		// set while a frame source is, the ring its frames arrive through
+		TSharedPtr<FVARIDFrameRing, ESPMode::ThreadSafe> FrameRing;
+
+		// set while the output is captured, the writer its frames go to
+		TSharedPtr<FVARIDCaptureWriter, ESPMode::ThreadSafe> CaptureWriter;
 	};
 
 	// Local cached copy of the data. Purely used by render threads - hence privately defined within the main renderer class
 	FCachedRenderResource CachedResourcesRenderThread;
+
+	// the profile InView is rendered with: its own, or the active profile
+	const FVARIDProfile& GetViewProfile_RenderThread(const FSceneView& InView) const;
+
+	struct FFrameSourceTexture
+	{
+		// a frame source frame, and the fence written after the last pass that samples it
+		FTexture2DRHIRef Texture;
+		FGPUFenceRHIRef Fence;
+		bool bFenced = false;
+	};
+
+	struct FFrameSourceResource
+	{
+		// enough that the GPU has finished with the oldest before it is uploaded to again. If it hasn't, the upload waits a frame
+		static const int32 NumTextures = 3;
+
+		// the ring the textures are filled from. A different ring starts over
+		TSharedPtr<FVARIDFrameRing, ESPMode::ThreadSafe> Ring;
+		FFrameSourceTexture Textures[NumTextures];
+
+		// the texture holding the newest frame, INDEX_NONE until one has arrived
+		int32 Current = INDEX_NONE;
+		uint32 UploadFrameNumber = 0;
+	};
+
+	// the newest frame source frame, uploaded once per frame into the next of a ring of textures that live as long as the frame ring, so an upload
+	// never overwrites a texture the GPU may still be sampling for an earlier frame
+	FFrameSourceResource FrameSourceRenderThread;
+
+	// the frame source's newest frame resampled into each eye of the plan, in a texture like InSceneColor's. Null until a frame has arrived
+	FRDGTextureRef GetFrameSourceInput_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& InView, const FScreenPassTexture& InSceneColor, const FVARIDWorkingTexturePlan& InPlan);
+
+	struct FSinglePassStereoResource
+	{
+		uint32 FrameNumber = 0;
+		FVARIDWorkingTexturePlan Plan;
+		TRefCountPtr<IPooledRenderTarget> ContrastTexture;
+		TRefCountPtr<IPooledRenderTarget> BlurVFMapTexture;
+		TRefCountPtr<IPooledRenderTarget> WarpVFMapTexture;
+		TRefCountPtr<IPooledRenderTarget> SummedAreaTableTexture;
+
+		// only kept when the compute compositor reconstructs contrast level 0
+		bool bContrastLevel0Deferred = false;
+		TRefCountPtr<IPooledRenderTarget> GaussianTexture;
+		TRefCountPtr<IPooledRenderTarget> ContrastVFMapTexture;
+	};
+
+	// working textures built by the first view of a single pass stereo frame, kept for the second view to composite from
+	FSinglePassStereoResource SinglePassStereoRenderThread;
+
+	struct FSharedPyramidResource
+	{
+		uint32 FrameNumber = 0;
+		const FSceneViewFamily* Family = nullptr;
+		FMatrix ViewProjectionMatrix;
+		FVARIDWorkingTexturePlan Plan;
+		uint32 InpaintHash = 0;
+		TRefCountPtr<IPooledRenderTarget> InpaintColourTexture;
+		TRefCountPtr<IPooledRenderTarget> GaussianTexture;
+		TRefCountPtr<IPooledRenderTarget> LaplacianTexture;	// not kept when reconstructing fused
+	};
+
+	// the gaze independent textures of each view of this frame, for later views that see the same scene colour (r.VARID.SharePyramids)
+	TArray<FSharedPyramidResource> SharedPyramidsRenderThread;
+
+	struct FGPUTimingFrame
+	{
+		uint32 FrameNumber = 0;
+
+		// a begin and an end timestamp around the passes of each view
+		TArray<FRHIPooledRenderQuery> Queries;
+	};
+
+	// r.VARID.DynamicQuality: the timestamps of the frames the GPU may not have finished yet, oldest first, and the level they choose
+	TArray<FGPUTimingFrame> GPUTimingFramesRenderThread;
+	FRenderQueryPoolRHIRef GPUTimingQueryPoolRenderThread;
+	FVARIDQualityController QualityControllerRenderThread;
+	uint32 QualityFrameNumberRenderThread = 0;
+
+	// once a frame, before its first view: feeds the GPU timings that have come back to the controller and sets the quality the frame renders at
+	void UpdateQuality_RenderThread(uint32 InFrameNumber);
+
+	// adds a pass writing a GPU timestamp for frame InFrameNumber, the begin or the end of a view's passes. Nothing unless r.VARID.DynamicQuality is on
+	void AddGPUTimestamp_RenderThread(FRDGBuilder& GraphBuilder, uint32 InFrameNumber);
+
+	struct FCaptureReadback
+	{
+		// a CPU readable copy of one eye's output, and the fence written after the copy
+		FTexture2DRHIRef Texture;
+		FGPUFenceRHIRef Fence;
+
+		uint32 FrameNumber = 0;
+		double Seconds = 0.0;
+		int32 EyeIndex = 0;
+		FVector2D GazePoint = FVector2D::ZeroVector;
+
+		// mapped until the writer thread has copied it out of Source, or at once if it wasn't queued
+		bool bMapped = false;
+		TSharedPtr<FVARIDCaptureSource, ESPMode::ThreadSafe> Source;
+	};
+
+	struct FOutputCaptureResource
+	{
+		// the writer the readbacks are for. A different writer starts over
+		TSharedPtr<FVARIDCaptureWriter, ESPMode::ThreadSafe> Writer;
+
+		// a ring: copies are issued into the readback after the newest, mapped from the oldest, so frames reach the writer in order, and released, i.e.
+		// unmapped and free to issue again, in the same order once the writer has copied them
+		TArray<FCaptureReadback> Readbacks;
+		uint64 NumIssued = 0;
+		uint64 NumMapped = 0;
+		uint64 NumReleased = 0;
+
+		// the eyes captured this frame, a bit each. A second view of an eye in a frame isn't captured
+		uint32 FrameNumber = 0;
+		uint32 CapturedEyes = 0;
+	};
+
+	// the output capture's copies the GPU may not have made yet
+	FOutputCaptureResource OutputCaptureRenderThread;
+
+	// unmaps the readbacks the writer has copied, maps those whose copies the GPU has made, oldest first, and queues them for the writer to copy,
+	// then adds a copy of InOutput's view rect to the next readback. Never waits: a frame with no readback free, or no room in the queue, is dropped. Nothing unless the output is being captured
+	void AddOutputCapture_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& InView, int32 InEyeIndex, const FScreenPassTexture& InOutput);
 };
 
@@ -0,0 +1,39 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Checks of the plugin's behaviour rather than its rendering: which shipped profiles load, the FX IDs, the module's rendering state,
+// and time budgets on the CPU paths of FVARIDBenchmark. A budget overrun fails the check like a wrong result does.
+// Each is an automation test under VARID.SelfCheck - see VARIDTests.cpp. None of it needs a GPU:
+// UE4Editor-Cmd <project> -nullrhi -unattended -ExecCmds="Automation RunTests VARID.SelfCheck; Quit" [-VARIDBudgetScale=<n>]
+
+struct FVARIDSelfCheck
+{
+public:
+	/** every VARID_PROFILE_TEST_* and template profile of Content/Profiles loads or is turned down as expected, with its FX on the eye its name gives */
+	static bool CheckProfileFiles(FString& OutReport);
+
+	/** GetFX() and ToggleFX() map IDs 0-7 to blur, contrast, inpaint and warp of the left eye then the right, and ignore any other ID */
+	static bool CheckFXIDs(FString& OutReport);
+
+	/** BeginRendering() and EndRendering() in every order, including twice in a row. Leaves the module rendering as it found it */
+	static bool CheckModuleState(FString& OutReport);
+
+	/**
+	 * starts rendering, a profile hot reload and a trace recording, and checks EndAll(), the part of ShutdownModule() that doesn't reset the running
+	 * engine's shader directory mappings, ends them all. Leaves the module rendering as it found it and its active profile as it was, anything else ended
+	 */
+	static bool CheckShutdown(FString& OutReport);
+
+	/** the median of each budgeted FVARIDBenchmark case, run quick, against its budget times InBudgetScale, e.g. 4 for a debug build */
+	static bool CheckBudgets(float InBudgetScale, FString& OutReport);
+};
+
+#endif
@@ -0,0 +1,139 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VARIDProfile.h"
+#include "VARIDEyeTracking.h"
+
+struct FVARIDBenchmarkResult;
+
+// A trace is what a session fed VARID - gaze samples, profile activations, FX toggles and display FOV changes - and the CPU time of each frame's
+// VARID work, stamped with the frame it happened in. FVARIDTraceRecorder writes them as the session runs. FVARIDModule::BeginTraceReplay() feeds
+// the inputs back a recorded frame per engine frame, so two builds can be compared on the same session, and ReplayCPU() does the same without a GPU.
+//
+// The file is a header, then events one after another until the end of the file:
+//   uint32 magic 'VRTR', uint32 version
+//   event: uint8 type, packed uint32 frame, float time, then the payload of its type
+// A profile is written in full the first time it is activated. Later activations of the same profile are only its index.
+// Progressions, view profiles and profile batches aren't recorded.
+
+enum class EVARIDTraceEvent : uint8
+{
+	/** payload: the left then right gaze point */
+	EyeTracking,
+
+	/** payload: a profile, which becomes FVARIDTrace::Profiles[n]. Always followed by the ActiveProfile event that activates it */
+	ProfileDefinition,
+
+	/** payload: packed uint32 index into FVARIDTrace::Profiles */
+	ActiveProfile,
+
+	/** payload: uint8 with bit i set when the FX of ID i is enabled. Written when FVARIDModule toggles, enables or disables FX */
+	FXEnabled,
+
+	/** payload: FVector2D */
+	DisplayFOV,
+
+	/** payload: uint8 EVARIDTraceStage, float microseconds. Not replayed */
+	StageTiming,
+
+	Num
+};
+
+/** the VARID work of a frame that is timed while recording */
+enum class EVARIDTraceStage : uint8
+{
+	/** game thread: copying the profiles and eye tracking for the render thread, in SetupViewFamily() */
+	Marshal,
+
+	/** render thread: adding the passes of a view to the render graph. Once per view, so twice a frame in stereo */
+	BuildPasses,
+
+	/** GPU: the passes of every view of a frame, read back a few frames later. Only timed under r.VARID.DynamicQuality */
+	GPUPasses,
+
+	Num
+};
+
+struct FVARIDTraceEvent
+{
+public:
+	EVARIDTraceEvent Type;
+
+	/** frames since the recording began */
+	uint32 Frame;
+
+	/** seconds since the recording began */
+	float Time;
+
+	/** EyeTracking */
+	FVARIDEyeTracking EyeTracking;
+
+	/** DisplayFOV */
+	FVector2D DisplayFOV;
+
+	/** ActiveProfile: the index of the profile. FXEnabled: the FX bits. StageTiming: the EVARIDTraceStage */
+	int32 Value;
+
+	/** StageTiming */
+	float Microseconds;
+
+public:
+	FVARIDTraceEvent();
+	FVARIDTraceEvent(EVARIDTraceEvent InType, uint32 InFrame, float InTime);
+
+	bool operator==(const FVARIDTraceEvent& Other) const;
+};
+
+struct FVARIDTrace
+{
+public:
+	static const uint32 Magic;
+	static const uint32 Version;
+
+	/** in the order they were recorded. ProfileDefinition events are kept in Profiles instead */
+	TArray<FVARIDTraceEvent> Events;
+
+	/** every profile the trace activates, in the order they were first activated. Meshes and curvature bounds are rebuilt when parsed */
+	TArray<FVARIDProfile> Profiles;
+
+public:
+	static void WriteHeader(FArchive& Ar);
+	static void WriteEvent(FArchive& Ar, const FVARIDTraceEvent& InEvent);
+
+	/** InProfileBytes is the profile from SerialiseProfile(), so that the recorder can tell profiles it has written before by their bytes */
+	static void WriteProfileDefinition(FArchive& Ar, uint32 InFrame, float InTime, const TArray<uint8>& InProfileBytes);
+
+	/** writes or reads everything LoadProfile() parses, including which FX are enabled. An image VF map is its file, which is loaded when the profile is activated */
+	static void SerialiseProfile(FArchive& Ar, FVARIDProfile& InOutProfile);
+
+	/** fails on a bad header or an unknown event. A trace cut off part way through an event, e.g. by a crash, gives the events before it */
+	static bool Parse(const TArray<uint8>& InBytes, FVARIDTrace& OutTrace);
+	static bool Load(const FString& InFilePath, FVARIDTrace& OutTrace);
+
+	/** bit i is set when the FX of ID i is enabled */
+	static uint8 GetFXEnabled(FVARIDProfile& InProfile);
+	static void SetFXEnabled(FVARIDProfile& InOutProfile, uint8 InFXEnabled);
+
+	static const TCHAR* GetStageName(EVARIDTraceStage InStage);
+
+	/** the frames up to and including the last event's, 0 if there are none */
+	uint32 GetNumFrames() const;
+
+	/** the recorded timings of each stage, as benchmark results named "Trace" with the stage as the case. Each sample is one StageTiming event */
+	void GetStageTimings(TArray<FVARIDBenchmarkResult>& OutResults) const;
+
+	/**
+	 * replays the trace on the CPU, a frame at a time with the inputs of that frame, and times the CPU work of each frame that has a valid profile:
+	 * "Marshal", the copy of the profile and eye tracking for the render thread, and "PackShaderPoints", the points of every enabled point VF map
+	 * of both eyes, side by side and moved by their gaze. Results are named "TraceReplay"
+	 */
+	void ReplayCPU(TArray<FVARIDBenchmarkResult>& OutResults) const;
+
+	/** loads InTracePath and saves its stage timings and those of ReplayCPU() as benchmark JSON, to InOutputPath or next to the trace if it is empty */
+	static bool ReplayCPUAndSave(const FString& InTracePath, const FString& InOutputPath, FString& OutOutputPath);
+};
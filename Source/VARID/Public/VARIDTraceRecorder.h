@@ -0,0 +1,77 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VARIDTrace.h"
+#include "Async/Future.h"
+#include "HAL/CriticalSection.h"
+
+// Writes a trace as a session runs - see VARIDTrace.h. Events are encoded into a buffer, which goes to the thread pool to be written once it
+// holds 64KB or a second has passed, so the game and render threads never wait on the file. Owned by FVARIDModule, which records its inputs,
+// and shared with the render thread for the stage timings.
+
+class FVARIDTraceRecorder
+{
+public:
+	/** opens InFilePath, creating its directory, and writes the trace header. Null if the file can't be written */
+	static TSharedPtr<FVARIDTraceRecorder, ESPMode::ThreadSafe> Begin(const FString& InFilePath);
+
+	/** ends the recording if End() hasn't */
+	~FVARIDTraceRecorder();
+
+	/** game thread. Stamped with GFrameNumber */
+	void RecordEyeTracking(const FVARIDEyeTracking& InEyeTracking);
+	void RecordActiveProfile(const FVARIDProfile& InProfile);
+	void RecordFXEnabled(uint8 InFXEnabled);
+	void RecordDisplayFOV(const FVector2D& InDisplayFOV);
+
+	/** any thread. InFrameNumber is the GFrameNumber the work is for, e.g. FSceneViewFamily::FrameNumber on the render thread. Work from before the recording began is dropped */
+	void RecordStageTiming(uint32 InFrameNumber, EVARIDTraceStage InStage, float InMicroseconds);
+
+	/** writes what is buffered, waits for the writes and closes the file. Anything recorded after is dropped */
+	void End();
+
+	const FString& GetFilePath() const;
+
+	/** bytes recorded so far, written or not */
+	int64 GetNumBytes() const;
+
+private:
+	FVARIDTraceRecorder(const FString& InFilePath, FArchive* InFile);
+
+	/** the frame and time of an event now. InFrameNumber is a GFrameNumber. False if it is from before the recording began */
+	bool Stamp(uint32 InFrameNumber, uint32& OutFrame, float& OutTime) const;
+
+	void AddEvent(const FVARIDTraceEvent& InEvent);
+
+	/** with BufferLock held. Moves the buffer to the write queue if it is due, or if bInForce, and starts a write on the thread pool */
+	void FlushBuffer(bool bInForce);
+
+	/** on the thread pool. Writes every queued chunk, oldest first */
+	void WriteChunks();
+
+private:
+	const FString FilePath;
+	const uint32 StartFrameNumber;
+	const double StartSeconds;
+
+	/** guards everything below but the file */
+	mutable FCriticalSection BufferLock;
+	TArray<uint8> Buffer;
+	TArray<TArray<uint8>> Chunks;
+	TArray<TFuture<void>> Writes;
+	double LastFlushSeconds;
+	int64 NumBytes;
+	bool bEnded;
+
+	/** each profile defined so far, as SerialiseProfile() bytes, and the CRC of those bytes to its index */
+	TArray<TArray<uint8>> ProfileBytes;
+	TMap<uint32, int32> ProfileIndices;
+
+	FCriticalSection FileLock;
+	TUniquePtr<FArchive> File;
+};
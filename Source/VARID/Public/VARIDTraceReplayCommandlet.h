@@ -0,0 +1,21 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "VARIDTraceReplayCommandlet.generated.h"
+
+/** runs FVARIDTrace::ReplayCPUAndSave headless: UE4Editor-Cmd <project> -run=VARIDTraceReplay -nullrhi -trace=<file> [-output=<file>]. Returns 1 if the trace could not be replayed */
+UCLASS()
+class UVARIDTraceReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UVARIDTraceReplayCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
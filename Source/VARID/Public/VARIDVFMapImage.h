@@ -0,0 +1,103 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Templates/Atomic.h"
+#include "Templates/Function.h"
+
+// A dense VF map read from an image file (16 bit PNG or EXR) rather than a list of points. It has no limit on its number of samples
+// and costs one texture fetch per texel. The file is decoded, normalised and mip chained on the thread pool when the profile is
+// activated; the render thread uploads it the first time it is used. Until then the eye only gets the origin offset, as if the FX had no points.
+// Decoding is passed in, so everything else can be checked on the CPU with generated images - see FVARIDReference::ValidateVFMapImage().
+
+enum class EVARIDVFMapImageState : uint8
+{
+	NotLoaded,
+	Loading,
+	Loaded,
+	Failed
+};
+
+/** the first channel of a decoded image file */
+struct FVARIDVFMapImagePixels
+{
+public:
+	FIntPoint Size;
+
+	/** row major */
+	TArray<float> Values;
+
+	/** integer formats: 0..1 spans the Min..Max of the map. float formats (EXR) hold raw values, in the same units as Min and Max */
+	bool bUnitRange;
+
+public:
+	FVARIDVFMapImagePixels();
+};
+
+/** reads an image file into OutPixels. Runs on the thread pool. Returns false if the file can't be read or decoded */
+typedef TFunction<bool(const FString& InFilePath, FVARIDVFMapImagePixels& OutPixels)> FVARIDDecodeVFMapImage;
+
+struct FVARIDVFMapImageMip
+{
+public:
+	FIntPoint Size;
+	TArray<float> Values;
+};
+
+class FVARIDVFMapImage
+{
+public:
+	/** InNormMin..InNormMax is the rect of normalised eye space the image covers. Outside it the map is zero, i.e. unaffected */
+	FVARIDVFMapImage(const FString& InFilePath, float InMin, float InMax, const FVector2D& InNormMin, const FVector2D& InNormMax);
+
+	/** waits for a load in flight, which writes to this */
+	~FVARIDVFMapImage();
+
+	/** decodes the file and builds the mips on the thread pool. Does nothing if a load has already started */
+	void BeginLoad(FVARIDDecodeVFMapImage InDecode);
+
+	/** blocks until a load that has been started finishes */
+	void WaitForLoad();
+
+	EVARIDVFMapImageState GetState() const;
+
+	/** the mips are only safe to read once this is true. They don't change after that */
+	bool IsLoaded() const;
+
+	const TArray<FVARIDVFMapImageMip>& GetMips() const;
+
+	/** trilinear sample at a normalised eye position, the same as VARIDVFMapImageCS.usf. Zero outside the image or before it is loaded */
+	float Sample(const FVector2D& InNormPosition, float InLevel) const;
+
+	/** trilinear sample at an image UV with AM_Clamp, the same as ImageSampler. Zero before the image is loaded */
+	float SampleImageUV(const FVector2D& InUV, float InLevel) const;
+
+	/** mip level whose texels are closest in size to InNormTexelSize, a working texel measured in normalised eye space. Never past the last mip */
+	float GetSampleLevel(const FVector2D& InNormTexelSize) const;
+
+	/**
+	 * converts raw pixels into VF map values the same way ParseVFMap() converts the values of points: inverted so that high is bad vision,
+	 * and offset by -0.5 if Min..Max straddles zero. Then box filters them down to 1x1
+	 */
+	static bool BuildMips(const FVARIDVFMapImagePixels& InPixels, float InMin, float InMax, TArray<FVARIDVFMapImageMip>& OutMips);
+
+public:
+	const FString FilePath;
+	const float Min;
+	const float Max;
+	const FVector2D NormMin;
+	const FVector2D NormMax;
+
+private:
+	float SampleBilinear(const FVARIDVFMapImageMip& InMip, const FVector2D& InUV) const;
+
+private:
+	TAtomic<EVARIDVFMapImageState> State;
+	TFuture<void> LoadTask;
+	TArray<FVARIDVFMapImageMip> Mips;
+};
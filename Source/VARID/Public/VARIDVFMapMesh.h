@@ -0,0 +1,48 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Delaunay triangulation of the points of a VF map, built the first time a map is drawn with it. With r.VARID.VFMap.Interpolation=1 the
+// render thread draws it as a small triangle mesh and the rasteriser interpolates the values, so a texel costs one triangle rather
+// than a sum over every point. Kept free of render code so it can be checked on the CPU - see FVARIDReference::ValidateVFMapMesh().
+
+struct FVARIDVFMapMesh
+{
+public:
+	/**
+	 * the mesh always includes a square frame with corners at FrameMin and FrameMax, in normalised eye space. It is wide enough to cover
+	 * the view for any gaze offset. Frame vertices have a value of zero, so away from the data the field falls back to the origin offset, like the RBF
+	 */
+	static const float FrameMin;
+	static const float FrameMax;
+
+	/** x, y = normalised eye position, z = value. The first four are the frame */
+	TArray<FVector> Vertices;
+
+	/** three per triangle, wound so that (B - A) x (C - A) > 0 in normalised eye space */
+	TArray<int32> Indices;
+
+	/** the index in the points given to Build() of each vertex, INDEX_NONE for the frame. Lets a map with the same positions reuse the triangles with its own values */
+	TArray<int32> PointIndices;
+
+public:
+	FVARIDVFMapMesh();
+
+	/** Bowyer-Watson triangulation of the frame and InPoints. Points outside the frame, or at the position of an earlier point, are skipped */
+	void Build(const TArray<FVector>& InPoints);
+
+	bool IsEmpty() const;
+
+	int32 GetNumTriangles() const;
+
+	/** barycentric interpolation in the triangle containing InPosition. OutGradient gets the gradient of that triangle's plane. Returns false outside the frame */
+	bool Evaluate(const FVector2D& InPosition, float& OutValue, FVector2D* OutGradient = nullptr) const;
+
+	/** the triangles are wound consistently, tile the frame exactly and no vertex is inside the circumcircle of a triangle */
+	bool IsValidDelaunay(FString& OutReason) const;
+};
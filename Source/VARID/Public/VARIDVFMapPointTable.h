@@ -0,0 +1,112 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VARIDProfile.h"
+
+// With r.VARID.VFMap.Combined=1 every VF map of a frame is built by one dispatch of VARIDVFMapCombinedCS.usf, from a single table of
+// points. Points of different maps at the same position share an entry, so the gaussian weight is worked out once for all of them.
+// Kept free of render code so it can be checked on the CPU - see FVARIDReference::ValidateVFMapCombined().
+
+/** the VF maps of an eye, in the order of the values of a table entry. Must match VARIDVFMapCombinedCS.usf */
+namespace EVARIDVFMapChannel
+{
+	enum Type
+	{
+		Blur = 0,
+		Inpaint,
+		Warp,
+		Contrast0,
+		Num = Contrast0 + 10	// one per contrast level, up to MAX_NUM_MIP_LEVELS
+	};
+}
+
+/** one position of the table. 64 bytes, the stride of the structured buffer */
+struct FVARIDVFMapTableEntry
+{
+public:
+	/** scene colour UV, including the gaze offset */
+	float X;
+	float Y;
+
+	/** bit n is set when channel n has a point here. Channels without one hold zero */
+	uint32 ChannelMask;
+
+	float Values[EVARIDVFMapChannel::Num];
+
+public:
+	FVARIDVFMapTableEntry();
+};
+
+static_assert(sizeof(FVARIDVFMapTableEntry) == 64, "FVARIDVFMapTableEntry is wrong size. VARIDVFMapCombinedCS.usf expects 64 bytes. Has it been changed?!");
+
+/** a point of one VF map, as VARIDHeightMapCS.usf and VARIDPositionMapCS.usf read it */
+struct FShaderParameterMapPoint
+{
+public:
+	float X;
+	float Y;
+	float Value;
+	float Padding;
+};
+
+static_assert(sizeof(FShaderParameterMapPoint) == 16, "FShaderParameterMapPoint is wrong size. Expected 16 byte alignment. Has it been changed?!");
+
+struct FVARIDVFMapPointTable
+{
+public:
+	/** eye 0 first, then eye 1 */
+	TArray<FVARIDVFMapTableEntry> Entries;
+
+	/** first entry and number of entries of eye 0, then eye 1 */
+	int32 EyeEntryRange[4];
+
+	/** per channel, x = eye 0 and y = eye 1: the value where the map has no points */
+	FVector2D OriginOffsets[EVARIDVFMapChannel::Num];
+
+	/** points added to each channel of each eye, before those at the same position were merged. What a dispatch per map sums at every texel */
+	int32 NumPoints[EVARIDVFMapChannel::Num][2];
+
+public:
+	FVARIDVFMapPointTable();
+
+	/** starts the entries of the next eye. At most two, in order */
+	void BeginEye();
+
+	/**
+	 * adds InVFMap to InChannel of the current eye, filtered the same way as BuildHeightMapTexture_RenderThread: nullptr leaves InOriginOffset,
+	 * a full field map replaces it, and the points go to scene colour UV with the stereo transform and the gaze offset
+	 */
+	void AddVFMap(EVARIDVFMapChannel::Type InChannel, const FVARIDVFMap* InVFMap, float InOriginOffset, float InXScale, float InXOffset, const FVector2D& InGazePoint);
+
+	/**
+	 * starts the next eye and adds every VF map of InEye the way BuildVFMapTexturesCombined_RenderThread picks them: disabled FX and image maps add no points,
+	 * contrast levels up to InNumMips, and warp only with bInWarp. nullptr gives an eye of origin offsets
+	 */
+	void AddEye(const FVARIDEye* InEye, int32 InNumMips, bool bInWarp, float InXScale, float InXOffset, const FVector2D& InGazePoint);
+
+	/** entries of InEyeIndex that hold any channel of InChannelMask - the exp() calls a texel of those channels costs */
+	int32 GetNumWeights(int32 InEyeIndex, uint32 InChannelMask) const;
+
+	static uint32 GetChannelBit(int32 InChannel);
+
+	/**
+	 * the per frame packing of the dispatch per map paths (BuildHeightMapTexture_RenderThread): appends InPoints to InOutPoints in scene colour UV,
+	 * with the stereo transform and the gaze offset. Kept here so it can be timed without a GPU - see FVARIDBenchmark
+	 */
+	static void AddShaderPoints(const FVARIDVFMapPoints& InPoints, float InXScale, float InXOffset, const FVector2D& InGazePoint, TArray<FShaderParameterMapPoint>& InOutPoints);
+
+private:
+	int32 CurrentEye;
+
+	/** normalised eye position -> entry, for the current eye */
+	TMap<FVector2D, int32> EntryIndices;
+
+	/** the entry of each point of the last map added to the current eye. The next map with the same positions, e.g. the next contrast level, reuses them */
+	TSharedPtr<const FVARIDVFMapPositions, ESPMode::ThreadSafe> LastPositions;
+	TArray<int32> LastEntryIndices;
+};
@@ -0,0 +1,85 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// The points of a VF map as the renderer keeps them. The renderer only reads each point's normalised position and value, and the maps of a profile,
+// above all its ten contrast levels, usually measure the same positions. So positions are kept apart from values: one immutable set of positions is
+// shared by every map, and every copy of a map, that has them, and each map only holds its values. The raw values of the profile - position in degrees,
+// value, min and max - are only needed to edit or export it, and are kept to one side, shared by copies, or not at all. FVARIDVFMapPoint, the form
+// Blueprints see, is converted to and from this by GetPoint(), GetPoints() and SetPoints().
+
+struct FVARIDVFMapPoint;
+
+/** normalised point positions, shared. Never changed once made */
+struct FVARIDVFMapPositions
+{
+public:
+	TArray<float> X;
+	TArray<float> Y;
+
+	/** of X and Y, to find an equal set quickly */
+	uint32 Hash;
+
+public:
+	FVARIDVFMapPositions();
+};
+
+/** the points as the profile gives them, shared. Never changed once made */
+struct FVARIDVFMapRawPoints
+{
+public:
+	TArray<float> X;
+	TArray<float> Y;
+	TArray<float> Value;
+	TArray<float> Min;
+	TArray<float> Max;
+};
+
+class FVARIDVFMapPoints
+{
+public:
+	FVARIDVFMapPoints();
+
+	int32 Num() const;
+
+	/** normalised, as the renderer reads them */
+	float GetX(int32 InIndex) const;
+	float GetY(int32 InIndex) const;
+	float GetValue(int32 InIndex) const;
+
+	/** values belong to this map alone, so can be changed without touching the positions. The raw value, if kept, is left as it was */
+	void SetValue(int32 InIndex, float InNormValue);
+
+	/** the Blueprint form of a point. Its raw fields are 0, and Min..Max 0..1, if the raw points weren't kept */
+	FVARIDVFMapPoint GetPoint(int32 InIndex) const;
+	void GetPoints(TArray<FVARIDVFMapPoint>& OutPoints) const;
+
+	/** replaces every point. The positions are shared with any other map that has the same. bInKeepRaw false drops the raw fields of InPoints */
+	void SetPoints(const TArray<FVARIDVFMapPoint>& InPoints, bool bInKeepRaw = true);
+
+	void Empty();
+
+	bool HasRawPoints() const;
+
+	/** the same pointer for every map with these positions, e.g. the contrast levels of a profile. Invalid if there are no points */
+	const TSharedPtr<const FVARIDVFMapPositions, ESPMode::ThreadSafe>& GetPositions() const;
+
+	/** bytes of the values, which this map holds alone */
+	SIZE_T GetAllocatedSize() const;
+
+	/** bytes of InPoints together, counting positions and raw points they share once */
+	static SIZE_T GetAllocatedSize(const TArray<const FVARIDVFMapPoints*>& InPoints);
+
+	/** the number of distinct sets of positions in use, for checks and reports */
+	static int32 GetNumSharedPositions();
+
+private:
+	TSharedPtr<const FVARIDVFMapPositions, ESPMode::ThreadSafe> Positions;
+	TArray<float> Values;
+	TSharedPtr<const FVARIDVFMapRawPoints, ESPMode::ThreadSafe> RawPoints;
+};
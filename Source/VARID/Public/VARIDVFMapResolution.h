@@ -0,0 +1,74 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VARIDProfile.h"
+
+// With r.VARID.VFMap.LowRes=1 the RBF of a VF map is summed on a coarse grid of nodes and bilinearly upsampled, rather than summed at every texel.
+// How coarse comes from a bound on the curvature of the RBF sum, so that the upsampling error stays under r.VARID.VFMap.LowResMaxError.
+// Kept free of render code so the bound can be checked on the CPU - see FVARIDReference::ValidateVFMapResolution().
+
+/** where the r.VARID.VFMap.LowRes nodes go: eye 0 from the left of the node texture, then eye 1. Each eye's nodes start on its first texel centre */
+struct FVARIDVFMapNodeGrid
+{
+public:
+	int32 Factor;
+
+	/** of the node texture */
+	FIntPoint Size;
+
+	/** nodes at or right of it belong to eye 1. MAX_int32 with one eye */
+	int32 RightEyeNodeMinX;
+
+	/** working texel position of a node = node * X + (Z or W for eye 0 or 1, Y) */
+	FVector4 NodeTransform;
+
+	/** the last node of each eye, the furthest the upsample reads */
+	FIntPoint LastNode[2];
+
+public:
+	FVARIDVFMapNodeGrid();
+
+	/** InRightEyeMinX is where eye 1 starts in working texels, or MAX_int32 with one eye. Only Factor is set when InFactor is 1 - the normal path needs no grid */
+	static FVARIDVFMapNodeGrid Create(const FIntRect& InViewportRect, int32 InRightEyeMinX, int32 InFactor);
+
+	/** the working texel position of InNode */
+	FVector2D GetTexelPosition(const FIntPoint& InNode) const;
+
+	/** the inverse, with the eye picked from the texel */
+	FVector2D GetNodePosition(const FVector2D& InTexelPosition, int32 InRightEyeMinX) const;
+};
+
+struct FVARIDVFMapResolution
+{
+public:
+	/** the width of each RBF term, in UV. Must match StdDev in VARIDHeightMapCS.usf */
+	static const float RBFStdDev;
+
+	/** the coarsest grid tried: one node every MaxReductionFactor texels */
+	static const int32 MaxReductionFactor;
+
+public:
+	/**
+	 * an upper bound on |d2f/dx2| and |d2f/dy2| of the unclamped RBF sum of InPoints, anywhere in the plane. In scene UV, with the x of the points
+	 * squeezed by InXScale (0.5 for side by side stereo). Each term is bounded over a whole cell of a fine grid, so it holds between the cells too.
+	 * A term only visits the cells near it - the rest share one constant for it - so the cost grows with the points rather than cells times points
+	 */
+	static float GetCurvatureBound(const FVARIDVFMapPoints& InPoints, float InXScale);
+
+	/** the worst bilinear interpolation error of a field with InCurvatureBound, from nodes InNodeSpacing apart: (x^2 + y^2) * InCurvatureBound / 8 */
+	static float GetErrorBound(float InCurvatureBound, const FVector2D& InNodeSpacing);
+
+	/**
+	 * the largest power of two, up to InMaxFactor, for which nodes that many texels apart keep GetErrorBound() within InMaxError.
+	 * InTexelSize is a texel in scene UV. Returns 1 if no factor does
+	 */
+	static int32 GetReductionFactor(float InCurvatureBound, const FVector2D& InTexelSize, float InMaxError, int32 InMaxFactor);
+
+	/** nodes covering InNumTexels texels along one axis. The first node is on the first texel centre and the last is on or past the last one, so upsampling never extrapolates */
+	static int32 GetNumNodes(int32 InNumTexels, int32 InFactor);
+};
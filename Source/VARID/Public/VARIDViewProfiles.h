@@ -0,0 +1,34 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VARIDProfile.h"
+
+// Profiles for particular views, picked over the active profile: two conditions side by side in split screen, or an unprocessed spectator view next to the HMD.
+// Kept free of render code so the choice can be checked on the CPU - see FVARIDReference::ValidateViewProfiles().
+
+struct FVARIDViewProfiles
+{
+public:
+	/** by the index of the view in its family. In stereo 0 and 1 are the eyes */
+	TMap<int32, FVARIDProfile> ByViewIndex;
+
+	/** by FSceneView::PlayerIndex, the local player of a split screen view */
+	TMap<int32, FVARIDProfile> ByPlayerIndex;
+
+public:
+	bool IsEmpty() const;
+
+	/** by view index, then by player, then InActiveProfile. A profile that isn't valid, e.g. FVARIDProfile(), leaves the view unprocessed */
+	const FVARIDProfile& Find(int32 InViewIndex, int32 InPlayerIndex, const FVARIDProfile& InActiveProfile) const;
+
+	/**
+	 * a hash of everything the inpainted colour of an eye depends on: its inpaint VF map and gaze point, or nothing at all when inpaint is off.
+	 * Views that see the same scene colour and get the same hash for every eye build the same inpainted colour, so can share it and its pyramids
+	 */
+	static uint32 GetInpaintHash(const FVARIDEye* InEye, const FVector2D& InGazePoint);
+};
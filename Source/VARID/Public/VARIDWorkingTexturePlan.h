@@ -0,0 +1,94 @@
+// This source code is provided "as is" without warranty of any kind, either express or implied. Use at your own risk.
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Decides how big the VARID working textures (VF maps, inpaint, pyramids, contrast) are and where each eye lives in them.
+// Kept free of render code so the layouts can be checked on the CPU - see FVARIDReference::ValidateWorkingTexturePlan().
+
+enum class EVARIDWorkingTextureMode : uint8
+{
+	/** original behaviour: every view allocates textures the size of the whole scene colour texture */
+	SceneSized,
+
+	/** every view allocates textures the size of its own view rect */
+	PerEye,
+
+	/** one set of textures covers both eyes and is built once per frame, by the first stereo view. Needs side by side eyes */
+	SinglePassStereo
+};
+
+struct FVARIDWorkingEye
+{
+public:
+	/** 0 = left (or mono), 1 = right */
+	int32 EyeIndex;
+
+	/** where the eye is in the scene colour texture */
+	FIntRect SceneRect;
+
+	/** where the eye is in the working textures. Always the same size as SceneRect */
+	FIntRect WorkingRect;
+
+public:
+	FVARIDWorkingEye();
+	FVARIDWorkingEye(int32 InEyeIndex, const FIntRect& InSceneRect, const FIntRect& InWorkingRect);
+};
+
+struct FVARIDWorkingTexturePlan
+{
+public:
+	EVARIDWorkingTextureMode Mode;
+
+	/** size of the scene colour texture */
+	FIntPoint SceneExtent;
+
+	/** size of mip 0 of the working textures */
+	FIntPoint Extent;
+
+	/** scene colour texel that working texel 0,0 maps to. Working and scene texels are only ever offset, never scaled */
+	FIntPoint SceneOrigin;
+
+	/** number of mips the working textures get */
+	uint8 NumMips;
+
+	/** the eyes this plan builds FX for. One entry unless single pass stereo */
+	TArray<FVARIDWorkingEye> Eyes;
+
+public:
+	FVARIDWorkingTexturePlan();
+
+	/**
+	 * InEyeSceneRects holds the view rects of the family in eye order: one for mono, left and right for stereo. InEyeIndex is the eye of the view being rendered.
+	 * Single pass stereo falls back to per eye when there aren't two eyes side by side.
+	 */
+	static FVARIDWorkingTexturePlan Create(EVARIDWorkingTextureMode InMode, const FIntPoint& InSceneExtent, const TArray<FIntRect>& InEyeSceneRects, int32 InEyeIndex, uint8 InMaxNumMips);
+
+	static uint8 CalculateNumMips1D(int32 InValue);
+	static uint8 CalculateNumMips2D(FIntPoint InSize);
+
+	/** nullptr if the plan doesn't cover the eye */
+	const FVARIDWorkingEye* FindEye(int32 InEyeIndex) const;
+
+	/** bounding rect of every eye in the working textures */
+	FIntRect GetActiveRect() const;
+
+	/** xy scale and zw bias taking a working texture UV to the scene colour UV of the same point */
+	FVector4 GetSceneUVScaleBias() const;
+
+	/** memory taken by one working texture with a full mip chain */
+	uint64 GetTextureBytes(int32 InBytesPerTexel) const;
+
+	/** number of times the FX pipeline runs per frame for the given number of views */
+	int32 GetPipelineBuildsPerFrame(int32 InNumViews) const;
+
+	/** true if both plans put the same eyes in the same place - i.e. working textures built for one can be used by the other */
+	bool HasSameLayout(const FVARIDWorkingTexturePlan& Other) const;
+
+	/** true if both plans have the same working textures with the eyes in the same place, wherever the eyes are in scene colour - i.e. two views showing the same image can share what they build from it */
+	bool HasSameWorkingLayout(const FVARIDWorkingTexturePlan& Other) const;
+};
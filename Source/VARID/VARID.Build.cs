@@ -63,6 +63,7 @@ public class VARID : ModuleRules
 				"Renderer",
                 "CoreUObject",
                 "Engine",
+                "ImageWrapper", // Needed to decode image VF maps
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);